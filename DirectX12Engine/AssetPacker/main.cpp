@@ -0,0 +1,164 @@
+// packs loose files into an archive the engine mounts at startup
+//   AssetPacker [-store] [-block kilobytes] [-db database] output.aarc input...
+// paths are stored as they are given, so run it from the directory the engine runs in. with a build database
+// the archive is only packed again when an input, the input list or the options changed since the last run
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../DirectX12Engine/AssetArchive.h"
+#include "../DirectX12Engine/AssetBuilder.h"
+#include "../DirectX12Engine/JobSystem.h"
+
+namespace
+{
+	// bumped when the archive a given set of inputs packs to changes
+	const UINT c_packerVersion = 1;
+
+	bool readFile(const std::string & path, std::vector<UINT8> & data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+		if (!file)
+		{
+			return false;
+		}
+
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+		return static_cast<bool>(file);
+	}
+
+	// already entropy coded, lz won't find anything in them
+	bool worthCompressing(const std::string & path)
+	{
+		const size_t dot = path.find_last_of('.');
+		const std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+
+		return extension != "png" && extension != "jpg" && extension != "jpeg" && extension != "aarc";
+	}
+
+	bool pack(JobSystem & jobSystem, const std::string & outputPath, const std::vector<std::string> & inputs, const bool store, const UINT32 blockSize)
+	{
+		AssetArchiveWriter writer(jobSystem);
+
+		if (blockSize > 0)
+		{
+			writer.setBlockSize(blockSize);
+		}
+
+		for (size_t i = 0; i < inputs.size(); ++i)
+		{
+			std::vector<UINT8> data;
+
+			if (!readFile(inputs[i], data))
+			{
+				printf("failed to read %s\n", inputs[i].c_str());
+				return false;
+			}
+
+			writer.add(inputs[i], std::move(data), !store && worthCompressing(AssetFileSystem::normalisePath(inputs[i])));
+		}
+
+		ArchivePackStats stats;
+
+		if (!writer.save(outputPath, stats))
+		{
+			printf("failed to write %s\n", outputPath.c_str());
+			return false;
+		}
+
+		printf("%s: %u entries, %llu blocks, %llu -> %llu bytes (%.2fx) in %.3f ms on %u threads\n",
+			outputPath.c_str(), stats.m_entries, stats.m_blocks, stats.m_bytesIn, stats.m_bytesStored, stats.compressionRatio(),
+			stats.m_seconds * 1000.0, stats.m_threadCount);
+
+		return true;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	bool store = false;
+	UINT32 blockSize = 0;
+	std::string databasePath;
+	int arg = 1;
+
+	for (; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		if (strcmp(argv[arg], "-store") == 0)
+		{
+			store = true;
+		}
+		else if (strcmp(argv[arg], "-block") == 0 && arg + 1 < argc)
+		{
+			blockSize = static_cast<UINT32>(atoi(argv[++arg])) * 1024;
+		}
+		else if (strcmp(argv[arg], "-db") == 0 && arg + 1 < argc)
+		{
+			databasePath = argv[++arg];
+		}
+		else
+		{
+			printf("unknown option %s\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	if (argc - arg < 2)
+	{
+		printf("usage: AssetPacker [-store] [-block kilobytes] [-db database] output.aarc input...\n");
+		return 1;
+	}
+
+	const std::string outputPath = argv[arg++];
+	const std::vector<std::string> inputs(argv + arg, argv + argc);
+
+	JobSystem jobSystem;
+
+	if (databasePath.empty())
+	{
+		return pack(jobSystem, outputPath, inputs, store, blockSize) ? 0 : 1;
+	}
+
+	AssetBuilder builder(jobSystem);
+	builder.loadDatabase(databasePath);
+
+	char settings[64];
+	sprintf_s(settings, "store=%d block=%u", store ? 1 : 0, blockSize);
+
+	BuildStep step;
+	step.m_output = outputPath;
+	step.m_inputs = inputs;
+	step.m_settings = settings;
+	step.m_toolVersion = c_packerVersion;
+	step.m_build = [&](const BuildStep & packStep, std::vector<std::string> &)
+	{
+		return pack(jobSystem, packStep.m_output, packStep.m_inputs, store, blockSize);
+	};
+
+	builder.addStep(step);
+
+	AssetBuildStats stats;
+	const bool built = builder.build(stats);
+
+	if (stats.m_upToDate > 0)
+	{
+		printf("%s is up to date, checked %u inputs in %.3f ms\n", outputPath.c_str(), static_cast<UINT>(inputs.size()), stats.m_seconds * 1000.0);
+	}
+
+	if (!builder.saveDatabase(databasePath))
+	{
+		printf("failed to write %s\n", databasePath.c_str());
+		return 1;
+	}
+
+	return built ? 0 : 1;
+}
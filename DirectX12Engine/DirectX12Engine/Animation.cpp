@@ -0,0 +1,694 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	// skeletons per job, a skeleton on its own is too little work to be worth queuing
+	const size_t c_instancesPerJob = 8;
+
+	const UINT c_channelComponents[CHANNEL_COUNT] = { 3, 4, 3 };
+
+	// the three smallest quaternion components are within +-1/sqrt(2)
+	const float c_smallestThreeRange = 0.70710678f;
+	const float c_fixedPointScale = 1.0f / 65535.0f;
+
+	void appendTrack(KeyStream & stream, const std::vector<float> & times, const float * values, const UINT components)
+	{
+		for (size_t k = 0; k < times.size(); ++k)
+		{
+			stream.m_times.push_back(times[k]);
+
+			for (UINT c = 0; c < components; ++c)
+			{
+				stream.m_values[c].push_back(values[k * components + c]);
+			}
+		}
+
+		stream.m_trackStart.push_back(static_cast<UINT>(stream.m_times.size()));
+	}
+
+	// steps the track's cursor forward to the last key at or before time and interpolates from there.
+	// false for an empty track
+	bool sampleTrack(const KeyStream & stream, const UINT track, const UINT components, const float time, UINT & key, float * out)
+	{
+		const UINT start = stream.m_trackStart[track];
+		const UINT count = stream.m_trackStart[track + 1] - start;
+
+		if (count == 0)
+		{
+			return false;
+		}
+
+		const float * times = &stream.m_times[start];
+		UINT k = std::min(key, count - 1);
+
+		while (k + 1 < count && times[k + 1] <= time)
+		{
+			++k;
+		}
+
+		key = k;
+
+		// held before the first key and after the last
+		if (k + 1 >= count || time <= times[k])
+		{
+			for (UINT c = 0; c < components; ++c)
+			{
+				out[c] = stream.m_values[c][start + k];
+			}
+
+			return true;
+		}
+
+		const float t = (time - times[k]) / (times[k + 1] - times[k]);
+
+		for (UINT c = 0; c < components; ++c)
+		{
+			const float a = stream.m_values[c][start + k];
+			const float b = stream.m_values[c][start + k + 1];
+			out[c] = a + (b - a) * t;
+		}
+
+		return true;
+	}
+
+	// the compressed version of sampleTrack, the same stepping with the keys unpacked as they are read
+	bool sampleCompressedTrack(const CompressedKeyStream & stream, const AnimationChannel channel, const UINT track, const float time,
+		const float duration, UINT & key, float * out)
+	{
+		const UINT start = stream.m_trackStart[track];
+		const UINT count = stream.m_trackStart[track + 1] - start;
+
+		if (count == 0)
+		{
+			return false;
+		}
+
+		// compared as 16 bit fractions, no need to unpack the times
+		const UINT16 * times = &stream.m_times[start];
+		const float fraction = duration > 0.0f ? std::min(std::max(time / duration, 0.0f), 1.0f) * 65535.0f : 0.0f;
+		UINT k = std::min(key, count - 1);
+
+		while (k + 1 < count && times[k + 1] <= fraction)
+		{
+			++k;
+		}
+
+		key = k;
+
+		float a[4];
+		float b[4];
+		float t = 0.0f;
+		const bool hold = k + 1 >= count || fraction <= times[k];
+
+		if (!hold)
+		{
+			t = (fraction - times[k]) / static_cast<float>(times[k + 1] - times[k]);
+		}
+
+		if (channel == CHANNEL_ROTATION)
+		{
+			const DirectX::XMFLOAT4 from = unpackQuaternion(&stream.m_values[(start + k) * 3]);
+
+			if (hold)
+			{
+				out[0] = from.x;
+				out[1] = from.y;
+				out[2] = from.z;
+				out[3] = from.w;
+				return true;
+			}
+
+			const DirectX::XMFLOAT4 to = unpackQuaternion(&stream.m_values[(start + k + 1) * 3]);
+
+			// neighbouring keys can unpack on opposite sides, so lerp along the shorter arc
+			const float sign = (from.x * to.x + from.y * to.y + from.z * to.z + from.w * to.w) < 0.0f ? -1.0f : 1.0f;
+
+			a[0] = from.x; a[1] = from.y; a[2] = from.z; a[3] = from.w;
+			b[0] = to.x * sign; b[1] = to.y * sign; b[2] = to.z * sign; b[3] = to.w * sign;
+
+			for (UINT c = 0; c < 4; ++c)
+			{
+				out[c] = a[c] + (b[c] - a[c]) * t;
+			}
+
+			return true;
+		}
+
+		const DirectX::XMFLOAT3 & rangeMin = stream.m_rangeMin[track];
+		const DirectX::XMFLOAT3 & rangeExtent = stream.m_rangeExtent[track];
+		const float minimum[3] = { rangeMin.x, rangeMin.y, rangeMin.z };
+		const float extent[3] = { rangeExtent.x * c_fixedPointScale, rangeExtent.y * c_fixedPointScale, rangeExtent.z * c_fixedPointScale };
+
+		for (UINT c = 0; c < 3; ++c)
+		{
+			a[c] = minimum[c] + stream.m_values[(start + k) * 3 + c] * extent[c];
+			out[c] = a[c];
+		}
+
+		if (!hold)
+		{
+			for (UINT c = 0; c < 3; ++c)
+			{
+				b[c] = minimum[c] + stream.m_values[(start + k + 1) * 3 + c] * extent[c];
+				out[c] = a[c] + (b[c] - a[c]) * t;
+			}
+		}
+
+		return true;
+	}
+
+	// normalised lerp, b is flipped onto a's side first so it takes the shorter arc
+	DirectX::XMFLOAT4 nlerp(const DirectX::XMFLOAT4 & a, const DirectX::XMFLOAT4 & b, const float t)
+	{
+		const float sign = (a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w) < 0.0f ? -1.0f : 1.0f;
+
+		float q[4] =
+		{
+			a.x + (b.x * sign - a.x) * t,
+			a.y + (b.y * sign - a.y) * t,
+			a.z + (b.z * sign - a.z) * t,
+			a.w + (b.w * sign - a.w) * t,
+		};
+
+		const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+		return DirectX::XMFLOAT4(q[0] * scale, q[1] * scale, q[2] * scale, q[3] * scale);
+	}
+
+	DirectX::XMFLOAT4 normalise(const float * q)
+	{
+		const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+		return DirectX::XMFLOAT4(q[0] * scale, q[1] * scale, q[2] * scale, q[3] * scale);
+	}
+
+	// scale, then rotate, then translate, laid out for row vectors like XMMatrixAffineTransformation
+	void composeMatrix(const JointTransform & transform, DirectX::XMFLOAT4X4 & out)
+	{
+		const float x = transform.m_rotation.x;
+		const float y = transform.m_rotation.y;
+		const float z = transform.m_rotation.z;
+		const float w = transform.m_rotation.w;
+
+		const float sx = transform.m_scale.x;
+		const float sy = transform.m_scale.y;
+		const float sz = transform.m_scale.z;
+
+		out.m[0][0] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+		out.m[0][1] = 2.0f * (x * y + z * w) * sx;
+		out.m[0][2] = 2.0f * (x * z - y * w) * sx;
+		out.m[0][3] = 0.0f;
+
+		out.m[1][0] = 2.0f * (x * y - z * w) * sy;
+		out.m[1][1] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+		out.m[1][2] = 2.0f * (y * z + x * w) * sy;
+		out.m[1][3] = 0.0f;
+
+		out.m[2][0] = 2.0f * (x * z + y * w) * sz;
+		out.m[2][1] = 2.0f * (y * z - x * w) * sz;
+		out.m[2][2] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+		out.m[2][3] = 0.0f;
+
+		out.m[3][0] = transform.m_translation.x;
+		out.m[3][1] = transform.m_translation.y;
+		out.m[3][2] = transform.m_translation.z;
+		out.m[3][3] = 1.0f;
+	}
+
+	void sampleLayer(AnimationLayer & layer, const Skeleton & skeleton, const UINT jointCount, std::vector<JointTransform> & pose)
+	{
+		if (layer.m_clip != nullptr)
+		{
+			sampleClip(*layer.m_clip, skeleton, layer.m_time, layer.m_cursor, pose, jointCount);
+		}
+		else
+		{
+			sampleClip(*layer.m_compressedClip, skeleton, layer.m_time, layer.m_cursor, pose, jointCount);
+		}
+	}
+
+	void multiply(const DirectX::XMFLOAT4X4 & a, const DirectX::XMFLOAT4X4 & b, DirectX::XMFLOAT4X4 & out)
+	{
+		for (UINT r = 0; r < 4; ++r)
+		{
+			for (UINT c = 0; c < 4; ++c)
+			{
+				out.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+			}
+		}
+	}
+}
+
+void packQuaternion(const DirectX::XMFLOAT4 & rotation, UINT16 * packed)
+{
+	const float q[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+	UINT largest = 0;
+
+	for (UINT i = 1; i < 4; ++i)
+	{
+		if (std::fabs(q[i]) > std::fabs(q[largest]))
+		{
+			largest = i;
+		}
+	}
+
+	// q and -q are the same rotation, flipping it makes the dropped component positive
+	const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+	UINT written = 0;
+
+	for (UINT i = 0; i < 4; ++i)
+	{
+		if (i == largest)
+		{
+			continue;
+		}
+
+		// an even number of steps, so zero lands exactly on one
+		const float normalised = std::min(std::max(q[i] * sign / c_smallestThreeRange, -1.0f), 1.0f);
+		packed[written++] = static_cast<UINT16>(std::floor((normalised * 0.5f + 0.5f) * 32766.0f + 0.5f));
+	}
+
+	// the dropped component's index goes in the spare top bits of the first two
+	packed[0] |= static_cast<UINT16>((largest >> 1) << 15);
+	packed[1] |= static_cast<UINT16>((largest & 1) << 15);
+}
+
+DirectX::XMFLOAT4 unpackQuaternion(const UINT16 * packed)
+{
+	const UINT largest = ((packed[0] >> 15) << 1) | (packed[1] >> 15);
+
+	float q[4];
+	float sumSquares = 0.0f;
+	UINT read = 0;
+
+	for (UINT i = 0; i < 4; ++i)
+	{
+		if (i == largest)
+		{
+			continue;
+		}
+
+		q[i] = ((packed[read++] & 0x7fff) / 32766.0f * 2.0f - 1.0f) * c_smallestThreeRange;
+		sumSquares += q[i] * q[i];
+	}
+
+	q[largest] = std::sqrt(std::max(1.0f - sumSquares, 0.0f));
+
+	return DirectX::XMFLOAT4(q[0], q[1], q[2], q[3]);
+}
+
+size_t CompressedClip::getSizeInBytes() const
+{
+	size_t size = sizeof(m_duration);
+
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		const CompressedKeyStream & stream = m_channels[channel];
+
+		size += stream.m_times.size() * sizeof(UINT16) + stream.m_values.size() * sizeof(UINT16) + stream.m_trackStart.size() * sizeof(UINT) +
+			(stream.m_rangeMin.size() + stream.m_rangeExtent.size()) * sizeof(DirectX::XMFLOAT3);
+	}
+
+	return size;
+}
+
+int Skeleton::findJoint(const std::string & name) const
+{
+	for (size_t i = 0; i < m_names.size(); ++i)
+	{
+		if (m_names[i] == name)
+		{
+			return static_cast<int>(i);
+		}
+	}
+
+	return -1;
+}
+
+UINT Skeleton::countJointsToDepth(const UINT depth) const
+{
+	std::vector<UINT> depths(m_parents.size());
+
+	for (size_t j = 0; j < m_parents.size(); ++j)
+	{
+		depths[j] = m_parents[j] < 0 ? 0 : depths[m_parents[j]] + 1;
+
+		// breadth first, so the first joint too deep ends the prefix
+		if (depths[j] > depth)
+		{
+			return static_cast<UINT>(j);
+		}
+	}
+
+	return static_cast<UINT>(m_parents.size());
+}
+
+void AnimationClip::build(const std::vector<JointKeys> & keys, const float duration)
+{
+	m_duration = duration;
+
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		m_channels[channel] = KeyStream();
+		m_channels[channel].m_trackStart.push_back(0);
+	}
+
+	for (size_t j = 0; j < keys.size(); ++j)
+	{
+		const JointKeys & joint = keys[j];
+
+		assert(joint.m_translationTimes.size() == joint.m_translations.size());
+		assert(joint.m_rotationTimes.size() == joint.m_rotations.size());
+		assert(joint.m_scaleTimes.size() == joint.m_scales.size());
+
+		appendTrack(m_channels[CHANNEL_TRANSLATION], joint.m_translationTimes,
+			joint.m_translations.empty() ? nullptr : &joint.m_translations[0].x, 3);
+		appendTrack(m_channels[CHANNEL_ROTATION], joint.m_rotationTimes,
+			joint.m_rotations.empty() ? nullptr : &joint.m_rotations[0].x, 4);
+		appendTrack(m_channels[CHANNEL_SCALE], joint.m_scaleTimes,
+			joint.m_scales.empty() ? nullptr : &joint.m_scales[0].x, 3);
+	}
+}
+
+void AnimationCursor::reset(const AnimationClip & clip)
+{
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		m_keys[channel].assign(clip.getTrackCount(), 0);
+	}
+
+	m_time = 0.0f;
+}
+
+void AnimationCursor::reset(const CompressedClip & clip)
+{
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		m_keys[channel].assign(clip.getTrackCount(), 0);
+	}
+
+	m_time = 0.0f;
+}
+
+void sampleClip(const AnimationClip & clip, const Skeleton & skeleton, const float time, AnimationCursor & cursor, std::vector<JointTransform> & pose,
+	const UINT jointCount)
+{
+	const UINT trackCount = clip.getTrackCount();
+	const UINT sampledCount = std::min(trackCount, jointCount);
+
+	assert(trackCount == skeleton.m_parents.size());
+	assert(pose.size() == skeleton.m_parents.size());
+
+	if (cursor.m_keys[CHANNEL_TRANSLATION].size() != trackCount || time < cursor.m_time)
+	{
+		cursor.reset(clip);
+	}
+
+	cursor.m_time = time;
+
+	for (UINT track = sampledCount; track < trackCount; ++track)
+	{
+		pose[track] = skeleton.m_bindPose[track];
+	}
+
+	for (UINT track = 0; track < sampledCount; ++track)
+	{
+		JointTransform & joint = pose[track];
+		joint = skeleton.m_bindPose[track];
+
+		float values[4];
+
+		if (sampleTrack(clip.m_channels[CHANNEL_TRANSLATION], track, c_channelComponents[CHANNEL_TRANSLATION], time, cursor.m_keys[CHANNEL_TRANSLATION][track], values))
+		{
+			joint.m_translation = DirectX::XMFLOAT3(values[0], values[1], values[2]);
+		}
+
+		if (sampleTrack(clip.m_channels[CHANNEL_ROTATION], track, c_channelComponents[CHANNEL_ROTATION], time, cursor.m_keys[CHANNEL_ROTATION][track], values))
+		{
+			// lerped component wise, the keys are close enough together for that once it is renormalised
+			joint.m_rotation = normalise(values);
+		}
+
+		if (sampleTrack(clip.m_channels[CHANNEL_SCALE], track, c_channelComponents[CHANNEL_SCALE], time, cursor.m_keys[CHANNEL_SCALE][track], values))
+		{
+			joint.m_scale = DirectX::XMFLOAT3(values[0], values[1], values[2]);
+		}
+	}
+}
+
+void sampleClip(const CompressedClip & clip, const Skeleton & skeleton, const float time, AnimationCursor & cursor, std::vector<JointTransform> & pose,
+	const UINT jointCount)
+{
+	const UINT trackCount = clip.getTrackCount();
+	const UINT sampledCount = std::min(trackCount, jointCount);
+
+	assert(trackCount == skeleton.m_parents.size());
+	assert(pose.size() == skeleton.m_parents.size());
+
+	if (cursor.m_keys[CHANNEL_TRANSLATION].size() != trackCount || time < cursor.m_time)
+	{
+		cursor.reset(clip);
+	}
+
+	cursor.m_time = time;
+
+	for (UINT track = sampledCount; track < trackCount; ++track)
+	{
+		pose[track] = skeleton.m_bindPose[track];
+	}
+
+	for (UINT track = 0; track < sampledCount; ++track)
+	{
+		JointTransform & joint = pose[track];
+		joint = skeleton.m_bindPose[track];
+
+		float values[4];
+
+		if (sampleCompressedTrack(clip.m_channels[CHANNEL_TRANSLATION], CHANNEL_TRANSLATION, track, time, clip.m_duration, cursor.m_keys[CHANNEL_TRANSLATION][track], values))
+		{
+			joint.m_translation = DirectX::XMFLOAT3(values[0], values[1], values[2]);
+		}
+
+		if (sampleCompressedTrack(clip.m_channels[CHANNEL_ROTATION], CHANNEL_ROTATION, track, time, clip.m_duration, cursor.m_keys[CHANNEL_ROTATION][track], values))
+		{
+			joint.m_rotation = normalise(values);
+		}
+
+		if (sampleCompressedTrack(clip.m_channels[CHANNEL_SCALE], CHANNEL_SCALE, track, time, clip.m_duration, cursor.m_keys[CHANNEL_SCALE][track], values))
+		{
+			joint.m_scale = DirectX::XMFLOAT3(values[0], values[1], values[2]);
+		}
+	}
+}
+
+void blendPoses(const std::vector<JointTransform> & a, const std::vector<JointTransform> & b, const float weight, std::vector<JointTransform> & out)
+{
+	assert(a.size() == b.size());
+
+	out.resize(a.size());
+
+	for (size_t j = 0; j < a.size(); ++j)
+	{
+		const JointTransform & from = a[j];
+		const JointTransform & to = b[j];
+		JointTransform & blended = out[j];
+
+		blended.m_translation = DirectX::XMFLOAT3(
+			from.m_translation.x + (to.m_translation.x - from.m_translation.x) * weight,
+			from.m_translation.y + (to.m_translation.y - from.m_translation.y) * weight,
+			from.m_translation.z + (to.m_translation.z - from.m_translation.z) * weight);
+
+		blended.m_rotation = nlerp(from.m_rotation, to.m_rotation, weight);
+
+		blended.m_scale = DirectX::XMFLOAT3(
+			from.m_scale.x + (to.m_scale.x - from.m_scale.x) * weight,
+			from.m_scale.y + (to.m_scale.y - from.m_scale.y) * weight,
+			from.m_scale.z + (to.m_scale.z - from.m_scale.z) * weight);
+	}
+}
+
+void localToModel(const Skeleton & skeleton, const std::vector<JointTransform> & pose, std::vector<DirectX::XMFLOAT4X4> & model)
+{
+	model.resize(pose.size());
+
+	for (size_t j = 0; j < pose.size(); ++j)
+	{
+		const int parent = skeleton.m_parents[j];
+
+		if (parent < 0)
+		{
+			composeMatrix(pose[j], model[j]);
+			continue;
+		}
+
+		assert(static_cast<size_t>(parent) < j);
+
+		DirectX::XMFLOAT4X4 local;
+		composeMatrix(pose[j], local);
+		multiply(local, model[parent], model[j]);
+	}
+}
+
+void computeSkinPalette(const std::vector<DirectX::XMFLOAT4X4> & model, const std::vector<int> & boneJoints,
+	const std::vector<DirectX::XMFLOAT4X4> & inverseBindPose, const DirectX::XMFLOAT4X4 & modelToMesh, std::vector<DirectX::XMFLOAT4X4> & palette)
+{
+	assert(boneJoints.size() == inverseBindPose.size());
+
+	palette.resize(boneJoints.size());
+
+	for (size_t b = 0; b < boneJoints.size(); ++b)
+	{
+		DirectX::XMFLOAT4X4 boneToModel;
+
+		if (boneJoints[b] >= 0)
+		{
+			multiply(inverseBindPose[b], model[boneJoints[b]], boneToModel);
+		}
+		else
+		{
+			// not in the skeleton, it stays at its bind pose
+			boneToModel = inverseBindPose[b];
+		}
+
+		multiply(boneToModel, modelToMesh, palette[b]);
+	}
+}
+
+AnimationInstance::AnimationInstance()
+	: m_skeleton(nullptr)
+	, m_jointCount(UINT_MAX)
+{
+
+}
+
+void AnimationInstance::addLayer(const AnimationClip * clip, const float weight, const bool loop)
+{
+	AnimationLayer layer;
+	layer.m_clip = clip;
+	layer.m_compressedClip = nullptr;
+	layer.m_time = 0.0f;
+	layer.m_speed = 1.0f;
+	layer.m_weight = weight;
+	layer.m_loop = loop;
+	layer.m_cursor.reset(*clip);
+
+	m_layers.push_back(layer);
+}
+
+void AnimationInstance::addLayer(const CompressedClip * clip, const float weight, const bool loop)
+{
+	AnimationLayer layer;
+	layer.m_clip = nullptr;
+	layer.m_compressedClip = clip;
+	layer.m_time = 0.0f;
+	layer.m_speed = 1.0f;
+	layer.m_weight = weight;
+	layer.m_loop = loop;
+	layer.m_cursor.reset(*clip);
+
+	m_layers.push_back(layer);
+}
+
+AnimationSystem::AnimationSystem(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+{
+
+}
+
+AnimationSystem::~AnimationSystem()
+{
+
+}
+
+void AnimationSystem::evaluate(std::vector<AnimationInstance> & instances, const float deltaTime, AnimationStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	m_jobSystem.parallelFor(instances.size(), c_instancesPerJob, [&instances, deltaTime](const size_t begin, const size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			evaluateInstance(instances[i], deltaTime);
+		}
+	});
+
+	stats.m_skeletons = static_cast<UINT>(instances.size());
+	stats.m_joints = 0;
+
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		stats.m_joints += instances[i].m_localPose.size();
+	}
+
+	stats.m_seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+}
+
+void AnimationSystem::evaluateInstance(AnimationInstance & instance, const float deltaTime)
+{
+	evaluatePose(instance, deltaTime);
+	localToModel(*instance.m_skeleton, instance.m_localPose, instance.m_modelMatrices);
+}
+
+void AnimationSystem::evaluatePose(AnimationInstance & instance, const float deltaTime)
+{
+	const Skeleton & skeleton = *instance.m_skeleton;
+
+	instance.m_localPose.resize(skeleton.m_parents.size());
+	instance.m_layerPose.resize(skeleton.m_parents.size());
+
+	float totalWeight = 0.0f;
+
+	for (size_t l = 0; l < instance.m_layers.size(); ++l)
+	{
+		AnimationLayer & layer = instance.m_layers[l];
+		const float duration = layer.m_clip != nullptr ? layer.m_clip->m_duration : layer.m_compressedClip->m_duration;
+
+		layer.m_time += deltaTime * layer.m_speed;
+
+		if (layer.m_loop && duration > 0.0f)
+		{
+			layer.m_time = std::fmod(layer.m_time, duration);
+
+			if (layer.m_time < 0.0f)
+			{
+				layer.m_time += duration;
+			}
+		}
+		else
+		{
+			layer.m_time = std::min(std::max(layer.m_time, 0.0f), duration);
+		}
+
+		if (l == 0)
+		{
+			sampleLayer(layer, skeleton, instance.m_jointCount, instance.m_localPose);
+			totalWeight = layer.m_weight;
+			continue;
+		}
+
+		if (layer.m_weight <= 0.0f)
+		{
+			continue;
+		}
+
+		// blending each layer in by its share of the weight so far gives the weighted average of them all
+		sampleLayer(layer, skeleton, instance.m_jointCount, instance.m_layerPose);
+		totalWeight += layer.m_weight;
+		blendPoses(instance.m_localPose, instance.m_layerPose, layer.m_weight / totalWeight, instance.m_localPose);
+	}
+
+	if (instance.m_layers.empty())
+	{
+		instance.m_localPose = skeleton.m_bindPose;
+	}
+}
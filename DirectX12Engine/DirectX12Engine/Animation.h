@@ -0,0 +1,195 @@
+#pragma once
+#ifndef _ANIMATION_H_
+#define _ANIMATION_H_
+
+#include <Windows.h>
+
+#include <climits>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "JobSystem.h"
+
+// one joint's transform relative to its parent, the rotation is a unit quaternion (x, y, z, w)
+struct JointTransform
+{
+	DirectX::XMFLOAT3 m_translation;
+	DirectX::XMFLOAT4 m_rotation;
+	DirectX::XMFLOAT3 m_scale;
+};
+
+// joints are stored parents first, so one pass in order can build every model space matrix. breadth first is
+// best, then the joints down to any depth are a prefix of the list, which is what animation lod cuts to
+struct Skeleton
+{
+	std::vector<int> m_parents;					// -1 for a root
+	std::vector<std::string> m_names;			// the scene nodes the joints came from
+	std::vector<JointTransform> m_bindPose;		// used for every joint a clip has no keys for
+
+	int findJoint(const std::string & name) const;
+	// how many joints from the start of the list are at most depth below a root (a root is depth 0)
+	UINT countJointsToDepth(const UINT depth) const;
+};
+
+// keyframes for one joint the way assimp hands them over (aiNodeAnim), times in seconds
+struct JointKeys
+{
+	std::vector<float> m_translationTimes;
+	std::vector<DirectX::XMFLOAT3> m_translations;
+	std::vector<float> m_rotationTimes;
+	std::vector<DirectX::XMFLOAT4> m_rotations;
+	std::vector<float> m_scaleTimes;
+	std::vector<DirectX::XMFLOAT3> m_scales;
+};
+
+// every track of one channel in one stream, a track's keys are a contiguous run. times and each component
+// are separate arrays, so stepping through a track only touches the components the channel has
+struct KeyStream
+{
+	std::vector<float> m_times;
+	std::vector<float> m_values[4];		// x, y, z (and w for rotations)
+	std::vector<UINT> m_trackStart;		// first key of each joint's track, one past the end for the last
+};
+
+enum AnimationChannel
+{
+	CHANNEL_TRANSLATION = 0,
+	CHANNEL_ROTATION,
+	CHANNEL_SCALE,
+	CHANNEL_COUNT
+};
+
+// a clip in the runtime layout, one track per skeleton joint. an empty track leaves the joint at its bind pose
+struct AnimationClip
+{
+	std::string m_name;
+	float m_duration;	// seconds
+	KeyStream m_channels[CHANNEL_COUNT];
+
+	// keys[joint], there has to be one entry per joint of the skeleton the clip is played on
+	void build(const std::vector<JointKeys> & keys, const float duration);
+
+	UINT getTrackCount() const { return m_channels[CHANNEL_TRANSLATION].m_trackStart.empty() ? 0 : static_cast<UINT>(m_channels[CHANNEL_TRANSLATION].m_trackStart.size() - 1); }
+	UINT getKeyCount(const AnimationChannel channel, const UINT track) const { return m_channels[channel].m_trackStart[track + 1] - m_channels[channel].m_trackStart[track]; }
+};
+
+// the same clip after AnimationCompressor, sampled directly without unpacking it first. key times are 16 bit
+// fractions of the duration, rotations are smallest three in 48 bits, translations and scales 16 bit fixed point
+// over each track's range. every track starts at a known key, so any time can be sampled without the ones before
+struct CompressedKeyStream
+{
+	std::vector<UINT16> m_times;
+	std::vector<UINT16> m_values;			// three per key, one key after the other
+	std::vector<UINT> m_trackStart;			// the same as KeyStream::m_trackStart
+	std::vector<DirectX::XMFLOAT3> m_rangeMin;		// per track, translations and scales only
+	std::vector<DirectX::XMFLOAT3> m_rangeExtent;
+};
+
+struct CompressedClip
+{
+	std::string m_name;
+	float m_duration;
+	CompressedKeyStream m_channels[CHANNEL_COUNT];
+
+	UINT getTrackCount() const { return m_channels[CHANNEL_TRANSLATION].m_trackStart.empty() ? 0 : static_cast<UINT>(m_channels[CHANNEL_TRANSLATION].m_trackStart.size() - 1); }
+	UINT getKeyCount(const AnimationChannel channel, const UINT track) const { return m_channels[channel].m_trackStart[track + 1] - m_channels[channel].m_trackStart[track]; }
+	size_t getSizeInBytes() const;
+};
+
+// smallest three, the largest component is dropped (and made positive) and the other three stored in 15 bits each
+void packQuaternion(const DirectX::XMFLOAT4 & rotation, UINT16 * packed);
+DirectX::XMFLOAT4 unpackQuaternion(const UINT16 * packed);
+
+// where sampling last got to in every track, so the next sample steps forward from there instead of searching.
+// going back in time (a loop wrapping) restarts the tracks from their first key
+struct AnimationCursor
+{
+	std::vector<UINT> m_keys[CHANNEL_COUNT];	// per track, the key at or before the last sample time
+	float m_time;
+
+	void reset(const AnimationClip & clip);
+	void reset(const CompressedClip & clip);
+};
+
+// samples the tracks of the first jointCount joints at time into pose, which needs one entry per joint.
+// the joints past that are set to their bind pose
+void sampleClip(const AnimationClip & clip, const Skeleton & skeleton, const float time, AnimationCursor & cursor, std::vector<JointTransform> & pose,
+	const UINT jointCount = UINT_MAX);
+void sampleClip(const CompressedClip & clip, const Skeleton & skeleton, const float time, AnimationCursor & cursor, std::vector<JointTransform> & pose,
+	const UINT jointCount = UINT_MAX);
+
+// weight 0 keeps a, 1 gives b. rotations are normalised lerps along the shorter arc
+void blendPoses(const std::vector<JointTransform> & a, const std::vector<JointTransform> & b, const float weight, std::vector<JointTransform> & out);
+
+// row vector matrices (DirectXMath), a joint's model matrix is its local one times its parent's
+void localToModel(const Skeleton & skeleton, const std::vector<JointTransform> & pose, std::vector<DirectX::XMFLOAT4X4> & model);
+
+// model matrices into a skinning palette, one per skin bone: inverse bind pose * joint model matrix * modelToMesh
+void computeSkinPalette(const std::vector<DirectX::XMFLOAT4X4> & model, const std::vector<int> & boneJoints,
+	const std::vector<DirectX::XMFLOAT4X4> & inverseBindPose, const DirectX::XMFLOAT4X4 & modelToMesh, std::vector<DirectX::XMFLOAT4X4> & palette);
+
+// one clip playing on an instance, either a raw or a compressed one
+struct AnimationLayer
+{
+	const AnimationClip * m_clip;
+	const CompressedClip * m_compressedClip;
+	float m_time;
+	float m_speed;
+	float m_weight;		// relative to the other layers, they are normalised against each other
+	bool m_loop;
+	AnimationCursor m_cursor;
+};
+
+// a skeleton being animated, the layers are blended in order into m_localPose then m_modelMatrices
+struct AnimationInstance
+{
+	const Skeleton * m_skeleton;
+	std::vector<AnimationLayer> m_layers;
+	UINT m_jointCount;		// joints the layers are sampled for, the rest hold their bind pose. UINT_MAX for all of them
+
+	std::vector<JointTransform> m_localPose;
+	std::vector<DirectX::XMFLOAT4X4> m_modelMatrices;
+
+	// scratch for the layers after the first, kept so a frame doesn't allocate
+	std::vector<JointTransform> m_layerPose;
+
+	AnimationInstance();
+	void addLayer(const AnimationClip * clip, const float weight, const bool loop);
+	void addLayer(const CompressedClip * clip, const float weight, const bool loop);
+};
+
+struct AnimationStats
+{
+	UINT m_skeletons;
+	UINT64 m_joints;
+	double m_seconds;
+	UINT m_threadCount;
+
+	double skeletonsPerMillisecond() const
+	{
+		return m_seconds > 0.0 ? static_cast<double>(m_skeletons) / (m_seconds * 1000.0) : 0.0;
+	}
+};
+
+// advances and evaluates every instance, spread over the job system a few skeletons per job
+class AnimationSystem
+{
+public:
+	AnimationSystem(JobSystem & jobSystem);
+	~AnimationSystem();
+
+	void evaluate(std::vector<AnimationInstance> & instances, const float deltaTime, AnimationStats & stats);
+
+	// advance, sample, blend and build the model matrices for one instance
+	static void evaluateInstance(AnimationInstance & instance, const float deltaTime);
+	// the same without the model matrices, m_localPose is left with the blended layers
+	static void evaluatePose(AnimationInstance & instance, const float deltaTime);
+
+private:
+
+	JobSystem & m_jobSystem;
+};
+
+#endif // _ANIMATION_H_
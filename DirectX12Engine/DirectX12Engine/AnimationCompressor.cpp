@@ -0,0 +1,580 @@
+#include "AnimationCompressor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const UINT c_channelComponents[CHANNEL_COUNT] = { 3, 4, 3 };
+
+	// "ANMC" and the layout version, bumped whenever writeClip changes
+	const UINT c_clipMagic = 0x434d4e41;
+	const UINT c_clipVersion = 1;
+
+	float toleranceOf(const JointTolerance & tolerance, const UINT channel)
+	{
+		switch (channel)
+		{
+		case CHANNEL_TRANSLATION:
+			return tolerance.m_translation;
+		case CHANNEL_ROTATION:
+			return tolerance.m_rotation;
+		default:
+			return tolerance.m_scale;
+		}
+	}
+
+	// distance for translations, the angle between the two for rotations, the largest axis for scales
+	float keyError(const UINT channel, const float * a, const float * b)
+	{
+		if (channel == CHANNEL_ROTATION)
+		{
+			// from the chord between them rather than acos of the dot product, which loses small angles to float
+			// rounding. q and -q are the same rotation so the nearer of the two is used
+			float difference = 0.0f;
+			float sum = 0.0f;
+
+			for (UINT c = 0; c < 4; ++c)
+			{
+				difference += (a[c] - b[c]) * (a[c] - b[c]);
+				sum += (a[c] + b[c]) * (a[c] + b[c]);
+			}
+
+			const float chord = std::sqrt(std::min(difference, sum));
+			return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f));
+		}
+
+		if (channel == CHANNEL_TRANSLATION)
+		{
+			const float x = a[0] - b[0];
+			const float y = a[1] - b[1];
+			const float z = a[2] - b[2];
+
+			return std::sqrt(x * x + y * y + z * z);
+		}
+
+		return std::max(std::fabs(a[0] - b[0]), std::max(std::fabs(a[1] - b[1]), std::fabs(a[2] - b[2])));
+	}
+
+	// the same fraction of the duration the runtime compares the packed times against
+	float timeFraction(const float time, const float duration)
+	{
+		return duration > 0.0f ? std::min(std::max(time / duration, 0.0f), 1.0f) * 65535.0f : 0.0f;
+	}
+
+	// what the runtime gets between two unpacked keys, rotations renormalised afterwards like sampleClip does
+	void interpolate(const UINT channel, const float * a, const float * b, const float t, float * out)
+	{
+		if (channel != CHANNEL_ROTATION)
+		{
+			for (UINT c = 0; c < 3; ++c)
+			{
+				out[c] = a[c] + (b[c] - a[c]) * t;
+			}
+
+			return;
+		}
+
+		const float sign = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]) < 0.0f ? -1.0f : 1.0f;
+		float lengthSquared = 0.0f;
+
+		for (UINT c = 0; c < 4; ++c)
+		{
+			out[c] = a[c] + (b[c] * sign - a[c]) * t;
+			lengthSquared += out[c] * out[c];
+		}
+
+		const float scale = lengthSquared > 0.0f ? 1.0f / std::sqrt(lengthSquared) : 0.0f;
+
+		for (UINT c = 0; c < 4; ++c)
+		{
+			out[c] *= scale;
+		}
+	}
+
+	void jointValue(const JointTransform & joint, const UINT channel, float * out)
+	{
+		switch (channel)
+		{
+		case CHANNEL_TRANSLATION:
+			out[0] = joint.m_translation.x; out[1] = joint.m_translation.y; out[2] = joint.m_translation.z;
+			break;
+		case CHANNEL_ROTATION:
+			out[0] = joint.m_rotation.x; out[1] = joint.m_rotation.y; out[2] = joint.m_rotation.z; out[3] = joint.m_rotation.w;
+			break;
+		default:
+			out[0] = joint.m_scale.x; out[1] = joint.m_scale.y; out[2] = joint.m_scale.z;
+			break;
+		}
+	}
+
+	// one track's keys packed, and unpacked again so the reduction measures exactly what the runtime will see
+	struct QuantisedTrack
+	{
+		std::vector<UINT16> m_times;
+		std::vector<UINT16> m_values;
+		std::vector<float> m_unpacked;		// four floats a key whatever the channel
+		DirectX::XMFLOAT3 m_rangeMin;
+		DirectX::XMFLOAT3 m_rangeExtent;
+	};
+
+	void quantiseTrack(const UINT channel, const std::vector<float> & times, const std::vector<float> & values, const float duration, QuantisedTrack & track)
+	{
+		const size_t count = times.size();
+		const UINT components = c_channelComponents[channel];
+
+		track.m_times.resize(count);
+		track.m_values.resize(count * 3);
+		track.m_unpacked.assign(count * 4, 0.0f);
+		track.m_rangeMin = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		track.m_rangeExtent = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+		for (size_t k = 0; k < count; ++k)
+		{
+			track.m_times[k] = static_cast<UINT16>(std::floor(timeFraction(times[k], duration) + 0.5f));
+		}
+
+		if (channel == CHANNEL_ROTATION)
+		{
+			for (size_t k = 0; k < count; ++k)
+			{
+				const float * q = &values[k * components];
+				packQuaternion(DirectX::XMFLOAT4(q[0], q[1], q[2], q[3]), &track.m_values[k * 3]);
+
+				const DirectX::XMFLOAT4 unpacked = unpackQuaternion(&track.m_values[k * 3]);
+				track.m_unpacked[k * 4 + 0] = unpacked.x;
+				track.m_unpacked[k * 4 + 1] = unpacked.y;
+				track.m_unpacked[k * 4 + 2] = unpacked.z;
+				track.m_unpacked[k * 4 + 3] = unpacked.w;
+			}
+
+			return;
+		}
+
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (size_t k = 0; k < count; ++k)
+		{
+			for (UINT c = 0; c < 3; ++c)
+			{
+				minimum[c] = std::min(minimum[c], values[k * components + c]);
+				maximum[c] = std::max(maximum[c], values[k * components + c]);
+			}
+		}
+
+		track.m_rangeMin = DirectX::XMFLOAT3(minimum[0], minimum[1], minimum[2]);
+		track.m_rangeExtent = DirectX::XMFLOAT3(maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2]);
+
+		const float extent[3] = { track.m_rangeExtent.x, track.m_rangeExtent.y, track.m_rangeExtent.z };
+
+		for (size_t k = 0; k < count; ++k)
+		{
+			for (UINT c = 0; c < 3; ++c)
+			{
+				// a flat component packs to zero and unpacks to the minimum
+				const float normalised = extent[c] > 0.0f ? (values[k * components + c] - minimum[c]) / extent[c] : 0.0f;
+				const UINT16 packed = static_cast<UINT16>(std::floor(std::min(std::max(normalised, 0.0f), 1.0f) * 65535.0f + 0.5f));
+
+				track.m_values[k * 3 + c] = packed;
+				track.m_unpacked[k * 4 + c] = minimum[c] + packed * (extent[c] * (1.0f / 65535.0f));
+			}
+		}
+	}
+
+	// every source key strictly between first and last is within tolerance of the line between them
+	bool segmentFits(const UINT channel, const std::vector<float> & times, const std::vector<float> & values, const float duration,
+		const QuantisedTrack & track, const size_t first, const size_t last, const float tolerance)
+	{
+		const UINT components = c_channelComponents[channel];
+		const float from = track.m_times[first];
+		const float to = track.m_times[last];
+
+		for (size_t k = first + 1; k < last; ++k)
+		{
+			const float t = to > from ? std::min(std::max((timeFraction(times[k], duration) - from) / (to - from), 0.0f), 1.0f) : 0.0f;
+
+			float reconstructed[4];
+			interpolate(channel, &track.m_unpacked[first * 4], &track.m_unpacked[last * 4], t, reconstructed);
+
+			if (keyError(channel, &values[k * components], reconstructed) > tolerance)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template <typename T>
+	void appendArray(std::vector<UINT8> & out, const std::vector<T> & values)
+	{
+		const UINT count = static_cast<UINT>(values.size());
+		const size_t offset = out.size();
+
+		out.resize(offset + sizeof(count) + values.size() * sizeof(T));
+		memcpy(&out[offset], &count, sizeof(count));
+
+		if (!values.empty())
+		{
+			memcpy(&out[offset + sizeof(count)], values.data(), values.size() * sizeof(T));
+		}
+	}
+
+	// reads a count and that many values, false without touching values when the data is too short
+	template <typename T>
+	bool readArray(const UINT8 * data, const size_t size, size_t & offset, std::vector<T> & values)
+	{
+		UINT count = 0;
+
+		if (size - offset < sizeof(count))
+		{
+			return false;
+		}
+
+		memcpy(&count, data + offset, sizeof(count));
+		offset += sizeof(count);
+
+		if ((size - offset) / sizeof(T) < count)
+		{
+			return false;
+		}
+
+		values.resize(count);
+
+		if (count > 0)
+		{
+			memcpy(values.data(), data + offset, count * sizeof(T));
+		}
+
+		offset += count * sizeof(T);
+		return true;
+	}
+}
+
+AnimationCompressionSettings::AnimationCompressionSettings()
+	: m_jointTolerances()
+	, m_dropBindPoseTracks(true)
+{
+	// a tenth of a millimetre at a metre scale, a hundredth of a degree
+	m_defaultTolerance.m_translation = 0.0001f;
+	m_defaultTolerance.m_rotation = 0.000175f;
+	m_defaultTolerance.m_scale = 0.0001f;
+}
+
+AnimationCompressor::AnimationCompressor()
+{
+}
+
+AnimationCompressor::~AnimationCompressor()
+{
+}
+
+CompressedClip AnimationCompressor::compress(const AnimationClip & source, const Skeleton & skeleton, const AnimationCompressionSettings & settings,
+	AnimationCompressionReport & report)
+{
+	const UINT trackCount = source.getTrackCount();
+
+	assert(trackCount == skeleton.m_parents.size());
+	assert(settings.m_jointTolerances.empty() || settings.m_jointTolerances.size() == trackCount);
+
+	report = AnimationCompressionReport();
+
+	CompressedClip clip;
+	clip.m_name = source.m_name;
+	clip.m_duration = source.m_duration;
+
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		clip.m_channels[channel].m_trackStart.push_back(0);
+	}
+
+	std::vector<float> times;
+	std::vector<float> values;
+	std::vector<size_t> kept;
+	QuantisedTrack quantised;
+
+	for (UINT track = 0; track < trackCount; ++track)
+	{
+		const JointTolerance & jointTolerance = settings.m_jointTolerances.empty() ? settings.m_defaultTolerance : settings.m_jointTolerances[track];
+
+		for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+		{
+			const KeyStream & stream = source.m_channels[channel];
+			CompressedKeyStream & out = clip.m_channels[channel];
+			const UINT components = c_channelComponents[channel];
+			const float tolerance = toleranceOf(jointTolerance, channel);
+
+			const UINT start = stream.m_trackStart[track];
+			const UINT count = stream.m_trackStart[track + 1] - start;
+
+			report.m_sourceKeys += count;
+
+			times.assign(stream.m_times.begin() + start, stream.m_times.begin() + start + count);
+			values.resize(count * components);
+
+			for (UINT k = 0; k < count; ++k)
+			{
+				for (UINT c = 0; c < components; ++c)
+				{
+					values[k * components + c] = stream.m_values[c][start + k];
+				}
+			}
+
+			kept.clear();
+
+			bool bindPose = settings.m_dropBindPoseTracks;
+
+			if (bindPose && count > 0)
+			{
+				float bind[4];
+				jointValue(skeleton.m_bindPose[track], channel, bind);
+
+				for (UINT k = 0; k < count && bindPose; ++k)
+				{
+					bindPose = keyError(channel, &values[k * components], bind) <= tolerance;
+				}
+			}
+
+			if (count > 0 && !bindPose)
+			{
+				quantiseTrack(channel, times, values, source.m_duration, quantised);
+
+				// a constant track is held at its first key
+				bool constant = true;
+
+				for (UINT k = 1; k < count && constant; ++k)
+				{
+					constant = keyError(channel, &values[k * components], &quantised.m_unpacked[0]) <= tolerance;
+				}
+
+				kept.push_back(0);
+
+				if (!constant)
+				{
+					// greedy, each kept key reaches as far ahead as the tolerance allows
+					size_t first = 0;
+
+					while (first + 1 < count)
+					{
+						size_t last = first + 1;
+
+						while (last + 1 < count && segmentFits(channel, times, values, source.m_duration, quantised, first, last + 1, tolerance))
+						{
+							++last;
+						}
+
+						kept.push_back(last);
+						first = last;
+					}
+				}
+
+				for (size_t k = 0; k < kept.size(); ++k)
+				{
+					out.m_times.push_back(quantised.m_times[kept[k]]);
+					out.m_values.insert(out.m_values.end(), quantised.m_values.begin() + kept[k] * 3, quantised.m_values.begin() + kept[k] * 3 + 3);
+				}
+			}
+
+			out.m_trackStart.push_back(static_cast<UINT>(out.m_times.size()));
+
+			// rotations don't need a range, the others keep one per track (empty ones too) so they index by track
+			if (channel != CHANNEL_ROTATION)
+			{
+				out.m_rangeMin.push_back(kept.empty() ? DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f) : quantised.m_rangeMin);
+				out.m_rangeExtent.push_back(kept.empty() ? DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f) : quantised.m_rangeExtent);
+			}
+
+			report.m_keptKeys += kept.size();
+		}
+	}
+
+	// the source at the same precision AnimationClip keeps it in memory
+	report.m_sourceBytes = sizeof(source.m_duration);
+
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		const KeyStream & stream = source.m_channels[channel];
+		report.m_sourceBytes += stream.m_times.size() * sizeof(float) * (1 + c_channelComponents[channel]) + stream.m_trackStart.size() * sizeof(UINT);
+	}
+
+	report.m_compressedBytes = clip.getSizeInBytes();
+
+	// errors measured through the runtime samplers at every time any track has a key, walking forwards so both
+	// cursors only ever step ahead
+	std::vector<float> sampleTimes;
+
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		sampleTimes.insert(sampleTimes.end(), source.m_channels[channel].m_times.begin(), source.m_channels[channel].m_times.end());
+	}
+
+	std::sort(sampleTimes.begin(), sampleTimes.end());
+	sampleTimes.erase(std::unique(sampleTimes.begin(), sampleTimes.end()), sampleTimes.end());
+
+	AnimationCursor sourceCursor;
+	sourceCursor.reset(source);
+	AnimationCursor compressedCursor;
+	compressedCursor.reset(clip);
+
+	std::vector<JointTransform> sourcePose(trackCount);
+	std::vector<JointTransform> compressedPose(trackCount);
+
+	double errorSum[CHANNEL_COUNT] = { 0.0, 0.0, 0.0 };
+	float errorMax[CHANNEL_COUNT] = { 0.0f, 0.0f, 0.0f };
+	UINT64 errorCount[CHANNEL_COUNT] = { 0, 0, 0 };
+
+	for (size_t t = 0; t < sampleTimes.size(); ++t)
+	{
+		sampleClip(source, skeleton, sampleTimes[t], sourceCursor, sourcePose);
+		sampleClip(clip, skeleton, sampleTimes[t], compressedCursor, compressedPose);
+
+		for (UINT track = 0; track < trackCount; ++track)
+		{
+			for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+			{
+				// joints the source never moves aren't counted, they would only pull the mean down
+				if (source.getKeyCount(static_cast<AnimationChannel>(channel), track) == 0)
+				{
+					continue;
+				}
+
+				float a[4];
+				float b[4];
+				jointValue(sourcePose[track], channel, a);
+				jointValue(compressedPose[track], channel, b);
+
+				const float error = keyError(channel, a, b);
+				errorSum[channel] += error;
+				errorMax[channel] = std::max(errorMax[channel], error);
+				++errorCount[channel];
+			}
+		}
+	}
+
+	report.m_maxTranslationError = errorMax[CHANNEL_TRANSLATION];
+	report.m_maxRotationError = errorMax[CHANNEL_ROTATION];
+	report.m_maxScaleError = errorMax[CHANNEL_SCALE];
+	report.m_meanTranslationError = errorCount[CHANNEL_TRANSLATION] > 0 ? static_cast<float>(errorSum[CHANNEL_TRANSLATION] / errorCount[CHANNEL_TRANSLATION]) : 0.0f;
+	report.m_meanRotationError = errorCount[CHANNEL_ROTATION] > 0 ? static_cast<float>(errorSum[CHANNEL_ROTATION] / errorCount[CHANNEL_ROTATION]) : 0.0f;
+	report.m_meanScaleError = errorCount[CHANNEL_SCALE] > 0 ? static_cast<float>(errorSum[CHANNEL_SCALE] / errorCount[CHANNEL_SCALE]) : 0.0f;
+
+	return clip;
+}
+
+std::vector<UINT8> AnimationCompressor::writeClip(const CompressedClip & clip)
+{
+	std::vector<UINT8> file(sizeof(c_clipMagic) + sizeof(c_clipVersion) + sizeof(clip.m_duration));
+
+	memcpy(&file[0], &c_clipMagic, sizeof(c_clipMagic));
+	memcpy(&file[sizeof(c_clipMagic)], &c_clipVersion, sizeof(c_clipVersion));
+	memcpy(&file[sizeof(c_clipMagic) + sizeof(c_clipVersion)], &clip.m_duration, sizeof(clip.m_duration));
+
+	appendArray(file, std::vector<char>(clip.m_name.begin(), clip.m_name.end()));
+
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		const CompressedKeyStream & stream = clip.m_channels[channel];
+
+		appendArray(file, stream.m_trackStart);
+		appendArray(file, stream.m_times);
+		appendArray(file, stream.m_values);
+		appendArray(file, stream.m_rangeMin);
+		appendArray(file, stream.m_rangeExtent);
+	}
+
+	return file;
+}
+
+bool AnimationCompressor::readClip(const UINT8 * data, const size_t size, CompressedClip & clip)
+{
+	UINT magic = 0;
+	UINT version = 0;
+	size_t offset = sizeof(magic) + sizeof(version) + sizeof(clip.m_duration);
+
+	if (size < offset)
+	{
+		return false;
+	}
+
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&version, data + sizeof(magic), sizeof(version));
+
+	if (magic != c_clipMagic || version != c_clipVersion)
+	{
+		return false;
+	}
+
+	CompressedClip read;
+	memcpy(&read.m_duration, data + sizeof(magic) + sizeof(version), sizeof(read.m_duration));
+
+	std::vector<char> name;
+
+	if (!readArray(data, size, offset, name))
+	{
+		return false;
+	}
+
+	read.m_name.assign(name.begin(), name.end());
+
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		CompressedKeyStream & stream = read.m_channels[channel];
+
+		if (!readArray(data, size, offset, stream.m_trackStart) || !readArray(data, size, offset, stream.m_times) ||
+			!readArray(data, size, offset, stream.m_values) || !readArray(data, size, offset, stream.m_rangeMin) ||
+			!readArray(data, size, offset, stream.m_rangeExtent))
+		{
+			return false;
+		}
+
+		// the sampler trusts these, so a clip that doesn't hang together is refused here
+		if (stream.m_trackStart.empty() || stream.m_trackStart.back() != stream.m_times.size() || stream.m_values.size() != stream.m_times.size() * 3)
+		{
+			return false;
+		}
+
+		for (size_t t = 1; t < stream.m_trackStart.size(); ++t)
+		{
+			if (stream.m_trackStart[t] < stream.m_trackStart[t - 1])
+			{
+				return false;
+			}
+		}
+	}
+
+	const size_t tracks = read.m_channels[CHANNEL_TRANSLATION].m_trackStart.size();
+
+	for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+	{
+		const CompressedKeyStream & stream = read.m_channels[channel];
+		const size_t ranges = channel == CHANNEL_ROTATION ? 0 : tracks - 1;
+
+		if (stream.m_trackStart.size() != tracks || stream.m_rangeMin.size() != ranges || stream.m_rangeExtent.size() != ranges)
+		{
+			return false;
+		}
+	}
+
+	clip = std::move(read);
+	return true;
+}
+
+bool AnimationCompressor::saveClip(const CompressedClip & clip, const std::string & path)
+{
+	const std::vector<UINT8> file = writeClip(clip);
+
+	std::ofstream stream(path, std::ios::binary);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+	return static_cast<bool>(stream);
+}
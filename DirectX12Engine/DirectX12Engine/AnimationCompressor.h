@@ -0,0 +1,69 @@
+#pragma once
+#ifndef _ANIMATION_COMPRESSOR_H_
+#define _ANIMATION_COMPRESSOR_H_
+
+#include <string>
+#include <vector>
+
+#include "Animation.h"
+
+// largest error a joint's local transform may pick up, in the units of the clip
+struct JointTolerance
+{
+	float m_translation;	// distance
+	float m_rotation;		// radians
+	float m_scale;			// per axis
+};
+
+struct AnimationCompressionSettings
+{
+	JointTolerance m_defaultTolerance;
+	// per joint, e.g. tighter near the root where the error is carried down the whole chain. empty uses the default
+	std::vector<JointTolerance> m_jointTolerances;
+	// tracks that never leave the bind pose by more than the tolerance are left empty, they sample as the bind pose
+	bool m_dropBindPoseTracks;
+
+	AnimationCompressionSettings();
+};
+
+// the error is measured at every source key, between the source value and the compressed clip sampled at that time
+struct AnimationCompressionReport
+{
+	UINT64 m_sourceKeys;
+	UINT64 m_keptKeys;
+	size_t m_sourceBytes;
+	size_t m_compressedBytes;
+
+	float m_maxTranslationError;
+	float m_meanTranslationError;
+	float m_maxRotationError;		// radians
+	float m_meanRotationError;
+	float m_maxScaleError;
+	float m_meanScaleError;
+
+	double compressionRatio() const
+	{
+		return m_compressedBytes > 0 ? static_cast<double>(m_sourceBytes) / static_cast<double>(m_compressedBytes) : 0.0;
+	}
+};
+
+// cook stage for clips. every key is quantised first, then keys are removed greedily for as long as interpolating
+// the quantised neighbours stays inside the joint's tolerance of the source, so the tolerance covers both
+class AnimationCompressor
+{
+public:
+	AnimationCompressor();
+	~AnimationCompressor();
+
+	// the skeleton is the one the clip plays on, its bind pose is what empty tracks fall back to
+	CompressedClip compress(const AnimationClip & source, const Skeleton & skeleton, const AnimationCompressionSettings & settings,
+		AnimationCompressionReport & report);
+
+	// the clip as one flat little endian blob, the same layout as in memory so reading it is a few copies.
+	// readClip checks every count against the size before copying anything
+	static std::vector<UINT8> writeClip(const CompressedClip & clip);
+	static bool readClip(const UINT8 * data, const size_t size, CompressedClip & clip);
+	static bool saveClip(const CompressedClip & clip, const std::string & path);
+};
+
+#endif // _ANIMATION_COMPRESSOR_H_
@@ -0,0 +1,238 @@
+#include "AnimationScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	// the same batching as AnimationSystem, most instances in a crowd do little or nothing on a given frame
+	const size_t c_instancesPerJob = 16;
+}
+
+AnimationScheduler::InstanceState::InstanceState()
+	: m_level(UINT_MAX)
+	, m_hasPose(false)
+	, m_owedTime(0.0f)
+	, m_aheadTime(0.0f)
+	, m_framesSinceUpdate(0)
+	, m_interval(1)
+	, m_lastAction(SCHEDULE_HOLD)
+{
+
+}
+
+AnimationScheduler::AnimationScheduler(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+	, m_pixelsPerUnitAtOne(0.0f)
+	, m_hysteresis(0.2f)
+	, m_frame(0)
+{
+	setViewport(600, 0.785398f); // 45 degrees
+
+	// every frame up close, then every other frame, then every fourth without the hands and feet, and at the back
+	// every eighth with only the spine and limbs held without interpolating
+	const AnimationLodLevel levels[] =
+	{
+		{ 150.0f, 1, UINT_MAX, false },
+		{ 60.0f, 2, UINT_MAX, true },
+		{ 20.0f, 4, 4, true },
+		{ 0.0f, 8, 2, false },
+	};
+
+	m_levels.assign(levels, levels + sizeof(levels) / sizeof(levels[0]));
+}
+
+AnimationScheduler::~AnimationScheduler()
+{
+
+}
+
+void AnimationScheduler::setViewport(const UINT screenHeight, const float verticalFov)
+{
+	m_pixelsPerUnitAtOne = static_cast<float>(screenHeight) / (2.0f * std::tan(verticalFov * 0.5f));
+}
+
+float AnimationScheduler::projectedHeight(const AnimationVisibility & visibility) const
+{
+	// the camera is inside the bounds, it can't get any bigger
+	if (visibility.m_distance <= visibility.m_radius)
+	{
+		return FLT_MAX;
+	}
+
+	return 2.0f * visibility.m_radius * m_pixelsPerUnitAtOne / visibility.m_distance;
+}
+
+UINT AnimationScheduler::selectLevel(const AnimationVisibility & visibility, const UINT currentLevel) const
+{
+	assert(!m_levels.empty());
+
+	const float height = projectedHeight(visibility);
+	UINT wanted = static_cast<UINT>(m_levels.size() - 1);
+
+	for (UINT l = 0; l < m_levels.size(); ++l)
+	{
+		if (height >= m_levels[l].m_minScreenHeight)
+		{
+			wanted = l;
+			break;
+		}
+	}
+
+	// going finer happens straight away, going coarser only once it is clearly smaller than the current level
+	if (currentLevel < m_levels.size() && wanted > currentLevel &&
+		height >= m_levels[currentLevel].m_minScreenHeight * (1.0f - m_hysteresis))
+	{
+		return currentLevel;
+	}
+
+	return wanted;
+}
+
+bool AnimationScheduler::isUpdateFrame(const UINT64 frame, const size_t instance, const UINT interval)
+{
+	return interval <= 1 || (frame + instance) % interval == 0;
+}
+
+void AnimationScheduler::update(std::vector<AnimationInstance> & instances, const std::vector<AnimationVisibility> & visibility, const float deltaTime,
+	AnimationScheduleStats & stats)
+{
+	using namespace std::chrono;
+
+	assert(visibility.size() == instances.size());
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	m_states.resize(instances.size());
+
+	m_jobSystem.parallelFor(instances.size(), c_instancesPerJob, [this, &instances, &visibility, deltaTime](const size_t begin, const size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			m_states[i].m_lastAction = updateInstance(instances[i], m_states[i], visibility[i], i, deltaTime);
+		}
+	});
+
+	++m_frame;
+
+	stats.m_seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+	stats.m_instances = static_cast<UINT>(instances.size());
+	stats.m_evaluated = 0;
+	stats.m_interpolated = 0;
+	stats.m_held = 0;
+	stats.m_culled = 0;
+	stats.m_jointsSampled = 0;
+	stats.m_jointsAtFullRate = 0;
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		const UINT joints = static_cast<UINT>(instances[i].m_skeleton->m_parents.size());
+
+		stats.m_jointsAtFullRate += joints;
+
+		switch (m_states[i].m_lastAction)
+		{
+		case SCHEDULE_EVALUATE:
+			++stats.m_evaluated;
+			stats.m_jointsSampled += std::min(joints, instances[i].m_jointCount);
+			break;
+		case SCHEDULE_INTERPOLATE:
+			++stats.m_interpolated;
+			break;
+		case SCHEDULE_HOLD:
+			++stats.m_held;
+			break;
+		default:
+			++stats.m_culled;
+			break;
+		}
+	}
+}
+
+AnimationScheduler::ScheduleAction AnimationScheduler::updateInstance(AnimationInstance & instance, InstanceState & state,
+	const AnimationVisibility & visibility, const size_t index, const float deltaTime) const
+{
+	const Skeleton & skeleton = *instance.m_skeleton;
+
+	state.m_owedTime += deltaTime;
+	++state.m_framesSinceUpdate;
+
+	// nothing looks at the pose, it is evaluated afresh at whatever time it has got to once it is visible again
+	if (!visibility.m_visible)
+	{
+		state.m_hasPose = false;
+		return SCHEDULE_CULL;
+	}
+
+	const UINT level = selectLevel(visibility, state.m_level);
+	const AnimationLodLevel & lod = m_levels[level];
+	const UINT interval = std::max(lod.m_updateInterval, 1u);
+	const bool changed = level != state.m_level;
+
+	if (changed)
+	{
+		state.m_level = level;
+		instance.m_jointCount = lod.m_maxJointDepth == UINT_MAX ? UINT_MAX : skeleton.countJointsToDepth(lod.m_maxJointDepth);
+	}
+
+	// a new level starts its own schedule with an evaluation, after that the stagger decides
+	if (state.m_hasPose && !changed && !isUpdateFrame(m_frame, index, interval))
+	{
+		if (state.m_aheadTime <= 0.0f)
+		{
+			return SCHEDULE_HOLD;
+		}
+
+		const float t = std::min(static_cast<float>(state.m_framesSinceUpdate) / static_cast<float>(state.m_interval), 1.0f);
+
+		blendPoses(state.m_fromPose, state.m_toPose, t, instance.m_localPose);
+		localToModel(skeleton, instance.m_localPose, instance.m_modelMatrices);
+		return SCHEDULE_INTERPOLATE;
+	}
+
+	// to interpolate, the layers are evaluated a whole interval ahead and what is on screen now blends towards that.
+	// the layers may already be ahead from the last evaluation, a negative advance just winds them back
+	const bool interpolate = lod.m_interpolate && interval > 1;
+	const float ahead = interpolate ? deltaTime * interval : 0.0f;
+	float advance = state.m_owedTime - state.m_aheadTime;
+
+	if (interpolate)
+	{
+		if (!state.m_hasPose)
+		{
+			// nothing to start from, so it costs a second evaluation for the pose now
+			AnimationSystem::evaluatePose(instance, advance);
+			advance = 0.0f;
+		}
+		else if (state.m_aheadTime > 0.0f)
+		{
+			// where the last interval has got to, which is the target itself when the schedule was regular
+			const float t = std::min(static_cast<float>(state.m_framesSinceUpdate) / static_cast<float>(state.m_interval), 1.0f);
+			blendPoses(state.m_fromPose, state.m_toPose, t, instance.m_localPose);
+		}
+
+		state.m_fromPose = instance.m_localPose;
+	}
+
+	AnimationSystem::evaluatePose(instance, advance + ahead);
+
+	if (interpolate)
+	{
+		state.m_toPose = instance.m_localPose;
+		instance.m_localPose = state.m_fromPose;
+	}
+
+	localToModel(skeleton, instance.m_localPose, instance.m_modelMatrices);
+
+	state.m_hasPose = true;
+	state.m_owedTime = 0.0f;
+	state.m_aheadTime = ahead;
+	state.m_framesSinceUpdate = 0;
+	state.m_interval = interval;
+
+	return SCHEDULE_EVALUATE;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef _ANIMATION_SCHEDULER_H_
+#define _ANIMATION_SCHEDULER_H_
+
+#include <vector>
+
+#include "Animation.h"
+#include "JobSystem.h"
+
+// one animation level of detail, chosen by how tall the character is on screen
+struct AnimationLodLevel
+{
+	float m_minScreenHeight;	// pixels, the level is used down to this projected height
+	UINT m_updateInterval;		// frames between pose evaluations, 1 is every frame
+	UINT m_maxJointDepth;		// joints deeper than this hold their bind pose
+	bool m_interpolate;			// blend towards the next pose between evaluations instead of holding the last one
+};
+
+// what the scheduler needs to know about each character this frame
+struct AnimationVisibility
+{
+	float m_distance;	// from the camera
+	float m_radius;		// of the character's bounding sphere
+	bool m_visible;		// anything outside the frustum (or hidden) skips evaluation but keeps its time moving
+};
+
+struct AnimationScheduleStats
+{
+	UINT m_instances;
+	UINT m_evaluated;		// sampled this frame
+	UINT m_interpolated;	// blended between two evaluated poses
+	UINT m_held;			// kept last frame's pose
+	UINT m_culled;			// not visible
+	UINT64 m_jointsSampled;
+	UINT64 m_jointsAtFullRate;	// every joint of every instance, what evaluating them all every frame would sample
+	double m_seconds;
+	UINT m_threadCount;
+
+	double sampledFraction() const
+	{
+		return m_jointsAtFullRate > 0 ? static_cast<double>(m_jointsSampled) / static_cast<double>(m_jointsAtFullRate) : 0.0;
+	}
+};
+
+// evaluates far away and off screen characters less often and with fewer joints. each level updates every so many
+// frames, staggered by instance index so a crowd spreads its evaluations over the frames, and the frames in
+// between either hold the last pose or blend towards one evaluated that far ahead of time.
+// the policy only depends on its inputs and the frame count, so it can be tested without timing
+class AnimationScheduler
+{
+public:
+	AnimationScheduler(JobSystem & jobSystem);
+	~AnimationScheduler();
+
+	// screen height in pixels and vertical field of view in radians
+	void setViewport(const UINT screenHeight, const float verticalFov);
+	// finest first, the last level is used for everything smaller than the ones before it
+	void setLevels(const std::vector<AnimationLodLevel> & levels) { m_levels = levels; }
+	// fraction of a level's height a character has to be past before it drops to the coarser level
+	void setHysteresis(const float fraction) { m_hysteresis = fraction; }
+
+	const std::vector<AnimationLodLevel> & getLevels() const { return m_levels; }
+
+	// pixels tall the bounding sphere is on screen
+	float projectedHeight(const AnimationVisibility & visibility) const;
+	UINT selectLevel(const AnimationVisibility & visibility, const UINT currentLevel) const;
+	static bool isUpdateFrame(const UINT64 frame, const size_t instance, const UINT interval);
+
+	// visibility has one entry per instance. instances may be added or removed between calls, an instance
+	// that is new to the scheduler is evaluated straight away
+	void update(std::vector<AnimationInstance> & instances, const std::vector<AnimationVisibility> & visibility, const float deltaTime,
+		AnimationScheduleStats & stats);
+
+	// the level each instance used last frame
+	UINT getLevel(const size_t instance) const { return m_states[instance].m_level; }
+
+private:
+
+	enum ScheduleAction
+	{
+		SCHEDULE_EVALUATE = 0,
+		SCHEDULE_INTERPOLATE,
+		SCHEDULE_HOLD,
+		SCHEDULE_CULL
+	};
+
+	struct InstanceState
+	{
+		InstanceState();
+
+		UINT m_level;			// UINT_MAX before the first frame
+		bool m_hasPose;			// false until the first evaluation, and again after being culled
+		float m_owedTime;		// frame time not yet given to the layers
+		float m_aheadTime;		// how far the layers are ahead of real time, evaluated early to interpolate towards
+		UINT m_framesSinceUpdate;
+		UINT m_interval;		// of the level at the last evaluation
+		std::vector<JointTransform> m_fromPose;
+		std::vector<JointTransform> m_toPose;
+		ScheduleAction m_lastAction;
+	};
+
+	ScheduleAction updateInstance(AnimationInstance & instance, InstanceState & state, const AnimationVisibility & visibility,
+		const size_t index, const float deltaTime) const;
+
+	JobSystem & m_jobSystem;
+
+	std::vector<AnimationLodLevel> m_levels;
+	float m_pixelsPerUnitAtOne; // screen height / (2 tan(fov / 2))
+	float m_hysteresis;
+
+	std::vector<InstanceState> m_states;
+	UINT64 m_frame;
+};
+
+#endif // _ANIMATION_SCHEDULER_H_
@@ -11,161 +11,1451 @@
 #include <assimp/scene.h>           // Output data structure
 #include <assimp/postprocess.h>     // Post processing flags
 
+#include <algorithm>
 #include <vector>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+#include "AssetArchive.h"
+#include "AssetIOSystem.h"
+#include "DdsLoader.h"
+#include "GltfLoader.h"
+#include "JobSystem.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+#include "SceneFlattener.h"
+#include "Skinning.h"
+#include "WicImageDecoder.h"
+
+namespace
+{
+	// streamed texture memory, the mip tails count towards it too
+	const UINT64 c_textureStreamingBudget = 256 * 1024 * 1024;
+	// rough size of m_geomatry in world units, the texel density is worked out against it
+	const float c_streamedObjectSize = 2.0f;
+	// every path is set up for every skinned mesh, this only picks the one drawn
+	const SkinningPath c_skinningPath = SKINNING_COMPUTE;
+	// what assimp's own animation code assumes when a file doesn't say
+	const double c_defaultTicksPerSecond = 25.0;
+	// morph deltas shorter than this (after the import scale) aren't kept
+	const float c_morphDeltaThreshold = 0.00001f;
+	// built with AssetPacker, optional
+	const char * const c_assetArchivePath = "assets.aarc";
+
+	// normals the file doesn't have come from TangentSpaceGenerator where they're used (the morphed mesh) instead of
+	// aiProcess_GenNormals on everything. its tangents replace aiProcess_CalcTangentSpace once something samples normal maps
+	const unsigned int c_importFlags =
+		aiProcess_Triangulate |
+		aiProcess_JoinIdenticalVertices | // needed for the index buffer to share vertices
+		aiProcess_SortByPType |
+		// aiProcess_FlipWindingOrder|
+		aiProcess_GenUVCoords |
+		aiProcess_MakeLeftHanded;
+
+	// assimp matrices transform column vectors, DirectXMath ones row vectors
+	DirectX::XMFLOAT4X4 toRowMajor(const aiMatrix4x4 & matrix)
+	{
+		DirectX::XMFLOAT4X4 out;
+
+		for (UINT r = 0; r < 4; ++r)
+		{
+			for (UINT c = 0; c < 4; ++c)
+			{
+				out.m[r][c] = matrix[c][r];
+			}
+		}
+
+		return out;
+	}
+
+	// positions and triangles, aiProcess_Triangulate and aiProcess_SortByPType mean every face is a triangle
+	void copyMesh(const aiMesh * mesh, MeshData & meshData)
+	{
+		meshData.m_vertices.resize(mesh->mNumVertices);
+
+		for (size_t i = 0; i < mesh->mNumVertices; ++i)
+		{
+			meshData.m_vertices[i].m_position.x = mesh->mVertices[i].x;
+			meshData.m_vertices[i].m_position.y = mesh->mVertices[i].y;
+			meshData.m_vertices[i].m_position.z = mesh->mVertices[i].z;
+		}
+
+		meshData.m_indices.reserve(mesh->mNumFaces * 3);
+
+		for (size_t i = 0; i < mesh->mNumFaces; ++i)
+		{
+			assert(mesh->mFaces[i].mNumIndices == 3);
+
+			meshData.m_indices.push_back(mesh->mFaces[i].mIndices[0]);
+			meshData.m_indices.push_back(mesh->mFaces[i].mIndices[1]);
+			meshData.m_indices.push_back(mesh->mFaces[i].mIndices[2]);
+		}
+	}
+
+	// an instance for every mesh of every node, with the node's transform down from the root
+	void gatherSceneInstances(const aiScene * scene, std::vector<SceneInstance> & instances)
+	{
+		std::vector<std::pair<const aiNode *, DirectX::XMFLOAT4X4> > toVisit;
+		DirectX::XMFLOAT4X4 identity;
+		DirectX::XMStoreFloat4x4(&identity, DirectX::XMMatrixIdentity());
+		toVisit.push_back(std::make_pair(scene->mRootNode, identity));
+
+		while (!toVisit.empty())
+		{
+			const aiNode * node = toVisit.back().first;
+			const DirectX::XMFLOAT4X4 local = toRowMajor(node->mTransformation);
+			const DirectX::XMFLOAT4X4 parentWorld = toVisit.back().second;
+			toVisit.pop_back();
+
+			DirectX::XMFLOAT4X4 world;
+			DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&local), DirectX::XMLoadFloat4x4(&parentWorld)));
+
+			for (UINT m = 0; m < node->mNumMeshes; ++m)
+			{
+				SceneInstance instance;
+				instance.m_mesh = node->mMeshes[m];
+				instance.m_material = scene->mMeshes[node->mMeshes[m]]->mMaterialIndex;
+				instance.m_world = world;
+				instances.push_back(instance);
+			}
+
+			for (UINT c = 0; c < node->mNumChildren; ++c)
+			{
+				toVisit.push_back(std::make_pair(node->mChildren[c], world));
+			}
+		}
+	}
+
+	// blinn-phong exponent to a roughness, the usual sqrt(2 / (n + 2)) match between the two lobes
+	float shininessToRoughness(const float shininess)
+	{
+		return shininess > 0.0f ? std::sqrt(2.0f / (shininess + 2.0f)) : 1.0f;
+	}
+
+	// bakes the instances into one mesh of batches merged by material
+	bool flattenScene(JobSystem & jobSystem, const std::vector<MeshData> & meshes, const std::vector<SceneInstance> & instances,
+		const std::string & scenePath, MeshData & meshData)
+	{
+		SceneFlattener sceneFlattener(jobSystem);
+		std::vector<SceneBatch> batches;
+		SceneFlattenStats flattenStats;
+
+		if (!sceneFlattener.flatten(meshes, instances, meshData, batches, flattenStats))
+		{
+			return false;
+		}
+
+		char flattenStr[256];
+		sprintf_s(flattenStr, "SceneFlattener: %.64s, %u draws -> %u batches over %u materials, %llu vertices -> %u, %u mirrored, %.3f ms on %u threads\n",
+			scenePath.c_str(), flattenStats.m_instances, flattenStats.m_batches, flattenStats.m_materials, flattenStats.m_bakedVertices,
+			flattenStats.m_vertices, flattenStats.m_mirroredInstances, flattenStats.m_seconds * 1000.0, flattenStats.m_threadCount);
+		OutputDebugStringA(flattenStr);
+
+		return true;
+	}
+}
 
 LRESULT CALLBACK WindowCallBackFunc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
 	PAINTSTRUCT ps;
 	HDC hdc;
 
-	switch (message)
+	switch (message)
+	{
+	case WM_PAINT:
+		hdc = BeginPaint(hWnd, &ps);
+		EndPaint(hWnd, &ps);
+		break;
+
+	case WM_DESTROY:
+		PostQuitMessage(0);
+		break;
+
+	default:
+		return DefWindowProc(hWnd, message, wParam, lParam);
+	}
+
+	return 0;
+}
+
+
+ApplicationCore::ApplicationCore()
+	: m_windowPtr(nullptr)
+	, m_rendererPtr(nullptr)
+	, m_geomatry(c_invalidResourceHandle)
+	, m_geomatryLod(0)
+	, m_ioService(&m_ioBackend)
+	, m_cpuSkinner(m_jobSystem)
+	, m_hasSkinnedMesh(false)
+	, m_skinningStats()
+	, m_animationScheduler(m_jobSystem)
+	, m_animationStats()
+	, m_morphBlender(m_jobSystem)
+	, m_hasMorphedMesh(false)
+	, m_morphTime(0.0f)
+	, m_morphedGeometry(c_invalidResourceHandle)
+	, m_morphedVertices()
+	, m_morphStats()
+	, m_materialBuffer(c_invalidResourceHandle)
+	, m_frameCount(0)
+	, m_viewDistance(1.0f)
+{
+	for (UINT copy = 0; copy < c_dynamicBufferCopies; ++copy)
+	{
+		m_morphStaleBegin[copy] = 0;
+		m_morphStaleEnd[copy] = 0;
+	}
+}
+
+ApplicationCore::~ApplicationCore()
+{
+
+}
+
+HRESULT ApplicationCore::init(HINSTANCE hInst, int nCmdValues, const std::string & indexFile)
+{
+	// create Win32 window
+
+	m_windowPtr = new Win32Window(800, 600, "Dx12 Engine");
+
+	if (FAILED(m_windowPtr->createWindow(hInst, WindowCallBackFunc, nCmdValues)))
+	{
+		return E_FAIL;
+	} 
+
+	const HWND windowHandle = m_windowPtr->getWindowHandle();
+
+	// start of stuff to put in initDirectx() 
+
+	m_rendererPtr = new Dx12Renderer(800, 600);
+
+	if (FAILED(m_rendererPtr->init(windowHandle)))
+	{
+		return E_FAIL;
+	}
+
+	if (FAILED(m_ioBackend.init()))
+	{
+		return E_FAIL;
+	}
+
+	m_ioService.start();
+
+	m_lodSelector.setViewport(600, DirectX::XM_PIDIV4);
+	m_textureStreamer.setViewport(600, DirectX::XM_PIDIV4);
+	m_animationScheduler.setViewport(600, DirectX::XM_PIDIV4);
+	m_textureStreamer.setBudget(c_textureStreamingBudget);
+
+	// populate the vertex buffer, (deal with the geomatry struct)
+
+	{
+		// a packed archive next to the executable shadows the loose files, anything not in it still comes off disk
+		if (m_assetArchive.open(c_assetArchivePath))
+		{
+			ArchiveReadStats archiveStats;
+
+			if (!m_assetArchive.mountInto(m_assetFileSystem, m_jobSystem, archiveStats))
+			{
+				OutputDebugStringA("AssetArchive: some entries failed to decompress\n");
+			}
+
+			char archiveStr[256];
+			sprintf_s(archiveStr, "AssetArchive: mounted %u entries, %llu bytes decompressed in %.3f ms on %u threads\n",
+				m_assetArchive.getEntryCount(), archiveStats.m_bytesOut, archiveStats.m_seconds * 1000.0, archiveStats.m_threadCount);
+			OutputDebugStringA(archiveStr);
+		}
+
+		Assimp::Importer importer;
+
+		// the scene and everything it references are read out of mappings instead of through stdio, the importer owns the adapter
+		importer.SetIOHandler(new AssetIOSystem(m_assetFileSystem));
+
+		const std::string scenePath = "TestCube.obj";
+		const size_t sceneDirectoryEnd = scenePath.find_last_of("/\\");
+		const std::string sceneDirectory = sceneDirectoryEnd == std::string::npos ? std::string() : scenePath.substr(0, sceneDirectoryEnd);
+
+		// down scale the vertex data, want it to be visable on screen
+
+		const float scaleVerticesBy = 0.25f;
+
+		MeshData meshData;
+		std::vector<TextureSource> textureSources;
+
+		// only set when the scene came through Assimp, .obj and glTF files are read natively
+		const aiScene * testScene = nullptr;
+		const aiMesh * importedMesh = nullptr;
+
+		// keeps a .glb mapped, the images packed into it are decoded from there with the rest of the textures
+		GltfAsset gltfAsset;
+
+		const std::chrono::steady_clock::time_point importStart = std::chrono::steady_clock::now();
+		const std::string sceneExtension = TextureLoader::extensionOf(scenePath);
+
+		if (sceneExtension == "obj")
+		{
+			ObjLoader objLoader(m_jobSystem, m_assetFileSystem);
+			ObjMesh objMesh;
+			ObjLoadStats objStats;
+
+			if (!objLoader.load(scenePath, objMesh, objStats))
+			{
+				MessageBoxA(windowHandle, "Failed to load the scene", "ObjLoader::load() failed", MB_OK);
+				return E_FAIL;
+			}
+
+			char objStr[256];
+			sprintf_s(objStr, "ObjLoader: %.64s, %u triangles, %u vertices from %u positions, %.1f MB/s in %u chunks on %u threads\n",
+				scenePath.c_str(), objStats.m_triangles, objStats.m_vertices, objStats.m_positions, objStats.megabytesPerSecond(),
+				objStats.m_chunks, objStats.m_threadCount);
+			OutputDebugStringA(objStr);
+
+			meshData = std::move(objMesh.m_mesh);
+			textureSources = gatherTextureSources(objMesh.m_materials, sceneDirectory);
+			addMaterials(describeMaterials(objMesh.m_materials));
+
+#ifdef _DEBUG
+			// it stands in for Assimp, so check the two still agree. Assimp splits the file per material and joins
+			// vertices within each, so a vertex shared across materials counts once here and once per mesh there
+			{
+				const aiScene * reference = importer.ReadFile(scenePath, c_importFlags);
+				UINT64 referenceVertices = 0;
+				UINT64 referenceIndices = 0;
+
+				for (UINT m = 0; reference != nullptr && m < reference->mNumMeshes; ++m)
+				{
+					referenceVertices += reference->mMeshes[m]->mNumVertices;
+					referenceIndices += reference->mMeshes[m]->mNumFaces * 3;
+				}
+
+				char compareStr[256];
+				sprintf_s(compareStr, "ObjLoader: %u vertices and %u indices, Assimp %llu and %llu\n",
+					static_cast<UINT>(meshData.m_vertices.size()), static_cast<UINT>(meshData.m_indices.size()), referenceVertices, referenceIndices);
+				OutputDebugStringA(compareStr);
+
+				importer.FreeScene();
+			}
+#endif
+		}
+		else if (sceneExtension == "glb" || sceneExtension == "gltf")
+		{
+			GltfLoadStats gltfStats;
+
+			if (!gltfAsset.open(m_assetFileSystem, scenePath, gltfStats))
+			{
+				MessageBoxA(windowHandle, "Failed to load the scene", "GltfAsset::open() failed", MB_OK);
+				return E_FAIL;
+			}
+
+			char gltfStr[256];
+			sprintf_s(gltfStr, "GltfAsset: %.64s, %u meshes, %u nodes, %u accessors, %u JSON values, %llu bytes in %.3f ms\n",
+				scenePath.c_str(), gltfStats.m_meshes, gltfStats.m_nodes, gltfStats.m_accessors, gltfStats.m_jsonValues,
+				gltfStats.m_bytes, gltfStats.m_seconds * 1000.0);
+			OutputDebugStringA(gltfStr);
+
+			// each primitive read once however many nodes use it, then every node's copy baked and merged like the
+			// Assimp scenes. the vertices get scaled and coloured below so they are converted, not uploaded from the file as they are
+			const std::vector<GltfMesh> & gltfMeshes = gltfAsset.getMeshes();
+			const std::vector<UINT> materialIds = addMaterials(describeMaterials(gltfAsset));
+			std::vector<MeshData> sceneMeshes;
+			std::vector<UINT> firstPrimitive(gltfMeshes.size());
+
+			for (size_t m = 0; m < gltfMeshes.size(); ++m)
+			{
+				firstPrimitive[m] = static_cast<UINT>(sceneMeshes.size());
+
+				for (size_t p = 0; p < gltfMeshes[m].m_primitives.size(); ++p)
+				{
+					sceneMeshes.push_back(MeshData());
+					MeshData & primitive = sceneMeshes.back();
+
+					// points and lines are skipped like aiProcess_SortByPType leaves them out of the triangle mesh, an
+					// empty mesh draws nothing
+					if (!gltfAsset.readVertices(gltfMeshes[m].m_primitives[p], primitive.m_vertices) ||
+						!gltfAsset.readIndices(gltfMeshes[m].m_primitives[p], 0, primitive.m_indices))
+					{
+						primitive = MeshData();
+					}
+				}
+			}
+
+			std::vector<DirectX::XMFLOAT4X4> worldTransforms;
+			gltfAsset.computeWorldTransforms(worldTransforms);
+
+			const std::vector<GltfNode> & nodes = gltfAsset.getNodes();
+			std::vector<SceneInstance> instances;
+			std::vector<UINT> toVisit = gltfAsset.getSceneRoots();
+
+			while (!toVisit.empty())
+			{
+				const UINT n = toVisit.back();
+				toVisit.pop_back();
+				toVisit.insert(toVisit.end(), nodes[n].m_children.begin(), nodes[n].m_children.end());
+
+				if (nodes[n].m_mesh == c_gltfNone)
+				{
+					continue;
+				}
+
+				const std::vector<GltfPrimitive> & primitives = gltfMeshes[nodes[n].m_mesh].m_primitives;
+
+				for (size_t p = 0; p < primitives.size(); ++p)
+				{
+					SceneInstance instance;
+					instance.m_mesh = firstPrimitive[nodes[n].m_mesh] + static_cast<UINT>(p);
+					// the default material is the last one described
+					instance.m_material = primitives[p].m_material == c_gltfNone ? materialIds.back() : materialIds[primitives[p].m_material];
+					instance.m_world = worldTransforms[n];
+					instances.push_back(instance);
+				}
+			}
+
+			if (!flattenScene(m_jobSystem, sceneMeshes, instances, scenePath, meshData))
+			{
+				MessageBoxA(windowHandle, "Failed to flatten the scene", "SceneFlattener::flatten() failed", MB_OK);
+				return E_FAIL;
+			}
+
+			textureSources = gatherTextureSources(gltfAsset, sceneDirectory);
+		}
+		else
+		{
+			testScene = importer.ReadFile(scenePath, c_importFlags);
+
+			assert(testScene);
+
+			const std::vector<UINT> materialIds = addMaterials(describeMaterials(testScene));
+
+			// a lone skinned or morphed mesh keeps its vertices as they are, it is drawn through its own path below.
+			// anything else is static, so the node hierarchy is baked into the vertices and merged into batches
+			if (testScene->mNumMeshes == 1 && (testScene->mMeshes[0]->HasBones() || testScene->mMeshes[0]->mNumAnimMeshes > 0))
+			{
+				importedMesh = testScene->mMeshes[0];
+				copyMesh(importedMesh, meshData);
+			}
+			else
+			{
+				std::vector<MeshData> sceneMeshes(testScene->mNumMeshes);
+
+				for (UINT m = 0; m < testScene->mNumMeshes; ++m)
+				{
+					copyMesh(testScene->mMeshes[m], sceneMeshes[m]);
+				}
+
+				std::vector<SceneInstance> instances;
+				gatherSceneInstances(testScene, instances);
+
+				// merged by material id, not the scene's index, so copies of one material end up in the same batches
+				for (size_t i = 0; i < instances.size(); ++i)
+				{
+					instances[i].m_material = materialIds[instances[i].m_material];
+				}
+
+				if (!flattenScene(m_jobSystem, sceneMeshes, instances, scenePath, meshData))
+				{
+					MessageBoxA(windowHandle, "Failed to flatten the scene", "SceneFlattener::flatten() failed", MB_OK);
+					return E_FAIL;
+				}
+			}
+
+			textureSources = gatherTextureSources(testScene, sceneDirectory);
+		}
+
+		{
+			const double importSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - importStart).count();
+			const AssetFileStats & fileStats = m_assetFileSystem.getStats();
+
+			char importStr[256];
+			sprintf_s(importStr, "AssetFileSystem: imported %.64s in %.3f ms, %u opens (%u from memory), %u files mapped, %llu bytes, %u missing\n",
+				scenePath.c_str(), importSeconds * 1000.0, fileStats.m_opens, fileStats.m_mountedOpens, fileStats.m_filesMapped,
+				fileStats.m_bytesMapped, fileStats.m_missing);
+			OutputDebugStringA(importStr);
+
+			// the scene has been copied out, nothing else reads these
+			m_assetFileSystem.releaseLooseFiles();
+		}
+
+		for (size_t i = 0; i < meshData.m_vertices.size(); ++i)
+		{
+			meshData.m_vertices[i].m_position.x *= scaleVerticesBy;
+			meshData.m_vertices[i].m_position.y *= scaleVerticesBy;
+			meshData.m_vertices[i].m_position.z *= scaleVerticesBy;
+
+			// assign colour based on i
+			if (i % 3 == 0) // i is a multiple of 3
+			{
+				meshData.m_vertices[i].m_colour = DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f); // blue
+			}
+			else if (i % 2 == 0) // i is a multiple of 2
+			{
+				meshData.m_vertices[i].m_colour = DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f); // green
+			}
+			else
+			{
+				meshData.m_vertices[i].m_colour = DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f); // red
+			}
+		}
+
+		// a skinned or morphed mesh is drawn through its own path instead, before the cook steps reorder the vertices
+		if (importedMesh != nullptr && importedMesh->HasBones())
+		{
+			if (FAILED(initSkinnedMesh(testScene, importedMesh, meshData, scaleVerticesBy)))
+			{
+				MessageBoxA(windowHandle, "Failed to create the skinned mesh", "initSkinnedMesh() failed", MB_OK);
+				return E_FAIL;
+			}
+		}
+		else if (importedMesh != nullptr && importedMesh->mNumAnimMeshes > 0)
+		{
+			if (FAILED(initMorphedMesh(importedMesh, meshData, scaleVerticesBy)))
+			{
+				MessageBoxA(windowHandle, "Failed to create the morphed mesh", "initMorphedMesh() failed", MB_OK);
+				return E_FAIL;
+			}
+		}
+
+		// cook step, build the lod chain then reorder each level for the post transform cache, overdraw and vertex fetch
+		{
+			MeshSimplifier meshSimplifier;
+			meshSimplifier.buildLodChain(meshData);
+		}
+
+		{
+			MeshOptimiser meshOptimiser;
+			const MeshOptimiserReport report = meshOptimiser.optimise(meshData);
+
+			char reportStr[256];
+			sprintf_s(reportStr, "MeshOptimiser: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+				report.m_before.m_acmr, report.m_after.m_acmr, report.m_before.m_atvr, report.m_after.m_atvr);
+			OutputDebugStringA(reportStr);
+		}
+
+		// split the full detail level into meshlets, this reorders its triangles so it has to come after the optimiser
+		{
+			MeshletBuilder meshletBuilder;
+			m_geomatryMeshlets = meshletBuilder.build(meshData);
+		}
+
+		Geometry geometry;
+		UploadTicket vertexUpload = 0;
+		UploadTicket indexUpload = 0;
+
+		if (FAILED(createGpuBuffer(meshData.m_vertices.data(), sizeof(Vertex) * meshData.m_vertices.size(), geometry.m_vertexBuffer, vertexUpload)))
+		{
+			MessageBoxA(windowHandle, "Failed to create the vertex buffer", "createGpuBuffer() failed", MB_OK);
+			return E_FAIL;
+		}
+
+		if (FAILED(createGpuBuffer(meshData.m_indices.data(), sizeof(UINT) * meshData.m_indices.size(), geometry.m_indexBuffer, indexUpload)))
+		{
+			MessageBoxA(windowHandle, "Failed to create the index buffer", "createGpuBuffer() failed", MB_OK);
+			return E_FAIL;
+		}
+
+		// tickets are submitted in order, so waiting on the later one covers both
+		geometry.m_uploadTicket = indexUpload > vertexUpload ? indexUpload : vertexUpload;
+
+		geometry.m_numVertices = static_cast<UINT>(meshData.m_vertices.size());
+		geometry.m_numIndices = static_cast<UINT>(meshData.m_indices.size());
+		geometry.m_lods = meshData.m_lods;
+
+		// Initialize the vertex buffer view.
+		geometry.m_vertexBufferView.BufferLocation = geometry.m_vertexBuffer->GetGPUVirtualAddress();
+		geometry.m_vertexBufferView.StrideInBytes = sizeof(Vertex);
+		geometry.m_vertexBufferView.SizeInBytes = sizeof(Vertex) * geometry.m_numVertices;
+
+		geometry.m_indexBufferView.BufferLocation = geometry.m_indexBuffer->GetGPUVirtualAddress();
+		geometry.m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+		geometry.m_indexBufferView.SizeInBytes = sizeof(UINT) * geometry.m_numIndices;
+
+		m_geomatry = m_rendererPtr->getResources().addMesh(geometry);
+
+		// the material table, nothing binds it until the scene is drawn per material rather than by vertex colour
+		if (m_materialTable.getMaterialCount() > 0)
+		{
+			const std::vector<PackedMaterial> & packedMaterials = m_materialTable.getPackedMaterials();
+			Microsoft::WRL::ComPtr<ID3D12Resource> materialBuffer;
+			UploadTicket materialUpload = 0;
+
+			if (FAILED(createGpuBuffer(packedMaterials.data(), sizeof(PackedMaterial) * packedMaterials.size(), materialBuffer, materialUpload)))
+			{
+				MessageBoxA(windowHandle, "Failed to create the material buffer", "createGpuBuffer() failed", MB_OK);
+				return E_FAIL;
+			}
+
+			m_materialBuffer = m_rendererPtr->getResources().addBuffer(materialBuffer);
+
+			char materialStr[256];
+			sprintf_s(materialStr, "MaterialTable: %u imported materials -> %u unique, %u textures, %u bytes\n",
+				m_materialTable.getImportedCount(), m_materialTable.getMaterialCount(), static_cast<UINT>(m_materialTable.getTextureNames().size()),
+				static_cast<UINT>(sizeof(PackedMaterial) * packedMaterials.size()));
+			OutputDebugStringA(materialStr);
+		}
+
+		// textures, read and decoded across every core then queued on the copy queue with their mips
+		{
+			// the files that go to the decoder are read in the background while the cooked ones are mapped,
+			// a failed read leaves the loader to read the file itself
+			const std::chrono::steady_clock::time_point readStart = std::chrono::steady_clock::now();
+			std::vector<IoTicket> textureReads(textureSources.size(), 0);
+
+			for (size_t i = 0; i < textureSources.size(); ++i)
+			{
+				if (!textureSources[i].m_path.empty() && textureSources[i].m_formatHint != "dds")
+				{
+					IoRequest request;
+					request.m_path = textureSources[i].m_path;
+					request.m_priority = IO_PRIORITY_HIGH;
+					textureReads[i] = m_ioService.enqueue(std::move(request));
+				}
+			}
+
+			// cooked .dds files skip the decoder, they are mapped and copied straight into upload memory
+			{
+				const std::chrono::steady_clock::time_point ddsStart = std::chrono::steady_clock::now();
+				UINT64 ddsBytes = 0;
+				UINT ddsCount = 0;
+
+				std::vector<TextureSource> toDecode;
+				std::vector<IoTicket> toDecodeReads;
+
+				for (size_t i = 0; i < textureSources.size(); ++i)
+				{
+					if (textureSources[i].m_path.empty() || textureSources[i].m_formatHint != "dds")
+					{
+						toDecode.push_back(textureSources[i]);
+						toDecodeReads.push_back(textureReads[i]);
+						continue;
+					}
+
+					const std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+					DdsTextureLayout layout;
+
+					if (!file->open(textureSources[i].m_path) || !parseDds(file->getData(), file->getSize(), layout))
+					{
+						OutputDebugStringA(("TextureLoader: failed to load " + textureSources[i].m_name + "\n").c_str());
+						continue;
+					}
+
+					// only the mip tail goes up now, the rest streams in once something asks for it
+					StreamedTextureDesc streamedDesc;
+					streamedDesc.m_width = layout.m_width;
+					streamedDesc.m_height = layout.m_height;
+					streamedDesc.m_mipBytes.assign(layout.m_mipCount, 0);
+
+					UINT bytesPerElement = 0;
+					ddsFormatInfo(layout.m_format, bytesPerElement, streamedDesc.m_blockCompressed);
+
+					for (size_t s = 0; s < layout.m_subresources.size(); ++s)
+					{
+						streamedDesc.m_mipBytes[s % layout.m_mipCount] += layout.m_subresources[s].m_rowSizeInBytes * layout.m_subresources[s].m_numRows;
+					}
+
+					const StreamedTextureId streamedId = m_textureStreamer.addTexture(streamedDesc);
+					Texture texture;
+
+					if (FAILED(m_rendererPtr->createTextureFromDds(file, texture, m_textureStreamer.getTailMip(streamedId))))
+					{
+						MessageBoxA(windowHandle, "Failed to create a texture", "createTextureFromDds() failed", MB_OK);
+						return E_FAIL;
+					}
+
+					StreamedTextureSlot slot;
+					slot.m_texture = m_rendererPtr->getResources().addTexture(texture);
+					slot.m_topSize = std::max(layout.m_width, layout.m_height);
+					slot.m_file = file;
+					slot.m_hasPending = false;
+					m_streamedTextures.push_back(slot);
+
+					ddsBytes += file->getSize();
+					++ddsCount;
+					m_textures.push_back(slot.m_texture);
+				}
+
+				const double ddsSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ddsStart).count();
+
+				char ddsStr[256];
+				sprintf_s(ddsStr, "DdsLoader: %u textures, %.2f MB mapped and queued in %.3f s\n",
+					ddsCount, static_cast<double>(ddsBytes) / (1024.0 * 1024.0), ddsSeconds);
+				OutputDebugStringA(ddsStr);
+
+				textureSources.swap(toDecode);
+				textureReads.swap(toDecodeReads);
+			}
+
+			// kept until the decoder is done with them
+			std::vector<AssetView> textureFiles(textureSources.size());
+			UINT64 textureFileBytes = 0;
+
+			for (size_t i = 0; i < textureSources.size(); ++i)
+			{
+				if (textureReads[i] != 0 && m_ioService.wait(textureReads[i], textureFiles[i]) == IO_STATUS_COMPLETED)
+				{
+					textureSources[i].m_embeddedData = textureFiles[i].m_data;
+					textureSources[i].m_embeddedSize = textureFiles[i].m_size;
+					textureFileBytes += textureFiles[i].m_size;
+				}
+			}
+
+			{
+				const IoStats ioStats = m_ioService.getStats();
+				const double readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - readStart).count();
+
+				char ioStr[256];
+				sprintf_s(ioStr, "IoService: %.2f MB of textures in %.3f s, %llu requests in %llu reads, %llu failed\n",
+					static_cast<double>(textureFileBytes) / (1024.0 * 1024.0), readSeconds, ioStats.m_requests, ioStats.m_reads, ioStats.m_failed);
+				OutputDebugStringA(ioStr);
+			}
+
+			TextureLoader textureLoader(m_jobSystem, decodeImage);
+
+			TextureLoadStats stats;
+			std::vector<LoadedTexture> loadedTextures = textureLoader.load(textureSources, stats);
+
+			char statsStr[256];
+			sprintf_s(statsStr, "TextureLoader: %u textures (%u failed), %.2f MB in %.3f s on %u threads, %.1f MB/s per core\n",
+				static_cast<UINT>(stats.m_textureCount), static_cast<UINT>(stats.m_failedCount),
+				static_cast<double>(stats.m_encodedBytes) / (1024.0 * 1024.0), stats.m_wallSeconds, stats.m_threadCount,
+				stats.encodedMegabytesPerSecondPerCore());
+			OutputDebugStringA(statsStr);
+
+			for (size_t i = 0; i < loadedTextures.size(); ++i)
+			{
+				if (!loadedTextures[i].m_loaded)
+				{
+					OutputDebugStringA(("TextureLoader: failed to load " + loadedTextures[i].m_name + "\n").c_str());
+					continue;
+				}
+
+				Texture texture;
+
+				if (FAILED(m_rendererPtr->createTexture(loadedTextures[i].m_mips, texture)))
+				{
+					MessageBoxA(windowHandle, "Failed to create a texture", "createTexture() failed", MB_OK);
+					return E_FAIL;
+				}
+
+				m_textures.push_back(m_rendererPtr->getResources().addTexture(texture));
+			}
+		}
+	}
+
+
+	return S_OK; // next just get a rotating triangle on screen (need to create a Dx12 context first)
+}
+
+HRESULT ApplicationCore::createGpuBuffer(const void * data, const size_t sizeInBytes, Microsoft::WRL::ComPtr<ID3D12Resource> & buffer, UploadTicket & ticket)
+{
+	const Microsoft::WRL::ComPtr<ID3D12Device> devicePtr = m_rendererPtr->getDevicePtr();
+
+	// created in the common state, the copy queue and then the direct queue promote it as needed
+	HRESULT hRes = devicePtr->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&buffer));
+
+	if (FAILED(hRes))
+	{
+		return hRes;
+	}
+
+	m_rendererPtr->trackResidency(buffer.Get());
+
+	UploadRequest request;
+	request.m_destination = buffer.Get();
+	request.m_destinationOffset = 0;
+	request.m_data.assign(static_cast<const UINT8*>(data), static_cast<const UINT8*>(data) + sizeInBytes);
+
+	ticket = m_rendererPtr->getUploader().enqueue(std::move(request));
+
+	return S_OK;
+}
+
+bool ApplicationCore::importSkin(const aiMesh * mesh, const MeshData & bindPose, SkinnedMeshData & skinned)
+{
+	if (mesh->mNumBones > c_maxSkinBones)
+	{
+		return false;
+	}
+
+	skinned.m_vertices.resize(mesh->mNumVertices);
+
+	// unscaled, the bone offsets are in the mesh's own space
+	for (size_t i = 0; i < mesh->mNumVertices; ++i)
+	{
+		skinned.m_vertices[i].m_position = DirectX::XMFLOAT3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+		skinned.m_vertices[i].m_colour = bindPose.m_vertices[i].m_colour;
+	}
+
+	skinned.m_indices = bindPose.m_indices;
+
+	SkinBuilder skinBuilder(mesh->mNumVertices);
+
+	for (UINT b = 0; b < mesh->mNumBones; ++b)
+	{
+		const aiBone * bone = mesh->mBones[b];
+
+		skinned.m_boneNames.push_back(bone->mName.C_Str());
+		skinned.m_inverseBindPose.push_back(toRowMajor(bone->mOffsetMatrix));
+
+		for (UINT w = 0; w < bone->mNumWeights; ++w)
+		{
+			skinBuilder.addInfluence(bone->mWeights[w].mVertexId, b, bone->mWeights[w].mWeight);
+		}
+	}
+
+	const UINT truncated = skinBuilder.build(skinned.m_vertices);
+
+	if (truncated > 0)
+	{
+		char truncatedStr[128];
+		sprintf_s(truncatedStr, "SkinBuilder: %u vertices had more than %u bones, the lightest were dropped\n", truncated, c_maxBoneInfluences);
+		OutputDebugStringA(truncatedStr);
+	}
+
+	return true;
+}
+
+void ApplicationCore::buildSkeleton(const aiNode * root, Skeleton & skeleton)
+{
+	// breadth first, parents still come before their children and every depth is a run of the list
+	std::vector<std::pair<const aiNode*, int>> queue;
+	queue.push_back(std::make_pair(root, -1));
+
+	for (size_t next = 0; next < queue.size(); ++next)
+	{
+		const aiNode * node = queue[next].first;
+		const int joint = static_cast<int>(skeleton.m_parents.size());
+
+		aiVector3D scaling;
+		aiQuaternion rotation;
+		aiVector3D position;
+		node->mTransformation.Decompose(scaling, rotation, position);
+
+		JointTransform bindPose;
+		bindPose.m_translation = DirectX::XMFLOAT3(position.x, position.y, position.z);
+		bindPose.m_rotation = DirectX::XMFLOAT4(rotation.x, rotation.y, rotation.z, rotation.w);
+		bindPose.m_scale = DirectX::XMFLOAT3(scaling.x, scaling.y, scaling.z);
+
+		skeleton.m_parents.push_back(queue[next].second);
+		skeleton.m_names.push_back(node->mName.C_Str());
+		skeleton.m_bindPose.push_back(bindPose);
+
+		for (UINT c = 0; c < node->mNumChildren; ++c)
+		{
+			queue.push_back(std::make_pair(node->mChildren[c], joint));
+		}
+	}
+}
+
+void ApplicationCore::convertAnimation(const aiAnimation * animation, const Skeleton & skeleton, AnimationClip & clip)
+{
+	const double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : c_defaultTicksPerSecond;
+	const float secondsPerTick = static_cast<float>(1.0 / ticksPerSecond);
+
+	std::vector<JointKeys> keys(skeleton.m_parents.size());
+
+	for (UINT c = 0; c < animation->mNumChannels; ++c)
+	{
+		const aiNodeAnim * channel = animation->mChannels[c];
+		const int joint = skeleton.findJoint(channel->mNodeName.C_Str());
+
+		if (joint < 0)
+		{
+			continue;
+		}
+
+		JointKeys & jointKeys = keys[joint];
+
+		for (UINT k = 0; k < channel->mNumPositionKeys; ++k)
+		{
+			const aiVectorKey & key = channel->mPositionKeys[k];
+			jointKeys.m_translationTimes.push_back(static_cast<float>(key.mTime) * secondsPerTick);
+			jointKeys.m_translations.push_back(DirectX::XMFLOAT3(key.mValue.x, key.mValue.y, key.mValue.z));
+		}
+
+		for (UINT k = 0; k < channel->mNumRotationKeys; ++k)
+		{
+			const aiQuatKey & key = channel->mRotationKeys[k];
+			jointKeys.m_rotationTimes.push_back(static_cast<float>(key.mTime) * secondsPerTick);
+			jointKeys.m_rotations.push_back(DirectX::XMFLOAT4(key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w));
+		}
+
+		for (UINT k = 0; k < channel->mNumScalingKeys; ++k)
+		{
+			const aiVectorKey & key = channel->mScalingKeys[k];
+			jointKeys.m_scaleTimes.push_back(static_cast<float>(key.mTime) * secondsPerTick);
+			jointKeys.m_scales.push_back(DirectX::XMFLOAT3(key.mValue.x, key.mValue.y, key.mValue.z));
+		}
+	}
+
+	clip.m_name = animation->mName.C_Str();
+	clip.build(keys, static_cast<float>(animation->mDuration) * secondsPerTick);
+}
+
+HRESULT ApplicationCore::initSkinnedMesh(const aiScene * scene, const aiMesh * mesh, const MeshData & bindPose, const float scale)
+{
+	if (!importSkin(mesh, bindPose, m_skinnedMesh))
+	{
+		return E_FAIL;
+	}
+
+	// every node of the scene is a joint, the bones are the ones the skin names
+	buildSkeleton(scene->mRootNode, m_skeleton);
+
+	for (size_t b = 0; b < m_skinnedMesh.m_boneNames.size(); ++b)
+	{
+		m_boneJoints.push_back(m_skeleton.findJoint(m_skinnedMesh.m_boneNames[b]));
+	}
+
+	// the joints' model space includes the root's transform, the mesh is drawn relative to the root and scaled
+	aiMatrix4x4 scaling;
+	aiMatrix4x4::Scaling(aiVector3D(scale, scale, scale), scaling);
+	m_modelToMesh = toRowMajor(scaling * aiMatrix4x4(scene->mRootNode->mTransformation).Inverse());
+
+	// all of the clips are converted, the first one plays. the instance points into both, so they are filled first
+	m_animationClips.resize(scene->mNumAnimations);
+
+	for (UINT a = 0; a < scene->mNumAnimations; ++a)
+	{
+		convertAnimation(scene->mAnimations[a], m_skeleton, m_animationClips[a]);
+	}
+
+	// there is no cooked clip format on disk yet, so they are compressed as they load and played from that
+	AnimationCompressor compressor;
+	m_compressedClips.resize(m_animationClips.size());
+
+	for (size_t a = 0; a < m_animationClips.size(); ++a)
+	{
+		AnimationCompressionReport report;
+		m_compressedClips[a] = compressor.compress(m_animationClips[a], m_skeleton, AnimationCompressionSettings(), report);
+
+		char compressionStr[256];
+		sprintf_s(compressionStr, "AnimationCompressor: %.64s %llu of %llu keys, %.1f:1, max error %f translation %f radians\n",
+			m_animationClips[a].m_name.c_str(), report.m_keptKeys, report.m_sourceKeys, report.compressionRatio(),
+			report.m_maxTranslationError, report.m_maxRotationError);
+		OutputDebugStringA(compressionStr);
+	}
+
+	m_animationInstances.resize(1);
+	m_animationInstances[0].m_skeleton = &m_skeleton;
+
+	if (!m_compressedClips.empty())
+	{
+		m_animationInstances[0].addLayer(&m_compressedClips[0], 1.0f, true);
+	}
+
+	// a palette for the first frame, the bind pose when there is nothing to play
+	AnimationSystem::evaluateInstance(m_animationInstances[0], 0.0f);
+	computeSkinPalette(m_animationInstances[0].m_modelMatrices, m_boneJoints, m_skinnedMesh.m_inverseBindPose, m_modelToMesh, m_bonePalette);
+
+	Geometry & geometry = m_skinnedGeometry.m_geometry;
+	UploadTicket vertexUpload = 0;
+	UploadTicket indexUpload = 0;
+
+	if (FAILED(createGpuBuffer(m_skinnedMesh.m_vertices.data(), sizeof(SkinnedVertex) * m_skinnedMesh.m_vertices.size(), geometry.m_vertexBuffer, vertexUpload)) ||
+		FAILED(createGpuBuffer(m_skinnedMesh.m_indices.data(), sizeof(UINT) * m_skinnedMesh.m_indices.size(), geometry.m_indexBuffer, indexUpload)))
+	{
+		return E_FAIL;
+	}
+
+	geometry.m_uploadTicket = indexUpload > vertexUpload ? indexUpload : vertexUpload;
+	geometry.m_numVertices = static_cast<UINT>(m_skinnedMesh.m_vertices.size());
+	geometry.m_numIndices = static_cast<UINT>(m_skinnedMesh.m_indices.size());
+
+	geometry.m_vertexBufferView.BufferLocation = geometry.m_vertexBuffer->GetGPUVirtualAddress();
+	geometry.m_vertexBufferView.StrideInBytes = sizeof(SkinnedVertex);
+	geometry.m_vertexBufferView.SizeInBytes = sizeof(SkinnedVertex) * geometry.m_numVertices;
+
+	geometry.m_indexBufferView.BufferLocation = geometry.m_indexBuffer->GetGPUVirtualAddress();
+	geometry.m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+	geometry.m_indexBufferView.SizeInBytes = sizeof(UINT) * geometry.m_numIndices;
+
+	// every path gets its buffers, so switching is only a matter of m_path
+	if (FAILED(m_rendererPtr->createDynamicBuffer(sizeof(Vertex) * geometry.m_numVertices, m_skinnedGeometry.m_skinnedVertices)) ||
+		FAILED(m_rendererPtr->createDynamicBuffer(sizeof(DirectX::XMFLOAT4X4) * c_maxSkinBones, m_skinnedGeometry.m_bonePalette)) ||
+		FAILED(m_rendererPtr->createUnorderedAccessBuffer(sizeof(Vertex) * geometry.m_numVertices, m_skinnedGeometry.m_computeSkinnedVertices)))
+	{
+		return E_FAIL;
+	}
+
+	m_skinnedGeometry.m_path = c_skinningPath;
+	m_hasSkinnedMesh = true;
+
+	return S_OK;
+}
+
+HRESULT ApplicationCore::initMorphedMesh(const aiMesh * mesh, const MeshData & bindPose, const float scale)
+{
+	m_morphedMesh.m_vertices = bindPose.m_vertices;
+	m_morphedMesh.m_indices = bindPose.m_indices;
+
+	TangentSpaceGenerator tangentSpace(m_jobSystem);
+	const bool generateNormals = !mesh->HasNormals();
+
+	if (!generateNormals)
+	{
+		m_morphedMesh.m_normals.resize(mesh->mNumVertices);
+
+		for (size_t i = 0; i < mesh->mNumVertices; ++i)
+		{
+			m_morphedMesh.m_normals[i] = DirectX::XMFLOAT3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+		}
+	}
+	else
+	{
+		// welded, JoinIdenticalVertices still leaves vertices split where their texture coordinates differ
+		TangentSpaceStats normalStats;
+		tangentSpace.generateNormals(bindPose.m_vertices, bindPose.m_indices, true, m_morphedMesh.m_normals, normalStats);
+
+		char normalStr[256];
+		sprintf_s(normalStr, "TangentSpace: %u normals from %u triangles (%u degenerate) in %.2f ms on %u threads\n",
+			normalStats.m_vertices, normalStats.m_triangles, normalStats.m_degenerateTriangles, normalStats.m_seconds * 1000.0, normalStats.m_threadCount);
+		OutputDebugStringA(normalStr);
+	}
+
+	std::vector<Vertex> targetVertices = bindPose.m_vertices;
+	std::vector<DirectX::XMFLOAT3> positions(mesh->mNumVertices);
+	std::vector<DirectX::XMFLOAT3> normals;
+
+	for (UINT a = 0; a < mesh->mNumAnimMeshes; ++a)
+	{
+		const aiAnimMesh * animMesh = mesh->mAnimMeshes[a];
+
+		if (animMesh->mNumVertices != mesh->mNumVertices)
+		{
+			return E_FAIL;
+		}
+
+		// an anim mesh only has the streams it changes, the rest are the base mesh's
+		for (size_t i = 0; i < mesh->mNumVertices; ++i)
+		{
+			positions[i] = animMesh->HasPositions() ?
+				DirectX::XMFLOAT3(animMesh->mVertices[i].x * scale, animMesh->mVertices[i].y * scale, animMesh->mVertices[i].z * scale) :
+				bindPose.m_vertices[i].m_position;
+		}
+
+		// normals from the file only morph when the target has its own, generated ones are generated again for the target
+		const bool hasNormals = !m_morphedMesh.m_normals.empty() && (animMesh->HasNormals() || generateNormals);
+
+		if (hasNormals && animMesh->HasNormals())
+		{
+			normals.resize(mesh->mNumVertices);
+
+			for (size_t i = 0; i < mesh->mNumVertices; ++i)
+			{
+				normals[i] = DirectX::XMFLOAT3(animMesh->mNormals[i].x, animMesh->mNormals[i].y, animMesh->mNormals[i].z);
+			}
+		}
+		else if (hasNormals && animMesh->HasPositions())
+		{
+			// the target's own shape, generated the same way as the base so only real bending shows as a delta
+			for (size_t i = 0; i < mesh->mNumVertices; ++i)
+			{
+				targetVertices[i].m_position = positions[i];
+			}
+
+			TangentSpaceStats targetStats;
+			tangentSpace.generateNormals(targetVertices, bindPose.m_indices, true, normals, targetStats);
+		}
+		else if (hasNormals)
+		{
+			normals = m_morphedMesh.m_normals;
+		}
+
+		MorphTarget target;
+		target.m_name = "target" + std::to_string(a);
+
+		buildMorphTarget(m_morphedMesh.m_vertices.data(), hasNormals ? m_morphedMesh.m_normals.data() : nullptr, positions.data(),
+			hasNormals ? normals.data() : nullptr, mesh->mNumVertices, c_morphDeltaThreshold, target);
+
+		m_morphedMesh.m_targets.push_back(target);
+	}
+
+	// assimp 3 has no morph animation channels, so each target fades in and back out in turn, a second apiece
+	const size_t targetCount = m_morphedMesh.m_targets.size();
+
+	for (size_t k = 0; k <= targetCount + 1; ++k)
 	{
-	case WM_PAINT:
-		hdc = BeginPaint(hWnd, &ps);
-		EndPaint(hWnd, &ps);
-		break;
+		m_morphWeights.m_times.push_back(static_cast<float>(k));
 
-	case WM_DESTROY:
-		PostQuitMessage(0);
-		break;
+		for (size_t t = 0; t < targetCount; ++t)
+		{
+			m_morphWeights.m_weights.push_back(k == t + 1 ? 1.0f : 0.0f);
+		}
+	}
 
-	default:
-		return DefWindowProc(hWnd, message, wParam, lParam);
+	m_morphInstances.resize(1);
+	m_morphInstances[0].setMesh(&m_morphedMesh);
+	MorphBlender::blendInstance(m_morphInstances[0]);
+
+	const MorphInstance & instance = m_morphInstances[0];
+	const UINT vertexBytes = static_cast<UINT>(sizeof(Vertex) * instance.m_vertices.size());
+
+	// the vertices change most frames, so they live in upload memory rather than going over the copy queue
+	if (FAILED(m_rendererPtr->createDynamicBuffer(vertexBytes, m_morphedVertices)))
+	{
+		return E_FAIL;
 	}
 
-	return 0;
-}
+	// every copy starts as the first blend
+	for (UINT copy = 0; copy < c_dynamicBufferCopies; ++copy)
+	{
+		memcpy(m_morphedVertices.m_mapped + static_cast<size_t>(copy) * m_morphedVertices.m_frameSize, instance.m_vertices.data(), vertexBytes);
+		m_morphStaleBegin[copy] = 0;
+		m_morphStaleEnd[copy] = 0;
+	}
 
+	Geometry geometry;
+	geometry.m_vertexBuffer = m_morphedVertices.m_resource;
 
-ApplicationCore::ApplicationCore()
-	: m_windowPtr(nullptr)
-	, m_rendererPtr(nullptr)
-{
-	
-}
+	if (FAILED(createGpuBuffer(m_morphedMesh.m_indices.data(), sizeof(UINT) * m_morphedMesh.m_indices.size(), geometry.m_indexBuffer, geometry.m_uploadTicket)))
+	{
+		return E_FAIL;
+	}
 
-ApplicationCore::~ApplicationCore()
-{
+	geometry.m_numVertices = static_cast<UINT>(m_morphedMesh.m_vertices.size());
+	geometry.m_numIndices = static_cast<UINT>(m_morphedMesh.m_indices.size());
+
+	// pointed at this frame's copy in updateMorphing
+	geometry.m_vertexBufferView.BufferLocation = m_rendererPtr->getDynamicFrameAddress(m_morphedVertices);
+	geometry.m_vertexBufferView.StrideInBytes = sizeof(Vertex);
+	geometry.m_vertexBufferView.SizeInBytes = sizeof(Vertex) * geometry.m_numVertices;
+
+	geometry.m_indexBufferView.BufferLocation = geometry.m_indexBuffer->GetGPUVirtualAddress();
+	geometry.m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+	geometry.m_indexBufferView.SizeInBytes = sizeof(UINT) * geometry.m_numIndices;
+
+	m_morphedGeometry = m_rendererPtr->getResources().addMesh(geometry);
+	m_hasMorphedMesh = true;
 
+	return S_OK;
 }
 
-HRESULT ApplicationCore::init(HINSTANCE hInst, int nCmdValues, const std::string & indexFile)
+std::vector<TextureSource> ApplicationCore::gatherTextureSources(const aiScene * scene, const std::string & sceneDirectory)
 {
-	// create Win32 window
+	const aiTextureType textureTypes[] =
+	{
+		aiTextureType_DIFFUSE,
+		aiTextureType_SPECULAR,
+		aiTextureType_NORMALS,
+		aiTextureType_HEIGHT,
+		aiTextureType_EMISSIVE,
+		aiTextureType_OPACITY
+	};
 
-	m_windowPtr = new Win32Window(800, 600, "Dx12 Engine");
+	std::vector<TextureSource> sources;
+	std::set<std::string> seen;
 
-	if (FAILED(m_windowPtr->createWindow(hInst, WindowCallBackFunc, nCmdValues)))
+	for (UINT m = 0; m < scene->mNumMaterials; ++m)
 	{
-		return E_FAIL;
-	} 
+		const aiMaterial * material = scene->mMaterials[m];
 
-	const HWND windowHandle = m_windowPtr->getWindowHandle();
+		for (size_t t = 0; t < _countof(textureTypes); ++t)
+		{
+			for (UINT i = 0; i < material->GetTextureCount(textureTypes[t]); ++i)
+			{
+				aiString path;
 
-	// start of stuff to put in initDirectx() 
+				if (material->GetTexture(textureTypes[t], i, &path) != AI_SUCCESS || !seen.insert(path.C_Str()).second)
+				{
+					continue;
+				}
 
-	m_rendererPtr = new Dx12Renderer(800, 600);
+				TextureSource source;
+				source.m_name = path.C_Str();
+				source.m_embeddedData = nullptr;
+				source.m_embeddedSize = 0;
+				source.m_rawWidth = 0;
+				source.m_rawHeight = 0;
 
-	if (FAILED(m_rendererPtr->init(windowHandle)))
-	{
-		return E_FAIL;
+				UINT embeddedIndex = 0;
+
+				if (TextureLoader::parseEmbeddedIndex(source.m_name, embeddedIndex))
+				{
+					if (embeddedIndex >= scene->mNumTextures)
+					{
+						continue;
+					}
+
+					const aiTexture * embedded = scene->mTextures[embeddedIndex];
+					source.m_embeddedData = reinterpret_cast<const UINT8*>(embedded->pcData);
+
+					// mHeight of 0 means pcData is the compressed file and mWidth is its size in bytes
+					if (embedded->mHeight == 0)
+					{
+						source.m_embeddedSize = embedded->mWidth;
+						source.m_formatHint = embedded->achFormatHint;
+					}
+					else
+					{
+						source.m_rawWidth = embedded->mWidth;
+						source.m_rawHeight = embedded->mHeight;
+						source.m_embeddedSize = static_cast<size_t>(embedded->mWidth) * embedded->mHeight * sizeof(aiTexel);
+					}
+				}
+				else
+				{
+					source.m_path = TextureLoader::resolvePath(sceneDirectory, source.m_name);
+					source.m_formatHint = TextureLoader::extensionOf(source.m_path);
+				}
+
+				sources.push_back(source);
+			}
+		}
 	}
 
-	// populate the vertex buffer, (deal with the geomatry struct)
+	return sources;
+}
 
-	{
-		HRESULT vertexBufferCreation = E_FAIL;
+std::vector<TextureSource> ApplicationCore::gatherTextureSources(const std::vector<ObjMaterial> & materials, const std::string & sceneDirectory)
+{
+	std::vector<TextureSource> sources;
+	std::set<std::string> seen;
 
-		Assimp::Importer importer;
+	for (size_t m = 0; m < materials.size(); ++m)
+	{
+		const std::string * maps[] =
+		{
+			&materials[m].m_diffuseMap,
+			&materials[m].m_specularMap,
+			&materials[m].m_normalMap,
+			&materials[m].m_emissiveMap,
+			&materials[m].m_opacityMap
+		};
 
-		const aiScene * testScene = importer.ReadFile("TestCube.obj",
-			//aiProcess_CalcTangentSpace |
-			aiProcess_Triangulate |
-			// aiProcess_JoinIdenticalVertices |
-			aiProcess_SortByPType |
-			aiProcess_GenNormals |
-			// aiProcess_FlipWindingOrder|
-			aiProcess_GenUVCoords |
-			aiProcess_MakeLeftHanded);
+		for (size_t t = 0; t < _countof(maps); ++t)
+		{
+			if (maps[t]->empty() || !seen.insert(*maps[t]).second)
+			{
+				continue;
+			}
 
-		assert(testScene);
+			TextureSource source;
+			source.m_name = *maps[t];
+			source.m_path = TextureLoader::resolvePath(sceneDirectory, source.m_name);
+			source.m_formatHint = TextureLoader::extensionOf(source.m_path);
+			source.m_embeddedData = nullptr;
+			source.m_embeddedSize = 0;
+			source.m_rawWidth = 0;
+			source.m_rawHeight = 0;
 
-		std::vector<Vertex> vertexInput;
+			sources.push_back(source);
+		}
+	}
 
-		assert(testScene->mNumMeshes == 1);
+	return sources;
+}
 
-		vertexInput.resize(testScene->mMeshes[0]->mNumVertices);
+std::vector<TextureSource> ApplicationCore::gatherTextureSources(const GltfAsset & asset, const std::string & sceneDirectory)
+{
+	const std::vector<GltfImage> & images = asset.getImages();
+	const std::vector<GltfMaterial> & materials = asset.getMaterials();
 
-		// down scale the vertex data, want it to be visable on screen
+	std::vector<TextureSource> sources;
+	std::set<UINT> seen;
 
-		const float scaleVerticesBy = 0.25f;
+	for (size_t m = 0; m < materials.size(); ++m)
+	{
+		const UINT maps[] =
+		{
+			materials[m].m_baseColourImage,
+			materials[m].m_metallicRoughnessImage,
+			materials[m].m_normalImage,
+			materials[m].m_occlusionImage,
+			materials[m].m_emissiveImage
+		};
 
-		for (size_t i = 0; i < testScene->mMeshes[0]->mNumVertices; ++i)
+		for (size_t t = 0; t < _countof(maps); ++t)
 		{
-			vertexInput[i].m_position.x = testScene->mMeshes[0]->mVertices[i].x * scaleVerticesBy;
-			vertexInput[i].m_position.y = testScene->mMeshes[0]->mVertices[i].y * scaleVerticesBy;
-			vertexInput[i].m_position.z = testScene->mMeshes[0]->mVertices[i].z * scaleVerticesBy;
+			if (maps[t] == c_gltfNone || !seen.insert(maps[t]).second)
+			{
+				continue;
+			}
 
-			// assign colour based on i
-			if (i % 3 == 0) // i is a multiple of 3
+			const GltfImage & image = images[maps[t]];
+
+			TextureSource source;
+			source.m_embeddedData = image.m_data;
+			source.m_embeddedSize = image.m_size;
+			source.m_rawWidth = 0;
+			source.m_rawHeight = 0;
+
+			if (image.m_data != nullptr)
 			{
-				vertexInput[i].m_colour = DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f); // blue
+				// packed into the .glb, named like Assimp names embedded textures
+				source.m_name = "*" + std::to_string(maps[t]);
+				source.m_formatHint = image.m_mimeType == "image/jpeg" ? "jpg" : (image.m_mimeType == "image/png" ? "png" : std::string());
 			}
-			else if (i % 2 == 0) // i is a multiple of 2
+			else if (!image.m_uri.empty() && image.m_uri.compare(0, 5, "data:") != 0)
 			{
-				vertexInput[i].m_colour = DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f); // green
+				source.m_name = image.m_uri;
+				source.m_path = TextureLoader::resolvePath(sceneDirectory, source.m_name);
+				source.m_formatHint = TextureLoader::extensionOf(source.m_path);
 			}
 			else
 			{
-				vertexInput[i].m_colour = DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f); // red
+				// base64 images aren't decoded, nothing exports them for real scenes
+				continue;
 			}
+
+			sources.push_back(source);
 		}
+	}
+
+	return sources;
+}
+
+std::vector<MaterialDesc> ApplicationCore::describeMaterials(const aiScene * scene)
+{
+	std::vector<MaterialDesc> descs(scene->mNumMaterials);
 
-		const UINT vertexBufferSize = sizeof(Vertex) * testScene->mMeshes[0]->mNumVertices;
+	for (UINT m = 0; m < scene->mNumMaterials; ++m)
+	{
+		const aiMaterial * material = scene->mMaterials[m];
+		MaterialDesc & desc = descs[m];
+
+		// a key the material doesn't have leaves the value alone
+		aiColor3D diffuse(1.0f, 1.0f, 1.0f);
+		aiColor3D emissive(0.0f, 0.0f, 0.0f);
+		float opacity = 1.0f;
+		float shininess = 0.0f;
+		int twoSided = 0;
+		material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+		material->Get(AI_MATKEY_COLOR_EMISSIVE, emissive);
+		material->Get(AI_MATKEY_OPACITY, opacity);
+		material->Get(AI_MATKEY_SHININESS, shininess);
+		material->Get(AI_MATKEY_TWOSIDED, twoSided);
 
-		const Microsoft::WRL::ComPtr<ID3D12Device> devicePtr = m_rendererPtr->getDevicePtr();
-		
-		vertexBufferCreation = devicePtr->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_geomatry.m_vertexBuffer));
+		desc.m_baseColour = DirectX::XMFLOAT4(diffuse.r, diffuse.g, diffuse.b, opacity);
+		desc.m_emissive = DirectX::XMFLOAT3(emissive.r, emissive.g, emissive.b);
+		desc.m_roughness = shininessToRoughness(shininess);
+		desc.m_doubleSided = twoSided != 0;
 
-		if (FAILED(vertexBufferCreation))
+		// .obj bump maps come through as height maps, they are the normal map when there is no other
+		const aiTextureType slotTypes[MATERIAL_TEXTURE_COUNT][2] =
 		{
-			MessageBoxA(windowHandle, "Failed to clear the command list", "m_commandList->Close() failed", MB_OK);
-			return E_FAIL;
+			{ aiTextureType_DIFFUSE, aiTextureType_NONE },
+			{ aiTextureType_NONE, aiTextureType_NONE },
+			{ aiTextureType_NORMALS, aiTextureType_HEIGHT },
+			{ aiTextureType_LIGHTMAP, aiTextureType_NONE },
+			{ aiTextureType_EMISSIVE, aiTextureType_NONE }
+		};
+
+		for (UINT t = 0; t < MATERIAL_TEXTURE_COUNT; ++t)
+		{
+			for (UINT k = 0; k < 2 && desc.m_textures[t].empty(); ++k)
+			{
+				aiString path;
+
+				if (slotTypes[t][k] != aiTextureType_NONE && material->GetTexture(slotTypes[t][k], 0, &path) == AI_SUCCESS)
+				{
+					desc.m_textures[t] = path.C_Str();
+				}
+			}
 		}
+	}
+
+	return descs;
+}
+
+std::vector<MaterialDesc> ApplicationCore::describeMaterials(const std::vector<ObjMaterial> & materials)
+{
+	std::vector<MaterialDesc> descs(materials.size());
+
+	for (size_t m = 0; m < materials.size(); ++m)
+	{
+		const ObjMaterial & material = materials[m];
+		MaterialDesc & desc = descs[m];
+
+		desc.m_baseColour = DirectX::XMFLOAT4(material.m_diffuse.x, material.m_diffuse.y, material.m_diffuse.z, material.m_opacity);
+		desc.m_emissive = material.m_emissive;
+		desc.m_roughness = shininessToRoughness(material.m_shininess);
+
+		// the specular and opacity maps have no slot
+		desc.m_textures[MATERIAL_TEXTURE_BASE_COLOUR] = material.m_diffuseMap;
+		desc.m_textures[MATERIAL_TEXTURE_NORMAL] = material.m_normalMap;
+		desc.m_textures[MATERIAL_TEXTURE_EMISSIVE] = material.m_emissiveMap;
+	}
+
+	return descs;
+}
+
+std::vector<MaterialDesc> ApplicationCore::describeMaterials(const GltfAsset & asset)
+{
+	const std::vector<GltfImage> & images = asset.getImages();
+	const std::vector<GltfMaterial> & materials = asset.getMaterials();
+
+	// the spec's default is white, fully metallic and fully rough
+	std::vector<MaterialDesc> descs(materials.size() + 1);
+	descs.back().m_metallic = 1.0f;
+
+	for (size_t m = 0; m < materials.size(); ++m)
+	{
+		const GltfMaterial & material = materials[m];
+		MaterialDesc & desc = descs[m];
 
-		// Copy the triangle data to the vertex buffer.
-		UINT8* pVertexDataBegin;
-		CD3DX12_RANGE readRange(0, 0);		// We do not intend to read from this resource on the CPU.
+		desc.m_baseColour = material.m_baseColour;
+		desc.m_emissive = material.m_emissive;
+		desc.m_metallic = material.m_metallic;
+		desc.m_roughness = material.m_roughness;
+		desc.m_alphaCutoff = material.m_alphaCutoff;
+		desc.m_doubleSided = material.m_doubleSided;
 
-		vertexBufferCreation = m_geomatry.m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin));
+		const UINT maps[MATERIAL_TEXTURE_COUNT] =
+		{
+			material.m_baseColourImage,
+			material.m_metallicRoughnessImage,
+			material.m_normalImage,
+			material.m_occlusionImage,
+			material.m_emissiveImage
+		};
 
-		if (FAILED(vertexBufferCreation))
+		// named the same way gatherTextureSources names them, base64 images aren't loaded so they are left out
+		for (UINT t = 0; t < MATERIAL_TEXTURE_COUNT; ++t)
 		{
-			MessageBoxA(windowHandle, "Failed to clear the command list", "m_commandList->Close() failed", MB_OK);
-			return E_FAIL;
+			if (maps[t] == c_gltfNone)
+			{
+				continue;
+			}
+
+			if (images[maps[t]].m_data != nullptr)
+			{
+				desc.m_textures[t] = "*" + std::to_string(maps[t]);
+			}
+			else if (!images[maps[t]].m_uri.empty() && images[maps[t]].m_uri.compare(0, 5, "data:") != 0)
+			{
+				desc.m_textures[t] = images[maps[t]].m_uri;
+			}
 		}
+	}
 
-		// populate the vertex buffer via the mapping
-		memcpy(pVertexDataBegin, &vertexInput[0], vertexBufferSize);
+	return descs;
+}
 
-		// remove the mapping as the copy has taken place
-		m_geomatry.m_vertexBuffer->Unmap(0, nullptr);
+std::vector<UINT> ApplicationCore::addMaterials(const std::vector<MaterialDesc> & materials)
+{
+	std::vector<UINT> ids(materials.size());
 
-		// Initialize the vertex buffer view.
-		m_geomatry.m_vertexBufferView.BufferLocation = m_geomatry.m_vertexBuffer->GetGPUVirtualAddress();
-		m_geomatry.m_vertexBufferView.StrideInBytes = sizeof(Vertex);
-		m_geomatry.m_vertexBufferView.SizeInBytes = vertexBufferSize;
+	for (size_t m = 0; m < materials.size(); ++m)
+	{
+		ids[m] = m_materialTable.add(materials[m]);
 	}
 
+	std::vector<UINT> remap;
+	m_materialTable.sortByState(remap);
 
-	return S_OK; // next just get a rotating triangle on screen (need to create a Dx12 context first)
+	for (size_t m = 0; m < ids.size(); ++m)
+	{
+		ids[m] = remap[ids[m]];
+	}
+
+	return ids;
 }
 
 int ApplicationCore::run()
@@ -213,7 +1503,85 @@ int ApplicationCore::run()
 
 void ApplicationCore::shutdown()
 {
-	m_geomatry.m_vertexBuffer.~ComPtr(); // this should free any associated resorces
+	// handed back to the registry, the renderer frees them once its last frame is done with them
+	ResourceRegistry & resources = m_rendererPtr->getResources();
+	resources.release(m_geomatry);
+	resources.release(m_morphedGeometry);
+	resources.release(m_materialBuffer);
+
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		resources.release(m_textures[i]);
+	}
+
+	// a streamed texture's next mips may still be a copy destination, the registry keeps them until it lands
+	for (size_t i = 0; i < m_streamedTextures.size(); ++i)
+	{
+		if (m_streamedTextures[i].m_hasPending)
+		{
+			resources.release(resources.addTexture(m_streamedTextures[i].m_pending));
+		}
+	}
+
+	// the skinned mesh and its per frame buffers are drawn without handles, they go through the registry now so
+	// they are untracked and wait for the last frame and their upload like everything else
+	const ResourceHandle skinned[] =
+	{
+		resources.addMesh(m_skinnedGeometry.m_geometry),
+		resources.addBuffer(m_skinnedGeometry.m_skinnedVertices.m_resource),
+		resources.addBuffer(m_skinnedGeometry.m_bonePalette.m_resource),
+		resources.addBuffer(m_skinnedGeometry.m_computeSkinnedVertices)
+	};
+
+	for (size_t i = 0; i < _countof(skinned); ++i)
+	{
+		m_rendererPtr->useResource(skinned[i]);
+		resources.release(skinned[i]);
+	}
+
+	m_streamedTextures.clear();
+	m_textures.clear();
+	// the morphed mesh released above owns the same resource as its vertex buffer
+	m_morphedVertices = DynamicBuffer();
+
+	const ResidencyStats & residency = m_rendererPtr->getResidency().getStats();
+
+	char residencyStr[256];
+	sprintf_s(residencyStr, "ResidencyManager: %.2f of %.2f MB budget, %llu evicted in %llu batches, %llu made resident\n",
+		static_cast<double>(residency.m_usageBytes) / (1024.0 * 1024.0), static_cast<double>(residency.m_budgetBytes) / (1024.0 * 1024.0),
+		residency.m_evictedObjects, residency.m_evictBatches, residency.m_madeResidentObjects);
+	OutputDebugStringA(residencyStr);
+
+	if (m_hasSkinnedMesh)
+	{
+		char animationStr[256];
+		sprintf_s(animationStr, "AnimationScheduler: %u skeletons, %u evaluated, %u interpolated, %u held, %u culled, %.0f%% of the joints sampled in %.3f ms on %u threads\n",
+			m_animationStats.m_instances, m_animationStats.m_evaluated, m_animationStats.m_interpolated, m_animationStats.m_held,
+			m_animationStats.m_culled, m_animationStats.sampledFraction() * 100.0, m_animationStats.m_seconds * 1000.0, m_animationStats.m_threadCount);
+		OutputDebugStringA(animationStr);
+	}
+
+	if (m_hasMorphedMesh)
+	{
+		char morphStr[256];
+		sprintf_s(morphStr, "MorphBlender: %llu active targets, %llu deltas, %llu vertices changed in %.3f ms on %u threads\n",
+			m_morphStats.m_activeTargets, m_morphStats.m_deltas, m_morphStats.m_dirtyVertices, m_morphStats.m_seconds * 1000.0,
+			m_morphStats.m_threadCount);
+		OutputDebugStringA(morphStr);
+	}
+
+	if (m_hasSkinnedMesh && m_skinnedGeometry.m_path == SKINNING_CPU)
+	{
+		char skinningStr[256];
+		sprintf_s(skinningStr, "CpuSkinner: %llu vertices in %.3f ms on %u threads, %.2f M vertices/s per core\n",
+			m_skinningStats.m_vertices, m_skinningStats.m_seconds * 1000.0, m_skinningStats.m_threadCount,
+			m_skinningStats.verticesPerSecondPerCore() / 1000000.0);
+		OutputDebugStringA(skinningStr);
+	}
+
+	// after the stats, resetting it puts m_path back to SKINNING_CPU. the registry holds the buffers until the
+	// renderer's shutdown has waited for the GPU
+	m_skinnedGeometry = SkinnedGeometry();
 	
 	m_rendererPtr->shutdown();
 	delete m_rendererPtr;
@@ -226,6 +1594,143 @@ void ApplicationCore::shutdown()
 void ApplicationCore::update(float deltaTime)
 {
 	// tick update things to draw
+	updateTextureStreaming();
+	updateAnimation(deltaTime);
+	updateSkinning();
+	updateMorphing(deltaTime);
+}
+
+void ApplicationCore::updateAnimation(float deltaTime)
+{
+	if (!m_hasSkinnedMesh)
+	{
+		return;
+	}
+
+	// there is no camera yet, the skinned mesh stands where m_geomatry would
+	m_animationVisibility.resize(m_animationInstances.size());
+
+	for (size_t i = 0; i < m_animationVisibility.size(); ++i)
+	{
+		m_animationVisibility[i].m_distance = m_viewDistance;
+		m_animationVisibility[i].m_radius = c_streamedObjectSize * 0.5f;
+		m_animationVisibility[i].m_visible = true;
+	}
+
+	m_animationScheduler.update(m_animationInstances, m_animationVisibility, deltaTime, m_animationStats);
+	computeSkinPalette(m_animationInstances[0].m_modelMatrices, m_boneJoints, m_skinnedMesh.m_inverseBindPose, m_modelToMesh, m_bonePalette);
+}
+
+void ApplicationCore::updateSkinning()
+{
+	if (!m_hasSkinnedMesh)
+	{
+		return;
+	}
+
+	// written into this frame's copy, the GPU finished with it when the last frame was waited on
+	if (m_skinnedGeometry.m_path == SKINNING_CPU)
+	{
+		Vertex * skinned = reinterpret_cast<Vertex*>(m_rendererPtr->getDynamicFrameData(m_skinnedGeometry.m_skinnedVertices));
+		m_cpuSkinner.skin(m_skinnedMesh.m_vertices.data(), m_skinnedMesh.m_vertices.size(), m_bonePalette.data(), skinned, m_skinningStats);
+	}
+	else
+	{
+		memcpy(m_rendererPtr->getDynamicFrameData(m_skinnedGeometry.m_bonePalette), m_bonePalette.data(), sizeof(DirectX::XMFLOAT4X4) * m_bonePalette.size());
+	}
+}
+
+void ApplicationCore::updateMorphing(float deltaTime)
+{
+	if (!m_hasMorphedMesh)
+	{
+		return;
+	}
+
+	const float duration = m_morphWeights.m_times.empty() ? 0.0f : m_morphWeights.m_times.back();
+	m_morphTime = duration > 0.0f ? std::fmod(m_morphTime + deltaTime, duration) : 0.0f;
+
+	MorphInstance & instance = m_morphInstances[0];
+	m_morphWeights.sample(m_morphTime, instance.m_weights.data());
+	m_morphBlender.blend(m_morphInstances, m_morphStats);
+
+	Geometry * geometry = m_rendererPtr->getResources().getMesh(m_morphedGeometry);
+
+	if (geometry == nullptr)
+	{
+		return;
+	}
+
+	// every copy has missed what this blend moved, and this frame's copy may still miss what earlier ones did
+	for (UINT copy = 0; copy < c_dynamicBufferCopies && instance.m_dirtyBegin < instance.m_dirtyEnd; ++copy)
+	{
+		if (m_morphStaleBegin[copy] >= m_morphStaleEnd[copy])
+		{
+			m_morphStaleBegin[copy] = instance.m_dirtyBegin;
+			m_morphStaleEnd[copy] = instance.m_dirtyEnd;
+		}
+		else
+		{
+			m_morphStaleBegin[copy] = std::min(m_morphStaleBegin[copy], instance.m_dirtyBegin);
+			m_morphStaleEnd[copy] = std::max(m_morphStaleEnd[copy], instance.m_dirtyEnd);
+		}
+	}
+
+	// only what this frame's copy is missing is written, the last frame was waited on so the GPU is done with it.
+	// no staging buffer and no copy queue wait
+	const UINT copy = m_rendererPtr->getFrameIndex();
+
+	if (m_morphStaleBegin[copy] < m_morphStaleEnd[copy])
+	{
+		Vertex * vertices = reinterpret_cast<Vertex*>(m_rendererPtr->getDynamicFrameData(m_morphedVertices));
+		memcpy(vertices + m_morphStaleBegin[copy], instance.m_vertices.data() + m_morphStaleBegin[copy],
+			sizeof(Vertex) * (m_morphStaleEnd[copy] - m_morphStaleBegin[copy]));
+
+		m_morphStaleBegin[copy] = 0;
+		m_morphStaleEnd[copy] = 0;
+	}
+
+	geometry->m_vertexBufferView.BufferLocation = m_rendererPtr->getDynamicFrameAddress(m_morphedVertices);
+}
+
+void ApplicationCore::updateTextureStreaming()
+{
+	for (size_t i = 0; i < m_streamedTextures.size(); ++i)
+	{
+		StreamedTextureSlot & slot = m_streamedTextures[i];
+
+		if (slot.m_hasPending && m_rendererPtr->getUploader().isComplete(slot.m_pending.m_uploadTicket))
+		{
+			m_rendererPtr->replaceTexture(slot.m_texture, slot.m_pending);
+			m_textureStreamer.onChangeComplete(static_cast<StreamedTextureId>(i));
+			slot.m_hasPending = false;
+		}
+	}
+
+	// no camera or materials yet, every texture counts as on m_geomatry at m_viewDistance
+	for (size_t i = 0; i < m_streamedTextures.size(); ++i)
+	{
+		const float mip = m_textureStreamer.desiredMip(m_streamedTextures[i].m_topSize, c_streamedObjectSize, m_viewDistance);
+		m_textureStreamer.requestMip(static_cast<StreamedTextureId>(i), mip, 1.0f / std::max(m_viewDistance, 0.01f));
+	}
+
+	const StreamingUpdate update = m_textureStreamer.update(++m_frameCount);
+
+	// an eviction is a smaller copy of the texture, it is built and swapped in the same way as a load
+	std::vector<MipResidencyChange> changes = update.m_loads;
+	changes.insert(changes.end(), update.m_evictions.begin(), update.m_evictions.end());
+
+	for (size_t i = 0; i < changes.size(); ++i)
+	{
+		StreamedTextureSlot & slot = m_streamedTextures[changes[i].m_texture];
+
+		if (FAILED(m_rendererPtr->createStreamedTexture(slot.m_file, changes[i].m_topMip, slot.m_pending)))
+		{
+			throw "createStreamedTexture() failed";
+		}
+
+		slot.m_hasPending = true;
+	}
 }
 
 void ApplicationCore::draw()
@@ -244,5 +1749,44 @@ void ApplicationCore::draw()
 
 void ApplicationCore::populateDxCmdList()
 {
-	m_rendererPtr->appendDrawingCommands(m_geomatry);
+	// the materials belong to m_geomatry, so they are used whenever it is drawn
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		m_rendererPtr->useResource(m_textures[i]);
+	}
+
+	if (m_hasSkinnedMesh)
+	{
+		m_rendererPtr->appendSkinnedDrawingCommands(m_skinnedGeometry);
+		return;
+	}
+
+	if (m_hasMorphedMesh)
+	{
+		m_rendererPtr->useResource(m_morphedGeometry);
+		m_rendererPtr->appendDrawingCommands(*m_rendererPtr->getResources().getMesh(m_morphedGeometry));
+		return;
+	}
+
+	const Geometry * geometry = m_rendererPtr->getResources().getMesh(m_geomatry);
+
+	if (geometry == nullptr)
+	{
+		return;
+	}
+
+	m_rendererPtr->useResource(m_geomatry);
+	m_geomatryLod = m_lodSelector.selectLod(geometry->m_lods, m_viewDistance, m_geomatryLod);
+
+	if (m_geomatryLod == 0 && !m_geomatryMeshlets.m_meshlets.empty())
+	{
+		// the vertex shader has no transforms yet, so the camera looks down +z from in front of the mesh
+		m_meshletCuller.setCameraPosition(DirectX::XMFLOAT3(0.0f, 0.0f, -m_viewDistance));
+		m_meshletCuller.cull(m_geomatryMeshlets, m_visibleRanges);
+		m_rendererPtr->appendDrawingCommands(*geometry, m_visibleRanges);
+	}
+	else
+	{
+		m_rendererPtr->appendDrawingCommands(*geometry, m_geomatryLod);
+	}
 }
\ No newline at end of file
@@ -19,7 +19,32 @@
 #include "Win32Window.h"
 #include "Dx12Renderer.h"
 
+#include "Animation.h"
+#include "AnimationCompressor.h"
+#include "AnimationScheduler.h"
+#include "AssetArchive.h"
+#include "AssetFileSystem.h"
 #include "Geomatry.h"
+#include "GltfLoader.h"
+#include "IoService.h"
+#include "JobSystem.h"
+#include "LodSelector.h"
+#include "MaterialTable.h"
+#include "Meshlets.h"
+#include "Morphing.h"
+#include "ObjLoader.h"
+#include "ResourceRegistry.h"
+#include "Skinning.h"
+#include "TangentSpace.h"
+#include "Texture.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "Win32IoBackend.h"
+
+struct aiScene;
+struct aiMesh;
+struct aiNode;
+struct aiAnimation;
 
 
 class ApplicationCore
@@ -38,13 +63,123 @@ private:
 	void draw();
 	void populateDxCmdList();
 
+	// creates a default heap buffer and queues its contents on the renderer's copy queue
+	HRESULT createGpuBuffer(const void * data, const size_t sizeInBytes, Microsoft::WRL::ComPtr<ID3D12Resource> & buffer, UploadTicket & ticket);
+
+	// hands finished loads and evictions to the renderer, then asks for the mips this frame needs
+	void updateTextureStreaming();
+
+	// the mesh's bones go on its bind pose (positions from the mesh, colours from bindPose), uploaded for both skinning paths
+	HRESULT initSkinnedMesh(const aiScene * scene, const aiMesh * mesh, const MeshData & bindPose, const float scale);
+	// plays the skinned mesh's clip and rebuilds the bone palette from it
+	void updateAnimation(float deltaTime);
+	// fills this frame's copy of the skinned vertices or the bone palette, whichever the path draws from
+	void updateSkinning();
+
+	// the mesh's anim meshes as sparse targets on top of bindPose, its vertex buffer takes partial updates
+	HRESULT initMorphedMesh(const aiMesh * mesh, const MeshData & bindPose, const float scale);
+	// moves the weights on, blends and uploads whatever vertices changed
+	void updateMorphing(float deltaTime);
+
+	// false when the mesh has more bones than a byte index can reach
+	static bool importSkin(const aiMesh * mesh, const MeshData & bindPose, SkinnedMeshData & skinned);
+	// the node and everything under it breadth first, with the node transforms as the bind pose
+	static void buildSkeleton(const aiNode * root, Skeleton & skeleton);
+	// keys from ticks into seconds, channels for nodes the skeleton doesn't have are dropped
+	static void convertAnimation(const aiAnimation * animation, const Skeleton & skeleton, AnimationClip & clip);
+
+	// every texture the scene's materials refer to, once each, embedded ones point into the scene
+	static std::vector<TextureSource> gatherTextureSources(const aiScene * scene, const std::string & sceneDirectory);
+	// the same for the materials the native .obj loader read
+	static std::vector<TextureSource> gatherTextureSources(const std::vector<ObjMaterial> & materials, const std::string & sceneDirectory);
+	// and for a glTF asset's, images in its buffers point into the asset
+	static std::vector<TextureSource> gatherTextureSources(const GltfAsset & asset, const std::string & sceneDirectory);
+
+	// the scene's materials in the table's terms, one per scene material with textures named like gatherTextureSources names them
+	static std::vector<MaterialDesc> describeMaterials(const aiScene * scene);
+	static std::vector<MaterialDesc> describeMaterials(const std::vector<ObjMaterial> & materials);
+	// a glTF asset's, plus the spec's default material last for primitives that don't name one
+	static std::vector<MaterialDesc> describeMaterials(const GltfAsset & asset);
+	// adds them to m_materialTable and sorts it, the material id for each
+	std::vector<UINT> addMaterials(const std::vector<MaterialDesc> & materials);
+
 	std::chrono::steady_clock::time_point m_timeAtStartOfTheFrame, m_timeAtEndOfTheFrame;
 	float m_deltaTimeForFrame {0.0f};
 
 	Win32Window* m_windowPtr;
 	Dx12Renderer* m_rendererPtr;
 
-	Geometry m_geomatry;
+	ResourceHandle m_geomatry; // in the renderer's registry, as are the morphed mesh, textures and material buffer
+	UINT m_geomatryLod; // last selected, the lod selector's hysteresis needs it
+
+	MeshletData m_geomatryMeshlets; // full detail level only
+	MeshletCuller m_meshletCuller;
+	std::vector<IndexRange> m_visibleRanges;
+
+	JobSystem m_jobSystem;
+	AssetFileSystem m_assetFileSystem;
+	AssetArchive m_assetArchive;	// mounted into m_assetFileSystem when there is one
+	Win32IoBackend m_ioBackend;
+	IoService m_ioService;	// texture files come in through it while the cooked ones are mapped
+
+	// the scene's mesh when it has bones, drawn in place of m_geomatry
+	CpuSkinner m_cpuSkinner;
+	bool m_hasSkinnedMesh;
+	SkinnedMeshData m_skinnedMesh;
+	SkinnedGeometry m_skinnedGeometry;
+	std::vector<DirectX::XMFLOAT4X4> m_bonePalette;
+	SkinningStats m_skinningStats; // the last frame skinned on the CPU
+
+	// the skinned mesh's scene as a skeleton, the palette is rebuilt from the instance's pose every frame
+	Skeleton m_skeleton;
+	std::vector<AnimationClip> m_animationClips;
+	std::vector<CompressedClip> m_compressedClips;		// what the instance actually plays
+	std::vector<AnimationInstance> m_animationInstances;
+	AnimationScheduler m_animationScheduler;
+	std::vector<AnimationVisibility> m_animationVisibility;
+	AnimationScheduleStats m_animationStats; // the last frame
+	std::vector<int> m_boneJoints;		// skeleton joint per skin bone
+	DirectX::XMFLOAT4X4 m_modelToMesh;
+
+	// the scene's mesh when it has morph targets (and no bones), drawn in place of m_geomatry
+	MorphBlender m_morphBlender;
+	bool m_hasMorphedMesh;
+	MorphedMeshData m_morphedMesh;
+	std::vector<MorphInstance> m_morphInstances;
+	MorphWeightTrack m_morphWeights;
+	float m_morphTime;
+	ResourceHandle m_morphedGeometry;
+	// the blended vertices, written straight into this frame's copy and drawn from there. the mesh in the
+	// registry holds the same resource as its vertex buffer
+	DynamicBuffer m_morphedVertices;
+	// per copy, the vertices blended since that copy was last written. [begin, end), empty when begin >= end
+	UINT m_morphStaleBegin[c_dynamicBufferCopies];
+	UINT m_morphStaleEnd[c_dynamicBufferCopies];
+	MorphStats m_morphStats;
+
+	std::vector<ResourceHandle> m_textures;
+
+	// the scene's unique materials, uploaded as one structured buffer of PackedMaterials indexed by material id
+	MaterialTable m_materialTable;
+	ResourceHandle m_materialBuffer;
+
+	// cooked .dds textures start as their mip tail and stream in from the mapped file, indexed by streamer id
+	struct StreamedTextureSlot
+	{
+		ResourceHandle m_texture;	// one of m_textures
+		UINT m_topSize;				// largest side of the full size top mip
+		std::shared_ptr<MappedFile> m_file;
+		Texture m_pending;			// the next set of mips, swapped in once its upload has finished
+		bool m_hasPending;
+	};
+
+	std::vector<StreamedTextureSlot> m_streamedTextures;
+	TextureStreamer m_textureStreamer;
+	UINT64 m_frameCount;
+
+	LodSelector m_lodSelector;
+	// there is no camera yet, this stands in for the distance from the camera to m_geomatry
+	float m_viewDistance;
 };
 
 #endif
\ No newline at end of file
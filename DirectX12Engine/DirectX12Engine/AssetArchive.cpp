@@ -0,0 +1,615 @@
+#include "AssetArchive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "LzCompression.h"
+#include "MappedFile.h"
+
+namespace
+{
+	const char c_archiveMagic[4] = { 'A', 'A', 'R', 'C' };
+
+	// big enough that a block is worth a job, small enough that a texture or a mesh is several of them
+	const UINT32 c_defaultBlockSize = 64 * 1024;
+
+	// blocks per job when reading, a block decompresses in tens of microseconds
+	const size_t c_blocksPerJob = 2;
+
+	UINT64 alignUp(const UINT64 value, const UINT64 alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	UINT64 blockCountOf(const UINT64 size, const UINT32 blockSize)
+	{
+		return (size + blockSize - 1) / blockSize;
+	}
+
+	// a block of a compressed entry or a block sized run of an uncompressed one
+	struct BlockWork
+	{
+		size_t m_request;
+		UINT m_block;
+	};
+}
+
+AssetArchiveWriter::AssetArchiveWriter(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+	, m_blockSize(c_defaultBlockSize)
+{
+
+}
+
+AssetArchiveWriter::~AssetArchiveWriter()
+{
+
+}
+
+void AssetArchiveWriter::add(const std::string & path, std::vector<UINT8> && data, const bool compress)
+{
+	const std::string normalised = AssetFileSystem::normalisePath(path);
+
+	for (size_t e = 0; e < m_entries.size(); ++e)
+	{
+		if (m_entries[e].m_path == normalised)
+		{
+			m_entries[e].m_data = std::move(data);
+			m_entries[e].m_compress = compress;
+			return;
+		}
+	}
+
+	PendingEntry entry;
+	entry.m_path = normalised;
+	entry.m_data = std::move(data);
+	entry.m_compress = compress;
+	m_entries.push_back(std::move(entry));
+}
+
+std::vector<UINT8> AssetArchiveWriter::write(ArchivePackStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	// every block of every compressed entry, compressed in parallel
+	std::vector<BlockWork> work;
+	std::vector<UINT32> firstBlocks(m_entries.size(), 0);
+
+	for (size_t e = 0; e < m_entries.size(); ++e)
+	{
+		firstBlocks[e] = static_cast<UINT32>(work.size());
+
+		if (!m_entries[e].m_compress)
+		{
+			continue;
+		}
+
+		const UINT64 blocks = blockCountOf(m_entries[e].m_data.size(), m_blockSize);
+
+		for (UINT64 b = 0; b < blocks; ++b)
+		{
+			BlockWork block;
+			block.m_request = e;
+			block.m_block = static_cast<UINT>(b);
+			work.push_back(block);
+		}
+	}
+
+	std::vector<std::vector<UINT8>> compressed(work.size());
+
+	m_jobSystem.parallelFor(work.size(), 1, [this, &work, &compressed](const size_t begin, const size_t end)
+	{
+		for (size_t w = begin; w < end; ++w)
+		{
+			const std::vector<UINT8> & data = m_entries[work[w].m_request].m_data;
+			const size_t first = static_cast<size_t>(work[w].m_block) * m_blockSize;
+			const size_t length = std::min<size_t>(m_blockSize, data.size() - first);
+
+			std::vector<UINT8> & out = compressed[w];
+			out.resize(lzCompressBound(length));
+
+			const size_t size = lzCompress(data.data() + first, length, out.data(), out.size());
+
+			// didn't get any smaller, the block is stored raw and the reader tells by its size
+			if (size == 0 || size >= length)
+			{
+				out.assign(data.begin() + first, data.begin() + first + length);
+			}
+			else
+			{
+				out.resize(size);
+			}
+		}
+	});
+
+	// lay the entries out in the order they were added, each on its own alignment boundary
+	std::vector<ArchiveEntry> entries(m_entries.size());
+	std::string names;
+	UINT64 offset = alignUp(sizeof(ArchiveHeader), c_archiveAlignment);
+
+	stats.m_bytesIn = 0;
+	stats.m_bytesStored = 0;
+
+	for (size_t e = 0; e < m_entries.size(); ++e)
+	{
+		ArchiveEntry & entry = entries[e];
+		entry.m_hash = AssetArchive::hashPath(m_entries[e].m_path);
+		entry.m_offset = offset;
+		entry.m_size = m_entries[e].m_data.size();
+		entry.m_nameOffset = static_cast<UINT32>(names.size());
+		entry.m_nameLength = static_cast<UINT32>(m_entries[e].m_path.size());
+		entry.m_firstBlock = firstBlocks[e];
+		entry.m_flags = m_entries[e].m_compress ? ARCHIVE_ENTRY_COMPRESSED : 0;
+		entry.m_storedSize = 0;
+
+		if (m_entries[e].m_compress)
+		{
+			const UINT64 blocks = blockCountOf(entry.m_size, m_blockSize);
+
+			for (UINT64 b = 0; b < blocks; ++b)
+			{
+				entry.m_storedSize += compressed[entry.m_firstBlock + b].size();
+			}
+		}
+		else
+		{
+			entry.m_storedSize = entry.m_size;
+		}
+
+		names += m_entries[e].m_path;
+		offset = alignUp(offset + entry.m_storedSize, c_archiveAlignment);
+
+		stats.m_bytesIn += entry.m_size;
+		stats.m_bytesStored += entry.m_storedSize;
+	}
+
+	ArchiveHeader header;
+	memcpy(header.m_magic, c_archiveMagic, sizeof(header.m_magic));
+	header.m_version = c_archiveVersion;
+	header.m_entryCount = static_cast<UINT32>(entries.size());
+	header.m_blockCount = static_cast<UINT32>(work.size());
+	header.m_blockSize = m_blockSize;
+	header.m_namesSize = static_cast<UINT32>(names.size());
+	header.m_tocOffset = offset;
+
+	const size_t tocSize = sizeof(ArchiveEntry) * entries.size() + sizeof(UINT32) * work.size() + names.size();
+	std::vector<UINT8> archive(static_cast<size_t>(offset) + tocSize, 0);
+
+	memcpy(archive.data(), &header, sizeof(header));
+
+	for (size_t e = 0; e < entries.size(); ++e)
+	{
+		UINT8 * out = archive.data() + entries[e].m_offset;
+
+		if (!m_entries[e].m_compress)
+		{
+			if (!m_entries[e].m_data.empty())
+			{
+				memcpy(out, m_entries[e].m_data.data(), m_entries[e].m_data.size());
+			}
+
+			continue;
+		}
+
+		const UINT64 blocks = blockCountOf(entries[e].m_size, m_blockSize);
+
+		for (UINT64 b = 0; b < blocks; ++b)
+		{
+			const std::vector<UINT8> & block = compressed[entries[e].m_firstBlock + b];
+			memcpy(out, block.data(), block.size());
+			out += block.size();
+		}
+	}
+
+	// the table of contents, sorted so a lookup is a binary search on the hash
+	std::vector<ArchiveEntry> toc(entries);
+
+	std::sort(toc.begin(), toc.end(), [](const ArchiveEntry & a, const ArchiveEntry & b)
+	{
+		return a.m_hash < b.m_hash;
+	});
+
+	UINT8 * out = archive.data() + offset;
+
+	if (!toc.empty())
+	{
+		memcpy(out, toc.data(), sizeof(ArchiveEntry) * toc.size());
+		out += sizeof(ArchiveEntry) * toc.size();
+	}
+
+	for (size_t w = 0; w < work.size(); ++w)
+	{
+		const UINT32 size = static_cast<UINT32>(compressed[w].size());
+		memcpy(out, &size, sizeof(size));
+		out += sizeof(size);
+	}
+
+	if (!names.empty())
+	{
+		memcpy(out, names.data(), names.size());
+	}
+
+	stats.m_entries = static_cast<UINT>(entries.size());
+	stats.m_blocks = work.size();
+	stats.m_seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+
+	return archive;
+}
+
+bool AssetArchiveWriter::save(const std::string & path, ArchivePackStats & stats)
+{
+	const std::vector<UINT8> archive = write(stats);
+
+	std::ofstream stream(path, std::ios::binary);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(archive.data()), archive.size());
+	return static_cast<bool>(stream);
+}
+
+AssetArchive::AssetArchive()
+	: m_data(nullptr)
+	, m_size(0)
+	, m_blockSize(0)
+	, m_names(nullptr)
+{
+
+}
+
+AssetArchive::~AssetArchive()
+{
+
+}
+
+UINT64 AssetArchive::hashPath(const std::string & path)
+{
+	// FNV-1a
+	const std::string normalised = AssetFileSystem::normalisePath(path);
+	UINT64 hash = 14695981039346656037ull;
+
+	for (size_t i = 0; i < normalised.size(); ++i)
+	{
+		hash ^= static_cast<UINT8>(normalised[i]);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+bool AssetArchive::open(const std::string & path)
+{
+	const std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+
+	if (!file->open(path))
+	{
+		return false;
+	}
+
+	return open(file->getData(), file->getSize(), file);
+}
+
+bool AssetArchive::open(const UINT8 * data, const size_t size, const std::shared_ptr<const void> & owner)
+{
+	close();
+
+	ArchiveHeader header;
+
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.m_magic, c_archiveMagic, sizeof(c_archiveMagic)) != 0 || header.m_version != c_archiveVersion || header.m_blockSize == 0)
+	{
+		return false;
+	}
+
+	// every count is 32 bits, so none of this can overflow 64
+	const UINT64 tocSize = sizeof(ArchiveEntry) * static_cast<UINT64>(header.m_entryCount) +
+		sizeof(UINT32) * static_cast<UINT64>(header.m_blockCount) + header.m_namesSize;
+
+	if (header.m_tocOffset < sizeof(header) || header.m_tocOffset > size || tocSize > size - header.m_tocOffset)
+	{
+		return false;
+	}
+
+	const UINT8 * toc = data + header.m_tocOffset;
+
+	std::vector<ArchiveEntry> entries(header.m_entryCount);
+	std::vector<UINT32> blockSizes(header.m_blockCount);
+
+	if (!entries.empty())
+	{
+		memcpy(entries.data(), toc, sizeof(ArchiveEntry) * entries.size());
+	}
+
+	if (!blockSizes.empty())
+	{
+		memcpy(blockSizes.data(), toc + sizeof(ArchiveEntry) * entries.size(), sizeof(UINT32) * blockSizes.size());
+	}
+
+	std::vector<UINT64> blockOffsets(blockSizes.size(), 0);
+
+	for (size_t e = 0; e < entries.size(); ++e)
+	{
+		const ArchiveEntry & entry = entries[e];
+
+		if ((e > 0 && entries[e - 1].m_hash > entry.m_hash) ||
+			static_cast<UINT64>(entry.m_nameOffset) + entry.m_nameLength > header.m_namesSize ||
+			entry.m_offset < sizeof(header) || entry.m_offset > header.m_tocOffset || entry.m_storedSize > header.m_tocOffset - entry.m_offset)
+		{
+			return false;
+		}
+
+		if ((entry.m_flags & ARCHIVE_ENTRY_COMPRESSED) == 0)
+		{
+			if (entry.m_storedSize != entry.m_size)
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		const UINT64 blocks = blockCountOf(entry.m_size, header.m_blockSize);
+
+		if (entry.m_firstBlock > blockSizes.size() || blocks > blockSizes.size() - entry.m_firstBlock)
+		{
+			return false;
+		}
+
+		UINT64 stored = 0;
+
+		for (UINT64 b = 0; b < blocks; ++b)
+		{
+			const UINT64 length = std::min<UINT64>(header.m_blockSize, entry.m_size - b * header.m_blockSize);
+			const UINT32 blockSize = blockSizes[static_cast<size_t>(entry.m_firstBlock + b)];
+
+			// a stored block is never bigger than what it decompresses to
+			if (blockSize > length)
+			{
+				return false;
+			}
+
+			blockOffsets[static_cast<size_t>(entry.m_firstBlock + b)] = entry.m_offset + stored;
+			stored += blockSize;
+		}
+
+		if (stored != entry.m_storedSize)
+		{
+			return false;
+		}
+	}
+
+	m_data = data;
+	m_size = size;
+	m_owner = owner;
+	m_blockSize = header.m_blockSize;
+	m_entries.swap(entries);
+	m_blockOffsets.swap(blockOffsets);
+	m_blockSizes.swap(blockSizes);
+	m_names = reinterpret_cast<const char*>(toc + tocSize - header.m_namesSize);
+
+	return true;
+}
+
+void AssetArchive::close()
+{
+	m_data = nullptr;
+	m_size = 0;
+	m_owner.reset();
+	m_blockSize = 0;
+	m_entries.clear();
+	m_blockOffsets.clear();
+	m_blockSizes.clear();
+	m_names = nullptr;
+}
+
+std::string AssetArchive::getName(const UINT entry) const
+{
+	return std::string(m_names + m_entries[entry].m_nameOffset, m_entries[entry].m_nameLength);
+}
+
+UINT AssetArchive::find(const std::string & path) const
+{
+	const std::string normalised = AssetFileSystem::normalisePath(path);
+	const UINT64 hash = hashPath(normalised);
+
+	std::vector<ArchiveEntry>::const_iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), hash,
+		[](const ArchiveEntry & entry, const UINT64 value)
+	{
+		return entry.m_hash < value;
+	});
+
+	// a 64 bit collision is unlikely, but the name decides
+	for (; it != m_entries.end() && it->m_hash == hash; ++it)
+	{
+		if (it->m_nameLength == normalised.size() && memcmp(m_names + it->m_nameOffset, normalised.data(), normalised.size()) == 0)
+		{
+			return static_cast<UINT>(it - m_entries.begin());
+		}
+	}
+
+	return UINT_MAX;
+}
+
+bool AssetArchive::getView(const UINT entry, AssetView & view) const
+{
+	if (isCompressed(entry))
+	{
+		return false;
+	}
+
+	view.m_data = m_data + m_entries[entry].m_offset;
+	view.m_size = static_cast<size_t>(m_entries[entry].m_size);
+	view.m_owner = m_owner;
+	return true;
+}
+
+bool AssetArchive::readBlock(const UINT entry, const UINT block, UINT8 * destination) const
+{
+	const ArchiveEntry & info = m_entries[entry];
+	const UINT64 first = static_cast<UINT64>(block) * m_blockSize;
+	const size_t length = static_cast<size_t>(std::min<UINT64>(m_blockSize, info.m_size - first));
+
+	if (!isCompressed(entry))
+	{
+		memcpy(destination, m_data + info.m_offset + first, length);
+		return true;
+	}
+
+	const size_t index = info.m_firstBlock + block;
+	const UINT8 * source = m_data + m_blockOffsets[index];
+
+	if (m_blockSizes[index] == length)
+	{
+		memcpy(destination, source, length);
+		return true;
+	}
+
+	return lzDecompress(source, m_blockSizes[index], destination, length);
+}
+
+bool AssetArchive::read(const UINT entry, UINT8 * destination) const
+{
+	const UINT64 blocks = blockCountOf(m_entries[entry].m_size, m_blockSize);
+
+	for (UINT64 b = 0; b < blocks; ++b)
+	{
+		if (!readBlock(entry, static_cast<UINT>(b), destination + b * m_blockSize))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool AssetArchive::readBatch(std::vector<ArchiveReadRequest> & requests, JobSystem & jobSystem, ArchiveReadStats & stats) const
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	std::vector<BlockWork> work;
+
+	stats.m_bytesStored = 0;
+	stats.m_bytesOut = 0;
+
+	for (size_t r = 0; r < requests.size(); ++r)
+	{
+		const ArchiveEntry & entry = m_entries[requests[r].m_entry];
+		const UINT64 blocks = blockCountOf(entry.m_size, m_blockSize);
+
+		for (UINT64 b = 0; b < blocks; ++b)
+		{
+			BlockWork block;
+			block.m_request = r;
+			block.m_block = static_cast<UINT>(b);
+			work.push_back(block);
+		}
+
+		stats.m_bytesStored += entry.m_storedSize;
+		stats.m_bytesOut += entry.m_size;
+	}
+
+	// any block failing fails its whole request
+	std::vector<std::atomic<bool>> failed(requests.size());
+
+	for (size_t r = 0; r < failed.size(); ++r)
+	{
+		failed[r] = false;
+	}
+
+	jobSystem.parallelFor(work.size(), c_blocksPerJob, [this, &requests, &work, &failed](const size_t begin, const size_t end)
+	{
+		for (size_t w = begin; w < end; ++w)
+		{
+			const ArchiveReadRequest & request = requests[work[w].m_request];
+			UINT8 * destination = request.m_destination + static_cast<size_t>(work[w].m_block) * m_blockSize;
+
+			if (!readBlock(request.m_entry, work[w].m_block, destination))
+			{
+				failed[work[w].m_request] = true;
+			}
+		}
+	});
+
+	bool succeeded = true;
+
+	for (size_t r = 0; r < requests.size(); ++r)
+	{
+		requests[r].m_succeeded = !failed[r];
+		succeeded = succeeded && requests[r].m_succeeded;
+	}
+
+	stats.m_entries = static_cast<UINT>(requests.size());
+	stats.m_blocks = work.size();
+	stats.m_seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+	stats.m_threadCount = jobSystem.getWorkerCount() + 1;
+
+	return succeeded;
+}
+
+void AssetArchive::readBatchAsync(const std::vector<ArchiveReadRequest> & requests, JobSystem & jobSystem,
+	std::function<void(std::vector<ArchiveReadRequest> & requests, const ArchiveReadStats & stats)> onComplete) const
+{
+	// parallelFor joins in from inside a job, so the batch still spreads over every worker
+	jobSystem.submit([this, requests, &jobSystem, onComplete]()
+	{
+		std::vector<ArchiveReadRequest> batch(requests);
+		ArchiveReadStats stats;
+
+		readBatch(batch, jobSystem, stats);
+		onComplete(batch, stats);
+	});
+}
+
+bool AssetArchive::mountInto(AssetFileSystem & fileSystem, JobSystem & jobSystem, ArchiveReadStats & stats) const
+{
+	std::vector<ArchiveReadRequest> requests;
+	std::vector<std::shared_ptr<std::vector<UINT8>>> buffers;
+
+	for (UINT e = 0; e < getEntryCount(); ++e)
+	{
+		AssetView view;
+
+		if (getView(e, view))
+		{
+			fileSystem.mount(getName(e), view.m_data, view.m_size, view.m_owner);
+			continue;
+		}
+
+		buffers.push_back(std::make_shared<std::vector<UINT8>>(static_cast<size_t>(m_entries[e].m_size)));
+
+		ArchiveReadRequest request;
+		request.m_entry = e;
+		request.m_destination = buffers.back()->data();
+		request.m_succeeded = false;
+		requests.push_back(request);
+	}
+
+	const bool succeeded = readBatch(requests, jobSystem, stats);
+
+	for (size_t r = 0; r < requests.size(); ++r)
+	{
+		if (requests[r].m_succeeded)
+		{
+			fileSystem.mount(getName(requests[r].m_entry), buffers[r]->data(), buffers[r]->size(), buffers[r]);
+		}
+	}
+
+	return succeeded;
+}
@@ -0,0 +1,175 @@
+#pragma once
+#ifndef _ASSET_ARCHIVE_H_
+#define _ASSET_ARCHIVE_H_
+
+#include <climits>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+#include "AssetFileSystem.h"
+#include "JobSystem.h"
+
+// on disk layout, little endian:
+//   ArchiveHeader, padded to c_archiveAlignment
+//   entry data, each entry starting on a c_archiveAlignment boundary
+//   the table of contents: ArchiveEntry[m_entryCount] sorted by hash, UINT32 stored size per block, the names
+const UINT c_archiveAlignment = 4096;
+const UINT c_archiveVersion = 1;
+
+struct ArchiveHeader
+{
+	char m_magic[4];	// "AARC"
+	UINT32 m_version;
+	UINT32 m_entryCount;
+	UINT32 m_blockCount;	// in the block table, over every compressed entry
+	UINT32 m_blockSize;		// uncompressed bytes per block, the last block of an entry can be shorter
+	UINT32 m_namesSize;
+	UINT64 m_tocOffset;
+};
+
+enum ArchiveEntryFlags
+{
+	ARCHIVE_ENTRY_COMPRESSED = 1	// stored as blocks, a block whose stored size is its full size is stored raw
+};
+
+struct ArchiveEntry
+{
+	UINT64 m_hash;			// of the normalised path
+	UINT64 m_offset;		// from the start of the archive
+	UINT64 m_size;			// uncompressed
+	UINT64 m_storedSize;
+	UINT32 m_nameOffset;	// into the names
+	UINT32 m_nameLength;
+	UINT32 m_firstBlock;	// into the block table, compressed entries only
+	UINT32 m_flags;
+};
+
+struct ArchivePackStats
+{
+	UINT m_entries;
+	UINT64 m_blocks;
+	UINT64 m_bytesIn;
+	UINT64 m_bytesStored;	// entry data only, without the padding and the table of contents
+	double m_seconds;
+	UINT m_threadCount;
+
+	double compressionRatio() const
+	{
+		return m_bytesStored > 0 ? static_cast<double>(m_bytesIn) / static_cast<double>(m_bytesStored) : 0.0;
+	}
+};
+
+struct ArchiveReadStats
+{
+	UINT m_entries;
+	UINT64 m_blocks;
+	UINT64 m_bytesStored;
+	UINT64 m_bytesOut;
+	double m_seconds;
+	UINT m_threadCount;
+
+	double megabytesPerSecond() const
+	{
+		return m_seconds > 0.0 ? static_cast<double>(m_bytesOut) / (1024.0 * 1024.0) / m_seconds : 0.0;
+	}
+};
+
+// builds an archive. entries that ask for compression are split into blocks and every block of every entry is
+// compressed in parallel, a block that doesn't get smaller is stored as it is
+class AssetArchiveWriter
+{
+public:
+	AssetArchiveWriter(JobSystem & jobSystem);
+	~AssetArchiveWriter();
+
+	void setBlockSize(const UINT32 bytes) { m_blockSize = bytes; }
+
+	// paths are stored normalised, the same as AssetFileSystem looks them up. a second add of a path replaces the first
+	void add(const std::string & path, std::vector<UINT8> && data, const bool compress);
+
+	std::vector<UINT8> write(ArchivePackStats & stats);
+	bool save(const std::string & path, ArchivePackStats & stats);
+
+private:
+
+	struct PendingEntry
+	{
+		std::string m_path;
+		std::vector<UINT8> m_data;
+		bool m_compress;
+	};
+
+	JobSystem & m_jobSystem;
+	UINT32 m_blockSize;
+	std::vector<PendingEntry> m_entries;
+};
+
+// one entry to read in full into memory the caller owns, entry size bytes of it
+struct ArchiveReadRequest
+{
+	UINT m_entry;
+	UINT8 * m_destination;
+	bool m_succeeded;
+};
+
+// reads an archive out of a mapping. uncompressed entries are views straight into it, compressed ones are
+// decompressed block by block, and a batch of reads spreads every block of every entry over the job system
+class AssetArchive
+{
+public:
+	AssetArchive();
+	~AssetArchive();
+
+	AssetArchive(const AssetArchive &) = delete;
+	AssetArchive & operator=(const AssetArchive &) = delete;
+
+	static UINT64 hashPath(const std::string & path);
+
+	bool open(const std::string & path);
+	// the data has to stay valid while the owner does, the whole table of contents is checked before it is used
+	bool open(const UINT8 * data, const size_t size, const std::shared_ptr<const void> & owner);
+	void close();
+
+	UINT getEntryCount() const { return static_cast<UINT>(m_entries.size()); }
+	const ArchiveEntry & getEntry(const UINT entry) const { return m_entries[entry]; }
+	std::string getName(const UINT entry) const;
+	bool isCompressed(const UINT entry) const { return (m_entries[entry].m_flags & ARCHIVE_ENTRY_COMPRESSED) != 0; }
+
+	// UINT_MAX when it isn't in the archive
+	UINT find(const std::string & path) const;
+
+	// an uncompressed entry as it is in the mapping, false for a compressed one
+	bool getView(const UINT entry, AssetView & view) const;
+
+	// one entry on the calling thread
+	bool read(const UINT entry, UINT8 * destination) const;
+	// every block of every request across the job system, false if any of them failed
+	bool readBatch(std::vector<ArchiveReadRequest> & requests, JobSystem & jobSystem, ArchiveReadStats & stats) const;
+	// the same from a job, the callback runs on whichever thread finishes it. the archive has to outlive the batch
+	void readBatchAsync(const std::vector<ArchiveReadRequest> & requests, JobSystem & jobSystem,
+		std::function<void(std::vector<ArchiveReadRequest> & requests, const ArchiveReadStats & stats)> onComplete) const;
+
+	// serves every entry through the file system, uncompressed ones from the mapping and compressed ones from
+	// buffers they are decompressed into up front
+	bool mountInto(AssetFileSystem & fileSystem, JobSystem & jobSystem, ArchiveReadStats & stats) const;
+
+private:
+
+	bool readBlock(const UINT entry, const UINT block, UINT8 * destination) const;
+
+	const UINT8 * m_data;
+	size_t m_size;
+	std::shared_ptr<const void> m_owner;
+
+	UINT32 m_blockSize;
+	std::vector<ArchiveEntry> m_entries;
+	std::vector<UINT64> m_blockOffsets;	// from the start of the archive
+	std::vector<UINT32> m_blockSizes;	// stored
+	const char * m_names;
+};
+
+#endif // _ASSET_ARCHIVE_H_
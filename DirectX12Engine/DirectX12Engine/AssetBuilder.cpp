@@ -0,0 +1,662 @@
+#include "AssetBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "AssetFileSystem.h"
+#include "MappedFile.h"
+
+namespace
+{
+	const UINT64 c_prime1 = 0x9E3779B185EBCA87ull;
+	const UINT64 c_prime2 = 0xC2B2AE3D27D4EB4Full;
+	const UINT64 c_prime3 = 0x165667B19E3779F9ull;
+
+	enum StepState
+	{
+		STEP_WAITING = 0,
+		STEP_UP_TO_DATE,
+		STEP_BUILT,
+		STEP_FAILED,
+		STEP_SKIPPED
+	};
+
+	UINT64 rotateLeft(const UINT64 value, const UINT bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	UINT64 mixLane(UINT64 lane, const UINT64 word)
+	{
+		lane += word * c_prime2;
+		return rotateLeft(lane, 31) * c_prime1;
+	}
+
+	UINT64 readWord(const UINT8 * data)
+	{
+		UINT64 word;
+		memcpy(&word, data, sizeof(word));
+		return word;
+	}
+
+	// size and last write time, false when there is no such file
+	bool statFile(const std::string & path, UINT64 & size, UINT64 & writeTime)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+		if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes) || (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+		{
+			return false;
+		}
+
+		size = (static_cast<UINT64>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		writeTime = (static_cast<UINT64>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+
+		return true;
+	}
+
+	// the same clock and units the file system stamps writes with
+	UINT64 currentFileTime()
+	{
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+
+		return (static_cast<UINT64>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+	}
+
+	template<typename T>
+	void append(std::vector<UINT8> & out, const T & value)
+	{
+		const UINT8 * bytes = reinterpret_cast<const UINT8*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	void appendFile(std::vector<UINT8> & out, const BuildFileRecord & file)
+	{
+		BuildDatabaseFile stored;
+		stored.m_size = file.m_size;
+		stored.m_writeTime = file.m_writeTime;
+		stored.m_recordTime = file.m_recordTime;
+		stored.m_hash = file.m_hash;
+		stored.m_pathLength = static_cast<UINT32>(file.m_path.size());
+		stored.m_reserved = 0;
+
+		append(out, stored);
+		out.insert(out.end(), file.m_path.begin(), file.m_path.end());
+	}
+
+	// reads a BuildDatabaseFile and its path, false past the end
+	bool readFileRecord(const UINT8 * & cursor, const UINT8 * end, BuildFileRecord & file)
+	{
+		BuildDatabaseFile stored;
+
+		if (static_cast<size_t>(end - cursor) < sizeof(stored))
+		{
+			return false;
+		}
+
+		memcpy(&stored, cursor, sizeof(stored));
+		cursor += sizeof(stored);
+
+		if (static_cast<size_t>(end - cursor) < stored.m_pathLength)
+		{
+			return false;
+		}
+
+		file.m_path.assign(reinterpret_cast<const char*>(cursor), stored.m_pathLength);
+		file.m_size = stored.m_size;
+		file.m_writeTime = stored.m_writeTime;
+		file.m_recordTime = stored.m_recordTime;
+		file.m_hash = stored.m_hash;
+		cursor += stored.m_pathLength;
+
+		return true;
+	}
+}
+
+AssetBuilder::AssetBuilder(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+{
+
+}
+
+AssetBuilder::~AssetBuilder()
+{
+
+}
+
+bool AssetBuilder::loadDatabase(const std::string & path)
+{
+	m_records.clear();
+
+	MappedFile file;
+
+	if (!file.open(path) || file.getSize() < sizeof(BuildDatabaseHeader))
+	{
+		return false;
+	}
+
+	const UINT8 * cursor = file.getData();
+	const UINT8 * end = cursor + file.getSize();
+
+	BuildDatabaseHeader header;
+	memcpy(&header, cursor, sizeof(header));
+	cursor += sizeof(header);
+
+	if (memcmp(header.m_magic, "ABDB", 4) != 0 || header.m_version != c_buildDatabaseVersion)
+	{
+		return false;
+	}
+
+	for (UINT32 r = 0; r < header.m_recordCount; ++r)
+	{
+		BuildDatabaseRecord stored;
+
+		if (static_cast<size_t>(end - cursor) < sizeof(stored))
+		{
+			m_records.clear();
+			return false;
+		}
+
+		memcpy(&stored, cursor, sizeof(stored));
+		cursor += sizeof(stored);
+
+		BuildRecord record;
+		record.m_recipeHash = stored.m_recipeHash;
+		record.m_output.m_size = stored.m_output.m_size;
+		record.m_output.m_writeTime = stored.m_output.m_writeTime;
+		record.m_output.m_recordTime = stored.m_output.m_recordTime;
+		record.m_output.m_hash = stored.m_output.m_hash;
+
+		if (static_cast<size_t>(end - cursor) < stored.m_output.m_pathLength)
+		{
+			m_records.clear();
+			return false;
+		}
+
+		record.m_output.m_path.assign(reinterpret_cast<const char*>(cursor), stored.m_output.m_pathLength);
+		cursor += stored.m_output.m_pathLength;
+
+		// each input takes at least its fixed part, so a damaged count can't reserve more than the file holds
+		if (stored.m_inputCount > static_cast<size_t>(end - cursor) / sizeof(BuildDatabaseFile))
+		{
+			m_records.clear();
+			return false;
+		}
+
+		record.m_inputs.resize(stored.m_inputCount);
+
+		for (UINT32 i = 0; i < stored.m_inputCount; ++i)
+		{
+			if (!readFileRecord(cursor, end, record.m_inputs[i]))
+			{
+				m_records.clear();
+				return false;
+			}
+		}
+
+		m_records[AssetFileSystem::normalisePath(record.m_output.m_path)] = std::move(record);
+	}
+
+	return true;
+}
+
+bool AssetBuilder::saveDatabase(const std::string & path) const
+{
+	std::vector<UINT8> out;
+
+	BuildDatabaseHeader header;
+	memcpy(header.m_magic, "ABDB", 4);
+	header.m_version = c_buildDatabaseVersion;
+	header.m_recordCount = static_cast<UINT32>(m_records.size());
+	header.m_reserved = 0;
+	append(out, header);
+
+	for (std::unordered_map<std::string, BuildRecord>::const_iterator it = m_records.begin(); it != m_records.end(); ++it)
+	{
+		const BuildRecord & record = it->second;
+
+		BuildDatabaseRecord stored;
+		stored.m_recipeHash = record.m_recipeHash;
+		stored.m_output.m_size = record.m_output.m_size;
+		stored.m_output.m_writeTime = record.m_output.m_writeTime;
+		stored.m_output.m_recordTime = record.m_output.m_recordTime;
+		stored.m_output.m_hash = record.m_output.m_hash;
+		stored.m_output.m_pathLength = static_cast<UINT32>(record.m_output.m_path.size());
+		stored.m_output.m_reserved = 0;
+		stored.m_inputCount = static_cast<UINT32>(record.m_inputs.size());
+		stored.m_reserved = 0;
+
+		append(out, stored);
+		out.insert(out.end(), record.m_output.m_path.begin(), record.m_output.m_path.end());
+
+		for (size_t i = 0; i < record.m_inputs.size(); ++i)
+		{
+			appendFile(out, record.m_inputs[i]);
+		}
+	}
+
+	const std::string temporaryPath = path + ".tmp";
+
+	{
+		std::ofstream stream(temporaryPath, std::ios::binary);
+
+		if (!stream)
+		{
+			return false;
+		}
+
+		stream.write(reinterpret_cast<const char*>(out.data()), out.size());
+
+		if (!stream)
+		{
+			return false;
+		}
+	}
+
+	return MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool AssetBuilder::addStep(const BuildStep & step)
+{
+	const std::string output = AssetFileSystem::normalisePath(step.m_output);
+
+	if (m_outputs.find(output) != m_outputs.end())
+	{
+		return false;
+	}
+
+	m_outputs[output] = static_cast<UINT>(m_steps.size());
+	m_steps.push_back(step);
+
+	return true;
+}
+
+void AssetBuilder::clearSteps()
+{
+	m_steps.clear();
+	m_outputs.clear();
+}
+
+bool AssetBuilder::build(AssetBuildStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+	const size_t stepCount = m_steps.size();
+
+	// the record each step had, looked up before anything runs so the jobs only read the map
+	std::vector<const BuildRecord *> oldRecords(stepCount, nullptr);
+
+	for (size_t s = 0; s < stepCount; ++s)
+	{
+		const std::unordered_map<std::string, BuildRecord>::const_iterator it = m_records.find(AssetFileSystem::normalisePath(m_steps[s].m_output));
+		oldRecords[s] = it != m_records.end() ? &it->second : nullptr;
+	}
+
+	// an edge from every step that makes one of a step's inputs to it. discovered inputs come from the last
+	// build's record, a step only discovers what it reads, so if it hasn't been built it is stale anyway
+	std::vector<std::vector<UINT> > dependents(stepCount);
+	std::vector<UINT> waitingOn(stepCount, 0);
+
+	for (UINT s = 0; s < stepCount; ++s)
+	{
+		std::vector<UINT> producers;
+
+		for (size_t i = 0; i < m_steps[s].m_inputs.size(); ++i)
+		{
+			const std::unordered_map<std::string, UINT>::const_iterator it = m_outputs.find(AssetFileSystem::normalisePath(m_steps[s].m_inputs[i]));
+
+			if (it != m_outputs.end())
+			{
+				producers.push_back(it->second);
+			}
+		}
+
+		for (size_t i = 0; oldRecords[s] != nullptr && i < oldRecords[s]->m_inputs.size(); ++i)
+		{
+			const std::unordered_map<std::string, UINT>::const_iterator it = m_outputs.find(AssetFileSystem::normalisePath(oldRecords[s]->m_inputs[i].m_path));
+
+			if (it != m_outputs.end())
+			{
+				producers.push_back(it->second);
+			}
+		}
+
+		std::sort(producers.begin(), producers.end());
+		producers.erase(std::unique(producers.begin(), producers.end()), producers.end());
+
+		for (size_t p = 0; p < producers.size(); ++p)
+		{
+			dependents[producers[p]].push_back(s);
+		}
+
+		waitingOn[s] = static_cast<UINT>(producers.size());
+	}
+
+	std::vector<UINT8> states(stepCount, STEP_WAITING);
+	std::vector<UINT8> upstreamFailed(stepCount, 0);
+	std::vector<BuildRecord> newRecords(stepCount);
+	std::atomic<UINT64> filesHashed(0);
+	std::atomic<UINT64> bytesHashed(0);
+
+	std::vector<UINT> wave;
+
+	for (UINT s = 0; s < stepCount; ++s)
+	{
+		if (waitingOn[s] == 0)
+		{
+			wave.push_back(s);
+		}
+	}
+
+	// a wave at a time, everything in a wave has had all its inputs made
+	while (!wave.empty())
+	{
+		m_jobSystem.parallelFor(wave.size(), 1, [&](const size_t begin, const size_t end)
+		{
+			UINT64 rangeFiles = 0;
+			UINT64 rangeBytes = 0;
+
+			for (size_t w = begin; w < end; ++w)
+			{
+				const UINT s = wave[w];
+				const BuildStep & step = m_steps[s];
+				BuildRecord & record = newRecords[s];
+
+				if (upstreamFailed[s] != 0)
+				{
+					states[s] = STEP_SKIPPED;
+					continue;
+				}
+
+				const UINT64 recipe = recipeHash(step);
+				bool upToDate = oldRecords[s] != nullptr && oldRecords[s]->m_recipeHash == recipe;
+
+				if (upToDate)
+				{
+					record = *oldRecords[s];
+					upToDate = isUnchanged(record.m_output, rangeFiles, rangeBytes);
+
+					for (size_t i = 0; upToDate && i < record.m_inputs.size(); ++i)
+					{
+						upToDate = isUnchanged(record.m_inputs[i], rangeFiles, rangeBytes);
+					}
+				}
+
+				if (upToDate)
+				{
+					states[s] = STEP_UP_TO_DATE;
+					continue;
+				}
+
+				std::vector<std::string> discovered;
+
+				if (!step.m_build || !step.m_build(step, discovered))
+				{
+					states[s] = STEP_FAILED;
+					continue;
+				}
+
+				// the declared inputs then whatever it found, once each
+				std::vector<std::string> inputs = step.m_inputs;
+				inputs.insert(inputs.end(), discovered.begin(), discovered.end());
+
+				record.m_recipeHash = recipe;
+				record.m_output.m_path = step.m_output;
+				record.m_inputs.clear();
+				bool recorded = recordFile(record.m_output, rangeBytes);
+				++rangeFiles;
+
+				std::vector<std::string> seen;
+
+				for (size_t i = 0; recorded && i < inputs.size(); ++i)
+				{
+					const std::string normalised = AssetFileSystem::normalisePath(inputs[i]);
+
+					if (std::find(seen.begin(), seen.end(), normalised) != seen.end())
+					{
+						continue;
+					}
+
+					seen.push_back(normalised);
+
+					BuildFileRecord input;
+					input.m_path = inputs[i];
+					recorded = recordFile(input, rangeBytes);
+					++rangeFiles;
+					record.m_inputs.push_back(input);
+				}
+
+				// an output that isn't there or an input that went missing counts as a failure, it can't be checked next time
+				states[s] = recorded ? STEP_BUILT : STEP_FAILED;
+			}
+
+			filesHashed += rangeFiles;
+			bytesHashed += rangeBytes;
+		});
+
+		std::vector<UINT> next;
+
+		for (size_t w = 0; w < wave.size(); ++w)
+		{
+			const UINT s = wave[w];
+			const bool failed = states[s] == STEP_FAILED || states[s] == STEP_SKIPPED;
+
+			for (size_t d = 0; d < dependents[s].size(); ++d)
+			{
+				const UINT dependent = dependents[s][d];
+				upstreamFailed[dependent] |= failed ? 1 : 0;
+
+				if (--waitingOn[dependent] == 0)
+				{
+					next.push_back(dependent);
+				}
+			}
+		}
+
+		std::sort(next.begin(), next.end());
+		wave.swap(next);
+	}
+
+	stats.m_steps = static_cast<UINT>(stepCount);
+	stats.m_built = 0;
+	stats.m_upToDate = 0;
+	stats.m_failed = 0;
+	stats.m_skipped = 0;
+
+	for (size_t s = 0; s < stepCount; ++s)
+	{
+		const std::string output = AssetFileSystem::normalisePath(m_steps[s].m_output);
+
+		switch (states[s])
+		{
+		case STEP_UP_TO_DATE:
+			++stats.m_upToDate;
+			m_records[output] = std::move(newRecords[s]);
+			break;
+
+		case STEP_BUILT:
+			++stats.m_built;
+			m_records[output] = std::move(newRecords[s]);
+			break;
+
+		case STEP_SKIPPED:
+			++stats.m_skipped;
+			break;
+
+		default:
+			// failed, or still waiting because it is in a loop. forgotten so it is tried again next time
+			++stats.m_failed;
+			m_records.erase(output);
+			break;
+		}
+	}
+
+	stats.m_filesHashed = filesHashed;
+	stats.m_bytesHashed = bytesHashed;
+	stats.m_seconds = duration<double>(steady_clock::now() - start).count();
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+
+	return stats.m_failed == 0 && stats.m_skipped == 0;
+}
+
+const BuildRecord * AssetBuilder::getRecord(const std::string & output) const
+{
+	const std::unordered_map<std::string, BuildRecord>::const_iterator it = m_records.find(AssetFileSystem::normalisePath(output));
+
+	return it != m_records.end() ? &it->second : nullptr;
+}
+
+UINT64 AssetBuilder::hashBytes(const void * data, const size_t size, const UINT64 seed)
+{
+	// xxHash64's structure, four independent lanes over 32 byte stripes so the multiplies overlap
+	const UINT8 * bytes = static_cast<const UINT8*>(data);
+	const UINT8 * end = bytes + size;
+	UINT64 hash;
+
+	if (size >= 32)
+	{
+		UINT64 lanes[4] = { seed + c_prime1 + c_prime2, seed + c_prime2, seed, seed - c_prime1 };
+
+		for (; end - bytes >= 32; bytes += 32)
+		{
+			lanes[0] = mixLane(lanes[0], readWord(bytes));
+			lanes[1] = mixLane(lanes[1], readWord(bytes + 8));
+			lanes[2] = mixLane(lanes[2], readWord(bytes + 16));
+			lanes[3] = mixLane(lanes[3], readWord(bytes + 24));
+		}
+
+		hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+
+		for (UINT l = 0; l < 4; ++l)
+		{
+			hash = (hash ^ mixLane(0, lanes[l])) * c_prime1 + c_prime3;
+		}
+	}
+	else
+	{
+		hash = seed + c_prime3;
+	}
+
+	hash += size;
+
+	for (; end - bytes >= 8; bytes += 8)
+	{
+		hash = rotateLeft(hash ^ mixLane(0, readWord(bytes)), 27) * c_prime1 + c_prime3;
+	}
+
+	for (; bytes < end; ++bytes)
+	{
+		hash = rotateLeft(hash ^ (*bytes * c_prime3), 11) * c_prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= c_prime2;
+	hash ^= hash >> 29;
+	hash *= c_prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+bool AssetBuilder::hashFile(const std::string & path, UINT64 & hash, UINT64 & size)
+{
+	UINT64 writeTime = 0;
+
+	if (!statFile(path, size, writeTime))
+	{
+		return false;
+	}
+
+	// an empty file can't be mapped
+	if (size == 0)
+	{
+		hash = hashBytes(nullptr, 0, 0);
+		return true;
+	}
+
+	MappedFile file;
+
+	if (!file.open(path))
+	{
+		return false;
+	}
+
+	size = file.getSize();
+	hash = hashBytes(file.getData(), file.getSize(), 0);
+
+	return true;
+}
+
+bool AssetBuilder::recordFile(BuildFileRecord & file, UINT64 & bytesHashed) const
+{
+	// the clock and the stamp first, a write after them makes the next check hash the file again rather than miss
+	// the change, even one that lands in the same tick and leaves the stamp as it was
+	UINT64 size = 0;
+	file.m_recordTime = currentFileTime();
+
+	if (!statFile(file.m_path, size, file.m_writeTime) || !hashFile(file.m_path, file.m_hash, file.m_size))
+	{
+		return false;
+	}
+
+	bytesHashed += file.m_size;
+
+	return true;
+}
+
+bool AssetBuilder::isUnchanged(BuildFileRecord & file, UINT64 & filesHashed, UINT64 & bytesHashed) const
+{
+	UINT64 size = 0;
+	UINT64 writeTime = 0;
+
+	if (!statFile(file.m_path, size, writeTime) || size != file.m_size)
+	{
+		return false;
+	}
+
+	// only a stamp from before the record was taken says nothing has been written since
+	if (writeTime == file.m_writeTime && writeTime < file.m_recordTime)
+	{
+		return true;
+	}
+
+	// touched, saved again with the same contents, or written too close to the record to tell
+	const UINT64 recordTime = currentFileTime();
+	UINT64 hash = 0;
+
+	if (!hashFile(file.m_path, hash, size))
+	{
+		return false;
+	}
+
+	++filesHashed;
+	bytesHashed += size;
+
+	if (hash != file.m_hash)
+	{
+		return false;
+	}
+
+	file.m_writeTime = writeTime;
+	file.m_recordTime = recordTime;
+
+	return true;
+}
+
+UINT64 AssetBuilder::recipeHash(const BuildStep & step) const
+{
+	UINT64 hash = hashBytes(step.m_settings.data(), step.m_settings.size(), step.m_toolVersion);
+
+	for (size_t i = 0; i < step.m_inputs.size(); ++i)
+	{
+		const std::string input = AssetFileSystem::normalisePath(step.m_inputs[i]);
+		hash = hashBytes(input.data(), input.size(), hash);
+	}
+
+	return hash;
+}
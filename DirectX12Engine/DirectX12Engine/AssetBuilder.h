@@ -0,0 +1,138 @@
+#pragma once
+#ifndef _ASSET_BUILDER_H_
+#define _ASSET_BUILDER_H_
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Windows.h>
+
+#include "JobSystem.h"
+
+// on disk layout of the build database, little endian:
+//   BuildDatabaseHeader
+//   per record: BuildDatabaseRecord, the output's path, then per input a BuildDatabaseFile and its path
+const UINT c_buildDatabaseVersion = 2;
+
+struct BuildDatabaseHeader
+{
+	char m_magic[4];	// "ABDB"
+	UINT32 m_version;
+	UINT32 m_recordCount;
+	UINT32 m_reserved;
+};
+
+struct BuildDatabaseFile
+{
+	UINT64 m_size;
+	UINT64 m_writeTime;
+	UINT64 m_recordTime;
+	UINT64 m_hash;
+	UINT32 m_pathLength;
+	UINT32 m_reserved;
+};
+
+struct BuildDatabaseRecord
+{
+	UINT64 m_recipeHash;
+	BuildDatabaseFile m_output;
+	UINT32 m_inputCount;
+	UINT32 m_reserved;
+};
+
+// one output and how to make it
+struct BuildStep
+{
+	std::string m_output;
+	std::vector<std::string> m_inputs;	// files it reads, other steps' outputs among them
+	std::string m_settings;				// everything else the output depends on, importer flags, cook settings
+	UINT m_toolVersion;					// bumped when the code that builds it changes
+	// makes the output. files found to be needed on the way (an .obj's .mtl, the textures a material names) go
+	// in discovered so a change to them rebuilds the output next time. false when it failed
+	std::function<bool(const BuildStep & step, std::vector<std::string> & discovered)> m_build;
+};
+
+// a file as it was when its output was last built. the size and write time are a quick check, only when
+// they have moved is the content hashed to see if it really changed. a file stamped at or after the record was
+// taken could have been written again within the same tick, so the stamp alone isn't trusted for it
+struct BuildFileRecord
+{
+	std::string m_path;
+	UINT64 m_size;
+	UINT64 m_writeTime;
+	UINT64 m_recordTime;	// the clock when the record was taken, before the file was read
+	UINT64 m_hash;
+};
+
+struct BuildRecord
+{
+	UINT64 m_recipeHash;	// settings, tool version and the declared inputs
+	BuildFileRecord m_output;
+	std::vector<BuildFileRecord> m_inputs;	// declared and discovered
+};
+
+struct AssetBuildStats
+{
+	UINT m_steps;
+	UINT m_built;
+	UINT m_upToDate;
+	UINT m_failed;			// and any caught in a dependency cycle
+	UINT m_skipped;			// something they need failed
+	UINT64 m_filesHashed;
+	UINT64 m_bytesHashed;
+	double m_seconds;
+	UINT m_threadCount;
+
+	double stepsPerSecond() const
+	{
+		return m_seconds > 0.0 ? static_cast<double>(m_steps) / m_seconds : 0.0;
+	}
+};
+
+// incremental builds for the offline steps. each output remembers the content hash of everything it was built
+// from, and a build only runs the steps where one of those changed, or the settings or tool version did. a step
+// whose input is another step's output runs after it, steps with nothing between them run in parallel. a
+// rebuilt output with the same bytes as before doesn't make the steps after it stale.
+// the records are kept in a database file between runs, paths are matched the way AssetFileSystem matches them
+class AssetBuilder
+{
+public:
+	AssetBuilder(JobSystem & jobSystem);
+	~AssetBuilder();
+
+	// false, and an empty database, when there is no file or it is from another version or damaged
+	bool loadDatabase(const std::string & path);
+	// written beside it first and then moved over it, so a run that dies half way leaves the last one
+	bool saveDatabase(const std::string & path) const;
+
+	// false when another step already makes that output
+	bool addStep(const BuildStep & step);
+	void clearSteps();
+
+	// false when any step failed or the steps depend on each other in a loop
+	bool build(AssetBuildStats & stats);
+
+	// nullptr when the output has never been built
+	const BuildRecord * getRecord(const std::string & output) const;
+
+	static UINT64 hashBytes(const void * data, const size_t size, const UINT64 seed);
+	// false when the file can't be read
+	static bool hashFile(const std::string & path, UINT64 & hash, UINT64 & size);
+
+private:
+
+	// fills the record's size, write time and hash from the file as it is now
+	bool recordFile(BuildFileRecord & file, UINT64 & bytesHashed) const;
+	// true when the file still has the recorded contents, the stamp is moved on when only it changed
+	bool isUnchanged(BuildFileRecord & file, UINT64 & filesHashed, UINT64 & bytesHashed) const;
+	UINT64 recipeHash(const BuildStep & step) const;
+
+	JobSystem & m_jobSystem;
+	std::vector<BuildStep> m_steps;
+	std::unordered_map<std::string, UINT> m_outputs;			// normalised output path to step
+	std::unordered_map<std::string, BuildRecord> m_records;	// normalised output path
+};
+
+#endif // _ASSET_BUILDER_H_
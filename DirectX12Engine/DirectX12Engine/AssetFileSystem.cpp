@@ -0,0 +1,145 @@
+#include "AssetFileSystem.h"
+
+#include <vector>
+
+#include "MappedFile.h"
+
+AssetFileSystem::AssetFileSystem()
+	: m_mounted()
+	, m_looseFiles()
+	, m_stats()
+{
+
+}
+
+AssetFileSystem::~AssetFileSystem()
+{
+
+}
+
+std::string AssetFileSystem::normalisePath(const std::string & path)
+{
+	std::vector<std::string> segments;
+	std::string segment;
+
+	for (size_t i = 0; i <= path.size(); ++i)
+	{
+		const char c = i < path.size() ? path[i] : '/';
+
+		if (c != '/' && c != '\\')
+		{
+			// windows doesn't care about case, so neither do the lookups
+			segment.push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c);
+			continue;
+		}
+
+		if (segment == "..")
+		{
+			// a leading ".." stays, there is nothing to step back out of
+			if (!segments.empty() && segments.back() != "..")
+			{
+				segments.pop_back();
+			}
+			else
+			{
+				segments.push_back(segment);
+			}
+		}
+		else if (!segment.empty() && segment != ".")
+		{
+			segments.push_back(segment);
+		}
+
+		segment.clear();
+	}
+
+	std::string normalised;
+
+	for (size_t s = 0; s < segments.size(); ++s)
+	{
+		if (s > 0)
+		{
+			normalised.push_back('/');
+		}
+
+		normalised += segments[s];
+	}
+
+	return normalised;
+}
+
+void AssetFileSystem::mount(const std::string & path, const UINT8 * data, const size_t size, const std::shared_ptr<const void> & owner)
+{
+	AssetView view;
+	view.m_data = data;
+	view.m_size = size;
+	view.m_owner = owner;
+
+	m_mounted[normalisePath(path)] = view;
+}
+
+void AssetFileSystem::unmount(const std::string & path)
+{
+	m_mounted.erase(normalisePath(path));
+}
+
+bool AssetFileSystem::exists(const std::string & path) const
+{
+	const std::string key = normalisePath(path);
+
+	if (m_mounted.count(key) > 0 || m_looseFiles.count(key) > 0)
+	{
+		return true;
+	}
+
+	const DWORD attributes = GetFileAttributesA(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
+}
+
+bool AssetFileSystem::open(const std::string & path, AssetView & view)
+{
+	++m_stats.m_opens;
+
+	const std::string key = normalisePath(path);
+
+	const std::unordered_map<std::string, AssetView>::const_iterator mounted = m_mounted.find(key);
+
+	if (mounted != m_mounted.end())
+	{
+		++m_stats.m_mountedOpens;
+		view = mounted->second;
+		return true;
+	}
+
+	const std::unordered_map<std::string, AssetView>::const_iterator mapped = m_looseFiles.find(key);
+
+	if (mapped != m_looseFiles.end())
+	{
+		++m_stats.m_mountedOpens;
+		view = mapped->second;
+		return true;
+	}
+
+	const std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+
+	if (!file->open(path))
+	{
+		++m_stats.m_missing;
+		return false;
+	}
+
+	view.m_data = file->getData();
+	view.m_size = file->getSize();
+	view.m_owner = file;
+
+	m_looseFiles[key] = view;
+
+	++m_stats.m_filesMapped;
+	m_stats.m_bytesMapped += view.m_size;
+	return true;
+}
+
+void AssetFileSystem::releaseLooseFiles()
+{
+	m_looseFiles.clear();
+}
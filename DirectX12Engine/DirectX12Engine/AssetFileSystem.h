@@ -0,0 +1,65 @@
+#pragma once
+#ifndef _ASSET_FILE_SYSTEM_H_
+#define _ASSET_FILE_SYSTEM_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <Windows.h>
+
+// a read only view of a whole asset, wherever it lives. the owner keeps the memory alive for as long as
+// the view is held, so a view can outlive the file system that handed it out
+struct AssetView
+{
+	const UINT8 * m_data;
+	size_t m_size;
+	std::shared_ptr<const void> m_owner;
+};
+
+struct AssetFileStats
+{
+	UINT m_opens;
+	UINT m_mountedOpens;	// served from a mount or a file mapped by an earlier open
+	UINT m_filesMapped;		// loose files mapped from disk
+	UINT m_missing;
+	UINT64 m_bytesMapped;
+};
+
+// serves assets from memory instead of through buffered reads. anything mounted (a block of memory, later an
+// archive) is looked up first, everything else is a loose file that is mapped on its first open and kept mapped
+// so the importer opening the same file several times only maps it once.
+// paths are compared normalised, so "Models\\A.obj" and "./models/a.obj" are the same asset.
+// not thread safe, mount everything before loading starts
+class AssetFileSystem
+{
+public:
+	AssetFileSystem();
+	~AssetFileSystem();
+
+	AssetFileSystem(const AssetFileSystem &) = delete;
+	AssetFileSystem & operator=(const AssetFileSystem &) = delete;
+
+	// forward slashes, no "." or "dir/.." segments, lower case
+	static std::string normalisePath(const std::string & path);
+
+	// the data has to stay valid while the owner does, a mount shadows a loose file with the same path
+	void mount(const std::string & path, const UINT8 * data, const size_t size, const std::shared_ptr<const void> & owner);
+	void unmount(const std::string & path);
+
+	bool exists(const std::string & path) const;
+	bool open(const std::string & path, AssetView & view);
+
+	// drops the loose files mapped so far, views already handed out keep theirs until they go
+	void releaseLooseFiles();
+
+	const AssetFileStats & getStats() const { return m_stats; }
+
+private:
+
+	std::unordered_map<std::string, AssetView> m_mounted;
+	std::unordered_map<std::string, AssetView> m_looseFiles;
+	AssetFileStats m_stats;
+};
+
+#endif // _ASSET_FILE_SYSTEM_H_
@@ -0,0 +1,129 @@
+#include "AssetIOSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+AssetIOStream::AssetIOStream(const AssetView & view)
+	: m_view(view)
+	, m_position(0)
+{
+
+}
+
+AssetIOStream::~AssetIOStream()
+{
+
+}
+
+size_t AssetIOStream::Read(void * buffer, size_t size, size_t count)
+{
+	if (size == 0 || count == 0)
+	{
+		return 0;
+	}
+
+	// whole items only, the same as fread
+	const size_t items = std::min(count, (m_view.m_size - m_position) / size);
+
+	memcpy(buffer, m_view.m_data + m_position, items * size);
+	m_position += items * size;
+
+	return items;
+}
+
+size_t AssetIOStream::Write(const void *, size_t, size_t)
+{
+	return 0;
+}
+
+aiReturn AssetIOStream::Seek(size_t offset, aiOrigin origin)
+{
+	size_t position = 0;
+
+	switch (origin)
+	{
+	case aiOrigin_SET:
+		position = offset;
+		break;
+	case aiOrigin_CUR:
+		position = m_position + offset;
+		break;
+	case aiOrigin_END:
+		// offset is unsigned, so from the end it counts backwards
+		if (offset > m_view.m_size)
+		{
+			return aiReturn_FAILURE;
+		}
+
+		position = m_view.m_size - offset;
+		break;
+	default:
+		return aiReturn_FAILURE;
+	}
+
+	if (position > m_view.m_size)
+	{
+		return aiReturn_FAILURE;
+	}
+
+	m_position = position;
+	return aiReturn_SUCCESS;
+}
+
+size_t AssetIOStream::Tell() const
+{
+	return m_position;
+}
+
+size_t AssetIOStream::FileSize() const
+{
+	return m_view.m_size;
+}
+
+void AssetIOStream::Flush()
+{
+
+}
+
+AssetIOSystem::AssetIOSystem(AssetFileSystem & fileSystem)
+	: m_fileSystem(fileSystem)
+{
+
+}
+
+AssetIOSystem::~AssetIOSystem()
+{
+
+}
+
+bool AssetIOSystem::Exists(const char * path) const
+{
+	return m_fileSystem.exists(path);
+}
+
+char AssetIOSystem::getOsSeparator() const
+{
+	return '/';
+}
+
+Assimp::IOStream * AssetIOSystem::Open(const char * path, const char * mode)
+{
+	if (strchr(mode, 'w') != nullptr || strchr(mode, 'a') != nullptr || strchr(mode, '+') != nullptr)
+	{
+		return nullptr;
+	}
+
+	AssetView view;
+
+	if (!m_fileSystem.open(path, view))
+	{
+		return nullptr;
+	}
+
+	return new AssetIOStream(view);
+}
+
+void AssetIOSystem::Close(Assimp::IOStream * stream)
+{
+	delete stream;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef _ASSET_IO_SYSTEM_H_
+#define _ASSET_IO_SYSTEM_H_
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include "AssetFileSystem.h"
+
+// a read only stream over an asset view, every read is a copy out of memory that is already mapped
+class AssetIOStream : public Assimp::IOStream
+{
+public:
+	AssetIOStream(const AssetView & view);
+	~AssetIOStream();
+
+	size_t Read(void * buffer, size_t size, size_t count) override;
+	size_t Write(const void * buffer, size_t size, size_t count) override;
+	aiReturn Seek(size_t offset, aiOrigin origin) override;
+	size_t Tell() const override;
+	size_t FileSize() const override;
+	void Flush() override;
+
+private:
+
+	AssetView m_view;
+	size_t m_position;
+};
+
+// lets Assimp::Importer read through an AssetFileSystem, so the scene and every file it references (the .mtl of
+// an .obj) come out of mappings and mounts instead of stdio. the importer deletes its io handler, so this is only
+// a thin adapter and the file system it points at is owned elsewhere
+class AssetIOSystem : public Assimp::IOSystem
+{
+public:
+	AssetIOSystem(AssetFileSystem & fileSystem);
+	~AssetIOSystem();
+
+	bool Exists(const char * path) const override;
+	char getOsSeparator() const override;
+	// read modes only, nothing is ever written back
+	Assimp::IOStream * Open(const char * path, const char * mode = "rb") override;
+	void Close(Assimp::IOStream * stream) override;
+
+private:
+
+	AssetFileSystem & m_fileSystem;
+};
+
+#endif // _ASSET_IO_SYSTEM_H_
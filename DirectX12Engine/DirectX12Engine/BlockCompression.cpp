@@ -0,0 +1,811 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// a block split into channels, so four texels of one channel fill an SSE register
+	struct BlockTexels
+	{
+		alignas(16) float m_channels[4][c_bcBlockTexels];
+	};
+
+	void loadBlock(const UINT8 * rgba, BlockTexels & texels)
+	{
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			for (UINT c = 0; c < 4; ++c)
+			{
+				texels.m_channels[c][t] = static_cast<float>(rgba[t * 4 + c]);
+			}
+		}
+	}
+
+	// nearest palette entry for every texel by weighted squared distance, writes each texel's error too.
+	// the weights pick the channels that count, BC1 ignores alpha and BC4 only looks at one channel
+	void selectIndices(const BlockTexels & texels, const float (*palette)[4], const UINT paletteSize,
+		const float * weights, UINT8 * indices, float * errors)
+	{
+#ifdef BC_USE_SSE2
+		const __m128 weightR = _mm_set1_ps(weights[0]);
+		const __m128 weightG = _mm_set1_ps(weights[1]);
+		const __m128 weightB = _mm_set1_ps(weights[2]);
+		const __m128 weightA = _mm_set1_ps(weights[3]);
+
+		for (UINT t = 0; t < c_bcBlockTexels; t += 4)
+		{
+			const __m128 r = _mm_load_ps(&texels.m_channels[0][t]);
+			const __m128 g = _mm_load_ps(&texels.m_channels[1][t]);
+			const __m128 b = _mm_load_ps(&texels.m_channels[2][t]);
+			const __m128 a = _mm_load_ps(&texels.m_channels[3][t]);
+
+			__m128 bestError = _mm_set1_ps(FLT_MAX);
+			__m128 bestIndex = _mm_setzero_ps();
+
+			for (UINT p = 0; p < paletteSize; ++p)
+			{
+				const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+				const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+				const __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+				const __m128 da = _mm_sub_ps(a, _mm_set1_ps(palette[p][3]));
+
+				__m128 error = _mm_mul_ps(_mm_mul_ps(dr, dr), weightR);
+				error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(dg, dg), weightG));
+				error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(db, db), weightB));
+				error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(da, da), weightA));
+
+				// strictly less, so ties keep the lower index like the scalar path
+				const __m128 better = _mm_cmplt_ps(error, bestError);
+				bestError = _mm_min_ps(error, bestError);
+				bestIndex = _mm_or_ps(_mm_and_ps(better, _mm_set1_ps(static_cast<float>(p))), _mm_andnot_ps(better, bestIndex));
+			}
+
+			alignas(16) float index[4];
+			_mm_store_ps(index, bestIndex);
+			_mm_storeu_ps(&errors[t], bestError);
+
+			for (UINT i = 0; i < 4; ++i)
+			{
+				indices[t + i] = static_cast<UINT8>(index[i]);
+			}
+		}
+#else
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			float bestError = FLT_MAX;
+			UINT8 bestIndex = 0;
+
+			for (UINT p = 0; p < paletteSize; ++p)
+			{
+				float error = 0.0f;
+
+				for (UINT c = 0; c < 4; ++c)
+				{
+					const float d = texels.m_channels[c][t] - palette[p][c];
+					error += d * d * weights[c];
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = static_cast<UINT8>(p);
+				}
+			}
+
+			indices[t] = bestIndex;
+			errors[t] = bestError;
+		}
+#endif
+	}
+
+	float sumErrors(const float * errors, const float * texelWeights)
+	{
+		float total = 0.0f;
+
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			total += errors[t] * texelWeights[t];
+		}
+
+		return total;
+	}
+
+	// endpoints along the principal axis of the included texels (texelWeights 0 or 1)
+	void fitEndpoints(const BlockTexels & texels, const float * texelWeights, const UINT channels, float * endpoint0, float * endpoint1)
+	{
+		float mean[4] = {};
+		float count = 0.0f;
+
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			for (UINT c = 0; c < channels; ++c)
+			{
+				mean[c] += texels.m_channels[c][t] * texelWeights[t];
+			}
+
+			count += texelWeights[t];
+		}
+
+		for (UINT c = 0; c < channels; ++c)
+		{
+			mean[c] /= std::max(count, 1.0f);
+		}
+
+		float covariance[4][4] = {};
+
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			for (UINT i = 0; i < channels; ++i)
+			{
+				const float di = (texels.m_channels[i][t] - mean[i]) * texelWeights[t];
+
+				for (UINT j = 0; j < channels; ++j)
+				{
+					covariance[i][j] += di * (texels.m_channels[j][t] - mean[j]);
+				}
+			}
+		}
+
+		// power iteration, converges quickly for the dominant axis which is all that is needed here
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+		for (UINT iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+
+			for (UINT i = 0; i < channels; ++i)
+			{
+				for (UINT j = 0; j < channels; ++j)
+				{
+					next[i] += covariance[i][j] * axis[j];
+				}
+
+				length = std::max(length, std::fabs(next[i]));
+			}
+
+			if (length < 1e-6f)
+			{
+				break;
+			}
+
+			for (UINT i = 0; i < channels; ++i)
+			{
+				axis[i] = next[i] / length;
+			}
+		}
+
+		float axisLengthSq = 0.0f;
+
+		for (UINT c = 0; c < channels; ++c)
+		{
+			axisLengthSq += axis[c] * axis[c];
+		}
+
+		float minimum = 0.0f;
+		float maximum = 0.0f;
+
+		if (axisLengthSq > 1e-12f)
+		{
+			minimum = FLT_MAX;
+			maximum = -FLT_MAX;
+
+			for (UINT t = 0; t < c_bcBlockTexels; ++t)
+			{
+				if (texelWeights[t] == 0.0f)
+				{
+					continue;
+				}
+
+				float projection = 0.0f;
+
+				for (UINT c = 0; c < channels; ++c)
+				{
+					projection += (texels.m_channels[c][t] - mean[c]) * axis[c];
+				}
+
+				projection /= axisLengthSq;
+				minimum = std::min(minimum, projection);
+				maximum = std::max(maximum, projection);
+			}
+		}
+
+		for (UINT c = 0; c < channels; ++c)
+		{
+			endpoint0[c] = std::min(std::max(mean[c] + axis[c] * minimum, 0.0f), 255.0f);
+			endpoint1[c] = std::min(std::max(mean[c] + axis[c] * maximum, 0.0f), 255.0f);
+		}
+	}
+
+	// least squares endpoints for the chosen indices, weight is how far each index is towards endpoint1.
+	// returns false when every texel sits on one index and there is nothing to solve
+	bool refineEndpoints(const BlockTexels & texels, const float * texelWeights, const UINT channels,
+		const UINT8 * indices, const float * indexWeights, float * endpoint0, float * endpoint1)
+	{
+		float a = 0.0f;
+		float b = 0.0f;
+		float c = 0.0f;
+		float rhs0[4] = {};
+		float rhs1[4] = {};
+
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			const float w = indexWeights[indices[t]];
+			const float inverse = 1.0f - w;
+			const float texelWeight = texelWeights[t];
+
+			a += inverse * inverse * texelWeight;
+			b += inverse * w * texelWeight;
+			c += w * w * texelWeight;
+
+			for (UINT ch = 0; ch < channels; ++ch)
+			{
+				rhs0[ch] += inverse * texels.m_channels[ch][t] * texelWeight;
+				rhs1[ch] += w * texels.m_channels[ch][t] * texelWeight;
+			}
+		}
+
+		const float determinant = a * c - b * b;
+
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (UINT ch = 0; ch < channels; ++ch)
+		{
+			endpoint0[ch] = std::min(std::max((c * rhs0[ch] - b * rhs1[ch]) / determinant, 0.0f), 255.0f);
+			endpoint1[ch] = std::min(std::max((a * rhs1[ch] - b * rhs0[ch]) / determinant, 0.0f), 255.0f);
+		}
+
+		return true;
+	}
+
+	// BC1 / BC3 colour ---------------------------------------------------------------------------------
+
+	UINT16 packRgb565(const float * colour)
+	{
+		const UINT r = static_cast<UINT>(colour[0] * 31.0f / 255.0f + 0.5f);
+		const UINT g = static_cast<UINT>(colour[1] * 63.0f / 255.0f + 0.5f);
+		const UINT b = static_cast<UINT>(colour[2] * 31.0f / 255.0f + 0.5f);
+		return static_cast<UINT16>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRgb565(const UINT16 packed, UINT * colour)
+	{
+		const UINT r = (packed >> 11) & 31;
+		const UINT g = (packed >> 5) & 63;
+		const UINT b = packed & 31;
+		colour[0] = (r << 3) | (r >> 2);
+		colour[1] = (g << 2) | (g >> 4);
+		colour[2] = (b << 3) | (b >> 2);
+	}
+
+	// the palette a decoder builds from two packed endpoints, threeColour is the c0 <= c1 mode
+	UINT buildColourPalette(const UINT16 c0, const UINT16 c1, const bool threeColour, float (*palette)[4])
+	{
+		UINT e0[3];
+		UINT e1[3];
+		unpackRgb565(c0, e0);
+		unpackRgb565(c1, e1);
+
+		for (UINT c = 0; c < 3; ++c)
+		{
+			palette[0][c] = static_cast<float>(e0[c]);
+			palette[1][c] = static_cast<float>(e1[c]);
+
+			if (threeColour)
+			{
+				palette[2][c] = static_cast<float>((e0[c] + e1[c]) / 2);
+			}
+			else
+			{
+				palette[2][c] = static_cast<float>((2 * e0[c] + e1[c]) / 3);
+				palette[3][c] = static_cast<float>((e0[c] + 2 * e1[c]) / 3);
+			}
+		}
+
+		for (UINT p = 0; p < 4; ++p)
+		{
+			palette[p][3] = 0.0f;
+		}
+
+		return threeColour ? 3 : 4;
+	}
+
+	struct ColourCandidate
+	{
+		UINT16 m_c0;
+		UINT16 m_c1;
+		UINT8 m_indices[c_bcBlockTexels];
+		float m_error;
+	};
+
+	// quantises the endpoints into the order the mode needs and picks the indices
+	void evaluateColour(const BlockTexels & texels, const float * texelWeights, const float * endpoint0, const float * endpoint1,
+		const bool threeColour, ColourCandidate & candidate)
+	{
+		UINT16 c0 = packRgb565(endpoint0);
+		UINT16 c1 = packRgb565(endpoint1);
+
+		// four colour mode needs c0 > c1 and three colour mode c0 <= c1, swapping the endpoints only flips the palette
+		if ((!threeColour && c0 < c1) || (threeColour && c0 > c1))
+		{
+			std::swap(c0, c1);
+		}
+
+		float palette[4][4];
+		UINT paletteSize = buildColourPalette(c0, c1, threeColour || c0 == c1, palette);
+
+		if (!threeColour && c0 == c1)
+		{
+			// equal endpoints can only be read as three colour, keep to the entries that match either way
+			paletteSize = 1;
+		}
+
+		const float weights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+		float errors[c_bcBlockTexels];
+
+		candidate.m_c0 = c0;
+		candidate.m_c1 = c1;
+		selectIndices(texels, palette, paletteSize, weights, candidate.m_indices, errors);
+		candidate.m_error = sumErrors(errors, texelWeights);
+	}
+
+	void encodeColourBlock(const UINT8 * rgba, const bool allowTransparent, UINT8 * block)
+	{
+		BlockTexels texels;
+		loadBlock(rgba, texels);
+
+		float texelWeights[c_bcBlockTexels];
+		bool anyTransparent = false;
+		bool anyOpaque = false;
+
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			const bool transparent = allowTransparent && rgba[t * 4 + 3] < 128;
+			texelWeights[t] = transparent ? 0.0f : 1.0f;
+			anyTransparent = anyTransparent || transparent;
+			anyOpaque = anyOpaque || !transparent;
+		}
+
+		ColourCandidate best;
+
+		if (!anyOpaque)
+		{
+			best.m_c0 = 0;
+			best.m_c1 = 0;
+			std::fill(best.m_indices, best.m_indices + c_bcBlockTexels, static_cast<UINT8>(3));
+		}
+		else
+		{
+			float endpoint0[4];
+			float endpoint1[4];
+			fitEndpoints(texels, texelWeights, 3, endpoint0, endpoint1);
+
+			evaluateColour(texels, texelWeights, endpoint0, endpoint1, anyTransparent, best);
+
+			// one least squares pass on the indices that came out, keep it if it helps
+			const float fourColourWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			const float threeColourWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+			if (refineEndpoints(texels, texelWeights, 3, best.m_indices, anyTransparent ? threeColourWeights : fourColourWeights, endpoint0, endpoint1))
+			{
+				ColourCandidate refined;
+				evaluateColour(texels, texelWeights, endpoint0, endpoint1, anyTransparent, refined);
+
+				if (refined.m_error < best.m_error)
+				{
+					best = refined;
+				}
+			}
+
+			for (UINT t = 0; t < c_bcBlockTexels; ++t)
+			{
+				if (texelWeights[t] == 0.0f)
+				{
+					best.m_indices[t] = 3;
+				}
+			}
+		}
+
+		UINT32 indexBits = 0;
+
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			indexBits |= static_cast<UINT32>(best.m_indices[t]) << (t * 2);
+		}
+
+		block[0] = static_cast<UINT8>(best.m_c0 & 0xff);
+		block[1] = static_cast<UINT8>(best.m_c0 >> 8);
+		block[2] = static_cast<UINT8>(best.m_c1 & 0xff);
+		block[3] = static_cast<UINT8>(best.m_c1 >> 8);
+		memcpy(block + 4, &indexBits, sizeof(indexBits));
+	}
+
+	void decodeColourBlock(const UINT8 * block, const bool alwaysFourColour, UINT8 * rgba)
+	{
+		const UINT16 c0 = static_cast<UINT16>(block[0] | (block[1] << 8));
+		const UINT16 c1 = static_cast<UINT16>(block[2] | (block[3] << 8));
+		const bool threeColour = !alwaysFourColour && c0 <= c1;
+
+		float palette[4][4];
+		buildColourPalette(c0, c1, threeColour, palette);
+
+		UINT32 indexBits;
+		memcpy(&indexBits, block + 4, sizeof(indexBits));
+
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			const UINT index = (indexBits >> (t * 2)) & 3;
+			const bool transparent = threeColour && index == 3;
+
+			for (UINT c = 0; c < 3; ++c)
+			{
+				rgba[t * 4 + c] = transparent ? 0 : static_cast<UINT8>(palette[index][c]);
+			}
+
+			rgba[t * 4 + 3] = transparent ? 0 : 255;
+		}
+	}
+
+	// BC7 mode 6 ---------------------------------------------------------------------------------------
+
+	const UINT c_bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	UINT bc7Interpolate(const UINT e0, const UINT e1, const UINT weight)
+	{
+		return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+	}
+
+	// 7 bits per channel plus a p bit shared by the endpoint's four channels, tries both p bits
+	void quantiseBc7Endpoint(const float * endpoint, UINT * quantised, UINT & pBit)
+	{
+		float bestError = FLT_MAX;
+
+		for (UINT p = 0; p < 2; ++p)
+		{
+			UINT candidate[4];
+			float error = 0.0f;
+
+			for (UINT c = 0; c < 4; ++c)
+			{
+				const int v = static_cast<int>((endpoint[c] - static_cast<float>(p)) / 2.0f + 0.5f);
+				candidate[c] = static_cast<UINT>(std::min(std::max(v, 0), 127));
+
+				const float d = static_cast<float>((candidate[c] << 1) | p) - endpoint[c];
+				error += d * d;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				std::copy(candidate, candidate + 4, quantised);
+			}
+		}
+	}
+
+	struct Bc7Candidate
+	{
+		UINT m_endpoints[2][4];	// 7 bit
+		UINT m_pBits[2];
+		UINT8 m_indices[c_bcBlockTexels];
+		float m_error;
+	};
+
+	void evaluateBc7(const BlockTexels & texels, const float * endpoint0, const float * endpoint1, Bc7Candidate & candidate)
+	{
+		quantiseBc7Endpoint(endpoint0, candidate.m_endpoints[0], candidate.m_pBits[0]);
+		quantiseBc7Endpoint(endpoint1, candidate.m_endpoints[1], candidate.m_pBits[1]);
+
+		UINT e0[4];
+		UINT e1[4];
+
+		for (UINT c = 0; c < 4; ++c)
+		{
+			e0[c] = (candidate.m_endpoints[0][c] << 1) | candidate.m_pBits[0];
+			e1[c] = (candidate.m_endpoints[1][c] << 1) | candidate.m_pBits[1];
+		}
+
+		float palette[16][4];
+
+		for (UINT i = 0; i < 16; ++i)
+		{
+			for (UINT c = 0; c < 4; ++c)
+			{
+				palette[i][c] = static_cast<float>(bc7Interpolate(e0[c], e1[c], c_bc7Weights4[i]));
+			}
+		}
+
+		const float weights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		const float texelWeights[c_bcBlockTexels] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+		float errors[c_bcBlockTexels];
+
+		selectIndices(texels, palette, 16, weights, candidate.m_indices, errors);
+		candidate.m_error = sumErrors(errors, texelWeights);
+	}
+
+	// writes fields least significant bit first, the way every BC7 block is laid out
+	struct BitWriter
+	{
+		UINT8 * m_block;
+		UINT m_position;
+
+		void write(const UINT value, const UINT bits)
+		{
+			for (UINT i = 0; i < bits; ++i, ++m_position)
+			{
+				if ((value >> i) & 1)
+				{
+					m_block[m_position >> 3] |= static_cast<UINT8>(1 << (m_position & 7));
+				}
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const UINT8 * m_block;
+		UINT m_position;
+
+		UINT read(const UINT bits)
+		{
+			UINT value = 0;
+
+			for (UINT i = 0; i < bits; ++i, ++m_position)
+			{
+				value |= ((m_block[m_position >> 3] >> (m_position & 7)) & 1u) << i;
+			}
+
+			return value;
+		}
+	};
+}
+
+void encodeBc1Block(const UINT8 * rgba, UINT8 * block)
+{
+	encodeColourBlock(rgba, true, block);
+}
+
+void encodeBc3Block(const UINT8 * rgba, UINT8 * block)
+{
+	encodeBc4Block(rgba, 3, block);
+	encodeColourBlock(rgba, false, block + c_bc4BlockBytes);
+}
+
+void encodeBc4Block(const UINT8 * rgba, const UINT channel, UINT8 * block)
+{
+	BlockTexels texels;
+	UINT minimum = 255;
+	UINT maximum = 0;
+
+	for (UINT t = 0; t < c_bcBlockTexels; ++t)
+	{
+		const UINT value = rgba[t * 4 + channel];
+		minimum = std::min(minimum, value);
+		maximum = std::max(maximum, value);
+
+		texels.m_channels[0][t] = static_cast<float>(value);
+		texels.m_channels[1][t] = 0.0f;
+		texels.m_channels[2][t] = 0.0f;
+		texels.m_channels[3][t] = 0.0f;
+	}
+
+	UINT8 indices[c_bcBlockTexels] = {};
+
+	// a0 > a1 picks the eight value mode, equal endpoints leave every index on 0
+	block[0] = static_cast<UINT8>(maximum);
+	block[1] = static_cast<UINT8>(minimum);
+
+	if (maximum != minimum)
+	{
+		float palette[8][4] = {};
+		palette[0][0] = static_cast<float>(maximum);
+		palette[1][0] = static_cast<float>(minimum);
+
+		for (UINT i = 2; i < 8; ++i)
+		{
+			palette[i][0] = static_cast<float>(((8 - i) * maximum + (i - 1) * minimum) / 7);
+		}
+
+		const float weights[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+		float errors[c_bcBlockTexels];
+		selectIndices(texels, palette, 8, weights, indices, errors);
+	}
+
+	UINT64 indexBits = 0;
+
+	for (UINT t = 0; t < c_bcBlockTexels; ++t)
+	{
+		indexBits |= static_cast<UINT64>(indices[t]) << (t * 3);
+	}
+
+	for (UINT i = 0; i < 6; ++i)
+	{
+		block[2 + i] = static_cast<UINT8>(indexBits >> (i * 8));
+	}
+}
+
+void encodeBc5Block(const UINT8 * rgba, UINT8 * block)
+{
+	encodeBc4Block(rgba, 0, block);
+	encodeBc4Block(rgba, 1, block + c_bc4BlockBytes);
+}
+
+void encodeBc7Block(const UINT8 * rgba, UINT8 * block)
+{
+	BlockTexels texels;
+	loadBlock(rgba, texels);
+
+	const float texelWeights[c_bcBlockTexels] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+	float endpoint0[4];
+	float endpoint1[4];
+	fitEndpoints(texels, texelWeights, 4, endpoint0, endpoint1);
+
+	Bc7Candidate best;
+	evaluateBc7(texels, endpoint0, endpoint1, best);
+
+	float indexWeights[16];
+
+	for (UINT i = 0; i < 16; ++i)
+	{
+		indexWeights[i] = static_cast<float>(c_bc7Weights4[i]) / 64.0f;
+	}
+
+	if (refineEndpoints(texels, texelWeights, 4, best.m_indices, indexWeights, endpoint0, endpoint1))
+	{
+		Bc7Candidate refined;
+		evaluateBc7(texels, endpoint0, endpoint1, refined);
+
+		if (refined.m_error < best.m_error)
+		{
+			best = refined;
+		}
+	}
+
+	// the first index is stored with its top bit implied zero, flip the endpoints if it is set
+	if (best.m_indices[0] >= 8)
+	{
+		for (UINT c = 0; c < 4; ++c)
+		{
+			std::swap(best.m_endpoints[0][c], best.m_endpoints[1][c]);
+		}
+
+		std::swap(best.m_pBits[0], best.m_pBits[1]);
+
+		for (UINT t = 0; t < c_bcBlockTexels; ++t)
+		{
+			best.m_indices[t] = static_cast<UINT8>(15 - best.m_indices[t]);
+		}
+	}
+
+	memset(block, 0, c_bc7BlockBytes);
+
+	BitWriter writer = { block, 0 };
+	writer.write(1 << 6, 7); // mode 6
+
+	for (UINT c = 0; c < 4; ++c)
+	{
+		writer.write(best.m_endpoints[0][c], 7);
+		writer.write(best.m_endpoints[1][c], 7);
+	}
+
+	writer.write(best.m_pBits[0], 1);
+	writer.write(best.m_pBits[1], 1);
+
+	for (UINT t = 0; t < c_bcBlockTexels; ++t)
+	{
+		writer.write(best.m_indices[t], t == 0 ? 3 : 4);
+	}
+}
+
+void decodeBc1Block(const UINT8 * block, UINT8 * rgba)
+{
+	decodeColourBlock(block, false, rgba);
+}
+
+void decodeBc3Block(const UINT8 * block, UINT8 * rgba)
+{
+	decodeColourBlock(block + c_bc4BlockBytes, true, rgba);
+	decodeBc4Block(block, 3, rgba);
+}
+
+void decodeBc4Block(const UINT8 * block, const UINT channel, UINT8 * rgba)
+{
+	const UINT a0 = block[0];
+	const UINT a1 = block[1];
+
+	UINT palette[8];
+	palette[0] = a0;
+	palette[1] = a1;
+
+	if (a0 > a1)
+	{
+		for (UINT i = 2; i < 8; ++i)
+		{
+			palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+		}
+	}
+	else
+	{
+		for (UINT i = 2; i < 6; ++i)
+		{
+			palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+		}
+
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	UINT64 indexBits = 0;
+
+	for (UINT i = 0; i < 6; ++i)
+	{
+		indexBits |= static_cast<UINT64>(block[2 + i]) << (i * 8);
+	}
+
+	for (UINT t = 0; t < c_bcBlockTexels; ++t)
+	{
+		rgba[t * 4 + channel] = static_cast<UINT8>(palette[(indexBits >> (t * 3)) & 7]);
+	}
+}
+
+void decodeBc5Block(const UINT8 * block, UINT8 * rgba)
+{
+	decodeBc4Block(block, 0, rgba);
+	decodeBc4Block(block + c_bc4BlockBytes, 1, rgba);
+
+	for (UINT t = 0; t < c_bcBlockTexels; ++t)
+	{
+		rgba[t * 4 + 2] = 0;
+		rgba[t * 4 + 3] = 255;
+	}
+}
+
+void decodeBc7Block(const UINT8 * block, UINT8 * rgba)
+{
+	BitReader reader = { block, 0 };
+
+	if (reader.read(7) != (1 << 6))
+	{
+		memset(rgba, 0, c_bcBlockTexels * 4);
+		return;
+	}
+
+	UINT endpoints[2][4];
+
+	for (UINT c = 0; c < 4; ++c)
+	{
+		endpoints[0][c] = reader.read(7);
+		endpoints[1][c] = reader.read(7);
+	}
+
+	const UINT p0 = reader.read(1);
+	const UINT p1 = reader.read(1);
+
+	for (UINT c = 0; c < 4; ++c)
+	{
+		endpoints[0][c] = (endpoints[0][c] << 1) | p0;
+		endpoints[1][c] = (endpoints[1][c] << 1) | p1;
+	}
+
+	for (UINT t = 0; t < c_bcBlockTexels; ++t)
+	{
+		const UINT index = reader.read(t == 0 ? 3 : 4);
+
+		for (UINT c = 0; c < 4; ++c)
+		{
+			rgba[t * 4 + c] = static_cast<UINT8>(bc7Interpolate(endpoints[0][c], endpoints[1][c], c_bc7Weights4[index]));
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#ifndef _BLOCK_COMPRESSION_H_
+#define _BLOCK_COMPRESSION_H_
+
+#include <Windows.h>
+
+// 4x4 block encoders for the BCn formats. every encoder takes the 16 texels of a block as RGBA8, row by row.
+// the palette search is SSE2 where it is available, four texels at a time
+const UINT c_bcBlockTexels = 16;
+const UINT c_bc1BlockBytes = 8;
+const UINT c_bc3BlockBytes = 16;
+const UINT c_bc4BlockBytes = 8;
+const UINT c_bc5BlockBytes = 16;
+const UINT c_bc7BlockBytes = 16;
+
+// rgb, texels with alpha under 128 use the punch through transparent index
+void encodeBc1Block(const UINT8 * rgba, UINT8 * block);
+// rgb as BC1 plus an interpolated alpha block
+void encodeBc3Block(const UINT8 * rgba, UINT8 * block);
+// one channel, channel is the offset into each RGBA texel
+void encodeBc4Block(const UINT8 * rgba, const UINT channel, UINT8 * block);
+// red and green as two BC4 blocks, for tangent space normal maps
+void encodeBc5Block(const UINT8 * rgba, UINT8 * block);
+// mode 6 only, one subset with 7 bit rgba endpoints and 4 bit indices. it is the mode that copes best with
+// smooth colour and alpha together, and a single mode keeps the encoder fast enough to run on every mip
+void encodeBc7Block(const UINT8 * rgba, UINT8 * block);
+
+// decoders, used to measure the encoders. BC7 only understands mode 6 and decodes anything else to zero
+void decodeBc1Block(const UINT8 * block, UINT8 * rgba);
+void decodeBc3Block(const UINT8 * block, UINT8 * rgba);
+void decodeBc4Block(const UINT8 * block, const UINT channel, UINT8 * rgba);
+void decodeBc5Block(const UINT8 * block, UINT8 * rgba);
+void decodeBc7Block(const UINT8 * block, UINT8 * rgba);
+
+#endif // _BLOCK_COMPRESSION_H_
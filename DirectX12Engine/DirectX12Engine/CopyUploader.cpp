@@ -0,0 +1,153 @@
+#include "CopyUploader.h"
+
+#include <algorithm>
+#include <cassert>
+
+CopyUploader::CopyUploader(CopyQueueBackend * backend)
+	: m_backend(backend)
+	, m_maxBatchBytes(16 * 1024 * 1024)
+	, m_maxBatchRequests(256)
+	, m_nextTicket(1)
+	, m_lastSubmittedTicket(0)
+	, m_completedFenceValue(0)
+	, m_submittedBatches(0)
+{
+	assert(m_backend);
+}
+
+CopyUploader::~CopyUploader()
+{
+
+}
+
+void CopyUploader::setBatchLimits(const UINT64 maxBatchBytes, const UINT maxBatchRequests)
+{
+	m_maxBatchBytes = maxBatchBytes;
+	m_maxBatchRequests = std::max(maxBatchRequests, 1u);
+}
+
+UploadTicket CopyUploader::enqueue(UploadRequest && request)
+{
+	std::lock_guard<std::mutex> lock(m_pendingMutex);
+
+	m_pending.push_back(std::move(request));
+	return m_nextTicket++;
+}
+
+void CopyUploader::flush()
+{
+	std::lock_guard<std::mutex> submitLock(m_submitMutex);
+
+	// take the pending requests while holding the submit lock, so a second flush can't
+	// submit later tickets before these and break the ticket order
+	std::vector<UploadRequest> requests;
+	{
+		std::lock_guard<std::mutex> pendingLock(m_pendingMutex);
+		requests.swap(m_pending);
+	}
+
+	std::vector<UploadRequest> batch;
+	UINT64 batchBytes = 0;
+
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		const UINT64 requestBytes = requests[i].getUploadSize();
+
+		const bool overBytes = !batch.empty() && batchBytes + requestBytes > m_maxBatchBytes;
+		const bool overCount = batch.size() >= m_maxBatchRequests;
+
+		if (overBytes || overCount)
+		{
+			submitBatch(batch, batchBytes);
+			batch.clear();
+			batchBytes = 0;
+		}
+
+		batch.push_back(std::move(requests[i]));
+		batchBytes += requestBytes;
+	}
+
+	if (!batch.empty())
+	{
+		submitBatch(batch, batchBytes);
+	}
+}
+
+void CopyUploader::submitBatch(const std::vector<UploadRequest> & batch, const UINT64 batchBytes)
+{
+	InFlightBatch inFlight;
+	inFlight.m_fenceValue = m_backend->submitBatch(batch, batchBytes);
+	inFlight.m_firstTicket = m_lastSubmittedTicket + 1;
+	inFlight.m_lastTicket = m_lastSubmittedTicket + batch.size();
+
+	m_lastSubmittedTicket = inFlight.m_lastTicket;
+	m_inFlight.push_back(inFlight);
+	++m_submittedBatches;
+}
+
+UINT64 CopyUploader::requiredFenceValue(const UploadTicket ticket)
+{
+	if (ticket == 0)
+	{
+		return 0;
+	}
+
+	bool needsFlush = false;
+	{
+		std::lock_guard<std::mutex> submitLock(m_submitMutex);
+		needsFlush = ticket > m_lastSubmittedTicket;
+	}
+
+	if (needsFlush)
+	{
+		flush();
+	}
+
+	std::lock_guard<std::mutex> submitLock(m_submitMutex);
+
+	// the first batch whose range reaches the ticket is the one that carries it
+	auto batch = std::lower_bound(m_inFlight.begin(), m_inFlight.end(), ticket,
+		[](const InFlightBatch & inFlight, const UploadTicket t) { return inFlight.m_lastTicket < t; });
+
+	if (batch == m_inFlight.end() || ticket < batch->m_firstTicket)
+	{
+		// its batch was retired
+		return 0;
+	}
+
+	if (batch->m_fenceValue <= m_completedFenceValue)
+	{
+		return 0;
+	}
+
+	m_completedFenceValue = std::max(m_completedFenceValue, m_backend->getCompletedFenceValue());
+
+	return batch->m_fenceValue <= m_completedFenceValue ? 0 : batch->m_fenceValue;
+}
+
+bool CopyUploader::isComplete(const UploadTicket ticket)
+{
+	{
+		std::lock_guard<std::mutex> submitLock(m_submitMutex);
+
+		if (ticket > m_lastSubmittedTicket)
+		{
+			// still queued, don't force a submit just to answer this
+			return false;
+		}
+	}
+
+	return requiredFenceValue(ticket) == 0;
+}
+
+void CopyUploader::retireCompleted()
+{
+	std::lock_guard<std::mutex> submitLock(m_submitMutex);
+
+	m_completedFenceValue = std::max(m_completedFenceValue, m_backend->getCompletedFenceValue());
+
+	while (!m_inFlight.empty() && m_inFlight.front().m_fenceValue <= m_completedFenceValue)
+	{
+		m_inFlight.pop_front();
+	}
+}
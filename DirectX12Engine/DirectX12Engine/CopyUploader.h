@@ -0,0 +1,131 @@
+#pragma once
+#ifndef _COPY_UPLOADER_H_
+#define _COPY_UPLOADER_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <d3d12.h>
+
+// identifies one upload, 0 is never handed out so it can mean "nothing to wait on"
+typedef UINT64 UploadTicket;
+
+struct UploadRequest
+{
+	UploadRequest()
+		: m_destination(nullptr)
+		, m_destinationOffset(0)
+		, m_isTexture(false)
+		, m_subresource(0)
+		, m_footprint()
+		, m_source(nullptr)
+		, m_sourceRowPitch(0)
+		, m_sourceRowCount(0)
+	{
+
+	}
+
+	// bytes this request takes in the staging buffer
+	UINT64 getUploadSize() const
+	{
+		if (m_source == nullptr)
+		{
+			return m_data.size();
+		}
+
+		return static_cast<UINT64>(m_isTexture ? m_footprint.RowPitch : m_sourceRowPitch) * m_sourceRowCount;
+	}
+
+	ID3D12Resource* m_destination;	// buffer or texture in a default heap, left in the common state
+	UINT64 m_destinationOffset;		// buffers only
+	std::vector<UINT8> m_data;
+
+	// textures go one subresource per request, m_data is laid out as m_footprint says (rows padded to RowPitch)
+	bool m_isTexture;
+	UINT m_subresource;
+	D3D12_SUBRESOURCE_FOOTPRINT m_footprint;
+
+	// instead of m_data, rows are copied straight from memory something else owns (a mapped file) into the
+	// staging buffer, each row spread out to the footprint's RowPitch for textures. m_sourceOwner keeps that
+	// memory alive until the batch has been written
+	const UINT8* m_source;
+	UINT m_sourceRowPitch;
+	UINT m_sourceRowCount;
+	std::shared_ptr<const void> m_sourceOwner;
+};
+
+// the part that talks to the GPU, split out so the batching and fence tracking can run against a fake
+class CopyQueueBackend
+{
+public:
+	virtual ~CopyQueueBackend() {}
+
+	// records the whole batch into one copy command list, executes it and signals the copy fence.
+	// returns the fence value that was signalled
+	virtual UINT64 submitBatch(const std::vector<UploadRequest> & batch, const UINT64 batchBytes) = 0;
+	virtual UINT64 getCompletedFenceValue() = 0;
+};
+
+// takes uploads from any thread and hands them to the copy queue in batches.
+// the render thread asks for the fence value a draw depends on, so the direct queue only waits
+// on the copy queue when it is about to use data that might not be there yet.
+class CopyUploader
+{
+public:
+	CopyUploader(CopyQueueBackend * backend);
+	~CopyUploader();
+
+	// a batch is closed once it would go over either limit, a single request bigger than
+	// maxBatchBytes still goes through on its own
+	void setBatchLimits(const UINT64 maxBatchBytes, const UINT maxBatchRequests);
+
+	// safe from any thread
+	UploadTicket enqueue(UploadRequest && request);
+
+	// submits everything enqueued so far, render thread only
+	void flush();
+
+	// the copy fence value the direct queue has to wait for before reading this upload,
+	// 0 when the copy has already finished. submits the upload first if it is still queued
+	UINT64 requiredFenceValue(const UploadTicket ticket);
+	bool isComplete(const UploadTicket ticket);
+
+	// drops the bookkeeping for batches the GPU has finished with
+	void retireCompleted();
+
+	UINT64 getSubmittedBatchCount() const { return m_submittedBatches; }
+	size_t getInFlightBatchCount() const { return m_inFlight.size(); }
+
+private:
+
+	// hands one batch to the backend, m_submitMutex must be held
+	void submitBatch(const std::vector<UploadRequest> & batch, const UINT64 batchBytes);
+
+	struct InFlightBatch
+	{
+		UploadTicket m_firstTicket;
+		UploadTicket m_lastTicket;
+		UINT64 m_fenceValue;
+	};
+
+	CopyQueueBackend * m_backend;
+
+	UINT64 m_maxBatchBytes;
+	UINT m_maxBatchRequests;
+
+	// enqueue side
+	std::mutex m_pendingMutex;
+	std::vector<UploadRequest> m_pending;
+	UploadTicket m_nextTicket;
+
+	// submit side, tickets are handed to the backend in order so each batch is a ticket range
+	std::mutex m_submitMutex;
+	std::deque<InFlightBatch> m_inFlight;
+	UploadTicket m_lastSubmittedTicket;
+	UINT64 m_completedFenceValue;
+	UINT64 m_submittedBatches;
+};
+
+#endif // _COPY_UPLOADER_H_
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef _DDS_FORMAT_H_
+#define _DDS_FORMAT_H_
+
+#include <Windows.h>
+
+// the on disk layout of a .dds file: magic, DdsHeader, DdsHeaderDx10 when the four cc is "DX10", then every
+// mip of every array slice back to back, each a tightly packed run of block rows
+const UINT32 c_ddsMagic = 0x20534444; // "DDS "
+const UINT32 c_ddsFourCcDx10 = 0x30315844; // "DX10"
+
+// legacy four ccs older tools still write instead of a DX10 header
+const UINT32 c_ddsFourCcDxt1 = 0x31545844; // "DXT1"
+const UINT32 c_ddsFourCcDxt3 = 0x33545844; // "DXT3"
+const UINT32 c_ddsFourCcDxt5 = 0x35545844; // "DXT5"
+const UINT32 c_ddsFourCcAti1 = 0x31495441; // "ATI1"
+const UINT32 c_ddsFourCcBc4u = 0x55344342; // "BC4U"
+const UINT32 c_ddsFourCcAti2 = 0x32495441; // "ATI2"
+const UINT32 c_ddsFourCcBc5u = 0x55354342; // "BC5U"
+
+const UINT32 c_ddsFlagCaps = 0x1;
+const UINT32 c_ddsFlagHeight = 0x2;
+const UINT32 c_ddsFlagWidth = 0x4;
+const UINT32 c_ddsFlagPixelFormat = 0x1000;
+const UINT32 c_ddsFlagMipMapCount = 0x20000;
+const UINT32 c_ddsFlagLinearSize = 0x80000;
+
+const UINT32 c_ddsPixelFormatAlphaPixels = 0x1;
+const UINT32 c_ddsPixelFormatFourCc = 0x4;
+const UINT32 c_ddsPixelFormatRgb = 0x40;
+
+const UINT32 c_ddsCapsComplex = 0x8;
+const UINT32 c_ddsCapsTexture = 0x1000;
+const UINT32 c_ddsCapsMipMap = 0x400000;
+
+const UINT32 c_ddsCaps2Cubemap = 0x200;
+const UINT32 c_ddsCaps2Volume = 0x200000;
+
+const UINT32 c_ddsDimensionTexture2D = 3;
+const UINT32 c_ddsMiscTextureCube = 0x4;
+
+struct DdsPixelFormat
+{
+	UINT32 m_size;
+	UINT32 m_flags;
+	UINT32 m_fourCc;
+	UINT32 m_rgbBitCount;
+	UINT32 m_rBitMask;
+	UINT32 m_gBitMask;
+	UINT32 m_bBitMask;
+	UINT32 m_aBitMask;
+};
+
+struct DdsHeader
+{
+	UINT32 m_size;
+	UINT32 m_flags;
+	UINT32 m_height;
+	UINT32 m_width;
+	UINT32 m_pitchOrLinearSize;
+	UINT32 m_depth;
+	UINT32 m_mipMapCount;
+	UINT32 m_reserved1[11];
+	DdsPixelFormat m_pixelFormat;
+	UINT32 m_caps;
+	UINT32 m_caps2;
+	UINT32 m_caps3;
+	UINT32 m_caps4;
+	UINT32 m_reserved2;
+};
+
+struct DdsHeaderDx10
+{
+	UINT32 m_dxgiFormat;
+	UINT32 m_resourceDimension;
+	UINT32 m_miscFlag;
+	UINT32 m_arraySize;
+	UINT32 m_miscFlags2;
+};
+
+static_assert(sizeof(DdsPixelFormat) == 32, "DdsPixelFormat has to match the file layout");
+static_assert(sizeof(DdsHeader) == 124, "DdsHeader has to match the file layout");
+static_assert(sizeof(DdsHeaderDx10) == 20, "DdsHeaderDx10 has to match the file layout");
+
+#endif // _DDS_FORMAT_H_
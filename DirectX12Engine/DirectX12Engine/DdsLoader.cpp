@@ -0,0 +1,312 @@
+#include "DdsLoader.h"
+
+#include "DdsFormat.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	UINT64 alignUp(const UINT64 value, const UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	DXGI_FORMAT formatFromFourCc(const UINT32 fourCc)
+	{
+		switch (fourCc)
+		{
+		case c_ddsFourCcDxt1: return DXGI_FORMAT_BC1_UNORM;
+		case c_ddsFourCcDxt3: return DXGI_FORMAT_BC2_UNORM;
+		case c_ddsFourCcDxt5: return DXGI_FORMAT_BC3_UNORM;
+		case c_ddsFourCcAti1: return DXGI_FORMAT_BC4_UNORM;
+		case c_ddsFourCcBc4u: return DXGI_FORMAT_BC4_UNORM;
+		case c_ddsFourCcAti2: return DXGI_FORMAT_BC5_UNORM;
+		case c_ddsFourCcBc5u: return DXGI_FORMAT_BC5_UNORM;
+		default: return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	DXGI_FORMAT formatFromMasks(const DdsPixelFormat & pixelFormat)
+	{
+		if (!(pixelFormat.m_flags & c_ddsPixelFormatRgb) || pixelFormat.m_rgbBitCount != 32)
+		{
+			return DXGI_FORMAT_UNKNOWN;
+		}
+
+		if (pixelFormat.m_rBitMask == 0x000000ff && pixelFormat.m_gBitMask == 0x0000ff00 && pixelFormat.m_bBitMask == 0x00ff0000)
+		{
+			return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+
+		if (pixelFormat.m_rBitMask == 0x00ff0000 && pixelFormat.m_gBitMask == 0x0000ff00 && pixelFormat.m_bBitMask == 0x000000ff)
+		{
+			return DXGI_FORMAT_B8G8R8A8_UNORM;
+		}
+
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	// size of one mip in the file, which is the rows without any padding
+	void mipFileSize(const UINT width, const UINT height, const UINT bytesPerElement, const bool blockCompressed, UINT & rowPitch, UINT & rowCount)
+	{
+		if (blockCompressed)
+		{
+			rowPitch = ((width + 3) / 4) * bytesPerElement;
+			rowCount = (height + 3) / 4;
+		}
+		else
+		{
+			rowPitch = width * bytesPerElement;
+			rowCount = height;
+		}
+	}
+}
+
+bool ddsFormatInfo(const DXGI_FORMAT format, UINT & bytesPerElement, bool & blockCompressed)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		bytesPerElement = 8;
+		blockCompressed = true;
+		return true;
+
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		bytesPerElement = 16;
+		blockCompressed = true;
+		return true;
+
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		bytesPerElement = 4;
+		blockCompressed = false;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool computeCopyableFootprints(DdsTextureLayout & layout)
+{
+	UINT bytesPerElement = 0;
+	bool blockCompressed = false;
+
+	if (!ddsFormatInfo(layout.m_format, bytesPerElement, blockCompressed))
+	{
+		return false;
+	}
+
+	layout.m_subresources.resize(static_cast<size_t>(layout.m_mipCount) * layout.m_arraySize);
+	layout.m_totalUploadBytes = 0;
+
+	UINT64 offset = 0;
+
+	for (UINT slice = 0; slice < layout.m_arraySize; ++slice)
+	{
+		for (UINT mip = 0; mip < layout.m_mipCount; ++mip)
+		{
+			DdsSubresourceLayout & subresource = layout.m_subresources[slice * layout.m_mipCount + mip];
+
+			const UINT width = std::max(layout.m_width >> mip, 1u);
+			const UINT height = std::max(layout.m_height >> mip, 1u);
+
+			UINT tightRowPitch = 0;
+			UINT rowCount = 0;
+			mipFileSize(width, height, bytesPerElement, blockCompressed, tightRowPitch, rowCount);
+
+			// every subresource starts on a 512 byte boundary and every row on a 256 byte one.
+			// the copy works in whole blocks so compressed sizes round up to a multiple of 4
+			offset = alignUp(offset, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+			subresource.m_placed.Offset = offset;
+			subresource.m_placed.Footprint.Format = layout.m_format;
+			subresource.m_placed.Footprint.Width = blockCompressed ? static_cast<UINT>(alignUp(width, 4)) : width;
+			subresource.m_placed.Footprint.Height = blockCompressed ? static_cast<UINT>(alignUp(height, 4)) : height;
+			subresource.m_placed.Footprint.Depth = 1;
+			subresource.m_placed.Footprint.RowPitch = static_cast<UINT>(alignUp(tightRowPitch, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT));
+			subresource.m_numRows = rowCount;
+			subresource.m_rowSizeInBytes = tightRowPitch;
+
+			// the total doesn't pad the very last row
+			layout.m_totalUploadBytes = offset + static_cast<UINT64>(subresource.m_placed.Footprint.RowPitch) * (rowCount - 1) + tightRowPitch;
+			offset += static_cast<UINT64>(subresource.m_placed.Footprint.RowPitch) * rowCount;
+		}
+	}
+
+	return true;
+}
+
+bool parseDds(const UINT8 * data, const size_t size, DdsTextureLayout & layout)
+{
+	if (data == nullptr || size < sizeof(c_ddsMagic) + sizeof(DdsHeader))
+	{
+		return false;
+	}
+
+	UINT32 magic;
+	DdsHeader header;
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&header, data + sizeof(magic), sizeof(header));
+
+	if (magic != c_ddsMagic || header.m_size != sizeof(DdsHeader) || header.m_pixelFormat.m_size != sizeof(DdsPixelFormat))
+	{
+		return false;
+	}
+
+	if (header.m_caps2 & (c_ddsCaps2Cubemap | c_ddsCaps2Volume))
+	{
+		return false;
+	}
+
+	UINT64 dataOffset = sizeof(magic) + sizeof(header);
+	layout.m_arraySize = 1;
+	layout.m_format = DXGI_FORMAT_UNKNOWN;
+
+	if ((header.m_pixelFormat.m_flags & c_ddsPixelFormatFourCc) && header.m_pixelFormat.m_fourCc == c_ddsFourCcDx10)
+	{
+		if (size < dataOffset + sizeof(DdsHeaderDx10))
+		{
+			return false;
+		}
+
+		DdsHeaderDx10 dx10;
+		memcpy(&dx10, data + dataOffset, sizeof(dx10));
+		dataOffset += sizeof(dx10);
+
+		if (dx10.m_resourceDimension != c_ddsDimensionTexture2D || (dx10.m_miscFlag & c_ddsMiscTextureCube)
+			|| dx10.m_arraySize == 0 || dx10.m_arraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+		{
+			return false;
+		}
+
+		layout.m_format = static_cast<DXGI_FORMAT>(dx10.m_dxgiFormat);
+		layout.m_arraySize = dx10.m_arraySize;
+	}
+	else if (header.m_pixelFormat.m_flags & c_ddsPixelFormatFourCc)
+	{
+		layout.m_format = formatFromFourCc(header.m_pixelFormat.m_fourCc);
+	}
+	else
+	{
+		layout.m_format = formatFromMasks(header.m_pixelFormat);
+	}
+
+	UINT bytesPerElement = 0;
+	bool blockCompressed = false;
+
+	if (!ddsFormatInfo(layout.m_format, bytesPerElement, blockCompressed))
+	{
+		return false;
+	}
+
+	if (header.m_width == 0 || header.m_height == 0 || header.m_width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || header.m_height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+	{
+		return false;
+	}
+
+	UINT fullChain = 1;
+
+	while ((std::max(header.m_width, header.m_height) >> fullChain) > 0)
+	{
+		++fullChain;
+	}
+
+	layout.m_width = header.m_width;
+	layout.m_height = header.m_height;
+	// some writers leave the count at 0 for a single level
+	layout.m_mipCount = std::max(header.m_mipMapCount, 1u);
+
+	if (layout.m_mipCount > fullChain)
+	{
+		return false;
+	}
+
+	if (!computeCopyableFootprints(layout))
+	{
+		return false;
+	}
+
+	// file side of the layout, every mip of a slice back to back
+	UINT64 fileOffset = dataOffset;
+
+	for (size_t i = 0; i < layout.m_subresources.size(); ++i)
+	{
+		DdsSubresourceLayout & subresource = layout.m_subresources[i];
+		const UINT mip = static_cast<UINT>(i % layout.m_mipCount);
+
+		UINT rowCount = 0;
+		mipFileSize(std::max(layout.m_width >> mip, 1u), std::max(layout.m_height >> mip, 1u), bytesPerElement, blockCompressed,
+			subresource.m_fileRowPitch, rowCount);
+
+		subresource.m_fileOffset = fileOffset;
+		fileOffset += static_cast<UINT64>(subresource.m_fileRowPitch) * rowCount;
+	}
+
+	return fileOffset <= size;
+}
+
+bool ddsMipRange(const DdsTextureLayout & layout, const UINT firstMip, DdsTextureLayout & range)
+{
+	if (firstMip >= layout.m_mipCount)
+	{
+		return false;
+	}
+
+	UINT bytesPerElement = 0;
+	bool blockCompressed = false;
+
+	if (!ddsFormatInfo(layout.m_format, bytesPerElement, blockCompressed))
+	{
+		return false;
+	}
+
+	const UINT width = std::max(layout.m_width >> firstMip, 1u);
+	const UINT height = std::max(layout.m_height >> firstMip, 1u);
+
+	// D3D12 only takes a BC texture whose top level is whole blocks, the smaller mips can be partial
+	if (blockCompressed && !ddsIsBlockAligned(width, height))
+	{
+		return false;
+	}
+
+	range.m_format = layout.m_format;
+	range.m_width = width;
+	range.m_height = height;
+	range.m_mipCount = layout.m_mipCount - firstMip;
+	range.m_arraySize = layout.m_arraySize;
+
+	if (!computeCopyableFootprints(range))
+	{
+		return false;
+	}
+
+	for (UINT slice = 0; slice < range.m_arraySize; ++slice)
+	{
+		for (UINT mip = 0; mip < range.m_mipCount; ++mip)
+		{
+			const DdsSubresourceLayout & source = layout.m_subresources[slice * layout.m_mipCount + firstMip + mip];
+			DdsSubresourceLayout & subresource = range.m_subresources[slice * range.m_mipCount + mip];
+
+			subresource.m_fileOffset = source.m_fileOffset;
+			subresource.m_fileRowPitch = source.m_fileRowPitch;
+		}
+	}
+
+	return true;
+}
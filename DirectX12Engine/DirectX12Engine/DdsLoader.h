@@ -0,0 +1,54 @@
+#pragma once
+#ifndef _DDS_LOADER_H_
+#define _DDS_LOADER_H_
+
+#include <vector>
+
+#include <d3d12.h>
+
+// where one subresource's data sits in the file and where it has to go in upload memory
+struct DdsSubresourceLayout
+{
+	UINT64 m_fileOffset;		// from the start of the file, rows are tightly packed
+	UINT m_fileRowPitch;
+
+	// the same thing GetCopyableFootprints hands back, offset is from the start of the texture's upload data
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT m_placed;
+	UINT m_numRows;				// block rows for compressed formats
+	UINT64 m_rowSizeInBytes;
+};
+
+struct DdsTextureLayout
+{
+	DXGI_FORMAT m_format;
+	UINT m_width;
+	UINT m_height;
+	UINT m_mipCount;
+	UINT m_arraySize;
+
+	// slice major then mip, the same order as D3D12 subresource indices
+	std::vector<DdsSubresourceLayout> m_subresources;
+	UINT64 m_totalUploadBytes;
+};
+
+// bytes per 4x4 block for the BC formats, per texel otherwise. false for formats the loader doesn't know
+bool ddsFormatInfo(const DXGI_FORMAT format, UINT & bytesPerElement, bool & blockCompressed);
+
+// fills in m_placed, m_numRows, m_rowSizeInBytes and m_totalUploadBytes for the format, size, mips and array size
+// already in the layout, matching ID3D12Device::GetCopyableFootprints with a base offset of 0.
+// pure arithmetic so it can run without a device and be checked against the real thing
+bool computeCopyableFootprints(DdsTextureLayout & layout);
+
+// 2D textures and texture arrays, with a DX10 header or one of the DXTn/ATIn four ccs or 32 bit RGBA masks.
+// nothing is copied, the layout points into data. false for cubes, volumes, unknown formats or a short file
+bool parseDds(const UINT8 * data, const size_t size, DdsTextureLayout & layout);
+
+// whether a BC texture can start at this size, both sides a multiple of the 4x4 block
+inline bool ddsIsBlockAligned(const UINT width, const UINT height) { return width % 4 == 0 && height % 4 == 0; }
+
+// the same texture without its mips above firstMip, for streaming. the footprints are worked out again for the
+// smaller chain and the file offsets still point at the original mips. false when firstMip of a BC format isn't
+// block aligned
+bool ddsMipRange(const DdsTextureLayout & layout, const UINT firstMip, DdsTextureLayout & range);
+
+#endif // _DDS_LOADER_H_
@@ -28,6 +28,71 @@ PSInput VSMain(float4 position : POSITION, float4 color : COLOR)
 	return result;
 }
 
+// bone matrices for the skinned pso, written by the CPU each frame. DirectXMath matrices, so row major
+cbuffer BonePalette : register(b0)
+{
+	row_major float4x4 g_bones[256];
+};
+
+// linear blend skinning, the weights add up to 1 once unpacked
+PSInput VSSkinned(float3 position : POSITION, float4 color : COLOR, uint4 boneIndices : BLENDINDICES, float4 boneWeights : BLENDWEIGHT)
+{
+	float3 skinned = float3(0.0f, 0.0f, 0.0f);
+
+	[unroll]
+	for (uint i = 0; i < 4; ++i)
+	{
+		skinned += boneWeights[i] * mul(float4(position, 1.0f), g_bones[boneIndices[i]]).xyz;
+	}
+
+	PSInput result;
+
+	result.position = float4(skinned, 1.0f);
+	result.color = color;
+
+	return result;
+}
+
+// the same skinning as a compute pass for the async compute queue. SkinnedVertex in, Vertex out, both packed
+ByteAddressBuffer g_bindPose : register(t0);
+RWByteAddressBuffer g_skinned : register(u0);
+
+cbuffer SkinningConstants : register(b1)
+{
+	uint g_vertexCount;
+};
+
+[numthreads(64, 1, 1)]
+void CSSkin(uint3 id : SV_DispatchThreadID)
+{
+	if (id.x >= g_vertexCount)
+	{
+		return;
+	}
+
+	// 36 bytes in, position, colour, then four bone indices and four weights a byte each
+	const uint source = id.x * 36;
+	const float3 position = asfloat(g_bindPose.Load3(source));
+	const float4 color = asfloat(g_bindPose.Load4(source + 12));
+	const uint packedIndices = g_bindPose.Load(source + 28);
+	const uint packedWeights = g_bindPose.Load(source + 32);
+
+	float3 skinned = float3(0.0f, 0.0f, 0.0f);
+
+	[unroll]
+	for (uint i = 0; i < 4; ++i)
+	{
+		const uint bone = (packedIndices >> (i * 8)) & 0xff;
+		const float weight = ((packedWeights >> (i * 8)) & 0xff) / 255.0f;
+		skinned += weight * mul(float4(position, 1.0f), g_bones[bone]).xyz;
+	}
+
+	// 28 bytes out
+	const uint destination = id.x * 28;
+	g_skinned.Store3(destination, asuint(skinned));
+	g_skinned.Store4(destination + 12, asuint(color));
+}
+
 float4 PSMain(PSInput input) : SV_TARGET
 {
 	return input.color;
@@ -0,0 +1,262 @@
+#include "Dx12CopyBackend.h"
+
+#include "d3dx12.h"
+
+Dx12CopyBackend::Dx12CopyBackend()
+	: m_device(nullptr)
+	, m_copyQueue(nullptr)
+	, m_commandList(nullptr)
+	, m_fence(nullptr)
+	, m_nextFenceValue(1)
+	, m_fenceEvent(nullptr)
+{
+
+}
+
+Dx12CopyBackend::~Dx12CopyBackend()
+{
+
+}
+
+HRESULT Dx12CopyBackend::init(const Microsoft::WRL::ComPtr<ID3D12Device> & device)
+{
+	m_device = device;
+
+	D3D12_COMMAND_QUEUE_DESC copyQueueDesc;
+	ZeroMemory(&copyQueueDesc, sizeof(D3D12_COMMAND_QUEUE_DESC));
+	copyQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	copyQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+
+	if (FAILED(m_device->CreateCommandQueue(&copyQueueDesc, IID_PPV_ARGS(&m_copyQueue))))
+	{
+		return E_FAIL;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+
+	if (FAILED(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator))))
+	{
+		return E_FAIL;
+	}
+
+	if (FAILED(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList))))
+	{
+		return E_FAIL;
+	}
+
+	// command lists are created open, it gets reset per batch
+	if (FAILED(m_commandList->Close()))
+	{
+		return E_FAIL;
+	}
+
+	m_freeAllocators.push_back(allocator);
+
+	if (FAILED(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence))))
+	{
+		return E_FAIL;
+	}
+
+	m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	if (m_fenceEvent == nullptr)
+	{
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
+
+void Dx12CopyBackend::shutdown()
+{
+	// wait for the last batch before anything it uses is released
+	if (m_fence && m_fence->GetCompletedValue() < m_nextFenceValue - 1)
+	{
+		if (SUCCEEDED(m_fence->SetEventOnCompletion(m_nextFenceValue - 1, m_fenceEvent)))
+		{
+			WaitForSingleObject(m_fenceEvent, INFINITE);
+		}
+	}
+
+	if (m_fenceEvent)
+	{
+		CloseHandle(m_fenceEvent);
+		m_fenceEvent = nullptr;
+	}
+
+	m_inFlight.clear();
+	m_freeAllocators.clear();
+	m_commandList.Reset();
+	m_fence.Reset();
+	m_copyQueue.Reset();
+	m_device.Reset();
+}
+
+UINT64 Dx12CopyBackend::submitBatch(const std::vector<UploadRequest> & batch, const UINT64 batchBytes)
+{
+	releaseFinishedBatches();
+
+	BatchResources resources;
+
+	if (m_freeAllocators.empty())
+	{
+		if (FAILED(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&resources.m_allocator))))
+		{
+			throw "m_device->CreateCommandAllocator() failed for the copy queue";
+		}
+	}
+	else
+	{
+		resources.m_allocator = m_freeAllocators.back();
+		m_freeAllocators.pop_back();
+
+		if (FAILED(resources.m_allocator->Reset()))
+		{
+			throw "copy queue allocator Reset() failed";
+		}
+	}
+
+	if (FAILED(m_commandList->Reset(resources.m_allocator.Get(), nullptr)))
+	{
+		throw "copy queue command list Reset() failed";
+	}
+
+	// texture data has to start on a 512 byte boundary in the staging buffer, so the batch can be a bit
+	// bigger than batchBytes
+	UINT64 stagingSize = 0;
+
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		stagingSize = alignStagingOffset(stagingSize, batch[i]) + batch[i].getUploadSize();
+	}
+
+	// one staging buffer for the whole batch
+	if (FAILED(m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(stagingSize > 0 ? stagingSize : 1),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&resources.m_staging))))
+	{
+		throw "failed to create the copy queue staging buffer";
+	}
+
+	UINT8* pStaging = nullptr;
+	CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
+
+	if (FAILED(resources.m_staging->Map(0, &readRange, reinterpret_cast<void**>(&pStaging))))
+	{
+		throw "failed to map the copy queue staging buffer";
+	}
+
+	UINT64 stagingOffset = 0;
+
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		const UploadRequest & request = batch[i];
+
+		const UINT64 uploadSize = request.getUploadSize();
+
+		if (uploadSize == 0)
+		{
+			continue;
+		}
+
+		stagingOffset = alignStagingOffset(stagingOffset, request);
+
+		if (request.m_source)
+		{
+			copySourceRows(request, pStaging + stagingOffset);
+		}
+		else
+		{
+			memcpy(pStaging + stagingOffset, request.m_data.data(), request.m_data.size());
+		}
+
+		// resources in the common state are promoted to copy dest on the copy queue and decay back
+		// to common once the batch finishes, so no barriers are needed
+		if (request.m_isTexture)
+		{
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT placed;
+			placed.Offset = stagingOffset;
+			placed.Footprint = request.m_footprint;
+
+			const CD3DX12_TEXTURE_COPY_LOCATION destination(request.m_destination, request.m_subresource);
+			const CD3DX12_TEXTURE_COPY_LOCATION source(resources.m_staging.Get(), placed);
+
+			m_commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+		}
+		else
+		{
+			m_commandList->CopyBufferRegion(request.m_destination, request.m_destinationOffset,
+				resources.m_staging.Get(), stagingOffset, uploadSize);
+		}
+
+		stagingOffset += uploadSize;
+	}
+
+	resources.m_staging->Unmap(0, nullptr);
+
+	if (FAILED(m_commandList->Close()))
+	{
+		throw "Failed to close the copy queue command list";
+	}
+
+	ID3D12CommandList* ppCmdLists[] = { m_commandList.Get() };
+	m_copyQueue->ExecuteCommandLists(1, ppCmdLists);
+
+	resources.m_fenceValue = m_nextFenceValue++;
+
+	if (FAILED(m_copyQueue->Signal(m_fence.Get(), resources.m_fenceValue)))
+	{
+		throw "m_copyQueue->Signal() failed";
+	}
+
+	m_inFlight.push_back(resources);
+
+	return resources.m_fenceValue;
+}
+
+UINT64 Dx12CopyBackend::alignStagingOffset(const UINT64 offset, const UploadRequest & request)
+{
+	if (!request.m_isTexture)
+	{
+		return offset;
+	}
+
+	const UINT64 alignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+void Dx12CopyBackend::copySourceRows(const UploadRequest & request, UINT8 * staging)
+{
+	// the source is the only copy the cpu makes, straight out of the mapping into write combined upload memory
+	if (!request.m_isTexture || request.m_footprint.RowPitch == request.m_sourceRowPitch)
+	{
+		memcpy(staging, request.m_source, static_cast<size_t>(request.m_sourceRowPitch) * request.m_sourceRowCount);
+		return;
+	}
+
+	for (UINT row = 0; row < request.m_sourceRowCount; ++row)
+	{
+		memcpy(staging + static_cast<size_t>(row) * request.m_footprint.RowPitch,
+			request.m_source + static_cast<size_t>(row) * request.m_sourceRowPitch, request.m_sourceRowPitch);
+	}
+}
+
+UINT64 Dx12CopyBackend::getCompletedFenceValue()
+{
+	return m_fence->GetCompletedValue();
+}
+
+void Dx12CopyBackend::releaseFinishedBatches()
+{
+	const UINT64 completed = m_fence->GetCompletedValue();
+
+	while (!m_inFlight.empty() && m_inFlight.front().m_fenceValue <= completed)
+	{
+		m_freeAllocators.push_back(m_inFlight.front().m_allocator);
+		m_inFlight.pop_front();
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef _DX12_COPY_BACKEND_H_
+#define _DX12_COPY_BACKEND_H_
+
+#include <wrl.h>
+
+#include <d3d12.h>
+
+#include <deque>
+#include <vector>
+
+#include "CopyUploader.h"
+
+// records upload batches on a D3D12_COMMAND_LIST_TYPE_COPY queue, so uploads run alongside the direct queue
+class Dx12CopyBackend : public CopyQueueBackend
+{
+public:
+	Dx12CopyBackend();
+	~Dx12CopyBackend();
+
+	HRESULT init(const Microsoft::WRL::ComPtr<ID3D12Device> & device);
+	void shutdown();
+
+	UINT64 submitBatch(const std::vector<UploadRequest> & batch, const UINT64 batchBytes) override;
+	UINT64 getCompletedFenceValue() override;
+
+	// the direct queue waits on this through ID3D12CommandQueue::Wait
+	ID3D12Fence* getFence() { return m_fence.Get(); }
+
+private:
+
+	// a command allocator and staging buffer can only be reused once the batch that used them has finished
+	struct BatchResources
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_allocator;
+		Microsoft::WRL::ComPtr<ID3D12Resource> m_staging;
+		UINT64 m_fenceValue;
+	};
+
+	void releaseFinishedBatches();
+	static UINT64 alignStagingOffset(const UINT64 offset, const UploadRequest & request);
+	static void copySourceRows(const UploadRequest & request, UINT8 * staging);
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_copyQueue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+	UINT64 m_nextFenceValue;
+	HANDLE m_fenceEvent;
+
+	std::deque<BatchResources> m_inFlight;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> m_freeAllocators;
+};
+
+#endif // _DX12_COPY_BACKEND_H_
@@ -2,6 +2,31 @@
 
 #include <d3dcompiler.h>
 
+#include <cassert>
+
+#include "DdsLoader.h"
+
+namespace
+{
+	// shader visible heap for every texture srv, grows in order and is never compacted
+	const UINT c_maxShaderResourceViews = 4096;
+	// root parameter 0, the skinned pso's bone palette
+	const UINT c_bonePaletteRootParameter = 0;
+	// the skinning pass's root signature, everything is a root descriptor so it needs no descriptor heap
+	const UINT c_skinningPaletteRootParameter = 0;
+	const UINT c_skinningBindPoseRootParameter = 1;
+	const UINT c_skinningOutputRootParameter = 2;
+	const UINT c_skinningConstantsRootParameter = 3;
+	// matches numthreads in CSSkin
+	const UINT c_skinningGroupSize = 64;
+	// the scheduler's id for what the skinning pass writes and the frame's command list draws
+	const UINT c_skinnedVerticesPassResource = 0;
+
+	// CSSkin reads and writes both as packed bytes
+	static_assert(sizeof(SkinnedVertex) == 36, "CSSkin expects a 36 byte SkinnedVertex");
+	static_assert(sizeof(Vertex) == 28, "CSSkin writes a 28 byte Vertex");
+}
+
 Dx12Renderer::Dx12Renderer(const UINT width, const UINT height)
 	: m_width(width)
 	, m_height(height)
@@ -9,6 +34,14 @@ Dx12Renderer::Dx12Renderer(const UINT width, const UINT height)
 	, m_useWarpDevice(false)
 	, m_fenceEvent(nullptr)
 	, m_fenceValue(0)
+	, m_uploader(&m_copyBackend)
+	, m_copyFenceToWaitFor(0)
+	, m_copyFenceWaitedFor(0)
+	, m_residency(&m_residencyBackend)
+	, m_resources(m_residency, m_uploader)
+	, m_computeQueue(nullptr)
+	, m_computeFenceToJoin(0)
+	, m_skinningPassAdded(false)
 	, m_dxDeviceAdapter(nullptr)
 	, m_dx12RootSig(nullptr)
 	, m_dx12Device(nullptr)
@@ -18,12 +51,24 @@ Dx12Renderer::Dx12Renderer(const UINT width, const UINT height)
 	, m_dx12CmdAllocator(nullptr)
 	, m_pipelineState(nullptr)
 	, m_commandList(nullptr)
+	, m_computeRootSig(nullptr)
+	, m_skinningPipelineState(nullptr)
+	, m_computeCmdAllocator(nullptr)
+	, m_computeCommandList(nullptr)
 	, m_frameIndex(0)
 	, m_fence(nullptr)
 	, m_rtvDescriptorSize(0)
+	, m_srvDescriptorSize(0)
+	, m_srvCount(0)
 {
 	m_renderTargets[0] = nullptr;
 	m_renderTargets[1] = nullptr;
+
+	for (UINT q = 0; q < QUEUE_COUNT; ++q)
+	{
+		m_passFences[q] = nullptr;
+		m_passFenceBase[q] = 0;
+	}
 }
 
 Dx12Renderer::~Dx12Renderer()
@@ -63,11 +108,26 @@ HRESULT Dx12Renderer::init(const HWND windowHandle)
 		throw "initPipelineAndCommandList() failed";
 		return E_FAIL;
 	}
+	if (FAILED(initComputePipeline()))
+	{
+		throw "initComputePipeline() failed";
+		return E_FAIL;
+	}
+	if (FAILED(initShaderResourceHeap()))
+	{
+		throw "initShaderResourceHeap() failed";
+		return E_FAIL;
+	}
 	if (FAILED(initSynchronisation()))
 	{
 		throw "initSynchronisation() failed";
 		return E_FAIL;
 	}
+	if (FAILED(m_residencyBackend.init(m_dx12Device, m_factory, m_fence)))
+	{
+		throw "m_residencyBackend.init() failed";
+		return E_FAIL;
+	}
 	return S_OK;
 }
 
@@ -77,18 +137,36 @@ void Dx12Renderer::shutdown()
 
 	CloseHandle(m_fenceEvent);
 
-	m_dxDeviceAdapter.~ComPtr();
-	m_dx12RootSig.~ComPtr();
-	m_dx12Device.~ComPtr();
-	m_dx12CommandQueue.~ComPtr();
-	m_swapChain.~ComPtr();
-	m_renderTargetviewDescHeap.~ComPtr();
-	m_dx12CmdAllocator.~ComPtr();
-	m_pipelineState.~ComPtr();
-	m_commandList.~ComPtr();
-	m_fence.~ComPtr();
-	m_renderTargets[0].~ComPtr();
-	m_renderTargets[1].~ComPtr();
+	m_copyBackend.shutdown();
+
+	// the GPU is idle, so whatever is still registered or waiting on a fence can go
+	m_resources.clear();
+
+	m_residency.clear();
+	m_residencyBackend.shutdown();
+
+	// Reset rather than the destructor, which runs again when the renderer is deleted
+	m_dxDeviceAdapter.Reset();
+	m_dx12RootSig.Reset();
+	m_dx12Device.Reset();
+	m_dx12CommandQueue.Reset();
+	m_computeQueue.Reset();
+	m_passFences[QUEUE_GRAPHICS].Reset();
+	m_passFences[QUEUE_ASYNC_COMPUTE].Reset();
+	m_swapChain.Reset();
+	m_renderTargetviewDescHeap.Reset();
+	m_srvHeap.Reset();
+	m_dx12CmdAllocator.Reset();
+	m_pipelineState.Reset();
+	m_skinnedPipelineState.Reset();
+	m_commandList.Reset();
+	m_computeRootSig.Reset();
+	m_skinningPipelineState.Reset();
+	m_computeCmdAllocator.Reset();
+	m_computeCommandList.Reset();
+	m_fence.Reset();
+	m_renderTargets[0].Reset();
+	m_renderTargets[1].Reset();
 }
 
 void Dx12Renderer::waitForLastFrame()
@@ -125,8 +203,246 @@ void Dx12Renderer::waitForLastFrame()
 	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 }
 
+void Dx12Renderer::waitForUpload(const UploadTicket ticket)
+{
+	const UINT64 fenceValue = m_uploader.requiredFenceValue(ticket);
+
+	if (fenceValue > m_copyFenceToWaitFor)
+	{
+		m_copyFenceToWaitFor = fenceValue;
+	}
+}
+
+void Dx12Renderer::trackResidency(ID3D12Resource * resource)
+{
+	const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	const D3D12_RESOURCE_ALLOCATION_INFO allocation = m_dx12Device->GetResourceAllocationInfo(0, 1, &desc);
+
+	m_residency.track(resource, allocation.SizeInBytes);
+}
+
+HRESULT Dx12Renderer::createTexture(const std::vector<DecodedImage> & mips, Texture & texture)
+{
+	if (mips.empty() || m_srvCount >= c_maxShaderResourceViews)
+	{
+		return E_FAIL;
+	}
+
+	const UINT mipCount = static_cast<UINT>(mips.size());
+	const D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM,
+		mips[0].m_width, mips[0].m_height, 1, static_cast<UINT16>(mipCount));
+
+	// common state, promoted to copy dest on the copy queue and to a shader resource when it is read
+	HRESULT hRes = m_dx12Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&textureDesc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&texture.m_resource));
+
+	if (FAILED(hRes))
+	{
+		return hRes;
+	}
+
+	trackResidency(texture.m_resource.Get());
+
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(mipCount);
+	std::vector<UINT> rowCounts(mipCount);
+	std::vector<UINT64> rowSizes(mipCount);
+	UINT64 totalBytes = 0;
+
+	m_dx12Device->GetCopyableFootprints(&textureDesc, 0, mipCount, 0, footprints.data(), rowCounts.data(), rowSizes.data(), &totalBytes);
+
+	for (UINT mip = 0; mip < mipCount; ++mip)
+	{
+		const D3D12_SUBRESOURCE_FOOTPRINT & footprint = footprints[mip].Footprint;
+		const size_t tightRowBytes = static_cast<size_t>(mips[mip].m_width) * 4;
+
+		UploadRequest request;
+		request.m_destination = texture.m_resource.Get();
+		request.m_isTexture = true;
+		request.m_subresource = mip;
+		request.m_footprint = footprint;
+		request.m_data.resize(static_cast<size_t>(footprint.RowPitch) * rowCounts[mip]);
+
+		// rows are padded out to the 256 byte pitch the copy needs
+		for (UINT row = 0; row < rowCounts[mip]; ++row)
+		{
+			memcpy(&request.m_data[static_cast<size_t>(row) * footprint.RowPitch], &mips[mip].m_pixels[row * tightRowBytes], tightRowBytes);
+		}
+
+		texture.m_uploadTicket = m_uploader.enqueue(std::move(request));
+	}
+
+	texture.m_width = mips[0].m_width;
+	texture.m_height = mips[0].m_height;
+	texture.m_mipCount = mipCount;
+	texture.m_srvIndex = m_srvCount++;
+	writeTextureSrv(texture);
+
+	return S_OK;
+}
+
+HRESULT Dx12Renderer::createTextureFromDds(const std::shared_ptr<MappedFile> & file, Texture & texture, const UINT firstMip)
+{
+	if (m_srvCount >= c_maxShaderResourceViews)
+	{
+		return E_FAIL;
+	}
+
+	HRESULT hRes = createDdsResource(file, firstMip, texture);
+
+	if (FAILED(hRes))
+	{
+		return hRes;
+	}
+
+	texture.m_srvIndex = m_srvCount++;
+	writeTextureSrv(texture);
+
+	return S_OK;
+}
+
+HRESULT Dx12Renderer::createStreamedTexture(const std::shared_ptr<MappedFile> & file, const UINT firstMip, Texture & replacement)
+{
+	return createDdsResource(file, firstMip, replacement);
+}
+
+void Dx12Renderer::replaceTexture(const ResourceHandle handle, Texture & replacement)
+{
+	Texture * texture = m_resources.getTexture(handle);
+
+	if (texture == nullptr)
+	{
+		m_residency.untrack(replacement.m_resource.Get());
+		replacement.m_resource.Reset();
+		return;
+	}
+
+	// the srv is rewritten straight away, every frame is waited on in finishDrawing so none in flight reads it.
+	// the old resource is untracked and freed once the last frame that drew with it has finished
+	m_resources.retireTexture(handle, *texture);
+
+	texture->m_resource = replacement.m_resource;
+	texture->m_width = replacement.m_width;
+	texture->m_height = replacement.m_height;
+	texture->m_mipCount = replacement.m_mipCount;
+	texture->m_uploadTicket = replacement.m_uploadTicket;
+
+	writeTextureSrv(*texture);
+
+	replacement.m_resource.Reset();
+}
+
+HRESULT Dx12Renderer::createDdsResource(const std::shared_ptr<MappedFile> & file, const UINT firstMip, Texture & texture)
+{
+	DdsTextureLayout fileLayout;
+	DdsTextureLayout layout;
+
+	if (!file || !parseDds(file->getData(), file->getSize(), fileLayout) || !ddsMipRange(fileLayout, firstMip, layout))
+	{
+		return E_FAIL;
+	}
+
+	const D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(layout.m_format,
+		layout.m_width, layout.m_height, static_cast<UINT16>(layout.m_arraySize), static_cast<UINT16>(layout.m_mipCount));
+
+	HRESULT hRes = m_dx12Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&textureDesc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&texture.m_resource));
+
+	if (FAILED(hRes))
+	{
+		return hRes;
+	}
+
+	trackResidency(texture.m_resource.Get());
+
+	const UINT subresourceCount = static_cast<UINT>(layout.m_subresources.size());
+
+#ifdef _DEBUG
+	// the layout is worked out on the cpu so the parser can be tested without a device, check it still agrees
+	{
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(subresourceCount);
+		std::vector<UINT> rowCounts(subresourceCount);
+		std::vector<UINT64> rowSizes(subresourceCount);
+		UINT64 totalBytes = 0;
+
+		m_dx12Device->GetCopyableFootprints(&textureDesc, 0, subresourceCount, 0, footprints.data(), rowCounts.data(), rowSizes.data(), &totalBytes);
+
+		for (UINT i = 0; i < subresourceCount; ++i)
+		{
+			assert(footprints[i].Offset == layout.m_subresources[i].m_placed.Offset);
+			assert(footprints[i].Footprint.RowPitch == layout.m_subresources[i].m_placed.Footprint.RowPitch);
+			assert(rowCounts[i] == layout.m_subresources[i].m_numRows);
+			assert(rowSizes[i] == layout.m_subresources[i].m_rowSizeInBytes);
+		}
+
+		assert(totalBytes == layout.m_totalUploadBytes);
+	}
+#endif
+
+	for (UINT i = 0; i < subresourceCount; ++i)
+	{
+		const DdsSubresourceLayout & subresource = layout.m_subresources[i];
+
+		UploadRequest request;
+		request.m_destination = texture.m_resource.Get();
+		request.m_isTexture = true;
+		request.m_subresource = i;
+		request.m_footprint = subresource.m_placed.Footprint;
+		request.m_source = file->getData() + subresource.m_fileOffset;
+		request.m_sourceRowPitch = subresource.m_fileRowPitch;
+		request.m_sourceRowCount = subresource.m_numRows;
+		request.m_sourceOwner = file;
+
+		texture.m_uploadTicket = m_uploader.enqueue(std::move(request));
+	}
+
+	texture.m_width = layout.m_width;
+	texture.m_height = layout.m_height;
+	texture.m_mipCount = layout.m_mipCount;
+
+	return S_OK;
+}
+
+void Dx12Renderer::writeTextureSrv(Texture & texture)
+{
+	const D3D12_RESOURCE_DESC resourceDesc = texture.m_resource->GetDesc();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = resourceDesc.Format;
+
+	if (resourceDesc.DepthOrArraySize > 1)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = resourceDesc.MipLevels;
+		srvDesc.Texture2DArray.ArraySize = resourceDesc.DepthOrArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = resourceDesc.MipLevels;
+	}
+
+	const CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle(m_srvHeap->GetCPUDescriptorHandleForHeapStart(), texture.m_srvIndex, m_srvDescriptorSize);
+	m_dx12Device->CreateShaderResourceView(texture.m_resource.Get(), &srvDesc, cpuHandle);
+
+	texture.m_srvGpuHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_srvHeap->GetGPUDescriptorHandleForHeapStart(), texture.m_srvIndex, m_srvDescriptorSize);
+}
+
 void Dx12Renderer::createInitialDrawingCommands()
 {
+	// anything queued since last frame starts copying now, in parallel with this frame's drawing
+	m_uploader.flush();
+
 	// clear the command allocator
 	HRESULT hRes = m_dx12CmdAllocator->Reset();
 
@@ -143,6 +459,22 @@ void Dx12Renderer::createInitialDrawingCommands()
 		throw "Failed to reset the command list!";
 	}
 
+	// compute passes are recorded alongside, the list is closed empty when the frame has none
+	if (FAILED(m_computeCmdAllocator->Reset()))
+	{
+		throw "m_computeCmdAllocator->Reset failed";
+	}
+
+	if (FAILED(m_computeCommandList->Reset(m_computeCmdAllocator.Get(), m_skinningPipelineState.Get())))
+	{
+		throw "Failed to reset the compute command list!";
+	}
+
+	m_framePasses.clear();
+	m_framePassLists.clear();
+	m_frameReads.clear();
+	m_skinningPassAdded = false;
+
 	// set the state
 	m_commandList->SetGraphicsRootSignature(m_dx12RootSig.Get());
 	m_commandList->RSSetViewports(1, &m_viewport);
@@ -159,12 +491,156 @@ void Dx12Renderer::createInitialDrawingCommands()
 	m_commandList->ClearRenderTargetView(rtvHandle, clearClr, 0, nullptr);
 }
 
-void Dx12Renderer::appendDrawingCommands(const Geometry & toDraw)
+void Dx12Renderer::appendDrawingCommands(const Geometry & toDraw, const UINT lod)
 {
+	waitForUpload(toDraw.m_uploadTicket);
+	useResource(toDraw.m_vertexBuffer.Get());
+	useResource(toDraw.m_indexBuffer.Get());
+
+	UINT indexOffset = 0;
+	UINT indexCount = toDraw.m_numIndices;
+
+	if (lod < toDraw.m_lods.size())
+	{
+		indexOffset = toDraw.m_lods[lod].m_indexOffset;
+		indexCount = toDraw.m_lods[lod].m_indexCount;
+	}
+
 	// append stuff to the command list
 	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST); // this could likely be moved to createInitialDrawingCommands
 	m_commandList->IASetVertexBuffers(0, 1, &toDraw.m_vertexBufferView);
-	m_commandList->DrawInstanced(toDraw.m_numVertices, 1, 0, 0);
+	m_commandList->IASetIndexBuffer(&toDraw.m_indexBufferView);
+	m_commandList->DrawIndexedInstanced(indexCount, 1, indexOffset, 0, 0);
+}
+
+void Dx12Renderer::appendDrawingCommands(const Geometry & toDraw, const std::vector<IndexRange> & ranges)
+{
+	waitForUpload(toDraw.m_uploadTicket);
+	useResource(toDraw.m_vertexBuffer.Get());
+	useResource(toDraw.m_indexBuffer.Get());
+
+	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	m_commandList->IASetVertexBuffers(0, 1, &toDraw.m_vertexBufferView);
+	m_commandList->IASetIndexBuffer(&toDraw.m_indexBufferView);
+
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		m_commandList->DrawIndexedInstanced(ranges[i].m_indexCount, 1, ranges[i].m_indexOffset, 0, 0);
+	}
+}
+
+void Dx12Renderer::appendSkinnedDrawingCommands(const SkinnedGeometry & toDraw)
+{
+	const Geometry & geometry = toDraw.m_geometry;
+
+	waitForUpload(geometry.m_uploadTicket);
+	useResource(geometry.m_indexBuffer.Get());
+
+	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	m_commandList->IASetIndexBuffer(&geometry.m_indexBufferView);
+
+	if (toDraw.m_path == SKINNING_CPU)
+	{
+		useResource(toDraw.m_skinnedVertices.m_resource.Get());
+
+		// this frame's copy of what the CPU skinned, drawn like any other mesh
+		D3D12_VERTEX_BUFFER_VIEW skinnedView;
+		skinnedView.BufferLocation = getDynamicFrameAddress(toDraw.m_skinnedVertices);
+		skinnedView.StrideInBytes = sizeof(Vertex);
+		skinnedView.SizeInBytes = sizeof(Vertex) * geometry.m_numVertices;
+
+		m_commandList->IASetVertexBuffers(0, 1, &skinnedView);
+		m_commandList->DrawIndexedInstanced(geometry.m_numIndices, 1, 0, 0, 0);
+		return;
+	}
+
+	if (toDraw.m_path == SKINNING_COMPUTE)
+	{
+		recordComputeSkinning(toDraw);
+
+		// what the pass wrote, the frame's list waits on the compute queue for it
+		D3D12_VERTEX_BUFFER_VIEW skinnedView;
+		skinnedView.BufferLocation = toDraw.m_computeSkinnedVertices->GetGPUVirtualAddress();
+		skinnedView.StrideInBytes = sizeof(Vertex);
+		skinnedView.SizeInBytes = sizeof(Vertex) * geometry.m_numVertices;
+
+		m_commandList->IASetVertexBuffers(0, 1, &skinnedView);
+		m_commandList->DrawIndexedInstanced(geometry.m_numIndices, 1, 0, 0, 0);
+		return;
+	}
+
+	useResource(geometry.m_vertexBuffer.Get());
+	useResource(toDraw.m_bonePalette.m_resource.Get());
+
+	m_commandList->SetPipelineState(m_skinnedPipelineState.Get());
+	m_commandList->SetGraphicsRootConstantBufferView(c_bonePaletteRootParameter, getDynamicFrameAddress(toDraw.m_bonePalette));
+	m_commandList->IASetVertexBuffers(0, 1, &geometry.m_vertexBufferView);
+	m_commandList->DrawIndexedInstanced(geometry.m_numIndices, 1, 0, 0, 0);
+
+	// back to the default for whatever is appended next
+	m_commandList->SetPipelineState(m_pipelineState.Get());
+}
+
+HRESULT Dx12Renderer::createDynamicBuffer(const UINT frameSize, DynamicBuffer & buffer)
+{
+	buffer.m_frameSize = (frameSize + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+
+	HRESULT hRes = m_dx12Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(buffer.m_frameSize) * c_dynamicBufferCopies),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&buffer.m_resource));
+
+	if (FAILED(hRes))
+	{
+		return hRes;
+	}
+
+	// never read on the CPU
+	const CD3DX12_RANGE readRange(0, 0);
+	hRes = buffer.m_resource->Map(0, &readRange, reinterpret_cast<void**>(&buffer.m_mapped));
+
+	if (FAILED(hRes))
+	{
+		buffer.m_resource.Reset();
+		return hRes;
+	}
+
+	trackResidency(buffer.m_resource.Get());
+
+	return S_OK;
+}
+
+UINT8 * Dx12Renderer::getDynamicFrameData(const DynamicBuffer & buffer) const
+{
+	return buffer.m_mapped + static_cast<size_t>(m_frameIndex) * buffer.m_frameSize;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS Dx12Renderer::getDynamicFrameAddress(const DynamicBuffer & buffer) const
+{
+	return buffer.m_resource->GetGPUVirtualAddress() + static_cast<UINT64>(m_frameIndex) * buffer.m_frameSize;
+}
+
+HRESULT Dx12Renderer::createUnorderedAccessBuffer(const UINT64 size, Microsoft::WRL::ComPtr<ID3D12Resource> & buffer)
+{
+	const HRESULT hRes = m_dx12Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&buffer));
+
+	if (FAILED(hRes))
+	{
+		return hRes;
+	}
+
+	trackResidency(buffer.Get());
+
+	return S_OK;
 }
 
 void Dx12Renderer::finishDrawing()
@@ -180,11 +656,55 @@ void Dx12Renderer::finishDrawing()
 		throw "Failed the close the command list";
 	}
 
+	if (FAILED(m_computeCommandList->Close()))
+	{
+		throw "Failed the close the compute command list";
+	}
+
+
+	// cross queue wait, only when this frame uses something the copy queue might still be writing. compute
+	// passes read uploads too, so both queues wait before anything of the frame is submitted
+	if (m_copyFenceToWaitFor > m_copyFenceWaitedFor)
+	{
+		if (FAILED(m_dx12CommandQueue->Wait(m_copyBackend.getFence(), m_copyFenceToWaitFor)))
+		{
+			throw "m_dx12CommandQueue->Wait() on the copy fence failed";
+		}
+
+		if (FAILED(m_computeQueue->Wait(m_copyBackend.getFence(), m_copyFenceToWaitFor)))
+		{
+			throw "m_computeQueue->Wait() on the copy fence failed";
+		}
+
+		m_copyFenceWaitedFor = m_copyFenceToWaitFor;
+	}
+
+	// evicts down to the budget and brings back anything this frame uses, before any of it runs.
+	// the frame signals m_fenceValue in waitForLastFrame
+	if (FAILED(m_residency.prepareFrame(m_fenceValue)))
+	{
+		throw "m_residency.prepareFrame() failed";
+	}
+
+	// the frame's own list goes last on the graphics queue, after the passes that write what it draws
+	PassDesc framePass;
+	framePass.m_name = "frame";
+	framePass.m_asyncComputeEligible = false;
+	framePass.m_reads = m_frameReads;
+	addFramePass(framePass, m_commandList.Get());
 
-	ID3D12CommandList* ppCmdLists[] = { m_commandList.Get() };
+	executePasses(m_framePasses.compile(), m_framePassLists);
 
-	// array of size 1, can have multiple command lists?
-	m_dx12CommandQueue->ExecuteCommandLists(1, ppCmdLists);
+	// compute passes nothing on the direct queue depended on still have to finish inside the frame
+	if (m_computeFenceToJoin != 0)
+	{
+		if (FAILED(m_dx12CommandQueue->Wait(m_passFences[QUEUE_ASYNC_COMPUTE].Get(), m_computeFenceToJoin)))
+		{
+			throw "m_dx12CommandQueue->Wait() on the compute fence failed";
+		}
+
+		m_computeFenceToJoin = 0;
+	}
 
 
 	// present the frame
@@ -194,6 +714,99 @@ void Dx12Renderer::finishDrawing()
 	}
 
 	waitForLastFrame();
+
+	m_uploader.retireCompleted();
+	m_resources.collect(m_fence->GetCompletedValue());
+}
+
+PassHandle Dx12Renderer::addFramePass(const PassDesc & desc, ID3D12CommandList * passCommandList)
+{
+	const PassHandle pass = m_framePasses.addPass(desc);
+	m_framePassLists.push_back(passCommandList);
+	return pass;
+}
+
+void Dx12Renderer::recordComputeSkinning(const SkinnedGeometry & toSkin)
+{
+	const Geometry & geometry = toSkin.m_geometry;
+
+	useResource(geometry.m_vertexBuffer.Get());
+	useResource(toSkin.m_bonePalette.m_resource.Get());
+	useResource(toSkin.m_computeSkinnedVertices.Get());
+
+	m_computeCommandList->SetComputeRootSignature(m_computeRootSig.Get());
+	m_computeCommandList->SetComputeRootConstantBufferView(c_skinningPaletteRootParameter, getDynamicFrameAddress(toSkin.m_bonePalette));
+	m_computeCommandList->SetComputeRootShaderResourceView(c_skinningBindPoseRootParameter, geometry.m_vertexBuffer->GetGPUVirtualAddress());
+	m_computeCommandList->SetComputeRootUnorderedAccessView(c_skinningOutputRootParameter, toSkin.m_computeSkinnedVertices->GetGPUVirtualAddress());
+	m_computeCommandList->SetComputeRoot32BitConstant(c_skinningConstantsRootParameter, geometry.m_numVertices, 0);
+	m_computeCommandList->Dispatch((geometry.m_numVertices + c_skinningGroupSize - 1) / c_skinningGroupSize, 1, 1);
+
+	// every compute skinned mesh this frame goes in the one pass, each writes its own buffer
+	if (!m_skinningPassAdded)
+	{
+		PassDesc skinningPass;
+		skinningPass.m_name = "skinning";
+		skinningPass.m_asyncComputeEligible = true;
+		skinningPass.m_writes.push_back(c_skinnedVerticesPassResource);
+		addFramePass(skinningPass, m_computeCommandList.Get());
+
+		m_frameReads.push_back(c_skinnedVerticesPassResource);
+		m_skinningPassAdded = true;
+	}
+}
+
+void Dx12Renderer::executePasses(const PassSchedule & schedule, const std::vector<ID3D12CommandList*> & passCommandLists)
+{
+	ID3D12CommandQueue* queues[QUEUE_COUNT] = { m_dx12CommandQueue.Get(), m_computeQueue.Get() };
+	bool computeUsed = false;
+
+	// passes are submitted in schedule order, so every wait is queued after the signal it is for
+	for (size_t i = 0; i < schedule.m_passes.size(); ++i)
+	{
+		const ScheduledPass & pass = schedule.m_passes[i];
+		ID3D12CommandQueue* queue = queues[pass.m_queue];
+
+		for (size_t w = 0; w < pass.m_waits.size(); ++w)
+		{
+			const FenceWait & wait = pass.m_waits[w];
+
+			if (FAILED(queue->Wait(m_passFences[wait.m_queue].Get(), m_passFenceBase[wait.m_queue] + wait.m_fenceValue)))
+			{
+				throw "cross queue Wait() for a pass failed";
+			}
+		}
+
+		ID3D12CommandList* ppCmdLists[] = { passCommandLists[pass.m_pass] };
+		queue->ExecuteCommandLists(1, ppCmdLists);
+
+		if (pass.m_signalValue != 0)
+		{
+			if (FAILED(queue->Signal(m_passFences[pass.m_queue].Get(), m_passFenceBase[pass.m_queue] + pass.m_signalValue)))
+			{
+				throw "Signal() after a pass failed";
+			}
+		}
+
+		computeUsed = computeUsed || pass.m_queue == QUEUE_ASYNC_COMPUTE;
+	}
+
+	for (UINT q = 0; q < QUEUE_COUNT; ++q)
+	{
+		m_passFenceBase[q] += schedule.m_signalCount[q];
+	}
+
+	if (computeUsed)
+	{
+		// one extra signal after the last compute pass for finishDrawing to join on
+		++m_passFenceBase[QUEUE_ASYNC_COMPUTE];
+
+		if (FAILED(m_computeQueue->Signal(m_passFences[QUEUE_ASYNC_COMPUTE].Get(), m_passFenceBase[QUEUE_ASYNC_COMPUTE])))
+		{
+			throw "m_computeQueue->Signal() failed";
+		}
+
+		m_computeFenceToJoin = m_passFenceBase[QUEUE_ASYNC_COMPUTE];
+	}
 }
 
 HRESULT Dx12Renderer::initCreateDevice(const HWND windowHandle)
@@ -274,7 +887,33 @@ HRESULT Dx12Renderer::initCreateCommandQueue()
 	ZeroMemory(&d3d12CmdQueueDesc, sizeof(D3D12_COMMAND_QUEUE_DESC));
 	d3d12CmdQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
 	d3d12CmdQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-	return m_dx12Device->CreateCommandQueue(&d3d12CmdQueueDesc, IID_PPV_ARGS(&m_dx12CommandQueue));
+
+	if (FAILED(m_dx12Device->CreateCommandQueue(&d3d12CmdQueueDesc, IID_PPV_ARGS(&m_dx12CommandQueue))))
+	{
+		return E_FAIL;
+	}
+
+	// async compute, passes marked eligible in the PassScheduler run here alongside the direct queue
+	D3D12_COMMAND_QUEUE_DESC computeQueueDesc;
+	ZeroMemory(&computeQueueDesc, sizeof(D3D12_COMMAND_QUEUE_DESC));
+	computeQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	computeQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+
+	if (FAILED(m_dx12Device->CreateCommandQueue(&computeQueueDesc, IID_PPV_ARGS(&m_computeQueue))))
+	{
+		return E_FAIL;
+	}
+
+	for (UINT q = 0; q < QUEUE_COUNT; ++q)
+	{
+		if (FAILED(m_dx12Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_passFences[q]))))
+		{
+			return E_FAIL;
+		}
+	}
+
+	// another queue just for uploads
+	return m_copyBackend.init(m_dx12Device);
 }
 
 HRESULT Dx12Renderer::initCreateSwapChain(const HWND windowHandle)
@@ -365,7 +1004,11 @@ HRESULT Dx12Renderer::initPipelineAndCommandList()
 	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc;
 	ZeroMemory(&rootSigDesc, sizeof(CD3DX12_ROOT_SIGNATURE_DESC));
 
-	rootSigDesc.Init(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	// the default pso doesn't read the bone palette, it only has to be bound for skinned draws
+	CD3DX12_ROOT_PARAMETER rootParameters[1];
+	rootParameters[c_bonePaletteRootParameter].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
+	rootSigDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 	Microsoft::WRL::ComPtr<ID3DBlob> sig;
 	Microsoft::WRL::ComPtr<ID3DBlob> err;
@@ -382,6 +1025,7 @@ HRESULT Dx12Renderer::initPipelineAndCommandList()
 	}
 
 	Microsoft::WRL::ComPtr<ID3DBlob> vsBlob;
+	Microsoft::WRL::ComPtr<ID3DBlob> skinnedVsBlob;
 	Microsoft::WRL::ComPtr<ID3DBlob> psBlob;
 
 #ifdef _DEBUG
@@ -396,6 +1040,11 @@ HRESULT Dx12Renderer::initPipelineAndCommandList()
 		// todo, look for and use the equivelent of getLastError()
 		return E_FAIL;
 	}
+	if (FAILED(D3DCompileFromFile(L"DefaultShader.hlsl", nullptr, nullptr, "VSSkinned", "vs_5_0", shaderCompileFlags, 0, &skinnedVsBlob, nullptr)))
+	{
+		throw "Failed to compile skinned Vertex Shader";
+		return E_FAIL;
+	}
 	if (FAILED(D3DCompileFromFile(L"DefaultShader.hlsl", nullptr, nullptr, "PSMain", "ps_5_0", shaderCompileFlags, 0, &psBlob, nullptr)))
 	{
 		throw "Failed to compile pixel Shader";
@@ -429,6 +1078,24 @@ HRESULT Dx12Renderer::initPipelineAndCommandList()
 		throw "m_dx12Device->CreateGraphicsPipelineState() failed";
 		return E_FAIL;
 	}
+
+	// the same again for bind pose SkinnedVertex data, skinned in the vertex shader
+	D3D12_INPUT_ELEMENT_DESC skinnedInputElementDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, 28, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "BLENDWEIGHT", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+
+	psoDesc.InputLayout = { skinnedInputElementDesc, _countof(skinnedInputElementDesc) };
+	psoDesc.VS = CD3DX12_SHADER_BYTECODE(skinnedVsBlob.Get());
+
+	if (FAILED(m_dx12Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_skinnedPipelineState))))
+	{
+		throw "m_dx12Device->CreateGraphicsPipelineState() failed for the skinned pso";
+		return E_FAIL;
+	}
 	const HRESULT createCommandListResults = m_dx12Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
 		m_dx12CmdAllocator.Get(), m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList));
 	if (FAILED(createCommandListResults))
@@ -445,6 +1112,93 @@ HRESULT Dx12Renderer::initPipelineAndCommandList()
 	return S_OK;
 }
 
+HRESULT Dx12Renderer::initComputePipeline()
+{
+	CD3DX12_ROOT_PARAMETER rootParameters[4];
+	rootParameters[c_skinningPaletteRootParameter].InitAsConstantBufferView(0);
+	rootParameters[c_skinningBindPoseRootParameter].InitAsShaderResourceView(0);
+	rootParameters[c_skinningOutputRootParameter].InitAsUnorderedAccessView(0);
+	rootParameters[c_skinningConstantsRootParameter].InitAsConstants(1, 1);
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc;
+	rootSigDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+	Microsoft::WRL::ComPtr<ID3DBlob> sig;
+	Microsoft::WRL::ComPtr<ID3DBlob> err;
+
+	if (FAILED(D3D12SerializeRootSignature(&rootSigDesc, D3D_ROOT_SIGNATURE_VERSION_1, &sig, &err)))
+	{
+		throw "D3D12SerializeRootSignature() failed for the compute root signature";
+		return E_FAIL;
+	}
+	if (FAILED(m_dx12Device->CreateRootSignature(0, sig->GetBufferPointer(), sig->GetBufferSize(), IID_PPV_ARGS(&m_computeRootSig))))
+	{
+		throw "m_dx12Device->CreateRootSignature() failed for the compute root signature";
+		return E_FAIL;
+	}
+
+	Microsoft::WRL::ComPtr<ID3DBlob> csBlob;
+
+#ifdef _DEBUG
+	UINT shaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	UINT shaderCompileFlags = 0;
+#endif
+
+	if (FAILED(D3DCompileFromFile(L"DefaultShader.hlsl", nullptr, nullptr, "CSSkin", "cs_5_0", shaderCompileFlags, 0, &csBlob, nullptr)))
+	{
+		throw "Failed to compile skinning Compute Shader";
+		return E_FAIL;
+	}
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.pRootSignature = m_computeRootSig.Get();
+	psoDesc.CS = CD3DX12_SHADER_BYTECODE(csBlob.Get());
+
+	if (FAILED(m_dx12Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&m_skinningPipelineState))))
+	{
+		throw "m_dx12Device->CreateComputePipelineState() failed for the skinning pso";
+		return E_FAIL;
+	}
+
+	// compute lists for the async compute queue, one allocator as every frame is waited on
+	if (FAILED(m_dx12Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS(&m_computeCmdAllocator))))
+	{
+		throw "m_dx12Device->CreateCommandAllocator() failed for the compute queue";
+		return E_FAIL;
+	}
+	if (FAILED(m_dx12Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE,
+		m_computeCmdAllocator.Get(), m_skinningPipelineState.Get(), IID_PPV_ARGS(&m_computeCommandList))))
+	{
+		throw "Failed to create the compute command list";
+		return E_FAIL;
+	}
+
+	if (FAILED(m_computeCommandList->Close()))
+	{
+		throw "Failed to close the compute command list, as part of creation";
+		return E_FAIL;
+	}
+	return S_OK;
+}
+
+HRESULT Dx12Renderer::initShaderResourceHeap()
+{
+	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc;
+	ZeroMemory(&srvHeapDesc, sizeof(D3D12_DESCRIPTOR_HEAP_DESC));
+	srvHeapDesc.NumDescriptors = c_maxShaderResourceViews;
+	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+	if (FAILED(m_dx12Device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_srvHeap))))
+	{
+		return E_FAIL;
+	}
+
+	m_srvDescriptorSize = m_dx12Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	return S_OK;
+}
+
 HRESULT Dx12Renderer::initSynchronisation()
 {
 	if (FAILED(m_dx12Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence))))
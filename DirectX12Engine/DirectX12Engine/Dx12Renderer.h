@@ -10,6 +10,17 @@
 #include "d3dx12.h"
 
 #include "Geomatry.h"
+#include <memory>
+
+#include "Texture.h"
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "CopyUploader.h"
+#include "Dx12CopyBackend.h"
+#include "Dx12ResidencyBackend.h"
+#include "ResidencyManager.h"
+#include "ResourceRegistry.h"
+#include "PassScheduler.h"
 
 class Dx12Renderer
 {
@@ -26,9 +37,63 @@ public:
 	}
 	
 	void waitForLastFrame(); // refactor once found a cleaner way
+
+	// uploads to default heap buffers go through here, they run on the copy queue
+	CopyUploader & getUploader()
+	{
+		return m_uploader;
+	}
+
+	// the next submitted frame waits on the copy queue for this upload, only if it hasn't finished already
+	void waitForUpload(const UploadTicket ticket);
+
+	// every default heap resource goes through the residency manager, textures and geometry buffers the renderer
+	// creates are tracked already. untrack through getResidency() before releasing anything tracked here
+	void trackResidency(ID3D12Resource * resource);
+	// the frame being recorded uses it, so it has to be resident when the frame runs
+	void useResource(ID3D12Pageable * object) { m_residency.markUsed(object); }
+	ResidencyManager & getResidency() { return m_residency; }
+
+	// meshes, textures and buffers by handle. a released one is kept until the last frame that used it has
+	// finished and freed at the end of a later frame
+	ResourceRegistry & getResources() { return m_resources; }
+	// the frame being recorded uses it, so it is resident when the frame runs and outlives the frame
+	void useResource(const ResourceHandle resource) { m_resources.markUsed(resource, m_fenceValue); }
+
+	// RGBA8 texture in a default heap with an srv in the shader visible heap, the mips are uploaded on the copy queue
+	HRESULT createTexture(const std::vector<DecodedImage> & mips, Texture & texture);
+	// a cooked .dds as is, every subresource is copied from the mapping straight into the copy queue's staging
+	// buffer with no decode or intermediate buffer. the mapping is held until its last mip has been written
+	HRESULT createTextureFromDds(const std::shared_ptr<MappedFile> & file, Texture & texture, const UINT firstMip = 0);
+
+	// streaming, the same .dds from another top mip with no srv of its own. once its upload has finished
+	// replaceTexture moves it into a registered texture's srv slot, so anything holding the slot index sees the
+	// new mips. the old resource is released through the registry
+	HRESULT createStreamedTexture(const std::shared_ptr<MappedFile> & file, const UINT firstMip, Texture & replacement);
+	void replaceTexture(const ResourceHandle texture, Texture & replacement);
+	ID3D12DescriptorHeap* getSrvHeap() { return m_srvHeap.Get(); }
+
+	// persistently mapped upload memory with a copy of frameSize bytes per back buffer, for data the CPU
+	// rewrites every frame. write this frame's copy through getDynamicFrameData before it is drawn
+	HRESULT createDynamicBuffer(const UINT frameSize, DynamicBuffer & buffer);
+	UINT8 * getDynamicFrameData(const DynamicBuffer & buffer) const;
+	// which of the c_dynamicBufferCopies getDynamicFrameData writes this frame
+	UINT getFrameIndex() const { return m_frameIndex; }
+	D3D12_GPU_VIRTUAL_ADDRESS getDynamicFrameAddress(const DynamicBuffer & buffer) const;
+	// default heap buffer a compute pass can write, in the common state. buffers promote to whatever each
+	// queue uses them as and decay back after every ExecuteCommandLists, so no barriers are needed
+	HRESULT createUnorderedAccessBuffer(const UINT64 size, Microsoft::WRL::ComPtr<ID3D12Resource> & buffer);
 	
 	void createInitialDrawingCommands();
-	void appendDrawingCommands(const Geometry & toDraw);
+	// lod indexes toDraw.m_lods, ignored when the geometry has no lod chain
+	void appendDrawingCommands(const Geometry & toDraw, const UINT lod = 0);
+	// draws only the given parts of the index buffer, e.g. the meshlets that survived culling
+	void appendDrawingCommands(const Geometry & toDraw, const std::vector<IndexRange> & ranges);
+	// toDraw.m_path picks the pso. the CPU path draws this frame's m_skinnedVertices with the default pso,
+	// the GPU path draws the bind pose with the skinned pso and this frame's m_bonePalette. the compute path
+	// adds a skinning pass to the frame and draws what it writes with the default pso
+	void appendSkinnedDrawingCommands(const SkinnedGeometry & toDraw);
+	// waits for the copy queue, runs the frame's passes and then its own command list, and presents
 	void finishDrawing();
 
 private:
@@ -37,9 +102,23 @@ private:
 	HRESULT initCreateCommandQueue();
 	HRESULT initCreateSwapChain(const HWND windowHandle);
 	HRESULT initRenderTargets(const HWND windowHandle);
+	// the default pso and the skinned one, they share the root signature
 	HRESULT initPipelineAndCommandList();
-	// todo, create seperate psos and command lists for different drawing techniques, e.g. skinned meshes.
 	HRESULT initSynchronisation();
+	HRESULT initShaderResourceHeap();
+	HRESULT createDdsResource(const std::shared_ptr<MappedFile> & file, const UINT firstMip, Texture & texture);
+	// (re)writes the srv in texture.m_srvIndex for whatever resource it holds now
+	void writeTextureSrv(Texture & texture);
+	// the skinning root signature and pso, and the command list compute passes are recorded into
+	HRESULT initComputePipeline();
+
+	// a pass for this frame's schedule, passCommandList has to be a compute list when the pass is async
+	// compute eligible. whatever the pass writes that the frame's own command list reads goes in m_frameReads
+	PassHandle addFramePass(const PassDesc & desc, ID3D12CommandList * passCommandList);
+	void recordComputeSkinning(const SkinnedGeometry & toSkin);
+	// runs the compiled passes on the graphics and async compute queues with the fences the schedule asks for.
+	// passCommandLists is indexed by pass handle. only from finishDrawing, once both queues wait on the copy fence
+	void executePasses(const PassSchedule & schedule, const std::vector<ID3D12CommandList*> & passCommandLists);
 
 	// Dx12 structs
 	Microsoft::WRL::ComPtr<IDXGIAdapter> m_dxDeviceAdapter;
@@ -49,10 +128,16 @@ private:
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_dx12CommandQueue;
 	Microsoft::WRL::ComPtr<IDXGISwapChain3> m_swapChain;
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_renderTargetviewDescHeap;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_srvHeap;
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_renderTargets[2];
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_dx12CmdAllocator;
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pipelineState;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_skinnedPipelineState;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_computeRootSig;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_skinningPipelineState;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_computeCmdAllocator;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_computeCommandList;
 	CD3DX12_VIEWPORT m_viewport;
 	CD3DX12_RECT m_scissorRect;
 
@@ -61,6 +146,8 @@ private:
 	float m_aspectRatio;
 
 	UINT m_rtvDescriptorSize;
+	UINT m_srvDescriptorSize;
+	UINT m_srvCount;
 
 	bool m_useWarpDevice;
 
@@ -70,6 +157,31 @@ private:
 	Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
 	UINT64 m_fenceValue;
 
+	// copy queue for uploads, the direct queue only waits on it when a draw uses data still being copied
+	Dx12CopyBackend m_copyBackend;
+	CopyUploader m_uploader;
+	UINT64 m_copyFenceToWaitFor;
+	UINT64 m_copyFenceWaitedFor;
+
+	// keeps everything tracked under the OS video memory budget, checked once per frame
+	Dx12ResidencyBackend m_residencyBackend;
+	ResidencyManager m_residency;
+	ResourceRegistry m_resources;
+
+	// async compute, one fence per queue for the pass schedule. schedule fence values are added to the
+	// base so the same compiled schedule can be submitted every frame
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_computeQueue;
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_passFences[QUEUE_COUNT];
+	UINT64 m_passFenceBase[QUEUE_COUNT];
+	// compute work still running when the frame ends, the direct queue waits for it so waitForLastFrame covers it
+	UINT64 m_computeFenceToJoin;
+	// this frame's passes, rebuilt every frame. the frame's own command list is the last graphics pass and
+	// reads m_frameReads, so it only waits on the compute passes whose output it draws
+	PassScheduler m_framePasses;
+	std::vector<ID3D12CommandList*> m_framePassLists;
+	std::vector<UINT> m_frameReads;
+	bool m_skinningPassAdded;
+
 	// tempory code, figure out a good way to replace this
 	static inline void GetHardwareAdapter(IDXGIFactory2* pFactory, IDXGIAdapter1** ppAdapter)
 	{
@@ -0,0 +1,67 @@
+#include "Dx12ResidencyBackend.h"
+
+Dx12ResidencyBackend::Dx12ResidencyBackend()
+	: m_device(nullptr)
+	, m_adapter(nullptr)
+	, m_frameFence(nullptr)
+{
+
+}
+
+Dx12ResidencyBackend::~Dx12ResidencyBackend()
+{
+
+}
+
+HRESULT Dx12ResidencyBackend::init(const Microsoft::WRL::ComPtr<ID3D12Device> & device, const Microsoft::WRL::ComPtr<IDXGIFactory4> & factory,
+	const Microsoft::WRL::ComPtr<ID3D12Fence> & frameFence)
+{
+	m_device = device;
+	m_frameFence = frameFence;
+
+	// the adapter the device was actually created on, hardware or warp
+	if (FAILED(factory->EnumAdapterByLuid(m_device->GetAdapterLuid(), IID_PPV_ARGS(&m_adapter))))
+	{
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
+
+void Dx12ResidencyBackend::shutdown()
+{
+	m_frameFence.Reset();
+	m_adapter.Reset();
+	m_device.Reset();
+}
+
+void Dx12ResidencyBackend::queryVideoMemory(UINT64 & budget, UINT64 & usage)
+{
+	DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+
+	if (FAILED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+	{
+		// nothing to go on, don't evict anything
+		budget = UINT64_MAX;
+		usage = 0;
+		return;
+	}
+
+	budget = info.Budget;
+	usage = info.CurrentUsage;
+}
+
+HRESULT Dx12ResidencyBackend::makeResident(const std::vector<ID3D12Pageable*> & objects)
+{
+	return m_device->MakeResident(static_cast<UINT>(objects.size()), objects.data());
+}
+
+HRESULT Dx12ResidencyBackend::evict(const std::vector<ID3D12Pageable*> & objects)
+{
+	return m_device->Evict(static_cast<UINT>(objects.size()), objects.data());
+}
+
+UINT64 Dx12ResidencyBackend::getCompletedFenceValue()
+{
+	return m_frameFence->GetCompletedValue();
+}
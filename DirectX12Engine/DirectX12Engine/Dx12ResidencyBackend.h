@@ -0,0 +1,35 @@
+#pragma once
+#ifndef _DX12_RESIDENCY_BACKEND_H_
+#define _DX12_RESIDENCY_BACKEND_H_
+
+#include <wrl.h>
+
+#include <d3d12.h>
+#include <dxgi1_6.h>
+
+#include "ResidencyManager.h"
+
+// Evict / MakeResident on the device and the local memory budget from the adapter the device was made on
+class Dx12ResidencyBackend : public ResidencyBackend
+{
+public:
+	Dx12ResidencyBackend();
+	~Dx12ResidencyBackend();
+
+	HRESULT init(const Microsoft::WRL::ComPtr<ID3D12Device> & device, const Microsoft::WRL::ComPtr<IDXGIFactory4> & factory,
+		const Microsoft::WRL::ComPtr<ID3D12Fence> & frameFence);
+	void shutdown();
+
+	void queryVideoMemory(UINT64 & budget, UINT64 & usage) override;
+	HRESULT makeResident(const std::vector<ID3D12Pageable*> & objects) override;
+	HRESULT evict(const std::vector<ID3D12Pageable*> & objects) override;
+	UINT64 getCompletedFenceValue() override;
+
+private:
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Microsoft::WRL::ComPtr<IDXGIAdapter3> m_adapter;
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_frameFence;
+};
+
+#endif // _DX12_RESIDENCY_BACKEND_H_
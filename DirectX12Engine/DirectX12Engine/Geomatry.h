@@ -7,6 +7,8 @@
 #include <DirectXMath.h>
 #include <d3d12.h>
 
+#include <string>
+#include <vector>
 
 // this should just define structs for representing geomatry
 struct Vertex
@@ -30,14 +32,124 @@ struct Vertex
 };
 
 
+// at most four bones move a vertex, bone indices are bytes and the palette has to fit in one constant buffer
+const UINT c_maxBoneInfluences = 4;
+const UINT c_maxSkinBones = 256;
+
+// bind pose vertex with its bones, the GPU skinning path reads this layout as is. the weights are quantised
+// to bytes that add up to exactly 255, the heaviest first with unused slots left at 0
+struct SkinnedVertex
+{
+	DirectX::XMFLOAT3 m_position;
+	DirectX::XMFLOAT4 m_colour;
+	UINT8 m_boneIndices[c_maxBoneInfluences];
+	UINT8 m_boneWeights[c_maxBoneInfluences];
+};
+
+
+// one level of detail, a range of the mesh's index list that draws from the shared vertices
+struct MeshLod
+{
+	UINT m_indexOffset;
+	UINT m_indexCount;
+	float m_error; // object space error against the full detail mesh
+};
+
+
+// a run of the index buffer to draw
+struct IndexRange
+{
+	UINT m_indexOffset;
+	UINT m_indexCount;
+};
+
+
+// CPU side copy of a mesh, this is what the import / cook steps work on before it gets uploaded
+struct MeshData
+{
+	std::vector<Vertex> m_vertices;
+	std::vector<UINT> m_indices; // triangle list
+	std::vector<MeshLod> m_lods; // empty means m_indices is a single full detail level
+};
+
+
+// CPU side copy of a skinned mesh, kept after upload as the CPU skinning path reads it every frame
+struct SkinnedMeshData
+{
+	std::vector<SkinnedVertex> m_vertices;
+	std::vector<UINT> m_indices; // triangle list
+	std::vector<DirectX::XMFLOAT4X4> m_inverseBindPose; // per bone, mesh space into the bone's space
+	std::vector<std::string> m_boneNames; // the scene nodes that move each bone
+};
+
+
+// one morph target (aiAnimMesh) as the difference from the base mesh, kept only for the vertices it moves.
+// deltas are padded to four floats so the blend kernel reads each one with a single load
+struct MorphTarget
+{
+	std::string m_name;
+	std::vector<UINT> m_vertices; // ascending
+	std::vector<DirectX::XMFLOAT4> m_positionDeltas; // w is 0
+	std::vector<DirectX::XMFLOAT4> m_normalDeltas; // empty when the target doesn't change the normals
+};
+
+
+// CPU side copy of a mesh with morph targets, kept after upload as the blend reads it every frame
+struct MorphedMeshData
+{
+	std::vector<Vertex> m_vertices; // the base mesh
+	std::vector<DirectX::XMFLOAT3> m_normals; // empty, or one per vertex. Vertex has no normal yet so these stay CPU side
+	std::vector<UINT> m_indices; // triangle list
+	std::vector<MorphTarget> m_targets;
+};
+
+
 struct Geometry
 {
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_vertexBuffer;
 	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
-	// Microsoft::WRL::ComPtr<ID3D12Resource> m_index; // add this later
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_indexBuffer;
+	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+
+	std::vector<MeshLod> m_lods;
+
+	// last copy queue upload the buffers depend on, draws wait on it (0 = nothing to wait for)
+	UINT64 m_uploadTicket;
 
 	// this struct will change 
 	UINT m_numVertices;
+	UINT m_numIndices;
+};
+
+
+// one copy of every dynamic buffer per back buffer
+const UINT c_dynamicBufferCopies = 2;
+
+// upload heap memory the CPU rewrites every frame, one copy per back buffer so a frame never writes over what
+// the GPU may still be reading. it stays mapped for its whole life
+struct DynamicBuffer
+{
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_resource;
+	UINT8 * m_mapped;
+	UINT m_frameSize; // 256 byte aligned, so every copy can also be bound as a constant buffer
+};
+
+
+enum SkinningPath
+{
+	SKINNING_CPU = 0,	// skinned on the job system into a dynamic vertex buffer, drawn with the default pso
+	SKINNING_GPU,		// bind pose vertices skinned in the vertex shader of the skinned pso
+	SKINNING_COMPUTE	// skinned by a pass on the async compute queue into m_computeSkinnedVertices, drawn with the default pso
+};
+
+
+struct SkinnedGeometry
+{
+	Geometry m_geometry;				// bind pose SkinnedVertex buffer and the index buffer
+	DynamicBuffer m_skinnedVertices;	// CPU path, the skinned Vertex data for this frame
+	DynamicBuffer m_bonePalette;		// GPU and compute paths, c_maxSkinBones row major matrices for this frame
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_computeSkinnedVertices;	// compute path, Vertex data the skinning pass writes
+	SkinningPath m_path;
 };
 
 
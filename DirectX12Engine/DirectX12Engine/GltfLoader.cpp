@@ -0,0 +1,1127 @@
+#include "GltfLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "Json.h"
+#include "Skinning.h"
+#include "TextureLoader.h"
+
+namespace
+{
+	const UINT32 c_glbMagic = 0x46546C67;		// "glTF"
+	const UINT32 c_glbVersion = 2;
+	const UINT32 c_glbJsonChunk = 0x4E4F534A;	// "JSON"
+	const UINT32 c_glbBinaryChunk = 0x004E4942;	// "BIN\0"
+	const size_t c_glbHeaderSize = 12;
+	const size_t c_glbChunkHeaderSize = 8;
+
+	// a buffer view once its buffer has been looked up
+	struct BufferView
+	{
+		const UINT8 * m_data;
+		UINT m_size;
+		UINT m_stride;	// 0 when the accessors using it are tightly packed
+	};
+
+	UINT32 readUint32(const UINT8 * data)
+	{
+		UINT32 value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	UINT componentSize(const GltfComponentType type)
+	{
+		switch (type)
+		{
+		case GLTF_BYTE:
+		case GLTF_UNSIGNED_BYTE:
+			return 1;
+		case GLTF_SHORT:
+		case GLTF_UNSIGNED_SHORT:
+			return 2;
+		case GLTF_UNSIGNED_INT:
+		case GLTF_FLOAT:
+			return 4;
+		}
+
+		return 0;
+	}
+
+	UINT componentCount(const std::string & type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		if (type == "MAT2") return 4;
+		if (type == "MAT3") return 9;
+		if (type == "MAT4") return 16;
+
+		return 0;
+	}
+
+	int base64Value(const char c)
+	{
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == '+') return 62;
+		if (c == '/') return 63;
+
+		return -1;
+	}
+
+	bool decodeBase64(const char * text, const size_t size, std::vector<UINT8> & out)
+	{
+		out.clear();
+		out.reserve(size / 4 * 3);
+
+		UINT bits = 0;
+		UINT bitCount = 0;
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			if (text[i] == '=')
+			{
+				// only padding after the first one
+				for (size_t j = i; j < size; ++j)
+				{
+					if (text[j] != '=')
+					{
+						return false;
+					}
+				}
+
+				break;
+			}
+
+			const int value = base64Value(text[i]);
+
+			if (value < 0)
+			{
+				return false;
+			}
+
+			bits = (bits << 6) | static_cast<UINT>(value);
+			bitCount += 6;
+
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				out.push_back(static_cast<UINT8>(bits >> bitCount));
+			}
+		}
+
+		return true;
+	}
+
+	// "my%20model.bin" is "my model.bin" on disk
+	std::string decodeUri(const std::string & uri)
+	{
+		std::string out;
+		out.reserve(uri.size());
+
+		for (size_t i = 0; i < uri.size(); ++i)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(static_cast<unsigned char>(uri[i + 1])) && isxdigit(static_cast<unsigned char>(uri[i + 2])))
+			{
+				out += static_cast<char>(strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+				i += 2;
+			}
+			else
+			{
+				out += uri[i];
+			}
+		}
+
+		return out;
+	}
+
+	void setIdentity(DirectX::XMFLOAT4X4 & matrix)
+	{
+		for (UINT r = 0; r < 4; ++r)
+		{
+			for (UINT c = 0; c < 4; ++c)
+			{
+				matrix.m[r][c] = r == c ? 1.0f : 0.0f;
+			}
+		}
+	}
+
+	void multiply(const DirectX::XMFLOAT4X4 & a, const DirectX::XMFLOAT4X4 & b, DirectX::XMFLOAT4X4 & out)
+	{
+		for (UINT r = 0; r < 4; ++r)
+		{
+			for (UINT c = 0; c < 4; ++c)
+			{
+				out.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+			}
+		}
+	}
+
+	// mirror * matrix * mirror, the same transform seen from the left handed side. glTF stores matrices column
+	// major for column vectors, which is the same sixteen floats as row major for row vectors
+	void mirrorMatrix(const float * columnMajor, DirectX::XMFLOAT4X4 & out)
+	{
+		memcpy(&out.m[0][0], columnMajor, sizeof(float) * 16);
+
+		for (UINT i = 0; i < 4; ++i)
+		{
+			if (i != 2)
+			{
+				out.m[i][2] = -out.m[i][2];
+				out.m[2][i] = -out.m[2][i];
+			}
+		}
+	}
+
+	// scale, then rotate, then translate, laid out for row vectors like XMMatrixAffineTransformation
+	void composeMatrix(const float * translation, const float * rotation, const float * scale, DirectX::XMFLOAT4X4 & out)
+	{
+		const float x = rotation[0];
+		const float y = rotation[1];
+		const float z = rotation[2];
+		const float w = rotation[3];
+
+		out.m[0][0] = (1.0f - 2.0f * (y * y + z * z)) * scale[0];
+		out.m[0][1] = 2.0f * (x * y + z * w) * scale[0];
+		out.m[0][2] = 2.0f * (x * z - y * w) * scale[0];
+		out.m[0][3] = 0.0f;
+
+		out.m[1][0] = 2.0f * (x * y - z * w) * scale[1];
+		out.m[1][1] = (1.0f - 2.0f * (x * x + z * z)) * scale[1];
+		out.m[1][2] = 2.0f * (y * z + x * w) * scale[1];
+		out.m[1][3] = 0.0f;
+
+		out.m[2][0] = 2.0f * (x * z + y * w) * scale[2];
+		out.m[2][1] = 2.0f * (y * z - x * w) * scale[2];
+		out.m[2][2] = (1.0f - 2.0f * (x * x + y * y)) * scale[2];
+		out.m[2][3] = 0.0f;
+
+		out.m[3][0] = translation[0];
+		out.m[3][1] = translation[1];
+		out.m[3][2] = translation[2];
+		out.m[3][3] = 1.0f;
+	}
+
+	// up to count numbers of an array, what isn't there keeps its default
+	void readFloats(const JsonDocument & document, const UINT array, float * out, const UINT count)
+	{
+		for (UINT i = 0; i < count && i < document.getSize(array); ++i)
+		{
+			out[i] = static_cast<float>(document.getNumber(document.getElement(array, i), out[i]));
+		}
+	}
+
+	// c_gltfNone when it is missing, or past count
+	UINT readIndex(const JsonDocument & document, const UINT value, const size_t count)
+	{
+		const UINT index = document.getUint(value, c_gltfNone);
+
+		return index < count ? index : c_gltfNone;
+	}
+
+	UINT readElementIndex(const GltfAccessor & accessor, const UINT index)
+	{
+		const UINT8 * element = accessor.m_data + static_cast<size_t>(index) * accessor.m_stride;
+
+		switch (accessor.m_componentType)
+		{
+		case GLTF_UNSIGNED_BYTE:
+			return *element;
+		case GLTF_UNSIGNED_SHORT:
+		{
+			UINT16 value;
+			memcpy(&value, element, sizeof(value));
+			return value;
+		}
+		case GLTF_UNSIGNED_INT:
+		{
+			UINT32 value;
+			memcpy(&value, element, sizeof(value));
+			return value;
+		}
+		default:
+			return UINT_MAX;
+		}
+	}
+}
+
+GltfAsset::GltfAsset()
+{
+
+}
+
+GltfAsset::~GltfAsset()
+{
+
+}
+
+DirectX::XMFLOAT4X4 GltfAsset::getMirrorZ()
+{
+	DirectX::XMFLOAT4X4 mirror;
+	setIdentity(mirror);
+	mirror.m[2][2] = -1.0f;
+
+	return mirror;
+}
+
+void GltfAsset::clear()
+{
+	m_file = AssetView();
+	m_buffers.clear();
+	m_accessors.clear();
+	m_meshes.clear();
+	m_materials.clear();
+	m_images.clear();
+	m_nodes.clear();
+	m_skins.clear();
+	m_sceneRoots.clear();
+}
+
+bool GltfAsset::open(AssetFileSystem & fileSystem, const std::string & path, GltfLoadStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	clear();
+	stats = GltfLoadStats();
+
+	AssetView file;
+
+	if (!fileSystem.open(path, file))
+	{
+		return false;
+	}
+
+	const size_t directoryEnd = path.find_last_of("/\\");
+	const std::string directory = directoryEnd == std::string::npos ? std::string() : path.substr(0, directoryEnd);
+
+	stats.m_bytes = file.m_size;
+
+	const char * json = reinterpret_cast<const char*>(file.m_data);
+	size_t jsonSize = file.m_size;
+	AssetView binaryChunk = AssetView();
+
+	if (file.m_size >= c_glbHeaderSize && readUint32(file.m_data) == c_glbMagic)
+	{
+		const size_t length = readUint32(file.m_data + 8);
+
+		if (readUint32(file.m_data + 4) != c_glbVersion || length > file.m_size || length < c_glbHeaderSize + c_glbChunkHeaderSize)
+		{
+			return false;
+		}
+
+		// the JSON chunk comes first, then optionally the binary one. anything after that is ignored
+		const size_t jsonLength = readUint32(file.m_data + c_glbHeaderSize);
+
+		if (readUint32(file.m_data + c_glbHeaderSize + 4) != c_glbJsonChunk || jsonLength > length - c_glbHeaderSize - c_glbChunkHeaderSize)
+		{
+			return false;
+		}
+
+		json = reinterpret_cast<const char*>(file.m_data + c_glbHeaderSize + c_glbChunkHeaderSize);
+		jsonSize = jsonLength;
+
+		const size_t binaryStart = c_glbHeaderSize + c_glbChunkHeaderSize + jsonLength;
+
+		if (length - binaryStart >= c_glbChunkHeaderSize && readUint32(file.m_data + binaryStart + 4) == c_glbBinaryChunk)
+		{
+			const size_t binaryLength = readUint32(file.m_data + binaryStart);
+
+			if (binaryLength > length - binaryStart - c_glbChunkHeaderSize)
+			{
+				return false;
+			}
+
+			binaryChunk.m_data = file.m_data + binaryStart + c_glbChunkHeaderSize;
+			binaryChunk.m_size = binaryLength;
+			binaryChunk.m_owner = file.m_owner;
+		}
+	}
+
+	m_file = file;
+
+	if (!parseDocument(json, jsonSize, binaryChunk, fileSystem, directory, stats))
+	{
+		clear();
+		return false;
+	}
+
+	stats.m_buffers = static_cast<UINT>(m_buffers.size());
+	stats.m_accessors = static_cast<UINT>(m_accessors.size());
+	stats.m_meshes = static_cast<UINT>(m_meshes.size());
+	stats.m_nodes = static_cast<UINT>(m_nodes.size());
+	stats.m_seconds = duration<double>(steady_clock::now() - start).count();
+
+	return true;
+}
+
+bool GltfAsset::parseDocument(const char * json, const size_t jsonSize, const AssetView & binaryChunk, AssetFileSystem & fileSystem,
+	const std::string & directory, GltfLoadStats & stats)
+{
+	JsonDocument document;
+
+	if (!document.parse(json, jsonSize))
+	{
+		return false;
+	}
+
+	stats.m_jsonValues = document.getValueCount();
+
+	const UINT root = document.getRoot();
+	const std::string version = document.getString(document.find(document.find(root, "asset"), "version"), std::string());
+
+	if (document.getType(root) != JSON_OBJECT || version.compare(0, 2, "2.") != 0 || document.getSize(document.find(root, "extensionsRequired")) > 0)
+	{
+		return false;
+	}
+
+	// buffers, from the .glb's binary chunk, a data: URI or a file next to this one
+	const UINT buffers = document.find(root, "buffers");
+	m_buffers.resize(document.getSize(buffers));
+
+	for (UINT i = 0, buffer = document.getFirstChild(buffers); i < m_buffers.size(); ++i, buffer = document.getNextSibling(buffer))
+	{
+		const double byteLength = document.getNumber(document.find(buffer, "byteLength"), -1.0);
+		const std::string uri = document.getString(document.find(buffer, "uri"), std::string());
+		AssetView & view = m_buffers[i];
+
+		if (byteLength < 0.0)
+		{
+			return false;
+		}
+
+		if (uri.empty())
+		{
+			if (i != 0 || binaryChunk.m_data == nullptr)
+			{
+				return false;
+			}
+
+			view = binaryChunk;
+		}
+		else if (uri.compare(0, 5, "data:") == 0)
+		{
+			const size_t comma = uri.find(',');
+
+			if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+			{
+				return false;
+			}
+
+			std::shared_ptr<std::vector<UINT8>> decoded = std::make_shared<std::vector<UINT8>>();
+
+			if (!decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1, *decoded))
+			{
+				return false;
+			}
+
+			view.m_data = decoded->empty() ? nullptr : &(*decoded)[0];
+			view.m_size = decoded->size();
+			view.m_owner = decoded;
+		}
+		else
+		{
+			if (!fileSystem.open(TextureLoader::resolvePath(directory, decodeUri(uri)), view))
+			{
+				return false;
+			}
+
+			stats.m_bytes += view.m_size;
+		}
+
+		// a .glb's binary chunk is padded to four bytes
+		if (static_cast<double>(view.m_size) < byteLength)
+		{
+			return false;
+		}
+
+		view.m_size = static_cast<size_t>(byteLength);
+	}
+
+	const UINT bufferViews = document.find(root, "bufferViews");
+	std::vector<BufferView> views(document.getSize(bufferViews));
+
+	for (UINT i = 0, bufferView = document.getFirstChild(bufferViews); i < views.size(); ++i, bufferView = document.getNextSibling(bufferView))
+	{
+		const UINT buffer = readIndex(document, document.find(bufferView, "buffer"), m_buffers.size());
+		const UINT offset = document.getUint(document.find(bufferView, "byteOffset"), 0);
+		const UINT length = document.getUint(document.find(bufferView, "byteLength"), c_gltfNone);
+
+		if (buffer == c_gltfNone || length == c_gltfNone || static_cast<UINT64>(offset) + length > m_buffers[buffer].m_size)
+		{
+			return false;
+		}
+
+		views[i].m_data = m_buffers[buffer].m_data + offset;
+		views[i].m_size = length;
+		views[i].m_stride = document.getUint(document.find(bufferView, "byteStride"), 0);
+	}
+
+	const UINT accessors = document.find(root, "accessors");
+	m_accessors.resize(document.getSize(accessors));
+
+	for (UINT i = 0, accessorValue = document.getFirstChild(accessors); i < m_accessors.size(); ++i, accessorValue = document.getNextSibling(accessorValue))
+	{
+		GltfAccessor & accessor = m_accessors[i];
+		const UINT componentType = document.getUint(document.find(accessorValue, "componentType"), 0);
+		accessor.m_componentType = componentType >= GLTF_BYTE && componentType <= GLTF_FLOAT ? static_cast<GltfComponentType>(componentType) : GLTF_FLOAT;
+		accessor.m_components = componentCount(document.getString(document.find(accessorValue, "type"), std::string()));
+		accessor.m_count = document.getUint(document.find(accessorValue, "count"), 0);
+		accessor.m_normalised = document.getBool(document.find(accessorValue, "normalized"), false);
+
+		const UINT elementSize = componentSize(accessor.m_componentType) * accessor.m_components;
+
+		if (elementSize == 0 || accessor.m_componentType != componentType || accessor.m_count == 0 || document.find(accessorValue, "sparse") != c_jsonNone)
+		{
+			return false;
+		}
+
+		const UINT viewIndex = document.find(accessorValue, "bufferView");
+
+		if (viewIndex == c_jsonNone)
+		{
+			// no view means all zeros
+			std::shared_ptr<std::vector<UINT8>> zeros = std::make_shared<std::vector<UINT8>>(static_cast<size_t>(elementSize) * accessor.m_count);
+			AssetView zeroView = { &(*zeros)[0], zeros->size(), zeros };
+			m_buffers.push_back(zeroView);
+
+			accessor.m_data = zeroView.m_data;
+			accessor.m_stride = elementSize;
+			continue;
+		}
+
+		const UINT view = readIndex(document, viewIndex, views.size());
+		const UINT offset = document.getUint(document.find(accessorValue, "byteOffset"), 0);
+
+		if (view == c_gltfNone)
+		{
+			return false;
+		}
+
+		accessor.m_stride = views[view].m_stride != 0 ? views[view].m_stride : elementSize;
+
+		if (accessor.m_stride < elementSize ||
+			static_cast<UINT64>(offset) + static_cast<UINT64>(accessor.m_stride) * (accessor.m_count - 1) + elementSize > views[view].m_size)
+		{
+			return false;
+		}
+
+		accessor.m_data = views[view].m_data + offset;
+	}
+
+	const UINT images = document.find(root, "images");
+	m_images.resize(document.getSize(images));
+
+	for (UINT i = 0, imageValue = document.getFirstChild(images); i < m_images.size(); ++i, imageValue = document.getNextSibling(imageValue))
+	{
+		GltfImage & image = m_images[i];
+		image.m_name = document.getString(document.find(imageValue, "name"), std::string());
+		image.m_uri = decodeUri(document.getString(document.find(imageValue, "uri"), std::string()));
+		image.m_mimeType = document.getString(document.find(imageValue, "mimeType"), std::string());
+		image.m_data = nullptr;
+		image.m_size = 0;
+
+		const UINT viewIndex = document.find(imageValue, "bufferView");
+
+		if (viewIndex != c_jsonNone)
+		{
+			const UINT view = readIndex(document, viewIndex, views.size());
+
+			if (view == c_gltfNone)
+			{
+				return false;
+			}
+
+			image.m_data = views[view].m_data;
+			image.m_size = views[view].m_size;
+		}
+	}
+
+	// textures only add a sampler to an image, materials are given the image
+	const UINT textures = document.find(root, "textures");
+	std::vector<UINT> textureImages(document.getSize(textures));
+
+	for (UINT i = 0, texture = document.getFirstChild(textures); i < textureImages.size(); ++i, texture = document.getNextSibling(texture))
+	{
+		textureImages[i] = readIndex(document, document.find(texture, "source"), m_images.size());
+	}
+
+	const auto findImage = [&](const UINT object, const char * name)
+	{
+		const UINT texture = readIndex(document, document.find(document.find(object, name), "index"), textureImages.size());
+
+		return texture == c_gltfNone ? c_gltfNone : textureImages[texture];
+	};
+
+	const UINT materials = document.find(root, "materials");
+	m_materials.resize(document.getSize(materials));
+
+	for (UINT i = 0, materialValue = document.getFirstChild(materials); i < m_materials.size(); ++i, materialValue = document.getNextSibling(materialValue))
+	{
+		GltfMaterial & material = m_materials[i];
+		const UINT pbr = document.find(materialValue, "pbrMetallicRoughness");
+
+		material.m_name = document.getString(document.find(materialValue, "name"), std::string());
+		material.m_baseColour = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+		readFloats(document, document.find(pbr, "baseColorFactor"), &material.m_baseColour.x, 4);
+		material.m_metallic = static_cast<float>(document.getNumber(document.find(pbr, "metallicFactor"), 1.0));
+		material.m_roughness = static_cast<float>(document.getNumber(document.find(pbr, "roughnessFactor"), 1.0));
+		material.m_emissive = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		readFloats(document, document.find(materialValue, "emissiveFactor"), &material.m_emissive.x, 3);
+		material.m_alphaCutoff = document.getString(document.find(materialValue, "alphaMode"), std::string()) == "MASK" ?
+			static_cast<float>(document.getNumber(document.find(materialValue, "alphaCutoff"), 0.5)) : 0.0f;
+		material.m_doubleSided = document.getBool(document.find(materialValue, "doubleSided"), false);
+
+		material.m_baseColourImage = findImage(pbr, "baseColorTexture");
+		material.m_metallicRoughnessImage = findImage(pbr, "metallicRoughnessTexture");
+		material.m_normalImage = findImage(materialValue, "normalTexture");
+		material.m_occlusionImage = findImage(materialValue, "occlusionTexture");
+		material.m_emissiveImage = findImage(materialValue, "emissiveTexture");
+	}
+
+	const UINT meshes = document.find(root, "meshes");
+	m_meshes.resize(document.getSize(meshes));
+
+	for (UINT i = 0, meshValue = document.getFirstChild(meshes); i < m_meshes.size(); ++i, meshValue = document.getNextSibling(meshValue))
+	{
+		GltfMesh & mesh = m_meshes[i];
+		const UINT primitives = document.find(meshValue, "primitives");
+
+		mesh.m_name = document.getString(document.find(meshValue, "name"), std::string());
+		mesh.m_primitives.resize(document.getSize(primitives));
+
+		for (UINT p = 0, primitiveValue = document.getFirstChild(primitives); p < mesh.m_primitives.size(); ++p, primitiveValue = document.getNextSibling(primitiveValue))
+		{
+			GltfPrimitive & primitive = mesh.m_primitives[p];
+			const UINT attributes = document.find(primitiveValue, "attributes");
+
+			const struct { const char * m_name; UINT * m_accessor; } named[] =
+			{
+				{ "POSITION", &primitive.m_positions },
+				{ "NORMAL", &primitive.m_normals },
+				{ "TEXCOORD_0", &primitive.m_texCoords },
+				{ "COLOR_0", &primitive.m_colours },
+				{ "JOINTS_0", &primitive.m_joints },
+				{ "WEIGHTS_0", &primitive.m_weights },
+			};
+
+			for (size_t a = 0; a < _countof(named); ++a)
+			{
+				const UINT value = document.find(attributes, named[a].m_name);
+				*named[a].m_accessor = readIndex(document, value, m_accessors.size());
+
+				if (value != c_jsonNone && *named[a].m_accessor == c_gltfNone)
+				{
+					return false;
+				}
+			}
+
+			const UINT indices = document.find(primitiveValue, "indices");
+			const UINT material = document.find(primitiveValue, "material");
+			primitive.m_indices = readIndex(document, indices, m_accessors.size());
+			primitive.m_material = readIndex(document, material, m_materials.size());
+			const UINT mode = document.getUint(document.find(primitiveValue, "mode"), GLTF_TRIANGLES);
+			primitive.m_mode = mode <= GLTF_TRIANGLE_FAN ? static_cast<GltfPrimitiveMode>(mode) : GLTF_POINTS;
+
+			if (primitive.m_positions == c_gltfNone || mode > GLTF_TRIANGLE_FAN ||
+				(indices != c_jsonNone && primitive.m_indices == c_gltfNone) || (material != c_jsonNone && primitive.m_material == c_gltfNone))
+			{
+				return false;
+			}
+		}
+	}
+
+	const UINT skins = document.find(root, "skins");
+	const UINT nodes = document.find(root, "nodes");
+	m_skins.resize(document.getSize(skins));
+	m_nodes.resize(document.getSize(nodes));
+
+	for (UINT i = 0, skinValue = document.getFirstChild(skins); i < m_skins.size(); ++i, skinValue = document.getNextSibling(skinValue))
+	{
+		GltfSkin & skin = m_skins[i];
+		const UINT joints = document.find(skinValue, "joints");
+		const UINT inverseBindMatrices = document.find(skinValue, "inverseBindMatrices");
+
+		skin.m_name = document.getString(document.find(skinValue, "name"), std::string());
+		skin.m_joints.resize(document.getSize(joints));
+		skin.m_inverseBindMatrices = readIndex(document, inverseBindMatrices, m_accessors.size());
+		skin.m_skeleton = readIndex(document, document.find(skinValue, "skeleton"), m_nodes.size());
+
+		for (UINT j = 0, joint = document.getFirstChild(joints); j < skin.m_joints.size(); ++j, joint = document.getNextSibling(joint))
+		{
+			skin.m_joints[j] = readIndex(document, joint, m_nodes.size());
+
+			if (skin.m_joints[j] == c_gltfNone)
+			{
+				return false;
+			}
+		}
+
+		if (inverseBindMatrices != c_jsonNone)
+		{
+			const GltfAccessor * accessor = skin.m_inverseBindMatrices == c_gltfNone ? nullptr : &m_accessors[skin.m_inverseBindMatrices];
+
+			if (accessor == nullptr || accessor->m_componentType != GLTF_FLOAT || accessor->m_components != 16 || accessor->m_count < skin.m_joints.size())
+			{
+				return false;
+			}
+		}
+	}
+
+	for (UINT i = 0; i < m_nodes.size(); ++i)
+	{
+		m_nodes[i].m_parent = c_gltfNone;
+	}
+
+	for (UINT i = 0, nodeValue = document.getFirstChild(nodes); i < m_nodes.size(); ++i, nodeValue = document.getNextSibling(nodeValue))
+	{
+		GltfNode & node = m_nodes[i];
+		const UINT children = document.find(nodeValue, "children");
+		const UINT mesh = document.find(nodeValue, "mesh");
+		const UINT skin = document.find(nodeValue, "skin");
+
+		node.m_name = document.getString(document.find(nodeValue, "name"), std::string());
+		node.m_mesh = readIndex(document, mesh, m_meshes.size());
+		node.m_skin = readIndex(document, skin, m_skins.size());
+		node.m_children.resize(document.getSize(children));
+
+		if ((mesh != c_jsonNone && node.m_mesh == c_gltfNone) || (skin != c_jsonNone && node.m_skin == c_gltfNone))
+		{
+			return false;
+		}
+
+		// the nodes have to be a forest, one parent each
+		for (UINT c = 0, child = document.getFirstChild(children); c < node.m_children.size(); ++c, child = document.getNextSibling(child))
+		{
+			node.m_children[c] = readIndex(document, child, m_nodes.size());
+
+			if (node.m_children[c] == c_gltfNone || m_nodes[node.m_children[c]].m_parent != c_gltfNone)
+			{
+				return false;
+			}
+
+			m_nodes[node.m_children[c]].m_parent = i;
+		}
+
+		const UINT matrix = document.find(nodeValue, "matrix");
+
+		if (matrix != c_jsonNone)
+		{
+			float columnMajor[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+			readFloats(document, matrix, columnMajor, 16);
+			mirrorMatrix(columnMajor, node.m_local);
+		}
+		else
+		{
+			float translation[3] = { 0.0f, 0.0f, 0.0f };
+			float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			float scale[3] = { 1.0f, 1.0f, 1.0f };
+			readFloats(document, document.find(nodeValue, "translation"), translation, 3);
+			readFloats(document, document.find(nodeValue, "rotation"), rotation, 4);
+			readFloats(document, document.find(nodeValue, "scale"), scale, 3);
+
+			// mirrored in z the translation's z flips, and so does the rotation's direction about x and y
+			translation[2] = -translation[2];
+			rotation[0] = -rotation[0];
+			rotation[1] = -rotation[1];
+
+			composeMatrix(translation, rotation, scale, node.m_local);
+		}
+	}
+
+	// a loop of nodes has no root, walking up from any of them never ends
+	for (UINT i = 0; i < m_nodes.size(); ++i)
+	{
+		UINT depth = 0;
+
+		for (UINT parent = m_nodes[i].m_parent; parent != c_gltfNone; parent = m_nodes[parent].m_parent)
+		{
+			if (++depth > m_nodes.size())
+			{
+				return false;
+			}
+		}
+	}
+
+	const UINT scenes = document.find(root, "scenes");
+	const UINT scene = document.getElement(scenes, document.getUint(document.find(root, "scene"), 0));
+
+	if (scene != c_jsonNone)
+	{
+		const UINT sceneNodes = document.find(scene, "nodes");
+
+		for (UINT i = 0, node = document.getFirstChild(sceneNodes); i < document.getSize(sceneNodes); ++i, node = document.getNextSibling(node))
+		{
+			const UINT index = readIndex(document, node, m_nodes.size());
+
+			if (index == c_gltfNone || m_nodes[index].m_parent != c_gltfNone)
+			{
+				return false;
+			}
+
+			m_sceneRoots.push_back(index);
+		}
+	}
+	else
+	{
+		for (UINT i = 0; i < m_nodes.size(); ++i)
+		{
+			if (m_nodes[i].m_parent == c_gltfNone)
+			{
+				m_sceneRoots.push_back(i);
+			}
+		}
+	}
+
+	return true;
+}
+
+void GltfAsset::readElement(const GltfAccessor & accessor, const UINT index, float * out)
+{
+	const UINT8 * element = accessor.m_data + static_cast<size_t>(index) * accessor.m_stride;
+
+	switch (accessor.m_componentType)
+	{
+	case GLTF_FLOAT:
+		memcpy(out, element, sizeof(float) * accessor.m_components);
+		break;
+	case GLTF_BYTE:
+		for (UINT c = 0; c < accessor.m_components; ++c)
+		{
+			const float value = static_cast<float>(static_cast<INT8>(element[c]));
+			out[c] = accessor.m_normalised ? std::max(value / 127.0f, -1.0f) : value;
+		}
+		break;
+	case GLTF_UNSIGNED_BYTE:
+		for (UINT c = 0; c < accessor.m_components; ++c)
+		{
+			out[c] = accessor.m_normalised ? element[c] / 255.0f : static_cast<float>(element[c]);
+		}
+		break;
+	case GLTF_SHORT:
+		for (UINT c = 0; c < accessor.m_components; ++c)
+		{
+			INT16 value;
+			memcpy(&value, element + c * sizeof(value), sizeof(value));
+			out[c] = accessor.m_normalised ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+		}
+		break;
+	case GLTF_UNSIGNED_SHORT:
+		for (UINT c = 0; c < accessor.m_components; ++c)
+		{
+			UINT16 value;
+			memcpy(&value, element + c * sizeof(value), sizeof(value));
+			out[c] = accessor.m_normalised ? value / 65535.0f : static_cast<float>(value);
+		}
+		break;
+	case GLTF_UNSIGNED_INT:
+		for (UINT c = 0; c < accessor.m_components; ++c)
+		{
+			UINT32 value;
+			memcpy(&value, element + c * sizeof(value), sizeof(value));
+			out[c] = accessor.m_normalised ? static_cast<float>(value / 4294967295.0) : static_cast<float>(value);
+		}
+		break;
+	}
+}
+
+bool GltfAsset::getVertexView(const GltfPrimitive & primitive, const Vertex *& vertices, UINT & count) const
+{
+	if (primitive.m_colours == c_gltfNone)
+	{
+		return false;
+	}
+
+	const GltfAccessor & positions = m_accessors[primitive.m_positions];
+	const GltfAccessor & colours = m_accessors[primitive.m_colours];
+
+	// both accessors were range checked, so a whole Vertex fits at every element
+	if (positions.m_componentType != GLTF_FLOAT || positions.m_components != 3 || positions.m_stride != sizeof(Vertex) ||
+		colours.m_componentType != GLTF_FLOAT || colours.m_components != 4 || colours.m_stride != sizeof(Vertex) ||
+		colours.m_data != positions.m_data + offsetof(Vertex, m_colour) || colours.m_count != positions.m_count ||
+		reinterpret_cast<uintptr_t>(positions.m_data) % alignof(Vertex) != 0)
+	{
+		return false;
+	}
+
+	vertices = reinterpret_cast<const Vertex*>(positions.m_data);
+	count = positions.m_count;
+
+	return true;
+}
+
+bool GltfAsset::getIndexView(const GltfPrimitive & primitive, const UINT *& indices, UINT & count) const
+{
+	if (primitive.m_indices == c_gltfNone || primitive.m_mode != GLTF_TRIANGLES)
+	{
+		return false;
+	}
+
+	const GltfAccessor & accessor = m_accessors[primitive.m_indices];
+	const UINT vertexCount = m_accessors[primitive.m_positions].m_count;
+
+	if (accessor.m_componentType != GLTF_UNSIGNED_INT || accessor.m_components != 1 || accessor.m_stride != sizeof(UINT) ||
+		accessor.m_count % 3 != 0 || reinterpret_cast<uintptr_t>(accessor.m_data) % alignof(UINT) != 0)
+	{
+		return false;
+	}
+
+	// the GPU would read past the vertex buffer, one pass over the indices is still much less than copying them
+	const UINT * data = reinterpret_cast<const UINT*>(accessor.m_data);
+
+	for (UINT i = 0; i < accessor.m_count; ++i)
+	{
+		if (data[i] >= vertexCount)
+		{
+			return false;
+		}
+	}
+
+	indices = data;
+	count = accessor.m_count;
+
+	return true;
+}
+
+bool GltfAsset::readVertices(const GltfPrimitive & primitive, std::vector<Vertex> & vertices) const
+{
+	const GltfAccessor & positions = m_accessors[primitive.m_positions];
+	const GltfAccessor * colours = primitive.m_colours == c_gltfNone ? nullptr : &m_accessors[primitive.m_colours];
+
+	if (positions.m_components != 3 || (colours != nullptr && (colours->m_count != positions.m_count || colours->m_components < 3 || colours->m_components > 4)))
+	{
+		return false;
+	}
+
+	const size_t first = vertices.size();
+	vertices.resize(first + positions.m_count);
+
+	for (UINT i = 0; i < positions.m_count; ++i)
+	{
+		Vertex & vertex = vertices[first + i];
+		readElement(positions, i, &vertex.m_position.x);
+		vertex.m_position.z = -vertex.m_position.z;
+
+		if (colours != nullptr)
+		{
+			readElement(*colours, i, &vertex.m_colour.x);
+		}
+	}
+
+	return true;
+}
+
+bool GltfAsset::readSkinnedVertices(const GltfPrimitive & primitive, std::vector<SkinnedVertex> & vertices) const
+{
+	if (primitive.m_joints == c_gltfNone || primitive.m_weights == c_gltfNone)
+	{
+		return false;
+	}
+
+	std::vector<Vertex> unskinned;
+
+	if (!readVertices(primitive, unskinned))
+	{
+		return false;
+	}
+
+	const GltfAccessor & joints = m_accessors[primitive.m_joints];
+	const GltfAccessor & weights = m_accessors[primitive.m_weights];
+
+	if (joints.m_components != 4 || weights.m_components != 4 || joints.m_count != unskinned.size() || weights.m_count != unskinned.size() ||
+		(joints.m_componentType != GLTF_UNSIGNED_BYTE && joints.m_componentType != GLTF_UNSIGNED_SHORT))
+	{
+		return false;
+	}
+
+	const size_t first = vertices.size();
+	vertices.resize(first + unskinned.size());
+
+	for (UINT i = 0; i < unskinned.size(); ++i)
+	{
+		SkinnedVertex & vertex = vertices[first + i];
+		vertex.m_position = unskinned[i].m_position;
+		vertex.m_colour = unskinned[i].m_colour;
+
+		float jointValues[c_maxBoneInfluences];
+		float weightValues[c_maxBoneInfluences];
+		readElement(joints, i, jointValues);
+		readElement(weights, i, weightValues);
+
+		// quantising wants the heaviest first, glTF doesn't order them
+		UINT order[c_maxBoneInfluences] = { 0, 1, 2, 3 };
+
+		for (UINT a = 1; a < c_maxBoneInfluences; ++a)
+		{
+			for (UINT b = a; b > 0 && weightValues[order[b]] > weightValues[order[b - 1]]; --b)
+			{
+				std::swap(order[b], order[b - 1]);
+			}
+		}
+
+		float sorted[c_maxBoneInfluences];
+
+		for (UINT a = 0; a < c_maxBoneInfluences; ++a)
+		{
+			if (jointValues[order[a]] >= c_maxSkinBones)
+			{
+				vertices.resize(first);
+				return false;
+			}
+
+			vertex.m_boneIndices[a] = static_cast<UINT8>(jointValues[order[a]]);
+			sorted[a] = weightValues[order[a]];
+		}
+
+		quantiseBoneWeights(sorted, vertex.m_boneWeights);
+	}
+
+	return true;
+}
+
+bool GltfAsset::readNormals(const GltfPrimitive & primitive, std::vector<DirectX::XMFLOAT3> & normals) const
+{
+	if (primitive.m_normals == c_gltfNone || m_accessors[primitive.m_normals].m_components != 3)
+	{
+		return false;
+	}
+
+	const GltfAccessor & accessor = m_accessors[primitive.m_normals];
+	const size_t first = normals.size();
+	normals.resize(first + accessor.m_count);
+
+	for (UINT i = 0; i < accessor.m_count; ++i)
+	{
+		readElement(accessor, i, &normals[first + i].x);
+		normals[first + i].z = -normals[first + i].z;
+	}
+
+	return true;
+}
+
+bool GltfAsset::readIndices(const GltfPrimitive & primitive, const UINT baseVertex, std::vector<UINT> & indices) const
+{
+	if (primitive.m_mode != GLTF_TRIANGLES && primitive.m_mode != GLTF_TRIANGLE_STRIP && primitive.m_mode != GLTF_TRIANGLE_FAN)
+	{
+		return false;
+	}
+
+	const UINT vertexCount = m_accessors[primitive.m_positions].m_count;
+	const GltfAccessor * accessor = primitive.m_indices == c_gltfNone ? nullptr : &m_accessors[primitive.m_indices];
+	const UINT count = accessor != nullptr ? accessor->m_count : vertexCount;
+
+	if (accessor != nullptr && accessor->m_components != 1)
+	{
+		return false;
+	}
+
+	const auto fetch = [&](const UINT i) { return accessor != nullptr ? readElementIndex(*accessor, i) : i; };
+
+	const size_t first = indices.size();
+
+	if (primitive.m_mode == GLTF_TRIANGLES)
+	{
+		indices.reserve(first + count);
+
+		for (UINT i = 0; i + 2 < count; i += 3)
+		{
+			indices.push_back(fetch(i));
+			indices.push_back(fetch(i + 1));
+			indices.push_back(fetch(i + 2));
+		}
+	}
+	else if (count >= 3)
+	{
+		indices.reserve(first + (count - 2) * 3);
+
+		for (UINT i = 0; i + 2 < count; ++i)
+		{
+			if (primitive.m_mode == GLTF_TRIANGLE_FAN)
+			{
+				indices.push_back(fetch(i + 1));
+				indices.push_back(fetch(i + 2));
+				indices.push_back(fetch(0));
+			}
+			else
+			{
+				// every other triangle of a strip is turned around to keep the winding
+				indices.push_back(fetch(i));
+				indices.push_back(fetch(i + 1 + i % 2));
+				indices.push_back(fetch(i + 2 - i % 2));
+			}
+		}
+	}
+
+	for (size_t i = first; i < indices.size(); ++i)
+	{
+		if (indices[i] >= vertexCount)
+		{
+			indices.resize(first);
+			return false;
+		}
+
+		indices[i] += baseVertex;
+	}
+
+	return true;
+}
+
+bool GltfAsset::readInverseBindMatrices(const GltfSkin & skin, std::vector<DirectX::XMFLOAT4X4> & matrices) const
+{
+	matrices.resize(skin.m_joints.size());
+
+	for (UINT i = 0; i < skin.m_joints.size(); ++i)
+	{
+		if (skin.m_inverseBindMatrices == c_gltfNone)
+		{
+			setIdentity(matrices[i]);
+			continue;
+		}
+
+		float columnMajor[16];
+		readElement(m_accessors[skin.m_inverseBindMatrices], i, columnMajor);
+		mirrorMatrix(columnMajor, matrices[i]);
+	}
+
+	return true;
+}
+
+void GltfAsset::computeWorldTransforms(std::vector<DirectX::XMFLOAT4X4> & world) const
+{
+	world.resize(m_nodes.size());
+
+	// parents before children, open() made sure every node is under exactly one root
+	std::vector<UINT> stack;
+
+	for (UINT i = 0; i < m_nodes.size(); ++i)
+	{
+		if (m_nodes[i].m_parent == c_gltfNone)
+		{
+			world[i] = m_nodes[i].m_local;
+			stack.push_back(i);
+		}
+	}
+
+	while (!stack.empty())
+	{
+		const UINT parent = stack.back();
+		stack.pop_back();
+
+		for (size_t c = 0; c < m_nodes[parent].m_children.size(); ++c)
+		{
+			const UINT child = m_nodes[parent].m_children[c];
+			multiply(m_nodes[child].m_local, world[parent], world[child]);
+			stack.push_back(child);
+		}
+	}
+}
@@ -0,0 +1,201 @@
+#pragma once
+#ifndef _GLTF_LOADER_H_
+#define _GLTF_LOADER_H_
+
+#include <DirectXMath.h>
+
+#include <climits>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+#include "AssetFileSystem.h"
+#include "Geomatry.h"
+
+// accessor component types, the values are the ones the file uses
+enum GltfComponentType
+{
+	GLTF_BYTE = 5120,
+	GLTF_UNSIGNED_BYTE = 5121,
+	GLTF_SHORT = 5122,
+	GLTF_UNSIGNED_SHORT = 5123,
+	GLTF_UNSIGNED_INT = 5125,
+	GLTF_FLOAT = 5126
+};
+
+enum GltfPrimitiveMode
+{
+	GLTF_POINTS = 0,
+	GLTF_LINES = 1,
+	GLTF_LINE_LOOP = 2,
+	GLTF_LINE_STRIP = 3,
+	GLTF_TRIANGLES = 4,
+	GLTF_TRIANGLE_STRIP = 5,
+	GLTF_TRIANGLE_FAN = 6
+};
+
+// an index the file didn't set: no material, no parent, no mesh on a node...
+const UINT c_gltfNone = UINT_MAX;
+
+// where an accessor's elements are once its buffer view has been resolved and range checked
+struct GltfAccessor
+{
+	const UINT8 * m_data;	// the first element
+	UINT m_count;
+	UINT m_stride;			// bytes from one element to the next, the element size when the view is tightly packed
+	GltfComponentType m_componentType;
+	UINT m_components;		// 1 for SCALAR up to 16 for MAT4
+	bool m_normalised;
+};
+
+// accessor indices, c_gltfNone for attributes it doesn't have
+struct GltfPrimitive
+{
+	UINT m_positions;
+	UINT m_normals;
+	UINT m_texCoords;
+	UINT m_colours;
+	UINT m_joints;
+	UINT m_weights;
+	UINT m_indices;
+	UINT m_material;
+	GltfPrimitiveMode m_mode;
+};
+
+struct GltfMesh
+{
+	std::string m_name;
+	std::vector<GltfPrimitive> m_primitives;
+};
+
+// metallic roughness, the textures are image indices (the texture and its sampler are looked through)
+struct GltfMaterial
+{
+	std::string m_name;
+	DirectX::XMFLOAT4 m_baseColour;
+	float m_metallic;
+	float m_roughness;
+	DirectX::XMFLOAT3 m_emissive;
+	float m_alphaCutoff;	// 0 unless the alpha mode is MASK
+	bool m_doubleSided;
+
+	UINT m_baseColourImage;
+	UINT m_metallicRoughnessImage;
+	UINT m_normalImage;
+	UINT m_occlusionImage;
+	UINT m_emissiveImage;
+};
+
+// either a file next to the asset or, in a .glb, data in one of its buffers
+struct GltfImage
+{
+	std::string m_name;
+	std::string m_uri;			// empty when it is in a buffer
+	std::string m_mimeType;
+	const UINT8 * m_data;		// nullptr unless it is in a buffer
+	size_t m_size;
+};
+
+// m_local is left handed and laid out for row vectors, like every other matrix in the engine
+struct GltfNode
+{
+	std::string m_name;
+	UINT m_parent;
+	std::vector<UINT> m_children;
+	UINT m_mesh;
+	UINT m_skin;
+	DirectX::XMFLOAT4X4 m_local;
+};
+
+struct GltfSkin
+{
+	std::string m_name;
+	std::vector<UINT> m_joints;		// nodes, a vertex's JOINTS_0 indexes this list
+	UINT m_inverseBindMatrices;		// accessor, c_gltfNone means identity for every joint
+	UINT m_skeleton;
+};
+
+struct GltfLoadStats
+{
+	UINT64 m_bytes;			// the file and any buffers it loads
+	UINT m_jsonValues;
+	UINT m_buffers;
+	UINT m_accessors;
+	UINT m_meshes;
+	UINT m_nodes;
+	double m_seconds;
+};
+
+// a .glb or .gltf read through the asset file system. the file stays mapped and accessors point straight into
+// it, nothing is copied while loading apart from buffers embedded as base64 "data:" URIs. the JSON is parsed in
+// place by JsonDocument and only what the engine uses is kept.
+// glTF is right handed, so what comes out is mirrored in z to match aiProcess_MakeLeftHanded: node and inverse
+// bind matrices are converted on load, vertices when they are read. getVertexView() is the exception, it hands
+// out the file's data as is and the caller draws it with getMirrorZ() in front of its world matrix.
+// not handled: sparse accessors, morph targets, animations, cameras, extensions (the asset is rejected if it
+// requires one)
+class GltfAsset
+{
+public:
+	GltfAsset();
+	~GltfAsset();
+
+	GltfAsset(const GltfAsset &) = delete;
+	GltfAsset & operator=(const GltfAsset &) = delete;
+
+	// .glb by the magic at the start, JSON otherwise. external buffers are looked up next to it.
+	// false (and nothing kept) if anything in it is out of range or can't be read
+	bool open(AssetFileSystem & fileSystem, const std::string & path, GltfLoadStats & stats);
+
+	const std::vector<GltfAccessor> & getAccessors() const { return m_accessors; }
+	const std::vector<GltfMesh> & getMeshes() const { return m_meshes; }
+	const std::vector<GltfMaterial> & getMaterials() const { return m_materials; }
+	const std::vector<GltfImage> & getImages() const { return m_images; }
+	const std::vector<GltfNode> & getNodes() const { return m_nodes; }
+	const std::vector<GltfSkin> & getSkins() const { return m_skins; }
+	// the nodes of the default scene, or every node without a parent if it doesn't say
+	const std::vector<UINT> & getSceneRoots() const { return m_sceneRoots; }
+
+	// the primitive's vertices in place when the file already has them as Vertex (float3 POSITION with a float4
+	// COLOR_0 right after it, interleaved at sizeof(Vertex)), ready to upload. false means it needs readVertices()
+	bool getVertexView(const GltfPrimitive & primitive, const Vertex *& vertices, UINT & count) const;
+	// the same for a triangle list of tightly packed 32 bit indices
+	bool getIndexView(const GltfPrimitive & primitive, const UINT *& indices, UINT & count) const;
+
+	// converted and appended, colours default to white
+	bool readVertices(const GltfPrimitive & primitive, std::vector<Vertex> & vertices) const;
+	bool readSkinnedVertices(const GltfPrimitive & primitive, std::vector<SkinnedVertex> & vertices) const;
+	bool readNormals(const GltfPrimitive & primitive, std::vector<DirectX::XMFLOAT3> & normals) const;
+	// appended as a triangle list with baseVertex added, strips and fans are unrolled. a primitive without indices
+	// gets 0 to n - 1. false for points and lines, or an index past the end of the vertices
+	bool readIndices(const GltfPrimitive & primitive, const UINT baseVertex, std::vector<UINT> & indices) const;
+
+	// one per joint, mesh space into the joint's space
+	bool readInverseBindMatrices(const GltfSkin & skin, std::vector<DirectX::XMFLOAT4X4> & matrices) const;
+	// every node's local matrix times its parents', one per node
+	void computeWorldTransforms(std::vector<DirectX::XMFLOAT4X4> & world) const;
+
+	static DirectX::XMFLOAT4X4 getMirrorZ();
+
+	// element index of the accessor as floats, integer types scaled to 0-1 / -1-1 when the accessor is normalised
+	static void readElement(const GltfAccessor & accessor, const UINT index, float * out);
+
+private:
+
+	bool parseDocument(const char * json, const size_t jsonSize, const AssetView & binaryChunk, AssetFileSystem & fileSystem,
+		const std::string & directory, GltfLoadStats & stats);
+	void clear();
+
+	AssetView m_file;
+	std::vector<AssetView> m_buffers;
+	std::vector<GltfAccessor> m_accessors;
+	std::vector<GltfMesh> m_meshes;
+	std::vector<GltfMaterial> m_materials;
+	std::vector<GltfImage> m_images;
+	std::vector<GltfNode> m_nodes;
+	std::vector<GltfSkin> m_skins;
+	std::vector<UINT> m_sceneRoots;
+};
+
+#endif // _GLTF_LOADER_H_
@@ -0,0 +1,304 @@
+#include "ImageDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const size_t c_tgaHeaderSize = 18;
+
+	float srgbToLinear(const UINT8 value)
+	{
+		// table so decoding a texel is a lookup, built once on first use
+		static const std::vector<float> table = []()
+		{
+			std::vector<float> values(256);
+
+			for (UINT i = 0; i < 256; ++i)
+			{
+				const float c = i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+
+			return values;
+		}();
+
+		return table[value];
+	}
+
+	UINT8 linearToSrgb(const float value)
+	{
+		const float c = std::min(std::max(value, 0.0f), 1.0f);
+		const float encoded = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		return static_cast<UINT8>(encoded * 255.0f + 0.5f);
+	}
+
+	void readTgaPixel(const UINT8 * src, const UINT bytesPerPixel, UINT8 * dst)
+	{
+		if (bytesPerPixel == 1)
+		{
+			dst[0] = src[0];
+			dst[1] = src[0];
+			dst[2] = src[0];
+			dst[3] = 255;
+		}
+		else
+		{
+			// stored as b, g, r (, a)
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = bytesPerPixel == 4 ? src[3] : 255;
+		}
+	}
+}
+
+bool decodeTga(const UINT8 * data, const size_t size, DecodedImage & image)
+{
+	if (data == nullptr || size < c_tgaHeaderSize)
+	{
+		return false;
+	}
+
+	const UINT idLength = data[0];
+	const UINT colourMapType = data[1];
+	const UINT imageType = data[2];
+	const UINT width = data[12] | (data[13] << 8);
+	const UINT height = data[14] | (data[15] << 8);
+	const UINT bitsPerPixel = data[16];
+	const UINT descriptor = data[17];
+
+	const bool rle = imageType == 10 || imageType == 11;
+	const bool greyscale = imageType == 3 || imageType == 11;
+
+	// no colour mapped images
+	if (colourMapType != 0 || !(imageType == 2 || imageType == 3 || imageType == 10 || imageType == 11))
+	{
+		return false;
+	}
+
+	if ((greyscale && bitsPerPixel != 8) || (!greyscale && bitsPerPixel != 24 && bitsPerPixel != 32))
+	{
+		return false;
+	}
+
+	if (width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	const UINT bytesPerPixel = bitsPerPixel / 8;
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+
+	// unpack everything in file order first, then flip into top-down rows
+	std::vector<UINT8> filePixels(pixelCount * 4);
+
+	const UINT8 * src = data + c_tgaHeaderSize + idLength;
+	const UINT8 * end = data + size;
+
+	if (src > end)
+	{
+		return false;
+	}
+
+	if (!rle)
+	{
+		if (static_cast<size_t>(end - src) < pixelCount * bytesPerPixel)
+		{
+			return false;
+		}
+
+		for (size_t p = 0; p < pixelCount; ++p)
+		{
+			readTgaPixel(src + p * bytesPerPixel, bytesPerPixel, &filePixels[p * 4]);
+		}
+	}
+	else
+	{
+		size_t p = 0;
+
+		while (p < pixelCount)
+		{
+			if (src >= end)
+			{
+				return false;
+			}
+
+			const UINT packet = *src++;
+			const size_t count = std::min<size_t>((packet & 0x7f) + 1, pixelCount - p);
+
+			if (packet & 0x80)
+			{
+				// run of one pixel
+				if (static_cast<size_t>(end - src) < bytesPerPixel)
+				{
+					return false;
+				}
+
+				UINT8 pixel[4];
+				readTgaPixel(src, bytesPerPixel, pixel);
+				src += bytesPerPixel;
+
+				for (size_t i = 0; i < count; ++i, ++p)
+				{
+					std::copy(pixel, pixel + 4, &filePixels[p * 4]);
+				}
+			}
+			else
+			{
+				if (static_cast<size_t>(end - src) < count * bytesPerPixel)
+				{
+					return false;
+				}
+
+				for (size_t i = 0; i < count; ++i, ++p)
+				{
+					readTgaPixel(src, bytesPerPixel, &filePixels[p * 4]);
+					src += bytesPerPixel;
+				}
+			}
+		}
+	}
+
+	// bit 5 set means the first row is the top, bit 4 means right to left
+	const bool topToBottom = (descriptor & 0x20) != 0;
+	const bool rightToLeft = (descriptor & 0x10) != 0;
+
+	image.m_width = width;
+	image.m_height = height;
+	image.m_pixels.resize(pixelCount * 4);
+
+	for (UINT y = 0; y < height; ++y)
+	{
+		const UINT srcY = topToBottom ? y : height - 1 - y;
+
+		for (UINT x = 0; x < width; ++x)
+		{
+			const UINT srcX = rightToLeft ? width - 1 - x : x;
+			const UINT8 * from = &filePixels[(static_cast<size_t>(srcY) * width + srcX) * 4];
+			std::copy(from, from + 4, &image.m_pixels[(static_cast<size_t>(y) * width + x) * 4]);
+		}
+	}
+
+	return true;
+}
+
+void decodeBgra8(const UINT8 * data, const UINT width, const UINT height, DecodedImage & image)
+{
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+
+	image.m_width = width;
+	image.m_height = height;
+	image.m_pixels.resize(pixelCount * 4);
+
+	for (size_t p = 0; p < pixelCount; ++p)
+	{
+		image.m_pixels[p * 4 + 0] = data[p * 4 + 2];
+		image.m_pixels[p * 4 + 1] = data[p * 4 + 1];
+		image.m_pixels[p * 4 + 2] = data[p * 4 + 0];
+		image.m_pixels[p * 4 + 3] = data[p * 4 + 3];
+	}
+}
+
+std::vector<DecodedImage> buildMipChain(DecodedImage && source, const bool srgb)
+{
+	std::vector<DecodedImage> mips;
+	mips.push_back(std::move(source));
+
+	// srgb levels are filtered from a linear float copy of the previous level, so rounding doesn't build up
+	std::vector<float> linear;
+
+	if (srgb)
+	{
+		const std::vector<UINT8> & pixels = mips[0].m_pixels;
+		linear.resize(pixels.size());
+
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			linear[i] = (i % 4 == 3) ? pixels[i] / 255.0f : srgbToLinear(pixels[i]);
+		}
+	}
+
+	while (mips.back().m_width > 1 || mips.back().m_height > 1)
+	{
+		const UINT previousWidth = mips.back().m_width;
+		const UINT previousHeight = mips.back().m_height;
+
+		DecodedImage mip;
+		mip.m_width = std::max(previousWidth / 2, 1u);
+		mip.m_height = std::max(previousHeight / 2, 1u);
+		mip.m_pixels.resize(static_cast<size_t>(mip.m_width) * mip.m_height * 4);
+
+		std::vector<float> nextLinear(srgb ? mip.m_pixels.size() : 0);
+
+		for (UINT y = 0; y < mip.m_height; ++y)
+		{
+			// each destination texel covers [y0, y1) of the previous level, 3 wide at an odd edge
+			const UINT y0 = y * previousHeight / mip.m_height;
+			const UINT y1 = std::max((y + 1) * previousHeight / mip.m_height, y0 + 1);
+
+			for (UINT x = 0; x < mip.m_width; ++x)
+			{
+				const UINT x0 = x * previousWidth / mip.m_width;
+				const UINT x1 = std::max((x + 1) * previousWidth / mip.m_width, x0 + 1);
+
+				const UINT count = (y1 - y0) * (x1 - x0);
+				const size_t outIndex = (static_cast<size_t>(y) * mip.m_width + x) * 4;
+				UINT8 * out = &mip.m_pixels[outIndex];
+
+				if (srgb)
+				{
+					float sum[4] = {};
+
+					for (UINT sy = y0; sy < y1; ++sy)
+					{
+						for (UINT sx = x0; sx < x1; ++sx)
+						{
+							const float * texel = &linear[(static_cast<size_t>(sy) * previousWidth + sx) * 4];
+
+							for (UINT c = 0; c < 4; ++c)
+							{
+								sum[c] += texel[c];
+							}
+						}
+					}
+
+					for (UINT c = 0; c < 4; ++c)
+					{
+						const float value = sum[c] / static_cast<float>(count);
+						nextLinear[outIndex + c] = value;
+						out[c] = c == 3 ? static_cast<UINT8>(value * 255.0f + 0.5f) : linearToSrgb(value);
+					}
+				}
+				else
+				{
+					const std::vector<UINT8> & previous = mips.back().m_pixels;
+					UINT sum[4] = {};
+
+					for (UINT sy = y0; sy < y1; ++sy)
+					{
+						for (UINT sx = x0; sx < x1; ++sx)
+						{
+							const UINT8 * texel = &previous[(static_cast<size_t>(sy) * previousWidth + sx) * 4];
+
+							for (UINT c = 0; c < 4; ++c)
+							{
+								sum[c] += texel[c];
+							}
+						}
+					}
+
+					for (UINT c = 0; c < 4; ++c)
+					{
+						out[c] = static_cast<UINT8>((sum[c] + count / 2) / count);
+					}
+				}
+			}
+		}
+
+		mips.push_back(std::move(mip));
+		linear.swap(nextLinear);
+	}
+
+	return mips;
+}
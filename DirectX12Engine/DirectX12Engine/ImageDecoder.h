@@ -0,0 +1,29 @@
+#pragma once
+#ifndef _IMAGE_DECODER_H_
+#define _IMAGE_DECODER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include <Windows.h>
+
+// tightly packed RGBA8, top row first
+struct DecodedImage
+{
+	UINT m_width;
+	UINT m_height;
+	std::vector<UINT8> m_pixels;
+};
+
+// truecolour and greyscale TGA, plain or RLE, 8/24/32 bits. returns false on anything else or a short buffer
+bool decodeTga(const UINT8 * data, const size_t size, DecodedImage & image);
+
+// assimp stores uncompressed embedded textures as aiTexel, which is b, g, r, a
+void decodeBgra8(const UINT8 * data, const UINT width, const UINT height, DecodedImage & image);
+
+// box filtered mips down to 1x1, mips[0] is the source. odd sizes round down and the last row / column is
+// folded into its neighbour so nothing is dropped. srgb filters colour in linear space (alpha is always
+// linear), otherwise dark to light edges get darker with every level
+std::vector<DecodedImage> buildMipChain(DecodedImage && source, const bool srgb = false);
+
+#endif // _IMAGE_DECODER_H_
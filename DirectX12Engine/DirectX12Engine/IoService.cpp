@@ -0,0 +1,560 @@
+#include "IoService.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	const UINT c_defaultMaxInFlight = 8;
+	// a gap smaller than this is cheaper to read through than to issue a second read for
+	const UINT64 c_defaultMergeGap = 64 * 1024;
+	const UINT64 c_defaultMaxMergedBytes = 8 * 1024 * 1024;
+
+	struct Range
+	{
+		IoTicket m_ticket;
+		UINT64 m_offset;
+		UINT64 m_end;
+	};
+}
+
+IoService::IoService(IoBackend * backend)
+	: m_backend(backend)
+	, m_maxInFlight(c_defaultMaxInFlight)
+	, m_mergeGap(c_defaultMergeGap)
+	, m_maxMergedBytes(c_defaultMaxMergedBytes)
+	, m_nextTicket(1)
+	, m_nextReadTag(1)
+	, m_readsInFlight(0)
+	, m_stats()
+	, m_quit(false)
+{
+	assert(m_backend != nullptr);
+}
+
+IoService::~IoService()
+{
+	stop();
+}
+
+void IoService::setLimits(const UINT maxInFlight, const UINT64 mergeGap, const UINT64 maxMergedBytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_maxInFlight = std::max(maxInFlight, 1u);
+	m_mergeGap = mergeGap;
+	m_maxMergedBytes = maxMergedBytes;
+}
+
+void IoService::start()
+{
+	if (m_thread.joinable())
+	{
+		return;
+	}
+
+	m_quit = false;
+	m_thread = std::thread(&IoService::run, this);
+}
+
+void IoService::stop()
+{
+	if (!m_thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+
+	m_backend->wake();
+	m_thread.join();
+}
+
+IoTicket IoService::enqueue(IoRequest && request)
+{
+	IoTicket ticket = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		ticket = m_nextTicket++;
+
+		PendingRequest & pending = m_requests[ticket];
+		pending.m_request = std::move(request);
+		pending.m_status = IO_STATUS_PENDING;
+		pending.m_started = false;
+		pending.m_cancelRequested = false;
+		pending.m_data = AssetView();
+
+		m_queues[pending.m_request.m_priority].push_back(ticket);
+		m_files[pending.m_request.m_path].m_waiting.push_back(ticket);
+		++m_stats.m_requests;
+	}
+
+	m_backend->wake();
+
+	return ticket;
+}
+
+bool IoService::cancel(const IoTicket ticket)
+{
+	std::vector<FinishedRequest> finished;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto request = m_requests.find(ticket);
+
+		if (request == m_requests.end() || request->second.m_status != IO_STATUS_PENDING || request->second.m_cancelRequested)
+		{
+			return false;
+		}
+
+		if (request->second.m_started)
+		{
+			// the backend is still writing into its buffer, it is reported when the read lands
+			request->second.m_cancelRequested = true;
+			return true;
+		}
+
+		const std::string path = request->second.m_request.m_path;
+		std::vector<IoTicket> & waiting = m_files[path].m_waiting;
+		waiting.erase(std::remove(waiting.begin(), waiting.end(), ticket), waiting.end());
+
+		// left in its priority queue, it is skipped when it comes up
+		finish(ticket, IO_STATUS_CANCELLED, AssetView(), finished);
+		releaseFileIfIdle(path);
+	}
+
+	// before it started, so the callback runs here rather than on the io thread
+	for (FinishedRequest & request : finished)
+	{
+		request.m_callback(request.m_ticket, request.m_status, request.m_data);
+	}
+
+	return true;
+}
+
+IoStatus IoService::wait(const IoTicket ticket, AssetView & data)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto request = m_requests.find(ticket);
+
+	if (request == m_requests.end() || request->second.m_request.m_onComplete)
+	{
+		// already collected, or its result goes to the callback
+		data = AssetView();
+		return IO_STATUS_FAILED;
+	}
+
+	// the lock is dropped while waiting, an enqueue from another thread can rehash m_requests under the
+	// iterator, so the ticket is looked up again every time it is checked
+	m_completed.wait(lock, [&]()
+	{
+		auto pending = m_requests.find(ticket);
+		return pending == m_requests.end() || pending->second.m_status != IO_STATUS_PENDING;
+	});
+
+	request = m_requests.find(ticket);
+
+	if (request == m_requests.end())
+	{
+		// another wait on the same ticket collected it first
+		data = AssetView();
+		return IO_STATUS_FAILED;
+	}
+
+	const IoStatus status = request->second.m_status;
+	data = std::move(request->second.m_data);
+	m_requests.erase(request);
+
+	return status;
+}
+
+IoStats IoService::getStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_stats;
+}
+
+void IoService::run()
+{
+	std::vector<FinishedRequest> finished;
+	std::vector<IoCompletion> completions;
+
+	for (;;)
+	{
+		bool done = false;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (m_quit)
+			{
+				cancelWaiting(finished);
+			}
+
+			while (m_readsInFlight < m_maxInFlight && startNextRead(finished))
+			{
+			}
+
+			// reads in flight are waited out, the backend is still writing into their buffers
+			done = m_quit && m_readsInFlight == 0;
+		}
+
+		for (FinishedRequest & request : finished)
+		{
+			request.m_callback(request.m_ticket, request.m_status, request.m_data);
+		}
+
+		finished.clear();
+
+		if (done)
+		{
+			break;
+		}
+
+		completions.clear();
+		m_backend->waitForCompletions(completions);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (const IoCompletion & completion : completions)
+		{
+			// 0 is a wake up
+			if (completion.m_tag != 0)
+			{
+				completeRead(completion.m_tag, completion.m_bytesRead, completion.m_succeeded, finished);
+			}
+		}
+	}
+}
+
+bool IoService::startNextRead(std::vector<FinishedRequest> & finished)
+{
+	for (UINT priority = 0; priority < IO_PRIORITY_COUNT; ++priority)
+	{
+		std::deque<IoTicket> & queue = m_queues[priority];
+
+		while (!queue.empty())
+		{
+			const IoTicket seed = queue.front();
+			queue.pop_front();
+
+			auto seedRequest = m_requests.find(seed);
+
+			// cancelled or already pulled into an earlier read
+			if (seedRequest == m_requests.end() || seedRequest->second.m_status != IO_STATUS_PENDING || seedRequest->second.m_started)
+			{
+				continue;
+			}
+
+			const std::string path = seedRequest->second.m_request.m_path;
+			OpenFile & file = m_files[path];
+
+			if (!file.m_opened)
+			{
+				if (!m_backend->openFile(path, file.m_handle, file.m_size))
+				{
+					// everything waiting on the file fails with it
+					const std::vector<IoTicket> waiting = std::move(file.m_waiting);
+					m_files.erase(path);
+
+					for (const IoTicket ticket : waiting)
+					{
+						finish(ticket, IO_STATUS_FAILED, AssetView(), finished);
+					}
+
+					return true;
+				}
+
+				file.m_opened = true;
+				++m_stats.m_filesOpened;
+			}
+
+			// the ranges of everything waiting on the file, the ones that can't be read are finished here
+			std::vector<Range> ranges;
+			ranges.reserve(file.m_waiting.size());
+
+			for (const IoTicket ticket : file.m_waiting)
+			{
+				const IoRequest & request = m_requests[ticket].m_request;
+				const UINT64 size = request.m_size == c_ioWholeFile && request.m_offset <= file.m_size ? file.m_size - request.m_offset : request.m_size;
+
+				if (request.m_offset > file.m_size || size > file.m_size - request.m_offset)
+				{
+					finish(ticket, IO_STATUS_FAILED, AssetView(), finished);
+				}
+				else if (size == 0)
+				{
+					finish(ticket, IO_STATUS_COMPLETED, AssetView(), finished);
+				}
+				else
+				{
+					ranges.push_back({ ticket, request.m_offset, request.m_offset + size });
+				}
+			}
+
+			std::sort(ranges.begin(), ranges.end(), [](const Range & a, const Range & b) { return a.m_offset < b.m_offset; });
+
+			auto seedRange = std::find_if(ranges.begin(), ranges.end(), [&](const Range & range) { return range.m_ticket == seed; });
+
+			if (seedRange == ranges.end())
+			{
+				file.m_waiting.clear();
+				for (const Range & range : ranges)
+				{
+					file.m_waiting.push_back(range.m_ticket);
+				}
+
+				releaseFileIfIdle(path);
+				return true;
+			}
+
+			// grow out from the seed in offset order while the neighbours are close enough and the range stays small enough.
+			// a seed bigger than the limit still goes on its own
+			size_t first = seedRange - ranges.begin();
+			size_t last = first;
+			UINT64 start = seedRange->m_offset;
+			UINT64 end = seedRange->m_end;
+
+			while (last + 1 < ranges.size())
+			{
+				const Range & next = ranges[last + 1];
+				const UINT64 newEnd = std::max(end, next.m_end);
+
+				if (next.m_offset > end + m_mergeGap || newEnd - start > m_maxMergedBytes)
+				{
+					break;
+				}
+
+				end = newEnd;
+				++last;
+			}
+
+			while (first > 0)
+			{
+				const Range & previous = ranges[first - 1];
+
+				if (previous.m_end + m_mergeGap < start || end - previous.m_offset > m_maxMergedBytes)
+				{
+					break;
+				}
+
+				start = previous.m_offset;
+				// an earlier range can run past everything after it
+				end = std::max(end, previous.m_end);
+				--first;
+			}
+
+			const UINT64 tag = m_nextReadTag++;
+			Read & read = m_reads[tag];
+			read.m_path = path;
+			read.m_offset = start;
+			read.m_size = end - start;
+			read.m_buffer = std::make_shared<std::vector<UINT8>>(static_cast<size_t>(read.m_size));
+			read.m_bytesRead = 0;
+			read.m_failed = false;
+			read.m_piecesLeft = static_cast<UINT>((read.m_size + c_ioMaxBackendRead - 1) / c_ioMaxBackendRead);
+
+			file.m_waiting.clear();
+
+			for (size_t range = 0; range < ranges.size(); ++range)
+			{
+				if (range >= first && range <= last)
+				{
+					read.m_tickets.push_back(ranges[range].m_ticket);
+					m_requests[ranges[range].m_ticket].m_started = true;
+				}
+				else
+				{
+					file.m_waiting.push_back(ranges[range].m_ticket);
+				}
+			}
+
+			++file.m_readsInFlight;
+			++m_readsInFlight;
+			++m_stats.m_reads;
+			m_stats.m_mergedRequests += read.m_tickets.size() - 1;
+
+			// a failed submit of the last piece can finish the read, so nothing in it is touched after the loop starts
+			const IoFileHandle handle = file.m_handle;
+			const UINT64 readOffset = read.m_offset;
+			const UINT64 readSize = read.m_size;
+			UINT8 * const buffer = read.m_buffer->data();
+			const UINT pieces = read.m_piecesLeft;
+
+			for (UINT piece = 0; piece < pieces; ++piece)
+			{
+				const UINT64 offset = static_cast<UINT64>(piece) * c_ioMaxBackendRead;
+				const UINT64 size = std::min(c_ioMaxBackendRead, readSize - offset);
+
+				if (!m_backend->submitRead(handle, readOffset + offset, size, buffer + offset, tag))
+				{
+					// nothing comes back for it, count it as done
+					completeRead(tag, 0, false, finished);
+				}
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void IoService::completeRead(const UINT64 tag, const UINT64 bytesRead, const bool succeeded, std::vector<FinishedRequest> & finished)
+{
+	auto found = m_reads.find(tag);
+
+	if (found == m_reads.end())
+	{
+		return;
+	}
+
+	Read & read = found->second;
+	read.m_bytesRead += bytesRead;
+	read.m_failed = read.m_failed || !succeeded;
+	m_stats.m_bytesRead += bytesRead;
+
+	if (--read.m_piecesLeft > 0)
+	{
+		return;
+	}
+
+	// a short read means the file changed under us
+	const bool failed = read.m_failed || read.m_bytesRead != read.m_size;
+
+	for (const IoTicket ticket : read.m_tickets)
+	{
+		PendingRequest & request = m_requests[ticket];
+
+		if (request.m_cancelRequested)
+		{
+			finish(ticket, IO_STATUS_CANCELLED, AssetView(), finished);
+		}
+		else if (failed)
+		{
+			finish(ticket, IO_STATUS_FAILED, AssetView(), finished);
+		}
+		else
+		{
+			const UINT64 size = request.m_request.m_size == c_ioWholeFile ? m_files[read.m_path].m_size - request.m_request.m_offset : request.m_request.m_size;
+
+			AssetView view;
+			view.m_data = read.m_buffer->data() + (request.m_request.m_offset - read.m_offset);
+			view.m_size = static_cast<size_t>(size);
+			view.m_owner = read.m_buffer;
+
+			finish(ticket, IO_STATUS_COMPLETED, view, finished);
+		}
+	}
+
+	const std::string path = read.m_path;
+	m_reads.erase(found);
+
+	--m_files[path].m_readsInFlight;
+	--m_readsInFlight;
+
+	releaseFileIfIdle(path);
+}
+
+void IoService::cancelWaiting(std::vector<FinishedRequest> & finished)
+{
+	std::vector<std::string> paths;
+
+	for (auto & file : m_files)
+	{
+		for (const IoTicket ticket : file.second.m_waiting)
+		{
+			finish(ticket, IO_STATUS_CANCELLED, AssetView(), finished);
+		}
+
+		file.second.m_waiting.clear();
+		paths.push_back(file.first);
+	}
+
+	for (const std::string & path : paths)
+	{
+		releaseFileIfIdle(path);
+	}
+
+	for (UINT priority = 0; priority < IO_PRIORITY_COUNT; ++priority)
+	{
+		m_queues[priority].clear();
+	}
+
+	// and the ones in flight are reported cancelled when they land
+	for (auto & read : m_reads)
+	{
+		for (const IoTicket ticket : read.second.m_tickets)
+		{
+			m_requests[ticket].m_cancelRequested = true;
+		}
+	}
+}
+
+void IoService::finish(const IoTicket ticket, const IoStatus status, const AssetView & data, std::vector<FinishedRequest> & finished)
+{
+	auto request = m_requests.find(ticket);
+
+	if (request == m_requests.end())
+	{
+		return;
+	}
+
+	switch (status)
+	{
+	case IO_STATUS_COMPLETED:
+		m_stats.m_bytesRequested += data.m_size;
+		break;
+	case IO_STATUS_FAILED:
+		++m_stats.m_failed;
+		break;
+	case IO_STATUS_CANCELLED:
+		++m_stats.m_cancelled;
+		break;
+	default:
+		break;
+	}
+
+	if (request->second.m_request.m_onComplete)
+	{
+		FinishedRequest done;
+		done.m_callback = std::move(request->second.m_request.m_onComplete);
+		done.m_ticket = ticket;
+		done.m_status = status;
+		done.m_data = data;
+		finished.push_back(std::move(done));
+
+		m_requests.erase(request);
+		return;
+	}
+
+	request->second.m_status = status;
+	request->second.m_data = data;
+	request->second.m_started = false;
+	m_completed.notify_all();
+}
+
+void IoService::releaseFileIfIdle(const std::string & path)
+{
+	auto file = m_files.find(path);
+
+	if (file == m_files.end() || !file->second.m_waiting.empty() || file->second.m_readsInFlight > 0)
+	{
+		return;
+	}
+
+	if (file->second.m_opened)
+	{
+		m_backend->closeFile(file->second.m_handle);
+	}
+
+	m_files.erase(file);
+}
@@ -0,0 +1,218 @@
+#pragma once
+#ifndef _IO_SERVICE_H_
+#define _IO_SERVICE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <Windows.h>
+
+#include "AssetFileSystem.h"
+
+// identifies one read, 0 is never handed out so it can mean "nothing to wait on"
+typedef UINT64 IoTicket;
+
+// the size of a request that reads from its offset to the end of the file
+const UINT64 c_ioWholeFile = ~0ull;
+
+enum IoPriority
+{
+	IO_PRIORITY_HIGH = 0,	// something is waiting on it now
+	IO_PRIORITY_NORMAL,
+	IO_PRIORITY_LOW,		// prefetch
+	IO_PRIORITY_COUNT
+};
+
+enum IoStatus
+{
+	IO_STATUS_PENDING = 0,
+	IO_STATUS_COMPLETED,
+	IO_STATUS_FAILED,
+	IO_STATUS_CANCELLED
+};
+
+// the data is a view into the buffer the read went into, several merged requests can share one buffer
+typedef std::function<void(const IoTicket ticket, const IoStatus status, const AssetView & data)> IoCallback;
+
+struct IoRequest
+{
+	IoRequest()
+		: m_offset(0)
+		, m_size(c_ioWholeFile)
+		, m_priority(IO_PRIORITY_NORMAL)
+	{
+
+	}
+
+	std::string m_path;
+	UINT64 m_offset;
+	UINT64 m_size;
+	IoPriority m_priority;
+	// runs on the io thread, so it should be short. without one the result waits for wait() to collect it
+	IoCallback m_onComplete;
+};
+
+typedef UINT64 IoFileHandle;
+
+struct IoCompletion
+{
+	UINT64 m_tag;
+	UINT64 m_bytesRead;
+	bool m_succeeded;
+};
+
+// the part that talks to the OS, split out so the scheduling can run against a fake
+class IoBackend
+{
+public:
+	virtual ~IoBackend() {}
+
+	virtual bool openFile(const std::string & path, IoFileHandle & file, UINT64 & size) = 0;
+	virtual void closeFile(const IoFileHandle file) = 0;
+
+	// starts a read of at most c_ioMaxBackendRead bytes, its completion comes back with the tag.
+	// false if it couldn't be started, in which case there is no completion
+	virtual bool submitRead(const IoFileHandle file, const UINT64 offset, const UINT64 size, UINT8 * destination, const UINT64 tag) = 0;
+
+	// blocks until at least one read has completed or wake() is called, then returns everything that has completed
+	virtual void waitForCompletions(std::vector<IoCompletion> & completions) = 0;
+	// safe from any thread
+	virtual void wake() = 0;
+};
+
+// the most one backend read asks for, bigger reads are split
+const UINT64 c_ioMaxBackendRead = 64 * 1024 * 1024;
+
+struct IoStats
+{
+	UINT64 m_requests;
+	UINT64 m_reads;				// merged ranges handed to the backend
+	UINT64 m_mergedRequests;	// served by a range started for another request
+	UINT64 m_cancelled;
+	UINT64 m_failed;
+	UINT64 m_bytesRequested;
+	UINT64 m_bytesRead;
+	UINT64 m_filesOpened;
+};
+
+// reads files asynchronously on one io thread. requests are started in priority order, oldest first, with a
+// bounded number of reads in flight. each file is opened once for every request that wants it, and requests
+// for the same file whose ranges overlap or sit close together are merged into one read.
+// enqueue, cancel and wait are safe from any thread
+class IoService
+{
+public:
+	IoService(IoBackend * backend);
+	~IoService();
+
+	// reads in flight at once, and how far apart and how big merged ranges can get
+	void setLimits(const UINT maxInFlight, const UINT64 mergeGap, const UINT64 maxMergedBytes);
+
+	void start();
+	// cancels everything not yet finished and waits for the io thread
+	void stop();
+
+	IoTicket enqueue(IoRequest && request);
+
+	// true if the request won't complete. one already in flight still reads, its result is thrown away
+	bool cancel(const IoTicket ticket);
+
+	// blocks until the request is done and hands over its result, for requests without a callback.
+	// a request without a callback stays in the service until it is waited on, cancelled ones too
+	IoStatus wait(const IoTicket ticket, AssetView & data);
+
+	IoStats getStats() const;
+
+private:
+
+	struct PendingRequest
+	{
+		IoRequest m_request;
+		IoStatus m_status;
+		bool m_started;			// part of a read handed to the backend
+		bool m_cancelRequested;	// while in flight, reported as cancelled once its read lands
+		AssetView m_data;
+	};
+
+	struct OpenFile
+	{
+		OpenFile()
+			: m_handle(0)
+			, m_size(0)
+			, m_opened(false)
+			, m_readsInFlight(0)
+		{
+
+		}
+
+		IoFileHandle m_handle;
+		UINT64 m_size;
+		bool m_opened;
+		std::vector<IoTicket> m_waiting;	// not started yet
+		UINT m_readsInFlight;
+	};
+
+	// one merged range and every request it serves, split into pieces of at most c_ioMaxBackendRead
+	struct Read
+	{
+		std::string m_path;
+		UINT64 m_offset;
+		UINT64 m_size;
+		std::shared_ptr<std::vector<UINT8>> m_buffer;
+		std::vector<IoTicket> m_tickets;
+		UINT m_piecesLeft;
+		UINT64 m_bytesRead;
+		bool m_failed;
+	};
+
+	// callbacks are run once the lock is dropped
+	struct FinishedRequest
+	{
+		IoCallback m_callback;
+		IoTicket m_ticket;
+		IoStatus m_status;
+		AssetView m_data;
+	};
+
+	void run();
+
+	// the rest are called under m_mutex
+	// picks the oldest request of the highest priority, merges its neighbours in and hands the range to the backend.
+	// false when there was nothing to start
+	bool startNextRead(std::vector<FinishedRequest> & finished);
+	void completeRead(const UINT64 tag, const UINT64 bytesRead, const bool succeeded, std::vector<FinishedRequest> & finished);
+	void cancelWaiting(std::vector<FinishedRequest> & finished);
+	// a request without a callback stays in the table until wait() collects it
+	void finish(const IoTicket ticket, const IoStatus status, const AssetView & data, std::vector<FinishedRequest> & finished);
+	void releaseFileIfIdle(const std::string & path);
+
+	IoBackend * m_backend;
+
+	UINT m_maxInFlight;
+	UINT64 m_mergeGap;
+	UINT64 m_maxMergedBytes;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_completed;
+
+	std::unordered_map<IoTicket, PendingRequest> m_requests;
+	std::deque<IoTicket> m_queues[IO_PRIORITY_COUNT];
+	std::unordered_map<std::string, OpenFile> m_files;
+	std::unordered_map<UINT64, Read> m_reads;
+	IoTicket m_nextTicket;
+	UINT64 m_nextReadTag;
+	UINT m_readsInFlight;
+	IoStats m_stats;
+
+	std::thread m_thread;
+	bool m_quit;
+};
+
+#endif // _IO_SERVICE_H_
@@ -0,0 +1,159 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+JobSystem::JobSystem(const unsigned int workerCount)
+	: m_activeJobs(0)
+	, m_quit(false)
+{
+	unsigned int count = workerCount;
+
+	if (count == 0)
+	{
+		const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		count = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	m_workers.reserve(count);
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		m_workers.emplace_back(&JobSystem::workerLoop, this);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+
+	m_jobAvailable.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i].join();
+	}
+}
+
+void JobSystem::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+
+	m_jobAvailable.notify_one();
+}
+
+void JobSystem::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_jobs.empty() && m_activeJobs == 0; });
+}
+
+void JobSystem::parallelFor(const size_t count, const size_t grainSize, const std::function<void(size_t begin, size_t end)> & func)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	const size_t grain = std::max<size_t>(grainSize, 1);
+	const size_t rangeCount = (count + grain - 1) / grain;
+
+	if (rangeCount == 1 || m_workers.empty())
+	{
+		func(0, count);
+		return;
+	}
+
+	// shared between the caller and the helpers, a helper can still be queued after the caller returns
+	struct ParallelForState
+	{
+		std::atomic<size_t> m_nextRange;
+		std::atomic<size_t> m_rangesDone;
+		std::mutex m_doneMutex;
+		std::condition_variable m_done;
+	};
+
+	std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->m_nextRange = 0;
+	state->m_rangesDone = 0;
+
+	// func is only used while ranges are left, the caller waits for all of them so the reference stays valid
+	const std::function<void(size_t, size_t)> * funcPtr = &func;
+
+	auto runRanges = [state, funcPtr, count, grain, rangeCount]()
+	{
+		for (;;)
+		{
+			const size_t range = state->m_nextRange.fetch_add(1);
+
+			if (range >= rangeCount)
+			{
+				return;
+			}
+
+			const size_t begin = range * grain;
+			const size_t end = std::min(begin + grain, count);
+			(*funcPtr)(begin, end);
+
+			if (state->m_rangesDone.fetch_add(1) + 1 == rangeCount)
+			{
+				std::lock_guard<std::mutex> lock(state->m_doneMutex);
+				state->m_done.notify_all();
+			}
+		}
+	};
+
+	const size_t helperCount = std::min(m_workers.size(), rangeCount - 1);
+
+	for (size_t i = 0; i < helperCount; ++i)
+	{
+		submit(runRanges);
+	}
+
+	runRanges();
+
+	std::unique_lock<std::mutex> lock(state->m_doneMutex);
+	state->m_done.wait(lock, [&state, rangeCount]() { return state->m_rangesDone.load() == rangeCount; });
+}
+
+void JobSystem::workerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this]() { return m_quit || !m_jobs.empty(); });
+
+			if (m_jobs.empty())
+			{
+				// only get here when quitting
+				return;
+			}
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			++m_activeJobs;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_activeJobs;
+
+			if (m_jobs.empty() && m_activeJobs == 0)
+			{
+				m_idle.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef _JOB_SYSTEM_H_
+#define _JOB_SYSTEM_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed size pool of worker threads, work is either queued as a single job or split with parallelFor.
+// the calling thread joins in with parallelFor, so it is fine to call it from inside another job.
+class JobSystem
+{
+public:
+	// 0 picks one worker per hardware thread, minus the calling thread
+	explicit JobSystem(const unsigned int workerCount = 0);
+	~JobSystem();
+
+	unsigned int getWorkerCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+	// queue a job to run on a worker, use waitIdle() to wait for everything queued
+	void submit(std::function<void()> job);
+	void waitIdle();
+
+	// splits [0, count) into ranges of grainSize and blocks until every range has run
+	void parallelFor(const size_t count, const size_t grainSize, const std::function<void(size_t begin, size_t end)> & func);
+
+private:
+
+	void workerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	std::condition_variable m_idle;
+	size_t m_activeJobs;
+	bool m_quit;
+};
+
+#endif // _JOB_SYSTEM_H_
@@ -0,0 +1,558 @@
+#include "Json.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	bool isWhitespace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	const char * skipWhitespace(const char * p, const char * end)
+	{
+		while (p < end && isWhitespace(*p))
+		{
+			++p;
+		}
+
+		return p;
+	}
+
+	bool isDigit(const char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	int hexValue(const char c)
+	{
+		if (c >= '0' && c <= '9')
+		{
+			return c - '0';
+		}
+
+		if (c >= 'a' && c <= 'f')
+		{
+			return c - 'a' + 10;
+		}
+
+		if (c >= 'A' && c <= 'F')
+		{
+			return c - 'A' + 10;
+		}
+
+		return -1;
+	}
+
+	UINT readHex4(const char * p)
+	{
+		return (hexValue(p[0]) << 12) | (hexValue(p[1]) << 8) | (hexValue(p[2]) << 4) | hexValue(p[3]);
+	}
+
+	void appendUtf8(std::string & out, const UINT codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			out += static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			out += static_cast<char>(0xC0 | (codePoint >> 6));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | (codePoint >> 12));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | (codePoint >> 18));
+			out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	// the text has already been checked by the parser. integers up to 2^53 come out exact
+	double parseNumber(const char * p, const char * end)
+	{
+		static const double c_powersOfTen[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const bool negative = *p == '-';
+
+		if (negative)
+		{
+			++p;
+		}
+
+		UINT64 mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+
+		for (; p < end && isDigit(*p); ++p)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa > 0 ? 1 : 0;
+			}
+			else
+			{
+				++exponent;
+			}
+		}
+
+		if (p < end && *p == '.')
+		{
+			for (++p; p < end && isDigit(*p); ++p)
+			{
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					digits += mantissa > 0 ? 1 : 0;
+					--exponent;
+				}
+			}
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+			const bool negativeExponent = *p == '-';
+
+			if (*p == '-' || *p == '+')
+			{
+				++p;
+			}
+
+			int written = 0;
+
+			for (; p < end && isDigit(*p); ++p)
+			{
+				written = written < 10000 ? written * 10 + (*p - '0') : written;
+			}
+
+			exponent += negativeExponent ? -written : written;
+		}
+
+		double result = static_cast<double>(mantissa);
+
+		if (mantissa != 0 && exponent != 0)
+		{
+			const int magnitude = exponent < 0 ? -exponent : exponent;
+			const double scale = magnitude <= 22 ? c_powersOfTen[magnitude] : std::pow(10.0, magnitude);
+			result = exponent < 0 ? result / scale : result * scale;
+		}
+
+		return negative ? -result : result;
+	}
+}
+
+JsonDocument::JsonDocument()
+	: m_text(nullptr)
+{
+
+}
+
+JsonDocument::~JsonDocument()
+{
+
+}
+
+bool JsonDocument::parse(const char * text, const size_t size)
+{
+	m_text = text;
+	m_values.clear();
+
+	if (size >= UINT_MAX)
+	{
+		return false;
+	}
+
+	// about one value per eight characters in a glTF file
+	m_values.reserve(size / 8 + 1);
+
+	const char * end = text + size;
+	const char * p = skipWhitespace(text, end);
+
+	if (!parseValue(p, end, 0) || skipWhitespace(p, end) != end)
+	{
+		m_values.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool JsonDocument::parseValue(const char *& p, const char * end, const UINT depth)
+{
+	if (p == end || depth > c_jsonMaxDepth)
+	{
+		return false;
+	}
+
+	if (*p == '"')
+	{
+		return parseString(p, end);
+	}
+
+	const UINT index = static_cast<UINT>(m_values.size());
+	const Value empty = { JSON_NULL, static_cast<UINT>(p - m_text), 0, 0, 0 };
+	m_values.push_back(empty);
+
+	if (*p == '{' || *p == '[')
+	{
+		const bool object = *p == '{';
+		const char close = object ? '}' : ']';
+		UINT size = 0;
+
+		p = skipWhitespace(p + 1, end);
+
+		if (p < end && *p == close)
+		{
+			++p;
+		}
+		else
+		{
+			for (;;)
+			{
+				if (object)
+				{
+					if (p == end || *p != '"' || !parseString(p, end))
+					{
+						return false;
+					}
+
+					p = skipWhitespace(p, end);
+
+					if (p == end || *p != ':')
+					{
+						return false;
+					}
+
+					p = skipWhitespace(p + 1, end);
+				}
+
+				if (!parseValue(p, end, depth + 1))
+				{
+					return false;
+				}
+
+				++size;
+				p = skipWhitespace(p, end);
+
+				if (p < end && *p == ',')
+				{
+					p = skipWhitespace(p + 1, end);
+					continue;
+				}
+
+				if (p < end && *p == close)
+				{
+					++p;
+					break;
+				}
+
+				return false;
+			}
+		}
+
+		m_values[index].m_type = object ? JSON_OBJECT : JSON_ARRAY;
+		m_values[index].m_size = size;
+	}
+	else if (static_cast<size_t>(end - p) >= 4 && memcmp(p, "true", 4) == 0)
+	{
+		m_values[index].m_type = JSON_TRUE;
+		p += 4;
+	}
+	else if (static_cast<size_t>(end - p) >= 5 && memcmp(p, "false", 5) == 0)
+	{
+		m_values[index].m_type = JSON_FALSE;
+		p += 5;
+	}
+	else if (static_cast<size_t>(end - p) >= 4 && memcmp(p, "null", 4) == 0)
+	{
+		m_values[index].m_type = JSON_NULL;
+		p += 4;
+	}
+	else
+	{
+		// -?digits(.digits)?([eE][+-]?digits)?
+		if (*p == '-')
+		{
+			++p;
+		}
+
+		const char * digits = p;
+
+		while (p < end && isDigit(*p))
+		{
+			++p;
+		}
+
+		if (p == digits)
+		{
+			return false;
+		}
+
+		if (p < end && *p == '.')
+		{
+			digits = ++p;
+
+			while (p < end && isDigit(*p))
+			{
+				++p;
+			}
+
+			if (p == digits)
+			{
+				return false;
+			}
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				++p;
+			}
+
+			digits = p;
+
+			while (p < end && isDigit(*p))
+			{
+				++p;
+			}
+
+			if (p == digits)
+			{
+				return false;
+			}
+		}
+
+		m_values[index].m_type = JSON_NUMBER;
+	}
+
+	m_values[index].m_end = static_cast<UINT>(p - m_text);
+	m_values[index].m_next = static_cast<UINT>(m_values.size());
+
+	return true;
+}
+
+bool JsonDocument::parseString(const char *& p, const char * end)
+{
+	const char * begin = ++p;
+
+	while (p < end && *p != '"')
+	{
+		if (static_cast<unsigned char>(*p) < 0x20)
+		{
+			return false;
+		}
+
+		if (*p == '\\')
+		{
+			if (end - p < 2)
+			{
+				return false;
+			}
+
+			if (p[1] == 'u')
+			{
+				if (end - p < 6 || hexValue(p[2]) < 0 || hexValue(p[3]) < 0 || hexValue(p[4]) < 0 || hexValue(p[5]) < 0)
+				{
+					return false;
+				}
+
+				p += 6;
+				continue;
+			}
+
+			if (strchr("\"\\/bfnrt", p[1]) == nullptr || p[1] == '\0')
+			{
+				return false;
+			}
+
+			p += 2;
+			continue;
+		}
+
+		++p;
+	}
+
+	if (p == end)
+	{
+		return false;
+	}
+
+	const Value value = { JSON_STRING, static_cast<UINT>(begin - m_text), static_cast<UINT>(p - m_text), 0, static_cast<UINT>(m_values.size() + 1) };
+	m_values.push_back(value);
+	++p;
+
+	return true;
+}
+
+UINT JsonDocument::getSize(const UINT value) const
+{
+	const JsonType type = getType(value);
+
+	return type == JSON_ARRAY || type == JSON_OBJECT ? m_values[value].m_size : 0;
+}
+
+UINT JsonDocument::getElement(const UINT array, const UINT index) const
+{
+	if (getType(array) != JSON_ARRAY || index >= m_values[array].m_size)
+	{
+		return c_jsonNone;
+	}
+
+	UINT element = array + 1;
+
+	for (UINT i = 0; i < index; ++i)
+	{
+		element = m_values[element].m_next;
+	}
+
+	return element;
+}
+
+UINT JsonDocument::find(const UINT object, const char * key) const
+{
+	if (getType(object) != JSON_OBJECT)
+	{
+		return c_jsonNone;
+	}
+
+	const size_t keyLength = strlen(key);
+	UINT child = object + 1;
+
+	for (UINT i = 0; i < m_values[object].m_size; ++i)
+	{
+		const Value & name = m_values[child];
+		const UINT value = child + 1;
+
+		// keys with escapes in them are rare enough to undo them to compare
+		if (memchr(m_text + name.m_begin, '\\', name.m_end - name.m_begin) != nullptr)
+		{
+			if (getString(child, std::string()) == key)
+			{
+				return value;
+			}
+		}
+		else if (name.m_end - name.m_begin == keyLength && memcmp(m_text + name.m_begin, key, keyLength) == 0)
+		{
+			return value;
+		}
+
+		child = m_values[value].m_next;
+	}
+
+	return c_jsonNone;
+}
+
+UINT JsonDocument::getFirstChild(const UINT value) const
+{
+	return getSize(value) > 0 ? value + 1 : c_jsonNone;
+}
+
+UINT JsonDocument::getNextSibling(const UINT value) const
+{
+	// the caller counts the children, past the last one this is whatever comes next in the document
+	return value == c_jsonNone || m_values[value].m_next >= m_values.size() ? c_jsonNone : m_values[value].m_next;
+}
+
+double JsonDocument::getNumber(const UINT value, const double fallback) const
+{
+	if (getType(value) != JSON_NUMBER)
+	{
+		return fallback;
+	}
+
+	return parseNumber(m_text + m_values[value].m_begin, m_text + m_values[value].m_end);
+}
+
+UINT JsonDocument::getUint(const UINT value, const UINT fallback) const
+{
+	const double number = getNumber(value, -1.0);
+
+	if (number < 0.0 || number > static_cast<double>(UINT_MAX) || std::floor(number) != number)
+	{
+		return fallback;
+	}
+
+	return static_cast<UINT>(number);
+}
+
+bool JsonDocument::getBool(const UINT value, const bool fallback) const
+{
+	const JsonType type = getType(value);
+
+	return type == JSON_TRUE ? true : (type == JSON_FALSE ? false : fallback);
+}
+
+std::string JsonDocument::getString(const UINT value, const std::string & fallback) const
+{
+	if (getType(value) != JSON_STRING)
+	{
+		return fallback;
+	}
+
+	const char * p = m_text + m_values[value].m_begin;
+	const char * end = m_text + m_values[value].m_end;
+
+	std::string out;
+	out.reserve(end - p);
+
+	while (p < end)
+	{
+		if (*p != '\\')
+		{
+			out += *p++;
+			continue;
+		}
+
+		const char escape = p[1];
+		p += 2;
+
+		switch (escape)
+		{
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'n': out += '\n'; break;
+		case 'r': out += '\r'; break;
+		case 't': out += '\t'; break;
+		case 'u':
+		{
+			UINT codePoint = readHex4(p);
+			p += 4;
+
+			// a surrogate pair is one code point
+			if (codePoint >= 0xD800 && codePoint < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+			{
+				const UINT low = readHex4(p + 2);
+
+				if (low >= 0xDC00 && low < 0xE000)
+				{
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					p += 6;
+				}
+			}
+
+			appendUtf8(out, codePoint);
+			break;
+		}
+		default: out += escape; break;
+		}
+	}
+
+	return out;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef _JSON_H_
+#define _JSON_H_
+
+#include <climits>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+enum JsonType
+{
+	JSON_NULL = 0,
+	JSON_FALSE,
+	JSON_TRUE,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+// returned for a value that isn't there, every accessor takes it and gives back the fallback
+const UINT c_jsonNone = UINT_MAX;
+const UINT c_jsonMaxDepth = 64;
+
+// a parsed document is one flat array of values in document order, each a range of the text. nothing is copied
+// or converted until it is asked for, so the array is the only allocation however big the document is.
+// an object's children are its keys, each followed by its value. the text has to outlive the document
+class JsonDocument
+{
+public:
+	JsonDocument();
+	~JsonDocument();
+
+	// false for anything that isn't a single valid JSON value, nesting is limited to c_jsonMaxDepth
+	bool parse(const char * text, const size_t size);
+
+	UINT getRoot() const { return m_values.empty() ? c_jsonNone : 0; }
+	UINT getValueCount() const { return static_cast<UINT>(m_values.size()); }
+
+	JsonType getType(const UINT value) const { return value == c_jsonNone ? JSON_NULL : m_values[value].m_type; }
+	// elements of an array, keys of an object, 0 for anything else
+	UINT getSize(const UINT value) const;
+
+	UINT getElement(const UINT array, const UINT index) const;
+	UINT find(const UINT object, const char * key) const;
+
+	// walking the children in order, cheaper than getElement for every index
+	UINT getFirstChild(const UINT value) const;
+	UINT getNextSibling(const UINT value) const;
+
+	double getNumber(const UINT value, const double fallback) const;
+	UINT getUint(const UINT value, const UINT fallback) const;
+	bool getBool(const UINT value, const bool fallback) const;
+	// with the escapes undone, \u as UTF-8
+	std::string getString(const UINT value, const std::string & fallback) const;
+
+private:
+
+	struct Value
+	{
+		JsonType m_type;
+		UINT m_begin;	// into the text, strings without their quotes
+		UINT m_end;
+		UINT m_size;
+		UINT m_next;	// the value after this one and everything in it
+	};
+
+	bool parseValue(const char *& p, const char * end, const UINT depth);
+	bool parseString(const char *& p, const char * end);
+
+	const char * m_text;
+	std::vector<Value> m_values;
+};
+
+#endif // _JSON_H_
@@ -0,0 +1,81 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+LodSelector::LodSelector()
+	: m_pixelsPerUnitAtOne(0.0f)
+	, m_errorThreshold(1.0f)
+	, m_hysteresis(0.25f)
+{
+	setViewport(600, 0.785398f); // 45 degrees
+}
+
+LodSelector::~LodSelector()
+{
+
+}
+
+void LodSelector::setViewport(const UINT screenHeight, const float verticalFov)
+{
+	m_pixelsPerUnitAtOne = static_cast<float>(screenHeight) / (2.0f * std::tan(verticalFov * 0.5f));
+}
+
+float LodSelector::projectedError(const float objectError, const float distance) const
+{
+	// anything at or behind the near plane gets full detail
+	if (distance <= 0.0f)
+	{
+		return objectError > 0.0f ? FLT_MAX : 0.0f;
+	}
+
+	return objectError * m_pixelsPerUnitAtOne / distance;
+}
+
+UINT LodSelector::selectLod(const std::vector<MeshLod> & lods, const float distance, const UINT currentLod) const
+{
+	if (lods.size() < 2)
+	{
+		return 0;
+	}
+
+	const UINT current = std::min(currentLod, static_cast<UINT>(lods.size() - 1));
+	const UINT wanted = coarsestWithin(lods, distance, m_errorThreshold);
+
+	if (wanted > current)
+	{
+		// only go coarser once the coarser level is comfortably under the threshold
+		const UINT coarser = coarsestWithin(lods, distance, m_errorThreshold * (1.0f - m_hysteresis));
+		return std::max(coarser, current);
+	}
+
+	if (wanted < current)
+	{
+		// only go finer once the current level is clearly over the threshold
+		if (projectedError(lods[current].m_error, distance) <= m_errorThreshold * (1.0f + m_hysteresis))
+		{
+			return current;
+		}
+	}
+
+	return wanted;
+}
+
+UINT LodSelector::coarsestWithin(const std::vector<MeshLod> & lods, const float distance, const float threshold) const
+{
+	// errors grow along the chain, so walk from the full detail end
+	UINT lod = 0;
+
+	for (UINT i = 1; i < lods.size(); ++i)
+	{
+		if (projectedError(lods[i].m_error, distance) > threshold)
+		{
+			break;
+		}
+
+		lod = i;
+	}
+
+	return lod;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef _LOD_SELECTOR_H_
+#define _LOD_SELECTOR_H_
+
+#include <vector>
+
+#include "Geomatry.h"
+
+// picks a level of detail per instance from the projected screen space error of each level.
+// the selector holds no per instance state, the caller keeps the last lod so hysteresis can use it.
+class LodSelector
+{
+public:
+	LodSelector();
+	~LodSelector();
+
+	// screen height in pixels and vertical field of view in radians
+	void setViewport(const UINT screenHeight, const float verticalFov);
+	// largest error in pixels a level may have to be chosen
+	void setErrorThreshold(const float pixels) { m_errorThreshold = pixels; }
+	// fraction of the threshold a level has to be past before switching, stops popping at the boundary
+	void setHysteresis(const float fraction) { m_hysteresis = fraction; }
+
+	// object space error at the given view distance, in pixels
+	float projectedError(const float objectError, const float distance) const;
+
+	UINT selectLod(const std::vector<MeshLod> & lods, const float distance, const UINT currentLod) const;
+
+private:
+
+	// coarsest level with a projected error at or under the threshold
+	UINT coarsestWithin(const std::vector<MeshLod> & lods, const float distance, const float threshold) const;
+
+	float m_pixelsPerUnitAtOne; // screen height / (2 tan(fov / 2))
+	float m_errorThreshold;
+	float m_hysteresis;
+};
+
+#endif // _LOD_SELECTOR_H_
@@ -0,0 +1,251 @@
+#include "LzCompression.h"
+
+#include <cstring>
+
+namespace
+{
+	const size_t c_minMatch = 4;
+	const size_t c_maxOffset = 65535;
+	// the last bytes are always literals, so the match search can read 4 bytes at a time without checking the end
+	const size_t c_lastLiterals = 5;
+	const size_t c_hashBits = 12;
+
+	UINT32 read32(const UINT8 * p)
+	{
+		UINT32 value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	UINT32 hash4(const UINT8 * p)
+	{
+		return (read32(p) * 2654435761u) >> (32 - c_hashBits);
+	}
+
+	// 15 in the token means more length follows, 255 at a time
+	bool writeLength(size_t length, UINT8 *& out, const UINT8 * end)
+	{
+		while (length >= 255)
+		{
+			if (out >= end)
+			{
+				return false;
+			}
+
+			*out++ = 255;
+			length -= 255;
+		}
+
+		if (out >= end)
+		{
+			return false;
+		}
+
+		*out++ = static_cast<UINT8>(length);
+		return true;
+	}
+
+	bool readLength(size_t & length, const UINT8 *& in, const UINT8 * end)
+	{
+		UINT8 byte = 255;
+
+		while (byte == 255)
+		{
+			if (in >= end)
+			{
+				return false;
+			}
+
+			byte = *in++;
+			length += byte;
+		}
+
+		return true;
+	}
+
+	bool writeSequence(const UINT8 * literals, const size_t literalCount, const size_t offset, const size_t matchLength,
+		UINT8 *& out, const UINT8 * end)
+	{
+		if (out >= end)
+		{
+			return false;
+		}
+
+		UINT8 * token = out++;
+		const size_t matchCode = matchLength > 0 ? matchLength - c_minMatch : 0;
+
+		*token = static_cast<UINT8>(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+		if (literalCount >= 15 && !writeLength(literalCount - 15, out, end))
+		{
+			return false;
+		}
+
+		if (static_cast<size_t>(end - out) < literalCount)
+		{
+			return false;
+		}
+
+		if (literalCount > 0)
+		{
+			memcpy(out, literals, literalCount);
+			out += literalCount;
+		}
+
+		// the final sequence is literals only
+		if (matchLength == 0)
+		{
+			return true;
+		}
+
+		if (end - out < 2)
+		{
+			return false;
+		}
+
+		*out++ = static_cast<UINT8>(offset & 0xff);
+		*out++ = static_cast<UINT8>(offset >> 8);
+
+		return matchCode < 15 || writeLength(matchCode - 15, out, end);
+	}
+}
+
+size_t lzCompressBound(const size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t lzCompress(const UINT8 * source, const size_t size, UINT8 * destination, const size_t capacity)
+{
+	UINT8 * out = destination;
+	const UINT8 * const outEnd = destination + capacity;
+
+	size_t anchor = 0;
+
+	if (size > c_minMatch + c_lastLiterals)
+	{
+		// positions + 1, so 0 is empty
+		UINT32 table[1 << c_hashBits];
+		memset(table, 0, sizeof(table));
+
+		const size_t searchEnd = size - c_lastLiterals - c_minMatch;
+		size_t position = 0;
+		size_t misses = 0;
+
+		while (position <= searchEnd)
+		{
+			const UINT32 hash = hash4(source + position);
+			const size_t candidate = table[hash];
+			table[hash] = static_cast<UINT32>(position + 1);
+
+			if (candidate == 0 || position - (candidate - 1) > c_maxOffset || read32(source + candidate - 1) != read32(source + position))
+			{
+				// the longer it goes without a match the further it steps, so incompressible data passes through quickly
+				position += 1 + (misses++ >> 6);
+				continue;
+			}
+
+			const size_t match = candidate - 1;
+			const size_t matchEnd = size - c_lastLiterals;
+			size_t length = c_minMatch;
+
+			while (position + length < matchEnd && source[match + length] == source[position + length])
+			{
+				++length;
+			}
+
+			if (!writeSequence(source + anchor, position - anchor, position - match, length, out, outEnd))
+			{
+				return 0;
+			}
+
+			position += length;
+			anchor = position;
+			misses = 0;
+		}
+	}
+
+	if (!writeSequence(source + anchor, size - anchor, 0, 0, out, outEnd))
+	{
+		return 0;
+	}
+
+	return static_cast<size_t>(out - destination);
+}
+
+bool lzDecompress(const UINT8 * source, const size_t sourceSize, UINT8 * destination, const size_t size)
+{
+	const UINT8 * in = source;
+	const UINT8 * const inEnd = source + sourceSize;
+	UINT8 * out = destination;
+	UINT8 * const outEnd = destination + size;
+
+	while (in < inEnd)
+	{
+		const UINT8 token = *in++;
+		size_t literalCount = token >> 4;
+
+		if (literalCount == 15 && !readLength(literalCount, in, inEnd))
+		{
+			return false;
+		}
+
+		if (static_cast<size_t>(inEnd - in) < literalCount || static_cast<size_t>(outEnd - out) < literalCount)
+		{
+			return false;
+		}
+
+		if (literalCount > 0)
+		{
+			memcpy(out, in, literalCount);
+			in += literalCount;
+			out += literalCount;
+		}
+
+		// the last sequence ends on its literals
+		if (in == inEnd)
+		{
+			break;
+		}
+
+		if (inEnd - in < 2)
+		{
+			return false;
+		}
+
+		const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+		in += 2;
+
+		size_t matchLength = token & 15;
+
+		if (matchLength == 15 && !readLength(matchLength, in, inEnd))
+		{
+			return false;
+		}
+
+		matchLength += c_minMatch;
+
+		if (offset == 0 || offset > static_cast<size_t>(out - destination) || static_cast<size_t>(outEnd - out) < matchLength)
+		{
+			return false;
+		}
+
+		const UINT8 * match = out - offset;
+
+		// overlapping matches repeat the bytes just written, so they go one at a time
+		if (offset >= matchLength)
+		{
+			memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else
+		{
+			for (size_t i = 0; i < matchLength; ++i)
+			{
+				*out++ = *match++;
+			}
+		}
+	}
+
+	return out == outEnd;
+}
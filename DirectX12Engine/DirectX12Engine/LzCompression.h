@@ -0,0 +1,20 @@
+#pragma once
+#ifndef _LZ_COMPRESSION_H_
+#define _LZ_COMPRESSION_H_
+
+#include <Windows.h>
+
+// a byte oriented LZ77 in the style of LZ4. there is no entropy coding, a sequence is a token, its literals and
+// a 16 bit offset back to the match, so decompressing is mostly memcpy. each call is independent, the archive
+// compresses in fixed size blocks so they can be decompressed in parallel
+
+// the most lzCompress can write for size bytes of input, incompressible data grows by about 1 in 255
+size_t lzCompressBound(const size_t size);
+
+// returns the compressed size, 0 if it didn't fit in capacity
+size_t lzCompress(const UINT8 * source, const size_t size, UINT8 * destination, const size_t capacity);
+
+// false if the stream is malformed or doesn't decompress to exactly size bytes, it never reads or writes out of bounds
+bool lzDecompress(const UINT8 * source, const size_t sourceSize, UINT8 * destination, const size_t size);
+
+#endif // _LZ_COMPRESSION_H_
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <string>
+
+#include <Windows.h>
+
+// a read only view of a whole file. pages come in from the file cache as they are touched, so reading
+// out of it costs no extra copy and nothing is read that isn't used
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	bool open(const std::string & path);
+	void close();
+
+	const UINT8 * getData() const { return m_data; }
+	size_t getSize() const { return m_size; }
+
+private:
+
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const UINT8 * m_data;
+	size_t m_size;
+};
+
+#endif // _MAPPED_FILE_H_
@@ -0,0 +1,235 @@
+#include "MaterialTable.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+	const size_t c_initialTableSize = 64;
+
+	UINT stateRank(const UINT flags)
+	{
+		if ((flags & MATERIAL_FLAG_BLENDED) != 0)
+		{
+			return 3;
+		}
+
+		if ((flags & MATERIAL_FLAG_ALPHA_TESTED) != 0)
+		{
+			return 2;
+		}
+
+		return (flags & MATERIAL_FLAG_DOUBLE_SIDED) != 0 ? 1 : 0;
+	}
+
+	UINT hashMaterial(const PackedMaterial & material)
+	{
+		UINT words[sizeof(PackedMaterial) / sizeof(UINT)];
+		memcpy(words, &material, sizeof(words));
+
+		UINT hash = 2166136261u;
+
+		for (size_t i = 0; i < _countof(words); ++i)
+		{
+			hash = (hash ^ words[i]) * 16777619u;
+		}
+
+		return hash ^ (hash >> 15);
+	}
+}
+
+MaterialTable::MaterialTable()
+	: m_imported(0)
+{
+	clear();
+}
+
+MaterialTable::~MaterialTable()
+{
+
+}
+
+void MaterialTable::clear()
+{
+	m_materials.clear();
+	m_table.assign(c_initialTableSize, UINT_MAX);
+	m_textureNames.clear();
+	m_textureTable.assign(c_initialTableSize, UINT_MAX);
+	m_imported = 0;
+}
+
+UINT MaterialTable::add(const MaterialDesc & material)
+{
+	++m_imported;
+
+	// + 0.0f so -0 and 0 pack the same, the packed bytes are what's compared
+	PackedMaterial packed;
+	packed.m_baseColour = DirectX::XMFLOAT4(material.m_baseColour.x + 0.0f, material.m_baseColour.y + 0.0f, material.m_baseColour.z + 0.0f, material.m_baseColour.w + 0.0f);
+	packed.m_emissive = DirectX::XMFLOAT3(material.m_emissive.x + 0.0f, material.m_emissive.y + 0.0f, material.m_emissive.z + 0.0f);
+	packed.m_alphaCutoff = material.m_alphaCutoff + 0.0f;
+	packed.m_metallic = material.m_metallic + 0.0f;
+	packed.m_roughness = material.m_roughness + 0.0f;
+	packed.m_flags = (material.m_doubleSided ? MATERIAL_FLAG_DOUBLE_SIDED : 0)
+		| (material.m_alphaCutoff > 0.0f ? MATERIAL_FLAG_ALPHA_TESTED : 0)
+		| (material.m_baseColour.w < 1.0f ? MATERIAL_FLAG_BLENDED : 0);
+
+	for (UINT t = 0; t < MATERIAL_TEXTURE_COUNT; ++t)
+	{
+		packed.m_textures[t] = material.m_textures[t].empty() ? c_materialNoTexture : findTexture(material.m_textures[t]);
+	}
+
+	const size_t slot = findSlot(packed);
+
+	if (m_table[slot] != UINT_MAX)
+	{
+		return m_table[slot];
+	}
+
+	const UINT id = static_cast<UINT>(m_materials.size());
+	m_materials.push_back(packed);
+	m_table[slot] = id;
+
+	// kept at most half full
+	if (m_materials.size() * 2 > m_table.size())
+	{
+		m_table.assign(m_table.size() * 2, UINT_MAX);
+		rebuildTable();
+	}
+
+	return id;
+}
+
+void MaterialTable::sortByState(std::vector<UINT> & remap)
+{
+	std::vector<UINT> order(m_materials.size());
+
+	for (UINT i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+
+	// textures in the order a draw would rebind them, the base colour changes most between materials
+	const UINT textureOrder[MATERIAL_TEXTURE_COUNT] =
+	{
+		MATERIAL_TEXTURE_BASE_COLOUR,
+		MATERIAL_TEXTURE_NORMAL,
+		MATERIAL_TEXTURE_METALLIC_ROUGHNESS,
+		MATERIAL_TEXTURE_OCCLUSION,
+		MATERIAL_TEXTURE_EMISSIVE
+	};
+
+	std::sort(order.begin(), order.end(), [&](const UINT a, const UINT b)
+	{
+		const PackedMaterial & first = m_materials[a];
+		const PackedMaterial & second = m_materials[b];
+
+		if (stateRank(first.m_flags) != stateRank(second.m_flags))
+		{
+			return stateRank(first.m_flags) < stateRank(second.m_flags);
+		}
+
+		for (UINT t = 0; t < MATERIAL_TEXTURE_COUNT; ++t)
+		{
+			if (first.m_textures[textureOrder[t]] != second.m_textures[textureOrder[t]])
+			{
+				return first.m_textures[textureOrder[t]] < second.m_textures[textureOrder[t]];
+			}
+		}
+
+		return a < b;
+	});
+
+	std::vector<PackedMaterial> sorted(m_materials.size());
+	remap.resize(m_materials.size());
+
+	for (UINT i = 0; i < order.size(); ++i)
+	{
+		sorted[i] = m_materials[order[i]];
+		remap[order[i]] = i;
+	}
+
+	m_materials.swap(sorted);
+	std::fill(m_table.begin(), m_table.end(), UINT_MAX);
+	rebuildTable();
+}
+
+UINT64 MaterialTable::getSortKey(const UINT materialId, const float viewDepth) const
+{
+	// a positive float's bits sort the same way as the float, and fit in 31 bits
+	const float depth = std::max(viewDepth, 0.0f);
+	UINT depthBits = 0;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	if (materialId < m_materials.size() && (m_materials[materialId].m_flags & MATERIAL_FLAG_BLENDED) != 0)
+	{
+		return (1ull << 63) | (static_cast<UINT64>(0x7fffffffu - depthBits) << 32) | materialId;
+	}
+
+	return (static_cast<UINT64>(materialId & 0x7fffffffu) << 32) | depthBits;
+}
+
+UINT MaterialTable::findTexture(const std::string & name)
+{
+	size_t slot = std::hash<std::string>()(name) & (m_textureTable.size() - 1);
+
+	for (;;)
+	{
+		const UINT existing = m_textureTable[slot];
+
+		if (existing == UINT_MAX)
+		{
+			break;
+		}
+
+		if (m_textureNames[existing] == name)
+		{
+			return existing;
+		}
+
+		slot = (slot + 1) & (m_textureTable.size() - 1);
+	}
+
+	const UINT id = static_cast<UINT>(m_textureNames.size());
+	m_textureNames.push_back(name);
+	m_textureTable[slot] = id;
+
+	if (m_textureNames.size() * 2 > m_textureTable.size())
+	{
+		m_textureTable.assign(m_textureTable.size() * 2, UINT_MAX);
+
+		for (UINT t = 0; t < m_textureNames.size(); ++t)
+		{
+			size_t free = std::hash<std::string>()(m_textureNames[t]) & (m_textureTable.size() - 1);
+
+			while (m_textureTable[free] != UINT_MAX)
+			{
+				free = (free + 1) & (m_textureTable.size() - 1);
+			}
+
+			m_textureTable[free] = t;
+		}
+	}
+
+	return id;
+}
+
+size_t MaterialTable::findSlot(const PackedMaterial & material) const
+{
+	size_t slot = hashMaterial(material) & (m_table.size() - 1);
+
+	while (m_table[slot] != UINT_MAX && memcmp(&m_materials[m_table[slot]], &material, sizeof(PackedMaterial)) != 0)
+	{
+		slot = (slot + 1) & (m_table.size() - 1);
+	}
+
+	return slot;
+}
+
+void MaterialTable::rebuildTable()
+{
+	for (UINT id = 0; id < m_materials.size(); ++id)
+	{
+		m_table[findSlot(m_materials[id])] = id;
+	}
+}
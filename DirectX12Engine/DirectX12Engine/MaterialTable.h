@@ -0,0 +1,112 @@
+#pragma once
+#ifndef _MATERIAL_TABLE_H_
+#define _MATERIAL_TABLE_H_
+
+#include <DirectXMath.h>
+
+#include <climits>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+enum MaterialTextureSlot
+{
+	MATERIAL_TEXTURE_BASE_COLOUR = 0,
+	MATERIAL_TEXTURE_METALLIC_ROUGHNESS,
+	MATERIAL_TEXTURE_NORMAL,
+	MATERIAL_TEXTURE_OCCLUSION,
+	MATERIAL_TEXTURE_EMISSIVE,
+	MATERIAL_TEXTURE_COUNT
+};
+
+enum MaterialFlags
+{
+	MATERIAL_FLAG_DOUBLE_SIDED = 1,
+	MATERIAL_FLAG_ALPHA_TESTED = 2,
+	MATERIAL_FLAG_BLENDED = 4		// base colour alpha under 1, drawn after everything else back to front
+};
+
+const UINT c_materialNoTexture = UINT_MAX;
+
+// an imported material whichever format it came from. textures are named the way the TextureSources are,
+// empty for none. the name isn't kept, two materials that only differ by name are the same material
+struct MaterialDesc
+{
+	DirectX::XMFLOAT4 m_baseColour;	// alpha is the opacity
+	DirectX::XMFLOAT3 m_emissive;
+	float m_metallic;
+	float m_roughness;
+	float m_alphaCutoff;			// 0 unless alpha tested
+	bool m_doubleSided;
+	std::string m_textures[MATERIAL_TEXTURE_COUNT];
+
+	MaterialDesc()
+		: m_baseColour(1.0f, 1.0f, 1.0f, 1.0f)
+		, m_emissive(0.0f, 0.0f, 0.0f)
+		, m_metallic(0.0f)
+		, m_roughness(1.0f)
+		, m_alphaCutoff(0.0f)
+		, m_doubleSided(false)
+	{
+
+	}
+};
+
+// one material as the shaders read it out of the structured buffer, which packs it tightly. four 16 byte rows
+struct PackedMaterial
+{
+	DirectX::XMFLOAT4 m_baseColour;
+	DirectX::XMFLOAT3 m_emissive;
+	float m_alphaCutoff;
+	float m_metallic;
+	float m_roughness;
+	UINT m_flags;								// MaterialFlags
+	UINT m_textures[MATERIAL_TEXTURE_COUNT];	// into the texture names, c_materialNoTexture for none
+};
+
+static_assert(sizeof(PackedMaterial) == 64, "PackedMaterial has to match the shader's structured buffer");
+
+// the unique materials of everything imported, packed ready to upload as one structured buffer and indexed by
+// material id. adding a material that looks like one already there gives back that one's id, so scenes that
+// copy the same material onto every object collapse to a handful. ids are compact, 0 up with no gaps, and
+// once sortByState has run materials that share pipeline state and textures have neighbouring ids, so the id
+// can go straight into a draw's sort key
+class MaterialTable
+{
+public:
+	MaterialTable();
+	~MaterialTable();
+
+	void clear();
+
+	UINT add(const MaterialDesc & material);
+
+	// renumbers so opaque materials come first, then double sided, alpha tested and blended ones, and within
+	// each by texture. remap[old id] is the new id
+	void sortByState(std::vector<UINT> & remap);
+
+	// opaque draws by material then front to back, blended ones after all of them back to front
+	UINT64 getSortKey(const UINT materialId, const float viewDepth) const;
+
+	UINT getMaterialCount() const { return static_cast<UINT>(m_materials.size()); }
+	// every add, repeats included
+	UINT getImportedCount() const { return m_imported; }
+	const std::vector<PackedMaterial> & getPackedMaterials() const { return m_materials; }
+	const std::vector<std::string> & getTextureNames() const { return m_textureNames; }
+
+private:
+
+	UINT findTexture(const std::string & name);
+	// the slot a material is in or should go in, the table is open addressing over m_materials
+	size_t findSlot(const PackedMaterial & material) const;
+	void rebuildTable();
+
+	std::vector<PackedMaterial> m_materials;
+	std::vector<UINT> m_table;
+	std::vector<std::string> m_textureNames;
+	std::vector<UINT> m_textureTable;
+	UINT m_imported;
+};
+
+#endif // _MATERIAL_TABLE_H_
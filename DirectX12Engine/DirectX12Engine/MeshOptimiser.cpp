@@ -0,0 +1,543 @@
+#include "MeshOptimiser.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	// tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	const int c_forsythCacheSize = 32;
+	const float c_cacheDecayPower = 1.5f;
+	const float c_lastTriScore = 0.75f;
+	const float c_valenceBoostScale = 2.0f;
+	const float c_valenceBoostPower = 0.5f;
+
+	float forsythVertexScore(const int cachePosition, const UINT liveTriangles)
+	{
+		if (liveTriangles == 0)
+		{
+			// no triangles left need this vertex
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// was used in the last triangle, fixed score so the strip doesn't just turn back on itself
+				score = c_lastTriScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / static_cast<float>(c_forsythCacheSize - 3);
+				score = 1.0f - static_cast<float>(cachePosition - 3) * scaler;
+				score = std::pow(score, c_cacheDecayPower);
+			}
+		}
+
+		// bonus for vertices with few triangles left, gets rid of lone triangles
+		score += c_valenceBoostScale * std::pow(static_cast<float>(liveTriangles), -c_valenceBoostPower);
+		return score;
+	}
+
+	// runs a FIFO cache over a range of triangles, returns the number of misses
+	UINT simulateFifo(const std::vector<UINT> & indices, const size_t firstTri, const size_t endTri,
+		std::vector<UINT> & cacheTimestamps, UINT & timestamp, const UINT cacheSize)
+	{
+		UINT misses = 0;
+
+		for (size_t i = firstTri * 3; i < endTri * 3; ++i)
+		{
+			const UINT v = indices[i];
+
+			// a vertex is in a FIFO cache while fewer than cacheSize misses happened since it went in
+			if (timestamp - cacheTimestamps[v] > cacheSize)
+			{
+				cacheTimestamps[v] = timestamp;
+				++timestamp;
+				++misses;
+			}
+		}
+
+		return misses;
+	}
+}
+
+MeshOptimiser::MeshOptimiser()
+	: m_cacheSize(16)
+	, m_optimiseOverdraw(true)
+	, m_overdrawThreshold(1.05f)
+{
+
+}
+
+MeshOptimiser::~MeshOptimiser()
+{
+
+}
+
+MeshOptimiserReport MeshOptimiser::optimise(MeshData & mesh) const
+{
+	MeshOptimiserReport report;
+
+	const UINT vertexCount = static_cast<UINT>(mesh.m_vertices.size());
+
+	if (mesh.m_lods.empty())
+	{
+		report.m_before = analyseVertexCache(mesh.m_indices, vertexCount);
+
+		optimiseVertexCache(mesh.m_indices, vertexCount);
+
+		if (m_optimiseOverdraw)
+		{
+			optimiseOverdraw(mesh.m_indices, mesh.m_vertices);
+		}
+	}
+	else
+	{
+		// each level is drawn on its own, so each gets its own triangle order
+		for (size_t i = 0; i < mesh.m_lods.size(); ++i)
+		{
+			const MeshLod & lod = mesh.m_lods[i];
+			std::vector<UINT> lodIndices(mesh.m_indices.begin() + lod.m_indexOffset, mesh.m_indices.begin() + lod.m_indexOffset + lod.m_indexCount);
+
+			if (i == 0)
+			{
+				report.m_before = analyseVertexCache(lodIndices, vertexCount);
+			}
+
+			optimiseVertexCache(lodIndices, vertexCount);
+
+			if (m_optimiseOverdraw)
+			{
+				optimiseOverdraw(lodIndices, mesh.m_vertices);
+			}
+
+			std::copy(lodIndices.begin(), lodIndices.end(), mesh.m_indices.begin() + lod.m_indexOffset);
+		}
+	}
+
+	// the full detail level comes first, so the fetch order favours it
+	optimiseVertexFetch(mesh.m_vertices, mesh.m_indices);
+
+	if (mesh.m_lods.empty())
+	{
+		report.m_after = analyseVertexCache(mesh.m_indices, static_cast<UINT>(mesh.m_vertices.size()));
+	}
+	else
+	{
+		const std::vector<UINT> fullDetail(mesh.m_indices.begin(), mesh.m_indices.begin() + mesh.m_lods[0].m_indexCount);
+		report.m_after = analyseVertexCache(fullDetail, static_cast<UINT>(mesh.m_vertices.size()));
+	}
+
+	return report;
+}
+
+VertexCacheStats MeshOptimiser::analyseVertexCache(const std::vector<UINT> & indices, const UINT vertexCount) const
+{
+	assert(indices.size() % 3 == 0);
+
+	VertexCacheStats stats;
+
+	if (indices.empty())
+	{
+		return stats;
+	}
+
+	// timestamps start far enough back that every vertex is a miss on first use
+	UINT timestamp = m_cacheSize + 1;
+	std::vector<UINT> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+
+	stats.m_triangles = static_cast<UINT>(indices.size() / 3);
+	stats.m_transformedVertices = simulateFifo(indices, 0, stats.m_triangles, cacheTimestamps, timestamp, m_cacheSize);
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		if (!referenced[indices[i]])
+		{
+			referenced[indices[i]] = true;
+			++stats.m_uniqueVertices;
+		}
+	}
+
+	stats.m_acmr = static_cast<float>(stats.m_transformedVertices) / static_cast<float>(stats.m_triangles);
+	stats.m_atvr = static_cast<float>(stats.m_transformedVertices) / static_cast<float>(stats.m_uniqueVertices);
+
+	return stats;
+}
+
+void MeshOptimiser::optimiseVertexCache(std::vector<UINT> & indices, const UINT vertexCount) const
+{
+	assert(indices.size() % 3 == 0);
+
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// build the vertex -> triangle adjacency, stored as one flat array with per vertex offsets
+	std::vector<UINT> liveTriangles(vertexCount, 0);
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		assert(indices[i] < vertexCount);
+		++liveTriangles[indices[i]];
+	}
+
+	std::vector<UINT> adjacencyOffsets(vertexCount + 1, 0);
+
+	for (UINT v = 0; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+	}
+
+	std::vector<UINT> adjacency(indices.size());
+	{
+		std::vector<UINT> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (size_t c = 0; c < 3; ++c)
+			{
+				const UINT v = indices[t * 3 + c];
+				adjacency[fill[v]++] = static_cast<UINT>(t);
+			}
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+
+	for (UINT v = 0; v < vertexCount; ++v)
+	{
+		vertexScore[v] = forsythVertexScore(-1, liveTriangles[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	// the cache holds up to 3 extra entries so the newest triangle can push in before anything is dropped
+	std::vector<UINT> cache;
+	std::vector<UINT> newCache;
+	cache.reserve(c_forsythCacheSize + 3);
+	newCache.reserve(c_forsythCacheSize + 3);
+
+	std::vector<UINT> output;
+	output.reserve(indices.size());
+
+	size_t bestTriangle = 0;
+	size_t scanCursor = 0;
+	float bestScore = triangleScore[0];
+
+	for (size_t t = 1; t < triangleCount; ++t)
+	{
+		if (triangleScore[t] > bestScore)
+		{
+			bestScore = triangleScore[t];
+			bestTriangle = t;
+		}
+	}
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		if (bestScore < 0.0f)
+		{
+			// nothing in the cache has live triangles left, continue from the first unemitted triangle
+			while (emitted[scanCursor])
+			{
+				++scanCursor;
+			}
+			bestTriangle = scanCursor;
+		}
+
+		emitted[bestTriangle] = true;
+
+		const UINT * tri = &indices[bestTriangle * 3];
+
+		output.push_back(tri[0]);
+		output.push_back(tri[1]);
+		output.push_back(tri[2]);
+
+		// the emitted triangle's vertices go to the front of the cache
+		newCache.clear();
+		newCache.push_back(tri[0]);
+		newCache.push_back(tri[1]);
+		newCache.push_back(tri[2]);
+
+		for (size_t c = 0; c < 3; ++c)
+		{
+			const UINT v = tri[c];
+
+			// remove the triangle from the vertex's live list by swapping it to the end of the live range
+			const UINT begin = adjacencyOffsets[v];
+			const UINT end = begin + liveTriangles[v];
+
+			for (UINT a = begin; a < end; ++a)
+			{
+				if (adjacency[a] == bestTriangle)
+				{
+					std::swap(adjacency[a], adjacency[end - 1]);
+					break;
+				}
+			}
+
+			--liveTriangles[v];
+		}
+
+		for (size_t c = 0; c < cache.size(); ++c)
+		{
+			const UINT v = cache[c];
+
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		// anything past the end of the cache has fallen out
+		for (size_t c = c_forsythCacheSize; c < newCache.size(); ++c)
+		{
+			cachePosition[newCache[c]] = -1;
+			vertexScore[newCache[c]] = forsythVertexScore(-1, liveTriangles[newCache[c]]);
+		}
+
+		if (newCache.size() > static_cast<size_t>(c_forsythCacheSize))
+		{
+			newCache.resize(c_forsythCacheSize);
+		}
+
+		cache.swap(newCache);
+
+		for (size_t c = 0; c < cache.size(); ++c)
+		{
+			cachePosition[cache[c]] = static_cast<int>(c);
+			vertexScore[cache[c]] = forsythVertexScore(static_cast<int>(c), liveTriangles[cache[c]]);
+		}
+
+		// rescore the triangles that touch the cache, the best of these gets drawn next
+		bestScore = -1.0f;
+
+		for (size_t c = 0; c < cache.size(); ++c)
+		{
+			const UINT v = cache[c];
+			const UINT begin = adjacencyOffsets[v];
+			const UINT end = begin + liveTriangles[v];
+
+			for (UINT a = begin; a < end; ++a)
+			{
+				const UINT t = adjacency[a];
+				const float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				triangleScore[t] = score;
+
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimiser::optimiseOverdraw(std::vector<UINT> & indices, const std::vector<Vertex> & vertices) const
+{
+	assert(indices.size() % 3 == 0);
+
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	const UINT vertexCount = static_cast<UINT>(vertices.size());
+
+	// split into clusters, a triangle where all 3 vertices miss is a natural restart of the
+	// cache optimised order, inside those clusters split again once the cluster's ACMR gets within the threshold
+	const VertexCacheStats stats = analyseVertexCache(indices, vertexCount);
+	const float acmrLimit = stats.m_acmr * m_overdrawThreshold;
+
+	std::vector<size_t> clusterStarts;
+	{
+		UINT timestamp = m_cacheSize + 1;
+		std::vector<UINT> cacheTimestamps(vertexCount, 0);
+
+		size_t clusterStart = 0;
+		UINT clusterMisses = 0;
+
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			const UINT misses = simulateFifo(indices, t, t + 1, cacheTimestamps, timestamp, m_cacheSize);
+
+			if (t != clusterStart && misses == 3)
+			{
+				clusterStarts.push_back(clusterStart);
+				clusterStart = t;
+				clusterMisses = 0;
+			}
+
+			clusterMisses += misses;
+
+			const float clusterAcmr = static_cast<float>(clusterMisses) / static_cast<float>(t - clusterStart + 1);
+
+			if (clusterAcmr <= acmrLimit && t + 1 < triangleCount)
+			{
+				clusterStarts.push_back(clusterStart);
+				clusterStart = t + 1;
+				clusterMisses = 0;
+
+				// a new cluster may end up drawn anywhere, so start it from a cold cache
+				timestamp += m_cacheSize + 1;
+			}
+		}
+
+		clusterStarts.push_back(clusterStart);
+	}
+
+	if (clusterStarts.size() < 2)
+	{
+		return;
+	}
+
+	// area weighted centroid and normal per cluster
+	struct Cluster
+	{
+		size_t m_start;
+		size_t m_end;
+		float m_sortKey;
+	};
+
+	std::vector<Cluster> clusters(clusterStarts.size());
+	std::vector<DirectX::XMFLOAT3> centroids(clusterStarts.size());
+	std::vector<DirectX::XMFLOAT3> normals(clusterStarts.size());
+
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterStarts.size(); ++c)
+	{
+		clusters[c].m_start = clusterStarts[c];
+		clusters[c].m_end = (c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : triangleCount;
+
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float clusterArea = 0.0f;
+
+		for (size_t t = clusters[c].m_start; t < clusters[c].m_end; ++t)
+		{
+			const DirectX::XMFLOAT3 & p0 = vertices[indices[t * 3]].m_position;
+			const DirectX::XMFLOAT3 & p1 = vertices[indices[t * 3 + 1]].m_position;
+			const DirectX::XMFLOAT3 & p2 = vertices[indices[t * 3 + 2]].m_position;
+
+			const float e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+			const float e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+
+			// cross product length is twice the area, so the un-normalised cross is the area weighted normal
+			const float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0] };
+
+			const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			centroid[0] += (p0.x + p1.x + p2.x) * area;
+			centroid[1] += (p0.y + p1.y + p2.y) * area;
+			centroid[2] += (p0.z + p1.z + p2.z) * area;
+
+			normal[0] += n[0];
+			normal[1] += n[1];
+			normal[2] += n[2];
+
+			clusterArea += area;
+		}
+
+		meshCentroid[0] += centroid[0];
+		meshCentroid[1] += centroid[1];
+		meshCentroid[2] += centroid[2];
+		meshArea += clusterArea;
+
+		const float invArea = clusterArea > 0.0f ? 1.0f / (clusterArea * 3.0f) : 0.0f;
+		centroids[c] = DirectX::XMFLOAT3(centroid[0] * invArea, centroid[1] * invArea, centroid[2] * invArea);
+		normals[c] = DirectX::XMFLOAT3(normal[0], normal[1], normal[2]);
+	}
+
+	const float invMeshArea = meshArea > 0.0f ? 1.0f / (meshArea * 3.0f) : 0.0f;
+	meshCentroid[0] *= invMeshArea;
+	meshCentroid[1] *= invMeshArea;
+	meshCentroid[2] *= invMeshArea;
+
+	// clusters further out along their own normal occlude the rest from most view points, draw them first
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		const float d[3] = {
+			centroids[c].x - meshCentroid[0],
+			centroids[c].y - meshCentroid[1],
+			centroids[c].z - meshCentroid[2] };
+
+		const float length = std::sqrt(normals[c].x * normals[c].x + normals[c].y * normals[c].y + normals[c].z * normals[c].z);
+		const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+
+		clusters[c].m_sortKey = (d[0] * normals[c].x + d[1] * normals[c].y + d[2] * normals[c].z) * invLength;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster & a, const Cluster & b)
+	{
+		return a.m_sortKey > b.m_sortKey;
+	});
+
+	std::vector<UINT> output;
+	output.reserve(indices.size());
+
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		output.insert(output.end(), indices.begin() + clusters[c].m_start * 3, indices.begin() + clusters[c].m_end * 3);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimiser::optimiseVertexFetch(std::vector<Vertex> & vertices, std::vector<UINT> & indices) const
+{
+	const UINT unassigned = ~0u;
+	std::vector<UINT> remap(vertices.size(), unassigned);
+
+	UINT nextVertex = 0;
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		UINT & newIndex = remap[indices[i]];
+
+		if (newIndex == unassigned)
+		{
+			newIndex = nextVertex++;
+		}
+
+		indices[i] = newIndex;
+	}
+
+	// vertices nothing references are dropped
+	std::vector<Vertex> reordered(nextVertex);
+
+	for (size_t v = 0; v < vertices.size(); ++v)
+	{
+		if (remap[v] != unassigned)
+		{
+			reordered[remap[v]] = vertices[v];
+		}
+	}
+
+	vertices.swap(reordered);
+}
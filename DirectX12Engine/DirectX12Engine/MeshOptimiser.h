@@ -0,0 +1,74 @@
+#pragma once
+#ifndef _MESH_OPTIMISER_H_
+#define _MESH_OPTIMISER_H_
+
+#include <vector>
+
+#include "Geomatry.h"
+
+// results of simulating a FIFO post transform cache over an index list
+struct VertexCacheStats
+{
+	UINT m_transformedVertices;
+	UINT m_triangles;
+	UINT m_uniqueVertices;
+	float m_acmr; // average cache miss ratio, transformed vertices per triangle (0.5 is the best a regular grid gets)
+	float m_atvr; // average transformed vertex ratio, transformed vertices per unique vertex (1.0 is perfect)
+
+	VertexCacheStats()
+		: m_transformedVertices(0)
+		, m_triangles(0)
+		, m_uniqueVertices(0)
+		, m_acmr(0.0f)
+		, m_atvr(0.0f)
+	{
+
+	}
+};
+
+struct MeshOptimiserReport
+{
+	VertexCacheStats m_before;
+	VertexCacheStats m_after;
+};
+
+// offline (import / cook time) mesh optimisation, all of this is CPU only.
+// the passes run in the order: vertex cache -> overdraw -> vertex fetch,
+// each later pass keeps the locality the earlier one produced.
+class MeshOptimiser
+{
+public:
+	MeshOptimiser();
+	~MeshOptimiser();
+
+	// size of the FIFO cache used when reporting ACMR / ATVR, 16 is a conservative guess for modern hardware
+	void setCacheSize(const UINT cacheSize) { m_cacheSize = cacheSize; }
+	// overdraw reordering is optional, threshold is how much ACMR it may give up (1.05 = 5% worse)
+	void setOverdrawOptimisation(const bool enabled, const float threshold = 1.05f)
+	{
+		m_optimiseOverdraw = enabled;
+		m_overdrawThreshold = threshold;
+	}
+
+	// runs every pass over the mesh in place and returns the cache stats from before and after,
+	// when the mesh has a lod chain each level is reordered on its own and the stats are for the full detail level
+	MeshOptimiserReport optimise(MeshData & mesh) const;
+
+	VertexCacheStats analyseVertexCache(const std::vector<UINT> & indices, const UINT vertexCount) const;
+
+	// Forsyth's linear speed vertex cache optimisation, reorders triangles only
+	void optimiseVertexCache(std::vector<UINT> & indices, const UINT vertexCount) const;
+	// Tipsify style clustering, splits the cache optimised order into clusters and sorts them so
+	// clusters facing outwards from the mesh centre are drawn first
+	void optimiseOverdraw(std::vector<UINT> & indices, const std::vector<Vertex> & vertices) const;
+	// reorders the vertices into first use order and remaps the indices to match
+	void optimiseVertexFetch(std::vector<Vertex> & vertices, std::vector<UINT> & indices) const;
+
+private:
+
+	UINT m_cacheSize;
+	bool m_optimiseOverdraw;
+	float m_overdrawThreshold;
+};
+
+#endif // _MESH_OPTIMISER_H_
@@ -0,0 +1,521 @@
+#include "MeshSimplifier.h"
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+	// symmetric 4x4 matrix, only the upper triangle is stored
+	struct Quadric
+	{
+		double m_a2, m_ab, m_ac, m_ad;
+		double m_b2, m_bc, m_bd;
+		double m_c2, m_cd;
+		double m_d2;
+		double m_weight;
+
+		Quadric()
+		{
+			memset(this, 0, sizeof(Quadric));
+		}
+
+		// plane ax + by + cz + d = 0 with (a, b, c) unit length, weighted by triangle area
+		static Quadric fromPlane(const double a, const double b, const double c, const double d, const double weight)
+		{
+			Quadric q;
+			q.m_a2 = a * a * weight; q.m_ab = a * b * weight; q.m_ac = a * c * weight; q.m_ad = a * d * weight;
+			q.m_b2 = b * b * weight; q.m_bc = b * c * weight; q.m_bd = b * d * weight;
+			q.m_c2 = c * c * weight; q.m_cd = c * d * weight;
+			q.m_d2 = d * d * weight;
+			q.m_weight = weight;
+			return q;
+		}
+
+		void add(const Quadric & other)
+		{
+			m_a2 += other.m_a2; m_ab += other.m_ab; m_ac += other.m_ac; m_ad += other.m_ad;
+			m_b2 += other.m_b2; m_bc += other.m_bc; m_bd += other.m_bd;
+			m_c2 += other.m_c2; m_cd += other.m_cd;
+			m_d2 += other.m_d2;
+			m_weight += other.m_weight;
+		}
+
+		// v^T Q v with v = (x, y, z, 1), divided by the total weight so it is the
+		// area weighted mean squared distance to the planes rather than growing with area
+		double evaluate(const DirectX::XMFLOAT3 & p) const
+		{
+			if (m_weight <= 0.0)
+			{
+				return 0.0;
+			}
+
+			const double x = p.x;
+			const double y = p.y;
+			const double z = p.z;
+
+			const double sum = x * x * m_a2 + 2.0 * x * y * m_ab + 2.0 * x * z * m_ac + 2.0 * x * m_ad
+				+ y * y * m_b2 + 2.0 * y * z * m_bc + 2.0 * y * m_bd
+				+ z * z * m_c2 + 2.0 * z * m_cd
+				+ m_d2;
+
+			return sum / m_weight;
+		}
+	};
+
+	struct Collapse
+	{
+		double m_cost;
+		UINT m_from;
+		UINT m_to;
+		UINT m_fromVersion;
+		UINT m_toVersion;
+
+		bool operator>(const Collapse & other) const
+		{
+			return m_cost > other.m_cost;
+		}
+	};
+
+	void triangleNormal(const DirectX::XMFLOAT3 & p0, const DirectX::XMFLOAT3 & p1, const DirectX::XMFLOAT3 & p2, double normal[3])
+	{
+		const double e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+		const double e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+
+		normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+
+	UINT64 edgeKey(const UINT a, const UINT b)
+	{
+		return a < b ? (static_cast<UINT64>(a) << 32) | b : (static_cast<UINT64>(b) << 32) | a;
+	}
+
+	// working state for one mesh, the collapse loop only touches this
+	class SimplifierState
+	{
+	public:
+		SimplifierState(const MeshData & mesh)
+			: m_positions(mesh.m_vertices.size())
+			, m_triangles(mesh.m_indices)
+			, m_triangleAlive(mesh.m_indices.size() / 3, true)
+			, m_vertexTriangles(mesh.m_vertices.size())
+			, m_quadrics(mesh.m_vertices.size())
+			, m_versions(mesh.m_vertices.size(), 0)
+			, m_removed(mesh.m_vertices.size(), false)
+			, m_locked(mesh.m_vertices.size(), false)
+			, m_liveTriangles(static_cast<UINT>(mesh.m_indices.size() / 3))
+			, m_maxError(0.0)
+		{
+			for (size_t v = 0; v < mesh.m_vertices.size(); ++v)
+			{
+				m_positions[v] = mesh.m_vertices[v].m_position;
+			}
+
+			buildAdjacencyAndQuadrics();
+			lockBordersAndSeams();
+			queueInitialCollapses();
+		}
+
+		UINT getLiveTriangles() const { return m_liveTriangles; }
+		double getMaxError() const { return m_maxError; }
+
+		// does the cheapest valid collapse, returns false once nothing is left under maxCost
+		bool collapseNext(const double maxCost)
+		{
+			while (!m_queue.empty())
+			{
+				const Collapse collapse = m_queue.top();
+
+				if (collapse.m_cost > maxCost)
+				{
+					return false;
+				}
+
+				m_queue.pop();
+
+				if (m_removed[collapse.m_from] || m_removed[collapse.m_to]
+					|| m_versions[collapse.m_from] != collapse.m_fromVersion
+					|| m_versions[collapse.m_to] != collapse.m_toVersion)
+				{
+					// stale, one of the ends changed since this was queued
+					continue;
+				}
+
+				if (!isValidCollapse(collapse.m_from, collapse.m_to))
+				{
+					continue;
+				}
+
+				applyCollapse(collapse.m_from, collapse.m_to);
+				m_maxError = std::max(m_maxError, collapse.m_cost);
+				return true;
+			}
+
+			return false;
+		}
+
+		void appendLiveTriangles(std::vector<UINT> & indices) const
+		{
+			for (size_t t = 0; t < m_triangleAlive.size(); ++t)
+			{
+				if (m_triangleAlive[t])
+				{
+					indices.push_back(m_triangles[t * 3]);
+					indices.push_back(m_triangles[t * 3 + 1]);
+					indices.push_back(m_triangles[t * 3 + 2]);
+				}
+			}
+		}
+
+	private:
+
+		void buildAdjacencyAndQuadrics()
+		{
+			const size_t triangleCount = m_triangleAlive.size();
+
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				const UINT * tri = &m_triangles[t * 3];
+
+				double normal[3];
+				triangleNormal(m_positions[tri[0]], m_positions[tri[1]], m_positions[tri[2]], normal);
+
+				const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+				if (length > 0.0)
+				{
+					normal[0] /= length;
+					normal[1] /= length;
+					normal[2] /= length;
+
+					const DirectX::XMFLOAT3 & p0 = m_positions[tri[0]];
+					const double d = -(normal[0] * p0.x + normal[1] * p0.y + normal[2] * p0.z);
+
+					// the cross product length is twice the triangle area
+					const Quadric plane = Quadric::fromPlane(normal[0], normal[1], normal[2], d, length * 0.5);
+
+					for (size_t c = 0; c < 3; ++c)
+					{
+						m_quadrics[tri[c]].add(plane);
+					}
+				}
+
+				for (size_t c = 0; c < 3; ++c)
+				{
+					m_vertexTriangles[tri[c]].push_back(static_cast<UINT>(t));
+				}
+			}
+		}
+
+		void lockBordersAndSeams()
+		{
+			// an edge used by exactly one triangle is on an open border
+			std::unordered_map<UINT64, UINT> edgeUse;
+			edgeUse.reserve(m_triangles.size());
+
+			for (size_t t = 0; t < m_triangleAlive.size(); ++t)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					++edgeUse[edgeKey(m_triangles[t * 3 + c], m_triangles[t * 3 + (c + 1) % 3])];
+				}
+			}
+
+			for (auto it = edgeUse.begin(); it != edgeUse.end(); ++it)
+			{
+				if (it->second == 1)
+				{
+					m_locked[static_cast<UINT>(it->first >> 32)] = true;
+					m_locked[static_cast<UINT>(it->first & 0xffffffff)] = true;
+				}
+			}
+
+			// vertices that share a position with another vertex are on an attribute seam,
+			// moving one copy without the other would open a crack
+			struct PositionHash
+			{
+				size_t operator()(const DirectX::XMFLOAT3 & p) const
+				{
+					UINT bits[3];
+					memcpy(bits, &p, sizeof(bits));
+					return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+				}
+			};
+
+			struct PositionEqual
+			{
+				bool operator()(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b) const
+				{
+					return a.x == b.x && a.y == b.y && a.z == b.z;
+				}
+			};
+
+			std::unordered_map<DirectX::XMFLOAT3, UINT, PositionHash, PositionEqual> firstWithPosition;
+			firstWithPosition.reserve(m_positions.size());
+
+			for (UINT v = 0; v < m_positions.size(); ++v)
+			{
+				auto inserted = firstWithPosition.emplace(m_positions[v], v);
+
+				if (!inserted.second)
+				{
+					m_locked[v] = true;
+					m_locked[inserted.first->second] = true;
+				}
+			}
+		}
+
+		void queueInitialCollapses()
+		{
+			for (size_t t = 0; t < m_triangleAlive.size(); ++t)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					const UINT a = m_triangles[t * 3 + c];
+					const UINT b = m_triangles[t * 3 + (c + 1) % 3];
+
+					// each interior edge is seen from both triangles, only queue it from one side
+					if (a < b || m_locked[a] || m_locked[b])
+					{
+						queueCollapse(a, b);
+						queueCollapse(b, a);
+					}
+				}
+			}
+		}
+
+		void queueCollapse(const UINT from, const UINT to)
+		{
+			if (m_locked[from] || from == to)
+			{
+				return;
+			}
+
+			Quadric combined = m_quadrics[from];
+			combined.add(m_quadrics[to]);
+
+			Collapse collapse;
+			collapse.m_cost = std::max(combined.evaluate(m_positions[to]), 0.0);
+			collapse.m_from = from;
+			collapse.m_to = to;
+			collapse.m_fromVersion = m_versions[from];
+			collapse.m_toVersion = m_versions[to];
+
+			m_queue.push(collapse);
+		}
+
+		bool isValidCollapse(const UINT from, const UINT to) const
+		{
+			// every triangle that moves must keep facing the same way
+			const std::vector<UINT> & triangles = m_vertexTriangles[from];
+			bool sharesTriangle = false;
+
+			for (size_t i = 0; i < triangles.size(); ++i)
+			{
+				const UINT t = triangles[i];
+
+				if (!m_triangleAlive[t])
+				{
+					continue;
+				}
+
+				const UINT * tri = &m_triangles[t * 3];
+
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					// this one gets removed
+					sharesTriangle = true;
+					continue;
+				}
+
+				double before[3];
+				triangleNormal(m_positions[tri[0]], m_positions[tri[1]], m_positions[tri[2]], before);
+
+				DirectX::XMFLOAT3 moved[3] = { m_positions[tri[0]], m_positions[tri[1]], m_positions[tri[2]] };
+
+				for (size_t c = 0; c < 3; ++c)
+				{
+					if (tri[c] == from)
+					{
+						moved[c] = m_positions[to];
+					}
+				}
+
+				double after[3];
+				triangleNormal(moved[0], moved[1], moved[2], after);
+
+				const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+				const double afterLengthSq = after[0] * after[0] + after[1] * after[1] + after[2] * after[2];
+
+				if (dot <= 0.0 || afterLengthSq == 0.0)
+				{
+					return false;
+				}
+			}
+
+			// the edge might have gone when a neighbour collapsed
+			return sharesTriangle;
+		}
+
+		void applyCollapse(const UINT from, const UINT to)
+		{
+			std::vector<UINT> & fromTriangles = m_vertexTriangles[from];
+			std::vector<UINT> & toTriangles = m_vertexTriangles[to];
+
+			for (size_t i = 0; i < fromTriangles.size(); ++i)
+			{
+				const UINT t = fromTriangles[i];
+
+				if (!m_triangleAlive[t])
+				{
+					continue;
+				}
+
+				UINT * tri = &m_triangles[t * 3];
+
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					m_triangleAlive[t] = false;
+					--m_liveTriangles;
+					continue;
+				}
+
+				for (size_t c = 0; c < 3; ++c)
+				{
+					if (tri[c] == from)
+					{
+						tri[c] = to;
+					}
+				}
+
+				toTriangles.push_back(t);
+			}
+
+			fromTriangles.clear();
+			m_removed[from] = true;
+			m_quadrics[to].add(m_quadrics[from]);
+			++m_versions[to];
+
+			// drop dead triangles from the survivor and requeue the edges around it with its new quadric
+			toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+				[this](const UINT t) { return !m_triangleAlive[t]; }), toTriangles.end());
+
+			for (size_t i = 0; i < toTriangles.size(); ++i)
+			{
+				const UINT * tri = &m_triangles[toTriangles[i] * 3];
+
+				for (size_t c = 0; c < 3; ++c)
+				{
+					if (tri[c] != to)
+					{
+						queueCollapse(tri[c], to);
+						queueCollapse(to, tri[c]);
+					}
+				}
+			}
+		}
+
+		std::vector<DirectX::XMFLOAT3> m_positions;
+		std::vector<UINT> m_triangles;
+		std::vector<bool> m_triangleAlive;
+		std::vector<std::vector<UINT>> m_vertexTriangles;
+		std::vector<Quadric> m_quadrics;
+		std::vector<UINT> m_versions;
+		std::vector<bool> m_removed;
+		std::vector<bool> m_locked;
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_queue;
+		UINT m_liveTriangles;
+		double m_maxError;
+	};
+}
+
+MeshSimplifier::MeshSimplifier()
+{
+
+}
+
+MeshSimplifier::~MeshSimplifier()
+{
+
+}
+
+void MeshSimplifier::buildLodChain(MeshData & mesh) const
+{
+	assert(mesh.m_indices.size() % 3 == 0);
+	assert(mesh.m_lods.empty());
+
+	const UINT fullIndexCount = static_cast<UINT>(mesh.m_indices.size());
+
+	MeshLod fullDetail;
+	fullDetail.m_indexOffset = 0;
+	fullDetail.m_indexCount = fullIndexCount;
+	fullDetail.m_error = 0.0f;
+	mesh.m_lods.push_back(fullDetail);
+
+	if (m_settings.m_maxLods < 2 || fullIndexCount / 3 <= m_settings.m_minTriangles)
+	{
+		return;
+	}
+
+	SimplifierState state(mesh);
+
+	// the quadric cost is a squared distance
+	const double maxCost = static_cast<double>(m_settings.m_maxError) * static_cast<double>(m_settings.m_maxError);
+
+	UINT previousTriangles = fullIndexCount / 3;
+
+	while (mesh.m_lods.size() < m_settings.m_maxLods)
+	{
+		const UINT target = static_cast<UINT>(static_cast<float>(previousTriangles) * m_settings.m_reductionPerLod);
+
+		if (target < m_settings.m_minTriangles)
+		{
+			break;
+		}
+
+		while (state.getLiveTriangles() > target && state.collapseNext(maxCost))
+		{
+		}
+
+		const UINT reached = state.getLiveTriangles();
+
+		// not worth a level if collapsing got stuck well short of the target
+		if (reached == 0 || static_cast<float>(reached) > static_cast<float>(previousTriangles) * (1.0f + m_settings.m_reductionPerLod) * 0.5f)
+		{
+			break;
+		}
+
+		MeshLod lod;
+		lod.m_indexOffset = static_cast<UINT>(mesh.m_indices.size());
+		state.appendLiveTriangles(mesh.m_indices);
+		lod.m_indexCount = static_cast<UINT>(mesh.m_indices.size()) - lod.m_indexOffset;
+		lod.m_error = static_cast<float>(std::sqrt(state.getMaxError()));
+		mesh.m_lods.push_back(lod);
+
+		previousTriangles = reached;
+
+		if (reached > target)
+		{
+			// ran out of valid collapses under the error limit
+			break;
+		}
+	}
+}
+
+void MeshSimplifier::buildLodChains(std::vector<MeshData> & meshes, JobSystem & jobSystem) const
+{
+	jobSystem.parallelFor(meshes.size(), 1, [this, &meshes](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			buildLodChain(meshes[i]);
+		}
+	});
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef _MESH_SIMPLIFIER_H_
+#define _MESH_SIMPLIFIER_H_
+
+#include <cfloat>
+#include <vector>
+
+#include "Geomatry.h"
+
+class JobSystem;
+
+struct LodChainSettings
+{
+	UINT m_maxLods;			// including the full detail level
+	float m_reductionPerLod;	// triangle count of each level as a fraction of the previous one
+	UINT m_minTriangles;		// stop once a level would go below this
+	float m_maxError;		// stop once collapses cost more than this (object space distance)
+
+	LodChainSettings()
+		: m_maxLods(5)
+		, m_reductionPerLod(0.5f)
+		, m_minTriangles(8)
+		, m_maxError(FLT_MAX)
+	{
+
+	}
+};
+
+// quadric error metric (Garland & Heckbert) simplifier using half edge collapses, so every
+// level keeps using the original vertices and the whole chain can share one vertex buffer.
+// vertices on open borders or attribute seams are locked so the silhouette and uvs don't tear.
+class MeshSimplifier
+{
+public:
+	MeshSimplifier();
+	~MeshSimplifier();
+
+	void setSettings(const LodChainSettings & settings) { m_settings = settings; }
+	const LodChainSettings & getSettings() const { return m_settings; }
+
+	// replaces mesh.m_indices with every level concatenated (full detail first) and fills mesh.m_lods.
+	// the collapses run once, each level is a snapshot of the triangles when its target count is reached
+	void buildLodChain(MeshData & mesh) const;
+
+	// the same for many meshes, one mesh per job
+	void buildLodChains(std::vector<MeshData> & meshes, JobSystem & jobSystem) const;
+
+private:
+
+	LodChainSettings m_settings;
+};
+
+#endif // _MESH_SIMPLIFIER_H_
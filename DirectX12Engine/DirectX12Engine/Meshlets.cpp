@@ -0,0 +1,360 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	MeshletBounds computeBounds(const std::vector<Vertex> & vertices, const UINT * meshletVertices, const UINT vertexCount,
+		const UINT8 * meshletTriangles, const UINT triangleCount)
+	{
+		MeshletBounds bounds;
+
+		// sphere around the centre of the box, not the tightest but cheap and stable
+		DirectX::XMFLOAT3 minimum = vertices[meshletVertices[0]].m_position;
+		DirectX::XMFLOAT3 maximum = minimum;
+
+		for (UINT v = 1; v < vertexCount; ++v)
+		{
+			const DirectX::XMFLOAT3 & p = vertices[meshletVertices[v]].m_position;
+			minimum = DirectX::XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+			maximum = DirectX::XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+		}
+
+		bounds.m_centre = DirectX::XMFLOAT3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+
+		float radiusSq = 0.0f;
+
+		for (UINT v = 0; v < vertexCount; ++v)
+		{
+			const DirectX::XMFLOAT3 & p = vertices[meshletVertices[v]].m_position;
+			const float dx = p.x - bounds.m_centre.x;
+			const float dy = p.y - bounds.m_centre.y;
+			const float dz = p.z - bounds.m_centre.z;
+			radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+		}
+
+		bounds.m_radius = std::sqrt(radiusSq);
+
+		// normal cone, the axis is the average unit normal and the spread is the widest normal from it
+		std::vector<DirectX::XMFLOAT3> normals;
+		normals.reserve(triangleCount);
+
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (UINT t = 0; t < triangleCount; ++t)
+		{
+			const DirectX::XMFLOAT3 & p0 = vertices[meshletVertices[meshletTriangles[t * 3]]].m_position;
+			const DirectX::XMFLOAT3 & p1 = vertices[meshletVertices[meshletTriangles[t * 3 + 1]]].m_position;
+			const DirectX::XMFLOAT3 & p2 = vertices[meshletVertices[meshletTriangles[t * 3 + 2]]].m_position;
+
+			const float e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+			const float e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+			const float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0] };
+
+			const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			if (length == 0.0f)
+			{
+				// degenerate, it has no facing to cull by
+				continue;
+			}
+
+			normals.push_back(DirectX::XMFLOAT3(n[0] / length, n[1] / length, n[2] / length));
+
+			axis[0] += normals.back().x;
+			axis[1] += normals.back().y;
+			axis[2] += normals.back().z;
+		}
+
+		const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+		bounds.m_coneAxis = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		bounds.m_coneCutoff = 1.0f;
+
+		if (axisLength > 0.0f)
+		{
+			bounds.m_coneAxis = DirectX::XMFLOAT3(axis[0] / axisLength, axis[1] / axisLength, axis[2] / axisLength);
+
+			float minDot = 1.0f;
+
+			for (size_t i = 0; i < normals.size(); ++i)
+			{
+				const float d = normals[i].x * bounds.m_coneAxis.x + normals[i].y * bounds.m_coneAxis.y + normals[i].z * bounds.m_coneAxis.z;
+				minDot = std::min(minDot, d);
+			}
+
+			// over 90 degrees wide some triangle always faces the camera
+			if (minDot > 0.0f)
+			{
+				bounds.m_coneCutoff = std::sqrt(1.0f - minDot * minDot);
+			}
+		}
+
+		return bounds;
+	}
+}
+
+MeshletBuilder::MeshletBuilder()
+{
+
+}
+
+MeshletBuilder::~MeshletBuilder()
+{
+
+}
+
+MeshletData MeshletBuilder::build(MeshData & mesh) const
+{
+	// only the full detail level is dense enough to be worth splitting
+	const UINT indexCount = mesh.m_lods.empty() ? static_cast<UINT>(mesh.m_indices.size()) : mesh.m_lods[0].m_indexCount;
+	return build(mesh.m_vertices, mesh.m_indices, 0, indexCount);
+}
+
+MeshletData MeshletBuilder::build(const std::vector<Vertex> & vertices, std::vector<UINT> & indices, const UINT indexOffset, const UINT indexCount) const
+{
+	assert(indexCount % 3 == 0);
+	assert(indexOffset + indexCount <= indices.size());
+
+	MeshletData result;
+
+	const UINT triangleCount = indexCount / 3;
+	const UINT vertexCount = static_cast<UINT>(vertices.size());
+	const UINT * tris = indices.data() + indexOffset;
+
+	if (triangleCount == 0)
+	{
+		return result;
+	}
+
+	// vertex -> triangle adjacency as a flat array with per vertex offsets
+	std::vector<UINT> adjacencyOffsets(vertexCount + 1, 0);
+
+	for (UINT i = 0; i < indexCount; ++i)
+	{
+		++adjacencyOffsets[tris[i] + 1];
+	}
+
+	for (UINT v = 0; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+
+	std::vector<UINT> adjacency(indexCount);
+	{
+		std::vector<UINT> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+		for (UINT i = 0; i < indexCount; ++i)
+		{
+			adjacency[fill[tris[i]]++] = i / 3;
+		}
+	}
+
+	std::vector<bool> assigned(triangleCount, false);
+	std::vector<int> localIndex(vertexCount, -1);
+	std::vector<UINT> reordered;
+	reordered.reserve(indexCount);
+	std::vector<UINT> candidates;
+
+	UINT seedCursor = 0;
+
+	while (reordered.size() < indexCount)
+	{
+		while (assigned[seedCursor])
+		{
+			++seedCursor;
+		}
+
+		Meshlet meshlet;
+		meshlet.m_vertexOffset = static_cast<UINT>(result.m_vertices.size());
+		meshlet.m_vertexCount = 0;
+		meshlet.m_triangleOffset = static_cast<UINT>(result.m_triangles.size() / 3);
+		meshlet.m_triangleCount = 0;
+		meshlet.m_indexOffset = indexOffset + static_cast<UINT>(reordered.size());
+
+		candidates.clear();
+		UINT next = seedCursor;
+
+		for (;;)
+		{
+			// add the triangle, new vertices bring their other triangles in as candidates
+			assigned[next] = true;
+
+			for (UINT c = 0; c < 3; ++c)
+			{
+				const UINT v = tris[next * 3 + c];
+
+				if (localIndex[v] < 0)
+				{
+					localIndex[v] = static_cast<int>(meshlet.m_vertexCount++);
+					result.m_vertices.push_back(v);
+
+					for (UINT a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+					{
+						if (!assigned[adjacency[a]])
+						{
+							candidates.push_back(adjacency[a]);
+						}
+					}
+				}
+
+				result.m_triangles.push_back(static_cast<UINT8>(localIndex[v]));
+				reordered.push_back(v);
+			}
+
+			++meshlet.m_triangleCount;
+
+			if (meshlet.m_triangleCount == c_meshletMaxTriangles)
+			{
+				break;
+			}
+
+			// next is the candidate that needs the fewest new vertices, ties go to the earlier
+			// triangle so the existing cache friendly order is kept where it can be
+			UINT best = triangleCount;
+			UINT bestNewVertices = 4;
+			size_t live = 0;
+
+			for (size_t i = 0; i < candidates.size(); ++i)
+			{
+				const UINT t = candidates[i];
+
+				if (assigned[t])
+				{
+					continue;
+				}
+
+				candidates[live++] = t;
+
+				const UINT newVertices = (localIndex[tris[t * 3]] < 0 ? 1 : 0)
+					+ (localIndex[tris[t * 3 + 1]] < 0 ? 1 : 0)
+					+ (localIndex[tris[t * 3 + 2]] < 0 ? 1 : 0);
+
+				if (meshlet.m_vertexCount + newVertices > c_meshletMaxVertices)
+				{
+					continue;
+				}
+
+				if (newVertices < bestNewVertices || (newVertices == bestNewVertices && t < best))
+				{
+					best = t;
+					bestNewVertices = newVertices;
+				}
+			}
+
+			candidates.resize(live);
+
+			if (best == triangleCount)
+			{
+				break;
+			}
+
+			next = best;
+		}
+
+		for (UINT v = 0; v < meshlet.m_vertexCount; ++v)
+		{
+			localIndex[result.m_vertices[meshlet.m_vertexOffset + v]] = -1;
+		}
+
+		result.m_bounds.push_back(computeBounds(vertices, &result.m_vertices[meshlet.m_vertexOffset], meshlet.m_vertexCount,
+			&result.m_triangles[meshlet.m_triangleOffset * 3], meshlet.m_triangleCount));
+		result.m_meshlets.push_back(meshlet);
+	}
+
+	std::copy(reordered.begin(), reordered.end(), indices.begin() + indexOffset);
+
+	return result;
+}
+
+MeshletCuller::MeshletCuller()
+	: m_useFrustum(false)
+	, m_cameraPosition(0.0f, 0.0f, 0.0f)
+{
+	for (size_t i = 0; i < 6; ++i)
+	{
+		m_frustum[i] = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+}
+
+MeshletCuller::~MeshletCuller()
+{
+
+}
+
+void MeshletCuller::setFrustum(const DirectX::XMFLOAT4 planes[6])
+{
+	for (size_t i = 0; i < 6; ++i)
+	{
+		m_frustum[i] = planes[i];
+	}
+
+	m_useFrustum = true;
+}
+
+bool MeshletCuller::isVisible(const MeshletBounds & bounds) const
+{
+	if (m_useFrustum)
+	{
+		for (size_t i = 0; i < 6; ++i)
+		{
+			const DirectX::XMFLOAT4 & plane = m_frustum[i];
+			const float distance = plane.x * bounds.m_centre.x + plane.y * bounds.m_centre.y + plane.z * bounds.m_centre.z + plane.w;
+
+			if (distance < -bounds.m_radius)
+			{
+				return false;
+			}
+		}
+	}
+
+	if (bounds.m_coneCutoff < 1.0f)
+	{
+		// every triangle faces away when the camera is inside the cone behind the sphere
+		const float dx = bounds.m_centre.x - m_cameraPosition.x;
+		const float dy = bounds.m_centre.y - m_cameraPosition.y;
+		const float dz = bounds.m_centre.z - m_cameraPosition.z;
+		const float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+		const float along = dx * bounds.m_coneAxis.x + dy * bounds.m_coneAxis.y + dz * bounds.m_coneAxis.z;
+
+		if (along >= bounds.m_coneCutoff * length + bounds.m_radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void MeshletCuller::cull(const MeshletData & meshlets, std::vector<IndexRange> & visibleRanges) const
+{
+	visibleRanges.clear();
+
+	for (size_t i = 0; i < meshlets.m_meshlets.size(); ++i)
+	{
+		if (!isVisible(meshlets.m_bounds[i]))
+		{
+			continue;
+		}
+
+		const Meshlet & meshlet = meshlets.m_meshlets[i];
+		const UINT indexCount = meshlet.m_triangleCount * 3;
+
+		if (!visibleRanges.empty() && visibleRanges.back().m_indexOffset + visibleRanges.back().m_indexCount == meshlet.m_indexOffset)
+		{
+			visibleRanges.back().m_indexCount += indexCount;
+		}
+		else
+		{
+			IndexRange range;
+			range.m_indexOffset = meshlet.m_indexOffset;
+			range.m_indexCount = indexCount;
+			visibleRanges.push_back(range);
+		}
+	}
+}
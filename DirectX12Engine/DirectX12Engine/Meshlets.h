@@ -0,0 +1,77 @@
+#pragma once
+#ifndef _MESHLETS_H_
+#define _MESHLETS_H_
+
+#include <vector>
+
+#include "Geomatry.h"
+
+// limits match what mesh shaders are commonly tuned for, 124 keeps the triangle count
+// a multiple of 4 while staying under the 126 primitives hardware vendors suggest
+const UINT c_meshletMaxVertices = 64;
+const UINT c_meshletMaxTriangles = 124;
+
+struct Meshlet
+{
+	UINT m_vertexOffset;	// into MeshletData::m_vertices
+	UINT m_vertexCount;
+	UINT m_triangleOffset;	// into MeshletData::m_triangles, in triangles not bytes
+	UINT m_triangleCount;
+	UINT m_indexOffset;	// the same triangles in the mesh's index list, for the input assembler path
+};
+
+struct MeshletBounds
+{
+	DirectX::XMFLOAT3 m_centre;
+	float m_radius;
+	DirectX::XMFLOAT3 m_coneAxis;	// average facing direction of the triangles
+	float m_coneCutoff;		// sin of the cone half angle, 1 means the cone is too wide to ever cull
+};
+
+// meshlets for one level of a mesh, laid out the way a mesh shader wants them
+struct MeshletData
+{
+	std::vector<Meshlet> m_meshlets;
+	std::vector<MeshletBounds> m_bounds;
+	std::vector<UINT> m_vertices;	// mesh vertex index for each meshlet local vertex
+	std::vector<UINT8> m_triangles;	// 3 meshlet local vertex indices per triangle
+};
+
+class MeshletBuilder
+{
+public:
+	MeshletBuilder();
+	~MeshletBuilder();
+
+	// partitions the triangles of indices[indexOffset, indexOffset + indexCount) into meshlets by
+	// growing each one over neighbouring triangles, then rewrites that range into meshlet order so
+	// every meshlet is also one contiguous draw
+	MeshletData build(const std::vector<Vertex> & vertices, std::vector<UINT> & indices, const UINT indexOffset, const UINT indexCount) const;
+	MeshletData build(MeshData & mesh) const;
+};
+
+// CPU per meshlet culling, everything is in the mesh's object space
+class MeshletCuller
+{
+public:
+	MeshletCuller();
+	~MeshletCuller();
+
+	// planes are (normal, d) with the normal pointing into the frustum
+	void setFrustum(const DirectX::XMFLOAT4 planes[6]);
+	void clearFrustum() { m_useFrustum = false; }
+	void setCameraPosition(const DirectX::XMFLOAT3 & position) { m_cameraPosition = position; }
+
+	bool isVisible(const MeshletBounds & bounds) const;
+
+	// visible meshlets as index ranges, neighbouring meshlets are merged into one range
+	void cull(const MeshletData & meshlets, std::vector<IndexRange> & visibleRanges) const;
+
+private:
+
+	DirectX::XMFLOAT4 m_frustum[6];
+	bool m_useFrustum;
+	DirectX::XMFLOAT3 m_cameraPosition;
+};
+
+#endif // _MESHLETS_H_
@@ -0,0 +1,304 @@
+#include "Morphing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MORPH_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// meshes per job, a face of a few thousand vertices with a handful of active targets is a small job
+	const size_t c_instancesPerJob = 4;
+
+	// weights this close to zero count as off, so a target fading out stops costing anything before it reaches 0
+	const float c_minimumWeight = 0.0001f;
+
+	float activeWeight(const float weight)
+	{
+		return std::fabs(weight) < c_minimumWeight ? 0.0f : weight;
+	}
+
+	// out[vertices[k]] += weight * deltas[k] for k in [first, last)
+	void addScaled(const UINT * vertices, const DirectX::XMFLOAT4 * deltas, const size_t first, const size_t last, const float weight, DirectX::XMFLOAT4 * out)
+	{
+#ifdef MORPH_USE_SSE2
+		const __m128 scale = _mm_set1_ps(weight);
+
+		for (size_t k = first; k < last; ++k)
+		{
+			float * accumulated = &out[vertices[k]].x;
+			_mm_storeu_ps(accumulated, _mm_add_ps(_mm_loadu_ps(accumulated), _mm_mul_ps(scale, _mm_loadu_ps(&deltas[k].x))));
+		}
+#else
+		for (size_t k = first; k < last; ++k)
+		{
+			DirectX::XMFLOAT4 & accumulated = out[vertices[k]];
+			accumulated.x += weight * deltas[k].x;
+			accumulated.y += weight * deltas[k].y;
+			accumulated.z += weight * deltas[k].z;
+		}
+#endif
+	}
+}
+
+void buildMorphTarget(const Vertex * base, const DirectX::XMFLOAT3 * baseNormals, const DirectX::XMFLOAT3 * targetPositions,
+	const DirectX::XMFLOAT3 * targetNormals, const size_t vertexCount, const float threshold, MorphTarget & target)
+{
+	const bool hasNormals = baseNormals != nullptr && targetNormals != nullptr;
+	const float thresholdSquared = threshold * threshold;
+
+	target.m_vertices.clear();
+	target.m_positionDeltas.clear();
+	target.m_normalDeltas.clear();
+
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		const DirectX::XMFLOAT4 position(targetPositions[v].x - base[v].m_position.x, targetPositions[v].y - base[v].m_position.y,
+			targetPositions[v].z - base[v].m_position.z, 0.0f);
+
+		DirectX::XMFLOAT4 normal(0.0f, 0.0f, 0.0f, 0.0f);
+
+		if (hasNormals)
+		{
+			normal = DirectX::XMFLOAT4(targetNormals[v].x - baseNormals[v].x, targetNormals[v].y - baseNormals[v].y, targetNormals[v].z - baseNormals[v].z, 0.0f);
+		}
+
+		const float positionSquared = position.x * position.x + position.y * position.y + position.z * position.z;
+		const float normalSquared = normal.x * normal.x + normal.y * normal.y + normal.z * normal.z;
+
+		if (positionSquared <= thresholdSquared && normalSquared <= thresholdSquared)
+		{
+			continue;
+		}
+
+		target.m_vertices.push_back(static_cast<UINT>(v));
+		target.m_positionDeltas.push_back(position);
+
+		if (hasNormals)
+		{
+			target.m_normalDeltas.push_back(normal);
+		}
+	}
+}
+
+void MorphWeightTrack::sample(const float time, float * out) const
+{
+	if (m_times.empty())
+	{
+		return;
+	}
+
+	const size_t targetCount = m_weights.size() / m_times.size();
+
+	// the first key after time, the one before it is where the interpolation starts
+	const size_t next = std::upper_bound(m_times.begin(), m_times.end(), time) - m_times.begin();
+
+	if (next == 0 || next == m_times.size())
+	{
+		const float * held = &m_weights[(next == 0 ? 0 : next - 1) * targetCount];
+		std::copy(held, held + targetCount, out);
+		return;
+	}
+
+	const float * a = &m_weights[(next - 1) * targetCount];
+	const float * b = &m_weights[next * targetCount];
+	const float t = (time - m_times[next - 1]) / (m_times[next] - m_times[next - 1]);
+
+	for (size_t i = 0; i < targetCount; ++i)
+	{
+		out[i] = a[i] + (b[i] - a[i]) * t;
+	}
+}
+
+MorphInstance::MorphInstance()
+	: m_mesh(nullptr)
+	, m_dirtyBegin(0)
+	, m_dirtyEnd(0)
+{
+
+}
+
+void MorphInstance::setMesh(const MorphedMeshData * mesh)
+{
+	m_mesh = mesh;
+	m_weights.assign(mesh->m_targets.size(), 0.0f);
+
+	m_vertices = mesh->m_vertices;
+	m_normals = mesh->m_normals;
+	m_positions.resize(mesh->m_vertices.size());
+	m_blendedNormals.resize(mesh->m_normals.size());
+
+	// nothing applied yet, the first blend builds the whole mesh
+	m_appliedWeights.clear();
+	m_dirtyBegin = 0;
+	m_dirtyEnd = 0;
+}
+
+MorphBlender::MorphBlender(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+{
+
+}
+
+MorphBlender::~MorphBlender()
+{
+
+}
+
+void MorphBlender::blend(std::vector<MorphInstance> & instances, MorphStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	std::atomic<UINT64> deltas(0);
+	MorphInstance * data = instances.data();
+
+	m_jobSystem.parallelFor(instances.size(), c_instancesPerJob, [data, &deltas](const size_t begin, const size_t end)
+	{
+		UINT64 applied = 0;
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			applied += blendInstance(data[i]);
+		}
+
+		deltas += applied;
+	});
+
+	stats.m_seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+	stats.m_instances = static_cast<UINT>(instances.size());
+	stats.m_deltas = deltas;
+	stats.m_activeTargets = 0;
+	stats.m_dirtyVertices = 0;
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		for (size_t t = 0; t < instances[i].m_weights.size(); ++t)
+		{
+			stats.m_activeTargets += activeWeight(instances[i].m_weights[t]) != 0.0f ? 1 : 0;
+		}
+
+		stats.m_dirtyVertices += instances[i].m_dirtyEnd - instances[i].m_dirtyBegin;
+	}
+}
+
+UINT64 MorphBlender::blendInstance(MorphInstance & instance)
+{
+	const MorphedMeshData & mesh = *instance.m_mesh;
+	const UINT vertexCount = static_cast<UINT>(mesh.m_vertices.size());
+	const size_t targetCount = mesh.m_targets.size();
+	const bool hasNormals = !mesh.m_normals.empty();
+
+	assert(instance.m_weights.size() == targetCount);
+
+	UINT dirtyBegin = vertexCount;
+	UINT dirtyEnd = 0;
+
+	if (instance.m_appliedWeights.size() != targetCount)
+	{
+		dirtyBegin = 0;
+		dirtyEnd = vertexCount;
+		instance.m_appliedWeights.assign(targetCount, 0.0f);
+	}
+	else
+	{
+		// a target that changed weight (turning off included) moves its own vertices and nothing else
+		for (size_t t = 0; t < targetCount; ++t)
+		{
+			const MorphTarget & target = mesh.m_targets[t];
+
+			if (target.m_vertices.empty() || activeWeight(instance.m_weights[t]) == activeWeight(instance.m_appliedWeights[t]))
+			{
+				continue;
+			}
+
+			dirtyBegin = std::min(dirtyBegin, target.m_vertices.front());
+			dirtyEnd = std::max(dirtyEnd, target.m_vertices.back() + 1);
+		}
+	}
+
+	instance.m_appliedWeights = instance.m_weights;
+
+	if (dirtyBegin >= dirtyEnd)
+	{
+		instance.m_dirtyBegin = 0;
+		instance.m_dirtyEnd = 0;
+		return 0;
+	}
+
+	for (UINT v = dirtyBegin; v < dirtyEnd; ++v)
+	{
+		const DirectX::XMFLOAT3 & position = mesh.m_vertices[v].m_position;
+		instance.m_positions[v] = DirectX::XMFLOAT4(position.x, position.y, position.z, 0.0f);
+
+		if (hasNormals)
+		{
+			const DirectX::XMFLOAT3 & normal = mesh.m_normals[v];
+			instance.m_blendedNormals[v] = DirectX::XMFLOAT4(normal.x, normal.y, normal.z, 0.0f);
+		}
+	}
+
+	// every active target that reaches the range goes back on, not only the ones that changed
+	UINT64 applied = 0;
+
+	for (size_t t = 0; t < targetCount; ++t)
+	{
+		const float weight = activeWeight(instance.m_weights[t]);
+
+		if (weight != 0.0f)
+		{
+			applied += applyTarget(mesh.m_targets[t], weight, dirtyBegin, dirtyEnd, instance.m_positions.data(),
+				hasNormals ? instance.m_blendedNormals.data() : nullptr);
+		}
+	}
+
+	for (UINT v = dirtyBegin; v < dirtyEnd; ++v)
+	{
+		const DirectX::XMFLOAT4 & position = instance.m_positions[v];
+		instance.m_vertices[v].m_position = DirectX::XMFLOAT3(position.x, position.y, position.z);
+
+		if (hasNormals)
+		{
+			const DirectX::XMFLOAT4 & normal = instance.m_blendedNormals[v];
+			const float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+			const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+			instance.m_normals[v] = DirectX::XMFLOAT3(normal.x * scale, normal.y * scale, normal.z * scale);
+		}
+	}
+
+	instance.m_dirtyBegin = dirtyBegin;
+	instance.m_dirtyEnd = dirtyEnd;
+
+	return applied;
+}
+
+UINT MorphBlender::applyTarget(const MorphTarget & target, const float weight, const UINT begin, const UINT end,
+	DirectX::XMFLOAT4 * positions, DirectX::XMFLOAT4 * normals)
+{
+	// the vertex list is sorted, so the part inside the range is one run of it
+	const size_t first = std::lower_bound(target.m_vertices.begin(), target.m_vertices.end(), begin) - target.m_vertices.begin();
+	const size_t last = std::lower_bound(target.m_vertices.begin() + first, target.m_vertices.end(), end) - target.m_vertices.begin();
+
+	if (first == last)
+	{
+		return 0;
+	}
+
+	addScaled(target.m_vertices.data(), target.m_positionDeltas.data(), first, last, weight, positions);
+
+	if (normals != nullptr && !target.m_normalDeltas.empty())
+	{
+		addScaled(target.m_vertices.data(), target.m_normalDeltas.data(), first, last, weight, normals);
+	}
+
+	return static_cast<UINT>(last - first);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef _MORPHING_H_
+#define _MORPHING_H_
+
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "Geomatry.h"
+#include "JobSystem.h"
+
+// a target from aiAnimMesh style arrays, which replace every vertex rather than just the ones that move.
+// targetNormals (and baseNormals) can be null, deltas no longer than threshold are left out
+void buildMorphTarget(const Vertex * base, const DirectX::XMFLOAT3 * baseNormals, const DirectX::XMFLOAT3 * targetPositions,
+	const DirectX::XMFLOAT3 * targetNormals, const size_t vertexCount, const float threshold, MorphTarget & target);
+
+// weights for every target over time, like aiMeshMorphAnim but dense. times in seconds
+struct MorphWeightTrack
+{
+	std::vector<float> m_times;
+	std::vector<float> m_weights; // one run of target count weights per key
+
+	// linear between keys and held past either end, out needs one entry per target
+	void sample(const float time, float * out) const;
+};
+
+// one mesh being morphed. the blend only rebuilds the vertices the changed weights reach and reports them
+// as the dirty range, so only that much has to be uploaded
+struct MorphInstance
+{
+	const MorphedMeshData * m_mesh;
+	std::vector<float> m_weights; // per target, set before blending
+
+	// the blended mesh, the normals only when the mesh has them
+	std::vector<Vertex> m_vertices;
+	std::vector<DirectX::XMFLOAT3> m_normals;
+
+	// vertices the last blend changed, [begin, end). empty when nothing moved
+	UINT m_dirtyBegin;
+	UINT m_dirtyEnd;
+
+	// the weights m_vertices were built with and the blend accumulators, kept so a frame doesn't allocate
+	std::vector<float> m_appliedWeights;
+	std::vector<DirectX::XMFLOAT4> m_positions;
+	std::vector<DirectX::XMFLOAT4> m_blendedNormals;
+
+	MorphInstance();
+	void setMesh(const MorphedMeshData * mesh);
+};
+
+struct MorphStats
+{
+	UINT m_instances;
+	UINT64 m_activeTargets;		// non zero weights
+	UINT64 m_deltas;			// deltas applied
+	UINT64 m_dirtyVertices;
+	double m_seconds;
+	UINT m_threadCount;
+
+	double deltasPerSecond() const
+	{
+		return m_seconds > 0.0 ? static_cast<double>(m_deltas) / m_seconds : 0.0;
+	}
+};
+
+// blends morph targets on the job system a few meshes per job. targets with no weight cost nothing
+class MorphBlender
+{
+public:
+	MorphBlender(JobSystem & jobSystem);
+	~MorphBlender();
+
+	void blend(std::vector<MorphInstance> & instances, MorphStats & stats);
+
+	// resets the vertices whose weights changed to the base mesh then adds every active target back over them.
+	// returns the deltas applied
+	static UINT64 blendInstance(MorphInstance & instance);
+
+	// the kernel, weight * delta added for the target's vertices in [begin, end). SSE2 where it is available,
+	// normals is skipped when null. returns the deltas applied
+	static UINT applyTarget(const MorphTarget & target, const float weight, const UINT begin, const UINT end,
+		DirectX::XMFLOAT4 * positions, DirectX::XMFLOAT4 * normals);
+
+private:
+
+	JobSystem & m_jobSystem;
+};
+
+#endif // _MORPHING_H_
@@ -0,0 +1,914 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "TextureLoader.h"
+
+namespace
+{
+	const size_t c_defaultChunkSize = 1024 * 1024;
+	// what Assimp calls the material of faces that come before any usemtl
+	const char * const c_defaultMaterialName = "DefaultMaterial";
+
+	enum ObjAttribute
+	{
+		OBJ_POSITION = 0,
+		OBJ_TEX_COORD,
+		OBJ_NORMAL,
+		OBJ_ATTRIBUTE_COUNT
+	};
+
+	// one corner of a triangle, -1 for an attribute the face doesn't have. a negative index in the file counts back
+	// from the end of what is read so far, the chunk only knows its own part of that so those are stored relative
+	// to the start of the chunk and flagged until the chunk's base is known
+	struct ObjCorner
+	{
+		INT m_index[OBJ_ATTRIBUTE_COUNT];
+		UINT m_relative; // bit per attribute
+	};
+
+	struct ObjMaterialSwitch
+	{
+		UINT m_triangle; // the first triangle of the chunk it applies to
+		std::string m_name;
+	};
+
+	struct ObjChunk
+	{
+		const char * m_begin;
+		const char * m_end;
+
+		std::vector<DirectX::XMFLOAT3> m_positions;
+		std::vector<DirectX::XMFLOAT2> m_texCoords;
+		std::vector<DirectX::XMFLOAT3> m_normals;
+		std::vector<ObjCorner> m_corners; // three per triangle
+		std::vector<ObjMaterialSwitch> m_materialSwitches;
+		std::vector<std::string> m_libraries;
+		bool m_failed;
+
+		// the distinct corners in first use order and, per corner, which of them it is
+		std::vector<ObjCorner> m_uniqueCorners;
+		std::vector<UINT> m_cornerVertices;
+	};
+
+	// corner -> vertex, open addressing over the three indices. positions are never -1 once resolved so
+	// that marks an empty slot
+	class VertexTable
+	{
+	public:
+		explicit VertexTable(const size_t expected)
+		{
+			size_t capacity = 16;
+
+			while (capacity < expected * 2)
+			{
+				capacity *= 2;
+			}
+
+			m_slots.resize(capacity);
+			m_mask = capacity - 1;
+
+			for (Slot & slot : m_slots)
+			{
+				slot.m_position = -1;
+			}
+		}
+
+		// the vertex the corner already has, or the new one it is given
+		UINT insert(const ObjCorner & corner, const UINT vertex, bool & inserted)
+		{
+			const INT * index = corner.m_index;
+			UINT64 hash = static_cast<UINT>(index[OBJ_POSITION]) * 0x9E3779B97F4A7C15ull;
+			hash ^= (static_cast<UINT>(index[OBJ_TEX_COORD]) + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+			hash ^= (static_cast<UINT>(index[OBJ_NORMAL]) + 0x85EBCA77C2B2AE63ull) * 0x165667B19E3779F9ull;
+			hash ^= hash >> 29;
+
+			for (size_t slot = static_cast<size_t>(hash) & m_mask; ; slot = (slot + 1) & m_mask)
+			{
+				Slot & entry = m_slots[slot];
+
+				if (entry.m_position == -1)
+				{
+					entry.m_position = index[OBJ_POSITION];
+					entry.m_texCoord = index[OBJ_TEX_COORD];
+					entry.m_normal = index[OBJ_NORMAL];
+					entry.m_vertex = vertex;
+					inserted = true;
+					return vertex;
+				}
+
+				if (entry.m_position == index[OBJ_POSITION] && entry.m_texCoord == index[OBJ_TEX_COORD] && entry.m_normal == index[OBJ_NORMAL])
+				{
+					inserted = false;
+					return entry.m_vertex;
+				}
+			}
+		}
+
+	private:
+
+		struct Slot
+		{
+			INT m_position;
+			INT m_texCoord;
+			INT m_normal;
+			UINT m_vertex;
+		};
+
+		std::vector<Slot> m_slots;
+		size_t m_mask;
+	};
+
+	bool isSpace(const char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	const char * skipSpaces(const char * text, const char * end)
+	{
+		while (text < end && isSpace(*text))
+		{
+			++text;
+		}
+
+		return text;
+	}
+
+	bool startsWith(const char * text, const char * end, const char * keyword)
+	{
+		const size_t length = strlen(keyword);
+
+		return static_cast<size_t>(end - text) > length && memcmp(text, keyword, length) == 0 && isSpace(text[length]);
+	}
+
+	// the rest of the line without the spaces around it
+	std::string restOfLine(const char * text, const char * end)
+	{
+		text = skipSpaces(text, end);
+
+		while (end > text && (isSpace(end[-1]) || end[-1] == '\r'))
+		{
+			--end;
+		}
+
+		return std::string(text, end);
+	}
+
+	// the last word of the line, map statements can have options in front of the path
+	std::string lastWord(const char * text, const char * end)
+	{
+		const std::string line = restOfLine(text, end);
+		const size_t space = line.find_last_of(" \t");
+
+		return space == std::string::npos ? line : line.substr(space + 1);
+	}
+
+	bool parseIndex(const char *& text, const char * end, INT & index)
+	{
+		const char * p = text;
+		const bool negative = p < end && *p == '-';
+
+		if (negative)
+		{
+			++p;
+		}
+
+		if (p == end || *p < '0' || *p > '9')
+		{
+			return false;
+		}
+
+		INT64 value = 0;
+
+		while (p < end && *p >= '0' && *p <= '9' && value < INT_MAX)
+		{
+			value = value * 10 + (*p - '0');
+			++p;
+		}
+
+		if (value == 0 || value >= INT_MAX)
+		{
+			return false;
+		}
+
+		index = static_cast<INT>(negative ? -value : value);
+		text = p;
+		return true;
+	}
+
+	// one "p", "p/t", "p//n" or "p/t/n" corner, to an index into what has been read or one relative to it
+	bool parseCorner(const char *& text, const char * end, const ObjChunk & chunk, ObjCorner & corner)
+	{
+		const size_t counts[OBJ_ATTRIBUTE_COUNT] = { chunk.m_positions.size(), chunk.m_texCoords.size(), chunk.m_normals.size() };
+
+		corner.m_relative = 0;
+
+		for (UINT attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; ++attribute)
+		{
+			corner.m_index[attribute] = -1;
+
+			if (attribute > 0)
+			{
+				if (text == end || *text != '/')
+				{
+					continue;
+				}
+
+				++text;
+
+				// "p//n" has no texture coordinate
+				if (text < end && *text == '/')
+				{
+					continue;
+				}
+			}
+
+			INT index = 0;
+
+			if (!parseIndex(text, end, index))
+			{
+				return false;
+			}
+
+			if (index > 0)
+			{
+				corner.m_index[attribute] = index - 1;
+			}
+			else
+			{
+				corner.m_index[attribute] = static_cast<INT>(counts[attribute]) + index;
+				corner.m_relative |= 1u << attribute;
+			}
+		}
+
+		return text == end || isSpace(*text) || *text == '\r';
+	}
+
+	DirectX::XMFLOAT3 parseFloat3(const char * text, const char * end)
+	{
+		float values[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (UINT i = 0; i < 3 && ObjLoader::parseFloat(text, end, values[i]); ++i)
+		{
+		}
+
+		return DirectX::XMFLOAT3(values[0], values[1], values[2]);
+	}
+
+	void parseChunk(ObjChunk & chunk)
+	{
+		std::vector<ObjCorner> polygon;
+		chunk.m_failed = false;
+
+		for (const char * line = chunk.m_begin; line < chunk.m_end; )
+		{
+			const char * lineEnd = static_cast<const char*>(memchr(line, '\n', chunk.m_end - line));
+
+			if (lineEnd == nullptr)
+			{
+				lineEnd = chunk.m_end;
+			}
+
+			const char * p = skipSpaces(line, lineEnd);
+			const size_t length = lineEnd - p;
+
+			if (length > 2 && p[0] == 'v' && isSpace(p[1]))
+			{
+				// left handed, the same as aiProcess_MakeLeftHanded
+				DirectX::XMFLOAT3 position = parseFloat3(p + 2, lineEnd);
+				position.z = -position.z;
+				chunk.m_positions.push_back(position);
+			}
+			else if (length > 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+			{
+				DirectX::XMFLOAT3 normal = parseFloat3(p + 3, lineEnd);
+				normal.z = -normal.z;
+				chunk.m_normals.push_back(normal);
+			}
+			else if (length > 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+			{
+				const DirectX::XMFLOAT3 texCoord = parseFloat3(p + 3, lineEnd);
+				chunk.m_texCoords.push_back(DirectX::XMFLOAT2(texCoord.x, texCoord.y));
+			}
+			else if (length > 2 && p[0] == 'f' && isSpace(p[1]))
+			{
+				polygon.clear();
+
+				for (const char * corner = skipSpaces(p + 2, lineEnd); corner < lineEnd && *corner != '\r'; corner = skipSpaces(corner, lineEnd))
+				{
+					ObjCorner parsed;
+
+					if (!parseCorner(corner, lineEnd, chunk, parsed))
+					{
+						chunk.m_failed = true;
+						return;
+					}
+
+					polygon.push_back(parsed);
+				}
+
+				// a fan from the first corner, as aiProcess_Triangulate does for a convex polygon
+				for (size_t i = 2; i < polygon.size(); ++i)
+				{
+					chunk.m_corners.push_back(polygon[0]);
+					chunk.m_corners.push_back(polygon[i - 1]);
+					chunk.m_corners.push_back(polygon[i]);
+				}
+			}
+			else if (startsWith(p, lineEnd, "usemtl"))
+			{
+				chunk.m_materialSwitches.push_back({ static_cast<UINT>(chunk.m_corners.size() / 3), restOfLine(p + 6, lineEnd) });
+			}
+			else if (startsWith(p, lineEnd, "mtllib"))
+			{
+				chunk.m_libraries.push_back(restOfLine(p + 6, lineEnd));
+			}
+
+			line = lineEnd + 1;
+		}
+	}
+
+	// adds the chunk's bases to its relative indices and checks everything is in range
+	bool resolveCorners(ObjChunk & chunk, const size_t bases[OBJ_ATTRIBUTE_COUNT], const size_t totals[OBJ_ATTRIBUTE_COUNT])
+	{
+		for (ObjCorner & corner : chunk.m_corners)
+		{
+			for (UINT attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; ++attribute)
+			{
+				INT64 index = corner.m_index[attribute];
+
+				if ((corner.m_relative & (1u << attribute)) != 0)
+				{
+					index += static_cast<INT64>(bases[attribute]);
+				}
+				else if (index == -1 && attribute != OBJ_POSITION)
+				{
+					continue;
+				}
+
+				if (index < 0 || index >= static_cast<INT64>(totals[attribute]))
+				{
+					return false;
+				}
+
+				corner.m_index[attribute] = static_cast<INT>(index);
+			}
+
+			corner.m_relative = 0;
+		}
+
+		return true;
+	}
+
+	// joins the corners within the chunk, the chunks are joined with each other after
+	void joinCorners(ObjChunk & chunk)
+	{
+		VertexTable table(chunk.m_corners.size());
+		chunk.m_cornerVertices.resize(chunk.m_corners.size());
+
+		for (size_t i = 0; i < chunk.m_corners.size(); ++i)
+		{
+			bool inserted = false;
+			chunk.m_cornerVertices[i] = table.insert(chunk.m_corners[i], static_cast<UINT>(chunk.m_uniqueCorners.size()), inserted);
+
+			if (inserted)
+			{
+				chunk.m_uniqueCorners.push_back(chunk.m_corners[i]);
+			}
+		}
+	}
+
+	ObjMaterial defaultMaterial(const std::string & name)
+	{
+		ObjMaterial material;
+		material.m_name = name;
+		material.m_ambient = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		material.m_diffuse = DirectX::XMFLOAT3(0.6f, 0.6f, 0.6f);
+		material.m_specular = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		material.m_emissive = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		material.m_shininess = 0.0f;
+		material.m_opacity = 1.0f;
+
+		return material;
+	}
+}
+
+ObjLoader::ObjLoader(JobSystem & jobSystem, AssetFileSystem & fileSystem)
+	: m_jobSystem(jobSystem)
+	, m_fileSystem(fileSystem)
+	, m_chunkSize(c_defaultChunkSize)
+{
+
+}
+
+ObjLoader::~ObjLoader()
+{
+
+}
+
+bool ObjLoader::load(const std::string & path, ObjMesh & mesh, ObjLoadStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	AssetView view;
+
+	if (!m_fileSystem.open(path, view))
+	{
+		return false;
+	}
+
+	const size_t directoryEnd = path.find_last_of("/\\");
+	const std::string directory = directoryEnd == std::string::npos ? std::string() : path.substr(0, directoryEnd);
+
+	if (!parse(reinterpret_cast<const char*>(view.m_data), view.m_size, directory, mesh, stats))
+	{
+		return false;
+	}
+
+	// with the map and the .mtl files
+	stats.m_seconds = duration<double>(steady_clock::now() - start).count();
+	return true;
+}
+
+bool ObjLoader::parse(const char * data, const size_t size, const std::string & directory, ObjMesh & mesh, ObjLoadStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	stats = ObjLoadStats();
+	stats.m_bytes = size;
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+
+	mesh = ObjMesh();
+
+	// line aligned chunks, each boundary moved on to the start of the next line
+	std::vector<ObjChunk> chunks(std::max<size_t>((size + m_chunkSize - 1) / std::max<size_t>(m_chunkSize, 1), 1));
+	const char * end = data + size;
+	const char * chunkBegin = data;
+
+	for (size_t c = 0; c < chunks.size(); ++c)
+	{
+		const char * chunkEnd = c + 1 == chunks.size() ? end : data + size * (c + 1) / chunks.size();
+
+		if (chunkEnd < chunkBegin)
+		{
+			chunkEnd = chunkBegin;
+		}
+
+		const char * newline = static_cast<const char*>(memchr(chunkEnd, '\n', end - chunkEnd));
+		chunkEnd = newline == nullptr ? end : newline + 1;
+
+		chunks[c].m_begin = chunkBegin;
+		chunks[c].m_end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	stats.m_chunks = static_cast<UINT>(chunks.size());
+
+	m_jobSystem.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t c = begin; c < end; ++c)
+		{
+			parseChunk(chunks[c]);
+		}
+	});
+
+	// where each chunk's positions etc. start once they are all put together
+	std::vector<size_t> bases(chunks.size() * OBJ_ATTRIBUTE_COUNT);
+	size_t totals[OBJ_ATTRIBUTE_COUNT] = { 0, 0, 0 };
+	size_t triangleCount = 0;
+
+	for (size_t c = 0; c < chunks.size(); ++c)
+	{
+		if (chunks[c].m_failed)
+		{
+			return false;
+		}
+
+		bases[c * OBJ_ATTRIBUTE_COUNT + OBJ_POSITION] = totals[OBJ_POSITION];
+		bases[c * OBJ_ATTRIBUTE_COUNT + OBJ_TEX_COORD] = totals[OBJ_TEX_COORD];
+		bases[c * OBJ_ATTRIBUTE_COUNT + OBJ_NORMAL] = totals[OBJ_NORMAL];
+
+		totals[OBJ_POSITION] += chunks[c].m_positions.size();
+		totals[OBJ_TEX_COORD] += chunks[c].m_texCoords.size();
+		totals[OBJ_NORMAL] += chunks[c].m_normals.size();
+		triangleCount += chunks[c].m_corners.size() / 3;
+	}
+
+	if (triangleCount * 3 > UINT_MAX || totals[OBJ_POSITION] > INT_MAX || totals[OBJ_TEX_COORD] > INT_MAX || totals[OBJ_NORMAL] > INT_MAX)
+	{
+		return false;
+	}
+
+	std::vector<DirectX::XMFLOAT3> positions(totals[OBJ_POSITION]);
+	std::vector<DirectX::XMFLOAT2> texCoords(totals[OBJ_TEX_COORD]);
+	std::vector<DirectX::XMFLOAT3> normals(totals[OBJ_NORMAL]);
+	std::vector<UINT8> resolved(chunks.size(), 0);
+
+	m_jobSystem.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t c = begin; c < end; ++c)
+		{
+			ObjChunk & chunk = chunks[c];
+			const size_t * chunkBases = &bases[c * OBJ_ATTRIBUTE_COUNT];
+
+			std::copy(chunk.m_positions.begin(), chunk.m_positions.end(), positions.begin() + chunkBases[OBJ_POSITION]);
+			std::copy(chunk.m_texCoords.begin(), chunk.m_texCoords.end(), texCoords.begin() + chunkBases[OBJ_TEX_COORD]);
+			std::copy(chunk.m_normals.begin(), chunk.m_normals.end(), normals.begin() + chunkBases[OBJ_NORMAL]);
+			chunk.m_positions = std::vector<DirectX::XMFLOAT3>();
+			chunk.m_texCoords = std::vector<DirectX::XMFLOAT2>();
+			chunk.m_normals = std::vector<DirectX::XMFLOAT3>();
+
+			if (resolveCorners(chunk, chunkBases, totals))
+			{
+				resolved[c] = 1;
+				joinCorners(chunk);
+			}
+		}
+	});
+
+	if (std::find(resolved.begin(), resolved.end(), 0) != resolved.end())
+	{
+		return false;
+	}
+
+	// join across chunks in chunk order, which keeps the vertices in first use order. only the corners each
+	// chunk kept are looked at here
+	size_t uniqueCorners = 0;
+
+	for (const ObjChunk & chunk : chunks)
+	{
+		uniqueCorners += chunk.m_uniqueCorners.size();
+	}
+
+	std::vector<ObjCorner> vertexCorners;
+	vertexCorners.reserve(uniqueCorners);
+	std::vector<std::vector<UINT>> chunkToVertex(chunks.size());
+
+	{
+		VertexTable table(uniqueCorners);
+
+		for (size_t c = 0; c < chunks.size(); ++c)
+		{
+			chunkToVertex[c].resize(chunks[c].m_uniqueCorners.size());
+
+			for (size_t i = 0; i < chunks[c].m_uniqueCorners.size(); ++i)
+			{
+				bool inserted = false;
+				chunkToVertex[c][i] = table.insert(chunks[c].m_uniqueCorners[i], static_cast<UINT>(vertexCorners.size()), inserted);
+
+				if (inserted)
+				{
+					vertexCorners.push_back(chunks[c].m_uniqueCorners[i]);
+				}
+			}
+		}
+	}
+
+	// the materials, from every library the file names and then any it uses that they don't have
+	std::unordered_map<std::string, UINT> materialIndices;
+
+	for (const ObjChunk & chunk : chunks)
+	{
+		for (const std::string & library : chunk.m_libraries)
+		{
+			AssetView view;
+
+			// a missing library isn't fatal, what uses it gets default materials
+			if (m_fileSystem.open(TextureLoader::resolvePath(directory, library), view))
+			{
+				parseMaterials(reinterpret_cast<const char*>(view.m_data), view.m_size, mesh.m_materials);
+			}
+		}
+	}
+
+	for (UINT m = 0; m < mesh.m_materials.size(); ++m)
+	{
+		materialIndices.insert(std::make_pair(mesh.m_materials[m].m_name, m));
+	}
+
+	// runs of triangles with one material, in file order
+	struct MaterialRun
+	{
+		UINT m_material;
+		size_t m_chunk;
+		UINT m_firstTriangle;
+		UINT m_triangleCount;
+	};
+
+	std::vector<MaterialRun> runs;
+	std::vector<size_t> materialTriangles;
+	std::string currentMaterial = c_defaultMaterialName;
+
+	for (size_t c = 0; c < chunks.size(); ++c)
+	{
+		const UINT chunkTriangles = static_cast<UINT>(chunks[c].m_corners.size() / 3);
+		UINT runStart = 0;
+
+		for (size_t s = 0; s <= chunks[c].m_materialSwitches.size(); ++s)
+		{
+			const UINT runEnd = s < chunks[c].m_materialSwitches.size() ? chunks[c].m_materialSwitches[s].m_triangle : chunkTriangles;
+
+			if (runEnd > runStart)
+			{
+				auto found = materialIndices.find(currentMaterial);
+
+				if (found == materialIndices.end())
+				{
+					found = materialIndices.insert(std::make_pair(currentMaterial, static_cast<UINT>(mesh.m_materials.size()))).first;
+					mesh.m_materials.push_back(defaultMaterial(currentMaterial));
+				}
+
+				runs.push_back({ found->second, c, runStart, runEnd - runStart });
+			}
+
+			if (s < chunks[c].m_materialSwitches.size())
+			{
+				currentMaterial = chunks[c].m_materialSwitches[s].m_name;
+				runStart = runEnd;
+			}
+		}
+	}
+
+	materialTriangles.assign(mesh.m_materials.size(), 0);
+
+	for (const MaterialRun & run : runs)
+	{
+		materialTriangles[run.m_material] += run.m_triangleCount;
+	}
+
+	// each material's triangles go together, a counting sort over the runs
+	std::vector<size_t> runOffsets(runs.size());
+
+	{
+		std::vector<size_t> materialOffsets(mesh.m_materials.size());
+		size_t offset = 0;
+
+		for (UINT m = 0; m < mesh.m_materials.size(); ++m)
+		{
+			materialOffsets[m] = offset;
+
+			if (materialTriangles[m] > 0)
+			{
+				mesh.m_submeshes.push_back({ m, static_cast<UINT>(offset * 3), static_cast<UINT>(materialTriangles[m] * 3) });
+			}
+
+			offset += materialTriangles[m];
+		}
+
+		for (size_t r = 0; r < runs.size(); ++r)
+		{
+			runOffsets[r] = materialOffsets[runs[r].m_material];
+			materialOffsets[runs[r].m_material] += runs[r].m_triangleCount;
+		}
+	}
+
+	mesh.m_mesh.m_vertices.resize(vertexCorners.size());
+	mesh.m_mesh.m_indices.resize(triangleCount * 3);
+
+	if (totals[OBJ_NORMAL] > 0)
+	{
+		mesh.m_normals.resize(vertexCorners.size());
+	}
+
+	if (totals[OBJ_TEX_COORD] > 0)
+	{
+		mesh.m_texCoords.resize(vertexCorners.size());
+	}
+
+	m_jobSystem.parallelFor(runs.size(), 16, [&](size_t begin, size_t end)
+	{
+		for (size_t r = begin; r < end; ++r)
+		{
+			const MaterialRun & run = runs[r];
+			const std::vector<UINT> & cornerVertices = chunks[run.m_chunk].m_cornerVertices;
+			const std::vector<UINT> & toVertex = chunkToVertex[run.m_chunk];
+			UINT * indices = &mesh.m_mesh.m_indices[runOffsets[r] * 3];
+
+			for (size_t i = run.m_firstTriangle * 3; i < (run.m_firstTriangle + run.m_triangleCount) * 3; ++i)
+			{
+				*indices++ = toVertex[cornerVertices[i]];
+			}
+		}
+	});
+
+	m_jobSystem.parallelFor(vertexCorners.size(), 16384, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			const ObjCorner & corner = vertexCorners[v];
+			mesh.m_mesh.m_vertices[v].m_position = positions[corner.m_index[OBJ_POSITION]];
+
+			// a corner without one when others have them gets zero
+			if (!mesh.m_normals.empty())
+			{
+				mesh.m_normals[v] = corner.m_index[OBJ_NORMAL] >= 0 ? normals[corner.m_index[OBJ_NORMAL]] : DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+			}
+
+			if (!mesh.m_texCoords.empty())
+			{
+				mesh.m_texCoords[v] = corner.m_index[OBJ_TEX_COORD] >= 0 ? texCoords[corner.m_index[OBJ_TEX_COORD]] : DirectX::XMFLOAT2(0.0f, 0.0f);
+			}
+		}
+	});
+
+	stats.m_positions = static_cast<UINT>(totals[OBJ_POSITION]);
+	stats.m_vertices = static_cast<UINT>(vertexCorners.size());
+	stats.m_triangles = static_cast<UINT>(triangleCount);
+	stats.m_seconds = duration<double>(steady_clock::now() - start).count();
+
+	return true;
+}
+
+void ObjLoader::parseMaterials(const char * data, const size_t size, std::vector<ObjMaterial> & materials)
+{
+	const char * end = data + size;
+	ObjMaterial * material = nullptr;
+
+	for (const char * line = data; line < end; )
+	{
+		const char * lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+
+		if (lineEnd == nullptr)
+		{
+			lineEnd = end;
+		}
+
+		const char * p = skipSpaces(line, lineEnd);
+		line = lineEnd + 1;
+
+		if (startsWith(p, lineEnd, "newmtl"))
+		{
+			materials.push_back(defaultMaterial(restOfLine(p + 6, lineEnd)));
+			material = &materials.back();
+			continue;
+		}
+
+		// anything before the first newmtl has nothing to go on
+		if (material == nullptr)
+		{
+			continue;
+		}
+
+		if (startsWith(p, lineEnd, "Ka"))
+		{
+			material->m_ambient = parseFloat3(p + 3, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "Kd"))
+		{
+			material->m_diffuse = parseFloat3(p + 3, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "Ks"))
+		{
+			material->m_specular = parseFloat3(p + 3, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "Ke"))
+		{
+			material->m_emissive = parseFloat3(p + 3, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "Ns"))
+		{
+			material->m_shininess = parseFloat3(p + 3, lineEnd).x;
+		}
+		else if (startsWith(p, lineEnd, "d"))
+		{
+			material->m_opacity = parseFloat3(p + 2, lineEnd).x;
+		}
+		else if (startsWith(p, lineEnd, "Tr"))
+		{
+			material->m_opacity = 1.0f - parseFloat3(p + 3, lineEnd).x;
+		}
+		else if (startsWith(p, lineEnd, "map_Kd"))
+		{
+			material->m_diffuseMap = lastWord(p + 7, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "map_Ks"))
+		{
+			material->m_specularMap = lastWord(p + 7, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "map_Ke"))
+		{
+			material->m_emissiveMap = lastWord(p + 7, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "map_d"))
+		{
+			material->m_opacityMap = lastWord(p + 6, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "map_Bump") || startsWith(p, lineEnd, "map_bump") || startsWith(p, lineEnd, "bump") || startsWith(p, lineEnd, "norm"))
+		{
+			material->m_normalMap = lastWord(std::find_if(p, lineEnd, isSpace), lineEnd);
+		}
+	}
+}
+
+bool ObjLoader::parseFloat(const char *& text, const char * end, float & value)
+{
+	// exact powers of ten a double holds
+	static const double c_powersOfTen[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char * p = skipSpaces(text, end);
+	bool negative = false;
+
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	// up to 19 significant digits in the mantissa, past that they only move the exponent
+	UINT64 mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool any = false;
+
+	for (; p < end && *p >= '0' && *p <= '9'; ++p)
+	{
+		any = true;
+
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa > 0 ? 1 : 0;
+		}
+		else
+		{
+			++exponent;
+		}
+	}
+
+	if (p < end && *p == '.')
+	{
+		for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+		{
+			any = true;
+
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa > 0 ? 1 : 0;
+				--exponent;
+			}
+		}
+	}
+
+	if (!any)
+	{
+		return false;
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char * e = p + 1;
+		bool negativeExponent = false;
+
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = *e == '-';
+			++e;
+		}
+
+		if (e < end && *e >= '0' && *e <= '9')
+		{
+			int written = 0;
+
+			for (; e < end && *e >= '0' && *e <= '9'; ++e)
+			{
+				written = std::min(written * 10 + (*e - '0'), 1000);
+			}
+
+			exponent += negativeExponent ? -written : written;
+			p = e;
+		}
+	}
+
+	double result = static_cast<double>(mantissa);
+
+	if (mantissa != 0)
+	{
+		if (exponent < 0)
+		{
+			result = exponent >= -22 ? result / c_powersOfTen[-exponent] : result * std::pow(10.0, exponent);
+		}
+		else if (exponent > 0)
+		{
+			result = exponent <= 22 ? result * c_powersOfTen[exponent] : result * std::pow(10.0, exponent);
+		}
+	}
+
+	value = static_cast<float>(negative ? -result : result);
+	text = p;
+
+	return true;
+}
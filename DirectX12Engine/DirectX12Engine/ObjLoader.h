@@ -0,0 +1,103 @@
+#pragma once
+#ifndef _OBJ_LOADER_H_
+#define _OBJ_LOADER_H_
+
+#include <DirectXMath.h>
+
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+#include "AssetFileSystem.h"
+#include "Geomatry.h"
+#include "JobSystem.h"
+
+// what the loader keeps of a .mtl material, colours are linear 0-1 and the maps are paths as the file has them
+struct ObjMaterial
+{
+	std::string m_name;
+	DirectX::XMFLOAT3 m_ambient;
+	DirectX::XMFLOAT3 m_diffuse;
+	DirectX::XMFLOAT3 m_specular;
+	DirectX::XMFLOAT3 m_emissive;
+	float m_shininess;
+	float m_opacity;
+
+	std::string m_diffuseMap;
+	std::string m_specularMap;
+	std::string m_normalMap;
+	std::string m_emissiveMap;
+	std::string m_opacityMap;
+};
+
+// the triangles that use one material, a run of the index list
+struct ObjSubmesh
+{
+	UINT m_material;
+	UINT m_indexOffset;
+	UINT m_indexCount;
+};
+
+// one indexed triangle list for the whole file. vertices are the distinct position / texture coordinate / normal
+// combinations in the order the faces first use them, which is what Assimp gives after aiProcess_JoinIdenticalVertices.
+// the triangles are grouped by material, in file order within each
+struct ObjMesh
+{
+	MeshData m_mesh;
+	// per vertex alongside m_mesh.m_vertices, empty when the file has none
+	std::vector<DirectX::XMFLOAT3> m_normals;
+	std::vector<DirectX::XMFLOAT2> m_texCoords;
+	std::vector<ObjSubmesh> m_submeshes;
+	std::vector<ObjMaterial> m_materials;
+};
+
+struct ObjLoadStats
+{
+	UINT64 m_bytes;
+	UINT m_chunks;
+	UINT m_positions;
+	UINT m_vertices;
+	UINT m_triangles;
+	double m_seconds;
+	UINT m_threadCount;
+
+	double megabytesPerSecond() const
+	{
+		return m_seconds > 0.0 ? static_cast<double>(m_bytes) / (1024.0 * 1024.0) / m_seconds : 0.0;
+	}
+};
+
+// reads .obj / .mtl straight into the engine's vertex format, in place of Assimp for the common case.
+// the file is split into line aligned chunks that are parsed across the job system, then the chunks are stitched
+// together and the vertices joined. the output matches what Assimp gives with aiProcess_Triangulate,
+// aiProcess_JoinIdenticalVertices and aiProcess_MakeLeftHanded: polygons are fanned from their first corner and
+// z is mirrored. normals are only what the file has, nothing is generated.
+// not handled: line continuations, free form geometry, points and lines (skipped)
+class ObjLoader
+{
+public:
+	ObjLoader(JobSystem & jobSystem, AssetFileSystem & fileSystem);
+	~ObjLoader();
+
+	// the .mtl files it names are looked up next to it
+	bool load(const std::string & path, ObjMesh & mesh, ObjLoadStats & stats);
+	// materials that aren't in the libraries it names get a default grey one
+	bool parse(const char * data, const size_t size, const std::string & directory, ObjMesh & mesh, ObjLoadStats & stats);
+
+	static void parseMaterials(const char * data, const size_t size, std::vector<ObjMaterial> & materials);
+
+	// decimal and exponent notation, advances past what it read. false if there was no number there
+	static bool parseFloat(const char *& text, const char * end, float & value);
+
+	// how much of the file each job parses, a file smaller than this is one chunk
+	void setChunkSize(const size_t bytes) { m_chunkSize = bytes; }
+
+private:
+
+	JobSystem & m_jobSystem;
+	AssetFileSystem & m_fileSystem;
+	size_t m_chunkSize;
+};
+
+#endif // _OBJ_LOADER_H_
@@ -0,0 +1,214 @@
+#include "PassScheduler.h"
+
+#include <algorithm>
+#include <map>
+
+PassScheduler::PassScheduler()
+	: m_asyncComputeEnabled(true)
+{
+
+}
+
+PassScheduler::~PassScheduler()
+{
+
+}
+
+void PassScheduler::setAsyncComputeEnabled(const bool enabled)
+{
+	m_asyncComputeEnabled = enabled;
+}
+
+PassHandle PassScheduler::addPass(const PassDesc & desc)
+{
+	const PassHandle handle = static_cast<PassHandle>(m_passes.size());
+
+	for (size_t i = 0; i < desc.m_dependencies.size(); ++i)
+	{
+		// keeps the add order a valid submission order
+		if (desc.m_dependencies[i] >= handle)
+		{
+			throw "PassScheduler::addPass() dependency on a pass that hasn't been added yet";
+		}
+	}
+
+	m_passes.push_back(desc);
+	return handle;
+}
+
+void PassScheduler::clear()
+{
+	m_passes.clear();
+}
+
+std::vector<std::vector<PassHandle>> PassScheduler::resolveDependencies() const
+{
+	std::vector<std::vector<PassHandle>> dependencies(m_passes.size());
+
+	// per resource, the last pass to write it and everything that has read it since
+	std::map<UINT, PassHandle> lastWriter;
+	std::map<UINT, std::vector<PassHandle>> readersSinceWrite;
+
+	for (PassHandle pass = 0; pass < m_passes.size(); ++pass)
+	{
+		const PassDesc & desc = m_passes[pass];
+		std::vector<PassHandle> & passDependencies = dependencies[pass];
+
+		passDependencies = desc.m_dependencies;
+
+		// read after write
+		for (size_t i = 0; i < desc.m_reads.size(); ++i)
+		{
+			const UINT resource = desc.m_reads[i];
+			auto writer = lastWriter.find(resource);
+
+			if (writer != lastWriter.end())
+			{
+				passDependencies.push_back(writer->second);
+			}
+
+			readersSinceWrite[resource].push_back(pass);
+		}
+
+		// write after write and write after read
+		for (size_t i = 0; i < desc.m_writes.size(); ++i)
+		{
+			const UINT resource = desc.m_writes[i];
+			auto writer = lastWriter.find(resource);
+
+			if (writer != lastWriter.end())
+			{
+				passDependencies.push_back(writer->second);
+			}
+
+			std::vector<PassHandle> & readers = readersSinceWrite[resource];
+
+			for (size_t r = 0; r < readers.size(); ++r)
+			{
+				passDependencies.push_back(readers[r]);
+			}
+
+			readers.clear();
+			lastWriter[resource] = pass;
+		}
+
+		passDependencies.erase(std::remove(passDependencies.begin(), passDependencies.end(), pass), passDependencies.end());
+		std::sort(passDependencies.begin(), passDependencies.end());
+		passDependencies.erase(std::unique(passDependencies.begin(), passDependencies.end()), passDependencies.end());
+	}
+
+	return dependencies;
+}
+
+PassSchedule PassScheduler::compile() const
+{
+	const std::vector<std::vector<PassHandle>> dependencies = resolveDependencies();
+	const size_t passCount = m_passes.size();
+
+	std::vector<QueueType> queues(passCount);
+	// 1 based position of each pass on its queue
+	std::vector<UINT> positions(passCount);
+	UINT queueLengths[QUEUE_COUNT] = {};
+
+	for (size_t pass = 0; pass < passCount; ++pass)
+	{
+		queues[pass] = (m_asyncComputeEnabled && m_passes[pass].m_asyncComputeEligible) ? QUEUE_ASYNC_COMPUTE : QUEUE_GRAPHICS;
+		positions[pass] = ++queueLengths[queues[pass]];
+	}
+
+	// a vector clock per pass: for every queue, how far along it is known to be once this pass finishes.
+	// a wait is only needed when a dependency is past what the clock already covers, which is what
+	// keeps the fences minimal, a wait on a later pass or one that came in through another wait covers it
+	struct Clock
+	{
+		UINT m_position[QUEUE_COUNT];
+	};
+
+	std::vector<Clock> passClocks(passCount);
+	Clock queueClocks[QUEUE_COUNT] = {};
+
+	// the pass each wait is for, fence values are only known once every signal has been placed
+	std::vector<std::vector<PassHandle>> waitsOn(passCount);
+	std::vector<bool> needsSignal(passCount, false);
+
+	for (size_t pass = 0; pass < passCount; ++pass)
+	{
+		const QueueType queue = queues[pass];
+		Clock clock = queueClocks[queue];
+
+		for (UINT other = 0; other < QUEUE_COUNT; ++other)
+		{
+			if (other == queue)
+			{
+				// same queue work runs in submission order
+				continue;
+			}
+
+			// only the latest dependency on each queue matters
+			PassHandle latest = 0;
+			bool found = false;
+
+			for (size_t d = 0; d < dependencies[pass].size(); ++d)
+			{
+				const PassHandle dependency = dependencies[pass][d];
+
+				if (queues[dependency] == other && (!found || positions[dependency] > positions[latest]))
+				{
+					latest = dependency;
+					found = true;
+				}
+			}
+
+			if (!found || positions[latest] <= clock.m_position[other])
+			{
+				continue;
+			}
+
+			waitsOn[pass].push_back(latest);
+			needsSignal[latest] = true;
+
+			for (UINT q = 0; q < QUEUE_COUNT; ++q)
+			{
+				clock.m_position[q] = std::max(clock.m_position[q], passClocks[latest].m_position[q]);
+			}
+		}
+
+		clock.m_position[queue] = positions[pass];
+		passClocks[pass] = clock;
+		queueClocks[queue] = clock;
+	}
+
+	PassSchedule schedule;
+	schedule.m_passes.resize(passCount);
+	schedule.m_waitCount = 0;
+
+	for (UINT q = 0; q < QUEUE_COUNT; ++q)
+	{
+		schedule.m_signalCount[q] = 0;
+	}
+
+	for (size_t pass = 0; pass < passCount; ++pass)
+	{
+		ScheduledPass & scheduled = schedule.m_passes[pass];
+		scheduled.m_pass = static_cast<PassHandle>(pass);
+		scheduled.m_queue = queues[pass];
+		scheduled.m_signalValue = needsSignal[pass] ? ++schedule.m_signalCount[queues[pass]] : 0;
+	}
+
+	for (size_t pass = 0; pass < passCount; ++pass)
+	{
+		for (size_t w = 0; w < waitsOn[pass].size(); ++w)
+		{
+			const PassHandle signaller = waitsOn[pass][w];
+
+			FenceWait wait;
+			wait.m_queue = queues[signaller];
+			wait.m_fenceValue = schedule.m_passes[signaller].m_signalValue;
+
+			schedule.m_passes[pass].m_waits.push_back(wait);
+			++schedule.m_waitCount;
+		}
+	}
+
+	return schedule;
+}
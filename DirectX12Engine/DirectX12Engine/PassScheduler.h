@@ -0,0 +1,84 @@
+#pragma once
+#ifndef _PASS_SCHEDULER_H_
+#define _PASS_SCHEDULER_H_
+
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+enum QueueType
+{
+	QUEUE_GRAPHICS = 0,
+	QUEUE_ASYNC_COMPUTE,
+	QUEUE_COUNT
+};
+
+typedef UINT PassHandle;
+
+struct PassDesc
+{
+	std::string m_name;
+	// culling, skinning, post etc. can go on the compute queue and overlap graphics
+	bool m_asyncComputeEligible;
+	// resources are just ids to the scheduler, dependencies are worked out from who reads and writes what
+	std::vector<UINT> m_reads;
+	std::vector<UINT> m_writes;
+	// extra ordering that doesn't go through a resource, must be passes added earlier
+	std::vector<PassHandle> m_dependencies;
+};
+
+struct FenceWait
+{
+	QueueType m_queue;		// the queue that signals
+	UINT64 m_fenceValue;	// relative to the start of the schedule
+};
+
+struct ScheduledPass
+{
+	PassHandle m_pass;
+	QueueType m_queue;
+	// waits to issue on m_queue before the pass runs
+	std::vector<FenceWait> m_waits;
+	// fence value to signal on m_queue after the pass, 0 when nothing on another queue needs it
+	UINT64 m_signalValue;
+};
+
+struct PassSchedule
+{
+	// submission order, passes keep the order they were added in so every wait refers to an earlier signal
+	std::vector<ScheduledPass> m_passes;
+	// how many signals each queue makes, the renderer bumps its fence base by this after each submit
+	UINT64 m_signalCount[QUEUE_COUNT];
+	UINT m_waitCount;
+};
+
+// works out which queue each pass runs on and the fewest cross queue fences that keep the declared
+// dependencies. nothing here touches the device, Dx12Renderer::executePasses does the submits
+class PassScheduler
+{
+public:
+	PassScheduler();
+	~PassScheduler();
+
+	// with async compute off every pass goes on the graphics queue and no fences are needed
+	void setAsyncComputeEnabled(const bool enabled);
+
+	PassHandle addPass(const PassDesc & desc);
+	void clear();
+
+	const PassDesc & getPass(const PassHandle pass) const { return m_passes[pass]; }
+	size_t getPassCount() const { return m_passes.size(); }
+
+	PassSchedule compile() const;
+
+private:
+
+	// every earlier pass this one has to wait for, from resources and explicit dependencies
+	std::vector<std::vector<PassHandle>> resolveDependencies() const;
+
+	bool m_asyncComputeEnabled;
+	std::vector<PassDesc> m_passes;
+};
+
+#endif // _PASS_SCHEDULER_H_
@@ -0,0 +1,199 @@
+#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <cassert>
+
+ResidencyManager::ResidencyManager(ResidencyBackend * backend)
+	: m_backend(backend)
+	, m_stats()
+{
+	assert(m_backend);
+}
+
+ResidencyManager::~ResidencyManager()
+{
+
+}
+
+void ResidencyManager::track(ID3D12Pageable * object, const UINT64 sizeInBytes)
+{
+	if (object == nullptr || m_indices.count(object) != 0)
+	{
+		return;
+	}
+
+	TrackedObject tracked;
+	tracked.m_object = object;
+	tracked.m_size = sizeInBytes;
+	tracked.m_lastUsedFence = 0;
+	tracked.m_resident = true;
+	tracked.m_usedThisFrame = false;
+	tracked.m_neverUsed = true;
+
+	m_indices[object] = m_objects.size();
+	m_objects.push_back(tracked);
+
+	m_stats.m_trackedBytes += sizeInBytes;
+	m_stats.m_residentBytes += sizeInBytes;
+}
+
+void ResidencyManager::untrack(ID3D12Pageable * object)
+{
+	auto found = m_indices.find(object);
+
+	if (found == m_indices.end())
+	{
+		return;
+	}
+
+	const size_t index = found->second;
+	const TrackedObject & tracked = m_objects[index];
+
+	m_stats.m_trackedBytes -= tracked.m_size;
+
+	if (tracked.m_resident)
+	{
+		m_stats.m_residentBytes -= tracked.m_size;
+	}
+
+	m_indices.erase(found);
+
+	// swap the last one into the hole
+	if (index != m_objects.size() - 1)
+	{
+		m_objects[index] = m_objects.back();
+		m_indices[m_objects[index].m_object] = index;
+	}
+
+	m_objects.pop_back();
+}
+
+void ResidencyManager::clear()
+{
+	m_objects.clear();
+	m_indices.clear();
+	m_stats.m_trackedBytes = 0;
+	m_stats.m_residentBytes = 0;
+}
+
+void ResidencyManager::markUsed(ID3D12Pageable * object)
+{
+	auto found = m_indices.find(object);
+
+	if (found != m_indices.end())
+	{
+		m_objects[found->second].m_usedThisFrame = true;
+	}
+}
+
+bool ResidencyManager::isResident(ID3D12Pageable * object) const
+{
+	auto found = m_indices.find(object);
+	return found != m_indices.end() && m_objects[found->second].m_resident;
+}
+
+HRESULT ResidencyManager::prepareFrame(const UINT64 fenceValue)
+{
+	std::vector<ID3D12Pageable*> toMakeResident;
+	UINT64 makeResidentBytes = 0;
+
+	for (size_t i = 0; i < m_objects.size(); ++i)
+	{
+		if (m_objects[i].m_usedThisFrame && !m_objects[i].m_resident)
+		{
+			toMakeResident.push_back(m_objects[i].m_object);
+			makeResidentBytes += m_objects[i].m_size;
+		}
+	}
+
+	m_backend->queryVideoMemory(m_stats.m_budgetBytes, m_stats.m_usageBytes);
+
+	// room for what has to come back in as well
+	const UINT64 wanted = m_stats.m_usageBytes + makeResidentBytes;
+
+	if (wanted > m_stats.m_budgetBytes)
+	{
+		const UINT64 toFree = wanted - m_stats.m_budgetBytes;
+		const UINT64 completedFence = m_backend->getCompletedFenceValue();
+
+		std::vector<size_t> candidates;
+
+		for (size_t i = 0; i < m_objects.size(); ++i)
+		{
+			const TrackedObject & tracked = m_objects[i];
+
+			if (tracked.m_resident && !tracked.m_usedThisFrame && !tracked.m_neverUsed && tracked.m_lastUsedFence <= completedFence)
+			{
+				candidates.push_back(i);
+			}
+		}
+
+		// least recently used first, the biggest of those used at the same time first so fewer objects move
+		std::sort(candidates.begin(), candidates.end(), [this](const size_t a, const size_t b)
+		{
+			if (m_objects[a].m_lastUsedFence != m_objects[b].m_lastUsedFence)
+			{
+				return m_objects[a].m_lastUsedFence < m_objects[b].m_lastUsedFence;
+			}
+
+			return m_objects[a].m_size > m_objects[b].m_size;
+		});
+
+		std::vector<ID3D12Pageable*> toEvict;
+		UINT64 freed = 0;
+
+		for (size_t i = 0; i < candidates.size() && freed < toFree; ++i)
+		{
+			TrackedObject & tracked = m_objects[candidates[i]];
+
+			toEvict.push_back(tracked.m_object);
+			tracked.m_resident = false;
+			freed += tracked.m_size;
+		}
+
+		if (!toEvict.empty())
+		{
+			const HRESULT hRes = m_backend->evict(toEvict);
+
+			if (FAILED(hRes))
+			{
+				return hRes;
+			}
+
+			m_stats.m_residentBytes -= freed;
+			m_stats.m_evictedObjects += toEvict.size();
+			m_stats.m_evictedBytes += freed;
+			++m_stats.m_evictBatches;
+		}
+	}
+
+	if (!toMakeResident.empty())
+	{
+		// blocks until the pages are back, it has to be done before the frame is executed
+		const HRESULT hRes = m_backend->makeResident(toMakeResident);
+
+		if (FAILED(hRes))
+		{
+			return hRes;
+		}
+
+		m_stats.m_residentBytes += makeResidentBytes;
+		m_stats.m_madeResidentObjects += toMakeResident.size();
+		++m_stats.m_makeResidentBatches;
+	}
+
+	for (size_t i = 0; i < m_objects.size(); ++i)
+	{
+		TrackedObject & tracked = m_objects[i];
+
+		if (tracked.m_usedThisFrame)
+		{
+			tracked.m_resident = true;
+			tracked.m_lastUsedFence = fenceValue;
+			tracked.m_neverUsed = false;
+			tracked.m_usedThisFrame = false;
+		}
+	}
+
+	return S_OK;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef _RESIDENCY_MANAGER_H_
+#define _RESIDENCY_MANAGER_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include <d3d12.h>
+
+struct ResidencyStats
+{
+	UINT64 m_budgetBytes;		// what the OS last said this process may use
+	UINT64 m_usageBytes;		// and what it said the process is using
+	UINT64 m_trackedBytes;
+	UINT64 m_residentBytes;		// tracked and not evicted
+	UINT64 m_evictedObjects;	// running totals from here down
+	UINT64 m_evictedBytes;
+	UINT64 m_madeResidentObjects;
+	UINT64 m_evictBatches;
+	UINT64 m_makeResidentBatches;
+};
+
+// the part that talks to the device and the adapter, split out so the bookkeeping can run against a fake
+class ResidencyBackend
+{
+public:
+	virtual ~ResidencyBackend() {}
+
+	// local video memory, from IDXGIAdapter3::QueryVideoMemoryInfo
+	virtual void queryVideoMemory(UINT64 & budget, UINT64 & usage) = 0;
+	virtual HRESULT makeResident(const std::vector<ID3D12Pageable*> & objects) = 0;
+	virtual HRESULT evict(const std::vector<ID3D12Pageable*> & objects) = 0;
+	// the direct queue's frame fence
+	virtual UINT64 getCompletedFenceValue() = 0;
+};
+
+// keeps what the renderer has created under the OS video memory budget. every heap and committed resource is
+// tracked with the fence value of the last frame that used it. once a frame is over budget the least recently
+// used objects the GPU has finished with are evicted, and anything a frame uses that was evicted is made
+// resident again before the frame runs. one Evict and one MakeResident call per frame at most
+class ResidencyManager
+{
+public:
+	ResidencyManager(ResidencyBackend * backend);
+	~ResidencyManager();
+
+	// objects start resident, as they are when created
+	void track(ID3D12Pageable * object, const UINT64 sizeInBytes);
+	// before the object is released
+	void untrack(ID3D12Pageable * object);
+	void clear();
+
+	// the frame being recorded reads or writes the object
+	void markUsed(ID3D12Pageable * object);
+
+	// call once the frame is recorded and before it is executed, fenceValue is what the frame will signal
+	HRESULT prepareFrame(const UINT64 fenceValue);
+
+	const ResidencyStats & getStats() const { return m_stats; }
+	bool isResident(ID3D12Pageable * object) const;
+
+private:
+
+	struct TrackedObject
+	{
+		ID3D12Pageable * m_object;
+		UINT64 m_size;
+		UINT64 m_lastUsedFence;
+		bool m_resident;
+		bool m_usedThisFrame;
+		// nothing has drawn with it yet, so the copy queue may still be filling it. never evicted
+		bool m_neverUsed;
+	};
+
+	ResidencyBackend * m_backend;
+
+	std::vector<TrackedObject> m_objects;
+	std::unordered_map<ID3D12Pageable*, size_t> m_indices;
+
+	ResidencyStats m_stats;
+};
+
+#endif // _RESIDENCY_MANAGER_H_
@@ -0,0 +1,174 @@
+#include "ResourceRegistry.h"
+
+ResourceRegistry::ResourceRegistry(ResidencyManager & residency, CopyUploader & uploader)
+	: m_residency(residency)
+	, m_uploader(uploader)
+	, m_meshes(RESOURCE_MESH)
+	, m_textures(RESOURCE_TEXTURE)
+	, m_buffers(RESOURCE_BUFFER)
+{
+
+}
+
+ResourceRegistry::~ResourceRegistry()
+{
+
+}
+
+ResourceHandle ResourceRegistry::addMesh(const Geometry & mesh)
+{
+	return m_meshes.add(mesh);
+}
+
+ResourceHandle ResourceRegistry::addTexture(const Texture & texture)
+{
+	return m_textures.add(texture);
+}
+
+ResourceHandle ResourceRegistry::addBuffer(const Microsoft::WRL::ComPtr<ID3D12Resource> & buffer)
+{
+	return m_buffers.add(buffer);
+}
+
+ID3D12Resource * ResourceRegistry::getBuffer(const ResourceHandle buffer)
+{
+	const Microsoft::WRL::ComPtr<ID3D12Resource> * found = m_buffers.get(buffer);
+	return found != nullptr ? found->Get() : nullptr;
+}
+
+void ResourceRegistry::markUsed(const ResourceHandle resource, const UINT64 fenceValue)
+{
+	switch (getType(resource))
+	{
+	case RESOURCE_MESH:
+		if (const Geometry * mesh = m_meshes.get(resource))
+		{
+			m_meshes.markUsed(resource, fenceValue);
+
+			if (mesh->m_vertexBuffer.Get() != nullptr)
+			{
+				m_residency.markUsed(mesh->m_vertexBuffer.Get());
+			}
+
+			if (mesh->m_indexBuffer.Get() != nullptr)
+			{
+				m_residency.markUsed(mesh->m_indexBuffer.Get());
+			}
+		}
+		break;
+
+	case RESOURCE_TEXTURE:
+		if (const Texture * texture = m_textures.get(resource))
+		{
+			m_textures.markUsed(resource, fenceValue);
+
+			if (texture->m_resource.Get() != nullptr)
+			{
+				m_residency.markUsed(texture->m_resource.Get());
+			}
+		}
+		break;
+
+	case RESOURCE_BUFFER:
+		if (ID3D12Resource * buffer = getBuffer(resource))
+		{
+			m_buffers.markUsed(resource, fenceValue);
+			m_residency.markUsed(buffer);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+bool ResourceRegistry::release(const ResourceHandle resource)
+{
+	switch (getType(resource))
+	{
+	case RESOURCE_MESH:
+		return m_meshes.release(resource);
+
+	case RESOURCE_TEXTURE:
+		return m_textures.release(resource);
+
+	case RESOURCE_BUFFER:
+		return m_buffers.release(resource);
+
+	default:
+		return false;
+	}
+}
+
+bool ResourceRegistry::retireTexture(const ResourceHandle texture, const Texture & old)
+{
+	return m_textures.retire(texture, old);
+}
+
+UINT ResourceRegistry::collect(const UINT64 completedFenceValue)
+{
+	std::vector<Geometry> meshes;
+	std::vector<Texture> textures;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> buffers;
+
+	const auto isUploadComplete = [this](const UploadTicket ticket) { return m_uploader.isComplete(ticket); };
+
+	m_meshes.collect(completedFenceValue, isUploadComplete, meshes);
+	m_textures.collect(completedFenceValue, isUploadComplete, textures);
+	m_buffers.collect(completedFenceValue, buffers);
+
+	return untrackReleased(meshes, textures, buffers);
+}
+
+void ResourceRegistry::clear()
+{
+	std::vector<Geometry> meshes;
+	std::vector<Texture> textures;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> buffers;
+
+	m_meshes.clear(meshes);
+	m_textures.clear(textures);
+	m_buffers.clear(buffers);
+
+	untrackReleased(meshes, textures, buffers);
+}
+
+UINT ResourceRegistry::getLiveCount() const
+{
+	return m_meshes.getLiveCount() + m_textures.getLiveCount() + m_buffers.getLiveCount();
+}
+
+UINT ResourceRegistry::getPendingCount() const
+{
+	return m_meshes.getPendingCount() + m_textures.getPendingCount() + m_buffers.getPendingCount();
+}
+
+void ResourceRegistry::untrack(ID3D12Resource * resource)
+{
+	if (resource != nullptr)
+	{
+		m_residency.untrack(resource);
+	}
+}
+
+UINT ResourceRegistry::untrackReleased(const std::vector<Geometry> & meshes, const std::vector<Texture> & textures,
+	const std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> & buffers)
+{
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		untrack(meshes[i].m_vertexBuffer.Get());
+		untrack(meshes[i].m_indexBuffer.Get());
+	}
+
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		untrack(textures[i].m_resource.Get());
+	}
+
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		untrack(buffers[i].Get());
+	}
+
+	return static_cast<UINT>(meshes.size() + textures.size() + buffers.size());
+}
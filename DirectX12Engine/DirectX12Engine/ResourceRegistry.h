@@ -0,0 +1,308 @@
+#pragma once
+#ifndef _RESOURCE_REGISTRY_H_
+#define _RESOURCE_REGISTRY_H_
+
+#include <wrl.h>
+
+#include <d3d12.h>
+
+#include <climits>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "CopyUploader.h"
+#include "Geomatry.h"
+#include "ResidencyManager.h"
+#include "Texture.h"
+
+// slot index, the pool it came from and the slot's generation when it was handed out. 0 is never a live handle
+typedef UINT64 ResourceHandle;
+
+const ResourceHandle c_invalidResourceHandle = 0;
+
+enum ResourceType
+{
+	RESOURCE_MESH = 0,
+	RESOURCE_TEXTURE,
+	RESOURCE_BUFFER,
+	RESOURCE_TYPE_COUNT
+};
+
+// the copy that fills it, 0 for anything that isn't written through the copy queue
+template<typename T>
+UploadTicket getUploadTicket(const T &)
+{
+	return 0;
+}
+
+inline UploadTicket getUploadTicket(const Geometry & mesh)
+{
+	return mesh.m_uploadTicket;
+}
+
+inline UploadTicket getUploadTicket(const Texture & texture)
+{
+	return texture.m_uploadTicket;
+}
+
+// resources of one type by handle. a lookup is an index and a generation compare. releasing bumps the slot's
+// generation so every copy of the handle goes stale at once, and the slot can be handed out again straight
+// away. the resource itself waits in a queue with the fence value of the last frame that used it and only
+// comes back out of collect once that fence has completed, and the copy that fills it has landed, since one
+// released before its upload finished may still be written by the copy queue
+template<typename T>
+class ResourcePool
+{
+public:
+	ResourcePool(const ResourceType type)
+		: m_type(type)
+	{
+
+	}
+
+	~ResourcePool()
+	{
+
+	}
+
+	ResourceHandle add(const T & resource)
+	{
+		UINT index = 0;
+
+		if (!m_freeSlots.empty())
+		{
+			index = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			index = static_cast<UINT>(m_slots.size());
+			m_slots.push_back(Slot());
+			m_slots.back().m_generation = 1;
+		}
+
+		Slot & slot = m_slots[index];
+		slot.m_resource = resource;
+		slot.m_lastUsedFence = 0;
+		slot.m_live = true;
+
+		return (static_cast<UINT64>(slot.m_generation) << 32) | (static_cast<UINT64>(m_type) << 30) | index;
+	}
+
+	// nullptr when the handle is stale or from another pool
+	T * get(const ResourceHandle handle)
+	{
+		const UINT index = find(handle);
+		return index != UINT_MAX ? std::addressof(m_slots[index].m_resource) : nullptr;
+	}
+
+	const T * get(const ResourceHandle handle) const
+	{
+		const UINT index = find(handle);
+		return index != UINT_MAX ? std::addressof(m_slots[index].m_resource) : nullptr;
+	}
+
+	// the frame that will signal fenceValue reads it
+	void markUsed(const ResourceHandle handle, const UINT64 fenceValue)
+	{
+		const UINT index = find(handle);
+
+		if (index != UINT_MAX && fenceValue > m_slots[index].m_lastUsedFence)
+		{
+			m_slots[index].m_lastUsedFence = fenceValue;
+		}
+	}
+
+	// false when the handle was already stale
+	bool release(const ResourceHandle handle)
+	{
+		const UINT index = find(handle);
+
+		if (index == UINT_MAX)
+		{
+			return false;
+		}
+
+		Slot & slot = m_slots[index];
+		queue(slot.m_resource, slot.m_lastUsedFence, getUploadTicket(slot.m_resource));
+		slot.m_resource = T();
+		slot.m_live = false;
+
+		// never back to 0, so a handle can't come round to 0 either
+		slot.m_generation = slot.m_generation == UINT_MAX ? 1 : slot.m_generation + 1;
+		m_freeSlots.push_back(index);
+
+		return true;
+	}
+
+	// something the handle's resource has just replaced, kept until the frames that used the handle are over
+	bool retire(const ResourceHandle handle, const T & old)
+	{
+		const UINT index = find(handle);
+
+		if (index == UINT_MAX)
+		{
+			return false;
+		}
+
+		queue(old, m_slots[index].m_lastUsedFence, getUploadTicket(old));
+		return true;
+	}
+
+	// moves out everything whose last use has completed and whose upload has landed, lowest fence first and in
+	// release order within a fence. one still being copied into stays, without holding up those behind it.
+	// dropping them is what frees them
+	template<typename IsUploadComplete>
+	void collect(const UINT64 completedFenceValue, IsUploadComplete isUploadComplete, std::vector<T> & released)
+	{
+		typename std::deque<PendingRelease>::iterator position = m_pending.begin();
+
+		while (position != m_pending.end() && position->m_fenceValue <= completedFenceValue)
+		{
+			if (position->m_uploadTicket != 0 && !isUploadComplete(position->m_uploadTicket))
+			{
+				++position;
+				continue;
+			}
+
+			released.push_back(position->m_resource);
+			position = m_pending.erase(position);
+		}
+	}
+
+	// for pools where nothing is written through the copy queue
+	void collect(const UINT64 completedFenceValue, std::vector<T> & released)
+	{
+		collect(completedFenceValue, [](const UploadTicket) { return true; }, released);
+	}
+
+	// everything, live or waiting. only once the GPU is idle
+	void clear(std::vector<T> & released)
+	{
+		for (size_t i = 0; i < m_pending.size(); ++i)
+		{
+			released.push_back(m_pending[i].m_resource);
+		}
+
+		for (UINT index = 0; index < m_slots.size(); ++index)
+		{
+			if (m_slots[index].m_live)
+			{
+				released.push_back(m_slots[index].m_resource);
+			}
+		}
+
+		m_pending.clear();
+		m_slots.clear();
+		m_freeSlots.clear();
+	}
+
+	UINT getLiveCount() const { return static_cast<UINT>(m_slots.size() - m_freeSlots.size()); }
+	UINT getPendingCount() const { return static_cast<UINT>(m_pending.size()); }
+
+private:
+
+	struct Slot
+	{
+		T m_resource;
+		UINT64 m_lastUsedFence;
+		UINT m_generation;
+		bool m_live;
+	};
+
+	struct PendingRelease
+	{
+		T m_resource;
+		UINT64 m_fenceValue;
+		UploadTicket m_uploadTicket;
+	};
+
+	UINT find(const ResourceHandle handle) const
+	{
+		const UINT index = static_cast<UINT>(handle & 0x3fffffff);
+
+		if (((handle >> 30) & 3) != static_cast<UINT64>(m_type) || index >= m_slots.size())
+		{
+			return UINT_MAX;
+		}
+
+		const Slot & slot = m_slots[index];
+		return slot.m_live && slot.m_generation == static_cast<UINT>(handle >> 32) ? index : UINT_MAX;
+	}
+
+	void queue(const T & resource, const UINT64 fenceValue, const UploadTicket uploadTicket)
+	{
+		// kept in fence order. releases nearly always carry the newest fence, so this is usually the back
+		PendingRelease pending;
+		pending.m_resource = resource;
+		pending.m_fenceValue = fenceValue;
+		pending.m_uploadTicket = uploadTicket;
+
+		typename std::deque<PendingRelease>::iterator position = m_pending.end();
+
+		while (position != m_pending.begin() && (position - 1)->m_fenceValue > fenceValue)
+		{
+			--position;
+		}
+
+		m_pending.insert(position, pending);
+	}
+
+	ResourceType m_type;
+	std::vector<Slot> m_slots;
+	std::vector<UINT> m_freeSlots;
+	std::deque<PendingRelease> m_pending;
+};
+
+// the renderer's meshes, textures and buffers. what collect frees is untracked from the residency manager first.
+// meshes and textures also wait for the upload their ticket names
+class ResourceRegistry
+{
+public:
+	ResourceRegistry(ResidencyManager & residency, CopyUploader & uploader);
+	~ResourceRegistry();
+
+	ResourceHandle addMesh(const Geometry & mesh);
+	ResourceHandle addTexture(const Texture & texture);
+	ResourceHandle addBuffer(const Microsoft::WRL::ComPtr<ID3D12Resource> & buffer);
+
+	// nullptr when the handle is stale or of another type
+	Geometry * getMesh(const ResourceHandle mesh) { return m_meshes.get(mesh); }
+	Texture * getTexture(const ResourceHandle texture) { return m_textures.get(texture); }
+	ID3D12Resource * getBuffer(const ResourceHandle buffer);
+
+	static ResourceType getType(const ResourceHandle resource) { return static_cast<ResourceType>((resource >> 30) & 3); }
+
+	// the frame that will signal fenceValue reads it, which also marks it used for residency
+	void markUsed(const ResourceHandle resource, const UINT64 fenceValue);
+	// the handle is stale from here on, the resource is freed by the first collect after its last use completes
+	// and its upload has landed
+	bool release(const ResourceHandle resource);
+	// the texture's old resource once its contents have moved to a new one, freed the same way
+	bool retireTexture(const ResourceHandle texture, const Texture & old);
+
+	// frees everything the GPU has finished with, returns how many
+	UINT collect(const UINT64 completedFenceValue);
+	// everything, only once the GPU is idle
+	void clear();
+
+	UINT getLiveCount() const;
+	UINT getPendingCount() const;
+
+private:
+
+	void untrack(ID3D12Resource * resource);
+	// untracks them, the caller dropping them is what frees them. returns how many
+	UINT untrackReleased(const std::vector<Geometry> & meshes, const std::vector<Texture> & textures,
+		const std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> & buffers);
+
+	ResidencyManager & m_residency;
+	CopyUploader & m_uploader;
+
+	ResourcePool<Geometry> m_meshes;
+	ResourcePool<Texture> m_textures;
+	ResourcePool<Microsoft::WRL::ComPtr<ID3D12Resource>> m_buffers;
+};
+
+#endif // _RESOURCE_REGISTRY_H_
@@ -0,0 +1,422 @@
+#include "SceneFlattener.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+namespace
+{
+	const UINT c_defaultMaxBatchVertices = 65536;
+	const size_t c_defaultGrainSize = 64;
+	// bits per axis of the Morton codes
+	const UINT c_mortonBits = 10;
+
+	// row vector, the transforms are affine
+	DirectX::XMFLOAT3 transformPoint(const DirectX::XMFLOAT3 & p, const DirectX::XMFLOAT4X4 & m)
+	{
+		return DirectX::XMFLOAT3(
+			p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41,
+			p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42,
+			p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43);
+	}
+
+	float determinant3x3(const DirectX::XMFLOAT4X4 & m)
+	{
+		return m._11 * (m._22 * m._33 - m._23 * m._32)
+			- m._12 * (m._21 * m._33 - m._23 * m._31)
+			+ m._13 * (m._21 * m._32 - m._22 * m._31);
+	}
+
+	// the low 10 bits of v spread out to every third bit
+	UINT spreadBits(UINT v)
+	{
+		v &= 0x3ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+
+		return v;
+	}
+
+	UINT quantise(const float value, const float minimum, const float extent)
+	{
+		const UINT cells = (1u << c_mortonBits) - 1;
+		const float t = extent > 0.0f ? (value - minimum) / extent : 0.0f;
+
+		return static_cast<UINT>(std::max(0.0f, std::min(t, 1.0f)) * cells + 0.5f);
+	}
+
+	UINT hashVertex(const Vertex & vertex)
+	{
+		// + 0.0f so -0 and 0 hash the same, they compare equal
+		const float components[7] = { vertex.m_position.x + 0.0f, vertex.m_position.y + 0.0f, vertex.m_position.z + 0.0f,
+			vertex.m_colour.x + 0.0f, vertex.m_colour.y + 0.0f, vertex.m_colour.z + 0.0f, vertex.m_colour.w + 0.0f };
+		UINT bits[7];
+		memcpy(bits, components, sizeof(bits));
+
+		UINT hash = 2166136261u;
+
+		for (UINT i = 0; i < 7; ++i)
+		{
+			hash = (hash ^ bits[i]) * 16777619u;
+		}
+
+		return hash ^ (hash >> 15);
+	}
+
+	bool sameVertex(const Vertex & a, const Vertex & b)
+	{
+		return a.m_position.x == b.m_position.x && a.m_position.y == b.m_position.y && a.m_position.z == b.m_position.z
+			&& a.m_colour.x == b.m_colour.x && a.m_colour.y == b.m_colour.y && a.m_colour.z == b.m_colour.z && a.m_colour.w == b.m_colour.w;
+	}
+
+	// welds vertices[0, count) in place keeping the first of each, indices are remapped to match.
+	// returns how many are left
+	UINT weldVertices(Vertex * vertices, const UINT count, UINT * indices, const UINT indexCount)
+	{
+		size_t tableSize = 16;
+
+		while (tableSize < static_cast<size_t>(count) * 2)
+		{
+			tableSize *= 2;
+		}
+
+		// open addressing, each slot a welded vertex
+		std::vector<UINT> table(tableSize, UINT_MAX);
+		std::vector<UINT> remap(count);
+		UINT welded = 0;
+
+		for (UINT v = 0; v < count; ++v)
+		{
+			size_t slot = hashVertex(vertices[v]) & (tableSize - 1);
+
+			for (;;)
+			{
+				const UINT existing = table[slot];
+
+				if (existing == UINT_MAX)
+				{
+					// never past v, so it only ever moves a vertex down over one already read
+					vertices[welded] = vertices[v];
+					table[slot] = welded;
+					remap[v] = welded++;
+					break;
+				}
+
+				if (sameVertex(vertices[existing], vertices[v]))
+				{
+					remap[v] = existing;
+					break;
+				}
+
+				slot = (slot + 1) & (tableSize - 1);
+			}
+		}
+
+		for (UINT i = 0; i < indexCount; ++i)
+		{
+			indices[i] = remap[indices[i]];
+		}
+
+		return welded;
+	}
+
+	// where one instance's copy goes while baking, before welding
+	struct Placement
+	{
+		UINT m_instance;
+		UINT m_batch;
+		UINT64 m_vertexOffset;
+		UINT64 m_indexOffset;
+	};
+}
+
+SceneFlattener::SceneFlattener(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+	, m_maxBatchVertices(c_defaultMaxBatchVertices)
+	, m_grainSize(c_defaultGrainSize)
+{
+
+}
+
+SceneFlattener::~SceneFlattener()
+{
+
+}
+
+bool SceneFlattener::flatten(const std::vector<MeshData> & meshes, const std::vector<SceneInstance> & instances, MeshData & merged,
+	std::vector<SceneBatch> & batches, SceneFlattenStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+	const size_t grainSize = std::max<size_t>(m_grainSize, 1);
+
+	merged.m_vertices.clear();
+	merged.m_indices.clear();
+	merged.m_lods.clear();
+	batches.clear();
+
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		if (instances[i].m_mesh >= meshes.size())
+		{
+			return false;
+		}
+	}
+
+	// the centre of each mesh's box, moved to where each instance puts it
+	std::vector<DirectX::XMFLOAT3> meshCentres(meshes.size());
+
+	m_jobSystem.parallelFor(meshes.size(), 1, [&](const size_t begin, const size_t end)
+	{
+		for (size_t m = begin; m < end; ++m)
+		{
+			DirectX::XMFLOAT3 low(FLT_MAX, FLT_MAX, FLT_MAX);
+			DirectX::XMFLOAT3 high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+			for (size_t v = 0; v < meshes[m].m_vertices.size(); ++v)
+			{
+				const DirectX::XMFLOAT3 & p = meshes[m].m_vertices[v].m_position;
+				low = DirectX::XMFLOAT3(std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z));
+				high = DirectX::XMFLOAT3(std::max(high.x, p.x), std::max(high.y, p.y), std::max(high.z, p.z));
+			}
+
+			meshCentres[m] = meshes[m].m_vertices.empty() ? DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f) :
+				DirectX::XMFLOAT3((low.x + high.x) * 0.5f, (low.y + high.y) * 0.5f, (low.z + high.z) * 0.5f);
+		}
+	});
+
+	std::vector<DirectX::XMFLOAT3> centres(instances.size());
+
+	m_jobSystem.parallelFor(instances.size(), grainSize * 16, [&](const size_t begin, const size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			centres[i] = transformPoint(meshCentres[instances[i].m_mesh], instances[i].m_world);
+		}
+	});
+
+	// instances that draw nothing are dropped, the rest ordered by material then along the curve
+	DirectX::XMFLOAT3 sceneLow(FLT_MAX, FLT_MAX, FLT_MAX);
+	DirectX::XMFLOAT3 sceneHigh(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	std::vector<UINT> order;
+	order.reserve(instances.size());
+
+	for (UINT i = 0; i < instances.size(); ++i)
+	{
+		const MeshData & mesh = meshes[instances[i].m_mesh];
+
+		if (mesh.m_vertices.empty() || mesh.m_indices.size() < 3)
+		{
+			continue;
+		}
+
+		const DirectX::XMFLOAT3 & c = centres[i];
+		sceneLow = DirectX::XMFLOAT3(std::min(sceneLow.x, c.x), std::min(sceneLow.y, c.y), std::min(sceneLow.z, c.z));
+		sceneHigh = DirectX::XMFLOAT3(std::max(sceneHigh.x, c.x), std::max(sceneHigh.y, c.y), std::max(sceneHigh.z, c.z));
+		order.push_back(i);
+	}
+
+	// one scale for all three axes keeps the cells cubes, so a flat scene isn't cut into slivers
+	const float extent = std::max(sceneHigh.x - sceneLow.x, std::max(sceneHigh.y - sceneLow.y, sceneHigh.z - sceneLow.z));
+	std::vector<UINT> mortonCodes(instances.size(), 0);
+
+	for (size_t o = 0; o < order.size(); ++o)
+	{
+		const DirectX::XMFLOAT3 & c = centres[order[o]];
+		mortonCodes[order[o]] = spreadBits(quantise(c.x, sceneLow.x, extent))
+			| (spreadBits(quantise(c.y, sceneLow.y, extent)) << 1)
+			| (spreadBits(quantise(c.z, sceneLow.z, extent)) << 2);
+	}
+
+	std::sort(order.begin(), order.end(), [&](const UINT a, const UINT b)
+	{
+		if (instances[a].m_material != instances[b].m_material)
+		{
+			return instances[a].m_material < instances[b].m_material;
+		}
+
+		return mortonCodes[a] != mortonCodes[b] ? mortonCodes[a] < mortonCodes[b] : a < b;
+	});
+
+	// cut into batches, a new one for each material and whenever the next instance would take it over the max
+	std::vector<Placement> placements(order.size());
+	std::vector<UINT64> batchVertexStarts;
+	UINT64 bakedVertices = 0;
+	UINT64 bakedIndices = 0;
+	UINT64 batchVertices = 0;
+	UINT materials = 0;
+
+	for (size_t o = 0; o < order.size(); ++o)
+	{
+		const SceneInstance & instance = instances[order[o]];
+		const MeshData & mesh = meshes[instance.m_mesh];
+		const bool newMaterial = batches.empty() || batches.back().m_material != instance.m_material;
+
+		if (newMaterial || batchVertices + mesh.m_vertices.size() > m_maxBatchVertices)
+		{
+			SceneBatch batch;
+			batch.m_material = instance.m_material;
+			batch.m_vertexOffset = 0;
+			batch.m_vertexCount = 0;
+			batch.m_indexOffset = static_cast<UINT>(bakedIndices);
+			batch.m_indexCount = 0;
+			batch.m_instanceCount = 0;
+			batches.push_back(batch);
+			batchVertexStarts.push_back(bakedVertices);
+			batchVertices = 0;
+			materials += newMaterial ? 1 : 0;
+		}
+
+		placements[o].m_instance = order[o];
+		placements[o].m_batch = static_cast<UINT>(batches.size() - 1);
+		placements[o].m_vertexOffset = bakedVertices;
+		placements[o].m_indexOffset = bakedIndices;
+
+		const size_t indexCount = mesh.m_indices.size() / 3 * 3;
+		batches.back().m_indexCount += static_cast<UINT>(indexCount);
+		++batches.back().m_instanceCount;
+		batchVertices += mesh.m_vertices.size();
+		bakedVertices += mesh.m_vertices.size();
+		bakedIndices += indexCount;
+
+		if (bakedIndices > UINT_MAX)
+		{
+			batches.clear();
+			return false;
+		}
+	}
+
+	batchVertexStarts.push_back(bakedVertices);
+
+	// every batch's vertices are welded before the next starts, so only one batch at a time needs 32 bit indices
+	for (size_t b = 0; b < batches.size(); ++b)
+	{
+		if (batchVertexStarts[b + 1] - batchVertexStarts[b] > UINT_MAX)
+		{
+			batches.clear();
+			return false;
+		}
+	}
+
+	// bake each instance, indices are local to its batch until the batches are welded and laid out
+	merged.m_vertices.resize(static_cast<size_t>(bakedVertices));
+	merged.m_indices.resize(static_cast<size_t>(bakedIndices));
+	std::atomic<UINT> mirrored(0);
+
+	m_jobSystem.parallelFor(placements.size(), grainSize, [&](const size_t begin, const size_t end)
+	{
+		UINT rangeMirrored = 0;
+
+		for (size_t p = begin; p < end; ++p)
+		{
+			const SceneInstance & instance = instances[placements[p].m_instance];
+			const MeshData & mesh = meshes[instance.m_mesh];
+			Vertex * vertices = merged.m_vertices.data() + placements[p].m_vertexOffset;
+			UINT * indices = merged.m_indices.data() + placements[p].m_indexOffset;
+			const UINT firstIndex = static_cast<UINT>(placements[p].m_vertexOffset - batchVertexStarts[placements[p].m_batch]);
+
+			for (size_t v = 0; v < mesh.m_vertices.size(); ++v)
+			{
+				vertices[v].m_position = transformPoint(mesh.m_vertices[v].m_position, instance.m_world);
+				vertices[v].m_colour = mesh.m_vertices[v].m_colour;
+			}
+
+			// a mirroring transform turns the triangles over, swapping two corners turns them back
+			const bool mirror = determinant3x3(instance.m_world) < 0.0f;
+			const size_t indexCount = mesh.m_indices.size() / 3 * 3;
+
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				indices[i] = firstIndex + mesh.m_indices[i];
+				indices[i + 1] = firstIndex + mesh.m_indices[mirror ? i + 2 : i + 1];
+				indices[i + 2] = firstIndex + mesh.m_indices[mirror ? i + 1 : i + 2];
+			}
+
+			rangeMirrored += mirror ? 1 : 0;
+		}
+
+		mirrored += rangeMirrored;
+	});
+
+	m_jobSystem.parallelFor(batches.size(), 1, [&](const size_t begin, const size_t end)
+	{
+		for (size_t b = begin; b < end; ++b)
+		{
+			const UINT64 first = batchVertexStarts[b];
+			batches[b].m_vertexCount = weldVertices(merged.m_vertices.data() + first, static_cast<UINT>(batchVertexStarts[b + 1] - first),
+				merged.m_indices.data() + batches[b].m_indexOffset, batches[b].m_indexCount);
+		}
+	});
+
+	// close up the gaps welding left. each batch only moves down, so in batch order nothing is overwritten before it is read
+	UINT64 vertexCount = 0;
+
+	for (size_t b = 0; b < batches.size(); ++b)
+	{
+		const Vertex * source = merged.m_vertices.data() + batchVertexStarts[b];
+
+		if (vertexCount + batches[b].m_vertexCount > UINT_MAX)
+		{
+			batches.clear();
+			merged.m_vertices.clear();
+			merged.m_indices.clear();
+			return false;
+		}
+
+		batches[b].m_vertexOffset = static_cast<UINT>(vertexCount);
+
+		if (merged.m_vertices.data() + vertexCount != source)
+		{
+			memmove(merged.m_vertices.data() + vertexCount, source, sizeof(Vertex) * batches[b].m_vertexCount);
+		}
+
+		vertexCount += batches[b].m_vertexCount;
+	}
+
+	merged.m_vertices.resize(static_cast<size_t>(vertexCount));
+
+	m_jobSystem.parallelFor(batches.size(), 1, [&](const size_t begin, const size_t end)
+	{
+		for (size_t b = begin; b < end; ++b)
+		{
+			SceneBatch & batch = batches[b];
+			UINT * indices = merged.m_indices.data() + batch.m_indexOffset;
+
+			for (UINT i = 0; i < batch.m_indexCount; ++i)
+			{
+				indices[i] += batch.m_vertexOffset;
+			}
+
+			DirectX::XMFLOAT3 low(FLT_MAX, FLT_MAX, FLT_MAX);
+			DirectX::XMFLOAT3 high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+			for (UINT v = batch.m_vertexOffset; v < batch.m_vertexOffset + batch.m_vertexCount; ++v)
+			{
+				const DirectX::XMFLOAT3 & p = merged.m_vertices[v].m_position;
+				low = DirectX::XMFLOAT3(std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z));
+				high = DirectX::XMFLOAT3(std::max(high.x, p.x), std::max(high.y, p.y), std::max(high.z, p.z));
+			}
+
+			batch.m_boundsMin = low;
+			batch.m_boundsMax = high;
+		}
+	});
+
+	stats.m_instances = static_cast<UINT>(instances.size());
+	stats.m_batches = static_cast<UINT>(batches.size());
+	stats.m_materials = materials;
+	stats.m_mirroredInstances = mirrored;
+	stats.m_bakedVertices = bakedVertices;
+	stats.m_vertices = static_cast<UINT>(merged.m_vertices.size());
+	stats.m_indices = static_cast<UINT>(merged.m_indices.size());
+	stats.m_seconds = duration<double>(steady_clock::now() - start).count();
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+
+	return true;
+}
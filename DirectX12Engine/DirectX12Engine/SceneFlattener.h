@@ -0,0 +1,83 @@
+#pragma once
+#ifndef _SCENE_FLATTENER_H_
+#define _SCENE_FLATTENER_H_
+
+#include <DirectXMath.h>
+
+#include <vector>
+
+#include <Windows.h>
+
+#include "Geomatry.h"
+#include "JobSystem.h"
+
+// one node's use of a mesh, what walking the scene hierarchy leaves
+struct SceneInstance
+{
+	UINT m_mesh;					// into the meshes given to flatten
+	UINT m_material;
+	DirectX::XMFLOAT4X4 m_world;	// row vector, mesh space into scene space. static, it is baked in
+};
+
+// a merged draw, one material over a contiguous run of the flattened vertices and indices.
+// the indices point into the whole vertex list so the batches can also be drawn as one mesh
+struct SceneBatch
+{
+	UINT m_material;
+	UINT m_vertexOffset;
+	UINT m_vertexCount;
+	UINT m_indexOffset;
+	UINT m_indexCount;
+	UINT m_instanceCount;	// instances merged into it
+	DirectX::XMFLOAT3 m_boundsMin;
+	DirectX::XMFLOAT3 m_boundsMax;
+};
+
+struct SceneFlattenStats
+{
+	UINT m_instances;			// draws before
+	UINT m_batches;				// draws after
+	UINT m_materials;
+	UINT m_mirroredInstances;	// negative scale, their winding was flipped to keep the front faces
+	UINT64 m_bakedVertices;		// every instance's vertices
+	UINT m_vertices;			// left once the same vertex from neighbouring instances was welded
+	UINT m_indices;
+	double m_seconds;
+	UINT m_threadCount;
+
+	double instancesPerSecond() const
+	{
+		return m_seconds > 0.0 ? static_cast<double>(m_instances) / m_seconds : 0.0;
+	}
+};
+
+// turns a scene's hierarchy of small static meshes into a few big ones. every instance's transform is baked
+// into a copy of its mesh, then instances with the same material are merged into batches. within a material
+// they are ordered along a Morton curve through their centres and cut into batches of at most the max size,
+// so each batch covers one area of the scene and can still be culled on its own. vertices a batch ends up
+// with twice (a tile's edge shared with its neighbour) are welded.
+// baking and welding run on the job system, the ordering and packing are serial but only touch instances
+class SceneFlattener
+{
+public:
+	SceneFlattener(JobSystem & jobSystem);
+	~SceneFlattener();
+
+	// most vertices before welding that a batch takes. an instance bigger than that is a batch on its own
+	void setMaxBatchVertices(const UINT maxVertices) { m_maxBatchVertices = maxVertices; }
+	// instances per job
+	void setGrainSize(const size_t grainSize) { m_grainSize = grainSize; }
+
+	// false when an instance names a mesh that isn't there or the result would need more than 32 bit indices.
+	// merged gets the batches one after another in batch order, with no lods
+	bool flatten(const std::vector<MeshData> & meshes, const std::vector<SceneInstance> & instances, MeshData & merged,
+		std::vector<SceneBatch> & batches, SceneFlattenStats & stats);
+
+private:
+
+	JobSystem & m_jobSystem;
+	UINT m_maxBatchVertices;
+	size_t m_grainSize;
+};
+
+#endif // _SCENE_FLATTENER_H_
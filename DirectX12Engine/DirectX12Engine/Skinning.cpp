@@ -0,0 +1,234 @@
+#include "Skinning.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SKIN_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// vertices per job, enough that the job system overhead is lost in the noise
+	const size_t c_skinningBatchSize = 1024;
+
+	const float c_weightScale = 1.0f / 255.0f;
+}
+
+void quantiseBoneWeights(const float * weights, UINT8 * quantised)
+{
+	float total = 0.0f;
+
+	for (UINT i = 0; i < c_maxBoneInfluences; ++i)
+	{
+		total += std::max(weights[i], 0.0f);
+	}
+
+	if (total <= 0.0f)
+	{
+		quantised[0] = 255;
+
+		for (UINT i = 1; i < c_maxBoneInfluences; ++i)
+		{
+			quantised[i] = 0;
+		}
+
+		return;
+	}
+
+	float remainders[c_maxBoneInfluences];
+	UINT sum = 0;
+
+	for (UINT i = 0; i < c_maxBoneInfluences; ++i)
+	{
+		const float scaled = std::max(weights[i], 0.0f) / total * 255.0f;
+		const float whole = std::floor(scaled);
+
+		quantised[i] = static_cast<UINT8>(whole);
+		remainders[i] = scaled - whole;
+		sum += quantised[i];
+	}
+
+	// at most three short, the earlier (heavier) one wins a tie so the weights stay in order
+	while (sum < 255)
+	{
+		UINT largest = 0;
+
+		for (UINT i = 1; i < c_maxBoneInfluences; ++i)
+		{
+			if (remainders[i] > remainders[largest])
+			{
+				largest = i;
+			}
+		}
+
+		++quantised[largest];
+		remainders[largest] = -1.0f;
+		++sum;
+	}
+}
+
+SkinBuilder::SkinBuilder(const size_t vertexCount)
+	: m_influences(vertexCount)
+{
+
+}
+
+SkinBuilder::~SkinBuilder()
+{
+
+}
+
+void SkinBuilder::addInfluence(const UINT vertex, const UINT bone, const float weight)
+{
+	assert(vertex < m_influences.size());
+	assert(bone < c_maxSkinBones);
+
+	if (weight <= 0.0f)
+	{
+		return;
+	}
+
+	Influence influence;
+	influence.m_bone = bone;
+	influence.m_weight = weight;
+	m_influences[vertex].push_back(influence);
+}
+
+UINT SkinBuilder::build(std::vector<SkinnedVertex> & vertices) const
+{
+	assert(vertices.size() == m_influences.size());
+
+	UINT truncated = 0;
+
+	for (size_t v = 0; v < vertices.size(); ++v)
+	{
+		std::vector<Influence> influences = m_influences[v];
+
+		std::sort(influences.begin(), influences.end(), [](const Influence & a, const Influence & b)
+		{
+			if (a.m_weight != b.m_weight)
+			{
+				return a.m_weight > b.m_weight;
+			}
+
+			return a.m_bone < b.m_bone;
+		});
+
+		if (influences.size() > c_maxBoneInfluences)
+		{
+			influences.resize(c_maxBoneInfluences);
+			++truncated;
+		}
+
+		float weights[c_maxBoneInfluences] = {};
+		SkinnedVertex & vertex = vertices[v];
+
+		for (UINT i = 0; i < c_maxBoneInfluences; ++i)
+		{
+			vertex.m_boneIndices[i] = 0;
+		}
+
+		for (size_t i = 0; i < influences.size(); ++i)
+		{
+			vertex.m_boneIndices[i] = static_cast<UINT8>(influences[i].m_bone);
+			weights[i] = influences[i].m_weight;
+		}
+
+		// renormalised here, what was dropped is shared out over the ones kept
+		quantiseBoneWeights(weights, vertex.m_boneWeights);
+	}
+
+	return truncated;
+}
+
+CpuSkinner::CpuSkinner(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+{
+
+}
+
+CpuSkinner::~CpuSkinner()
+{
+
+}
+
+void CpuSkinner::skin(const SkinnedVertex * source, const size_t count, const DirectX::XMFLOAT4X4 * palette, Vertex * out, SkinningStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	m_jobSystem.parallelFor(count, c_skinningBatchSize, [source, palette, out](const size_t begin, const size_t end)
+	{
+		skinRange(source, begin, end, palette, out);
+	});
+
+	stats.m_vertices = count;
+	stats.m_seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+}
+
+void CpuSkinner::skinRange(const SkinnedVertex * source, const size_t begin, const size_t end, const DirectX::XMFLOAT4X4 * palette, Vertex * out)
+{
+	for (size_t v = begin; v < end; ++v)
+	{
+		const SkinnedVertex & vertex = source[v];
+
+#ifdef SKIN_USE_SSE2
+		const __m128 x = _mm_set1_ps(vertex.m_position.x);
+		const __m128 y = _mm_set1_ps(vertex.m_position.y);
+		const __m128 z = _mm_set1_ps(vertex.m_position.z);
+
+		__m128 skinned = _mm_setzero_ps();
+
+		for (UINT i = 0; i < c_maxBoneInfluences; ++i)
+		{
+			// heaviest first, so the first empty slot ends the list
+			if (vertex.m_boneWeights[i] == 0)
+			{
+				break;
+			}
+
+			// row vectors, so the position is x * row0 + y * row1 + z * row2 + row3
+			const float * bone = &palette[vertex.m_boneIndices[i]].m[0][0];
+
+			const __m128 xy = _mm_add_ps(_mm_mul_ps(x, _mm_loadu_ps(bone)), _mm_mul_ps(y, _mm_loadu_ps(bone + 4)));
+			const __m128 zw = _mm_add_ps(_mm_mul_ps(z, _mm_loadu_ps(bone + 8)), _mm_loadu_ps(bone + 12));
+			const __m128 weight = _mm_set1_ps(vertex.m_boneWeights[i] * c_weightScale);
+
+			skinned = _mm_add_ps(skinned, _mm_mul_ps(_mm_add_ps(xy, zw), weight));
+		}
+
+		alignas(16) float position[4];
+		_mm_store_ps(position, skinned);
+#else
+		float position[4] = {};
+
+		for (UINT i = 0; i < c_maxBoneInfluences; ++i)
+		{
+			if (vertex.m_boneWeights[i] == 0)
+			{
+				break;
+			}
+
+			const DirectX::XMFLOAT4X4 & bone = palette[vertex.m_boneIndices[i]];
+			const float weight = vertex.m_boneWeights[i] * c_weightScale;
+
+			for (UINT c = 0; c < 3; ++c)
+			{
+				position[c] += weight * (vertex.m_position.x * bone.m[0][c] + vertex.m_position.y * bone.m[1][c] +
+					vertex.m_position.z * bone.m[2][c] + bone.m[3][c]);
+			}
+		}
+#endif
+
+		out[v].m_position.x = position[0];
+		out[v].m_position.y = position[1];
+		out[v].m_position.z = position[2];
+		out[v].m_colour = vertex.m_colour;
+	}
+}
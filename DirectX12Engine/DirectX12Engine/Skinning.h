@@ -0,0 +1,73 @@
+#pragma once
+#ifndef _SKINNING_H_
+#define _SKINNING_H_
+
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "Geomatry.h"
+#include "JobSystem.h"
+
+// four weights, heaviest first and adding up to about 1, into bytes that add up to exactly 255.
+// rounding error goes to the largest remainders so the skinned vertex doesn't drift from the bind pose
+void quantiseBoneWeights(const float * weights, UINT8 * quantised);
+
+// gathers every bone's influences (aiBone style, a list of vertex and weight per bone) then keeps the four
+// heaviest per vertex, renormalised and quantised
+class SkinBuilder
+{
+public:
+	SkinBuilder(const size_t vertexCount);
+	~SkinBuilder();
+
+	void addInfluence(const UINT vertex, const UINT bone, const float weight);
+
+	// fills in m_boneIndices and m_boneWeights, vertices with no influences follow bone 0.
+	// returns how many vertices had more than four influences and lost some
+	UINT build(std::vector<SkinnedVertex> & vertices) const;
+
+private:
+
+	struct Influence
+	{
+		UINT m_bone;
+		float m_weight;
+	};
+
+	std::vector<std::vector<Influence>> m_influences;
+};
+
+struct SkinningStats
+{
+	UINT64 m_vertices;
+	double m_seconds;
+	UINT m_threadCount;
+
+	double verticesPerSecondPerCore() const
+	{
+		return m_seconds > 0.0 && m_threadCount > 0 ? static_cast<double>(m_vertices) / m_seconds / m_threadCount : 0.0;
+	}
+};
+
+// linear blend skinning on the CPU. the palette is one row major (DirectXMath) matrix per bone taking the
+// bind pose to the current pose, inverse bind pose already applied
+class CpuSkinner
+{
+public:
+	CpuSkinner(JobSystem & jobSystem);
+	~CpuSkinner();
+
+	// split across the job system in batches of a thousand or so vertices. out can be mapped upload memory,
+	// every vertex is written once in order and never read back
+	void skin(const SkinnedVertex * source, const size_t count, const DirectX::XMFLOAT4X4 * palette, Vertex * out, SkinningStats & stats);
+
+	// the kernel each job runs, SSE2 where it is available
+	static void skinRange(const SkinnedVertex * source, const size_t begin, const size_t end, const DirectX::XMFLOAT4X4 * palette, Vertex * out);
+
+private:
+
+	JobSystem & m_jobSystem;
+};
+
+#endif // _SKINNING_H_
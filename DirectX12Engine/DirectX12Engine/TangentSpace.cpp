@@ -0,0 +1,421 @@
+#include "TangentSpace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const size_t c_defaultGrainSize = 16384;
+
+	DirectX::XMFLOAT3 subtract(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b)
+	{
+		return DirectX::XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	DirectX::XMFLOAT3 cross(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b)
+	{
+		return DirectX::XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float dot(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	// a + b * scale
+	DirectX::XMFLOAT3 addScaled(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b, const float scale)
+	{
+		return DirectX::XMFLOAT3(a.x + b.x * scale, a.y + b.y * scale, a.z + b.z * scale);
+	}
+
+	// left as it is when it has no length
+	DirectX::XMFLOAT3 normalise(const DirectX::XMFLOAT3 & v)
+	{
+		const float length = std::sqrt(dot(v, v));
+
+		return length > 0.0f ? DirectX::XMFLOAT3(v.x / length, v.y / length, v.z / length) : v;
+	}
+
+	bool isZero(const DirectX::XMFLOAT3 & v)
+	{
+		return v.x == 0.0f && v.y == 0.0f && v.z == 0.0f;
+	}
+
+	// v with the part along the (unit) normal taken out
+	DirectX::XMFLOAT3 projectOntoPlane(const DirectX::XMFLOAT3 & v, const DirectX::XMFLOAT3 & normal)
+	{
+		return normalise(addScaled(v, normal, -dot(normal, v)));
+	}
+
+	float angleBetween(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b)
+	{
+		return std::acos(std::max(-1.0f, std::min(dot(a, b), 1.0f)));
+	}
+
+	// any unit vector at right angles to the normal, for vertices no triangle gives a direction to
+	DirectX::XMFLOAT3 perpendicular(const DirectX::XMFLOAT3 & normal)
+	{
+		const DirectX::XMFLOAT3 axis = std::fabs(normal.x) < 0.9f ? DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f) : DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+		const DirectX::XMFLOAT3 tangent = normalise(cross(normal, axis));
+
+		return isZero(tangent) ? DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f) : tangent;
+	}
+
+	UINT hashPosition(const DirectX::XMFLOAT3 & position)
+	{
+		// + 0.0f so -0 and 0 hash the same, they compare equal
+		const float components[3] = { position.x + 0.0f, position.y + 0.0f, position.z + 0.0f };
+		UINT bits[3];
+		memcpy(bits, components, sizeof(bits));
+
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+
+	// the same id for every vertex at the same position, ids in order of first use. returns how many there are
+	UINT groupByPosition(const std::vector<Vertex> & vertices, std::vector<UINT> & groups)
+	{
+		size_t tableSize = 16;
+
+		while (tableSize < vertices.size() * 2)
+		{
+			tableSize *= 2;
+		}
+
+		// open addressing, each slot the first vertex seen at a position
+		std::vector<UINT> table(tableSize, UINT_MAX);
+		groups.resize(vertices.size());
+		UINT groupCount = 0;
+
+		for (UINT v = 0; v < vertices.size(); ++v)
+		{
+			const DirectX::XMFLOAT3 & position = vertices[v].m_position;
+			size_t slot = hashPosition(position) & (tableSize - 1);
+
+			for (;;)
+			{
+				const UINT first = table[slot];
+
+				if (first == UINT_MAX)
+				{
+					table[slot] = v;
+					groups[v] = groupCount++;
+					break;
+				}
+
+				const DirectX::XMFLOAT3 & other = vertices[first].m_position;
+
+				if (other.x == position.x && other.y == position.y && other.z == position.z)
+				{
+					groups[v] = groups[first];
+					break;
+				}
+
+				slot = (slot + 1) & (tableSize - 1);
+			}
+		}
+
+		return groupCount;
+	}
+
+	// a counting sort of the corners (3 * triangle + corner) by the group of the vertex they use, groups is
+	// nullptr when every vertex is its own. the corners of group g are corners[offsets[g]] to corners[offsets[g + 1]]
+	void buildCornerLists(const std::vector<UINT> & indices, const UINT * groups, const UINT groupCount, std::vector<UINT> & offsets, std::vector<UINT> & corners)
+	{
+		offsets.assign(groupCount + 1, 0);
+
+		for (size_t c = 0; c < indices.size(); ++c)
+		{
+			++offsets[(groups != nullptr ? groups[indices[c]] : indices[c]) + 1];
+		}
+
+		for (UINT g = 0; g < groupCount; ++g)
+		{
+			offsets[g + 1] += offsets[g];
+		}
+
+		std::vector<UINT> cursor(offsets.begin(), offsets.end() - 1);
+		corners.resize(indices.size());
+
+		for (size_t c = 0; c < indices.size(); ++c)
+		{
+			corners[cursor[groups != nullptr ? groups[indices[c]] : indices[c]]++] = static_cast<UINT>(c);
+		}
+	}
+}
+
+TangentSpaceGenerator::TangentSpaceGenerator(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+	, m_grainSize(c_defaultGrainSize)
+{
+
+}
+
+TangentSpaceGenerator::~TangentSpaceGenerator()
+{
+
+}
+
+void TangentSpaceGenerator::generateNormals(const std::vector<Vertex> & vertices, const std::vector<UINT> & indices, const bool weldPositions,
+	std::vector<DirectX::XMFLOAT3> & normals, TangentSpaceStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+	const size_t triangleCount = indices.size() / 3;
+	const size_t grainSize = std::max<size_t>(m_grainSize, 1);
+
+	// the unit normal of each triangle and its angle at each corner
+	std::vector<DirectX::XMFLOAT3> faceNormals(triangleCount);
+	std::vector<float> cornerAngles(triangleCount * 3);
+	std::atomic<UINT> degenerate(0);
+
+	m_jobSystem.parallelFor(triangleCount, grainSize, [&](const size_t begin, const size_t end)
+	{
+		UINT rangeDegenerate = 0;
+
+		for (size_t f = begin; f < end; ++f)
+		{
+			assert(indices[f * 3] < vertices.size() && indices[f * 3 + 1] < vertices.size() && indices[f * 3 + 2] < vertices.size());
+
+			const DirectX::XMFLOAT3 & p0 = vertices[indices[f * 3]].m_position;
+			const DirectX::XMFLOAT3 & p1 = vertices[indices[f * 3 + 1]].m_position;
+			const DirectX::XMFLOAT3 & p2 = vertices[indices[f * 3 + 2]].m_position;
+
+			// the engine's front faces are clockwise and left handed, so this points out of them
+			faceNormals[f] = normalise(cross(subtract(p1, p0), subtract(p2, p0)));
+
+			if (isZero(faceNormals[f]))
+			{
+				cornerAngles[f * 3] = cornerAngles[f * 3 + 1] = cornerAngles[f * 3 + 2] = 0.0f;
+				++rangeDegenerate;
+				continue;
+			}
+
+			const DirectX::XMFLOAT3 e01 = normalise(subtract(p1, p0));
+			const DirectX::XMFLOAT3 e02 = normalise(subtract(p2, p0));
+			const DirectX::XMFLOAT3 e12 = normalise(subtract(p2, p1));
+
+			cornerAngles[f * 3] = angleBetween(e01, e02);
+			cornerAngles[f * 3 + 1] = angleBetween(DirectX::XMFLOAT3(-e01.x, -e01.y, -e01.z), e12);
+			cornerAngles[f * 3 + 2] = std::max(0.0f, DirectX::XM_PI - cornerAngles[f * 3] - cornerAngles[f * 3 + 1]);
+		}
+
+		degenerate += rangeDegenerate;
+	});
+
+	std::vector<UINT> groups;
+	const UINT groupCount = weldPositions ? groupByPosition(vertices, groups) : static_cast<UINT>(vertices.size());
+
+	std::vector<UINT> offsets;
+	std::vector<UINT> corners;
+	buildCornerLists(indices, weldPositions ? groups.data() : nullptr, groupCount, offsets, corners);
+
+	// welded, a normal per position that every vertex there copies
+	std::vector<DirectX::XMFLOAT3> groupNormals;
+	normals.resize(vertices.size());
+	DirectX::XMFLOAT3 * out = normals.data();
+
+	if (weldPositions)
+	{
+		groupNormals.resize(groupCount);
+		out = groupNormals.data();
+	}
+
+	m_jobSystem.parallelFor(groupCount, grainSize, [&](const size_t begin, const size_t end)
+	{
+		for (size_t g = begin; g < end; ++g)
+		{
+			DirectX::XMFLOAT3 sum(0.0f, 0.0f, 0.0f);
+
+			for (UINT i = offsets[g]; i < offsets[g + 1]; ++i)
+			{
+				sum = addScaled(sum, faceNormals[corners[i] / 3], cornerAngles[corners[i]]);
+			}
+
+			out[g] = normalise(sum);
+		}
+	});
+
+	if (weldPositions)
+	{
+		m_jobSystem.parallelFor(vertices.size(), grainSize, [&](const size_t begin, const size_t end)
+		{
+			for (size_t v = begin; v < end; ++v)
+			{
+				normals[v] = groupNormals[groups[v]];
+			}
+		});
+	}
+
+	stats = TangentSpaceStats();
+	stats.m_triangles = static_cast<UINT>(triangleCount);
+	stats.m_vertices = static_cast<UINT>(vertices.size());
+	stats.m_degenerateTriangles = degenerate;
+	stats.m_seconds = duration<double>(steady_clock::now() - start).count();
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+}
+
+void TangentSpaceGenerator::generateTangents(std::vector<Vertex> & vertices, std::vector<DirectX::XMFLOAT3> & normals, std::vector<DirectX::XMFLOAT2> & texCoords,
+	std::vector<UINT> & indices, std::vector<DirectX::XMFLOAT4> & tangents, TangentSpaceStats & stats)
+{
+	using namespace std::chrono;
+
+	assert(normals.size() == vertices.size() && texCoords.size() == vertices.size());
+
+	const steady_clock::time_point start = steady_clock::now();
+	const size_t triangleCount = indices.size() / 3;
+	const size_t vertexCount = vertices.size();
+	const size_t grainSize = std::max<size_t>(m_grainSize, 1);
+
+	// the direction u increases in across each triangle, and whether the mapping keeps the winding (1) or
+	// mirrors it (-1). 0 for no area in texture space, those triangles take their tangents from the others
+	std::vector<DirectX::XMFLOAT3> faceTangents(triangleCount);
+	std::vector<INT8> faceSigns(triangleCount);
+	std::atomic<UINT> degenerate(0);
+
+	m_jobSystem.parallelFor(triangleCount, grainSize, [&](const size_t begin, const size_t end)
+	{
+		UINT rangeDegenerate = 0;
+
+		for (size_t f = begin; f < end; ++f)
+		{
+			const UINT i0 = indices[f * 3];
+			const UINT i1 = indices[f * 3 + 1];
+			const UINT i2 = indices[f * 3 + 2];
+
+			const DirectX::XMFLOAT3 d1 = subtract(vertices[i1].m_position, vertices[i0].m_position);
+			const DirectX::XMFLOAT3 d2 = subtract(vertices[i2].m_position, vertices[i0].m_position);
+			const float t21x = texCoords[i1].x - texCoords[i0].x;
+			const float t21y = texCoords[i1].y - texCoords[i0].y;
+			const float t31x = texCoords[i2].x - texCoords[i0].x;
+			const float t31y = texCoords[i2].y - texCoords[i0].y;
+
+			// MikkTSpace's InitTriInfo: the tangent scaled by twice the signed area in texture space
+			const float signedArea = t21x * t31y - t21y * t31x;
+			const DirectX::XMFLOAT3 tangent = addScaled(DirectX::XMFLOAT3(d1.x * t31y, d1.y * t31y, d1.z * t31y), d2, -t21y);
+
+			if (std::fabs(signedArea) <= FLT_MIN || isZero(tangent))
+			{
+				faceSigns[f] = 0;
+				++rangeDegenerate;
+				continue;
+			}
+
+			faceSigns[f] = signedArea > 0.0f ? 1 : -1;
+			faceTangents[f] = normalise(DirectX::XMFLOAT3(tangent.x * faceSigns[f], tangent.y * faceSigns[f], tangent.z * faceSigns[f]));
+		}
+
+		degenerate += rangeDegenerate;
+	});
+
+	std::vector<UINT> offsets;
+	std::vector<UINT> corners;
+	buildCornerLists(indices, nullptr, static_cast<UINT>(vertexCount), offsets, corners);
+
+	// w is 0 unless the vertex is also used by triangles mapped the other way round
+	std::vector<DirectX::XMFLOAT4> mirrored(vertexCount, DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+	tangents.resize(vertexCount);
+
+	m_jobSystem.parallelFor(vertexCount, grainSize, [&](const size_t begin, const size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			const DirectX::XMFLOAT3 & normal = normals[v];
+			const DirectX::XMFLOAT3 & position = vertices[v].m_position;
+
+			// [0] for the triangles that keep the winding, [1] for the mirrored ones
+			DirectX::XMFLOAT3 sums[2] = { DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f) };
+			bool used[2] = { false, false };
+			INT8 firstSign = 0;
+
+			for (UINT i = offsets[v]; i < offsets[v + 1]; ++i)
+			{
+				const UINT corner = corners[i];
+				const UINT f = corner / 3;
+				const UINT k = corner % 3;
+
+				if (faceSigns[f] == 0)
+				{
+					continue;
+				}
+
+				// MikkTSpace's EvalTspace: the face tangent in the vertex's tangent plane, weighted by the angle
+				// the triangle makes there once its edges are flattened onto the same plane
+				const DirectX::XMFLOAT3 tangent = projectOntoPlane(faceTangents[f], normal);
+				const DirectX::XMFLOAT3 & previous = vertices[indices[f * 3 + (k > 0 ? k - 1 : 2)]].m_position;
+				const DirectX::XMFLOAT3 & next = vertices[indices[f * 3 + (k < 2 ? k + 1 : 0)]].m_position;
+				const float angle = angleBetween(projectOntoPlane(subtract(previous, position), normal), projectOntoPlane(subtract(next, position), normal));
+
+				const UINT side = faceSigns[f] > 0 ? 0 : 1;
+				sums[side] = addScaled(sums[side], tangent, angle);
+				used[side] = true;
+				firstSign = firstSign == 0 ? faceSigns[f] : firstSign;
+			}
+
+			if (firstSign == 0)
+			{
+				const DirectX::XMFLOAT3 any = perpendicular(normal);
+				tangents[v] = DirectX::XMFLOAT4(any.x, any.y, any.z, 1.0f);
+				continue;
+			}
+
+			// the vertex keeps whichever way its first triangle is mapped, the other way gets the copy
+			const UINT kept = firstSign > 0 ? 0 : 1;
+			const UINT other = 1 - kept;
+
+			DirectX::XMFLOAT3 tangent = normalise(sums[kept]);
+			tangent = isZero(tangent) ? perpendicular(normal) : tangent;
+			tangents[v] = DirectX::XMFLOAT4(tangent.x, tangent.y, tangent.z, kept == 0 ? 1.0f : -1.0f);
+
+			if (used[other])
+			{
+				tangent = normalise(sums[other]);
+				tangent = isZero(tangent) ? perpendicular(normal) : tangent;
+				mirrored[v] = DirectX::XMFLOAT4(tangent.x, tangent.y, tangent.z, other == 0 ? 1.0f : -1.0f);
+			}
+		}
+	});
+
+	// few enough to do in order, it appends to every array
+	UINT split = 0;
+
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		if (mirrored[v].w == 0.0f)
+		{
+			continue;
+		}
+
+		const UINT copy = static_cast<UINT>(vertices.size());
+		const INT8 sign = mirrored[v].w > 0.0f ? 1 : -1;
+
+		vertices.push_back(vertices[v]);
+		normals.push_back(normals[v]);
+		texCoords.push_back(texCoords[v]);
+		tangents.push_back(mirrored[v]);
+
+		for (UINT i = offsets[v]; i < offsets[v + 1]; ++i)
+		{
+			if (faceSigns[corners[i] / 3] == sign)
+			{
+				indices[corners[i]] = copy;
+			}
+		}
+
+		++split;
+	}
+
+	stats = TangentSpaceStats();
+	stats.m_triangles = static_cast<UINT>(triangleCount);
+	stats.m_vertices = static_cast<UINT>(vertices.size());
+	stats.m_degenerateTriangles = degenerate;
+	stats.m_splitVertices = split;
+	stats.m_seconds = duration<double>(steady_clock::now() - start).count();
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef _TANGENT_SPACE_H_
+#define _TANGENT_SPACE_H_
+
+#include <DirectXMath.h>
+
+#include <vector>
+
+#include <Windows.h>
+
+#include "Geomatry.h"
+#include "JobSystem.h"
+
+struct TangentSpaceStats
+{
+	UINT m_triangles;
+	UINT m_vertices;
+	UINT m_degenerateTriangles;	// no area, or for tangents no area in texture space
+	UINT m_splitVertices;		// copies made where mirrored texture coordinates meet
+	double m_seconds;
+	UINT m_threadCount;
+
+	double trianglesPerSecond() const
+	{
+		return m_seconds > 0.0 ? static_cast<double>(m_triangles) / m_seconds : 0.0;
+	}
+};
+
+// per vertex normals and tangents for meshes that come in without them, in place of aiProcess_GenNormals and
+// aiProcess_CalcTangentSpace. they go alongside the Vertex array the way MorphedMeshData and ObjMesh keep their
+// normals, Vertex itself has no room for them yet.
+// both work in three passes split across the job system: per triangle, then per vertex gathering the corners
+// that use it (so there are no atomics and the sums come out in the same order whatever the thread count), with
+// one serial counting sort in between to list each vertex's corners
+class TangentSpaceGenerator
+{
+public:
+	TangentSpaceGenerator(JobSystem & jobSystem);
+	~TangentSpaceGenerator();
+
+	// smooth normals, each triangle weighted by its angle at the vertex so how a surface is cut into triangles
+	// doesn't bend them. with weldPositions vertices at the same position are smoothed together even when
+	// something else (colour, texture coordinate) split them. zero for a vertex no triangle with area uses
+	void generateNormals(const std::vector<Vertex> & vertices, const std::vector<UINT> & indices, const bool weldPositions,
+		std::vector<DirectX::XMFLOAT3> & normals, TangentSpaceStats & stats);
+
+	// MikkTSpace tangents for joined vertices: xyz is the tangent and w the sign of the bitangent,
+	// bitangent = w * cross(normal, tangent). like MikkTSpace with its default 180 degree threshold every triangle
+	// at a vertex is averaged in, weighted by its angle there, and triangles whose texture mapping is mirrored are
+	// kept apart. a vertex used both ways is split, the copy is appended to vertices, normals and texCoords and the
+	// mirrored triangles' indices moved onto it
+	void generateTangents(std::vector<Vertex> & vertices, std::vector<DirectX::XMFLOAT3> & normals, std::vector<DirectX::XMFLOAT2> & texCoords,
+		std::vector<UINT> & indices, std::vector<DirectX::XMFLOAT4> & tangents, TangentSpaceStats & stats);
+
+	// triangles or vertices per job
+	void setGrainSize(const size_t grainSize) { m_grainSize = grainSize; }
+
+private:
+
+	JobSystem & m_jobSystem;
+	size_t m_grainSize;
+};
+
+#endif // _TANGENT_SPACE_H_
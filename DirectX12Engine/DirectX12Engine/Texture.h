@@ -0,0 +1,26 @@
+#pragma once
+#ifndef _TEXTURE_H_
+#define _TEXTURE_H_
+
+#include <wrl.h>
+
+#include <d3d12.h>
+
+#include "CopyUploader.h"
+
+struct Texture
+{
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_resource;
+	UINT m_width;
+	UINT m_height;
+	UINT m_mipCount;
+
+	// slot in the renderer's shader visible srv heap
+	UINT m_srvIndex;
+	D3D12_GPU_DESCRIPTOR_HANDLE m_srvGpuHandle;
+
+	// last mip's upload, mips are queued in order so it covers the whole chain
+	UploadTicket m_uploadTicket;
+};
+
+#endif // _TEXTURE_H_
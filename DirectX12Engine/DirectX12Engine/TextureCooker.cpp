@@ -0,0 +1,231 @@
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "BlockCompression.h"
+#include "DdsFormat.h"
+
+TextureCooker::TextureCooker(JobSystem & jobSystem)
+	: m_jobSystem(jobSystem)
+{
+
+}
+
+TextureCooker::~TextureCooker()
+{
+
+}
+
+CookedTexture TextureCooker::cook(DecodedImage && source, const TextureCookSettings & settings, TextureCookStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point mipStart = steady_clock::now();
+
+	std::vector<DecodedImage> mips;
+
+	if (settings.m_generateMips)
+	{
+		// BC5 holds vectors, not colour, so only the srgb formats get the linear space filter
+		mips = buildMipChain(std::move(source), settings.m_srgb && settings.m_compression != TEXTURE_COMPRESSION_BC5);
+	}
+	else
+	{
+		mips.push_back(std::move(source));
+	}
+
+	const steady_clock::time_point encodeStart = steady_clock::now();
+
+	CookedTexture texture;
+	texture.m_format = formatOf(settings.m_compression, settings.m_srgb);
+	texture.m_width = mips[0].m_width;
+	texture.m_height = mips[0].m_height;
+	texture.m_mipCount = static_cast<UINT>(mips.size());
+
+	size_t totalSize = 0;
+
+	for (size_t m = 0; m < mips.size(); ++m)
+	{
+		totalSize += surfaceSize(mips[m].m_width, mips[m].m_height, settings.m_compression);
+	}
+
+	texture.m_data.resize(totalSize);
+
+	stats.m_texels = 0;
+	stats.m_blocks = 0;
+
+	size_t offset = 0;
+
+	for (size_t m = 0; m < mips.size(); ++m)
+	{
+		encodeSurface(mips[m], settings.m_compression, &texture.m_data[offset]);
+
+		const size_t size = surfaceSize(mips[m].m_width, mips[m].m_height, settings.m_compression);
+		offset += size;
+
+		stats.m_texels += static_cast<UINT64>(mips[m].m_width) * mips[m].m_height;
+		stats.m_blocks += size / blockBytes(settings.m_compression);
+	}
+
+	const steady_clock::time_point end = steady_clock::now();
+
+	stats.m_mipSeconds = duration_cast<duration<double>>(encodeStart - mipStart).count();
+	stats.m_encodeSeconds = duration_cast<duration<double>>(end - encodeStart).count();
+
+	return texture;
+}
+
+void TextureCooker::encodeSurface(const DecodedImage & surface, const TextureCompression compression, UINT8 * out)
+{
+	const UINT blocksWide = (surface.m_width + 3) / 4;
+	const UINT blocksHigh = (surface.m_height + 3) / 4;
+	const UINT bytesPerBlock = blockBytes(compression);
+
+	m_jobSystem.parallelFor(blocksHigh, 1, [&](const size_t begin, const size_t end)
+	{
+		UINT8 texels[c_bcBlockTexels * 4];
+
+		for (size_t by = begin; by < end; ++by)
+		{
+			for (UINT bx = 0; bx < blocksWide; ++bx)
+			{
+				// blocks past the edge repeat the last row and column
+				for (UINT y = 0; y < 4; ++y)
+				{
+					const UINT sy = std::min(static_cast<UINT>(by) * 4 + y, surface.m_height - 1);
+
+					for (UINT x = 0; x < 4; ++x)
+					{
+						const UINT sx = std::min(bx * 4 + x, surface.m_width - 1);
+						memcpy(&texels[(y * 4 + x) * 4], &surface.m_pixels[(static_cast<size_t>(sy) * surface.m_width + sx) * 4], 4);
+					}
+				}
+
+				UINT8 * block = out + (by * blocksWide + bx) * bytesPerBlock;
+
+				switch (compression)
+				{
+				case TEXTURE_COMPRESSION_BC1:
+					encodeBc1Block(texels, block);
+					break;
+				case TEXTURE_COMPRESSION_BC3:
+					encodeBc3Block(texels, block);
+					break;
+				case TEXTURE_COMPRESSION_BC5:
+					encodeBc5Block(texels, block);
+					break;
+				case TEXTURE_COMPRESSION_BC7:
+					encodeBc7Block(texels, block);
+					break;
+				}
+			}
+		}
+	});
+}
+
+UINT TextureCooker::blockBytes(const TextureCompression compression)
+{
+	switch (compression)
+	{
+	case TEXTURE_COMPRESSION_BC1:
+		return c_bc1BlockBytes;
+	case TEXTURE_COMPRESSION_BC3:
+		return c_bc3BlockBytes;
+	case TEXTURE_COMPRESSION_BC5:
+		return c_bc5BlockBytes;
+	case TEXTURE_COMPRESSION_BC7:
+		return c_bc7BlockBytes;
+	}
+
+	return 0;
+}
+
+DXGI_FORMAT TextureCooker::formatOf(const TextureCompression compression, const bool srgb)
+{
+	switch (compression)
+	{
+	case TEXTURE_COMPRESSION_BC1:
+		return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case TEXTURE_COMPRESSION_BC3:
+		return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	case TEXTURE_COMPRESSION_BC5:
+		return DXGI_FORMAT_BC5_UNORM; // no srgb variant
+	case TEXTURE_COMPRESSION_BC7:
+		return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+size_t TextureCooker::surfaceSize(const UINT width, const UINT height, const TextureCompression compression)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(compression);
+}
+
+std::vector<UINT8> TextureCooker::writeDds(const CookedTexture & texture)
+{
+	DdsHeader header;
+	memset(&header, 0, sizeof(header));
+
+	header.m_size = sizeof(DdsHeader);
+	header.m_flags = c_ddsFlagCaps | c_ddsFlagHeight | c_ddsFlagWidth | c_ddsFlagPixelFormat | c_ddsFlagLinearSize;
+	header.m_height = texture.m_height;
+	header.m_width = texture.m_width;
+	header.m_depth = 1;
+	header.m_mipMapCount = texture.m_mipCount;
+	header.m_pixelFormat.m_size = sizeof(DdsPixelFormat);
+	header.m_pixelFormat.m_flags = c_ddsPixelFormatFourCc;
+	header.m_pixelFormat.m_fourCc = c_ddsFourCcDx10;
+	header.m_caps = c_ddsCapsTexture;
+
+	// size of the top level
+	const UINT bytesPerBlock = (texture.m_format == DXGI_FORMAT_BC1_UNORM || texture.m_format == DXGI_FORMAT_BC1_UNORM_SRGB) ? 8 : 16;
+	header.m_pitchOrLinearSize = ((texture.m_width + 3) / 4) * ((texture.m_height + 3) / 4) * bytesPerBlock;
+
+	if (texture.m_mipCount > 1)
+	{
+		header.m_flags |= c_ddsFlagMipMapCount;
+		header.m_caps |= c_ddsCapsComplex | c_ddsCapsMipMap;
+	}
+
+	DdsHeaderDx10 dx10;
+	memset(&dx10, 0, sizeof(dx10));
+	dx10.m_dxgiFormat = texture.m_format;
+	dx10.m_resourceDimension = c_ddsDimensionTexture2D;
+	dx10.m_arraySize = 1;
+
+	std::vector<UINT8> file(sizeof(c_ddsMagic) + sizeof(header) + sizeof(dx10) + texture.m_data.size());
+	UINT8 * out = file.data();
+
+	memcpy(out, &c_ddsMagic, sizeof(c_ddsMagic));
+	out += sizeof(c_ddsMagic);
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	memcpy(out, &dx10, sizeof(dx10));
+	out += sizeof(dx10);
+
+	if (!texture.m_data.empty())
+	{
+		memcpy(out, texture.m_data.data(), texture.m_data.size());
+	}
+
+	return file;
+}
+
+bool TextureCooker::saveDds(const CookedTexture & texture, const std::string & path)
+{
+	const std::vector<UINT8> file = writeDds(texture);
+
+	std::ofstream stream(path, std::ios::binary);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+	return static_cast<bool>(stream);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef _TEXTURE_COOKER_H_
+#define _TEXTURE_COOKER_H_
+
+#include <string>
+#include <vector>
+
+#include <dxgiformat.h>
+
+#include "ImageDecoder.h"
+#include "JobSystem.h"
+
+enum TextureCompression
+{
+	TEXTURE_COMPRESSION_BC1 = 0,	// rgb, 1 bit alpha
+	TEXTURE_COMPRESSION_BC3,		// rgba
+	TEXTURE_COMPRESSION_BC5,		// two channel, normal maps
+	TEXTURE_COMPRESSION_BC7			// rgba, best quality at the same size as BC3
+};
+
+struct TextureCookSettings
+{
+	TextureCompression m_compression;
+	// colour textures, mips are filtered in linear space and the format gets the _SRGB variant
+	bool m_srgb;
+	bool m_generateMips;
+};
+
+// mips top first, each a tightly packed run of block rows, which is exactly the DDS data layout
+struct CookedTexture
+{
+	DXGI_FORMAT m_format;
+	UINT m_width;
+	UINT m_height;
+	UINT m_mipCount;
+	std::vector<UINT8> m_data;
+};
+
+struct TextureCookStats
+{
+	UINT64 m_texels;		// every mip
+	UINT64 m_blocks;
+	double m_mipSeconds;
+	double m_encodeSeconds;
+
+	double encodeMegatexelsPerSecond() const
+	{
+		return m_encodeSeconds > 0.0 ? static_cast<double>(m_texels) / 1000000.0 / m_encodeSeconds : 0.0;
+	}
+};
+
+// offline stage that turns decoded RGBA8 images into block compressed mip chains, ready to upload as is.
+// each mip is encoded in parallel, one job per row of blocks
+class TextureCooker
+{
+public:
+	TextureCooker(JobSystem & jobSystem);
+	~TextureCooker();
+
+	CookedTexture cook(DecodedImage && source, const TextureCookSettings & settings, TextureCookStats & stats);
+
+	// encodes one RGBA8 surface, out has to hold surfaceSize(width, height, compression) bytes
+	void encodeSurface(const DecodedImage & surface, const TextureCompression compression, UINT8 * out);
+
+	static UINT blockBytes(const TextureCompression compression);
+	static DXGI_FORMAT formatOf(const TextureCompression compression, const bool srgb);
+	static size_t surfaceSize(const UINT width, const UINT height, const TextureCompression compression);
+
+	// a DX10 header .dds, so the dxgi format (srgb, BC7) is stored as is
+	static std::vector<UINT8> writeDds(const CookedTexture & texture);
+	static bool saveDds(const CookedTexture & texture, const std::string & path);
+
+private:
+
+	JobSystem & m_jobSystem;
+};
+
+#endif // _TEXTURE_COOKER_H_
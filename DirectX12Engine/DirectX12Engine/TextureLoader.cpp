@@ -0,0 +1,209 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+
+TextureLoader::TextureLoader(JobSystem & jobSystem, const ImageDecodeFunc & decoder)
+	: m_jobSystem(jobSystem)
+	, m_decoder(decoder)
+	, m_generateMips(true)
+{
+
+}
+
+TextureLoader::~TextureLoader()
+{
+
+}
+
+std::vector<LoadedTexture> TextureLoader::load(const std::vector<TextureSource> & sources, TextureLoadStats & stats)
+{
+	using namespace std::chrono;
+
+	const steady_clock::time_point start = steady_clock::now();
+
+	std::vector<LoadedTexture> textures(sources.size());
+	std::vector<UINT64> encodedBytes(sources.size(), 0);
+	std::vector<double> seconds(sources.size(), 0.0);
+
+	// textures vary a lot in size, one per job keeps the big ones from holding up a whole range
+	m_jobSystem.parallelFor(sources.size(), 1, [&](const size_t begin, const size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const steady_clock::time_point decodeStart = steady_clock::now();
+
+			textures[i].m_name = sources[i].m_name;
+			textures[i].m_loaded = loadOne(sources[i], textures[i], encodedBytes[i]);
+
+			seconds[i] = duration_cast<duration<double>>(steady_clock::now() - decodeStart).count();
+		}
+	});
+
+	stats.m_textureCount = sources.size();
+	stats.m_failedCount = 0;
+	stats.m_encodedBytes = 0;
+	stats.m_decodedBytes = 0;
+	stats.m_decodeSeconds = 0.0;
+	stats.m_threadCount = m_jobSystem.getWorkerCount() + 1;
+
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		stats.m_encodedBytes += encodedBytes[i];
+		stats.m_decodeSeconds += seconds[i];
+
+		if (!textures[i].m_loaded)
+		{
+			++stats.m_failedCount;
+		}
+		else
+		{
+			stats.m_decodedBytes += textures[i].m_mips[0].m_pixels.size();
+		}
+	}
+
+	stats.m_wallSeconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+	return textures;
+}
+
+bool TextureLoader::loadOne(const TextureSource & source, LoadedTexture & texture, UINT64 & encodedBytes) const
+{
+	DecodedImage image;
+
+	if (source.m_embeddedData != nullptr)
+	{
+		if (source.m_rawWidth != 0 && source.m_rawHeight != 0)
+		{
+			decodeBgra8(source.m_embeddedData, source.m_rawWidth, source.m_rawHeight, image);
+			encodedBytes = static_cast<UINT64>(source.m_rawWidth) * source.m_rawHeight * 4;
+		}
+		else
+		{
+			encodedBytes = source.m_embeddedSize;
+
+			if (!m_decoder(source.m_embeddedData, source.m_embeddedSize, source.m_formatHint, image))
+			{
+				return false;
+			}
+		}
+	}
+	else
+	{
+		std::ifstream file(source.m_path, std::ios::binary | std::ios::ate);
+
+		if (!file)
+		{
+			return false;
+		}
+
+		const std::streamoff fileSize = file.tellg();
+
+		if (fileSize <= 0)
+		{
+			return false;
+		}
+
+		std::vector<UINT8> fileData(static_cast<size_t>(fileSize));
+		file.seekg(0);
+
+		if (!file.read(reinterpret_cast<char*>(fileData.data()), fileSize))
+		{
+			return false;
+		}
+
+		encodedBytes = fileData.size();
+
+		if (!m_decoder(fileData.data(), fileData.size(), source.m_formatHint, image))
+		{
+			return false;
+		}
+	}
+
+	if (image.m_width == 0 || image.m_height == 0)
+	{
+		return false;
+	}
+
+	if (m_generateMips)
+	{
+		texture.m_mips = buildMipChain(std::move(image));
+	}
+	else
+	{
+		texture.m_mips.push_back(std::move(image));
+	}
+
+	return true;
+}
+
+std::string TextureLoader::resolvePath(const std::string & sceneDirectory, const std::string & texturePath)
+{
+	std::string path = texturePath;
+	std::replace(path.begin(), path.end(), '\\', '/');
+
+	// absolute, either /... or a drive letter
+	const bool absolute = (!path.empty() && path[0] == '/') || (path.size() > 1 && path[1] == ':');
+
+	if (absolute || sceneDirectory.empty())
+	{
+		return path;
+	}
+
+	// strip leading ./ so the paths dedupe
+	while (path.compare(0, 2, "./") == 0)
+	{
+		path.erase(0, 2);
+	}
+
+	std::string directory = sceneDirectory;
+	std::replace(directory.begin(), directory.end(), '\\', '/');
+
+	if (directory.back() != '/')
+	{
+		directory += '/';
+	}
+
+	return directory + path;
+}
+
+bool TextureLoader::parseEmbeddedIndex(const std::string & texturePath, UINT & index)
+{
+	if (texturePath.size() < 2 || texturePath[0] != '*')
+	{
+		return false;
+	}
+
+	UINT value = 0;
+
+	for (size_t i = 1; i < texturePath.size(); ++i)
+	{
+		if (!std::isdigit(static_cast<unsigned char>(texturePath[i])))
+		{
+			return false;
+		}
+
+		value = value * 10 + static_cast<UINT>(texturePath[i] - '0');
+	}
+
+	index = value;
+	return true;
+}
+
+std::string TextureLoader::extensionOf(const std::string & path)
+{
+	const size_t dot = path.find_last_of('.');
+	const size_t slash = path.find_last_of("/\\");
+
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+	{
+		return std::string();
+	}
+
+	std::string extension = path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+	return extension;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef _TEXTURE_LOADER_H_
+#define _TEXTURE_LOADER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ImageDecoder.h"
+#include "JobSystem.h"
+
+// one image a material refers to, either a file next to the scene or a payload embedded in it
+struct TextureSource
+{
+	std::string m_name;			// the path as the material has it, "*0" etc. for embedded textures
+	std::string m_path;			// resolved file path, empty when embedded
+	std::string m_formatHint;	// png, jpg, tga..., from aiTexture::achFormatHint or the extension
+	// embedded payload, or a file already read into memory. it has to outlive load(), compressed unless the raw size is set
+	const UINT8 * m_embeddedData;
+	size_t m_embeddedSize;
+	UINT m_rawWidth;
+	UINT m_rawHeight;
+};
+
+struct LoadedTexture
+{
+	std::string m_name;
+	bool m_loaded;
+	std::vector<DecodedImage> m_mips;
+};
+
+struct TextureLoadStats
+{
+	size_t m_textureCount;
+	size_t m_failedCount;
+	UINT64 m_encodedBytes;		// what was read or embedded
+	UINT64 m_decodedBytes;		// RGBA8 of the top mips
+	double m_decodeSeconds;		// summed across threads, read + decode + mips
+	double m_wallSeconds;
+	unsigned int m_threadCount;
+
+	// decode throughput of a single core, the number to compare between decoders
+	double encodedMegabytesPerSecondPerCore() const
+	{
+		return m_decodeSeconds > 0.0 ? (static_cast<double>(m_encodedBytes) / (1024.0 * 1024.0)) / m_decodeSeconds : 0.0;
+	}
+};
+
+// decodes a compressed image into RGBA8, decodeImage from WicImageDecoder.h in the engine
+typedef std::function<bool(const UINT8 * data, const size_t size, const std::string & formatHint, DecodedImage & image)> ImageDecodeFunc;
+
+// reads and decodes every texture a scene uses across the job system, one texture per job
+class TextureLoader
+{
+public:
+	TextureLoader(JobSystem & jobSystem, const ImageDecodeFunc & decoder);
+	~TextureLoader();
+
+	void setGenerateMips(const bool generateMips) { m_generateMips = generateMips; }
+
+	// results line up with sources, a texture that fails to read or decode comes back with m_loaded false
+	std::vector<LoadedTexture> load(const std::vector<TextureSource> & sources, TextureLoadStats & stats);
+
+	// material paths are relative to the scene file and may use either slash
+	static std::string resolvePath(const std::string & sceneDirectory, const std::string & texturePath);
+	// assimp names embedded textures "*<index into aiScene::mTextures>"
+	static bool parseEmbeddedIndex(const std::string & texturePath, UINT & index);
+	// lower case, without the dot
+	static std::string extensionOf(const std::string & path);
+
+private:
+
+	bool loadOne(const TextureSource & source, LoadedTexture & texture, UINT64 & encodedBytes) const;
+
+	JobSystem & m_jobSystem;
+	ImageDecodeFunc m_decoder;
+	bool m_generateMips;
+};
+
+#endif // _TEXTURE_LOADER_H_
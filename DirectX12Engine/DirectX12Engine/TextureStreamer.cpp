@@ -0,0 +1,326 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+TextureStreamer::TextureStreamer()
+	: m_budgetBytes(256 * 1024 * 1024)
+	, m_usedBytes(0)
+	, m_pixelsPerUnitAtOne(0.0f)
+	, m_mipTailSize(64)
+	, m_maxLoadsPerUpdate(8)
+	, m_stats()
+{
+	setViewport(600, 0.785398f); // 45 degrees
+}
+
+TextureStreamer::~TextureStreamer()
+{
+
+}
+
+void TextureStreamer::setViewport(const UINT screenHeight, const float verticalFov)
+{
+	m_pixelsPerUnitAtOne = static_cast<float>(screenHeight) / (2.0f * std::tan(verticalFov * 0.5f));
+}
+
+StreamedTextureId TextureStreamer::addTexture(const StreamedTextureDesc & desc)
+{
+	assert(!desc.m_mipBytes.empty());
+
+	StreamedTexture texture;
+	texture.m_mipBytes = desc.m_mipBytes;
+
+	const UINT lastMip = static_cast<UINT>(desc.m_mipBytes.size() - 1);
+	texture.m_tailMip = 0;
+
+	while (texture.m_tailMip < lastMip && std::max(desc.m_width >> texture.m_tailMip, desc.m_height >> texture.m_tailMip) > m_mipTailSize)
+	{
+		++texture.m_tailMip;
+	}
+
+	// once a BC mip isn't whole blocks no smaller one is either, so back up to the smallest that is. every load
+	// and eviction stays between mip 0 and the tail, so they only ever start at aligned mips too. the full chain
+	// is kept when nothing below it is aligned
+	if (desc.m_blockCompressed)
+	{
+		while (texture.m_tailMip > 0 && ((desc.m_width >> texture.m_tailMip) % 4 != 0 || (desc.m_height >> texture.m_tailMip) % 4 != 0))
+		{
+			--texture.m_tailMip;
+		}
+	}
+
+	// the tail goes up with the texture itself
+	texture.m_residentMip = texture.m_tailMip;
+	texture.m_pendingMip = texture.m_tailMip;
+	texture.m_changePending = false;
+	texture.m_requested = false;
+	texture.m_wantedMip = texture.m_tailMip;
+	texture.m_priority = 0.0f;
+	texture.m_lastUsedFrame = 0;
+
+	m_usedBytes += bytesFrom(texture, texture.m_tailMip);
+	m_textures.push_back(texture);
+
+	return static_cast<StreamedTextureId>(m_textures.size() - 1);
+}
+
+UINT TextureStreamer::getTailMip(const StreamedTextureId texture) const
+{
+	return m_textures[texture].m_tailMip;
+}
+
+UINT TextureStreamer::getResidentMip(const StreamedTextureId texture) const
+{
+	return m_textures[texture].m_residentMip;
+}
+
+UINT64 TextureStreamer::getResidentBytes(const StreamedTextureId texture) const
+{
+	return bytesFrom(m_textures[texture], m_textures[texture].m_residentMip);
+}
+
+float TextureStreamer::desiredMip(const UINT textureSize, const float worldSize, const float distance) const
+{
+	if (distance <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	const float pixels = worldSize * m_pixelsPerUnitAtOne / distance;
+
+	if (pixels <= 0.0f)
+	{
+		return FLT_MAX;
+	}
+
+	// texels per pixel, each mip halves it
+	return std::max(std::log2(static_cast<float>(textureSize) / pixels), 0.0f);
+}
+
+void TextureStreamer::requestMip(const StreamedTextureId texture, const float mip, const float priority)
+{
+	StreamedTexture & streamed = m_textures[texture];
+
+	// round down, trilinear blends towards the finer of the two levels
+	const UINT wanted = mip >= static_cast<float>(streamed.m_tailMip) ? streamed.m_tailMip : static_cast<UINT>(std::max(mip, 0.0f));
+
+	streamed.m_requested = true;
+	streamed.m_wantedMip = std::min(streamed.m_wantedMip, wanted);
+	streamed.m_priority = std::max(streamed.m_priority, priority);
+}
+
+StreamingUpdate TextureStreamer::update(const UINT64 frame)
+{
+	StreamingUpdate update;
+
+	std::vector<StreamedTextureId> wanted;
+
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		StreamedTexture & texture = m_textures[i];
+
+		if (!texture.m_requested)
+		{
+			continue;
+		}
+
+		texture.m_lastUsedFrame = frame;
+
+		if (!texture.m_changePending && texture.m_wantedMip < texture.m_residentMip)
+		{
+			wanted.push_back(static_cast<StreamedTextureId>(i));
+		}
+	}
+
+	// most visible first, scaled by how far each one is from what it wants
+	auto score = [this](const StreamedTextureId id)
+	{
+		const StreamedTexture & texture = m_textures[id];
+		return texture.m_priority * static_cast<float>(texture.m_residentMip - texture.m_wantedMip);
+	};
+
+	std::stable_sort(wanted.begin(), wanted.end(),
+		[&score](const StreamedTextureId a, const StreamedTextureId b) { return score(a) > score(b); });
+
+	for (size_t i = 0; i < wanted.size(); ++i)
+	{
+		StreamedTexture & texture = m_textures[wanted[i]];
+
+		if (update.m_loads.size() >= m_maxLoadsPerUpdate || texture.m_changePending)
+		{
+			// an eviction for room earlier in this update can have touched it
+			++m_stats.m_loadsDeferred;
+			continue;
+		}
+
+		// one level at a time, so every texture gets something before any one gets everything
+		const UINT nextMip = texture.m_residentMip - 1;
+		const UINT64 cost = texture.m_mipBytes[nextMip];
+
+		if (m_usedBytes + cost > m_budgetBytes && !makeRoom(m_usedBytes + cost - m_budgetBytes, wanted[i], texture.m_priority, frame, update))
+		{
+			++m_stats.m_loadsDeferred;
+			continue;
+		}
+
+		texture.m_pendingMip = nextMip;
+		texture.m_changePending = true;
+		m_usedBytes += cost;
+
+		MipResidencyChange load;
+		load.m_texture = wanted[i];
+		load.m_topMip = nextMip;
+		update.m_loads.push_back(load);
+		++m_stats.m_loadsIssued;
+	}
+
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		m_textures[i].m_requested = false;
+		m_textures[i].m_wantedMip = m_textures[i].m_tailMip;
+		m_textures[i].m_priority = 0.0f;
+	}
+
+	m_stats.m_budgetBytes = m_budgetBytes;
+	m_stats.m_residentBytes = m_usedBytes;
+
+	return update;
+}
+
+bool TextureStreamer::makeRoom(const UINT64 bytes, const StreamedTextureId protect, const float priority, const UINT64 frame, StreamingUpdate & update)
+{
+	struct Victim
+	{
+		StreamedTextureId m_texture;
+		UINT m_lowestMip;	// how far it may be dropped
+		int m_class;		// 0 more than it needs, 1 unused this frame, 2 visible with a lower priority
+		UINT64 m_lastUsedFrame;
+		float m_priority;
+	};
+
+	std::vector<Victim> victims;
+
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		const StreamedTexture & texture = m_textures[i];
+
+		if (i == protect || texture.m_changePending || texture.m_residentMip >= texture.m_tailMip)
+		{
+			continue;
+		}
+
+		Victim victim;
+		victim.m_texture = static_cast<StreamedTextureId>(i);
+		victim.m_lastUsedFrame = texture.m_lastUsedFrame;
+		victim.m_priority = texture.m_priority;
+
+		if (texture.m_lastUsedFrame < frame)
+		{
+			victim.m_class = 1;
+			victim.m_lowestMip = texture.m_tailMip;
+		}
+		else if (texture.m_residentMip < texture.m_wantedMip)
+		{
+			// costs nothing on screen
+			victim.m_class = 0;
+			victim.m_lowestMip = texture.m_wantedMip;
+		}
+		else if (texture.m_priority < priority)
+		{
+			victim.m_class = 2;
+			victim.m_lowestMip = texture.m_tailMip;
+		}
+		else
+		{
+			continue;
+		}
+
+		victims.push_back(victim);
+	}
+
+	// least recently used first, then the least important of what is on screen
+	std::sort(victims.begin(), victims.end(), [](const Victim & a, const Victim & b)
+	{
+		if (a.m_class != b.m_class)
+		{
+			return a.m_class < b.m_class;
+		}
+
+		if (a.m_lastUsedFrame != b.m_lastUsedFrame)
+		{
+			return a.m_lastUsedFrame < b.m_lastUsedFrame;
+		}
+
+		if (a.m_priority != b.m_priority)
+		{
+			return a.m_priority < b.m_priority;
+		}
+
+		return a.m_texture < b.m_texture;
+	});
+
+	// work out the drops first, nothing is evicted unless it frees enough
+	std::vector<MipResidencyChange> drops;
+	UINT64 freed = 0;
+
+	for (size_t i = 0; i < victims.size() && freed < bytes; ++i)
+	{
+		const StreamedTexture & texture = m_textures[victims[i].m_texture];
+		UINT mip = texture.m_residentMip;
+
+		while (mip < victims[i].m_lowestMip && freed < bytes)
+		{
+			freed += texture.m_mipBytes[mip];
+			++mip;
+		}
+
+		MipResidencyChange drop;
+		drop.m_texture = victims[i].m_texture;
+		drop.m_topMip = mip;
+		drops.push_back(drop);
+	}
+
+	if (freed < bytes)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < drops.size(); ++i)
+	{
+		StreamedTexture & texture = m_textures[drops[i].m_texture];
+
+		// counted as gone straight away, the caller swaps in the smaller texture before it can load anything else
+		m_usedBytes -= bytesFrom(texture, texture.m_residentMip) - bytesFrom(texture, drops[i].m_topMip);
+		texture.m_residentMip = drops[i].m_topMip;
+		texture.m_pendingMip = drops[i].m_topMip;
+		texture.m_changePending = true;
+
+		update.m_evictions.push_back(drops[i]);
+		++m_stats.m_evictionsIssued;
+	}
+
+	return true;
+}
+
+void TextureStreamer::onChangeComplete(const StreamedTextureId texture)
+{
+	StreamedTexture & streamed = m_textures[texture];
+
+	streamed.m_residentMip = streamed.m_pendingMip;
+	streamed.m_changePending = false;
+}
+
+UINT64 TextureStreamer::bytesFrom(const StreamedTexture & texture, const UINT mip)
+{
+	UINT64 bytes = 0;
+
+	for (size_t i = mip; i < texture.m_mipBytes.size(); ++i)
+	{
+		bytes += texture.m_mipBytes[i];
+	}
+
+	return bytes;
+}
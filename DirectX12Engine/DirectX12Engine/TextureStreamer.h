@@ -0,0 +1,122 @@
+#pragma once
+#ifndef _TEXTURE_STREAMER_H_
+#define _TEXTURE_STREAMER_H_
+
+#include <vector>
+
+#include <Windows.h>
+
+typedef UINT StreamedTextureId;
+
+struct StreamedTextureDesc
+{
+	StreamedTextureDesc()
+		: m_width(0)
+		, m_height(0)
+		, m_blockCompressed(false)
+	{
+
+	}
+
+	UINT m_width;
+	UINT m_height;
+	std::vector<UINT64> m_mipBytes;	// one per mip, top first
+	// a BC texture can only start at a mip that is whole 4x4 blocks, which keeps the tail from going that small
+	bool m_blockCompressed;
+};
+
+// a texture's top resident mip is changing, either finer (a load) or coarser (an eviction).
+// the caller makes the change and reports back through onChangeComplete
+struct MipResidencyChange
+{
+	StreamedTextureId m_texture;
+	UINT m_topMip;
+};
+
+struct StreamingUpdate
+{
+	std::vector<MipResidencyChange> m_loads;	// highest priority first
+	std::vector<MipResidencyChange> m_evictions;
+};
+
+struct TextureStreamerStats
+{
+	UINT64 m_budgetBytes;
+	UINT64 m_residentBytes;		// including loads still in flight
+	UINT64 m_loadsIssued;
+	UINT64 m_evictionsIssued;
+	UINT64 m_loadsDeferred;		// wanted but didn't fit under the budget this update
+};
+
+// decides which mips of which textures should be resident. textures start with only their small mips, the
+// mip tail, and visible objects ask for finer mips by how many texels land on each pixel. each update hands
+// out loads one mip at a time in priority order and makes room under the budget by dropping mips from the
+// textures used least recently, then from the lowest priority ones. cpu only, the caller does the uploads
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+	~TextureStreamer();
+
+	void setBudget(const UINT64 bytes) { m_budgetBytes = bytes; }
+	// screen height in pixels and vertical field of view in radians, the same as LodSelector
+	void setViewport(const UINT screenHeight, const float verticalFov);
+	// mips this size and smaller are always resident and are what a texture starts with
+	void setMipTailSize(const UINT texels) { m_mipTailSize = texels; }
+	// loads handed out per update, so one frame doesn't queue the whole scene
+	void setMaxLoadsPerUpdate(const UINT loads) { m_maxLoadsPerUpdate = loads; }
+
+	StreamedTextureId addTexture(const StreamedTextureDesc & desc);
+
+	// the first mip to load with the texture, everything from here down is the tail
+	UINT getTailMip(const StreamedTextureId texture) const;
+	UINT getResidentMip(const StreamedTextureId texture) const;
+	UINT64 getResidentBytes(const StreamedTextureId texture) const;
+
+	// mip where one texel covers about one pixel, for a texture spread over worldSize units at the given distance
+	float desiredMip(const UINT textureSize, const float worldSize, const float distance) const;
+
+	// called for every visible use this frame, the finest mip and highest priority asked for win
+	void requestMip(const StreamedTextureId texture, const float mip, const float priority);
+
+	StreamingUpdate update(const UINT64 frame);
+
+	// the load or eviction handed out for this texture has been made
+	void onChangeComplete(const StreamedTextureId texture);
+
+	const TextureStreamerStats & getStats() const { return m_stats; }
+
+private:
+
+	struct StreamedTexture
+	{
+		std::vector<UINT64> m_mipBytes;
+		UINT m_tailMip;
+		UINT m_residentMip;		// top resident mip, lower is finer
+		UINT m_pendingMip;		// what it becomes once the change in flight lands
+		bool m_changePending;
+
+		// this frame's requests
+		bool m_requested;
+		UINT m_wantedMip;
+		float m_priority;
+		UINT64 m_lastUsedFrame;
+	};
+
+	// bytes resident from mip down to the last mip
+	static UINT64 bytesFrom(const StreamedTexture & texture, const UINT mip);
+	// frees at least bytes by dropping mips, never from protect or anything with a higher priority
+	bool makeRoom(const UINT64 bytes, const StreamedTextureId protect, const float priority, const UINT64 frame, StreamingUpdate & update);
+
+	std::vector<StreamedTexture> m_textures;
+
+	UINT64 m_budgetBytes;
+	UINT64 m_usedBytes;
+	float m_pixelsPerUnitAtOne;
+	UINT m_mipTailSize;
+	UINT m_maxLoadsPerUpdate;
+
+	TextureStreamerStats m_stats;
+};
+
+#endif // _TEXTURE_STREAMER_H_
@@ -0,0 +1,62 @@
+#include "WicImageDecoder.h"
+
+#include <wincodec.h>
+#include <wrl.h>
+
+#include <algorithm>
+#include <cctype>
+
+bool decodeWithWic(const UINT8 * data, const size_t size, DecodedImage & image)
+{
+	// S_FALSE means this thread already had COM up, it still needs balancing
+	const HRESULT coInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	const bool uninitialise = SUCCEEDED(coInit);
+
+	bool decoded = false;
+
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICStream> stream;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		Microsoft::WRL::ComPtr<IWICBitmapSource> rgba;
+
+		UINT width = 0;
+		UINT height = 0;
+
+		if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))
+			&& SUCCEEDED(factory->CreateStream(&stream))
+			&& SUCCEEDED(stream->InitializeFromMemory(const_cast<BYTE*>(data), static_cast<DWORD>(size)))
+			&& SUCCEEDED(factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder))
+			&& SUCCEEDED(decoder->GetFrame(0, &frame))
+			&& SUCCEEDED(WICConvertBitmapSource(GUID_WICPixelFormat32bppRGBA, frame.Get(), &rgba))
+			&& SUCCEEDED(rgba->GetSize(&width, &height)))
+		{
+			image.m_width = width;
+			image.m_height = height;
+			image.m_pixels.resize(static_cast<size_t>(width) * height * 4);
+
+			decoded = SUCCEEDED(rgba->CopyPixels(nullptr, width * 4, static_cast<UINT>(image.m_pixels.size()), image.m_pixels.data()));
+		}
+	}
+
+	if (uninitialise)
+	{
+		CoUninitialize();
+	}
+
+	return decoded;
+}
+
+bool decodeImage(const UINT8 * data, const size_t size, const std::string & formatHint, DecodedImage & image)
+{
+	std::string hint = formatHint;
+	std::transform(hint.begin(), hint.end(), hint.begin(), [](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+	if (hint == "tga")
+	{
+		return decodeTga(data, size, image);
+	}
+
+	return decodeWithWic(data, size, image);
+}
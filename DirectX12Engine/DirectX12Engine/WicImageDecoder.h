@@ -0,0 +1,17 @@
+#pragma once
+#ifndef _WIC_IMAGE_DECODER_H_
+#define _WIC_IMAGE_DECODER_H_
+
+#include <string>
+
+#include "ImageDecoder.h"
+
+// png, jpg, bmp and anything else the Windows Imaging Component has a codec for.
+// safe to call from worker threads, COM is initialised per call if the thread hasn't done it
+bool decodeWithWic(const UINT8 * data, const size_t size, DecodedImage & image);
+
+// picks the decoder from the format hint (aiTexture::achFormatHint or the file extension), TGA has no
+// WIC codec so it goes through decodeTga
+bool decodeImage(const UINT8 * data, const size_t size, const std::string & formatHint, DecodedImage & image);
+
+#endif // _WIC_IMAGE_DECODER_H_
@@ -0,0 +1,125 @@
+#include "Win32IoBackend.h"
+
+#include <cassert>
+
+namespace
+{
+	// the OVERLAPPED has to live until the read completes, the tag rides along with it
+	struct OverlappedRead
+	{
+		OVERLAPPED m_overlapped;
+		UINT64 m_tag;
+	};
+
+	const ULONG c_maxCompletionsPerWait = 64;
+}
+
+Win32IoBackend::Win32IoBackend()
+	: m_completionPort(nullptr)
+{
+
+}
+
+Win32IoBackend::~Win32IoBackend()
+{
+	shutdown();
+}
+
+HRESULT Win32IoBackend::init()
+{
+	m_completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+
+	return m_completionPort != nullptr ? S_OK : E_FAIL;
+}
+
+void Win32IoBackend::shutdown()
+{
+	if (m_completionPort != nullptr)
+	{
+		CloseHandle(m_completionPort);
+		m_completionPort = nullptr;
+	}
+}
+
+bool Win32IoBackend::openFile(const std::string & path, IoFileHandle & file, UINT64 & size)
+{
+	const HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+
+	if (!GetFileSizeEx(handle, &fileSize) || CreateIoCompletionPort(handle, m_completionPort, 0, 0) == nullptr)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	file = reinterpret_cast<IoFileHandle>(handle);
+	size = static_cast<UINT64>(fileSize.QuadPart);
+
+	return true;
+}
+
+void Win32IoBackend::closeFile(const IoFileHandle file)
+{
+	CloseHandle(reinterpret_cast<HANDLE>(file));
+}
+
+bool Win32IoBackend::submitRead(const IoFileHandle file, const UINT64 offset, const UINT64 size, UINT8 * destination, const UINT64 tag)
+{
+	assert(size <= c_ioMaxBackendRead);
+
+	OverlappedRead * read = new OverlappedRead();
+	read->m_overlapped.Offset = static_cast<DWORD>(offset & 0xffffffff);
+	read->m_overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+	read->m_tag = tag;
+
+	// a read that finishes straight away still posts to the port, so every started read has exactly one completion
+	if (!ReadFile(reinterpret_cast<HANDLE>(file), destination, static_cast<DWORD>(size), nullptr, &read->m_overlapped) &&
+		GetLastError() != ERROR_IO_PENDING)
+	{
+		delete read;
+		return false;
+	}
+
+	return true;
+}
+
+void Win32IoBackend::waitForCompletions(std::vector<IoCompletion> & completions)
+{
+	OVERLAPPED_ENTRY entries[c_maxCompletionsPerWait];
+	ULONG count = 0;
+
+	if (!GetQueuedCompletionStatusEx(m_completionPort, entries, c_maxCompletionsPerWait, &count, INFINITE, FALSE))
+	{
+		return;
+	}
+
+	for (ULONG entry = 0; entry < count; ++entry)
+	{
+		// a wake up has no OVERLAPPED
+		if (entries[entry].lpOverlapped == nullptr)
+		{
+			completions.push_back({ 0, 0, true });
+			continue;
+		}
+
+		OverlappedRead * read = CONTAINING_RECORD(entries[entry].lpOverlapped, OverlappedRead, m_overlapped);
+
+		// the status of the read is in Internal, it is an NTSTATUS so anything negative is an error
+		const bool succeeded = static_cast<LONG>(read->m_overlapped.Internal) >= 0;
+
+		completions.push_back({ read->m_tag, entries[entry].dwNumberOfBytesTransferred, succeeded });
+		delete read;
+	}
+}
+
+void Win32IoBackend::wake()
+{
+	PostQueuedCompletionStatus(m_completionPort, 0, 0, nullptr);
+}
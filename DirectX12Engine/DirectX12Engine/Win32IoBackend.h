@@ -0,0 +1,30 @@
+#pragma once
+#ifndef _WIN32_IO_BACKEND_H_
+#define _WIN32_IO_BACKEND_H_
+
+#include <Windows.h>
+
+#include "IoService.h"
+
+// overlapped ReadFile on files opened for it, completions come back through one completion port
+class Win32IoBackend : public IoBackend
+{
+public:
+	Win32IoBackend();
+	~Win32IoBackend();
+
+	HRESULT init();
+	void shutdown();
+
+	bool openFile(const std::string & path, IoFileHandle & file, UINT64 & size) override;
+	void closeFile(const IoFileHandle file) override;
+	bool submitRead(const IoFileHandle file, const UINT64 offset, const UINT64 size, UINT8 * destination, const UINT64 tag) override;
+	void waitForCompletions(std::vector<IoCompletion> & completions) override;
+	void wake() override;
+
+private:
+
+	HANDLE m_completionPort;
+};
+
+#endif // _WIN32_IO_BACKEND_H_
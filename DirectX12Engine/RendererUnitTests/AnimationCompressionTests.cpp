@@ -0,0 +1,294 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/AnimationCompressor.h"
+
+#include <cmath>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	DirectX::XMFLOAT4 rotationZ(const float angle)
+	{
+		return DirectX::XMFLOAT4(0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f));
+	}
+
+	// the chord between the two on the unit sphere, acos of the dot product can't resolve angles this small
+	float angleBetween(const DirectX::XMFLOAT4 & a, const DirectX::XMFLOAT4 & b)
+	{
+		const float difference = (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z) + (a.w - b.w) * (a.w - b.w);
+		const float sum = (a.x + b.x) * (a.x + b.x) + (a.y + b.y) * (a.y + b.y) + (a.z + b.z) * (a.z + b.z) + (a.w + b.w) * (a.w + b.w);
+
+		return 4.0f * std::asin(std::sqrt(std::fmin(difference, sum)) * 0.5f);
+	}
+
+	// a chain of joints one unit apart along x
+	Skeleton makeChain(const UINT jointCount)
+	{
+		Skeleton skeleton;
+
+		for (UINT j = 0; j < jointCount; ++j)
+		{
+			JointTransform joint;
+			joint.m_translation = DirectX::XMFLOAT3(j == 0 ? 0.0f : 1.0f, 0.0f, 0.0f);
+			joint.m_rotation = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			joint.m_scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+			skeleton.m_parents.push_back(static_cast<int>(j) - 1);
+			skeleton.m_names.push_back("joint" + std::to_string(j));
+			skeleton.m_bindPose.push_back(joint);
+		}
+
+		return skeleton;
+	}
+
+	// sampled at 30 keys a second like an exported clip. every joint sways about z at its own rate and the root
+	// walks along x while bobbing up and down, joints past the first few hold still at the bind pose
+	AnimationClip makeSampledClip(const Skeleton & skeleton, const float duration)
+	{
+		std::vector<JointKeys> keys(skeleton.m_parents.size());
+		const UINT keyCount = static_cast<UINT>(duration * 30.0f) + 1;
+
+		for (size_t j = 0; j < keys.size(); ++j)
+		{
+			for (UINT k = 0; k < keyCount; ++k)
+			{
+				const float time = k / 30.0f;
+
+				keys[j].m_translationTimes.push_back(time);
+				keys[j].m_translations.push_back(skeleton.m_bindPose[j].m_translation);
+				keys[j].m_scaleTimes.push_back(time);
+				keys[j].m_scales.push_back(DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+				keys[j].m_rotationTimes.push_back(time);
+				keys[j].m_rotations.push_back(j < 12 ? rotationZ(0.5f * std::sin(time * (1.0f + j * 0.3f))) : skeleton.m_bindPose[j].m_rotation);
+			}
+		}
+
+		for (UINT k = 0; k < keyCount; ++k)
+		{
+			const float time = k / 30.0f;
+			keys[0].m_translations[k] = DirectX::XMFLOAT3(time * 1.5f, 0.05f * std::sin(time * 12.0f), 0.0f);
+		}
+
+		AnimationClip clip;
+		clip.build(keys, duration);
+		return clip;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(AnimationCompressionTests)
+	{
+	public:
+
+		TEST_METHOD(AnimationCompression_quaternionsPackToSmallestThree)
+		{
+			UINT seed = 12345;
+			float maxError = 0.0f;
+
+			for (UINT i = 0; i < 10000; ++i)
+			{
+				float q[4];
+				float length = 0.0f;
+
+				for (UINT c = 0; c < 4; ++c)
+				{
+					seed = seed * 1664525u + 1013904223u;
+					q[c] = (seed >> 8) / 8388608.0f - 1.0f;
+					length += q[c] * q[c];
+				}
+
+				length = std::sqrt(length);
+
+				const DirectX::XMFLOAT4 rotation(q[0] / length, q[1] / length, q[2] / length, q[3] / length);
+
+				UINT16 packed[3];
+				packQuaternion(rotation, packed);
+				const DirectX::XMFLOAT4 unpacked = unpackQuaternion(packed);
+
+				maxError = std::fmax(maxError, angleBetween(rotation, unpacked));
+			}
+
+			// 15 bits over +-1/sqrt(2) is a little under a hundredth of a degree
+			Assert::IsTrue(maxError < 0.0002f);
+
+			// the negated quaternion is the same rotation and packs to the same bits
+			UINT16 a[3];
+			UINT16 b[3];
+			packQuaternion(rotationZ(2.0f), a);
+			const DirectX::XMFLOAT4 flipped = rotationZ(2.0f);
+			packQuaternion(DirectX::XMFLOAT4(-flipped.x, -flipped.y, -flipped.z, -flipped.w), b);
+
+			for (UINT c = 0; c < 3; ++c)
+			{
+				Assert::AreEqual(a[c], b[c]);
+			}
+		}
+
+		TEST_METHOD(AnimationCompression_keepsOnlyTheKeysTheToleranceNeeds)
+		{
+			const Skeleton skeleton = makeChain(1);
+
+			// a straight line, a held rotation away from the bind pose and a scale that is the bind pose
+			std::vector<JointKeys> keys(1);
+
+			for (UINT k = 0; k <= 30; ++k)
+			{
+				keys[0].m_translationTimes.push_back(k / 30.0f);
+				keys[0].m_translations.push_back(DirectX::XMFLOAT3(k / 10.0f, 1.0f, k / -30.0f));
+				keys[0].m_rotationTimes.push_back(k / 30.0f);
+				keys[0].m_rotations.push_back(rotationZ(0.5f));
+				keys[0].m_scaleTimes.push_back(k / 30.0f);
+				keys[0].m_scales.push_back(DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+			}
+
+			AnimationClip source;
+			source.build(keys, 1.0f);
+
+			AnimationCompressor compressor;
+			AnimationCompressionReport report;
+			const CompressedClip clip = compressor.compress(source, skeleton, AnimationCompressionSettings(), report);
+
+			Assert::AreEqual(2u, clip.getKeyCount(CHANNEL_TRANSLATION, 0));
+			Assert::AreEqual(1u, clip.getKeyCount(CHANNEL_ROTATION, 0));
+			Assert::AreEqual(0u, clip.getKeyCount(CHANNEL_SCALE, 0));
+
+			Assert::AreEqual(static_cast<UINT64>(93), report.m_sourceKeys);
+			Assert::AreEqual(static_cast<UINT64>(3), report.m_keptKeys);
+
+			// halfway along the line
+			AnimationCursor cursor;
+			cursor.reset(clip);
+			std::vector<JointTransform> pose(1);
+			sampleClip(clip, skeleton, 0.5f, cursor, pose);
+
+			Assert::AreEqual(1.5f, pose[0].m_translation.x, 0.0001f);
+			Assert::AreEqual(1.0f, pose[0].m_translation.y, 0.0001f);
+			Assert::AreEqual(-0.5f, pose[0].m_translation.z, 0.0001f);
+			Assert::IsTrue(angleBetween(rotationZ(0.5f), pose[0].m_rotation) < 0.0002f);
+			Assert::AreEqual(1.0f, pose[0].m_scale.z);
+		}
+
+		TEST_METHOD(AnimationCompression_staysWithinToleranceOfADenseClip)
+		{
+			const Skeleton skeleton = makeChain(24);
+			const AnimationClip source = makeSampledClip(skeleton, 4.0f);
+
+			AnimationCompressionSettings settings;
+			settings.m_defaultTolerance.m_translation = 0.001f;
+			settings.m_defaultTolerance.m_rotation = 0.002f;
+			settings.m_defaultTolerance.m_scale = 0.001f;
+
+			// tighter at the root, its error moves every other joint
+			settings.m_jointTolerances.assign(skeleton.m_parents.size(), settings.m_defaultTolerance);
+			settings.m_jointTolerances[0].m_rotation = 0.0005f;
+
+			AnimationCompressor compressor;
+			AnimationCompressionReport report;
+			const CompressedClip clip = compressor.compress(source, skeleton, settings, report);
+
+			char reportStr[256];
+			sprintf_s(reportStr, "%llu of %llu keys, %zu bytes from %zu (%.1f:1), translation max %f mean %f, rotation max %f mean %f",
+				report.m_keptKeys, report.m_sourceKeys, report.m_compressedBytes, report.m_sourceBytes, report.compressionRatio(),
+				report.m_maxTranslationError, report.m_meanTranslationError, report.m_maxRotationError, report.m_meanRotationError);
+			Logger::WriteMessage(reportStr);
+
+			// the reduction works on the quantised keys, so both kinds of error are inside the tolerance. a little slack for
+			// the runtime's float maths
+			Assert::IsTrue(report.m_maxTranslationError <= 0.001f * 1.01f);
+			Assert::IsTrue(report.m_maxRotationError <= 0.002f * 1.01f);
+			Assert::IsTrue(report.m_maxScaleError <= 0.001f);
+			Assert::IsTrue(report.m_meanTranslationError <= report.m_maxTranslationError);
+			Assert::IsTrue(report.m_meanRotationError < 0.002f * 0.5f);
+			Assert::IsTrue(report.m_maxRotationError > 0.0f);
+
+			Assert::IsTrue(report.m_keptKeys * 5 < report.m_sourceKeys);
+			Assert::IsTrue(report.compressionRatio() > 10.0);
+			Assert::AreEqual(report.m_compressedBytes, clip.getSizeInBytes());
+
+			// the joints that hold still don't keep any keys at all
+			Assert::AreEqual(0u, clip.getKeyCount(CHANNEL_ROTATION, 20));
+			Assert::AreEqual(0u, clip.getKeyCount(CHANNEL_TRANSLATION, 5));
+			Assert::AreEqual(0u, clip.getKeyCount(CHANNEL_SCALE, 0));
+			Assert::IsTrue(clip.getKeyCount(CHANNEL_ROTATION, 0) > clip.getKeyCount(CHANNEL_ROTATION, 1) / 2);
+		}
+
+		TEST_METHOD(AnimationCompression_compressedClipPlaysLikeTheSource)
+		{
+			const Skeleton skeleton = makeChain(16);
+			const AnimationClip source = makeSampledClip(skeleton, 2.0f);
+
+			AnimationCompressor compressor;
+			AnimationCompressionReport report;
+			const CompressedClip clip = compressor.compress(source, skeleton, AnimationCompressionSettings(), report);
+
+			std::vector<AnimationInstance> instances(2);
+
+			for (size_t i = 0; i < instances.size(); ++i)
+			{
+				instances[i].m_skeleton = &skeleton;
+			}
+
+			instances[0].addLayer(&source, 1.0f, true);
+			instances[1].addLayer(&clip, 1.0f, true);
+
+			JobSystem jobSystem(2);
+			AnimationSystem animationSystem(jobSystem);
+			AnimationStats stats;
+
+			// past the end, so the loop wraps the compressed cursor back to the start too
+			for (UINT frame = 0; frame < 150; ++frame)
+			{
+				animationSystem.evaluate(instances, 1.0f / 60.0f, stats);
+
+				for (size_t j = 0; j < skeleton.m_parents.size(); ++j)
+				{
+					Assert::IsTrue(angleBetween(instances[0].m_localPose[j].m_rotation, instances[1].m_localPose[j].m_rotation) < 0.0005f);
+					Assert::AreEqual(instances[0].m_localPose[j].m_translation.x, instances[1].m_localPose[j].m_translation.x, 0.0005f);
+					Assert::AreEqual(instances[0].m_localPose[j].m_translation.y, instances[1].m_localPose[j].m_translation.y, 0.0005f);
+				}
+
+				// the end of the chain, where every joint's error has added up
+				Assert::AreEqual(instances[0].m_modelMatrices[15].m[3][0], instances[1].m_modelMatrices[15].m[3][0], 0.01f);
+				Assert::AreEqual(instances[0].m_modelMatrices[15].m[3][1], instances[1].m_modelMatrices[15].m[3][1], 0.01f);
+			}
+
+			Assert::IsTrue(instances[1].m_layers[0].m_time < 2.0f);
+		}
+
+		TEST_METHOD(AnimationCompression_clipRoundTripsThroughItsFileLayout)
+		{
+			const Skeleton skeleton = makeChain(8);
+			AnimationClip source = makeSampledClip(skeleton, 1.0f);
+			source.m_name = "sway";
+
+			AnimationCompressor compressor;
+			AnimationCompressionReport report;
+			const CompressedClip clip = compressor.compress(source, skeleton, AnimationCompressionSettings(), report);
+
+			const std::vector<UINT8> file = AnimationCompressor::writeClip(clip);
+
+			CompressedClip read;
+			Assert::IsTrue(AnimationCompressor::readClip(file.data(), file.size(), read));
+
+			Assert::AreEqual(std::string("sway"), read.m_name);
+			Assert::AreEqual(clip.m_duration, read.m_duration);
+			Assert::AreEqual(clip.getSizeInBytes(), read.getSizeInBytes());
+
+			for (UINT channel = 0; channel < CHANNEL_COUNT; ++channel)
+			{
+				Assert::IsTrue(clip.m_channels[channel].m_times == read.m_channels[channel].m_times);
+				Assert::IsTrue(clip.m_channels[channel].m_values == read.m_channels[channel].m_values);
+				Assert::IsTrue(clip.m_channels[channel].m_trackStart == read.m_channels[channel].m_trackStart);
+			}
+
+			// cut short anywhere, it is refused rather than read past the end
+			for (size_t size = 0; size < file.size(); size += 7)
+			{
+				Assert::IsFalse(AnimationCompressor::readClip(file.data(), size, read));
+			}
+		}
+	};
+}
@@ -0,0 +1,330 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/AnimationScheduler.h"
+
+#include <chrono>
+#include <cmath>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	DirectX::XMFLOAT4 rotationZ(const float angle)
+	{
+		return DirectX::XMFLOAT4(0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f));
+	}
+
+	// a root with four limbs of limbLength joints, breadth first like ApplicationCore builds them
+	Skeleton makeCreature(const UINT limbLength)
+	{
+		Skeleton skeleton;
+
+		JointTransform joint;
+		joint.m_translation = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		joint.m_rotation = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		joint.m_scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+		skeleton.m_parents.push_back(-1);
+		skeleton.m_names.push_back("root");
+		skeleton.m_bindPose.push_back(joint);
+
+		joint.m_translation = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+		for (UINT depth = 1; depth <= limbLength; ++depth)
+		{
+			for (UINT limb = 0; limb < 4; ++limb)
+			{
+				skeleton.m_parents.push_back(depth == 1 ? 0 : static_cast<int>(1 + (depth - 2) * 4 + limb));
+				skeleton.m_names.push_back("limb" + std::to_string(limb) + "_" + std::to_string(depth));
+				skeleton.m_bindPose.push_back(joint);
+			}
+		}
+
+		return skeleton;
+	}
+
+	// every joint bends about z over one second
+	AnimationClip makeBendClip(const Skeleton & skeleton)
+	{
+		std::vector<JointKeys> keys(skeleton.m_parents.size());
+
+		for (size_t j = 0; j < keys.size(); ++j)
+		{
+			for (UINT k = 0; k <= 10; ++k)
+			{
+				keys[j].m_rotationTimes.push_back(k * 0.1f);
+				keys[j].m_rotations.push_back(rotationZ(0.5f * k * 0.1f));
+			}
+		}
+
+		AnimationClip clip;
+		clip.build(keys, 1.0f);
+		return clip;
+	}
+
+	// every joint sways back and forth once a second, the same at both ends so it loops without a jump
+	AnimationClip makeSwayClip(const Skeleton & skeleton)
+	{
+		std::vector<JointKeys> keys(skeleton.m_parents.size());
+
+		for (size_t j = 0; j < keys.size(); ++j)
+		{
+			for (UINT k = 0; k <= 10; ++k)
+			{
+				keys[j].m_rotationTimes.push_back(k * 0.1f);
+				keys[j].m_rotations.push_back(rotationZ(0.5f * std::sin(k * 0.1f * 6.283185f)));
+			}
+		}
+
+		AnimationClip clip;
+		clip.build(keys, 1.0f);
+		return clip;
+	}
+
+	AnimationVisibility at(const float distance, const bool visible)
+	{
+		AnimationVisibility visibility;
+		visibility.m_distance = distance;
+		visibility.m_radius = 1.0f;
+		visibility.m_visible = visible;
+		return visibility;
+	}
+
+	// how far away a radius 1 character has to be to be this many pixels tall with the default viewport
+	float distanceForHeight(const float pixels)
+	{
+		return 2.0f * 600.0f / (2.0f * std::tan(0.785398f * 0.5f)) / pixels;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(AnimationSchedulerTests)
+	{
+	public:
+
+		TEST_METHOD(AnimationScheduler_levelsFollowScreenHeight)
+		{
+			JobSystem jobSystem(1);
+			AnimationScheduler scheduler(jobSystem);
+
+			Assert::AreEqual(300.0f, scheduler.projectedHeight(at(distanceForHeight(300.0f), true)), 0.01f);
+
+			Assert::AreEqual(0u, scheduler.selectLevel(at(distanceForHeight(300.0f), true), UINT_MAX));
+			Assert::AreEqual(1u, scheduler.selectLevel(at(distanceForHeight(100.0f), true), UINT_MAX));
+			Assert::AreEqual(2u, scheduler.selectLevel(at(distanceForHeight(30.0f), true), UINT_MAX));
+			Assert::AreEqual(3u, scheduler.selectLevel(at(distanceForHeight(5.0f), true), UINT_MAX));
+			Assert::AreEqual(0u, scheduler.selectLevel(at(0.5f, true), 3));
+
+			// just under a level's height it holds on to the finer level, well under it drops
+			Assert::AreEqual(0u, scheduler.selectLevel(at(distanceForHeight(140.0f), true), 0));
+			Assert::AreEqual(1u, scheduler.selectLevel(at(distanceForHeight(100.0f), true), 0));
+			Assert::AreEqual(1u, scheduler.selectLevel(at(distanceForHeight(140.0f), true), 1));
+			Assert::AreEqual(1u, scheduler.selectLevel(at(distanceForHeight(55.0f), true), 1));
+			Assert::AreEqual(3u, scheduler.selectLevel(at(distanceForHeight(5.0f), true), 1));
+		}
+
+		TEST_METHOD(AnimationScheduler_staggersUpdatesOverTheInterval)
+		{
+			Assert::IsTrue(AnimationScheduler::isUpdateFrame(5, 3, 1));
+			Assert::IsTrue(AnimationScheduler::isUpdateFrame(5, 3, 8));
+			Assert::IsFalse(AnimationScheduler::isUpdateFrame(6, 3, 8));
+			Assert::IsTrue(AnimationScheduler::isUpdateFrame(14, 2, 8));
+
+			const Skeleton skeleton = makeCreature(4);
+			const AnimationClip clip = makeBendClip(skeleton);
+
+			std::vector<AnimationInstance> instances(800);
+
+			for (size_t i = 0; i < instances.size(); ++i)
+			{
+				instances[i].m_skeleton = &skeleton;
+				instances[i].addLayer(&clip, 1.0f, true);
+			}
+
+			// all at the back, every eighth frame
+			const std::vector<AnimationVisibility> visibility(instances.size(), at(distanceForHeight(5.0f), true));
+
+			JobSystem jobSystem(4);
+			AnimationScheduler scheduler(jobSystem);
+			AnimationScheduleStats stats;
+
+			// the first frame evaluates everything, then an eighth of the crowd a frame
+			scheduler.update(instances, visibility, 1.0f / 60.0f, stats);
+			Assert::AreEqual(800u, stats.m_evaluated);
+
+			for (UINT frame = 0; frame < 16; ++frame)
+			{
+				scheduler.update(instances, visibility, 1.0f / 60.0f, stats);
+
+				Assert::AreEqual(100u, stats.m_evaluated);
+				Assert::AreEqual(700u, stats.m_held);
+				Assert::AreEqual(0u, stats.m_interpolated);
+			}
+
+			Assert::AreEqual(3u, scheduler.getLevel(0));
+		}
+
+		TEST_METHOD(AnimationScheduler_interpolatesTowardsThePoseAhead)
+		{
+			const Skeleton skeleton = makeCreature(2);
+			const AnimationClip clip = makeBendClip(skeleton);
+
+			// one level, every fourth frame and interpolated
+			AnimationLodLevel level;
+			level.m_minScreenHeight = 0.0f;
+			level.m_updateInterval = 4;
+			level.m_maxJointDepth = UINT_MAX;
+			level.m_interpolate = true;
+
+			JobSystem jobSystem(1);
+			AnimationScheduler scheduler(jobSystem);
+			scheduler.setLevels(std::vector<AnimationLodLevel>(1, level));
+
+			std::vector<AnimationInstance> instances(1);
+			instances[0].m_skeleton = &skeleton;
+			instances[0].addLayer(&clip, 1.0f, false);
+
+			AnimationInstance reference = instances[0];
+
+			const std::vector<AnimationVisibility> visibility(1, at(10.0f, true));
+			AnimationScheduleStats stats;
+			UINT interpolated = 0;
+
+			for (UINT frame = 0; frame < 40; ++frame)
+			{
+				scheduler.update(instances, visibility, 0.02f, stats);
+				AnimationSystem::evaluateInstance(reference, 0.02f);
+
+				interpolated += stats.m_interpolated;
+
+				// the bend is even over time, so blending two poses lands close to sampling in between
+				for (size_t j = 0; j < skeleton.m_parents.size(); ++j)
+				{
+					Assert::AreEqual(reference.m_localPose[j].m_rotation.z, instances[0].m_localPose[j].m_rotation.z, 1e-4f);
+				}
+
+				Assert::AreEqual(reference.m_modelMatrices[8].m[3][0], instances[0].m_modelMatrices[8].m[3][0], 1e-3f);
+				Assert::AreEqual(reference.m_modelMatrices[8].m[3][1], instances[0].m_modelMatrices[8].m[3][1], 1e-3f);
+			}
+
+			Assert::AreEqual(30u, interpolated);
+		}
+
+		TEST_METHOD(AnimationScheduler_skipsHiddenCharactersAndCutsJoints)
+		{
+			const Skeleton skeleton = makeCreature(4);
+			const AnimationClip clip = makeBendClip(skeleton);
+
+			Assert::AreEqual(1u, skeleton.countJointsToDepth(0));
+			Assert::AreEqual(9u, skeleton.countJointsToDepth(2));
+			Assert::AreEqual(17u, skeleton.countJointsToDepth(10));
+
+			JobSystem jobSystem(1);
+			AnimationScheduler scheduler(jobSystem);
+
+			std::vector<AnimationInstance> instances(1);
+			instances[0].m_skeleton = &skeleton;
+			instances[0].addLayer(&clip, 1.0f, true);
+
+			std::vector<AnimationVisibility> visibility(1, at(distanceForHeight(5.0f), false));
+			AnimationScheduleStats stats;
+
+			for (UINT frame = 0; frame < 10; ++frame)
+			{
+				scheduler.update(instances, visibility, 0.01f, stats);
+				Assert::AreEqual(1u, stats.m_culled);
+			}
+
+			// never evaluated, not even the time
+			Assert::IsTrue(instances[0].m_localPose.empty());
+			Assert::AreEqual(0.0f, instances[0].m_layers[0].m_time);
+
+			// back in view it catches up with all the time it was hidden for, down to depth 2 at the coarsest level
+			visibility[0].m_visible = true;
+			scheduler.update(instances, visibility, 0.01f, stats);
+
+			Assert::AreEqual(1u, stats.m_evaluated);
+			Assert::AreEqual(static_cast<UINT64>(9), stats.m_jointsSampled);
+			Assert::AreEqual(static_cast<UINT64>(17), stats.m_jointsAtFullRate);
+			Assert::AreEqual(0.11f, instances[0].m_layers[0].m_time, 1e-5f);
+
+			Assert::AreEqual(rotationZ(0.055f).z, instances[0].m_localPose[8].m_rotation.z, 1e-5f);
+			Assert::AreEqual(0.0f, instances[0].m_localPose[9].m_rotation.z);
+
+			// closer, everything is sampled again
+			visibility[0] = at(distanceForHeight(300.0f), true);
+			scheduler.update(instances, visibility, 0.01f, stats);
+
+			Assert::AreEqual(0u, scheduler.getLevel(0));
+			Assert::AreEqual(static_cast<UINT64>(17), stats.m_jointsSampled);
+			Assert::IsTrue(instances[0].m_localPose[16].m_rotation.z > 0.0f);
+		}
+
+		TEST_METHOD(AnimationScheduler_crowdSamplesAFractionOfTheJoints)
+		{
+			const Skeleton skeleton = makeCreature(10);
+			const AnimationClip clip = makeSwayClip(skeleton);
+
+			// a crowd spread from close up to far away, one in ten out of view
+			std::vector<AnimationInstance> instances(2000);
+			std::vector<AnimationVisibility> visibility(instances.size());
+
+			for (size_t i = 0; i < instances.size(); ++i)
+			{
+				instances[i].m_skeleton = &skeleton;
+				instances[i].addLayer(&clip, 1.0f, true);
+				instances[i].m_layers[0].m_time = (i % 100) * 0.01f;
+
+				visibility[i] = at(2.0f + (i % 200) * 0.5f, (i % 10) != 0);
+			}
+
+			std::vector<AnimationInstance> fullRate = instances;
+
+			JobSystem jobSystem(4);
+			AnimationScheduler scheduler(jobSystem);
+			AnimationSystem animationSystem(jobSystem);
+
+			AnimationScheduleStats stats;
+			AnimationStats fullStats;
+			UINT64 sampled = 0;
+			UINT64 atFullRate = 0;
+			double scheduledSeconds = 0.0;
+			double fullSeconds = 0.0;
+
+			for (UINT frame = 0; frame < 64; ++frame)
+			{
+				scheduler.update(instances, visibility, 1.0f / 60.0f, stats);
+				animationSystem.evaluate(fullRate, 1.0f / 60.0f, fullStats);
+
+				// the first frame evaluates everyone, it isn't what a running crowd costs
+				if (frame > 0)
+				{
+					sampled += stats.m_jointsSampled;
+					atFullRate += stats.m_jointsAtFullRate;
+					scheduledSeconds += stats.m_seconds;
+					fullSeconds += fullStats.m_seconds;
+				}
+			}
+
+			char statsStr[256];
+			sprintf_s(statsStr, "%u characters: %.1f%% of the joints sampled, %.3f ms a frame scheduled against %.3f ms at full rate on %u threads",
+				stats.m_instances, 100.0 * sampled / atFullRate, scheduledSeconds * 1000.0 / 63.0, fullSeconds * 1000.0 / 63.0, stats.m_threadCount);
+			Logger::WriteMessage(statsStr);
+
+			Assert::IsTrue(sampled * 4 < atFullRate);
+			Assert::AreEqual(2000u, stats.m_evaluated + stats.m_interpolated + stats.m_held + stats.m_culled);
+			Assert::AreEqual(200u, stats.m_culled);
+
+			// everything in view moved on as far as it would at full rate, give or take the interpolation
+			for (size_t i = 1; i < instances.size(); i += 37)
+			{
+				if (visibility[i].m_visible && scheduler.getLevel(i) < 3)
+				{
+					Assert::AreEqual(fullRate[i].m_localPose[1].m_rotation.z, instances[i].m_localPose[1].m_rotation.z, 0.01f);
+				}
+			}
+		}
+	};
+}
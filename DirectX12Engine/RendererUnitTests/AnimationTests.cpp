@@ -0,0 +1,271 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/Animation.h"
+
+#include <cmath>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	DirectX::XMFLOAT4 rotationZ(const float angle)
+	{
+		return DirectX::XMFLOAT4(0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f));
+	}
+
+	JointTransform makeJoint(const float x, const float y, const float z)
+	{
+		JointTransform joint;
+		joint.m_translation = DirectX::XMFLOAT3(x, y, z);
+		joint.m_rotation = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		joint.m_scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+		return joint;
+	}
+
+	// a chain of joints one unit apart along x
+	Skeleton makeChain(const UINT jointCount)
+	{
+		Skeleton skeleton;
+
+		for (UINT j = 0; j < jointCount; ++j)
+		{
+			skeleton.m_parents.push_back(static_cast<int>(j) - 1);
+			skeleton.m_names.push_back("joint" + std::to_string(j));
+			skeleton.m_bindPose.push_back(makeJoint(j == 0 ? 0.0f : 1.0f, 0.0f, 0.0f));
+		}
+
+		return skeleton;
+	}
+
+	// every joint bends about z over one second, the root also moves along y
+	AnimationClip makeBendClip(const Skeleton & skeleton, const float maxAngle)
+	{
+		std::vector<JointKeys> keys(skeleton.m_parents.size());
+
+		for (size_t j = 0; j < keys.size(); ++j)
+		{
+			for (UINT k = 0; k <= 10; ++k)
+			{
+				keys[j].m_rotationTimes.push_back(k * 0.1f);
+				keys[j].m_rotations.push_back(rotationZ(maxAngle * k * 0.1f));
+			}
+		}
+
+		keys[0].m_translationTimes.push_back(0.0f);
+		keys[0].m_translations.push_back(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+		keys[0].m_translationTimes.push_back(1.0f);
+		keys[0].m_translations.push_back(DirectX::XMFLOAT3(0.0f, 2.0f, 0.0f));
+
+		AnimationClip clip;
+		clip.build(keys, 1.0f);
+		return clip;
+	}
+
+	void assertNear(const DirectX::XMFLOAT4X4 & a, const DirectX::XMFLOAT4X4 & b, const float tolerance)
+	{
+		for (UINT r = 0; r < 4; ++r)
+		{
+			for (UINT c = 0; c < 4; ++c)
+			{
+				Assert::AreEqual(a.m[r][c], b.m[r][c], tolerance);
+			}
+		}
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(AnimationTests)
+	{
+	public:
+
+		TEST_METHOD(Animation_buildLaysTracksOutAsStreams)
+		{
+			const Skeleton skeleton = makeChain(3);
+			const AnimationClip clip = makeBendClip(skeleton, 1.0f);
+
+			Assert::AreEqual(3u, clip.getTrackCount());
+			Assert::AreEqual(2u, clip.getKeyCount(CHANNEL_TRANSLATION, 0));
+			Assert::AreEqual(0u, clip.getKeyCount(CHANNEL_TRANSLATION, 1));
+			Assert::AreEqual(11u, clip.getKeyCount(CHANNEL_ROTATION, 2));
+			Assert::AreEqual(0u, clip.getKeyCount(CHANNEL_SCALE, 0));
+
+			// the tracks follow each other in one stream, every component in its own array
+			const KeyStream & rotations = clip.m_channels[CHANNEL_ROTATION];
+			Assert::AreEqual(static_cast<size_t>(33), rotations.m_times.size());
+			Assert::AreEqual(static_cast<size_t>(33), rotations.m_values[3].size());
+			Assert::AreEqual(11u, rotations.m_trackStart[1]);
+			Assert::AreEqual(0.1f, rotations.m_times[12], 1e-6f);
+			Assert::IsTrue(clip.m_channels[CHANNEL_TRANSLATION].m_values[3].empty());
+		}
+
+		TEST_METHOD(Animation_sampleInterpolatesAndFallsBackToTheBindPose)
+		{
+			const Skeleton skeleton = makeChain(2);
+			const AnimationClip clip = makeBendClip(skeleton, 1.0f);
+
+			AnimationCursor cursor;
+			cursor.reset(clip);
+			std::vector<JointTransform> pose(2);
+
+			sampleClip(clip, skeleton, 0.25f, cursor, pose);
+
+			Assert::AreEqual(0.5f, pose[0].m_translation.y, 1e-5f);
+			// halfway between the 0.2 and 0.3 keys, close to the 0.25 rotation
+			Assert::AreEqual(rotationZ(0.25f).z, pose[0].m_rotation.z, 1e-3f);
+			Assert::AreEqual(rotationZ(0.25f).w, pose[0].m_rotation.w, 1e-3f);
+			// no translation keys, so the bind pose
+			Assert::AreEqual(1.0f, pose[1].m_translation.x);
+			Assert::AreEqual(1.0f, pose[1].m_scale.y);
+
+			// held past the end
+			sampleClip(clip, skeleton, 5.0f, cursor, pose);
+			Assert::AreEqual(2.0f, pose[0].m_translation.y, 1e-5f);
+			Assert::AreEqual(rotationZ(1.0f).z, pose[1].m_rotation.z, 1e-5f);
+		}
+
+		TEST_METHOD(Animation_cursorMatchesAFreshSampleForwardsAndBackwards)
+		{
+			const Skeleton skeleton = makeChain(4);
+			const AnimationClip clip = makeBendClip(skeleton, 2.0f);
+
+			AnimationCursor cursor;
+			cursor.reset(clip);
+			std::vector<JointTransform> stepped(4);
+			std::vector<JointTransform> fresh(4);
+
+			// forwards in small steps, then wrapping back to the start like a loop does
+			const float times[] = { 0.0f, 0.01f, 0.05f, 0.1f, 0.33f, 0.34f, 0.7f, 0.99f, 1.0f, 0.02f, 0.5f };
+
+			for (size_t t = 0; t < sizeof(times) / sizeof(times[0]); ++t)
+			{
+				sampleClip(clip, skeleton, times[t], cursor, stepped);
+
+				AnimationCursor freshCursor;
+				freshCursor.reset(clip);
+				sampleClip(clip, skeleton, times[t], freshCursor, fresh);
+
+				for (size_t j = 0; j < stepped.size(); ++j)
+				{
+					Assert::AreEqual(fresh[j].m_rotation.z, stepped[j].m_rotation.z);
+					Assert::AreEqual(fresh[j].m_rotation.w, stepped[j].m_rotation.w);
+					Assert::AreEqual(fresh[j].m_translation.y, stepped[j].m_translation.y);
+				}
+			}
+		}
+
+		TEST_METHOD(Animation_blendTakesTheShorterArc)
+		{
+			std::vector<JointTransform> a(1, makeJoint(0.0f, 0.0f, 0.0f));
+			std::vector<JointTransform> b(1, makeJoint(2.0f, 0.0f, 0.0f));
+
+			// 90 degrees, with the quaternion on the far side of the hypersphere
+			const DirectX::XMFLOAT4 quarter = rotationZ(DirectX::XM_PIDIV2);
+			b[0].m_rotation = DirectX::XMFLOAT4(-quarter.x, -quarter.y, -quarter.z, -quarter.w);
+
+			std::vector<JointTransform> out;
+
+			blendPoses(a, b, 0.0f, out);
+			Assert::AreEqual(0.0f, out[0].m_translation.x);
+			Assert::AreEqual(1.0f, out[0].m_rotation.w, 1e-6f);
+
+			blendPoses(a, b, 0.5f, out);
+			Assert::AreEqual(1.0f, out[0].m_translation.x, 1e-6f);
+			// 45 degrees, not 135
+			Assert::AreEqual(rotationZ(DirectX::XM_PIDIV4).z, out[0].m_rotation.z, 1e-5f);
+			Assert::AreEqual(rotationZ(DirectX::XM_PIDIV4).w, out[0].m_rotation.w, 1e-5f);
+		}
+
+		TEST_METHOD(Animation_modelMatricesFollowTheChain)
+		{
+			const Skeleton skeleton = makeChain(3);
+			std::vector<JointTransform> pose = skeleton.m_bindPose;
+
+			// the middle joint turns 90 degrees about z, so the end of the chain points up y
+			pose[1].m_rotation = rotationZ(DirectX::XM_PIDIV2);
+
+			std::vector<DirectX::XMFLOAT4X4> model;
+			localToModel(skeleton, pose, model);
+
+			Assert::AreEqual(1.0f, model[1].m[3][0], 1e-6f);
+			Assert::AreEqual(0.0f, model[1].m[3][1], 1e-6f);
+			Assert::AreEqual(1.0f, model[2].m[3][0], 1e-6f);
+			Assert::AreEqual(1.0f, model[2].m[3][1], 1e-6f);
+			// x axis of the last joint now along y
+			Assert::AreEqual(1.0f, model[2].m[0][1], 1e-6f);
+
+			// bind pose model matrices as the inverse bind pose give an identity palette
+			std::vector<DirectX::XMFLOAT4X4> bindModel;
+			localToModel(skeleton, skeleton.m_bindPose, bindModel);
+
+			std::vector<DirectX::XMFLOAT4X4> inverseBindPose(3, bindModel[0]);
+
+			for (UINT j = 0; j < 3; ++j)
+			{
+				inverseBindPose[j].m[3][0] = -bindModel[j].m[3][0];
+			}
+
+			DirectX::XMFLOAT4X4 identity = bindModel[0];
+			std::vector<DirectX::XMFLOAT4X4> palette;
+			computeSkinPalette(bindModel, { 0, 1, 2 }, inverseBindPose, identity, palette);
+
+			for (UINT b = 0; b < 3; ++b)
+			{
+				assertNear(identity, palette[b], 1e-6f);
+			}
+		}
+
+		TEST_METHOD(Animation_evaluatesSkeletonsInParallelAndBlendsLayers)
+		{
+			const Skeleton skeleton = makeChain(32);
+			const AnimationClip bend = makeBendClip(skeleton, 1.0f);
+			const AnimationClip bendBack = makeBendClip(skeleton, -1.0f);
+
+			std::vector<AnimationInstance> instances(500);
+
+			for (size_t i = 0; i < instances.size(); ++i)
+			{
+				instances[i].m_skeleton = &skeleton;
+				instances[i].addLayer(&bend, 1.0f, true);
+				instances[i].addLayer(&bendBack, (i % 2) == 0 ? 1.0f : 0.0f, true);
+				instances[i].m_layers[0].m_time = i * 0.001f;
+				instances[i].m_layers[1].m_time = i * 0.001f;
+			}
+
+			std::vector<AnimationInstance> serial = instances;
+
+			JobSystem jobSystem(4);
+			AnimationSystem animationSystem(jobSystem);
+			AnimationStats stats;
+
+			for (UINT frame = 0; frame < 90; ++frame)
+			{
+				animationSystem.evaluate(instances, 1.0f / 60.0f, stats);
+
+				for (size_t i = 0; i < serial.size(); ++i)
+				{
+					AnimationSystem::evaluateInstance(serial[i], 1.0f / 60.0f);
+				}
+			}
+
+			for (size_t i = 0; i < instances.size(); ++i)
+			{
+				assertNear(serial[i].m_modelMatrices[31], instances[i].m_modelMatrices[31], 0.0f);
+
+				// looped past the one second end
+				Assert::IsTrue(instances[i].m_layers[0].m_time < 1.0f);
+			}
+
+			// bending both ways at once cancels out, only the root's movement is left
+			Assert::AreEqual(0.0f, instances[0].m_localPose[5].m_rotation.z, 1e-5f);
+			Assert::AreEqual(31.0f, instances[0].m_modelMatrices[31].m[3][0], 1e-4f);
+			Assert::IsTrue(instances[1].m_localPose[5].m_rotation.z > 0.0f);
+
+			Assert::AreEqual(500u, stats.m_skeletons);
+			Assert::AreEqual(static_cast<UINT64>(500 * 32), stats.m_joints);
+			Assert::AreEqual(5u, stats.m_threadCount);
+			Assert::IsTrue(stats.skeletonsPerMillisecond() > 0.0);
+		}
+	};
+}
@@ -0,0 +1,388 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/AssetArchive.h"
+#include "../DirectX12Engine/LzCompression.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// text like data, the same few words over and over, compresses well
+	std::vector<UINT8> makeText(const size_t size, const UINT seed)
+	{
+		static const char * const words[] = { "v ", "vn ", "f ", "0.5 ", "-1.0 ", "usemtl ", "1/2/3 ", "\n", "newmtl ", "Kd " };
+
+		std::mt19937 random(seed);
+		std::vector<UINT8> data;
+
+		while (data.size() < size)
+		{
+			const char * word = words[random() % 10];
+			data.insert(data.end(), word, word + strlen(word));
+		}
+
+		data.resize(size);
+		return data;
+	}
+
+	std::vector<UINT8> makeNoise(const size_t size, const UINT seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<UINT8> data(size);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			data[i] = static_cast<UINT8>(random());
+		}
+
+		return data;
+	}
+
+	void assertRoundTrips(const std::vector<UINT8> & data)
+	{
+		std::vector<UINT8> compressed(lzCompressBound(data.size()));
+		const size_t size = lzCompress(data.data(), data.size(), compressed.data(), compressed.size());
+		Assert::IsTrue(size > 0);
+
+		std::vector<UINT8> decompressed(data.size() + 1, 0xcd);
+		Assert::IsTrue(lzDecompress(compressed.data(), size, decompressed.data(), data.size()));
+		Assert::IsTrue(data.empty() || memcmp(data.data(), decompressed.data(), data.size()) == 0);
+
+		// nothing written past the end
+		Assert::AreEqual(static_cast<UINT8>(0xcd), decompressed[data.size()]);
+	}
+
+	std::shared_ptr<std::vector<UINT8>> pack(AssetArchiveWriter & writer)
+	{
+		ArchivePackStats stats;
+		return std::make_shared<std::vector<UINT8>>(writer.write(stats));
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(AssetArchiveTests)
+	{
+	public:
+
+		TEST_METHOD(Lz_roundTripsAnyInput)
+		{
+			assertRoundTrips(std::vector<UINT8>());
+			assertRoundTrips(std::vector<UINT8>(1, 7));
+			assertRoundTrips(std::vector<UINT8>(9, 7));
+			assertRoundTrips(std::vector<UINT8>(100000, 0));	// one long overlapping match
+			assertRoundTrips(makeText(200000, 1));
+			assertRoundTrips(makeNoise(70000, 2));
+
+			// a repeat further back than the window reaches
+			std::vector<UINT8> far = makeNoise(100000, 3);
+			far.insert(far.end(), far.begin(), far.begin() + 1000);
+			assertRoundTrips(far);
+
+			const std::vector<UINT8> text = makeText(65536, 4);
+			std::vector<UINT8> compressed(lzCompressBound(text.size()));
+			const size_t size = lzCompress(text.data(), text.size(), compressed.data(), compressed.size());
+			Assert::IsTrue(size * 2 < text.size());
+
+			// too small a buffer fails instead of overrunning
+			Assert::AreEqual(static_cast<size_t>(0), lzCompress(text.data(), text.size(), compressed.data(), size / 2));
+		}
+
+		TEST_METHOD(Lz_rejectsDamagedStreams)
+		{
+			const std::vector<UINT8> text = makeText(10000, 5);
+			std::vector<UINT8> compressed(lzCompressBound(text.size()));
+			compressed.resize(lzCompress(text.data(), text.size(), compressed.data(), compressed.size()));
+
+			std::vector<UINT8> out(text.size());
+
+			// cut short, or asked for the wrong size
+			Assert::IsFalse(lzDecompress(compressed.data(), compressed.size() - 3, out.data(), out.size()));
+			Assert::IsFalse(lzDecompress(compressed.data(), compressed.size(), out.data(), out.size() - 1));
+
+			// garbage never reads or writes outside the buffers, whatever it decodes to
+			std::mt19937 random(6);
+
+			for (UINT trial = 0; trial < 200; ++trial)
+			{
+				std::vector<UINT8> damaged(compressed);
+				damaged[random() % damaged.size()] = static_cast<UINT8>(random());
+				lzDecompress(damaged.data(), damaged.size(), out.data(), out.size());
+			}
+
+			// a match reaching back before the start
+			const UINT8 badOffset[] = { 0x10, 'a', 0x05, 0x00 };
+			Assert::IsFalse(lzDecompress(badOffset, sizeof(badOffset), out.data(), 5));
+		}
+
+		TEST_METHOD(AssetArchive_findsAndReadsEntries)
+		{
+			JobSystem jobSystem(2);
+			AssetArchiveWriter writer(jobSystem);
+			writer.setBlockSize(4096);
+
+			const std::vector<UINT8> text = makeText(20000, 7);
+			const std::vector<UINT8> noise = makeNoise(5000, 8);
+
+			writer.add("Models\\TestCube.obj", std::vector<UINT8>(text), true);
+			writer.add("textures/noise.bin", std::vector<UINT8>(noise), true);
+			writer.add("DefaultShader.hlsl", std::vector<UINT8>(text.begin(), text.begin() + 3000), false);
+			writer.add("empty.txt", std::vector<UINT8>(), true);
+			// replaces the first
+			writer.add("models/testcube.obj", std::vector<UINT8>(text), true);
+
+			ArchivePackStats stats;
+			const std::shared_ptr<std::vector<UINT8>> data = std::make_shared<std::vector<UINT8>>(writer.write(stats));
+
+			Assert::AreEqual(4u, stats.m_entries);
+			Assert::AreEqual(static_cast<UINT64>(5 + 2), stats.m_blocks);
+			Assert::IsTrue(stats.compressionRatio() > 1.5);
+
+			AssetArchive archive;
+			Assert::IsTrue(archive.open(data->data(), data->size(), data));
+			Assert::AreEqual(4u, archive.getEntryCount());
+
+			const UINT cube = archive.find("./models/TESTCUBE.obj");
+			const UINT shader = archive.find("defaultshader.hlsl");
+			const UINT noiseEntry = archive.find("textures\\noise.bin");
+
+			Assert::AreNotEqual(UINT_MAX, cube);
+			Assert::AreEqual(UINT_MAX, archive.find("models/testcube.mtl"));
+			Assert::AreEqual(std::string("models/testcube.obj"), archive.getName(cube));
+
+			// every entry starts on its own alignment boundary
+			for (UINT e = 0; e < archive.getEntryCount(); ++e)
+			{
+				Assert::AreEqual(static_cast<UINT64>(0), archive.getEntry(e).m_offset % c_archiveAlignment);
+			}
+
+			// compressed entries come back through their blocks, the noise ones stored raw
+			std::vector<UINT8> out(text.size());
+			Assert::IsTrue(archive.isCompressed(cube));
+			Assert::IsTrue(archive.getEntry(cube).m_storedSize < text.size() / 2);
+			Assert::IsTrue(archive.read(cube, out.data()));
+			Assert::IsTrue(out == text);
+
+			out.resize(noise.size());
+			Assert::AreEqual(static_cast<UINT64>(noise.size()), archive.getEntry(noiseEntry).m_storedSize);
+			Assert::IsTrue(archive.read(noiseEntry, out.data()));
+			Assert::IsTrue(out == noise);
+
+			// uncompressed entries are the archive's own bytes
+			AssetView view;
+			Assert::IsFalse(archive.getView(cube, view));
+			Assert::IsTrue(archive.getView(shader, view));
+			Assert::IsTrue(view.m_data == data->data() + archive.getEntry(shader).m_offset);
+			Assert::AreEqual(static_cast<size_t>(3000), view.m_size);
+			Assert::IsTrue(memcmp(view.m_data, text.data(), 3000) == 0);
+
+			Assert::AreEqual(static_cast<UINT64>(0), archive.getEntry(archive.find("empty.txt")).m_size);
+		}
+
+		TEST_METHOD(AssetArchive_rejectsDamagedArchives)
+		{
+			JobSystem jobSystem(1);
+			AssetArchiveWriter writer(jobSystem);
+			writer.setBlockSize(4096);
+			writer.add("a.txt", makeText(10000, 9), true);
+			writer.add("b.txt", makeText(100, 10), false);
+
+			const std::shared_ptr<std::vector<UINT8>> data = pack(writer);
+
+			AssetArchive archive;
+			Assert::IsTrue(archive.open(data->data(), data->size(), data));
+
+			// cut off before the end of the table of contents
+			Assert::IsFalse(archive.open(data->data(), data->size() - 1, data));
+			Assert::IsFalse(archive.open(data->data(), 16, data));
+			Assert::AreEqual(0u, archive.getEntryCount());
+
+			ArchiveHeader header;
+			memcpy(&header, data->data(), sizeof(header));
+
+			// a block size that doesn't add up to the entry
+			std::vector<UINT8> damaged(*data);
+			UINT32 blockSize;
+			const size_t firstBlock = static_cast<size_t>(header.m_tocOffset) + sizeof(ArchiveEntry) * header.m_entryCount;
+			memcpy(&blockSize, damaged.data() + firstBlock, sizeof(blockSize));
+			blockSize += 1;
+			memcpy(damaged.data() + firstBlock, &blockSize, sizeof(blockSize));
+			Assert::IsFalse(archive.open(damaged.data(), damaged.size(), nullptr));
+
+			// an entry pointing past its data
+			damaged = *data;
+			ArchiveEntry entry;
+			memcpy(&entry, damaged.data() + header.m_tocOffset, sizeof(entry));
+			entry.m_offset = header.m_tocOffset - 10;
+			memcpy(damaged.data() + header.m_tocOffset, &entry, sizeof(entry));
+			Assert::IsFalse(archive.open(damaged.data(), damaged.size(), nullptr));
+
+			damaged = *data;
+			damaged[0] = 'X';
+			Assert::IsFalse(archive.open(damaged.data(), damaged.size(), nullptr));
+		}
+
+		TEST_METHOD(AssetArchive_readsBatchesAndMounts)
+		{
+			JobSystem jobSystem(4);
+			AssetArchiveWriter writer(jobSystem);
+
+			std::vector<std::vector<UINT8>> contents;
+
+			for (UINT i = 0; i < 12; ++i)
+			{
+				contents.push_back(i % 3 == 2 ? makeNoise(10000 + i * 30000, i) : makeText(10000 + i * 30000, i));
+				writer.add("asset" + std::to_string(i) + ".bin", std::vector<UINT8>(contents.back()), i % 4 != 3);
+			}
+
+			const std::shared_ptr<std::vector<UINT8>> data = pack(writer);
+
+			AssetArchive archive;
+			Assert::IsTrue(archive.open(data->data(), data->size(), data));
+
+			std::vector<std::vector<UINT8>> out(contents.size());
+			std::vector<ArchiveReadRequest> requests(contents.size());
+
+			for (UINT i = 0; i < contents.size(); ++i)
+			{
+				out[i].resize(contents[i].size());
+				requests[i].m_entry = archive.find("asset" + std::to_string(i) + ".bin");
+				requests[i].m_destination = out[i].data();
+				requests[i].m_succeeded = false;
+			}
+
+			ArchiveReadStats stats;
+			Assert::IsTrue(archive.readBatch(requests, jobSystem, stats));
+
+			for (size_t i = 0; i < contents.size(); ++i)
+			{
+				Assert::IsTrue(requests[i].m_succeeded);
+				Assert::IsTrue(out[i] == contents[i]);
+			}
+
+			Assert::AreEqual(12u, stats.m_entries);
+			Assert::AreEqual(5u, stats.m_threadCount);
+
+			// the same batch from a job, waited on through the callback
+			for (size_t i = 0; i < out.size(); ++i)
+			{
+				std::fill(out[i].begin(), out[i].end(), static_cast<UINT8>(0));
+			}
+
+			std::mutex mutex;
+			std::condition_variable done;
+			bool completed = false;
+			bool succeeded = false;
+
+			archive.readBatchAsync(requests, jobSystem, [&](std::vector<ArchiveReadRequest> & finished, const ArchiveReadStats &)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				succeeded = finished.size() == contents.size() && finished[5].m_succeeded;
+				completed = true;
+				done.notify_one();
+			});
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				done.wait(lock, [&completed]() { return completed; });
+			}
+
+			Assert::IsTrue(succeeded);
+			Assert::IsTrue(out[7] == contents[7]);
+
+			// and served through the file system, by the same paths
+			AssetFileSystem fileSystem;
+			Assert::IsTrue(archive.mountInto(fileSystem, jobSystem, stats));
+
+			for (size_t i = 0; i < contents.size(); ++i)
+			{
+				AssetView view;
+				Assert::IsTrue(fileSystem.open("Asset" + std::to_string(i) + ".bin", view));
+				Assert::AreEqual(contents[i].size(), view.m_size);
+				Assert::IsTrue(memcmp(view.m_data, contents[i].data(), view.m_size) == 0);
+			}
+
+			Assert::AreEqual(0u, fileSystem.getStats().m_filesMapped);
+		}
+
+		TEST_METHOD(AssetArchive_lookupAndDecompressThroughput)
+		{
+			using namespace std::chrono;
+
+			JobSystem jobSystem(4);
+			AssetArchiveWriter writer(jobSystem);
+
+			// a few thousand small files and a handful of large ones
+			for (UINT i = 0; i < 4000; ++i)
+			{
+				writer.add("small/file" + std::to_string(i) + ".txt", makeText(500 + (i % 50) * 40, i), true);
+			}
+
+			for (UINT i = 0; i < 4; ++i)
+			{
+				writer.add("large/file" + std::to_string(i) + ".bin", makeText(8 * 1024 * 1024, 10000 + i), true);
+			}
+
+			ArchivePackStats packStats;
+			const std::shared_ptr<std::vector<UINT8>> data = std::make_shared<std::vector<UINT8>>(writer.write(packStats));
+
+			const steady_clock::time_point openStart = steady_clock::now();
+
+			AssetArchive archive;
+			Assert::IsTrue(archive.open(data->data(), data->size(), data));
+
+			const steady_clock::time_point lookupStart = steady_clock::now();
+
+			UINT found = 0;
+
+			for (UINT i = 0; i < 4000; ++i)
+			{
+				found += archive.find("small/file" + std::to_string(i) + ".txt") != UINT_MAX ? 1 : 0;
+			}
+
+			const steady_clock::time_point lookupEnd = steady_clock::now();
+
+			Assert::AreEqual(4000u, found);
+
+			// the large entries on one thread, then as one batch over every thread
+			std::vector<std::vector<UINT8>> out(4, std::vector<UINT8>(8 * 1024 * 1024));
+			std::vector<ArchiveReadRequest> requests(4);
+
+			const steady_clock::time_point serialStart = steady_clock::now();
+
+			for (UINT i = 0; i < 4; ++i)
+			{
+				requests[i].m_entry = archive.find("large/file" + std::to_string(i) + ".bin");
+				requests[i].m_destination = out[i].data();
+				requests[i].m_succeeded = false;
+
+				Assert::IsTrue(archive.read(requests[i].m_entry, out[i].data()));
+			}
+
+			const double serialSeconds = duration_cast<duration<double>>(steady_clock::now() - serialStart).count();
+
+			ArchiveReadStats readStats;
+			Assert::IsTrue(archive.readBatch(requests, jobSystem, readStats));
+
+			char statsStr[256];
+			sprintf_s(statsStr, "packed %u entries %.2fx in %.1f ms, open %.3f ms, %.0f lookups/ms",
+				packStats.m_entries, packStats.compressionRatio(), packStats.m_seconds * 1000.0,
+				duration_cast<duration<double>>(lookupStart - openStart).count() * 1000.0,
+				4000.0 / (duration_cast<duration<double>>(lookupEnd - lookupStart).count() * 1000.0));
+			Logger::WriteMessage(statsStr);
+
+			sprintf_s(statsStr, "decompress %.0f MB/s on one thread, %.0f MB/s batched on %u threads",
+				32.0 / serialSeconds, readStats.megabytesPerSecond(), readStats.m_threadCount);
+			Logger::WriteMessage(statsStr);
+
+			Assert::IsTrue(out[3] == makeText(8 * 1024 * 1024, 10003));
+		}
+	};
+}
@@ -0,0 +1,453 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/AssetBuilder.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	void writeText(const std::string & path, const std::string & contents)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(contents.data(), contents.size());
+	}
+
+	std::string readText(const std::string & path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::stringstream contents;
+		contents << file.rdbuf();
+		return contents.str();
+	}
+
+	bool exists(const std::string & path)
+	{
+		return std::ifstream(path).good();
+	}
+
+	FILETIME getWriteTime(const std::string & path)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes);
+		return attributes.ftLastWriteTime;
+	}
+
+	void setWriteTime(const std::string & path, const FILETIME & writeTime)
+	{
+		HANDLE file = CreateFileA(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		SetFileTime(file, nullptr, nullptr, &writeTime);
+		CloseHandle(file);
+	}
+
+	// writes its inputs one after another
+	BuildStep makeConcatStep(const std::string & output, const std::vector<std::string> & inputs, std::atomic<UINT> & builds)
+	{
+		BuildStep concat;
+		concat.m_output = output;
+		concat.m_inputs = inputs;
+		concat.m_toolVersion = 1;
+		concat.m_build = [&builds](const BuildStep & step, std::vector<std::string> &)
+		{
+			++builds;
+			std::string contents;
+
+			for (size_t i = 0; i < step.m_inputs.size(); ++i)
+			{
+				if (!exists(step.m_inputs[i]))
+				{
+					return false;
+				}
+
+				contents += readText(step.m_inputs[i]);
+			}
+
+			writeText(step.m_output, contents + step.m_settings);
+			return true;
+		};
+
+		return concat;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(AssetBuilderTests)
+	{
+	public:
+
+		TEST_METHOD(AssetBuilder_rebuildsOnlyStaleOutputs)
+		{
+			const char * sources[] = { "AssetBuilderTests_a.txt", "AssetBuilderTests_b.txt", "AssetBuilderTests_c.txt" };
+			writeText(sources[0], "a");
+			writeText(sources[1], "b");
+			writeText(sources[2], "c");
+
+			JobSystem jobSystem(2);
+			AssetBuilder builder(jobSystem);
+			std::atomic<UINT> builds(0);
+
+			// ab and c first, then the pack that needs both. added in an order that isn't the build order
+			Assert::IsTrue(builder.addStep(makeConcatStep("AssetBuilderTests_pack.txt", { "AssetBuilderTests_ab.txt", "AssetBuilderTests_c.out" }, builds)));
+			Assert::IsTrue(builder.addStep(makeConcatStep("AssetBuilderTests_ab.txt", { sources[0], sources[1] }, builds)));
+			Assert::IsTrue(builder.addStep(makeConcatStep("AssetBuilderTests_c.out", { sources[2] }, builds)));
+			Assert::IsFalse(builder.addStep(makeConcatStep("assetbuildertests_AB.txt", { sources[2] }, builds)));
+
+			AssetBuildStats stats;
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(3u, stats.m_built);
+			Assert::AreEqual(3u, builds.load());
+			Assert::AreEqual(std::string("abc"), readText("AssetBuilderTests_pack.txt"));
+
+			const BuildRecord * record = builder.getRecord("AssetBuilderTests_ab.txt");
+			Assert::IsNotNull(record);
+			Assert::AreEqual(static_cast<size_t>(2), record->m_inputs.size());
+			Assert::AreEqual(static_cast<UINT64>(2), record->m_output.m_size);
+
+			// nothing changed, nothing runs. anything written in the tick its record was taken is hashed once
+			builds = 0;
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(3u, stats.m_upToDate);
+			Assert::AreEqual(0u, builds.load());
+
+			// and after that nothing is hashed
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(3u, stats.m_upToDate);
+			Assert::AreEqual(0u, builds.load());
+			Assert::AreEqual(static_cast<UINT64>(0), stats.m_filesHashed);
+
+			// only c and what's made from it
+			writeText(sources[2], "cc");
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(2u, stats.m_built);
+			Assert::AreEqual(1u, stats.m_upToDate);
+			Assert::AreEqual(std::string("abcc"), readText("AssetBuilderTests_pack.txt"));
+
+			// saved again with the same contents is hashed, and then left alone
+			builds = 0;
+			writeText(sources[0], "a");
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(0u, builds.load());
+			Assert::AreEqual(3u, stats.m_upToDate);
+
+			// an output deleted from under it is made again
+			std::remove("AssetBuilderTests_ab.txt");
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(1u, stats.m_built);
+			Assert::AreEqual(std::string("ab"), readText("AssetBuilderTests_ab.txt"));
+
+			const char * outputs[] = { "AssetBuilderTests_ab.txt", "AssetBuilderTests_c.out", "AssetBuilderTests_pack.txt" };
+
+			for (size_t i = 0; i < 3; ++i)
+			{
+				std::remove(sources[i]);
+				std::remove(outputs[i]);
+			}
+		}
+
+		TEST_METHOD(AssetBuilder_hashesFilesStampedAfterTheirRecord)
+		{
+			const std::string source = "AssetBuilderTests_racy.txt";
+			writeText(source, "old");
+
+			// stamped an hour ahead of the clock, the way a second write in the same tick as the record looks
+			FILETIME stamp = getWriteTime(source);
+			const UINT64 ahead = ((static_cast<UINT64>(stamp.dwHighDateTime) << 32) | stamp.dwLowDateTime) + 36000000000ull;
+			stamp.dwLowDateTime = static_cast<DWORD>(ahead);
+			stamp.dwHighDateTime = static_cast<DWORD>(ahead >> 32);
+			setWriteTime(source, stamp);
+
+			JobSystem jobSystem(2);
+			AssetBuilder builder(jobSystem);
+			std::atomic<UINT> builds(0);
+			builder.addStep(makeConcatStep("AssetBuilderTests_racy.out", { source }, builds));
+
+			AssetBuildStats stats;
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(1u, builds.load());
+
+			// new contents, same size and the same stamp, only the hash can tell
+			writeText(source, "new");
+			setWriteTime(source, stamp);
+
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(2u, builds.load());
+			Assert::AreEqual(std::string("new"), readText("AssetBuilderTests_racy.out"));
+
+			std::remove(source.c_str());
+			std::remove("AssetBuilderTests_racy.out");
+		}
+
+		TEST_METHOD(AssetBuilder_tracksDiscoveredInputsSettingsAndVersion)
+		{
+			writeText("AssetBuilderTests_model.obj", "mtllib AssetBuilderTests_model.mtl\nv 0 0 0\n");
+			writeText("AssetBuilderTests_model.mtl", "Kd 1 1 1\n");
+
+			JobSystem jobSystem(2);
+			AssetBuilder builder(jobSystem);
+			std::atomic<UINT> builds(0);
+
+			// the way the .obj loader finds its .mtl, only once it has read the .obj
+			BuildStep import;
+			import.m_output = "AssetBuilderTests_model.mesh";
+			import.m_inputs.push_back("AssetBuilderTests_model.obj");
+			import.m_settings = "flags=0x8b";
+			import.m_toolVersion = 3;
+			import.m_build = [&builds](const BuildStep & step, std::vector<std::string> & discovered)
+			{
+				++builds;
+				const std::string obj = readText(step.m_inputs[0]);
+				const std::string mtl = obj.substr(7, obj.find('\n') - 7);
+				discovered.push_back(mtl);
+				writeText(step.m_output, obj + readText(mtl));
+				return true;
+			};
+
+			builder.addStep(import);
+
+			AssetBuildStats stats;
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(1u, builds.load());
+			Assert::AreEqual(static_cast<size_t>(2), builder.getRecord(import.m_output)->m_inputs.size());
+
+			writeText("AssetBuilderTests_model.mtl", "Kd 1 0 0 1\n");
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(2u, builds.load());
+
+			// other importer flags
+			builder.clearSteps();
+			import.m_settings = "flags=0x8f";
+			builder.addStep(import);
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(3u, builds.load());
+
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(3u, builds.load());
+
+			// a newer importer
+			builder.clearSteps();
+			import.m_toolVersion = 4;
+			builder.addStep(import);
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(4u, builds.load());
+
+			std::remove("AssetBuilderTests_model.obj");
+			std::remove("AssetBuilderTests_model.mtl");
+			std::remove("AssetBuilderTests_model.mesh");
+		}
+
+		TEST_METHOD(AssetBuilder_stopsAtOutputsThatDidNotChange)
+		{
+			writeText("AssetBuilderTests_shader.hlsl", "float4 main() : SV_TARGET { return 1; }\n// comment\n");
+
+			JobSystem jobSystem(2);
+			AssetBuilder builder(jobSystem);
+			std::atomic<UINT> compiles(0);
+			std::atomic<UINT> builds(0);
+
+			// comments don't reach the output
+			BuildStep compile;
+			compile.m_output = "AssetBuilderTests_shader.cso";
+			compile.m_inputs.push_back("AssetBuilderTests_shader.hlsl");
+			compile.m_toolVersion = 1;
+			compile.m_build = [&compiles](const BuildStep & step, std::vector<std::string> &)
+			{
+				++compiles;
+				const std::string source = readText(step.m_inputs[0]);
+				writeText(step.m_output, source.substr(0, source.find("//")));
+				return true;
+			};
+
+			builder.addStep(compile);
+			builder.addStep(makeConcatStep("AssetBuilderTests_shaders.pack", { "AssetBuilderTests_shader.cso" }, builds));
+
+			AssetBuildStats stats;
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(2u, stats.m_built);
+
+			writeText("AssetBuilderTests_shader.hlsl", "float4 main() : SV_TARGET { return 1; }\n// a longer comment\n");
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(2u, compiles.load());
+			Assert::AreEqual(1u, builds.load());
+			Assert::AreEqual(1u, stats.m_built);
+			Assert::AreEqual(1u, stats.m_upToDate);
+
+			std::remove("AssetBuilderTests_shader.hlsl");
+			std::remove("AssetBuilderTests_shader.cso");
+			std::remove("AssetBuilderTests_shaders.pack");
+		}
+
+		TEST_METHOD(AssetBuilder_skipsWhatFollowsAFailure)
+		{
+			writeText("AssetBuilderTests_good.txt", "good");
+
+			JobSystem jobSystem(2);
+			AssetBuilder builder(jobSystem);
+			std::atomic<UINT> builds(0);
+
+			// the missing source fails its step, the pack after it is skipped, the unrelated step still builds
+			builder.addStep(makeConcatStep("AssetBuilderTests_bad.out", { "AssetBuilderTests_missing.txt" }, builds));
+			builder.addStep(makeConcatStep("AssetBuilderTests_bad.pack", { "AssetBuilderTests_bad.out" }, builds));
+			builder.addStep(makeConcatStep("AssetBuilderTests_good.out", { "AssetBuilderTests_good.txt" }, builds));
+
+			AssetBuildStats stats;
+			Assert::IsFalse(builder.build(stats));
+			Assert::AreEqual(1u, stats.m_failed);
+			Assert::AreEqual(1u, stats.m_skipped);
+			Assert::AreEqual(1u, stats.m_built);
+			Assert::AreEqual(2u, builds.load());
+			Assert::IsNull(builder.getRecord("AssetBuilderTests_bad.out"));
+			Assert::IsFalse(exists("AssetBuilderTests_bad.pack"));
+
+			// fixed, and only what wasn't built runs
+			writeText("AssetBuilderTests_missing.txt", "fixed");
+			Assert::IsTrue(builder.build(stats));
+			Assert::AreEqual(2u, stats.m_built);
+			Assert::AreEqual(1u, stats.m_upToDate);
+			Assert::AreEqual(std::string("fixed"), readText("AssetBuilderTests_bad.pack"));
+
+			// steps that need each other never run
+			builder.clearSteps();
+			builder.addStep(makeConcatStep("AssetBuilderTests_loop1.out", { "AssetBuilderTests_loop2.out" }, builds));
+			builder.addStep(makeConcatStep("AssetBuilderTests_loop2.out", { "AssetBuilderTests_loop1.out" }, builds));
+			builds = 0;
+			Assert::IsFalse(builder.build(stats));
+			Assert::AreEqual(2u, stats.m_failed);
+			Assert::AreEqual(0u, builds.load());
+
+			const char * paths[] = { "AssetBuilderTests_good.txt", "AssetBuilderTests_missing.txt", "AssetBuilderTests_bad.out", "AssetBuilderTests_bad.pack", "AssetBuilderTests_good.out" };
+
+			for (size_t i = 0; i < _countof(paths); ++i)
+			{
+				std::remove(paths[i]);
+			}
+		}
+
+		TEST_METHOD(AssetBuilder_keepsItsDatabaseBetweenRuns)
+		{
+			const std::string database = "AssetBuilderTests_build.db";
+			writeText("AssetBuilderTests_texture.png", "pixels");
+			writeText("AssetBuilderTests_texture.json", "{ \"srgb\": true }");
+
+			std::atomic<UINT> builds(0);
+			std::vector<BuildStep> steps;
+			steps.push_back(makeConcatStep("AssetBuilderTests_texture.dds", { "AssetBuilderTests_texture.png", "AssetBuilderTests_texture.json" }, builds));
+			steps.back().m_settings = "bc7";
+
+			{
+				JobSystem jobSystem(2);
+				AssetBuilder builder(jobSystem);
+				Assert::IsFalse(builder.loadDatabase(database));
+
+				builder.addStep(steps[0]);
+				AssetBuildStats stats;
+				Assert::IsTrue(builder.build(stats));
+				Assert::IsTrue(builder.saveDatabase(database));
+			}
+
+			{
+				// a later run picks up where that one left off
+				JobSystem jobSystem(2);
+				AssetBuilder builder(jobSystem);
+				Assert::IsTrue(builder.loadDatabase(database));
+
+				const BuildRecord * record = builder.getRecord("AssetBuilderTests_texture.dds");
+				Assert::IsNotNull(record);
+				Assert::AreEqual(std::string("AssetBuilderTests_texture.json"), record->m_inputs[1].m_path);
+				Assert::AreEqual(static_cast<UINT64>(16), record->m_inputs[1].m_size);
+
+				builder.addStep(steps[0]);
+				AssetBuildStats stats;
+				Assert::IsTrue(builder.build(stats));
+				Assert::AreEqual(1u, stats.m_upToDate);
+				Assert::AreEqual(1u, builds.load());
+			}
+
+			// anything cut short or from another version is thrown away, and everything builds again
+			const std::string saved = readText(database);
+			writeText(database, saved.substr(0, saved.size() - 3));
+
+			JobSystem jobSystem(2);
+			AssetBuilder builder(jobSystem);
+			Assert::IsFalse(builder.loadDatabase(database));
+			Assert::IsNull(builder.getRecord("AssetBuilderTests_texture.dds"));
+
+			std::string otherVersion = saved;
+			otherVersion[4] = 9;
+			writeText(database, otherVersion);
+			Assert::IsFalse(builder.loadDatabase(database));
+
+			std::remove(database.c_str());
+			std::remove("AssetBuilderTests_texture.png");
+			std::remove("AssetBuilderTests_texture.json");
+			std::remove("AssetBuilderTests_texture.dds");
+		}
+
+		TEST_METHOD(AssetBuilder_rebuildsLargeTreesIncrementally)
+		{
+			// a project's worth of small sources, one cook step each, packed into archives of 100
+			const UINT c_sourceCount = 2000;
+			const UINT c_packSize = 100;
+
+			std::vector<std::string> paths;
+			std::atomic<UINT> builds(0);
+
+			JobSystem jobSystem(4);
+			AssetBuilder builder(jobSystem);
+
+			for (UINT i = 0; i < c_sourceCount; ++i)
+			{
+				const std::string source = "AssetBuilderTests_tree" + std::to_string(i) + ".src";
+				const std::string cooked = "AssetBuilderTests_tree" + std::to_string(i) + ".bin";
+				writeText(source, std::string(512 + i % 512, static_cast<char>('a' + i % 26)));
+				builder.addStep(makeConcatStep(cooked, { source }, builds));
+				paths.push_back(source);
+				paths.push_back(cooked);
+			}
+
+			for (UINT p = 0; p < c_sourceCount / c_packSize; ++p)
+			{
+				std::vector<std::string> inputs;
+
+				for (UINT i = 0; i < c_packSize; ++i)
+				{
+					inputs.push_back("AssetBuilderTests_tree" + std::to_string(p * c_packSize + i) + ".bin");
+				}
+
+				const std::string pack = "AssetBuilderTests_tree" + std::to_string(p) + ".pack";
+				builder.addStep(makeConcatStep(pack, inputs, builds));
+				paths.push_back(pack);
+			}
+
+			AssetBuildStats full;
+			Assert::IsTrue(builder.build(full));
+			Assert::AreEqual(c_sourceCount + c_sourceCount / c_packSize, full.m_built);
+
+			AssetBuildStats noOp;
+			Assert::IsTrue(builder.build(noOp));
+			Assert::AreEqual(full.m_steps, noOp.m_upToDate);
+
+			writeText(paths[0], "changed");
+			AssetBuildStats single;
+			Assert::IsTrue(builder.build(single));
+			Assert::AreEqual(2u, single.m_built);
+
+			char statsStr[256];
+			sprintf_s(statsStr, "AssetBuilder: %u steps on %u threads, full %.1f ms, no-op %.1f ms, one source changed %.1f ms (%llu bytes hashed)\n",
+				full.m_steps, full.m_threadCount, full.m_seconds * 1000.0, noOp.m_seconds * 1000.0, single.m_seconds * 1000.0, static_cast<unsigned long long>(single.m_bytesHashed));
+			Logger::WriteMessage(statsStr);
+
+			for (size_t i = 0; i < paths.size(); ++i)
+			{
+				std::remove(paths[i].c_str());
+			}
+		}
+	};
+}
@@ -0,0 +1,217 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/AssetFileSystem.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	void writeFile(const std::string & path, const std::vector<UINT8> & contents)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+	}
+
+	std::vector<UINT8> makeContents(const size_t size, const UINT8 seed)
+	{
+		std::vector<UINT8> contents(size);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			contents[i] = static_cast<UINT8>(seed + i * 7);
+		}
+
+		return contents;
+	}
+
+	// what the default io system does, a buffered stream read into the importer's own copy
+	UINT64 readBuffered(const std::string & path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		std::vector<char> contents(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(contents.data(), contents.size());
+
+		UINT64 sum = 0;
+
+		for (size_t i = 0; i < contents.size(); i += 64)
+		{
+			sum += static_cast<UINT8>(contents[i]);
+		}
+
+		return sum;
+	}
+
+	UINT64 readMapped(AssetFileSystem & fileSystem, const std::string & path)
+	{
+		AssetView view;
+		fileSystem.open(path, view);
+
+		UINT64 sum = 0;
+
+		for (size_t i = 0; i < view.m_size; i += 64)
+		{
+			sum += view.m_data[i];
+		}
+
+		return sum;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(AssetFileSystemTests)
+	{
+	public:
+
+		TEST_METHOD(AssetFileSystem_normalisesPaths)
+		{
+			Assert::AreEqual(std::string("models/cube.obj"), AssetFileSystem::normalisePath("Models\\Cube.OBJ"));
+			Assert::AreEqual(std::string("models/cube.obj"), AssetFileSystem::normalisePath("./models//textures/../cube.obj"));
+			Assert::AreEqual(std::string("../shared/a.mtl"), AssetFileSystem::normalisePath("..\\shared\\.\\a.mtl"));
+			Assert::AreEqual(std::string("testcube.mtl"), AssetFileSystem::normalisePath("TestCube.mtl"));
+		}
+
+		TEST_METHOD(AssetFileSystem_servesMountsBeforeLooseFiles)
+		{
+			const char * path = "AssetFileSystemTests_mount.txt";
+			writeFile(path, makeContents(16, 1));
+
+			const std::vector<UINT8> mounted = makeContents(5, 100);
+			const std::shared_ptr<std::vector<UINT8>> owner = std::make_shared<std::vector<UINT8>>(mounted);
+
+			AssetFileSystem fileSystem;
+			fileSystem.mount("assetfilesystemtests_MOUNT.txt", owner->data(), owner->size(), owner);
+			fileSystem.mount("Only/In/Memory.mtl", owner->data(), 2, owner);
+
+			AssetView view;
+			Assert::IsTrue(fileSystem.open(path, view));
+			Assert::AreEqual(static_cast<size_t>(5), view.m_size);
+			Assert::AreEqual(static_cast<UINT8>(100), view.m_data[0]);
+
+			Assert::IsTrue(fileSystem.exists("only\\in\\memory.mtl"));
+			Assert::IsTrue(fileSystem.open("only/in/memory.mtl", view));
+			Assert::AreEqual(static_cast<size_t>(2), view.m_size);
+
+			// without the mount the file on disk shows through
+			fileSystem.unmount(path);
+			Assert::IsTrue(fileSystem.open(path, view));
+			Assert::AreEqual(static_cast<size_t>(16), view.m_size);
+			Assert::AreEqual(static_cast<UINT8>(1), view.m_data[0]);
+
+			Assert::IsFalse(fileSystem.exists("AssetFileSystemTests_missing.txt"));
+			Assert::IsFalse(fileSystem.open("AssetFileSystemTests_missing.txt", view));
+
+			const AssetFileStats & stats = fileSystem.getStats();
+			Assert::AreEqual(4u, stats.m_opens);
+			Assert::AreEqual(2u, stats.m_mountedOpens);
+			Assert::AreEqual(1u, stats.m_filesMapped);
+			Assert::AreEqual(1u, stats.m_missing);
+
+			view = AssetView();
+			fileSystem.releaseLooseFiles();
+			std::remove(path);
+		}
+
+		TEST_METHOD(AssetFileSystem_mapsALooseFileOnce)
+		{
+			const char * path = "AssetFileSystemTests_loose.txt";
+			const std::vector<UINT8> contents = makeContents(10000, 3);
+			writeFile(path, contents);
+
+			AssetView kept;
+
+			{
+				AssetFileSystem fileSystem;
+
+				AssetView first;
+				AssetView second;
+				Assert::IsTrue(fileSystem.open(path, first));
+				Assert::IsTrue(fileSystem.open("./ASSETFILESYSTEMTESTS_LOOSE.TXT", second));
+
+				// the second open is the same mapping, not another one
+				Assert::IsTrue(first.m_data == second.m_data);
+				Assert::AreEqual(1u, fileSystem.getStats().m_filesMapped);
+				Assert::AreEqual(static_cast<UINT64>(contents.size()), fileSystem.getStats().m_bytesMapped);
+
+				fileSystem.releaseLooseFiles();
+				kept = first;
+			}
+
+			// the view outlives both the release and the file system
+			Assert::AreEqual(contents.size(), kept.m_size);
+			Assert::IsTrue(memcmp(contents.data(), kept.m_data, contents.size()) == 0);
+
+			kept = AssetView();
+			std::remove(path);
+		}
+
+		TEST_METHOD(AssetFileSystem_readsManySmallAndLargeFiles)
+		{
+			using namespace std::chrono;
+
+			// a scene's worth of small files (.obj, .mtl, shaders) and a couple of large ones
+			std::vector<std::string> paths;
+
+			for (UINT i = 0; i < 200; ++i)
+			{
+				paths.push_back("AssetFileSystemTests_small" + std::to_string(i) + ".bin");
+				writeFile(paths.back(), makeContents(2000 + i * 10, static_cast<UINT8>(i)));
+			}
+
+			for (UINT i = 0; i < 2; ++i)
+			{
+				paths.push_back("AssetFileSystemTests_large" + std::to_string(i) + ".bin");
+				writeFile(paths.back(), makeContents(16 * 1024 * 1024, static_cast<UINT8>(i)));
+			}
+
+			UINT64 bufferedSum = 0;
+			UINT64 mappedSum = 0;
+
+			const steady_clock::time_point bufferedStart = steady_clock::now();
+
+			for (size_t i = 0; i < paths.size(); ++i)
+			{
+				bufferedSum += readBuffered(paths[i]);
+			}
+
+			const steady_clock::time_point mappedStart = steady_clock::now();
+
+			{
+				AssetFileSystem fileSystem;
+
+				// each file is opened twice, the way the importer checks a file before reading it
+				for (size_t i = 0; i < paths.size(); ++i)
+				{
+					readMapped(fileSystem, paths[i]);
+					mappedSum += readMapped(fileSystem, paths[i]);
+				}
+
+				Assert::AreEqual(static_cast<UINT>(paths.size()), fileSystem.getStats().m_filesMapped);
+			}
+
+			const steady_clock::time_point mappedEnd = steady_clock::now();
+
+			char statsStr[256];
+			sprintf_s(statsStr, "%u files: buffered reads %.3f ms, mapped %.3f ms (each opened twice)",
+				static_cast<UINT>(paths.size()), duration_cast<duration<double>>(mappedStart - bufferedStart).count() * 1000.0,
+				duration_cast<duration<double>>(mappedEnd - mappedStart).count() * 1000.0);
+			Logger::WriteMessage(statsStr);
+
+			for (size_t i = 0; i < paths.size(); ++i)
+			{
+				std::remove(paths[i].c_str());
+			}
+
+			Assert::AreEqual(bufferedSum, mappedSum);
+		}
+	};
+}
@@ -0,0 +1,193 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/CopyUploader.h"
+
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// stands in for the copy queue, batches "finish" when the test says so
+	class FakeCopyBackend : public CopyQueueBackend
+	{
+	public:
+		FakeCopyBackend()
+			: m_nextFenceValue(1)
+			, m_completedFenceValue(0)
+		{
+
+		}
+
+		UINT64 submitBatch(const std::vector<UploadRequest> & batch, const UINT64 batchBytes) override
+		{
+			m_batchSizes.push_back(batch.size());
+			m_batchBytes.push_back(batchBytes);
+
+			for (size_t i = 0; i < batch.size(); ++i)
+			{
+				m_firstBytes.push_back(batch[i].m_data.empty() ? 0 : batch[i].m_data[0]);
+			}
+
+			return m_nextFenceValue++;
+		}
+
+		UINT64 getCompletedFenceValue() override
+		{
+			return m_completedFenceValue;
+		}
+
+		void complete(const UINT64 fenceValue) { m_completedFenceValue = fenceValue; }
+
+		std::vector<size_t> m_batchSizes;
+		std::vector<UINT64> m_batchBytes;
+		std::vector<UINT8> m_firstBytes;
+		UINT64 m_nextFenceValue;
+		UINT64 m_completedFenceValue;
+	};
+
+	UploadRequest makeRequest(const size_t size, const UINT8 tag)
+	{
+		UploadRequest request;
+		request.m_destination = nullptr;
+		request.m_destinationOffset = 0;
+		request.m_data.assign(size, tag);
+		return request;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(CopyUploaderTests)
+	{
+	public:
+
+		TEST_METHOD(CopyUploader_batchesByBytesAndCount)
+		{
+			FakeCopyBackend backend;
+			CopyUploader uploader(&backend);
+			uploader.setBatchLimits(100, 3);
+
+			// 40 + 40 fit, the third would go over 100 bytes
+			uploader.enqueue(makeRequest(40, 1));
+			uploader.enqueue(makeRequest(40, 2));
+			uploader.enqueue(makeRequest(40, 3));
+			// over the byte limit on its own, still goes through as its own batch
+			uploader.enqueue(makeRequest(250, 4));
+			// hits the count limit
+			uploader.enqueue(makeRequest(1, 5));
+			uploader.enqueue(makeRequest(1, 6));
+			uploader.enqueue(makeRequest(1, 7));
+			uploader.enqueue(makeRequest(1, 8));
+
+			uploader.flush();
+
+			const std::vector<size_t> expectedSizes = { 2, 1, 1, 3, 1 };
+			Assert::IsTrue(expectedSizes == backend.m_batchSizes);
+			Assert::AreEqual(static_cast<UINT64>(80), backend.m_batchBytes[0]);
+			Assert::AreEqual(static_cast<UINT64>(250), backend.m_batchBytes[2]);
+
+			// submitted in the order they were enqueued
+			const std::vector<UINT8> expectedOrder = { 1, 2, 3, 4, 5, 6, 7, 8 };
+			Assert::IsTrue(expectedOrder == backend.m_firstBytes);
+			Assert::AreEqual(static_cast<UINT64>(5), uploader.getSubmittedBatchCount());
+		}
+
+		TEST_METHOD(CopyUploader_requiredFenceValueTracksBatches)
+		{
+			FakeCopyBackend backend;
+			CopyUploader uploader(&backend);
+			uploader.setBatchLimits(1024, 2);
+
+			const UploadTicket a = uploader.enqueue(makeRequest(8, 1));
+			const UploadTicket b = uploader.enqueue(makeRequest(8, 2));
+			const UploadTicket c = uploader.enqueue(makeRequest(8, 3));
+			uploader.flush();
+
+			Assert::AreEqual(static_cast<UINT64>(0), uploader.requiredFenceValue(0));
+			Assert::AreEqual(static_cast<UINT64>(1), uploader.requiredFenceValue(a));
+			Assert::AreEqual(static_cast<UINT64>(1), uploader.requiredFenceValue(b));
+			Assert::AreEqual(static_cast<UINT64>(2), uploader.requiredFenceValue(c));
+
+			// once the copy queue passes a batch nothing has to wait on it
+			backend.complete(1);
+			Assert::AreEqual(static_cast<UINT64>(0), uploader.requiredFenceValue(a));
+			Assert::IsTrue(uploader.isComplete(b));
+			Assert::AreEqual(static_cast<UINT64>(2), uploader.requiredFenceValue(c));
+			Assert::IsFalse(uploader.isComplete(c));
+
+			uploader.retireCompleted();
+			Assert::AreEqual(static_cast<size_t>(1), uploader.getInFlightBatchCount());
+			Assert::AreEqual(static_cast<UINT64>(0), uploader.requiredFenceValue(b));
+			Assert::AreEqual(static_cast<UINT64>(2), uploader.requiredFenceValue(c));
+
+			backend.complete(2);
+			uploader.retireCompleted();
+			Assert::AreEqual(static_cast<size_t>(0), uploader.getInFlightBatchCount());
+			Assert::AreEqual(static_cast<UINT64>(0), uploader.requiredFenceValue(c));
+		}
+
+		TEST_METHOD(CopyUploader_requiredFenceValueSubmitsPendingUpload)
+		{
+			FakeCopyBackend backend;
+			CopyUploader uploader(&backend);
+
+			const UploadTicket ticket = uploader.enqueue(makeRequest(16, 1));
+
+			Assert::IsFalse(uploader.isComplete(ticket));
+			Assert::AreEqual(static_cast<UINT64>(0), uploader.getSubmittedBatchCount());
+
+			// a draw needs it, so it has to be submitted now rather than at the next flush
+			Assert::AreEqual(static_cast<UINT64>(1), uploader.requiredFenceValue(ticket));
+			Assert::AreEqual(static_cast<UINT64>(1), uploader.getSubmittedBatchCount());
+		}
+
+		TEST_METHOD(CopyUploader_enqueueFromManyThreads)
+		{
+			FakeCopyBackend backend;
+			CopyUploader uploader(&backend);
+			uploader.setBatchLimits(1024 * 1024, 16);
+
+			const size_t threadCount = 4;
+			const size_t requestsPerThread = 250;
+			std::vector<std::vector<UploadTicket>> tickets(threadCount);
+			std::vector<std::thread> threads;
+
+			for (size_t t = 0; t < threadCount; ++t)
+			{
+				threads.emplace_back([&uploader, &tickets, t, requestsPerThread]()
+				{
+					for (size_t i = 0; i < requestsPerThread; ++i)
+					{
+						tickets[t].push_back(uploader.enqueue(makeRequest(4, static_cast<UINT8>(t))));
+					}
+				});
+			}
+
+			for (size_t t = 0; t < threads.size(); ++t)
+			{
+				threads[t].join();
+			}
+
+			uploader.flush();
+
+			// every ticket is unique and belongs to exactly one submitted batch
+			std::vector<bool> seen(threadCount * requestsPerThread + 1, false);
+
+			for (size_t t = 0; t < threadCount; ++t)
+			{
+				for (size_t i = 0; i < tickets[t].size(); ++i)
+				{
+					const UploadTicket ticket = tickets[t][i];
+					Assert::IsTrue(ticket >= 1 && ticket <= threadCount * requestsPerThread);
+					Assert::IsFalse(seen[static_cast<size_t>(ticket)]);
+					seen[static_cast<size_t>(ticket)] = true;
+					Assert::AreEqual(static_cast<UINT64>((ticket - 1) / 16 + 1), uploader.requiredFenceValue(ticket));
+				}
+			}
+
+			Assert::AreEqual(static_cast<UINT64>((threadCount * requestsPerThread + 15) / 16), uploader.getSubmittedBatchCount());
+		}
+	};
+}
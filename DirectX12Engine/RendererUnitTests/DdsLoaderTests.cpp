@@ -0,0 +1,285 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/DdsLoader.h"
+#include "../DirectX12Engine/DdsFormat.h"
+#include "../DirectX12Engine/TextureCooker.h"
+
+#include <cstring>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	std::vector<UINT8> makeLegacyDds(const UINT width, const UINT height, const UINT mipCount, const DdsPixelFormat & pixelFormat, const size_t dataSize)
+	{
+		DdsHeader header;
+		memset(&header, 0, sizeof(header));
+		header.m_size = sizeof(DdsHeader);
+		header.m_flags = c_ddsFlagCaps | c_ddsFlagHeight | c_ddsFlagWidth | c_ddsFlagPixelFormat;
+		header.m_width = width;
+		header.m_height = height;
+		header.m_mipMapCount = mipCount;
+		header.m_pixelFormat = pixelFormat;
+		header.m_caps = c_ddsCapsTexture;
+
+		std::vector<UINT8> file(sizeof(c_ddsMagic) + sizeof(header) + dataSize);
+		memcpy(file.data(), &c_ddsMagic, sizeof(c_ddsMagic));
+		memcpy(file.data() + sizeof(c_ddsMagic), &header, sizeof(header));
+
+		return file;
+	}
+
+	DdsPixelFormat fourCcFormat(const UINT32 fourCc)
+	{
+		DdsPixelFormat pixelFormat;
+		memset(&pixelFormat, 0, sizeof(pixelFormat));
+		pixelFormat.m_size = sizeof(DdsPixelFormat);
+		pixelFormat.m_flags = c_ddsPixelFormatFourCc;
+		pixelFormat.m_fourCc = fourCc;
+		return pixelFormat;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(DdsLoaderTests)
+	{
+	public:
+
+		TEST_METHOD(DdsLoader_footprintsMatchCopyableLayout)
+		{
+			DdsTextureLayout layout;
+			layout.m_format = DXGI_FORMAT_BC7_UNORM;
+			layout.m_width = 40;
+			layout.m_height = 24;
+			layout.m_mipCount = 6;
+			layout.m_arraySize = 1;
+
+			Assert::IsTrue(computeCopyableFootprints(layout));
+			Assert::AreEqual(static_cast<size_t>(6), layout.m_subresources.size());
+
+			// 40x24 is 10x6 blocks, 160 bytes a row padded to 256
+			Assert::AreEqual(static_cast<UINT64>(0), layout.m_subresources[0].m_placed.Offset);
+			Assert::AreEqual(256u, layout.m_subresources[0].m_placed.Footprint.RowPitch);
+			Assert::AreEqual(6u, layout.m_subresources[0].m_numRows);
+			Assert::AreEqual(static_cast<UINT64>(160), layout.m_subresources[0].m_rowSizeInBytes);
+
+			// 256 * 6 = 1536 is already on a 512 boundary
+			Assert::AreEqual(static_cast<UINT64>(1536), layout.m_subresources[1].m_placed.Offset);
+			Assert::AreEqual(3u, layout.m_subresources[1].m_numRows);
+
+			// 1536 + 256 * 3 = 2304, rounded up to 2560
+			Assert::AreEqual(static_cast<UINT64>(2560), layout.m_subresources[2].m_placed.Offset);
+
+			// 5x3 and smaller still copy whole blocks
+			Assert::AreEqual(8u, layout.m_subresources[3].m_placed.Footprint.Width);
+			Assert::AreEqual(4u, layout.m_subresources[3].m_placed.Footprint.Height);
+			Assert::AreEqual(4u, layout.m_subresources[5].m_placed.Footprint.Width);
+			Assert::AreEqual(1u, layout.m_subresources[5].m_numRows);
+
+			// the last subresource's only row isn't padded
+			Assert::AreEqual(layout.m_subresources[5].m_placed.Offset + 16, layout.m_totalUploadBytes);
+
+			for (size_t i = 0; i < layout.m_subresources.size(); ++i)
+			{
+				Assert::AreEqual(static_cast<UINT64>(0), layout.m_subresources[i].m_placed.Offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+				Assert::AreEqual(0u, layout.m_subresources[i].m_placed.Footprint.RowPitch % D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+			}
+		}
+
+		TEST_METHOD(DdsLoader_uncompressedRowsArePadded)
+		{
+			DdsTextureLayout layout;
+			layout.m_format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			layout.m_width = 100;
+			layout.m_height = 50;
+			layout.m_mipCount = 2;
+			layout.m_arraySize = 2;
+
+			Assert::IsTrue(computeCopyableFootprints(layout));
+			Assert::AreEqual(static_cast<size_t>(4), layout.m_subresources.size());
+
+			// 400 bytes a row padded to 512, then the second slice starts its own mip chain
+			Assert::AreEqual(512u, layout.m_subresources[0].m_placed.Footprint.RowPitch);
+			Assert::AreEqual(50u, layout.m_subresources[0].m_numRows);
+			Assert::AreEqual(static_cast<UINT64>(512 * 50), layout.m_subresources[1].m_placed.Offset);
+			Assert::AreEqual(256u, layout.m_subresources[1].m_placed.Footprint.RowPitch);
+			Assert::AreEqual(50u, layout.m_subresources[1].m_placed.Footprint.Width);
+
+			// 25600 + 256 * 25 = 32000, rounded up to 32256
+			Assert::AreEqual(100u, layout.m_subresources[2].m_placed.Footprint.Width);
+			Assert::AreEqual(static_cast<UINT64>(32256), layout.m_subresources[2].m_placed.Offset);
+		}
+
+		TEST_METHOD(DdsLoader_mipRangeKeepsFileOffsets)
+		{
+			DdsTextureLayout layout;
+			layout.m_format = DXGI_FORMAT_BC1_UNORM;
+			layout.m_width = 256;
+			layout.m_height = 128;
+			layout.m_mipCount = 9;
+			layout.m_arraySize = 1;
+			Assert::IsTrue(computeCopyableFootprints(layout));
+
+			for (UINT mip = 0; mip < layout.m_mipCount; ++mip)
+			{
+				layout.m_subresources[mip].m_fileOffset = 1000 + mip;
+				layout.m_subresources[mip].m_fileRowPitch = 10 + mip;
+			}
+
+			DdsTextureLayout range;
+			Assert::IsTrue(ddsMipRange(layout, 3, range));
+
+			Assert::AreEqual(32u, range.m_width);
+			Assert::AreEqual(16u, range.m_height);
+			Assert::AreEqual(6u, range.m_mipCount);
+			Assert::AreEqual(static_cast<UINT64>(1003), range.m_subresources[0].m_fileOffset);
+			Assert::AreEqual(18u, range.m_subresources[5].m_fileRowPitch);
+
+			// the placement starts again from 0 for the smaller texture
+			Assert::AreEqual(static_cast<UINT64>(0), range.m_subresources[0].m_placed.Offset);
+			Assert::AreEqual(layout.m_subresources[3].m_numRows, range.m_subresources[0].m_numRows);
+
+			Assert::IsFalse(ddsMipRange(layout, 9, range));
+
+			// 8x4 is whole blocks, 4x2 and the 1x1 at the end aren't
+			Assert::IsTrue(ddsMipRange(layout, 5, range));
+			Assert::IsFalse(ddsMipRange(layout, 6, range));
+			Assert::IsFalse(ddsMipRange(layout, 8, range));
+		}
+
+		TEST_METHOD(DdsLoader_mipRangeRejectsPartialBlockTops)
+		{
+			DdsTextureLayout layout;
+			layout.m_format = DXGI_FORMAT_BC1_UNORM;
+			layout.m_width = 512;
+			layout.m_height = 8;
+			layout.m_mipCount = 10;
+			layout.m_arraySize = 1;
+			Assert::IsTrue(computeCopyableFootprints(layout));
+
+			DdsTextureLayout range;
+			Assert::IsTrue(ddsMipRange(layout, 0, range));
+			Assert::IsTrue(ddsMipRange(layout, 1, range));
+			Assert::AreEqual(4u, range.m_height);
+			// 128x2 and the 64x1 the streamer used to pick as the tail
+			Assert::IsFalse(ddsMipRange(layout, 2, range));
+			Assert::IsFalse(ddsMipRange(layout, 3, range));
+
+			// uncompressed has no blocks, any mip can be the top
+			layout.m_format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			Assert::IsTrue(computeCopyableFootprints(layout));
+			Assert::IsTrue(ddsMipRange(layout, 9, range));
+			Assert::AreEqual(1u, range.m_width);
+		}
+
+		TEST_METHOD(DdsLoader_parsesCookedTexture)
+		{
+			JobSystem jobSystem(2);
+			TextureCooker cooker(jobSystem);
+
+			DecodedImage image;
+			image.m_width = 40;
+			image.m_height = 24;
+			image.m_pixels.assign(40 * 24 * 4, 200);
+
+			TextureCookSettings settings;
+			settings.m_compression = TEXTURE_COMPRESSION_BC1;
+			settings.m_srgb = true;
+			settings.m_generateMips = true;
+
+			TextureCookStats stats;
+			const CookedTexture texture = cooker.cook(std::move(image), settings, stats);
+			const std::vector<UINT8> file = TextureCooker::writeDds(texture);
+
+			DdsTextureLayout layout;
+			Assert::IsTrue(parseDds(file.data(), file.size(), layout));
+
+			Assert::IsTrue(layout.m_format == DXGI_FORMAT_BC1_UNORM_SRGB);
+			Assert::AreEqual(40u, layout.m_width);
+			Assert::AreEqual(24u, layout.m_height);
+			Assert::AreEqual(texture.m_mipCount, layout.m_mipCount);
+			Assert::AreEqual(1u, layout.m_arraySize);
+
+			// the mips sit back to back after the headers, exactly as the cooker laid them out
+			UINT64 expectedOffset = sizeof(c_ddsMagic) + sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+
+			for (size_t i = 0; i < layout.m_subresources.size(); ++i)
+			{
+				const DdsSubresourceLayout & subresource = layout.m_subresources[i];
+
+				Assert::AreEqual(expectedOffset, subresource.m_fileOffset);
+				Assert::AreEqual(static_cast<UINT64>(subresource.m_fileRowPitch), subresource.m_rowSizeInBytes);
+				expectedOffset += static_cast<UINT64>(subresource.m_fileRowPitch) * subresource.m_numRows;
+			}
+
+			Assert::AreEqual(static_cast<UINT64>(file.size()), expectedOffset);
+			Assert::AreEqual(0, memcmp(file.data() + layout.m_subresources[0].m_fileOffset, texture.m_data.data(), texture.m_data.size()));
+		}
+
+		TEST_METHOD(DdsLoader_parsesLegacyHeaders)
+		{
+			DdsTextureLayout layout;
+
+			// 16x16 DXT5 with no mip count, one level of 4x4 blocks at 16 bytes
+			const std::vector<UINT8> dxt5 = makeLegacyDds(16, 16, 0, fourCcFormat(c_ddsFourCcDxt5), 16 * 16);
+			Assert::IsTrue(parseDds(dxt5.data(), dxt5.size(), layout));
+			Assert::IsTrue(layout.m_format == DXGI_FORMAT_BC3_UNORM);
+			Assert::AreEqual(1u, layout.m_mipCount);
+			Assert::AreEqual(static_cast<UINT64>(sizeof(c_ddsMagic) + sizeof(DdsHeader)), layout.m_subresources[0].m_fileOffset);
+
+			const std::vector<UINT8> ati2 = makeLegacyDds(8, 8, 1, fourCcFormat(c_ddsFourCcAti2), 4 * 16);
+			Assert::IsTrue(parseDds(ati2.data(), ati2.size(), layout));
+			Assert::IsTrue(layout.m_format == DXGI_FORMAT_BC5_UNORM);
+
+			DdsPixelFormat bgra;
+			memset(&bgra, 0, sizeof(bgra));
+			bgra.m_size = sizeof(DdsPixelFormat);
+			bgra.m_flags = c_ddsPixelFormatRgb | c_ddsPixelFormatAlphaPixels;
+			bgra.m_rgbBitCount = 32;
+			bgra.m_rBitMask = 0x00ff0000;
+			bgra.m_gBitMask = 0x0000ff00;
+			bgra.m_bBitMask = 0x000000ff;
+			bgra.m_aBitMask = 0xff000000;
+
+			// 4x2, 2x1, 1x1
+			const std::vector<UINT8> uncompressed = makeLegacyDds(4, 2, 3, bgra, (8 + 2 + 1) * 4);
+			Assert::IsTrue(parseDds(uncompressed.data(), uncompressed.size(), layout));
+			Assert::IsTrue(layout.m_format == DXGI_FORMAT_B8G8R8A8_UNORM);
+			Assert::AreEqual(16u, layout.m_subresources[0].m_fileRowPitch);
+			Assert::AreEqual(8u, layout.m_subresources[1].m_fileRowPitch);
+			Assert::AreEqual(1u, layout.m_subresources[2].m_numRows);
+		}
+
+		TEST_METHOD(DdsLoader_rejectsBadFiles)
+		{
+			DdsTextureLayout layout;
+
+			const std::vector<UINT8> good = makeLegacyDds(16, 16, 1, fourCcFormat(c_ddsFourCcDxt1), 16 * 8);
+			Assert::IsTrue(parseDds(good.data(), good.size(), layout));
+
+			// one byte short of the last block
+			Assert::IsFalse(parseDds(good.data(), good.size() - 1, layout));
+			Assert::IsFalse(parseDds(good.data(), 64, layout));
+
+			std::vector<UINT8> badMagic = good;
+			badMagic[0] = 'X';
+			Assert::IsFalse(parseDds(badMagic.data(), badMagic.size(), layout));
+
+			// more mips than a 16x16 chain has
+			const std::vector<UINT8> tooManyMips = makeLegacyDds(16, 16, 6, fourCcFormat(c_ddsFourCcDxt1), 4096);
+			Assert::IsFalse(parseDds(tooManyMips.data(), tooManyMips.size(), layout));
+
+			const std::vector<UINT8> unknownFourCc = makeLegacyDds(16, 16, 1, fourCcFormat(0x12345678), 4096);
+			Assert::IsFalse(parseDds(unknownFourCc.data(), unknownFourCc.size(), layout));
+
+			std::vector<UINT8> cube = good;
+			DdsHeader header;
+			memcpy(&header, cube.data() + sizeof(c_ddsMagic), sizeof(header));
+			header.m_caps2 = c_ddsCaps2Cubemap;
+			memcpy(cube.data() + sizeof(c_ddsMagic), &header, sizeof(header));
+			Assert::IsFalse(parseDds(cube.data(), cube.size(), layout));
+		}
+	};
+}
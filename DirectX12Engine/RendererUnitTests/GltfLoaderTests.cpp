@@ -0,0 +1,555 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/GltfLoader.h"
+#include "../DirectX12Engine/ObjLoader.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	void appendUint32(std::vector<UINT8> & out, const UINT32 value)
+	{
+		const UINT8 * bytes = reinterpret_cast<const UINT8*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(value));
+	}
+
+	template<typename T>
+	void appendData(std::vector<UINT8> & out, const T * data, const size_t count)
+	{
+		const UINT8 * bytes = reinterpret_cast<const UINT8*>(data);
+		out.insert(out.end(), bytes, bytes + sizeof(T) * count);
+	}
+
+	// header, the JSON chunk padded with spaces and the binary one padded with zeros, as an exporter writes them
+	std::shared_ptr<std::vector<UINT8>> makeGlb(std::string json, std::vector<UINT8> binary)
+	{
+		json.resize((json.size() + 3) & ~static_cast<size_t>(3), ' ');
+		binary.resize((binary.size() + 3) & ~static_cast<size_t>(3), 0);
+
+		std::shared_ptr<std::vector<UINT8>> glb = std::make_shared<std::vector<UINT8>>();
+		appendUint32(*glb, 0x46546C67);
+		appendUint32(*glb, 2);
+		appendUint32(*glb, static_cast<UINT32>(12 + 8 + json.size() + (binary.empty() ? 0 : 8 + binary.size())));
+		appendUint32(*glb, static_cast<UINT32>(json.size()));
+		appendUint32(*glb, 0x4E4F534A);
+		appendData(*glb, json.data(), json.size());
+
+		if (!binary.empty())
+		{
+			appendUint32(*glb, static_cast<UINT32>(binary.size()));
+			appendUint32(*glb, 0x004E4942);
+			appendData(*glb, &binary[0], binary.size());
+		}
+
+		return glb;
+	}
+
+	void mount(AssetFileSystem & fileSystem, const std::string & path, const std::shared_ptr<std::vector<UINT8>> & data)
+	{
+		fileSystem.mount(path, &(*data)[0], data->size(), data);
+	}
+
+	std::string encodeBase64(const std::vector<UINT8> & data)
+	{
+		const char * alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string out;
+
+		for (size_t i = 0; i < data.size(); i += 3)
+		{
+			const UINT bits = (data[i] << 16) | ((i + 1 < data.size() ? data[i + 1] : 0) << 8) | (i + 2 < data.size() ? data[i + 2] : 0);
+			out += alphabet[(bits >> 18) & 63];
+			out += alphabet[(bits >> 12) & 63];
+			out += i + 1 < data.size() ? alphabet[(bits >> 6) & 63] : '=';
+			out += i + 2 < data.size() ? alphabet[bits & 63] : '=';
+		}
+
+		return out;
+	}
+
+	bool nearlyEqual(const float a, const float b)
+	{
+		return std::fabs(a - b) < 1e-5f;
+	}
+
+	// a size x size grid of quads, the same surface as a .glb of interleaved Vertex with 32 bit indices and as an .obj
+	void makeGrid(const UINT size, std::vector<Vertex> & vertices, std::vector<UINT> & indices)
+	{
+		vertices.resize((size + 1) * (size + 1));
+		indices.clear();
+
+		for (UINT y = 0; y <= size; ++y)
+		{
+			for (UINT x = 0; x <= size; ++x)
+			{
+				Vertex & vertex = vertices[y * (size + 1) + x];
+				vertex.m_position = DirectX::XMFLOAT3(x * 0.5f, y * 0.25f, (x ^ y) * 0.125f);
+				vertex.m_colour = DirectX::XMFLOAT4(x / static_cast<float>(size), y / static_cast<float>(size), 0.5f, 1.0f);
+			}
+		}
+
+		for (UINT y = 0; y < size; ++y)
+		{
+			for (UINT x = 0; x < size; ++x)
+			{
+				const UINT corner = y * (size + 1) + x;
+				const UINT quad[6] = { corner, corner + 1, corner + size + 2, corner, corner + size + 2, corner + size + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	std::shared_ptr<std::vector<UINT8>> makeGridGlb(const std::vector<Vertex> & vertices, const std::vector<UINT> & indices)
+	{
+		std::vector<UINT8> binary;
+		appendData(binary, &vertices[0], vertices.size());
+		appendData(binary, &indices[0], indices.size());
+
+		char json[1024];
+		sprintf_s(json,
+			"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":%zu}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteLength\":%zu,\"byteStride\":28},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+			"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+			"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC4\"},"
+			"{\"bufferView\":1,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"COLOR_0\":1},\"indices\":2}]}],"
+			"\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}],\"scene\":0}",
+			binary.size(), vertices.size() * sizeof(Vertex), vertices.size() * sizeof(Vertex), indices.size() * sizeof(UINT),
+			vertices.size(), vertices.size(), indices.size());
+
+		return makeGlb(json, binary);
+	}
+
+	std::string makeGridObj(const std::vector<Vertex> & vertices, const std::vector<UINT> & indices)
+	{
+		std::string text;
+		char line[128];
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			sprintf_s(line, "v %.4f %.4f %.4f\n", vertices[i].m_position.x, vertices[i].m_position.y, vertices[i].m_position.z);
+			text += line;
+		}
+
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			sprintf_s(line, "f %u %u %u\n", indices[i] + 1, indices[i + 1] + 1, indices[i + 2] + 1);
+			text += line;
+		}
+
+		return text;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(GltfLoaderTests)
+	{
+	public:
+
+		TEST_METHOD(GltfAsset_viewsMatchingVerticesInPlace)
+		{
+			std::vector<Vertex> vertices;
+			std::vector<UINT> indices;
+			makeGrid(2, vertices, indices);
+
+			const std::shared_ptr<std::vector<UINT8>> glb = makeGridGlb(vertices, indices);
+
+			AssetFileSystem fileSystem;
+			mount(fileSystem, "models/grid.glb", glb);
+
+			GltfAsset asset;
+			GltfLoadStats stats;
+			Assert::IsTrue(asset.open(fileSystem, "models/grid.glb", stats));
+			Assert::AreEqual(static_cast<UINT64>(glb->size()), stats.m_bytes);
+			Assert::AreEqual(3u, stats.m_accessors);
+			Assert::AreEqual(static_cast<size_t>(1), asset.getSceneRoots().size());
+
+			const GltfPrimitive & primitive = asset.getMeshes()[0].m_primitives[0];
+
+			// straight out of the mounted file, right handed as it was written
+			const Vertex * view = nullptr;
+			UINT vertexCount = 0;
+			Assert::IsTrue(asset.getVertexView(primitive, view, vertexCount));
+			Assert::AreEqual(static_cast<UINT>(vertices.size()), vertexCount);
+			Assert::IsTrue(reinterpret_cast<const UINT8*>(view) > &(*glb)[0] && reinterpret_cast<const UINT8*>(view) < &(*glb)[0] + glb->size());
+			Assert::AreEqual(0, memcmp(view, &vertices[0], sizeof(Vertex) * vertices.size()));
+
+			const UINT * indexView = nullptr;
+			UINT indexCount = 0;
+			Assert::IsTrue(asset.getIndexView(primitive, indexView, indexCount));
+			Assert::AreEqual(static_cast<UINT>(indices.size()), indexCount);
+			Assert::AreEqual(0, memcmp(indexView, &indices[0], sizeof(UINT) * indices.size()));
+
+			// converted, z mirrored
+			std::vector<Vertex> converted(1);
+			Assert::IsTrue(asset.readVertices(primitive, converted));
+			Assert::AreEqual(vertices.size() + 1, converted.size());
+
+			for (size_t i = 0; i < vertices.size(); ++i)
+			{
+				Assert::AreEqual(vertices[i].m_position.x, converted[i + 1].m_position.x);
+				Assert::AreEqual(-vertices[i].m_position.z, converted[i + 1].m_position.z);
+				Assert::AreEqual(vertices[i].m_colour.y, converted[i + 1].m_colour.y);
+			}
+
+			std::vector<UINT> convertedIndices;
+			Assert::IsTrue(asset.readIndices(primitive, 1, convertedIndices));
+			Assert::AreEqual(indices.size(), convertedIndices.size());
+			Assert::AreEqual(indices[5] + 1, convertedIndices[5]);
+		}
+
+		TEST_METHOD(GltfAsset_convertsOtherLayoutsAndTopologies)
+		{
+			// positions alone, then a strip and a fan over them through 16 bit indices
+			const float positions[] = { 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+			const UINT16 strip[] = { 0, 1, 2, 3 };
+			const UINT8 colours[] = { 255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255, 255, 255, 255, 255 };
+
+			std::vector<UINT8> binary;
+			appendData(binary, positions, _countof(positions));
+			appendData(binary, strip, _countof(strip));
+			appendData(binary, colours, _countof(colours));
+
+			const std::string json =
+				"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":72}],"
+				"\"bufferViews\":[{\"buffer\":0,\"byteLength\":48},{\"buffer\":0,\"byteOffset\":48,\"byteLength\":8},{\"buffer\":0,\"byteOffset\":56,\"byteLength\":16}],"
+				"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+				"{\"bufferView\":1,\"componentType\":5123,\"count\":4,\"type\":\"SCALAR\"},"
+				"{\"bufferView\":2,\"componentType\":5121,\"normalized\":true,\"count\":4,\"type\":\"VEC4\"}],"
+				"\"meshes\":[{\"primitives\":["
+				"{\"attributes\":{\"POSITION\":0,\"COLOR_0\":2},\"indices\":1,\"mode\":5},"
+				"{\"attributes\":{\"POSITION\":0},\"indices\":1,\"mode\":6},"
+				"{\"attributes\":{\"POSITION\":0},\"mode\":1}]}]}";
+
+			AssetFileSystem fileSystem;
+			mount(fileSystem, "quad.glb", makeGlb(json, binary));
+
+			GltfAsset asset;
+			GltfLoadStats stats;
+			Assert::IsTrue(asset.open(fileSystem, "quad.glb", stats));
+
+			const std::vector<GltfPrimitive> & primitives = asset.getMeshes()[0].m_primitives;
+			const Vertex * view = nullptr;
+			const UINT * indexView = nullptr;
+			UINT count = 0;
+			Assert::IsFalse(asset.getVertexView(primitives[0], view, count));
+			Assert::IsFalse(asset.getIndexView(primitives[0], indexView, count));
+
+			std::vector<Vertex> vertices;
+			Assert::IsTrue(asset.readVertices(primitives[0], vertices));
+			Assert::AreEqual(static_cast<size_t>(4), vertices.size());
+			Assert::AreEqual(-1.0f, vertices[3].m_position.z);
+			Assert::AreEqual(1.0f, vertices[1].m_colour.y);
+			Assert::AreEqual(0.0f, vertices[1].m_colour.x);
+
+			// every other strip triangle turned round
+			std::vector<UINT> indices;
+			Assert::IsTrue(asset.readIndices(primitives[0], 0, indices));
+			const UINT expectedStrip[] = { 0, 1, 2, 1, 3, 2 };
+			Assert::AreEqual(_countof(expectedStrip), indices.size());
+
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				Assert::AreEqual(expectedStrip[i], indices[i]);
+			}
+
+			indices.clear();
+			Assert::IsTrue(asset.readIndices(primitives[1], 10, indices));
+			const UINT expectedFan[] = { 11, 12, 10, 12, 13, 10 };
+
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				Assert::AreEqual(expectedFan[i], indices[i]);
+			}
+
+			// no colours means white, lines can't be made into triangles
+			vertices.clear();
+			Assert::IsTrue(asset.readVertices(primitives[1], vertices));
+			Assert::AreEqual(1.0f, vertices[0].m_colour.x);
+			Assert::IsFalse(asset.readIndices(primitives[2], 0, indices));
+		}
+
+		TEST_METHOD(GltfAsset_readsNodesMaterialsAndImages)
+		{
+			const UINT8 png[] = { 0x89, 'P', 'N', 'G', 13, 10, 26, 10 };
+			const float position[] = { 0.0f, 0.0f, 0.0f };
+
+			std::vector<UINT8> binary;
+			appendData(binary, position, _countof(position));
+			appendData(binary, png, _countof(png));
+
+			// a root turned a quarter about y and moved, its child 5 along z through a column major matrix
+			const std::string json =
+				"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":20}],"
+				"\"bufferViews\":[{\"buffer\":0,\"byteLength\":12},{\"buffer\":0,\"byteOffset\":12,\"byteLength\":8}],"
+				"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":1,\"type\":\"VEC3\"}],"
+				"\"images\":[{\"uri\":\"textures/base%20colour.png\"},{\"bufferView\":1,\"mimeType\":\"image/png\",\"name\":\"normals\"}],"
+				"\"textures\":[{\"source\":1},{\"source\":0}],"
+				"\"materials\":[{\"name\":\"painted\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[0.5,0.25,1,0.75],\"baseColorTexture\":{\"index\":1},\"roughnessFactor\":0.5},"
+				"\"normalTexture\":{\"index\":0},\"alphaMode\":\"MASK\",\"doubleSided\":true},{}],"
+				"\"meshes\":[{\"name\":\"point\",\"primitives\":[{\"attributes\":{\"POSITION\":0},\"material\":0}]}],"
+				"\"nodes\":[{\"name\":\"root\",\"children\":[1],\"translation\":[1,2,3],\"rotation\":[0,0.70710678,0,0.70710678]},"
+				"{\"name\":\"child\",\"mesh\":0,\"matrix\":[1,0,0,0,0,1,0,0,0,0,1,0,0,0,5,1]},{\"name\":\"unused\"}],"
+				"\"scenes\":[{\"nodes\":[0]}]}";
+
+			const std::shared_ptr<std::vector<UINT8>> glb = makeGlb(json, binary);
+
+			AssetFileSystem fileSystem;
+			mount(fileSystem, "scene.glb", glb);
+
+			GltfAsset asset;
+			GltfLoadStats stats;
+			Assert::IsTrue(asset.open(fileSystem, "scene.glb", stats));
+
+			const std::vector<GltfMaterial> & materials = asset.getMaterials();
+			Assert::AreEqual(static_cast<size_t>(2), materials.size());
+			Assert::AreEqual(std::string("painted"), materials[0].m_name);
+			Assert::AreEqual(0.25f, materials[0].m_baseColour.y);
+			Assert::AreEqual(1.0f, materials[0].m_metallic);
+			Assert::AreEqual(0.5f, materials[0].m_roughness);
+			Assert::AreEqual(0.5f, materials[0].m_alphaCutoff);
+			Assert::IsTrue(materials[0].m_doubleSided);
+			Assert::AreEqual(0u, materials[0].m_baseColourImage);
+			Assert::AreEqual(1u, materials[0].m_normalImage);
+			Assert::AreEqual(c_gltfNone, materials[0].m_emissiveImage);
+			Assert::AreEqual(1.0f, materials[1].m_baseColour.w);
+			Assert::AreEqual(0.0f, materials[1].m_alphaCutoff);
+
+			const std::vector<GltfImage> & images = asset.getImages();
+			Assert::AreEqual(std::string("textures/base colour.png"), images[0].m_uri);
+			Assert::IsTrue(images[0].m_data == nullptr);
+			Assert::AreEqual(std::string("image/png"), images[1].m_mimeType);
+			Assert::AreEqual(sizeof(png), images[1].m_size);
+			Assert::AreEqual(0, memcmp(images[1].m_data, png, sizeof(png)));
+
+			const std::vector<GltfNode> & nodes = asset.getNodes();
+			Assert::AreEqual(c_gltfNone, nodes[0].m_parent);
+			Assert::AreEqual(0u, nodes[1].m_parent);
+			Assert::AreEqual(0u, nodes[1].m_mesh);
+			Assert::AreEqual(static_cast<size_t>(1), asset.getSceneRoots().size());
+
+			// right handed the child ends up at (6, 2, 3), mirrored that's (6, 2, -3)
+			std::vector<DirectX::XMFLOAT4X4> world;
+			asset.computeWorldTransforms(world);
+			Assert::AreEqual(static_cast<size_t>(3), world.size());
+			Assert::IsTrue(nearlyEqual(1.0f, world[0]._41) && nearlyEqual(2.0f, world[0]._42) && nearlyEqual(-3.0f, world[0]._43));
+			Assert::IsTrue(nearlyEqual(6.0f, world[1]._41) && nearlyEqual(2.0f, world[1]._42) && nearlyEqual(-3.0f, world[1]._43));
+
+			// right handed the quarter turn takes x to -z and z to +x, mirrored x goes to +z and z to -x
+			Assert::IsTrue(nearlyEqual(1.0f, world[0]._13) && nearlyEqual(0.0f, world[0]._11));
+			Assert::IsTrue(nearlyEqual(-1.0f, world[1]._31) && nearlyEqual(0.0f, world[1]._33));
+			Assert::IsTrue(nearlyEqual(1.0f, world[2]._11) && nearlyEqual(0.0f, world[2]._41));
+		}
+
+		TEST_METHOD(GltfAsset_readsSkinsFromEmbeddedBuffers)
+		{
+			const float positions[] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+			const UINT8 joints[] = { 0, 1, 0, 0, 2, 1, 0, 0 };
+			const float weights[] = { 0.25f, 0.75f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+			// the second joint's bind pose is moved to (1, 2, 3), so its inverse moves back
+			const float inverseBind[] =
+			{
+				1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+				1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, -2.0f, -3.0f, 1.0f,
+				1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f
+			};
+
+			std::vector<UINT8> buffer;
+			appendData(buffer, positions, _countof(positions));
+			appendData(buffer, joints, _countof(joints));
+			appendData(buffer, weights, _countof(weights));
+			appendData(buffer, inverseBind, _countof(inverseBind));
+
+			char header[1024];
+			sprintf_s(header,
+				"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":%zu,\"uri\":\"data:application/octet-stream;base64,",
+				buffer.size());
+
+			const std::string json = std::string(header) + encodeBase64(buffer) + "\"}],"
+				"\"bufferViews\":[{\"buffer\":0,\"byteLength\":24},{\"buffer\":0,\"byteOffset\":24,\"byteLength\":8},"
+				"{\"buffer\":0,\"byteOffset\":32,\"byteLength\":32},{\"buffer\":0,\"byteOffset\":64,\"byteLength\":192}],"
+				"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":2,\"type\":\"VEC3\"},"
+				"{\"bufferView\":1,\"componentType\":5121,\"count\":2,\"type\":\"VEC4\"},"
+				"{\"bufferView\":2,\"componentType\":5126,\"count\":2,\"type\":\"VEC4\"},"
+				"{\"bufferView\":3,\"componentType\":5126,\"count\":3,\"type\":\"MAT4\"}],"
+				"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"JOINTS_0\":1,\"WEIGHTS_0\":2}}]}],"
+				"\"skins\":[{\"joints\":[1,2,3],\"inverseBindMatrices\":3,\"skeleton\":1}],"
+				"\"nodes\":[{\"mesh\":0,\"skin\":0},{\"name\":\"hips\",\"children\":[2,3]},{\"name\":\"left\"},{\"name\":\"right\"}]}";
+
+			const std::shared_ptr<std::vector<UINT8>> text = std::make_shared<std::vector<UINT8>>(json.begin(), json.end());
+
+			AssetFileSystem fileSystem;
+			mount(fileSystem, "skinned.gltf", text);
+
+			GltfAsset asset;
+			GltfLoadStats stats;
+			Assert::IsTrue(asset.open(fileSystem, "skinned.gltf", stats));
+			Assert::AreEqual(2u, static_cast<UINT>(asset.getSceneRoots().size()));
+
+			const GltfSkin & skin = asset.getSkins()[0];
+			Assert::AreEqual(static_cast<size_t>(3), skin.m_joints.size());
+			Assert::AreEqual(1u, skin.m_skeleton);
+			Assert::AreEqual(std::string("left"), asset.getNodes()[skin.m_joints[1]].m_name);
+
+			// heaviest first, quantised to add up to 255
+			std::vector<SkinnedVertex> vertices;
+			Assert::IsTrue(asset.readSkinnedVertices(asset.getMeshes()[0].m_primitives[0], vertices));
+			Assert::AreEqual(static_cast<size_t>(2), vertices.size());
+			Assert::AreEqual(-2.0f, vertices[0].m_position.z);
+			Assert::AreEqual(1, static_cast<int>(vertices[0].m_boneIndices[0]));
+			Assert::AreEqual(0, static_cast<int>(vertices[0].m_boneIndices[1]));
+			Assert::AreEqual(191, static_cast<int>(vertices[0].m_boneWeights[0]));
+			Assert::AreEqual(64, static_cast<int>(vertices[0].m_boneWeights[1]));
+			Assert::AreEqual(2, static_cast<int>(vertices[1].m_boneIndices[0]));
+			Assert::AreEqual(255, static_cast<int>(vertices[1].m_boneWeights[0]));
+
+			std::vector<DirectX::XMFLOAT4X4> inverseBindPose;
+			Assert::IsTrue(asset.readInverseBindMatrices(skin, inverseBindPose));
+			Assert::AreEqual(static_cast<size_t>(3), inverseBindPose.size());
+			Assert::AreEqual(-1.0f, inverseBindPose[1]._41);
+			Assert::AreEqual(-2.0f, inverseBindPose[1]._42);
+			Assert::AreEqual(3.0f, inverseBindPose[1]._43);
+			Assert::AreEqual(1.0f, inverseBindPose[2]._33);
+
+			// no indices means every three vertices are a triangle, two make none
+			const GltfPrimitive & primitive = asset.getMeshes()[0].m_primitives[0];
+			std::vector<UINT> indices;
+			Assert::IsTrue(asset.readIndices(primitive, 0, indices));
+			Assert::AreEqual(static_cast<size_t>(0), indices.size());
+		}
+
+		TEST_METHOD(GltfAsset_rejectsOutOfRangeData)
+		{
+			const float positions[] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+			const UINT outOfRange[] = { 0, 1, 3 };
+
+			std::vector<UINT8> binary;
+			appendData(binary, positions, _countof(positions));
+			appendData(binary, outOfRange, _countof(outOfRange));
+
+			const std::string start = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":48}],";
+			const std::string views = "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36},{\"buffer\":0,\"byteOffset\":36,\"byteLength\":12}],";
+			const std::string accessors = "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+				"{\"bufferView\":1,\"componentType\":5125,\"count\":3,\"type\":\"SCALAR\"}],";
+			const std::string meshes = "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1}]}]";
+
+			const std::string broken[] =
+			{
+				// a view past the end of its buffer
+				start + "\"bufferViews\":[{\"buffer\":0,\"byteLength\":52}]}",
+				// an accessor past the end of its view
+				start + views + "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"}]}",
+				// a stride shorter than an element
+				start + "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36,\"byteStride\":8}],\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":2,\"type\":\"VEC3\"}]}",
+				// not a component type
+				start + views + "\"accessors\":[{\"bufferView\":0,\"componentType\":5124,\"count\":1,\"type\":\"VEC3\"}]}",
+				// a primitive using an accessor that isn't there
+				start + views + accessors + "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":2}}]}]}",
+				// nodes in a loop, and a node with two parents
+				start + "\"nodes\":[{\"children\":[1]},{\"children\":[0]}]}",
+				start + "\"nodes\":[{\"children\":[2]},{\"children\":[2]},{}]}",
+				// needs an extension
+				start + "\"extensionsRequired\":[\"KHR_draco_mesh_compression\"]}",
+				// glTF 1
+				"{\"asset\":{\"version\":\"1.0\"}}",
+				// a buffer bigger than the binary chunk
+				"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":64}]}",
+			};
+
+			AssetFileSystem fileSystem;
+			GltfAsset asset;
+			GltfLoadStats stats;
+
+			for (size_t i = 0; i < _countof(broken); ++i)
+			{
+				mount(fileSystem, "broken.glb", makeGlb(broken[i], binary));
+				Assert::IsFalse(asset.open(fileSystem, "broken.glb", stats));
+				Assert::IsTrue(asset.getAccessors().empty());
+			}
+
+			// the file itself is fine, only the index past the last vertex is refused when it is read
+			mount(fileSystem, "indices.glb", makeGlb(start + views + accessors + meshes + "}", binary));
+			Assert::IsTrue(asset.open(fileSystem, "indices.glb", stats));
+
+			const GltfPrimitive & primitive = asset.getMeshes()[0].m_primitives[0];
+			const UINT * indexView = nullptr;
+			UINT count = 0;
+			std::vector<UINT> indices(2, 7);
+			Assert::IsFalse(asset.getIndexView(primitive, indexView, count));
+			Assert::IsFalse(asset.readIndices(primitive, 0, indices));
+			Assert::AreEqual(static_cast<size_t>(2), indices.size());
+
+			// a .glb that is cut short, or the wrong version
+			std::shared_ptr<std::vector<UINT8>> truncated = makeGlb(start + views + accessors + meshes + "}", binary);
+			truncated->resize(truncated->size() - 4);
+			mount(fileSystem, "truncated.glb", truncated);
+			Assert::IsFalse(asset.open(fileSystem, "truncated.glb", stats));
+
+			std::shared_ptr<std::vector<UINT8>> version = makeGlb(start + views + accessors + meshes + "}", binary);
+			(*version)[4] = 1;
+			mount(fileSystem, "version.glb", version);
+			Assert::IsFalse(asset.open(fileSystem, "version.glb", stats));
+			Assert::IsFalse(asset.open(fileSystem, "missing.glb", stats));
+		}
+
+		TEST_METHOD(GltfAsset_loadsFasterThanParsingTheSameObj)
+		{
+			using namespace std::chrono;
+
+			// a 1000 x 1000 quad grid, ~50 MB as .glb and ~60 MB as .obj
+			std::vector<Vertex> vertices;
+			std::vector<UINT> indices;
+			makeGrid(1000, vertices, indices);
+
+			const std::shared_ptr<std::vector<UINT8>> glb = makeGridGlb(vertices, indices);
+			const std::string obj = makeGridObj(vertices, indices);
+
+			AssetFileSystem fileSystem;
+			mount(fileSystem, "grid.glb", glb);
+
+			// in place, what the upload would read
+			steady_clock::time_point start = steady_clock::now();
+			GltfAsset asset;
+			GltfLoadStats stats;
+			const Vertex * vertexView = nullptr;
+			const UINT * indexView = nullptr;
+			UINT vertexCount = 0;
+			UINT indexCount = 0;
+			Assert::IsTrue(asset.open(fileSystem, "grid.glb", stats));
+			Assert::IsTrue(asset.getVertexView(asset.getMeshes()[0].m_primitives[0], vertexView, vertexCount));
+			Assert::IsTrue(asset.getIndexView(asset.getMeshes()[0].m_primitives[0], indexView, indexCount));
+			const double viewSeconds = duration<double>(steady_clock::now() - start).count();
+
+			// converted, what the engine does with it today
+			start = steady_clock::now();
+			MeshData converted;
+			Assert::IsTrue(asset.readVertices(asset.getMeshes()[0].m_primitives[0], converted.m_vertices));
+			Assert::IsTrue(asset.readIndices(asset.getMeshes()[0].m_primitives[0], 0, converted.m_indices));
+			const double convertSeconds = viewSeconds + duration<double>(steady_clock::now() - start).count();
+			Assert::AreEqual(indices.size(), converted.m_indices.size());
+
+			JobSystem jobSystem(4);
+			ObjLoader loader(jobSystem, fileSystem);
+			ObjMesh mesh;
+			ObjLoadStats objStats;
+			Assert::IsTrue(loader.parse(obj.data(), obj.size(), "", mesh, objStats));
+			Assert::AreEqual(vertices.size(), mesh.m_mesh.m_vertices.size());
+			Assert::AreEqual(indices.size(), mesh.m_mesh.m_indices.size());
+
+			char statsStr[256];
+			sprintf_s(statsStr, "GltfAsset: %u vertices, .glb %.1f MB in place %.2f ms, converted %.2f ms, .obj %.1f MB %.2f ms on %u threads\n",
+				vertexCount, glb->size() / (1024.0 * 1024.0), viewSeconds * 1000.0, convertSeconds * 1000.0,
+				obj.size() / (1024.0 * 1024.0), objStats.m_seconds * 1000.0, objStats.m_threadCount);
+			Logger::WriteMessage(statsStr);
+		}
+	};
+}
@@ -0,0 +1,554 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/IoService.h"
+#include "../DirectX12Engine/Win32IoBackend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	std::vector<UINT8> makeContents(const size_t size, const UINT8 seed)
+	{
+		std::vector<UINT8> contents(size);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			contents[i] = static_cast<UINT8>(seed + i * 7);
+		}
+
+		return contents;
+	}
+
+	void writeFile(const std::string & path, const std::vector<UINT8> & contents)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+	}
+
+	struct SubmittedRead
+	{
+		std::string m_path;
+		UINT64 m_offset;
+		UINT64 m_size;
+	};
+
+	// files in memory, reads complete when the io thread next waits unless it is held
+	class FakeIoBackend : public IoBackend
+	{
+	public:
+		FakeIoBackend()
+			: m_held(false)
+			, m_woken(false)
+		{
+
+		}
+
+		void addFile(const std::string & path, const std::vector<UINT8> & contents)
+		{
+			m_files.push_back(path);
+			m_contents.push_back(contents);
+		}
+
+		void hold()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_held = true;
+		}
+
+		void release()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_held = false;
+			}
+
+			m_changed.notify_all();
+		}
+
+		void waitForSubmitted(const size_t count)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_changed.wait(lock, [&]() { return m_submitted.size() >= count; });
+		}
+
+		std::vector<SubmittedRead> getSubmitted()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_submitted;
+		}
+
+		bool openFile(const std::string & path, IoFileHandle & file, UINT64 & size) override
+		{
+			for (size_t i = 0; i < m_files.size(); ++i)
+			{
+				if (m_files[i] == path)
+				{
+					file = i;
+					size = m_contents[i].size();
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void closeFile(const IoFileHandle file) override
+		{
+		}
+
+		bool submitRead(const IoFileHandle file, const UINT64 offset, const UINT64 size, UINT8 * destination, const UINT64 tag) override
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				Pending pending = { file, offset, size, destination, tag };
+				m_pending.push_back(pending);
+				m_submitted.push_back({ m_files[static_cast<size_t>(file)], offset, size });
+			}
+
+			m_changed.notify_all();
+			return true;
+		}
+
+		void waitForCompletions(std::vector<IoCompletion> & completions) override
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_changed.wait(lock, [&]() { return m_woken || (!m_held && !m_pending.empty()); });
+
+			m_woken = false;
+
+			if (m_held)
+			{
+				return;
+			}
+
+			for (const Pending & pending : m_pending)
+			{
+				memcpy(pending.m_destination, m_contents[static_cast<size_t>(pending.m_file)].data() + pending.m_offset, static_cast<size_t>(pending.m_size));
+				completions.push_back({ pending.m_tag, pending.m_size, true });
+			}
+
+			m_pending.clear();
+		}
+
+		void wake() override
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_woken = true;
+			}
+
+			m_changed.notify_all();
+		}
+
+	private:
+
+		struct Pending
+		{
+			IoFileHandle m_file;
+			UINT64 m_offset;
+			UINT64 m_size;
+			UINT8 * m_destination;
+			UINT64 m_tag;
+		};
+
+		std::vector<std::string> m_files;
+		std::vector<std::vector<UINT8>> m_contents;
+
+		std::mutex m_mutex;
+		std::condition_variable m_changed;
+		std::vector<Pending> m_pending;
+		std::vector<SubmittedRead> m_submitted;
+		bool m_held;
+		bool m_woken;
+	};
+
+	IoRequest makeRequest(const std::string & path, const UINT64 offset, const UINT64 size, const IoPriority priority)
+	{
+		IoRequest request;
+		request.m_path = path;
+		request.m_offset = offset;
+		request.m_size = size;
+		request.m_priority = priority;
+
+		return request;
+	}
+
+	bool matches(const AssetView & view, const std::vector<UINT8> & contents, const size_t offset, const size_t size)
+	{
+		return view.m_size == size && memcmp(view.m_data, contents.data() + offset, size) == 0;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(IoServiceTests)
+	{
+	public:
+
+		TEST_METHOD(IoService_startsReadsInPriorityOrder)
+		{
+			FakeIoBackend backend;
+			backend.addFile("low", makeContents(100, 1));
+			backend.addFile("normal", makeContents(100, 2));
+			backend.addFile("high", makeContents(100, 3));
+
+			IoService service(&backend);
+			service.setLimits(1, 0, 1024);
+
+			// queued before the io thread starts, so it sees all of them at once
+			const IoTicket low = service.enqueue(makeRequest("low", 0, 10, IO_PRIORITY_LOW));
+			const IoTicket normal = service.enqueue(makeRequest("normal", 0, 10, IO_PRIORITY_NORMAL));
+			const IoTicket high = service.enqueue(makeRequest("high", 0, 10, IO_PRIORITY_HIGH));
+
+			service.start();
+
+			AssetView view;
+			Assert::AreEqual(static_cast<int>(IO_STATUS_COMPLETED), static_cast<int>(service.wait(low, view)));
+			Assert::AreEqual(static_cast<int>(IO_STATUS_COMPLETED), static_cast<int>(service.wait(normal, view)));
+			Assert::AreEqual(static_cast<int>(IO_STATUS_COMPLETED), static_cast<int>(service.wait(high, view)));
+
+			const std::vector<SubmittedRead> submitted = backend.getSubmitted();
+			Assert::AreEqual(static_cast<size_t>(3), submitted.size());
+			Assert::AreEqual(std::string("high"), submitted[0].m_path);
+			Assert::AreEqual(std::string("normal"), submitted[1].m_path);
+			Assert::AreEqual(std::string("low"), submitted[2].m_path);
+		}
+
+		TEST_METHOD(IoService_mergesCloseReadsOfOneFile)
+		{
+			const std::vector<UINT8> a = makeContents(20000, 5);
+			const std::vector<UINT8> b = makeContents(300, 9);
+
+			FakeIoBackend backend;
+			backend.addFile("a.bin", a);
+			backend.addFile("b.bin", b);
+
+			IoService service(&backend);
+			service.setLimits(4, 1024, 8192);
+
+			std::vector<IoTicket> tickets;
+			tickets.push_back(service.enqueue(makeRequest("a.bin", 100, 100, IO_PRIORITY_NORMAL)));
+			// adjacent, overlapping and within the gap of the first
+			tickets.push_back(service.enqueue(makeRequest("a.bin", 0, 100, IO_PRIORITY_NORMAL)));
+			tickets.push_back(service.enqueue(makeRequest("a.bin", 150, 150, IO_PRIORITY_LOW)));
+			tickets.push_back(service.enqueue(makeRequest("a.bin", 1000, 50, IO_PRIORITY_NORMAL)));
+			// too far away, and far enough that merging it would go over the limit
+			tickets.push_back(service.enqueue(makeRequest("a.bin", 12000, 10, IO_PRIORITY_NORMAL)));
+			tickets.push_back(service.enqueue(makeRequest("b.bin", 0, c_ioWholeFile, IO_PRIORITY_NORMAL)));
+
+			service.start();
+
+			AssetView views[6];
+
+			for (size_t i = 0; i < tickets.size(); ++i)
+			{
+				Assert::AreEqual(static_cast<int>(IO_STATUS_COMPLETED), static_cast<int>(service.wait(tickets[i], views[i])));
+			}
+
+			Assert::IsTrue(matches(views[0], a, 100, 100));
+			Assert::IsTrue(matches(views[1], a, 0, 100));
+			Assert::IsTrue(matches(views[2], a, 150, 150));
+			Assert::IsTrue(matches(views[3], a, 1000, 50));
+			Assert::IsTrue(matches(views[4], a, 12000, 10));
+			Assert::IsTrue(matches(views[5], b, 0, b.size()));
+
+			// the merged requests share one buffer
+			Assert::IsTrue(views[0].m_owner == views[3].m_owner);
+
+			const IoStats stats = service.getStats();
+			Assert::AreEqual(static_cast<UINT64>(6), stats.m_requests);
+			Assert::AreEqual(static_cast<UINT64>(3), stats.m_reads);
+			Assert::AreEqual(static_cast<UINT64>(3), stats.m_mergedRequests);
+			Assert::AreEqual(static_cast<UINT64>(2), stats.m_filesOpened);
+			Assert::AreEqual(static_cast<UINT64>(1050 + 10 + 300), stats.m_bytesRead);
+
+			const std::vector<SubmittedRead> submitted = backend.getSubmitted();
+			Assert::AreEqual(static_cast<size_t>(3), submitted.size());
+			Assert::AreEqual(static_cast<UINT64>(0), submitted[0].m_offset);
+			Assert::AreEqual(static_cast<UINT64>(1050), submitted[0].m_size);
+		}
+
+		TEST_METHOD(IoService_cancelsQueuedAndInFlightRequests)
+		{
+			FakeIoBackend backend;
+			backend.addFile("first", makeContents(100, 1));
+			backend.addFile("second", makeContents(100, 2));
+			backend.hold();
+
+			IoService service(&backend);
+			service.setLimits(1, 0, 1024);
+
+			std::mutex mutex;
+			std::vector<IoStatus> reported;
+
+			IoRequest inFlight = makeRequest("first", 0, 100, IO_PRIORITY_HIGH);
+			inFlight.m_onComplete = [&](const IoTicket, const IoStatus status, const AssetView & data)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				reported.push_back(status);
+			};
+
+			const IoTicket first = service.enqueue(std::move(inFlight));
+			const IoTicket second = service.enqueue(makeRequest("second", 0, 100, IO_PRIORITY_NORMAL));
+			const IoTicket missing = service.enqueue(makeRequest("missing", 0, 100, IO_PRIORITY_NORMAL));
+
+			service.start();
+			backend.waitForSubmitted(1);
+
+			// the first is with the backend, the second still queued behind it
+			Assert::IsTrue(service.cancel(first));
+			Assert::IsTrue(service.cancel(second));
+			Assert::IsFalse(service.cancel(first));
+
+			AssetView view;
+			Assert::AreEqual(static_cast<int>(IO_STATUS_CANCELLED), static_cast<int>(service.wait(second, view)));
+			Assert::IsTrue(view.m_data == nullptr);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				Assert::IsTrue(reported.empty());
+			}
+
+			backend.release();
+
+			Assert::AreEqual(static_cast<int>(IO_STATUS_FAILED), static_cast<int>(service.wait(missing, view)));
+
+			service.stop();
+
+			Assert::AreEqual(static_cast<size_t>(1), reported.size());
+			Assert::AreEqual(static_cast<int>(IO_STATUS_CANCELLED), static_cast<int>(reported[0]));
+
+			const IoStats stats = service.getStats();
+			Assert::AreEqual(static_cast<UINT64>(2), stats.m_cancelled);
+			Assert::AreEqual(static_cast<UINT64>(1), stats.m_failed);
+			Assert::AreEqual(static_cast<size_t>(1), backend.getSubmitted().size());
+		}
+
+		TEST_METHOD(IoService_failsReadsPastTheEnd)
+		{
+			const std::vector<UINT8> contents = makeContents(100, 4);
+
+			FakeIoBackend backend;
+			backend.addFile("file", contents);
+
+			IoService service(&backend);
+			service.start();
+
+			const IoTicket past = service.enqueue(makeRequest("file", 90, 20, IO_PRIORITY_NORMAL));
+			const IoTicket beyond = service.enqueue(makeRequest("file", 200, c_ioWholeFile, IO_PRIORITY_NORMAL));
+			const IoTicket empty = service.enqueue(makeRequest("file", 100, c_ioWholeFile, IO_PRIORITY_NORMAL));
+			const IoTicket tail = service.enqueue(makeRequest("file", 60, c_ioWholeFile, IO_PRIORITY_NORMAL));
+
+			AssetView view;
+			Assert::AreEqual(static_cast<int>(IO_STATUS_FAILED), static_cast<int>(service.wait(past, view)));
+			Assert::AreEqual(static_cast<int>(IO_STATUS_FAILED), static_cast<int>(service.wait(beyond, view)));
+			Assert::AreEqual(static_cast<int>(IO_STATUS_COMPLETED), static_cast<int>(service.wait(empty, view)));
+			Assert::AreEqual(static_cast<size_t>(0), view.m_size);
+			Assert::AreEqual(static_cast<int>(IO_STATUS_COMPLETED), static_cast<int>(service.wait(tail, view)));
+			Assert::IsTrue(matches(view, contents, 60, 40));
+
+			// collected, so there is nothing left to wait on
+			Assert::AreEqual(static_cast<int>(IO_STATUS_FAILED), static_cast<int>(service.wait(tail, view)));
+		}
+
+		TEST_METHOD(IoService_waitsWhileOtherThreadsEnqueue)
+		{
+			const std::vector<UINT8> contents = makeContents(64, 6);
+
+			FakeIoBackend backend;
+			backend.addFile("file", contents);
+			backend.hold();
+
+			IoService service(&backend);
+			service.start();
+
+			const IoTicket waited = service.enqueue(makeRequest("file", 0, 64, IO_PRIORITY_NORMAL));
+
+			// held in the backend, so the wait below is still asleep while the map grows and rehashes
+			std::atomic<bool> waiting(false);
+			IoStatus status = IO_STATUS_PENDING;
+			AssetView view;
+
+			std::thread waiter([&]()
+			{
+				waiting = true;
+				status = service.wait(waited, view);
+			});
+
+			while (!waiting)
+			{
+				std::this_thread::yield();
+			}
+
+			std::vector<IoTicket> tickets;
+			std::thread enqueuer([&]()
+			{
+				for (UINT i = 0; i < 4096; ++i)
+				{
+					tickets.push_back(service.enqueue(makeRequest("file", i % 64, 1, IO_PRIORITY_LOW)));
+				}
+			});
+
+			enqueuer.join();
+			backend.release();
+			waiter.join();
+
+			Assert::AreEqual(static_cast<int>(IO_STATUS_COMPLETED), static_cast<int>(status));
+			Assert::IsTrue(matches(view, contents, 0, 64));
+
+			for (size_t i = 0; i < tickets.size(); ++i)
+			{
+				AssetView small;
+				Assert::AreEqual(static_cast<int>(IO_STATUS_COMPLETED), static_cast<int>(service.wait(tickets[i], small)));
+				Assert::IsTrue(matches(small, contents, i % 64, 1));
+			}
+		}
+
+		TEST_METHOD(IoService_readsMixedSmallAndLargeFiles)
+		{
+			using namespace std::chrono;
+
+			// a scene's worth of small files and a couple of large ones, the small ones also read in pieces
+			// the way a loader pulls headers before the rest
+			std::vector<std::string> paths;
+			std::vector<std::vector<UINT8>> contents;
+
+			for (UINT i = 0; i < 200; ++i)
+			{
+				paths.push_back("IoServiceTests_small" + std::to_string(i) + ".bin");
+				contents.push_back(makeContents(4000 + i * 10, static_cast<UINT8>(i)));
+				writeFile(paths.back(), contents.back());
+			}
+
+			for (UINT i = 0; i < 2; ++i)
+			{
+				paths.push_back("IoServiceTests_large" + std::to_string(i) + ".bin");
+				contents.push_back(makeContents(32 * 1024 * 1024, static_cast<UINT8>(i)));
+				writeFile(paths.back(), contents.back());
+			}
+
+			// one after another through buffered streams
+			const steady_clock::time_point bufferedStart = steady_clock::now();
+			UINT64 bufferedBytes = 0;
+
+			for (const std::string & path : paths)
+			{
+				std::ifstream file(path, std::ios::binary | std::ios::ate);
+				std::vector<char> data(static_cast<size_t>(file.tellg()));
+				file.seekg(0);
+				file.read(data.data(), data.size());
+				bufferedBytes += data.size();
+			}
+
+			const double bufferedSeconds = duration<double>(steady_clock::now() - bufferedStart).count();
+
+			Win32IoBackend backend;
+			Assert::IsTrue(SUCCEEDED(backend.init()));
+
+			IoService service(&backend);
+			service.start();
+
+			UINT completed = 0;
+			std::atomic<UINT> mismatched(0);
+			std::mutex latencyMutex;
+			std::condition_variable allCompleted;
+			std::vector<double> smallLatencies;
+
+			const steady_clock::time_point serviceStart = steady_clock::now();
+
+			// the large files go in first at low priority, the small ones have to get past them
+			std::vector<IoRequest> requests;
+
+			for (size_t i = 0; i < paths.size(); ++i)
+			{
+				const bool large = contents[i].size() > 1024 * 1024;
+
+				if (large)
+				{
+					requests.push_back(makeRequest(paths[i], 0, c_ioWholeFile, IO_PRIORITY_LOW));
+				}
+				else
+				{
+					requests.push_back(makeRequest(paths[i], 0, 256, IO_PRIORITY_HIGH));
+					requests.push_back(makeRequest(paths[i], 256, c_ioWholeFile, IO_PRIORITY_NORMAL));
+				}
+			}
+
+			std::rotate(requests.begin(), requests.end() - 2, requests.end());
+
+			for (IoRequest & request : requests)
+			{
+				const size_t file = std::find(paths.begin(), paths.end(), request.m_path) - paths.begin();
+				const size_t offset = static_cast<size_t>(request.m_offset);
+				const bool small = request.m_priority != IO_PRIORITY_LOW;
+				const steady_clock::time_point enqueued = steady_clock::now();
+
+				request.m_onComplete = [&, file, offset, small, enqueued](const IoTicket, const IoStatus status, const AssetView & data)
+				{
+					if (status != IO_STATUS_COMPLETED || memcmp(data.m_data, contents[file].data() + offset, data.m_size) != 0)
+					{
+						++mismatched;
+					}
+
+					std::lock_guard<std::mutex> lock(latencyMutex);
+
+					if (small)
+					{
+						smallLatencies.push_back(duration<double>(steady_clock::now() - enqueued).count());
+					}
+
+					++completed;
+					allCompleted.notify_all();
+				};
+
+				service.enqueue(std::move(request));
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(latencyMutex);
+				allCompleted.wait(lock, [&]() { return completed == requests.size(); });
+			}
+
+			const double serviceSeconds = duration<double>(steady_clock::now() - serviceStart).count();
+			const IoStats stats = service.getStats();
+			service.stop();
+
+			for (const std::string & path : paths)
+			{
+				std::remove(path.c_str());
+			}
+
+			backend.shutdown();
+
+			Assert::AreEqual(static_cast<UINT>(requests.size()), completed);
+			Assert::AreEqual(0u, mismatched.load());
+			Assert::AreEqual(bufferedBytes, stats.m_bytesRequested);
+
+			std::sort(smallLatencies.begin(), smallLatencies.end());
+
+			char statsStr[256];
+			sprintf_s(statsStr, "buffered %.1f MB/s, io service %.1f MB/s, %llu requests in %llu reads over %llu files\n",
+				bufferedBytes / (1024.0 * 1024.0) / bufferedSeconds, stats.m_bytesRead / (1024.0 * 1024.0) / serviceSeconds,
+				stats.m_requests, stats.m_reads, stats.m_filesOpened);
+			Logger::WriteMessage(statsStr);
+			sprintf_s(statsStr, "small read latency: median %.3f ms, p99 %.3f ms, max %.3f ms\n",
+				smallLatencies[smallLatencies.size() / 2] * 1000.0, smallLatencies[smallLatencies.size() * 99 / 100] * 1000.0,
+				smallLatencies.back() * 1000.0);
+			Logger::WriteMessage(statsStr);
+		}
+	};
+}
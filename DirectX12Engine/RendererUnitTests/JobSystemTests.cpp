@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/JobSystem.h"
+
+#include <atomic>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(JobSystemTests)
+	{
+	public:
+
+		TEST_METHOD(JobSystem_parallelForVisitsEveryIndexOnce)
+		{
+			JobSystem jobSystem(4);
+
+			std::vector<std::atomic<int>> visits(10007);
+
+			for (size_t i = 0; i < visits.size(); ++i)
+			{
+				visits[i] = 0;
+			}
+
+			jobSystem.parallelFor(visits.size(), 64, [&visits](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					++visits[i];
+				}
+			});
+
+			for (size_t i = 0; i < visits.size(); ++i)
+			{
+				Assert::AreEqual(1, visits[i].load());
+			}
+		}
+
+		TEST_METHOD(JobSystem_nestedParallelForCompletes)
+		{
+			JobSystem jobSystem(2);
+			std::atomic<int> total(0);
+
+			jobSystem.parallelFor(8, 1, [&jobSystem, &total](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					jobSystem.parallelFor(100, 10, [&total](size_t innerBegin, size_t innerEnd)
+					{
+						total += static_cast<int>(innerEnd - innerBegin);
+					});
+				}
+			});
+
+			Assert::AreEqual(800, total.load());
+		}
+
+		TEST_METHOD(JobSystem_waitIdleWaitsForSubmittedJobs)
+		{
+			JobSystem jobSystem(3);
+			std::atomic<int> count(0);
+
+			for (int i = 0; i < 100; ++i)
+			{
+				jobSystem.submit([&count]() { ++count; });
+			}
+
+			jobSystem.waitIdle();
+
+			Assert::AreEqual(100, count.load());
+		}
+	};
+}
@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/Json.h"
+
+#include <cstring>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	bool parse(JsonDocument & document, const std::string & text)
+	{
+		return document.parse(text.data(), text.size());
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(JsonTests)
+	{
+	public:
+
+		TEST_METHOD(Json_parsesNestedDocuments)
+		{
+			const std::string text =
+				"{\n"
+				"\t\"asset\": { \"version\": \"2.0\", \"generator\": \"a \\\"quoted\\\" \\\\ name\\n\" },\n"
+				"\t\"numbers\": [0, -1.5, 2.5e3, 1E-2, 4294967295, 4294967296, 3.25, 9007199254740993],\n"
+				"\t\"flags\": [true, false, null],\n"
+				"\t\"empty\": {}, \"none\": [],\n"
+				"\t\"unicode\": \"\\u00e9\\u20ac\\ud83d\\ude00\",\n"
+				"\t\"esc\\u0061ped\": 7\n"
+				"}";
+
+			JsonDocument document;
+			Assert::IsTrue(parse(document, text));
+
+			const UINT root = document.getRoot();
+			Assert::AreEqual(static_cast<int>(JSON_OBJECT), static_cast<int>(document.getType(root)));
+			Assert::AreEqual(7u, document.getSize(root));
+
+			const UINT asset = document.find(root, "asset");
+			Assert::AreEqual(std::string("2.0"), document.getString(document.find(asset, "version"), std::string()));
+			Assert::AreEqual(std::string("a \"quoted\" \\ name\n"), document.getString(document.find(asset, "generator"), std::string()));
+			Assert::AreEqual(c_jsonNone, document.find(asset, "missing"));
+			Assert::AreEqual(c_jsonNone, document.find(document.find(root, "numbers"), "version"));
+
+			const UINT numbers = document.find(root, "numbers");
+			Assert::AreEqual(8u, document.getSize(numbers));
+			Assert::AreEqual(0.0, document.getNumber(document.getElement(numbers, 0), 1.0));
+			Assert::AreEqual(-1.5, document.getNumber(document.getElement(numbers, 1), 0.0));
+			Assert::AreEqual(2500.0, document.getNumber(document.getElement(numbers, 2), 0.0));
+			Assert::AreEqual(0.01, document.getNumber(document.getElement(numbers, 3), 0.0));
+			Assert::AreEqual(4294967295u, document.getUint(document.getElement(numbers, 4), 0));
+			Assert::AreEqual(9007199254740992.0, document.getNumber(document.getElement(numbers, 7), 0.0));
+			Assert::AreEqual(c_jsonNone, document.getElement(numbers, 8));
+
+			// too big or not whole isn't a UINT
+			Assert::AreEqual(5u, document.getUint(document.getElement(numbers, 5), 5));
+			Assert::AreEqual(5u, document.getUint(document.getElement(numbers, 6), 5));
+			Assert::AreEqual(5u, document.getUint(document.getElement(numbers, 1), 5));
+
+			// walking the children sees the same values as indexing them
+			UINT element = document.getFirstChild(numbers);
+
+			for (UINT i = 0; i < document.getSize(numbers); ++i, element = document.getNextSibling(element))
+			{
+				Assert::AreEqual(document.getElement(numbers, i), element);
+			}
+
+			const UINT flags = document.find(root, "flags");
+			Assert::IsTrue(document.getBool(document.getElement(flags, 0), false));
+			Assert::IsFalse(document.getBool(document.getElement(flags, 1), true));
+			Assert::AreEqual(static_cast<int>(JSON_NULL), static_cast<int>(document.getType(document.getElement(flags, 2))));
+			Assert::IsTrue(document.getBool(document.getElement(flags, 2), true));
+
+			Assert::AreEqual(0u, document.getSize(document.find(root, "empty")));
+			Assert::AreEqual(c_jsonNone, document.getFirstChild(document.find(root, "none")));
+
+			Assert::AreEqual(std::string("\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"), document.getString(document.find(root, "unicode"), std::string()));
+			Assert::AreEqual(7u, document.getUint(document.find(root, "escaped"), 0));
+
+			// the wrong type gives the fallback
+			Assert::AreEqual(std::string("x"), document.getString(numbers, "x"));
+			Assert::AreEqual(3.0, document.getNumber(asset, 3.0));
+			Assert::AreEqual(3.0, document.getNumber(c_jsonNone, 3.0));
+		}
+
+		TEST_METHOD(Json_rejectsMalformedText)
+		{
+			const char * broken[] =
+			{
+				"",
+				"   ",
+				"{",
+				"[1, 2,]",
+				"{\"a\" 1}",
+				"{\"a\": 1,}",
+				"{a: 1}",
+				"[1 2]",
+				"\"unterminated",
+				"\"bad \\x escape\"",
+				"\"short \\u12\"",
+				"\"tab\tinside\"",
+				"-",
+				"1.",
+				"1e",
+				".5",
+				"tru",
+				"nul",
+				"[] []",
+				"{} x"
+			};
+
+			JsonDocument document;
+
+			for (size_t i = 0; i < _countof(broken); ++i)
+			{
+				Assert::IsFalse(document.parse(broken[i], strlen(broken[i])));
+				Assert::AreEqual(c_jsonNone, document.getRoot());
+			}
+
+			// as deep as allowed, then one more
+			const std::string deepest = std::string(c_jsonMaxDepth + 1, '[') + std::string(c_jsonMaxDepth + 1, ']');
+			const std::string tooDeep = std::string(c_jsonMaxDepth + 2, '[') + std::string(c_jsonMaxDepth + 2, ']');
+			Assert::IsTrue(parse(document, deepest));
+			Assert::IsFalse(parse(document, tooDeep));
+
+			// the size is respected, nothing past it is read
+			const char * prefix = "[1, 2]garbage";
+			Assert::IsTrue(document.parse(prefix, 6));
+			Assert::AreEqual(2u, document.getSize(document.getRoot()));
+		}
+	};
+}
@@ -0,0 +1,235 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/JobSystem.h"
+#include "../DirectX12Engine/LodSelector.h"
+#include "../DirectX12Engine/MeshSimplifier.h"
+
+#include <cmath>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// closed lat long sphere, the seam is shared so there are no duplicate positions
+	MeshData makeSphere(const UINT rings, const UINT segments, const float radius)
+	{
+		MeshData mesh;
+
+		Vertex top;
+		top.m_position = DirectX::XMFLOAT3(0.0f, radius, 0.0f);
+		mesh.m_vertices.push_back(top);
+
+		for (UINT r = 1; r < rings; ++r)
+		{
+			const float theta = 3.14159265f * static_cast<float>(r) / static_cast<float>(rings);
+
+			for (UINT s = 0; s < segments; ++s)
+			{
+				const float phi = 2.0f * 3.14159265f * static_cast<float>(s) / static_cast<float>(segments);
+
+				Vertex v;
+				v.m_position = DirectX::XMFLOAT3(
+					radius * std::sin(theta) * std::cos(phi),
+					radius * std::cos(theta),
+					radius * std::sin(theta) * std::sin(phi));
+				mesh.m_vertices.push_back(v);
+			}
+		}
+
+		Vertex bottom;
+		bottom.m_position = DirectX::XMFLOAT3(0.0f, -radius, 0.0f);
+		mesh.m_vertices.push_back(bottom);
+
+		const UINT bottomIndex = static_cast<UINT>(mesh.m_vertices.size() - 1);
+
+		auto ringVertex = [segments](const UINT ring, const UINT segment)
+		{
+			return 1 + (ring - 1) * segments + segment % segments;
+		};
+
+		for (UINT s = 0; s < segments; ++s)
+		{
+			mesh.m_indices.insert(mesh.m_indices.end(), { 0, ringVertex(1, s + 1), ringVertex(1, s) });
+		}
+
+		for (UINT r = 1; r + 1 < rings; ++r)
+		{
+			for (UINT s = 0; s < segments; ++s)
+			{
+				const UINT a = ringVertex(r, s);
+				const UINT b = ringVertex(r, s + 1);
+				const UINT c = ringVertex(r + 1, s);
+				const UINT d = ringVertex(r + 1, s + 1);
+
+				mesh.m_indices.insert(mesh.m_indices.end(), { a, b, c, b, d, c });
+			}
+		}
+
+		for (UINT s = 0; s < segments; ++s)
+		{
+			mesh.m_indices.insert(mesh.m_indices.end(), { bottomIndex, ringVertex(rings - 1, s), ringVertex(rings - 1, s + 1) });
+		}
+
+		return mesh;
+	}
+
+	std::vector<MeshLod> makeLods(const std::vector<float> & errors)
+	{
+		std::vector<MeshLod> lods(errors.size());
+
+		for (size_t i = 0; i < errors.size(); ++i)
+		{
+			lods[i].m_indexOffset = 0;
+			lods[i].m_indexCount = 3;
+			lods[i].m_error = errors[i];
+		}
+
+		return lods;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(LodTests)
+	{
+	public:
+
+		TEST_METHOD(MeshSimplifier_lodChainShrinksWithGrowingError)
+		{
+			MeshData mesh = makeSphere(32, 64, 1.0f);
+			const UINT fullIndexCount = static_cast<UINT>(mesh.m_indices.size());
+
+			MeshSimplifier simplifier;
+			simplifier.buildLodChain(mesh);
+
+			Assert::IsTrue(mesh.m_lods.size() >= 3);
+			Assert::AreEqual(0u, mesh.m_lods[0].m_indexOffset);
+			Assert::AreEqual(fullIndexCount, mesh.m_lods[0].m_indexCount);
+			Assert::AreEqual(0.0f, mesh.m_lods[0].m_error);
+
+			for (size_t i = 1; i < mesh.m_lods.size(); ++i)
+			{
+				const MeshLod & lod = mesh.m_lods[i];
+				const MeshLod & previous = mesh.m_lods[i - 1];
+
+				Assert::AreEqual(previous.m_indexOffset + previous.m_indexCount, lod.m_indexOffset);
+				Assert::IsTrue(lod.m_indexCount < previous.m_indexCount);
+				Assert::IsTrue(lod.m_error >= previous.m_error);
+				// a half edge collapse never moves a vertex off the sphere, the error stays well under the radius
+				Assert::IsTrue(lod.m_error < 0.5f);
+			}
+
+			Assert::AreEqual(mesh.m_lods.back().m_indexOffset + mesh.m_lods.back().m_indexCount, static_cast<UINT>(mesh.m_indices.size()));
+
+			for (size_t i = 0; i < mesh.m_indices.size(); ++i)
+			{
+				Assert::IsTrue(mesh.m_indices[i] < mesh.m_vertices.size());
+			}
+		}
+
+		TEST_METHOD(MeshSimplifier_flatInteriorCollapsesForFree)
+		{
+			// an open flat grid, the border is locked and the interior is coplanar so it costs nothing
+			MeshData mesh;
+			const UINT size = 16;
+
+			for (UINT y = 0; y <= size; ++y)
+			{
+				for (UINT x = 0; x <= size; ++x)
+				{
+					Vertex v;
+					v.m_position = DirectX::XMFLOAT3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+					mesh.m_vertices.push_back(v);
+				}
+			}
+
+			for (UINT y = 0; y < size; ++y)
+			{
+				for (UINT x = 0; x < size; ++x)
+				{
+					const UINT i0 = y * (size + 1) + x;
+					mesh.m_indices.insert(mesh.m_indices.end(), { i0, i0 + size + 1, i0 + 1, i0 + 1, i0 + size + 1, i0 + size + 2 });
+				}
+			}
+
+			MeshSimplifier simplifier;
+			simplifier.buildLodChain(mesh);
+
+			Assert::IsTrue(mesh.m_lods.size() >= 2);
+
+			for (size_t i = 0; i < mesh.m_lods.size(); ++i)
+			{
+				Assert::AreEqual(0.0f, mesh.m_lods[i].m_error, 0.0001f);
+			}
+		}
+
+		TEST_METHOD(MeshSimplifier_buildLodChainsMatchesSingleThreaded)
+		{
+			std::vector<MeshData> meshes;
+
+			for (UINT i = 0; i < 6; ++i)
+			{
+				meshes.push_back(makeSphere(8 + i * 2, 16 + i * 4, 1.0f + static_cast<float>(i)));
+			}
+
+			std::vector<MeshData> expected = meshes;
+
+			MeshSimplifier simplifier;
+
+			for (size_t i = 0; i < expected.size(); ++i)
+			{
+				simplifier.buildLodChain(expected[i]);
+			}
+
+			JobSystem jobSystem(3);
+			simplifier.buildLodChains(meshes, jobSystem);
+
+			for (size_t i = 0; i < meshes.size(); ++i)
+			{
+				Assert::IsTrue(expected[i].m_indices == meshes[i].m_indices);
+				Assert::AreEqual(expected[i].m_lods.size(), meshes[i].m_lods.size());
+			}
+		}
+
+		TEST_METHOD(LodSelector_picksCoarserLevelsFurtherAway)
+		{
+			LodSelector selector;
+			selector.setViewport(1000, 1.0f);
+			selector.setErrorThreshold(1.0f);
+			selector.setHysteresis(0.0f);
+
+			const std::vector<MeshLod> lods = makeLods({ 0.0f, 0.001f, 0.01f, 0.1f });
+
+			const float nearLod = static_cast<float>(selector.selectLod(lods, 0.1f, 0));
+			const float midLod = static_cast<float>(selector.selectLod(lods, 10.0f, 0));
+			const float farLod = static_cast<float>(selector.selectLod(lods, 1000.0f, 0));
+
+			Assert::AreEqual(0.0f, nearLod);
+			Assert::IsTrue(midLod > nearLod);
+			Assert::AreEqual(3.0f, farLod);
+		}
+
+		TEST_METHOD(LodSelector_hysteresisHoldsLevelNearBoundary)
+		{
+			LodSelector selector;
+			selector.setViewport(1000, 1.0f);
+			selector.setErrorThreshold(1.0f);
+			selector.setHysteresis(0.25f);
+
+			const std::vector<MeshLod> lods = makeLods({ 0.0f, 0.01f });
+
+			// find the distance where level 1 projects to exactly the threshold
+			const float boundary = selector.projectedError(0.01f, 1.0f);
+
+			// just past the boundary, coming from full detail, stay on full detail
+			Assert::AreEqual(0u, selector.selectLod(lods, boundary * 1.1f, 0));
+			// well past it, switch
+			Assert::AreEqual(1u, selector.selectLod(lods, boundary * 1.5f, 0));
+			// just inside the boundary, coming from the coarse level, stay coarse
+			Assert::AreEqual(1u, selector.selectLod(lods, boundary * 0.9f, 1));
+			// well inside it, go back to full detail
+			Assert::AreEqual(0u, selector.selectLod(lods, boundary * 0.5f, 1));
+		}
+	};
+}
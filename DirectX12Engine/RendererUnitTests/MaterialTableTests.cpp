@@ -0,0 +1,205 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/MaterialTable.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// one of a few looks, the way exporters copy a material onto every object that uses it
+	MaterialDesc makeMaterial(const UINT look)
+	{
+		MaterialDesc material;
+		material.m_baseColour = DirectX::XMFLOAT4(0.1f * (look % 5), 0.5f, 1.0f, 1.0f);
+		material.m_roughness = look % 2 == 0 ? 0.5f : 0.25f;
+		material.m_textures[MATERIAL_TEXTURE_BASE_COLOUR] = "albedo" + std::to_string(look % 3) + ".png";
+
+		if (look % 4 == 0)
+		{
+			material.m_textures[MATERIAL_TEXTURE_NORMAL] = "normal.png";
+		}
+
+		return material;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(MaterialTableTests)
+	{
+	public:
+
+		TEST_METHOD(MaterialTable_deduplicatesAndPacks)
+		{
+			MaterialTable table;
+			std::vector<UINT> ids;
+
+			// 30 distinct looks over and over
+			for (UINT i = 0; i < 3000; ++i)
+			{
+				ids.push_back(table.add(makeMaterial(i % 30)));
+			}
+
+			Assert::AreEqual(3000u, table.getImportedCount());
+			Assert::AreEqual(30u, table.getMaterialCount());
+
+			for (UINT i = 0; i < ids.size(); ++i)
+			{
+				// ids are handed out in order of first use
+				Assert::AreEqual(i % 30, ids[i]);
+			}
+
+			// -0 and 0 are the same colour
+			MaterialDesc negativeZero = makeMaterial(0);
+			negativeZero.m_baseColour.x = -0.0f;
+			Assert::AreEqual(0u, table.add(negativeZero));
+
+			// a texture counts, so does it being missing
+			MaterialDesc untextured = makeMaterial(0);
+			untextured.m_textures[MATERIAL_TEXTURE_NORMAL].clear();
+			Assert::AreEqual(30u, table.add(untextured));
+
+			// textures are shared by name across materials
+			const std::vector<std::string> & names = table.getTextureNames();
+			Assert::AreEqual(static_cast<size_t>(4), names.size());
+
+			const PackedMaterial & packed = table.getPackedMaterials()[4];
+			Assert::AreEqual(0.4f, packed.m_baseColour.x);
+			Assert::AreEqual(0.5f, packed.m_roughness);
+			Assert::AreEqual(0u, packed.m_flags);
+			Assert::AreEqual(std::string("albedo1.png"), names[packed.m_textures[MATERIAL_TEXTURE_BASE_COLOUR]]);
+			Assert::AreEqual(std::string("normal.png"), names[packed.m_textures[MATERIAL_TEXTURE_NORMAL]]);
+			Assert::AreEqual(c_materialNoTexture, packed.m_textures[MATERIAL_TEXTURE_EMISSIVE]);
+			Assert::AreEqual(c_materialNoTexture, table.getPackedMaterials()[30].m_textures[MATERIAL_TEXTURE_NORMAL]);
+
+			// the state that picks the pipeline goes into the flags
+			MaterialDesc cutout = makeMaterial(1);
+			cutout.m_alphaCutoff = 0.5f;
+			cutout.m_doubleSided = true;
+			const UINT cutoutId = table.add(cutout);
+			Assert::AreEqual(static_cast<UINT>(MATERIAL_FLAG_ALPHA_TESTED | MATERIAL_FLAG_DOUBLE_SIDED), table.getPackedMaterials()[cutoutId].m_flags);
+
+			table.clear();
+			Assert::AreEqual(0u, table.getMaterialCount());
+			Assert::AreEqual(0u, table.add(makeMaterial(7)));
+		}
+
+		TEST_METHOD(MaterialTable_sortsByStateForDrawKeys)
+		{
+			MaterialTable table;
+			std::vector<MaterialDesc> materials;
+
+			for (UINT i = 0; i < 40; ++i)
+			{
+				MaterialDesc material = makeMaterial(i);
+				material.m_doubleSided = i % 7 == 0;
+				material.m_alphaCutoff = i % 5 == 1 ? 0.5f : 0.0f;
+				material.m_baseColour.w = i % 6 == 2 ? 0.5f : 1.0f;
+				materials.push_back(material);
+			}
+
+			std::vector<UINT> ids;
+
+			for (size_t i = 0; i < materials.size(); ++i)
+			{
+				ids.push_back(table.add(materials[i]));
+			}
+
+			const std::vector<PackedMaterial> before = table.getPackedMaterials();
+			std::vector<UINT> remap;
+			table.sortByState(remap);
+
+			Assert::AreEqual(before.size(), remap.size());
+			Assert::AreEqual(before.size(), table.getPackedMaterials().size());
+
+			std::vector<bool> used(remap.size(), false);
+
+			for (size_t i = 0; i < remap.size(); ++i)
+			{
+				// a permutation that moved each material with its id
+				Assert::IsFalse(used[remap[i]]);
+				used[remap[i]] = true;
+				Assert::AreEqual(0, memcmp(&before[i], &table.getPackedMaterials()[remap[i]], sizeof(PackedMaterial)));
+			}
+
+			// the table still finds materials under their new ids
+			for (size_t i = 0; i < materials.size(); ++i)
+			{
+				Assert::AreEqual(remap[ids[i]], table.add(materials[i]));
+			}
+
+			// opaque, double sided, alpha tested then blended, and within a state the same base colour texture together
+			const std::vector<PackedMaterial> & sorted = table.getPackedMaterials();
+
+			for (size_t i = 1; i < sorted.size(); ++i)
+			{
+				const UINT previousRank = (sorted[i - 1].m_flags & MATERIAL_FLAG_BLENDED) ? 3 : (sorted[i - 1].m_flags & MATERIAL_FLAG_ALPHA_TESTED) ? 2 : sorted[i - 1].m_flags;
+				const UINT rank = (sorted[i].m_flags & MATERIAL_FLAG_BLENDED) ? 3 : (sorted[i].m_flags & MATERIAL_FLAG_ALPHA_TESTED) ? 2 : sorted[i].m_flags;
+				Assert::IsTrue(previousRank <= rank);
+
+				if (previousRank == rank)
+				{
+					Assert::IsTrue(sorted[i - 1].m_textures[MATERIAL_TEXTURE_BASE_COLOUR] <= sorted[i].m_textures[MATERIAL_TEXTURE_BASE_COLOUR]);
+				}
+			}
+
+			// opaque draws by material then front to back, blended after them all back to front whatever the material
+			const UINT opaque = 0;
+			UINT blended = 0;
+
+			while (blended < sorted.size() && (sorted[blended].m_flags & MATERIAL_FLAG_BLENDED) == 0)
+			{
+				++blended;
+			}
+
+			Assert::IsTrue(blended > 1 && blended < sorted.size());
+			Assert::IsTrue(table.getSortKey(opaque, 1.0f) < table.getSortKey(opaque, 2.0f));
+			Assert::IsTrue(table.getSortKey(opaque, 1000.0f) < table.getSortKey(opaque + 1, 0.5f));
+			Assert::IsTrue(table.getSortKey(blended - 1, 1000.0f) < table.getSortKey(static_cast<UINT>(sorted.size() - 1), 5000.0f));
+			Assert::IsTrue(table.getSortKey(static_cast<UINT>(sorted.size() - 1), 5.0f) < table.getSortKey(blended, 1.0f));
+			Assert::IsTrue(table.getSortKey(opaque, -3.0f) == table.getSortKey(opaque, 0.0f));
+		}
+
+		TEST_METHOD(MaterialTable_collapsesLargeImports)
+		{
+			// a big scene's worth, every object with its own copy of one of 500 materials
+			using namespace std::chrono;
+
+			std::vector<MaterialDesc> imported;
+
+			for (UINT i = 0; i < 200000; ++i)
+			{
+				imported.push_back(makeMaterial((i * 7919) % 500 + 30));
+				imported.back().m_metallic = static_cast<float>(((i * 7919) % 500) / 30);
+			}
+
+			MaterialTable table;
+			const steady_clock::time_point start = steady_clock::now();
+
+			for (size_t i = 0; i < imported.size(); ++i)
+			{
+				table.add(imported[i]);
+			}
+
+			std::vector<UINT> remap;
+			table.sortByState(remap);
+			const double seconds = duration<double>(steady_clock::now() - start).count();
+
+			Assert::AreEqual(200000u, table.getImportedCount());
+			Assert::AreEqual(500u, table.getMaterialCount());
+
+			char statsStr[256];
+			sprintf_s(statsStr, "MaterialTable: %u imported -> %u unique, %u textures, %u bytes packed, %.1f ms\n",
+				table.getImportedCount(), table.getMaterialCount(), static_cast<UINT>(table.getTextureNames().size()),
+				static_cast<UINT>(sizeof(PackedMaterial) * table.getMaterialCount()), seconds * 1000.0);
+			Logger::WriteMessage(statsStr);
+		}
+	};
+}
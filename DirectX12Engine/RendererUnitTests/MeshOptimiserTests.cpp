@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/MeshOptimiser.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// regular grid of quads, two triangles per quad
+	MeshData makeGrid(const UINT width, const UINT height)
+	{
+		MeshData mesh;
+
+		for (UINT y = 0; y <= height; ++y)
+		{
+			for (UINT x = 0; x <= width; ++x)
+			{
+				Vertex v;
+				v.m_position = DirectX::XMFLOAT3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+				mesh.m_vertices.push_back(v);
+			}
+		}
+
+		for (UINT y = 0; y < height; ++y)
+		{
+			for (UINT x = 0; x < width; ++x)
+			{
+				const UINT i0 = y * (width + 1) + x;
+				const UINT i1 = i0 + 1;
+				const UINT i2 = i0 + width + 1;
+				const UINT i3 = i2 + 1;
+
+				mesh.m_indices.insert(mesh.m_indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+
+		return mesh;
+	}
+
+	void shuffleTriangles(std::vector<UINT> & indices)
+	{
+		std::vector<std::array<UINT, 3>> triangles(indices.size() / 3);
+
+		for (size_t t = 0; t < triangles.size(); ++t)
+		{
+			triangles[t] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+		}
+
+		std::mt19937 rng(1234);
+		std::shuffle(triangles.begin(), triangles.end(), rng);
+
+		for (size_t t = 0; t < triangles.size(); ++t)
+		{
+			indices[t * 3] = triangles[t][0];
+			indices[t * 3 + 1] = triangles[t][1];
+			indices[t * 3 + 2] = triangles[t][2];
+		}
+	}
+
+	// triangles as sorted position triples, rotated so the winding is kept
+	std::vector<std::array<float, 9>> triangleSet(const MeshData & mesh)
+	{
+		std::vector<std::array<float, 9>> triangles;
+
+		for (size_t t = 0; t < mesh.m_indices.size() / 3; ++t)
+		{
+			std::array<UINT, 3> tri = { mesh.m_indices[t * 3], mesh.m_indices[t * 3 + 1], mesh.m_indices[t * 3 + 2] };
+			std::array<float, 9> positions;
+
+			for (size_t c = 0; c < 3; ++c)
+			{
+				const DirectX::XMFLOAT3 & p = mesh.m_vertices[tri[c]].m_position;
+				positions[c * 3] = p.x;
+				positions[c * 3 + 1] = p.y;
+				positions[c * 3 + 2] = p.z;
+			}
+
+			// rotate so the smallest vertex comes first, keeps winding but ignores the start vertex
+			std::array<float, 9> best = positions;
+
+			for (size_t r = 1; r < 3; ++r)
+			{
+				std::array<float, 9> rotated;
+				std::rotate_copy(positions.begin(), positions.begin() + r * 3, positions.end(), rotated.begin());
+				best = std::min(best, rotated);
+			}
+
+			triangles.push_back(best);
+		}
+
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(MeshOptimiserTests)
+	{
+	public:
+
+		TEST_METHOD(MeshOptimiser_analyseVertexCacheCountsMisses)
+		{
+			MeshOptimiser optimiser;
+			optimiser.setCacheSize(3);
+
+			// two triangles sharing an edge, with a cache of 3 only one vertex misses for the second
+			const std::vector<UINT> indices = { 0, 1, 2, 2, 1, 3 };
+			const VertexCacheStats stats = optimiser.analyseVertexCache(indices, 4);
+
+			Assert::AreEqual(4u, stats.m_transformedVertices);
+			Assert::AreEqual(2u, stats.m_triangles);
+			Assert::AreEqual(4u, stats.m_uniqueVertices);
+			Assert::AreEqual(2.0f, stats.m_acmr, 0.0001f);
+			Assert::AreEqual(1.0f, stats.m_atvr, 0.0001f);
+		}
+
+		TEST_METHOD(MeshOptimiser_vertexCacheImprovesShuffledGrid)
+		{
+			MeshData mesh = makeGrid(64, 64);
+			shuffleTriangles(mesh.m_indices);
+
+			MeshOptimiser optimiser;
+			const UINT vertexCount = static_cast<UINT>(mesh.m_vertices.size());
+			const VertexCacheStats before = optimiser.analyseVertexCache(mesh.m_indices, vertexCount);
+
+			const auto trianglesBefore = triangleSet(mesh);
+			optimiser.optimiseVertexCache(mesh.m_indices, vertexCount);
+			const VertexCacheStats after = optimiser.analyseVertexCache(mesh.m_indices, vertexCount);
+
+			Assert::IsTrue(trianglesBefore == triangleSet(mesh));
+			Assert::IsTrue(after.m_acmr < before.m_acmr);
+			// a grid can't go below 0.5, Forsyth should get well under 1.0
+			Assert::IsTrue(after.m_acmr < 0.8f);
+		}
+
+		TEST_METHOD(MeshOptimiser_overdrawKeepsTrianglesAndCacheWithinThreshold)
+		{
+			MeshData mesh = makeGrid(32, 32);
+			shuffleTriangles(mesh.m_indices);
+
+			MeshOptimiser optimiser;
+			const UINT vertexCount = static_cast<UINT>(mesh.m_vertices.size());
+			optimiser.optimiseVertexCache(mesh.m_indices, vertexCount);
+			const VertexCacheStats cacheOptimised = optimiser.analyseVertexCache(mesh.m_indices, vertexCount);
+
+			const auto trianglesBefore = triangleSet(mesh);
+			optimiser.optimiseOverdraw(mesh.m_indices, mesh.m_vertices);
+
+			Assert::IsTrue(trianglesBefore == triangleSet(mesh));
+
+			// the cold cache at each cluster start costs a bit, it shouldn't cost a lot
+			const VertexCacheStats overdrawOptimised = optimiser.analyseVertexCache(mesh.m_indices, vertexCount);
+			Assert::IsTrue(overdrawOptimised.m_acmr < cacheOptimised.m_acmr * 1.5f);
+		}
+
+		TEST_METHOD(MeshOptimiser_vertexFetchIsFirstUseOrder)
+		{
+			MeshData mesh;
+			mesh.m_vertices.resize(5);
+
+			for (UINT v = 0; v < 5; ++v)
+			{
+				mesh.m_vertices[v].m_position = DirectX::XMFLOAT3(static_cast<float>(v), 0.0f, 0.0f);
+			}
+
+			// vertex 1 is never used
+			mesh.m_indices = { 4, 2, 0, 0, 2, 3 };
+
+			MeshOptimiser optimiser;
+			optimiser.optimiseVertexFetch(mesh.m_vertices, mesh.m_indices);
+
+			const std::vector<UINT> expectedIndices = { 0, 1, 2, 2, 1, 3 };
+			Assert::IsTrue(expectedIndices == mesh.m_indices);
+			Assert::AreEqual(static_cast<size_t>(4), mesh.m_vertices.size());
+			Assert::AreEqual(4.0f, mesh.m_vertices[0].m_position.x);
+			Assert::AreEqual(2.0f, mesh.m_vertices[1].m_position.x);
+			Assert::AreEqual(0.0f, mesh.m_vertices[2].m_position.x);
+			Assert::AreEqual(3.0f, mesh.m_vertices[3].m_position.x);
+		}
+
+		TEST_METHOD(MeshOptimiser_optimiseReportsBeforeAndAfter)
+		{
+			MeshData mesh = makeGrid(48, 48);
+			shuffleTriangles(mesh.m_indices);
+
+			const auto trianglesBefore = triangleSet(mesh);
+
+			MeshOptimiser optimiser;
+			const MeshOptimiserReport report = optimiser.optimise(mesh);
+
+			Assert::IsTrue(trianglesBefore == triangleSet(mesh));
+			Assert::AreEqual(report.m_before.m_triangles, report.m_after.m_triangles);
+			Assert::AreEqual(report.m_before.m_uniqueVertices, report.m_after.m_uniqueVertices);
+			Assert::IsTrue(report.m_after.m_acmr < report.m_before.m_acmr);
+			Assert::IsTrue(report.m_after.m_atvr < report.m_before.m_atvr);
+		}
+	};
+}
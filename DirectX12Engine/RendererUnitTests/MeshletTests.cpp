@@ -0,0 +1,189 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/Meshlets.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// flat grid in the z = 0 plane, the triangles face -z (towards a camera looking down +z)
+	MeshData makeGrid(const UINT width, const UINT height)
+	{
+		MeshData mesh;
+
+		for (UINT y = 0; y <= height; ++y)
+		{
+			for (UINT x = 0; x <= width; ++x)
+			{
+				Vertex v;
+				v.m_position = DirectX::XMFLOAT3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+				mesh.m_vertices.push_back(v);
+			}
+		}
+
+		for (UINT y = 0; y < height; ++y)
+		{
+			for (UINT x = 0; x < width; ++x)
+			{
+				const UINT i0 = y * (width + 1) + x;
+				mesh.m_indices.insert(mesh.m_indices.end(), { i0, i0 + width + 1, i0 + 1, i0 + 1, i0 + width + 1, i0 + width + 2 });
+			}
+		}
+
+		return mesh;
+	}
+
+	std::vector<std::array<UINT, 3>> sortedTriangles(const std::vector<UINT> & indices)
+	{
+		std::vector<std::array<UINT, 3>> triangles;
+
+		for (size_t t = 0; t < indices.size() / 3; ++t)
+		{
+			std::array<UINT, 3> tri = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+			// rotate the smallest index to the front, the winding is kept
+			std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()), tri.end());
+			triangles.push_back(tri);
+		}
+
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(MeshletTests)
+	{
+	public:
+
+		TEST_METHOD(MeshletBuilder_meshletsRespectLimitsAndMatchIndexBuffer)
+		{
+			MeshData mesh = makeGrid(40, 40);
+			const auto trianglesBefore = sortedTriangles(mesh.m_indices);
+
+			MeshletBuilder builder;
+			const MeshletData meshlets = builder.build(mesh);
+
+			Assert::IsTrue(trianglesBefore == sortedTriangles(mesh.m_indices));
+			Assert::AreEqual(meshlets.m_meshlets.size(), meshlets.m_bounds.size());
+
+			UINT nextIndex = 0;
+
+			for (size_t m = 0; m < meshlets.m_meshlets.size(); ++m)
+			{
+				const Meshlet & meshlet = meshlets.m_meshlets[m];
+
+				Assert::IsTrue(meshlet.m_vertexCount <= c_meshletMaxVertices);
+				Assert::IsTrue(meshlet.m_triangleCount <= c_meshletMaxTriangles);
+				Assert::IsTrue(meshlet.m_triangleCount > 0);
+
+				// meshlets cover the index buffer in order with no gaps
+				Assert::AreEqual(nextIndex, meshlet.m_indexOffset);
+				nextIndex += meshlet.m_triangleCount * 3;
+
+				// the mesh shader data describes the same triangles as the index buffer range
+				for (UINT i = 0; i < meshlet.m_triangleCount * 3; ++i)
+				{
+					const UINT8 local = meshlets.m_triangles[meshlet.m_triangleOffset * 3 + i];
+					Assert::IsTrue(local < meshlet.m_vertexCount);
+					Assert::AreEqual(mesh.m_indices[meshlet.m_indexOffset + i], meshlets.m_vertices[meshlet.m_vertexOffset + local]);
+				}
+			}
+
+			Assert::AreEqual(static_cast<UINT>(mesh.m_indices.size()), nextIndex);
+
+			// a grid should fill most meshlets to the vertex limit
+			Assert::IsTrue(meshlets.m_meshlets.size() < (mesh.m_indices.size() / 3) / 50);
+		}
+
+		TEST_METHOD(MeshletBuilder_boundsContainVerticesAndConeFacesOut)
+		{
+			MeshData mesh = makeGrid(20, 20);
+
+			MeshletBuilder builder;
+			const MeshletData meshlets = builder.build(mesh);
+
+			for (size_t m = 0; m < meshlets.m_meshlets.size(); ++m)
+			{
+				const Meshlet & meshlet = meshlets.m_meshlets[m];
+				const MeshletBounds & bounds = meshlets.m_bounds[m];
+
+				for (UINT v = 0; v < meshlet.m_vertexCount; ++v)
+				{
+					const DirectX::XMFLOAT3 & p = mesh.m_vertices[meshlets.m_vertices[meshlet.m_vertexOffset + v]].m_position;
+					const float dx = p.x - bounds.m_centre.x;
+					const float dy = p.y - bounds.m_centre.y;
+					const float dz = p.z - bounds.m_centre.z;
+					Assert::IsTrue(dx * dx + dy * dy + dz * dz <= bounds.m_radius * bounds.m_radius * 1.0001f);
+				}
+
+				// every triangle of a flat grid faces the same way, so the cone is a line
+				Assert::AreEqual(-1.0f, bounds.m_coneAxis.z, 0.0001f);
+				Assert::AreEqual(0.0f, bounds.m_coneCutoff, 0.001f);
+			}
+		}
+
+		TEST_METHOD(MeshletCuller_culledFromBehindAndOutsideFrustum)
+		{
+			MeshData mesh = makeGrid(40, 40);
+
+			MeshletBuilder builder;
+			const MeshletData meshlets = builder.build(mesh);
+
+			MeshletCuller culler;
+			std::vector<IndexRange> ranges;
+
+			// in front, everything is drawn as a single range
+			culler.setCameraPosition(DirectX::XMFLOAT3(20.0f, 20.0f, -50.0f));
+			culler.cull(meshlets, ranges);
+			Assert::AreEqual(static_cast<size_t>(1), ranges.size());
+			Assert::AreEqual(0u, ranges[0].m_indexOffset);
+			Assert::AreEqual(static_cast<UINT>(mesh.m_indices.size()), ranges[0].m_indexCount);
+
+			// behind, every meshlet is back facing
+			culler.setCameraPosition(DirectX::XMFLOAT3(20.0f, 20.0f, 50.0f));
+			culler.cull(meshlets, ranges);
+			Assert::IsTrue(ranges.empty());
+
+			// in front again but with a frustum plane keeping only x <= 10
+			const DirectX::XMFLOAT4 planes[6] = {
+				DirectX::XMFLOAT4(-1.0f, 0.0f, 0.0f, 10.0f),
+				DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1000.0f),
+				DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 1000.0f),
+				DirectX::XMFLOAT4(0.0f, -1.0f, 0.0f, 1000.0f),
+				DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 1000.0f),
+				DirectX::XMFLOAT4(0.0f, 0.0f, -1.0f, 1000.0f) };
+
+			culler.setCameraPosition(DirectX::XMFLOAT3(20.0f, 20.0f, -50.0f));
+			culler.setFrustum(planes);
+			culler.cull(meshlets, ranges);
+
+			UINT drawnIndices = 0;
+
+			for (size_t i = 0; i < ranges.size(); ++i)
+			{
+				drawnIndices += ranges[i].m_indexCount;
+
+				// ranges are merged, so they never touch
+				if (i > 0)
+				{
+					Assert::IsTrue(ranges[i - 1].m_indexOffset + ranges[i - 1].m_indexCount < ranges[i].m_indexOffset);
+				}
+			}
+
+			Assert::IsTrue(drawnIndices > 0);
+			Assert::IsTrue(drawnIndices < mesh.m_indices.size());
+
+			for (size_t m = 0; m < meshlets.m_meshlets.size(); ++m)
+			{
+				const MeshletBounds & bounds = meshlets.m_bounds[m];
+				const bool expectedVisible = bounds.m_centre.x - bounds.m_radius <= 10.0f;
+				Assert::AreEqual(expectedVisible, culler.isVisible(bounds));
+			}
+		}
+	};
+}
@@ -0,0 +1,269 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/Morphing.h"
+
+#include <cmath>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// a strip of vertices along x, every target moves its own run of them up y (and tilts their normals)
+	MorphedMeshData makeStrip(const UINT vertexCount, const UINT targetCount, const UINT verticesPerTarget)
+	{
+		MorphedMeshData mesh;
+
+		for (UINT v = 0; v < vertexCount; ++v)
+		{
+			Vertex vertex;
+			vertex.m_position = DirectX::XMFLOAT3(static_cast<float>(v), 0.0f, 0.0f);
+			mesh.m_vertices.push_back(vertex);
+			mesh.m_normals.push_back(DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f));
+		}
+
+		for (UINT t = 0; t < targetCount; ++t)
+		{
+			std::vector<DirectX::XMFLOAT3> positions(vertexCount);
+			std::vector<DirectX::XMFLOAT3> normals(mesh.m_normals);
+
+			for (UINT v = 0; v < vertexCount; ++v)
+			{
+				positions[v] = mesh.m_vertices[v].m_position;
+			}
+
+			const UINT first = (t * verticesPerTarget / 2) % (vertexCount - verticesPerTarget);
+
+			for (UINT v = first; v < first + verticesPerTarget; ++v)
+			{
+				positions[v].y += 1.0f + t * 0.1f;
+				normals[v] = DirectX::XMFLOAT3(0.0f, 0.6f, 0.8f);
+			}
+
+			MorphTarget target;
+			buildMorphTarget(mesh.m_vertices.data(), mesh.m_normals.data(), positions.data(), normals.data(), vertexCount, 0.000001f, target);
+			mesh.m_targets.push_back(target);
+		}
+
+		return mesh;
+	}
+
+	// dense, every target over every vertex, to check the sparse blend against
+	void referenceBlend(const MorphedMeshData & mesh, const std::vector<float> & weights, std::vector<DirectX::XMFLOAT3> & positions)
+	{
+		positions.resize(mesh.m_vertices.size());
+
+		for (size_t v = 0; v < mesh.m_vertices.size(); ++v)
+		{
+			positions[v] = mesh.m_vertices[v].m_position;
+		}
+
+		for (size_t t = 0; t < mesh.m_targets.size(); ++t)
+		{
+			const MorphTarget & target = mesh.m_targets[t];
+
+			for (size_t k = 0; k < target.m_vertices.size(); ++k)
+			{
+				positions[target.m_vertices[k]].x += weights[t] * target.m_positionDeltas[k].x;
+				positions[target.m_vertices[k]].y += weights[t] * target.m_positionDeltas[k].y;
+				positions[target.m_vertices[k]].z += weights[t] * target.m_positionDeltas[k].z;
+			}
+		}
+	}
+
+	void assertMatchesReference(const MorphInstance & instance)
+	{
+		std::vector<DirectX::XMFLOAT3> expected;
+		referenceBlend(*instance.m_mesh, instance.m_weights, expected);
+
+		for (size_t v = 0; v < expected.size(); ++v)
+		{
+			Assert::AreEqual(expected[v].x, instance.m_vertices[v].m_position.x, 1e-5f);
+			Assert::AreEqual(expected[v].y, instance.m_vertices[v].m_position.y, 1e-5f);
+			Assert::AreEqual(expected[v].z, instance.m_vertices[v].m_position.z, 1e-5f);
+		}
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(MorphingTests)
+	{
+	public:
+
+		TEST_METHOD(Morph_targetsOnlyKeepTheVerticesTheyMove)
+		{
+			const MorphedMeshData mesh = makeStrip(100, 3, 10);
+
+			const MorphTarget & target = mesh.m_targets[1];
+			Assert::AreEqual(static_cast<size_t>(10), target.m_vertices.size());
+			Assert::AreEqual(5u, target.m_vertices.front());
+			Assert::AreEqual(14u, target.m_vertices.back());
+			Assert::AreEqual(1.1f, target.m_positionDeltas[0].y, 1e-6f);
+			Assert::AreEqual(0.0f, target.m_positionDeltas[0].w);
+			Assert::AreEqual(0.6f, target.m_normalDeltas[0].y, 1e-6f);
+
+			// no normals given, only the positions are kept
+			std::vector<DirectX::XMFLOAT3> positions(2, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+			positions[1].z = 0.5f;
+
+			MorphTarget positionsOnly;
+			buildMorphTarget(mesh.m_vertices.data(), nullptr, positions.data(), nullptr, 2, 0.000001f, positionsOnly);
+
+			Assert::AreEqual(static_cast<size_t>(1), positionsOnly.m_vertices.size());
+			Assert::AreEqual(1u, positionsOnly.m_vertices[0]);
+			Assert::AreEqual(-1.0f, positionsOnly.m_positionDeltas[0].x);
+			Assert::IsTrue(positionsOnly.m_normalDeltas.empty());
+		}
+
+		TEST_METHOD(Morph_blendMatchesADenseBlend)
+		{
+			const MorphedMeshData mesh = makeStrip(1000, 16, 64);
+
+			MorphInstance instance;
+			instance.setMesh(&mesh);
+
+			std::mt19937 random(7);
+			std::uniform_real_distribution<float> weight(-0.5f, 1.0f);
+
+			for (UINT frame = 0; frame < 20; ++frame)
+			{
+				// about half the targets off each frame
+				for (size_t t = 0; t < instance.m_weights.size(); ++t)
+				{
+					instance.m_weights[t] = (random() % 2) == 0 ? 0.0f : weight(random);
+				}
+
+				MorphBlender::blendInstance(instance);
+				assertMatchesReference(instance);
+			}
+
+			// the normals are renormalised after blending
+			for (size_t v = 0; v < instance.m_normals.size(); ++v)
+			{
+				const DirectX::XMFLOAT3 & normal = instance.m_normals[v];
+				Assert::AreEqual(1.0f, std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z), 1e-5f);
+			}
+		}
+
+		TEST_METHOD(Morph_onlyTheChangedTargetsRangeIsDirty)
+		{
+			const MorphedMeshData mesh = makeStrip(200, 4, 20);
+
+			MorphInstance instance;
+			instance.setMesh(&mesh);
+
+			// the first blend builds everything
+			Assert::AreEqual(static_cast<UINT64>(0), MorphBlender::blendInstance(instance));
+			Assert::AreEqual(0u, instance.m_dirtyBegin);
+			Assert::AreEqual(200u, instance.m_dirtyEnd);
+
+			// nothing changed, nothing to upload
+			MorphBlender::blendInstance(instance);
+			Assert::AreEqual(instance.m_dirtyBegin, instance.m_dirtyEnd);
+
+			// target 2 covers [20, 40), target 1 overlaps it at [10, 30) and is reapplied over the overlap
+			instance.m_weights[1] = 1.0f;
+			MorphBlender::blendInstance(instance);
+			Assert::AreEqual(10u, instance.m_dirtyBegin);
+			Assert::AreEqual(30u, instance.m_dirtyEnd);
+
+			instance.m_weights[2] = 0.5f;
+			Assert::AreEqual(static_cast<UINT64>(20 + 10), MorphBlender::blendInstance(instance));
+			Assert::AreEqual(20u, instance.m_dirtyBegin);
+			Assert::AreEqual(40u, instance.m_dirtyEnd);
+			assertMatchesReference(instance);
+
+			// turning a target off puts its vertices back
+			instance.m_weights[1] = 0.0f;
+			instance.m_weights[2] = 0.0f;
+			MorphBlender::blendInstance(instance);
+			Assert::AreEqual(10u, instance.m_dirtyBegin);
+			Assert::AreEqual(40u, instance.m_dirtyEnd);
+			Assert::AreEqual(0.0f, instance.m_vertices[25].m_position.y);
+
+			// too small to see, so it doesn't count as a change
+			instance.m_weights[3] = 0.00001f;
+			MorphBlender::blendInstance(instance);
+			Assert::AreEqual(instance.m_dirtyBegin, instance.m_dirtyEnd);
+		}
+
+		TEST_METHOD(Morph_blendsManyMeshesOnTheJobSystem)
+		{
+			const UINT targetCount = 32;
+			const MorphedMeshData mesh = makeStrip(4000, targetCount, 400);
+
+			JobSystem jobSystem(4);
+			MorphBlender blender(jobSystem);
+
+			// the cost follows the active targets, the ones with no weight are never touched
+			UINT64 previousDeltas = 0;
+			const UINT activeCounts[] = { 0, 1, 4, 16, 32 };
+
+			for (size_t a = 0; a < sizeof(activeCounts) / sizeof(activeCounts[0]); ++a)
+			{
+				std::vector<MorphInstance> instances(64);
+
+				for (size_t i = 0; i < instances.size(); ++i)
+				{
+					instances[i].setMesh(&mesh);
+				}
+
+				// builds the base mesh, then every blend after it starts from there
+				MorphStats stats;
+				blender.blend(instances, stats);
+
+				for (size_t i = 0; i < instances.size(); ++i)
+				{
+					for (UINT t = 0; t < activeCounts[a]; ++t)
+					{
+						instances[i].m_weights[t] = 0.25f + (i % 4) * 0.25f;
+					}
+				}
+
+				blender.blend(instances, stats);
+
+				char statsStr[256];
+				sprintf_s(statsStr, "%u active targets: %llu deltas, %llu dirty vertices in %.3f ms on %u threads, %.1f M deltas/s",
+					activeCounts[a], stats.m_deltas, stats.m_dirtyVertices, stats.m_seconds * 1000.0, stats.m_threadCount, stats.deltasPerSecond() / 1000000.0);
+				Logger::WriteMessage(statsStr);
+
+				Assert::AreEqual(static_cast<UINT64>(64 * activeCounts[a]), stats.m_activeTargets);
+				Assert::AreEqual(static_cast<UINT64>(64 * 400 * activeCounts[a]), stats.m_deltas);
+				Assert::IsTrue(activeCounts[a] == 0 || stats.m_deltas > previousDeltas);
+				Assert::AreEqual(5u, stats.m_threadCount);
+				previousDeltas = stats.m_deltas;
+
+				for (size_t i = 0; i < instances.size(); i += 7)
+				{
+					assertMatchesReference(instances[i]);
+				}
+			}
+		}
+
+		TEST_METHOD(Morph_weightTrackInterpolatesBetweenKeys)
+		{
+			MorphWeightTrack track;
+			track.m_times = { 0.0f, 1.0f, 3.0f };
+			track.m_weights = { 0.0f, 1.0f,  1.0f, 0.0f,  0.5f, 0.5f };
+
+			float weights[2];
+
+			track.sample(-1.0f, weights);
+			Assert::AreEqual(0.0f, weights[0]);
+			Assert::AreEqual(1.0f, weights[1]);
+
+			track.sample(0.25f, weights);
+			Assert::AreEqual(0.25f, weights[0], 1e-6f);
+			Assert::AreEqual(0.75f, weights[1], 1e-6f);
+
+			track.sample(2.0f, weights);
+			Assert::AreEqual(0.75f, weights[0], 1e-6f);
+			Assert::AreEqual(0.25f, weights[1], 1e-6f);
+
+			track.sample(10.0f, weights);
+			Assert::AreEqual(0.5f, weights[0]);
+		}
+	};
+}
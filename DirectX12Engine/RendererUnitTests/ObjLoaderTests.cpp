@@ -0,0 +1,327 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/ObjLoader.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// TestCube.obj and TestCube.mtl as Blender wrote them
+	const char * const c_testCubeObj =
+		"# Blender v2.79 (sub 0) OBJ File: ''\n"
+		"# www.blender.org\n"
+		"mtllib TestCube.mtl\n"
+		"o Cube\n"
+		"v 1.000000 -1.000000 -1.000000\n"
+		"v 1.000000 -1.000000 1.000000\n"
+		"v -1.000000 -1.000000 1.000000\n"
+		"v -1.000000 -1.000000 -1.000000\n"
+		"v 1.000000 1.000000 -0.999999\n"
+		"v 0.999999 1.000000 1.000001\n"
+		"v -1.000000 1.000000 1.000000\n"
+		"v -1.000000 1.000000 -1.000000\n"
+		"vn 0.0000 -1.0000 0.0000\n"
+		"vn 0.0000 1.0000 0.0000\n"
+		"vn 1.0000 0.0000 0.0000\n"
+		"vn -0.0000 -0.0000 1.0000\n"
+		"vn -1.0000 -0.0000 -0.0000\n"
+		"vn 0.0000 0.0000 -1.0000\n"
+		"usemtl Material\n"
+		"s off\n"
+		"f 1//1 2//1 3//1 4//1\n"
+		"f 5//2 8//2 7//2 6//2\n"
+		"f 1//3 5//3 6//3 2//3\n"
+		"f 2//4 6//4 7//4 3//4\n"
+		"f 3//5 7//5 8//5 4//5\n"
+		"f 5//6 1//6 4//6 8//6\n";
+
+	const char * const c_testCubeMtl =
+		"# Blender MTL File: 'None'\n"
+		"# Material Count: 1\n"
+		"\n"
+		"newmtl Material\n"
+		"Ns 96.078431\n"
+		"Ka 1.000000 1.000000 1.000000\n"
+		"Kd 0.640000 0.640000 0.640000\n"
+		"Ks 0.500000 0.500000 0.500000\n"
+		"Ke 0.000000 0.000000 0.000000\n"
+		"Ni 1.000000\n"
+		"d 1.000000\n"
+		"illum 2\n";
+
+	bool sameFloat3(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	// a grid of quads, every other row through relative indices and switching material every few rows
+	std::string makeGrid(const UINT size, const bool relative)
+	{
+		std::string text = "mtllib grid.mtl\n";
+		char line[128];
+
+		for (UINT y = 0; y <= size; ++y)
+		{
+			for (UINT x = 0; x <= size; ++x)
+			{
+				sprintf_s(line, "v %.4f %.4f %.4f\nvt %.4f %.4f\n", x * 0.5f, y * 0.25f, (x ^ y) * 0.125f, x / static_cast<float>(size), y / static_cast<float>(size));
+				text += line;
+			}
+		}
+
+		text += "vn 0 0 1\n";
+
+		const UINT positions = (size + 1) * (size + 1);
+
+		for (UINT y = 0; y < size; ++y)
+		{
+			if (y % 3 == 0)
+			{
+				text += (y / 3) % 2 == 0 ? "usemtl red\n" : "usemtl blue\n";
+			}
+
+			for (UINT x = 0; x < size; ++x)
+			{
+				const UINT corner = y * (size + 1) + x + 1;
+
+				if (relative)
+				{
+					// everything has been read by now, so -n is positions - n + 1
+					const int a = static_cast<int>(corner) - static_cast<int>(positions) - 1;
+					sprintf_s(line, "f %d/%d/-1 %d/%d/-1 %d/%d/-1 %d/%d/-1\n", a, a, a + 1, a + 1, a + static_cast<int>(size) + 2, a + static_cast<int>(size) + 2,
+						a + static_cast<int>(size) + 1, a + static_cast<int>(size) + 1);
+				}
+				else
+				{
+					sprintf_s(line, "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", corner, corner, corner + 1, corner + 1, corner + size + 2, corner + size + 2,
+						corner + size + 1, corner + size + 1);
+				}
+
+				text += line;
+			}
+		}
+
+		return text;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(ObjLoaderTests)
+	{
+	public:
+
+		TEST_METHOD(ObjLoader_parsesFloatsLikeStrtof)
+		{
+			const char * numbers[] =
+			{
+				"1.000000", "-0.999999", "0.1", "1e-5", "+12.5E+2", ".5", "5.", "-.25", "0.0000001234", "3.4028234e38",
+				"123456789012345678901234", "1.00000000000000000000000001", "7", "-0"
+			};
+
+			for (size_t i = 0; i < _countof(numbers); ++i)
+			{
+				const char * text = numbers[i];
+				const char * end = text + strlen(text);
+				float value = 0.0f;
+
+				Assert::IsTrue(ObjLoader::parseFloat(text, end, value));
+				Assert::IsTrue(text == end);
+
+				// within a unit in the last place of the correctly rounded value
+				const float expected = strtof(numbers[i], nullptr);
+				Assert::IsTrue(std::fabs(value - expected) <= std::fabs(expected) * 1.2e-7f);
+			}
+
+			// stops at what isn't part of the number
+			const char * line = "  2.5 -3e1x";
+			const char * end = line + strlen(line);
+			float value = 0.0f;
+			Assert::IsTrue(ObjLoader::parseFloat(line, end, value));
+			Assert::AreEqual(2.5f, value);
+			Assert::IsTrue(ObjLoader::parseFloat(line, end, value));
+			Assert::AreEqual(-30.0f, value);
+			Assert::AreEqual('x', *line);
+
+			const char * notANumber = " -x";
+			Assert::IsFalse(ObjLoader::parseFloat(notANumber, notANumber + 3, value));
+		}
+
+		TEST_METHOD(ObjLoader_matchesAssimpOnTheTestCube)
+		{
+			JobSystem jobSystem(2);
+			AssetFileSystem fileSystem;
+
+			const std::shared_ptr<std::string> mtl = std::make_shared<std::string>(c_testCubeMtl);
+			fileSystem.mount("models/TestCube.mtl", reinterpret_cast<const UINT8*>(mtl->data()), mtl->size(), mtl);
+
+			ObjLoader loader(jobSystem, fileSystem);
+			ObjMesh mesh;
+			ObjLoadStats stats;
+			Assert::IsTrue(loader.parse(c_testCubeObj, strlen(c_testCubeObj), "models", mesh, stats));
+
+			// what the engine got out of Assimp with aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
+			// aiProcess_MakeLeftHanded: a vertex per face corner as no two faces share a normal, each quad fanned
+			// from its first corner, z mirrored and the winding left alone
+			Assert::AreEqual(static_cast<size_t>(24), mesh.m_mesh.m_vertices.size());
+			Assert::AreEqual(static_cast<size_t>(36), mesh.m_mesh.m_indices.size());
+
+			for (UINT face = 0; face < 6; ++face)
+			{
+				const UINT expected[6] = { face * 4, face * 4 + 1, face * 4 + 2, face * 4, face * 4 + 2, face * 4 + 3 };
+
+				for (UINT i = 0; i < 6; ++i)
+				{
+					Assert::AreEqual(expected[i], mesh.m_mesh.m_indices[face * 6 + i]);
+				}
+			}
+
+			Assert::IsTrue(sameFloat3(DirectX::XMFLOAT3(1.0f, -1.0f, 1.0f), mesh.m_mesh.m_vertices[0].m_position));
+			Assert::IsTrue(sameFloat3(DirectX::XMFLOAT3(1.0f, -1.0f, -1.0f), mesh.m_mesh.m_vertices[1].m_position));
+			Assert::IsTrue(sameFloat3(DirectX::XMFLOAT3(1.0f, 1.0f, 0.999999f), mesh.m_mesh.m_vertices[4].m_position));
+			Assert::IsTrue(sameFloat3(DirectX::XMFLOAT3(0.999999f, 1.0f, -1.000001f), mesh.m_mesh.m_vertices[7].m_position));
+
+			Assert::AreEqual(static_cast<size_t>(24), mesh.m_normals.size());
+			Assert::IsTrue(sameFloat3(DirectX::XMFLOAT3(0.0f, -1.0f, 0.0f), mesh.m_normals[0]));
+			Assert::IsTrue(sameFloat3(DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f), mesh.m_normals[12]));
+			Assert::IsTrue(sameFloat3(DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f), mesh.m_normals[20]));
+			Assert::IsTrue(mesh.m_texCoords.empty());
+
+			Assert::AreEqual(static_cast<size_t>(1), mesh.m_materials.size());
+			Assert::AreEqual(std::string("Material"), mesh.m_materials[0].m_name);
+			Assert::AreEqual(0.64f, mesh.m_materials[0].m_diffuse.x);
+			Assert::AreEqual(0.5f, mesh.m_materials[0].m_specular.y);
+			Assert::AreEqual(96.078431f, mesh.m_materials[0].m_shininess);
+
+			Assert::AreEqual(static_cast<size_t>(1), mesh.m_submeshes.size());
+			Assert::AreEqual(0u, mesh.m_submeshes[0].m_material);
+			Assert::AreEqual(36u, mesh.m_submeshes[0].m_indexCount);
+
+			Assert::AreEqual(8u, stats.m_positions);
+			Assert::AreEqual(12u, stats.m_triangles);
+		}
+
+		TEST_METHOD(ObjLoader_givesTheSameMeshWhateverTheChunking)
+		{
+			const std::string absolute = makeGrid(40, false);
+			const std::string relative = makeGrid(40, true);
+			const std::string mtl = "newmtl red\nKd 1 0 0\nmap_Kd -bm 1 textures/red.png\n\nnewmtl blue\nKd 0 0 1\n";
+
+			JobSystem jobSystem(3);
+			AssetFileSystem fileSystem;
+			fileSystem.mount("grid.mtl", reinterpret_cast<const UINT8*>(mtl.data()), mtl.size(), nullptr);
+
+			ObjLoader loader(jobSystem, fileSystem);
+			ObjMesh whole;
+			ObjLoadStats stats;
+			Assert::IsTrue(loader.parse(absolute.data(), absolute.size(), "", whole, stats));
+			Assert::AreEqual(1u, stats.m_chunks);
+
+			// chunks of a few lines each, so faces reach back over many chunks
+			loader.setChunkSize(200);
+
+			for (UINT pass = 0; pass < 2; ++pass)
+			{
+				const std::string & text = pass == 0 ? absolute : relative;
+
+				ObjMesh chunked;
+				Assert::IsTrue(loader.parse(text.data(), text.size(), "", chunked, stats));
+				Assert::IsTrue(stats.m_chunks > 100);
+
+				Assert::AreEqual(whole.m_mesh.m_vertices.size(), chunked.m_mesh.m_vertices.size());
+				Assert::IsTrue(whole.m_mesh.m_indices == chunked.m_mesh.m_indices);
+
+				for (size_t v = 0; v < whole.m_mesh.m_vertices.size(); ++v)
+				{
+					Assert::IsTrue(sameFloat3(whole.m_mesh.m_vertices[v].m_position, chunked.m_mesh.m_vertices[v].m_position));
+					Assert::AreEqual(whole.m_texCoords[v].x, chunked.m_texCoords[v].x);
+				}
+			}
+
+			// every position is used with its own texture coordinate and the one normal
+			Assert::AreEqual(static_cast<size_t>(41 * 41), whole.m_mesh.m_vertices.size());
+			Assert::AreEqual(static_cast<size_t>(40 * 40 * 6), whole.m_mesh.m_indices.size());
+
+			// the red rows then the blue ones, each in file order
+			Assert::AreEqual(static_cast<size_t>(2), whole.m_materials.size());
+			Assert::AreEqual(std::string("textures/red.png"), whole.m_materials[0].m_diffuseMap);
+			Assert::AreEqual(static_cast<size_t>(2), whole.m_submeshes.size());
+			Assert::AreEqual(0u, whole.m_submeshes[0].m_material);
+			Assert::AreEqual(21u * 40 * 6, whole.m_submeshes[0].m_indexCount);
+			Assert::AreEqual(whole.m_submeshes[0].m_indexCount, whole.m_submeshes[1].m_indexOffset);
+			Assert::AreEqual(19u * 40 * 6, whole.m_submeshes[1].m_indexCount);
+
+			// the first blue triangle starts at the first corner of the fourth row
+			const Vertex & firstBlue = whole.m_mesh.m_vertices[whole.m_mesh.m_indices[whole.m_submeshes[1].m_indexOffset]];
+			Assert::IsTrue(sameFloat3(DirectX::XMFLOAT3(0.0f, 0.75f, -0.375f), firstBlue.m_position));
+		}
+
+		TEST_METHOD(ObjLoader_rejectsBrokenFaces)
+		{
+			JobSystem jobSystem(1);
+			AssetFileSystem fileSystem;
+			ObjLoader loader(jobSystem, fileSystem);
+			ObjMesh mesh;
+			ObjLoadStats stats;
+
+			const char * outOfRange = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n";
+			Assert::IsFalse(loader.parse(outOfRange, strlen(outOfRange), "", mesh, stats));
+
+			const char * beforeTheStart = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf -1 -2 -4\n";
+			Assert::IsFalse(loader.parse(beforeTheStart, strlen(beforeTheStart), "", mesh, stats));
+
+			const char * notAnIndex = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 x\n";
+			Assert::IsFalse(loader.parse(notAnIndex, strlen(notAnIndex), "", mesh, stats));
+
+			// faces before any usemtl get a default material, and a missing library isn't fatal
+			const char * noMaterial = "mtllib missing.mtl\r\nv 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nf 1 2 3\r\nl 1 2\r\n";
+			Assert::IsTrue(loader.parse(noMaterial, strlen(noMaterial), "", mesh, stats));
+			Assert::AreEqual(static_cast<size_t>(3), mesh.m_mesh.m_indices.size());
+			Assert::AreEqual(static_cast<size_t>(1), mesh.m_materials.size());
+			Assert::AreEqual(std::string("DefaultMaterial"), mesh.m_materials[0].m_name);
+		}
+
+		TEST_METHOD(ObjLoader_parsesLargeFilesAcrossCores)
+		{
+			using namespace std::chrono;
+
+			// ~120 MB of positions, texture coordinates and quads
+			const std::string text = makeGrid(1100, false);
+
+			AssetFileSystem fileSystem;
+			double seconds[2] = { 0.0, 0.0 };
+			UINT threads[2] = { 0, 0 };
+			ObjLoadStats stats;
+
+			for (UINT pass = 0; pass < 2; ++pass)
+			{
+				JobSystem jobSystem(pass == 0 ? 1 : 4);
+				ObjLoader loader(jobSystem, fileSystem);
+				ObjMesh mesh;
+
+				Assert::IsTrue(loader.parse(text.data(), text.size(), "", mesh, stats));
+				Assert::AreEqual(1101u * 1101u, stats.m_vertices);
+				Assert::AreEqual(1100u * 1100u * 2u, stats.m_triangles);
+
+				seconds[pass] = stats.m_seconds;
+				threads[pass] = stats.m_threadCount;
+			}
+
+			char statsStr[256];
+			sprintf_s(statsStr, "ObjLoader: %.1f MB, %u threads %.1f MB/s, %u threads %.1f MB/s, %u chunks\n",
+				text.size() / (1024.0 * 1024.0), threads[0], text.size() / (1024.0 * 1024.0) / seconds[0],
+				threads[1], text.size() / (1024.0 * 1024.0) / seconds[1], stats.m_chunks);
+			Logger::WriteMessage(statsStr);
+		}
+	};
+}
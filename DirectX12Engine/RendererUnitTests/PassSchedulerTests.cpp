@@ -0,0 +1,244 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/PassScheduler.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	PassDesc makePass(const char * name, const bool async, const std::vector<UINT> & reads, const std::vector<UINT> & writes)
+	{
+		PassDesc desc;
+		desc.m_name = name;
+		desc.m_asyncComputeEligible = async;
+		desc.m_reads = reads;
+		desc.m_writes = writes;
+		return desc;
+	}
+
+	// replays the schedule the way the GPU would see it, tracking which passes on each queue are known
+	// to be done before each pass starts. fails if a dependency isn't covered or a wait adds nothing
+	void checkSchedule(const PassSchedule & schedule, const std::vector<std::vector<PassHandle>> & dependencies)
+	{
+		const size_t passCount = schedule.m_passes.size();
+
+		std::vector<UINT> positions(passCount);
+		UINT queueLengths[QUEUE_COUNT] = {};
+		// signal value -> pass, per queue
+		std::vector<PassHandle> signallers[QUEUE_COUNT];
+
+		for (size_t p = 0; p < passCount; ++p)
+		{
+			const ScheduledPass & scheduled = schedule.m_passes[p];
+			positions[p] = ++queueLengths[scheduled.m_queue];
+
+			if (scheduled.m_signalValue != 0)
+			{
+				// signal values count up from 1 on each queue
+				Assert::AreEqual(static_cast<UINT64>(signallers[scheduled.m_queue].size() + 1), scheduled.m_signalValue);
+				signallers[scheduled.m_queue].push_back(static_cast<PassHandle>(p));
+			}
+		}
+
+		std::vector<std::vector<UINT>> known(passCount, std::vector<UINT>(QUEUE_COUNT, 0));
+		std::vector<UINT> queueKnown[QUEUE_COUNT];
+
+		for (UINT q = 0; q < QUEUE_COUNT; ++q)
+		{
+			queueKnown[q].assign(QUEUE_COUNT, 0);
+		}
+
+		for (size_t p = 0; p < passCount; ++p)
+		{
+			const ScheduledPass & scheduled = schedule.m_passes[p];
+			std::vector<UINT> clock = queueKnown[scheduled.m_queue];
+
+			for (size_t w = 0; w < scheduled.m_waits.size(); ++w)
+			{
+				const FenceWait & wait = scheduled.m_waits[w];
+				Assert::IsTrue(wait.m_queue != scheduled.m_queue);
+				Assert::IsTrue(wait.m_fenceValue >= 1 && wait.m_fenceValue <= signallers[wait.m_queue].size());
+
+				const PassHandle signaller = signallers[wait.m_queue][static_cast<size_t>(wait.m_fenceValue - 1)];
+				Assert::IsTrue(signaller < p);
+
+				// a wait that is already covered is a wasted fence
+				Assert::IsTrue(positions[signaller] > clock[wait.m_queue]);
+
+				for (UINT q = 0; q < QUEUE_COUNT; ++q)
+				{
+					clock[q] = std::max(clock[q], known[signaller][q]);
+				}
+			}
+
+			for (size_t d = 0; d < dependencies[p].size(); ++d)
+			{
+				const PassHandle dependency = dependencies[p][d];
+				Assert::IsTrue(positions[dependency] <= clock[schedule.m_passes[dependency].m_queue]
+					|| schedule.m_passes[dependency].m_queue == scheduled.m_queue);
+			}
+
+			clock[scheduled.m_queue] = positions[p];
+			known[p] = clock;
+			queueKnown[scheduled.m_queue] = clock;
+		}
+
+		// every signal is waited on by someone
+		for (UINT q = 0; q < QUEUE_COUNT; ++q)
+		{
+			Assert::AreEqual(static_cast<UINT64>(signallers[q].size()), schedule.m_signalCount[q]);
+		}
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(PassSchedulerTests)
+	{
+	public:
+
+		TEST_METHOD(PassScheduler_asyncDisabledUsesOneQueue)
+		{
+			PassScheduler scheduler;
+			scheduler.setAsyncComputeEnabled(false);
+
+			scheduler.addPass(makePass("cull", true, {}, { 0 }));
+			scheduler.addPass(makePass("draw", false, { 0 }, { 1 }));
+			scheduler.addPass(makePass("post", true, { 1 }, { 2 }));
+
+			const PassSchedule schedule = scheduler.compile();
+
+			Assert::AreEqual(static_cast<size_t>(3), schedule.m_passes.size());
+
+			for (size_t p = 0; p < schedule.m_passes.size(); ++p)
+			{
+				Assert::IsTrue(schedule.m_passes[p].m_queue == QUEUE_GRAPHICS);
+				Assert::IsTrue(schedule.m_passes[p].m_waits.empty());
+				Assert::AreEqual(static_cast<UINT64>(0), schedule.m_passes[p].m_signalValue);
+			}
+
+			Assert::AreEqual(0u, schedule.m_waitCount);
+		}
+
+		TEST_METHOD(PassScheduler_crossQueueDependenciesGetFences)
+		{
+			PassScheduler scheduler;
+
+			// skinning on compute feeds the graphics pass, post on compute reads what graphics drew
+			const PassHandle skin = scheduler.addPass(makePass("skin", true, {}, { 0 }));
+			const PassHandle draw = scheduler.addPass(makePass("draw", false, { 0 }, { 1 }));
+			const PassHandle post = scheduler.addPass(makePass("post", true, { 1 }, { 2 }));
+
+			const PassSchedule schedule = scheduler.compile();
+
+			Assert::IsTrue(schedule.m_passes[skin].m_queue == QUEUE_ASYNC_COMPUTE);
+			Assert::IsTrue(schedule.m_passes[draw].m_queue == QUEUE_GRAPHICS);
+			Assert::IsTrue(schedule.m_passes[post].m_queue == QUEUE_ASYNC_COMPUTE);
+
+			Assert::AreEqual(static_cast<UINT64>(1), schedule.m_passes[skin].m_signalValue);
+			Assert::AreEqual(static_cast<size_t>(1), schedule.m_passes[draw].m_waits.size());
+			Assert::IsTrue(schedule.m_passes[draw].m_waits[0].m_queue == QUEUE_ASYNC_COMPUTE);
+			Assert::AreEqual(static_cast<UINT64>(1), schedule.m_passes[draw].m_waits[0].m_fenceValue);
+
+			Assert::AreEqual(static_cast<UINT64>(1), schedule.m_passes[draw].m_signalValue);
+			Assert::AreEqual(static_cast<size_t>(1), schedule.m_passes[post].m_waits.size());
+			Assert::IsTrue(schedule.m_passes[post].m_waits[0].m_queue == QUEUE_GRAPHICS);
+
+			// nothing waits on post so it doesn't signal
+			Assert::AreEqual(static_cast<UINT64>(0), schedule.m_passes[post].m_signalValue);
+			Assert::AreEqual(2u, schedule.m_waitCount);
+		}
+
+		TEST_METHOD(PassScheduler_redundantWaitsAreSkipped)
+		{
+			PassScheduler scheduler;
+
+			const PassHandle g0 = scheduler.addPass(makePass("g0", false, {}, { 0 }));
+			const PassHandle c0 = scheduler.addPass(makePass("c0", true, { 0 }, { 1 }));
+			// already behind c0's wait on g0 on the same queue
+			const PassHandle c1 = scheduler.addPass(makePass("c1", true, { 0 }, { 2 }));
+			// waiting on c1 covers c0 too
+			const PassHandle g1 = scheduler.addPass(makePass("g1", false, { 1, 2 }, { 3 }));
+			// c0's output, already covered by g1's wait
+			const PassHandle g2 = scheduler.addPass(makePass("g2", false, { 1 }, { 4 }));
+
+			const PassSchedule schedule = scheduler.compile();
+
+			Assert::AreEqual(static_cast<size_t>(1), schedule.m_passes[c0].m_waits.size());
+			Assert::IsTrue(schedule.m_passes[c1].m_waits.empty());
+			Assert::AreEqual(static_cast<size_t>(1), schedule.m_passes[g1].m_waits.size());
+			Assert::IsTrue(schedule.m_passes[g2].m_waits.empty());
+
+			Assert::AreEqual(static_cast<UINT64>(0), schedule.m_passes[c0].m_signalValue);
+			Assert::AreEqual(static_cast<UINT64>(1), schedule.m_passes[c1].m_signalValue);
+			Assert::AreEqual(static_cast<UINT64>(1), schedule.m_passes[g1].m_waits[0].m_fenceValue);
+			Assert::AreEqual(static_cast<UINT64>(1), schedule.m_passes[g0].m_signalValue);
+
+			Assert::AreEqual(static_cast<UINT64>(1), schedule.m_signalCount[QUEUE_GRAPHICS]);
+			Assert::AreEqual(static_cast<UINT64>(1), schedule.m_signalCount[QUEUE_ASYNC_COMPUTE]);
+			Assert::AreEqual(2u, schedule.m_waitCount);
+		}
+
+		TEST_METHOD(PassScheduler_writeAfterReadIsOrdered)
+		{
+			PassScheduler scheduler;
+
+			scheduler.addPass(makePass("write", false, {}, { 0 }));
+			const PassHandle read = scheduler.addPass(makePass("read", true, { 0 }, { 1 }));
+			// overwrites what the compute pass is still reading
+			const PassHandle overwrite = scheduler.addPass(makePass("overwrite", false, {}, { 0 }));
+
+			const PassSchedule schedule = scheduler.compile();
+
+			Assert::AreEqual(static_cast<size_t>(1), schedule.m_passes[overwrite].m_waits.size());
+			Assert::IsTrue(schedule.m_passes[overwrite].m_waits[0].m_queue == QUEUE_ASYNC_COMPUTE);
+			Assert::AreEqual(schedule.m_passes[read].m_signalValue, schedule.m_passes[overwrite].m_waits[0].m_fenceValue);
+		}
+
+		TEST_METHOD(PassScheduler_dependencyOnLaterPassThrows)
+		{
+			PassScheduler scheduler;
+			scheduler.addPass(makePass("first", false, {}, {}));
+
+			PassDesc bad = makePass("bad", true, {}, {});
+			bad.m_dependencies.push_back(5);
+
+			Assert::ExpectException<const char *>([&scheduler, &bad]() { scheduler.addPass(bad); });
+		}
+
+		TEST_METHOD(PassScheduler_randomGraphsAreCorrectAndMinimal)
+		{
+			std::mt19937 rng(1234);
+
+			for (int graph = 0; graph < 200; ++graph)
+			{
+				PassScheduler scheduler;
+				std::vector<std::vector<PassHandle>> dependencies;
+
+				const UINT passCount = 2 + rng() % 30;
+
+				for (UINT p = 0; p < passCount; ++p)
+				{
+					PassDesc desc = makePass("pass", (rng() % 2) == 0, {}, {});
+
+					for (UINT d = 0; d < p; ++d)
+					{
+						if (rng() % 4 == 0)
+						{
+							desc.m_dependencies.push_back(d);
+						}
+					}
+
+					dependencies.push_back(desc.m_dependencies);
+					scheduler.addPass(desc);
+				}
+
+				checkSchedule(scheduler.compile(), dependencies);
+			}
+		}
+	};
+}
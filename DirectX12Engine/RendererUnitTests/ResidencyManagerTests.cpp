@@ -0,0 +1,302 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/ResidencyManager.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// stands in for the adapter, usage is whatever is resident out of what it has been told about
+	class FakeResidencyBackend : public ResidencyBackend
+	{
+	public:
+		FakeResidencyBackend()
+			: m_budget(0)
+			, m_completedFence(0)
+		{
+
+		}
+
+		~FakeResidencyBackend()
+		{
+
+		}
+
+		void add(ID3D12Pageable * object, const UINT64 size)
+		{
+			m_sizes[object] = size;
+			m_resident[object] = true;
+		}
+
+		void queryVideoMemory(UINT64 & budget, UINT64 & usage) override
+		{
+			budget = m_budget;
+			usage = 0;
+
+			for (auto it = m_sizes.begin(); it != m_sizes.end(); ++it)
+			{
+				if (m_resident[it->first])
+				{
+					usage += it->second;
+				}
+			}
+		}
+
+		HRESULT makeResident(const std::vector<ID3D12Pageable*> & objects) override
+		{
+			for (size_t i = 0; i < objects.size(); ++i)
+			{
+				m_resident[objects[i]] = true;
+			}
+
+			m_madeResident.push_back(objects);
+			return S_OK;
+		}
+
+		HRESULT evict(const std::vector<ID3D12Pageable*> & objects) override
+		{
+			for (size_t i = 0; i < objects.size(); ++i)
+			{
+				m_resident[objects[i]] = false;
+			}
+
+			m_evicted.push_back(objects);
+			return S_OK;
+		}
+
+		UINT64 getCompletedFenceValue() override
+		{
+			return m_completedFence;
+		}
+
+		UINT64 m_budget;
+		UINT64 m_completedFence;
+
+		std::map<ID3D12Pageable*, UINT64> m_sizes;
+		std::map<ID3D12Pageable*, bool> m_resident;
+
+		std::vector<std::vector<ID3D12Pageable*>> m_evicted;
+		std::vector<std::vector<ID3D12Pageable*>> m_madeResident;
+	};
+
+	// never dereferenced, only used as keys
+	ID3D12Pageable * fakeObject(const UINT id)
+	{
+		return reinterpret_cast<ID3D12Pageable*>(static_cast<uintptr_t>(id) * 16);
+	}
+
+	void trackBoth(ResidencyManager & manager, FakeResidencyBackend & backend, ID3D12Pageable * object, const UINT64 size)
+	{
+		manager.track(object, size);
+		backend.add(object, size);
+	}
+
+	// one frame where only these are drawn, and the GPU finishes it straight away
+	void runFrame(ResidencyManager & manager, FakeResidencyBackend & backend, const std::vector<ID3D12Pageable*> & used, UINT64 & fence)
+	{
+		for (size_t i = 0; i < used.size(); ++i)
+		{
+			manager.markUsed(used[i]);
+		}
+
+		++fence;
+		Assert::IsTrue(SUCCEEDED(manager.prepareFrame(fence)));
+		backend.m_completedFence = fence;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(ResidencyManagerTests)
+	{
+	public:
+
+		TEST_METHOD(ResidencyManager_underBudgetEvictsNothing)
+		{
+			FakeResidencyBackend backend;
+			backend.m_budget = 1000;
+
+			ResidencyManager manager(&backend);
+			trackBoth(manager, backend, fakeObject(1), 300);
+			trackBoth(manager, backend, fakeObject(2), 300);
+
+			UINT64 fence = 0;
+			runFrame(manager, backend, { fakeObject(1) }, fence);
+			runFrame(manager, backend, { fakeObject(2) }, fence);
+
+			Assert::IsTrue(backend.m_evicted.empty());
+			Assert::AreEqual(static_cast<UINT64>(600), manager.getStats().m_usageBytes);
+			Assert::AreEqual(static_cast<UINT64>(1000), manager.getStats().m_budgetBytes);
+			Assert::AreEqual(static_cast<UINT64>(600), manager.getStats().m_residentBytes);
+		}
+
+		TEST_METHOD(ResidencyManager_overBudgetEvictsLeastRecentlyUsedInOneBatch)
+		{
+			FakeResidencyBackend backend;
+			backend.m_budget = 10000;
+
+			ResidencyManager manager(&backend);
+
+			for (UINT i = 1; i <= 4; ++i)
+			{
+				trackBoth(manager, backend, fakeObject(i), 100);
+			}
+
+			// used in order 1, 2, 3, 4 so 1 is the oldest
+			UINT64 fence = 0;
+
+			for (UINT i = 1; i <= 4; ++i)
+			{
+				runFrame(manager, backend, { fakeObject(i) }, fence);
+			}
+
+			// the OS takes 150 away, two objects have to go
+			backend.m_budget = 250;
+			runFrame(manager, backend, { fakeObject(4) }, fence);
+
+			Assert::AreEqual(static_cast<size_t>(1), backend.m_evicted.size());
+			Assert::AreEqual(static_cast<size_t>(2), backend.m_evicted[0].size());
+			Assert::IsTrue(backend.m_evicted[0][0] == fakeObject(1));
+			Assert::IsTrue(backend.m_evicted[0][1] == fakeObject(2));
+
+			Assert::IsFalse(manager.isResident(fakeObject(1)));
+			Assert::IsFalse(manager.isResident(fakeObject(2)));
+			Assert::IsTrue(manager.isResident(fakeObject(3)));
+			Assert::IsTrue(manager.isResident(fakeObject(4)));
+
+			const ResidencyStats & stats = manager.getStats();
+			Assert::AreEqual(static_cast<UINT64>(2), stats.m_evictedObjects);
+			Assert::AreEqual(static_cast<UINT64>(200), stats.m_evictedBytes);
+			Assert::AreEqual(static_cast<UINT64>(1), stats.m_evictBatches);
+			Assert::AreEqual(static_cast<UINT64>(200), stats.m_residentBytes);
+		}
+
+		TEST_METHOD(ResidencyManager_bringsBackWhatTheFrameUsesInOneBatch)
+		{
+			FakeResidencyBackend backend;
+			backend.m_budget = 10000;
+
+			ResidencyManager manager(&backend);
+
+			for (UINT i = 1; i <= 4; ++i)
+			{
+				trackBoth(manager, backend, fakeObject(i), 100);
+			}
+
+			UINT64 fence = 0;
+			runFrame(manager, backend, { fakeObject(1), fakeObject(2) }, fence);
+			runFrame(manager, backend, { fakeObject(3), fakeObject(4) }, fence);
+
+			backend.m_budget = 200;
+			runFrame(manager, backend, { fakeObject(3), fakeObject(4) }, fence);
+			Assert::IsFalse(manager.isResident(fakeObject(1)));
+			Assert::IsFalse(manager.isResident(fakeObject(2)));
+
+			// back to the first two, the other pair makes room and nothing this frame uses is pushed out
+			runFrame(manager, backend, { fakeObject(1), fakeObject(2) }, fence);
+
+			Assert::AreEqual(static_cast<size_t>(2), backend.m_evicted.size());
+			Assert::IsTrue(std::find(backend.m_evicted[1].begin(), backend.m_evicted[1].end(), fakeObject(1)) == backend.m_evicted[1].end());
+			Assert::IsTrue(std::find(backend.m_evicted[1].begin(), backend.m_evicted[1].end(), fakeObject(2)) == backend.m_evicted[1].end());
+
+			Assert::AreEqual(static_cast<size_t>(1), backend.m_madeResident.size());
+			Assert::AreEqual(static_cast<size_t>(2), backend.m_madeResident[0].size());
+
+			Assert::IsTrue(manager.isResident(fakeObject(1)));
+			Assert::IsTrue(manager.isResident(fakeObject(2)));
+			Assert::IsFalse(manager.isResident(fakeObject(3)));
+			Assert::IsFalse(manager.isResident(fakeObject(4)));
+			Assert::AreEqual(static_cast<UINT64>(2), manager.getStats().m_madeResidentObjects);
+			Assert::AreEqual(static_cast<UINT64>(1), manager.getStats().m_makeResidentBatches);
+		}
+
+		TEST_METHOD(ResidencyManager_keepsObjectsTheGpuMayStillUse)
+		{
+			FakeResidencyBackend backend;
+			backend.m_budget = 10000;
+
+			ResidencyManager manager(&backend);
+			trackBoth(manager, backend, fakeObject(1), 100);
+			trackBoth(manager, backend, fakeObject(2), 100);
+
+			manager.markUsed(fakeObject(1));
+			Assert::IsTrue(SUCCEEDED(manager.prepareFrame(1)));
+			manager.markUsed(fakeObject(2));
+			Assert::IsTrue(SUCCEEDED(manager.prepareFrame(2)));
+
+			// neither frame has finished
+			backend.m_completedFence = 0;
+			backend.m_budget = 100;
+			Assert::IsTrue(SUCCEEDED(manager.prepareFrame(3)));
+			Assert::IsTrue(backend.m_evicted.empty());
+
+			// the first one has, so its object can go
+			backend.m_completedFence = 1;
+			Assert::IsTrue(SUCCEEDED(manager.prepareFrame(4)));
+			Assert::AreEqual(static_cast<size_t>(1), backend.m_evicted.size());
+			Assert::IsTrue(backend.m_evicted[0][0] == fakeObject(1));
+			Assert::IsTrue(manager.isResident(fakeObject(2)));
+		}
+
+		TEST_METHOD(ResidencyManager_neverEvictsObjectsNotUsedYet)
+		{
+			FakeResidencyBackend backend;
+			backend.m_budget = 10000;
+
+			ResidencyManager manager(&backend);
+			trackBoth(manager, backend, fakeObject(1), 100);
+			trackBoth(manager, backend, fakeObject(2), 100);
+
+			UINT64 fence = 0;
+			runFrame(manager, backend, { fakeObject(1) }, fence);
+
+			// 2 may still be being filled by the copy queue
+			backend.m_budget = 0;
+			runFrame(manager, backend, {}, fence);
+
+			Assert::AreEqual(static_cast<size_t>(1), backend.m_evicted.size());
+			Assert::AreEqual(static_cast<size_t>(1), backend.m_evicted[0].size());
+			Assert::IsTrue(backend.m_evicted[0][0] == fakeObject(1));
+			Assert::IsTrue(manager.isResident(fakeObject(2)));
+		}
+
+		TEST_METHOD(ResidencyManager_untrackForgetsTheObject)
+		{
+			FakeResidencyBackend backend;
+			backend.m_budget = 10000;
+
+			ResidencyManager manager(&backend);
+
+			for (UINT i = 1; i <= 3; ++i)
+			{
+				trackBoth(manager, backend, fakeObject(i), 100 * i);
+			}
+
+			UINT64 fence = 0;
+			runFrame(manager, backend, { fakeObject(1), fakeObject(2), fakeObject(3) }, fence);
+
+			manager.untrack(fakeObject(1));
+			backend.m_sizes.erase(fakeObject(1));
+
+			Assert::AreEqual(static_cast<UINT64>(500), manager.getStats().m_trackedBytes);
+			Assert::AreEqual(static_cast<UINT64>(500), manager.getStats().m_residentBytes);
+			Assert::IsFalse(manager.isResident(fakeObject(1)));
+
+			// the one swapped into its place is still looked up correctly
+			backend.m_budget = 300;
+			runFrame(manager, backend, { fakeObject(2) }, fence);
+
+			Assert::AreEqual(static_cast<size_t>(1), backend.m_evicted.size());
+			Assert::IsTrue(backend.m_evicted[0][0] == fakeObject(3));
+			Assert::IsTrue(manager.isResident(fakeObject(2)));
+
+			// and untracking something unknown does nothing
+			manager.untrack(fakeObject(7));
+			Assert::AreEqual(static_cast<UINT64>(500), manager.getStats().m_trackedBytes);
+		}
+	};
+}
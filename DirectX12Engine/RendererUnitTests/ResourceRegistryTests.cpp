@@ -0,0 +1,338 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/ResourceRegistry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// nothing here is ever over budget, the registry only untracks through it
+	class NullResidencyBackend : public ResidencyBackend
+	{
+	public:
+		NullResidencyBackend()
+		{
+
+		}
+
+		~NullResidencyBackend()
+		{
+
+		}
+
+		void queryVideoMemory(UINT64 & budget, UINT64 & usage) override
+		{
+			budget = 0;
+			usage = 0;
+		}
+
+		HRESULT makeResident(const std::vector<ID3D12Pageable*> &) override { return S_OK; }
+		HRESULT evict(const std::vector<ID3D12Pageable*> &) override { return S_OK; }
+		UINT64 getCompletedFenceValue() override { return 0; }
+	};
+
+	// the copy queue finishes batches only when the test says so
+	class ManualCopyBackend : public CopyQueueBackend
+	{
+	public:
+		ManualCopyBackend()
+			: m_nextFenceValue(1)
+			, m_completedFenceValue(0)
+		{
+
+		}
+
+		UINT64 submitBatch(const std::vector<UploadRequest> &, const UINT64) override { return m_nextFenceValue++; }
+		UINT64 getCompletedFenceValue() override { return m_completedFenceValue; }
+
+		UINT64 m_nextFenceValue;
+		UINT64 m_completedFenceValue;
+	};
+
+	UploadTicket enqueueBytes(CopyUploader & uploader, const UINT64 size)
+	{
+		UploadRequest request;
+		request.m_data.resize(static_cast<size_t>(size));
+		return uploader.enqueue(std::move(request));
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(ResourceRegistryTests)
+	{
+	public:
+
+		TEST_METHOD(ResourcePool_detectsStaleHandles)
+		{
+			ResourcePool<std::string> pool(RESOURCE_TEXTURE);
+
+			const ResourceHandle first = pool.add("first");
+			const ResourceHandle second = pool.add("second");
+
+			Assert::IsTrue(first != c_invalidResourceHandle);
+			Assert::IsTrue(first != second);
+			Assert::AreEqual(std::string("first"), *pool.get(first));
+			Assert::AreEqual(std::string("second"), *pool.get(second));
+			Assert::IsNull(pool.get(c_invalidResourceHandle));
+
+			Assert::IsTrue(pool.release(first));
+			Assert::IsNull(pool.get(first));
+			Assert::IsFalse(pool.release(first));
+			Assert::AreEqual(1u, pool.getLiveCount());
+
+			// the slot comes straight back, under a new generation the old handle doesn't match
+			const ResourceHandle reused = pool.add("reused");
+			Assert::AreEqual(first & 0xffffffffull, reused & 0xffffffffull);
+			Assert::IsTrue(first != reused);
+			Assert::IsNull(pool.get(first));
+			Assert::AreEqual(std::string("reused"), *pool.get(reused));
+
+			// marking or retiring through a stale handle does nothing
+			pool.markUsed(first, 10);
+			Assert::IsFalse(pool.retire(first, "old"));
+
+			// round and round the same slot, every handle it gave out before stays stale
+			std::vector<ResourceHandle> handles;
+			ResourceHandle current = reused;
+
+			for (UINT i = 0; i < 1000; ++i)
+			{
+				handles.push_back(current);
+				pool.release(current);
+				current = pool.add("again");
+			}
+
+			for (size_t i = 0; i < handles.size(); ++i)
+			{
+				Assert::IsNull(pool.get(handles[i]));
+			}
+
+			Assert::IsNotNull(pool.get(current));
+
+			// the same index in a pool of another type
+			ResourcePool<std::string> buffers(RESOURCE_BUFFER);
+			const ResourceHandle buffer = buffers.add("buffer");
+			Assert::IsNull(pool.get(buffer));
+			Assert::IsNull(buffers.get(second));
+			Assert::AreEqual(static_cast<int>(RESOURCE_BUFFER), static_cast<int>(ResourceRegistry::getType(buffer)));
+		}
+
+		TEST_METHOD(ResourcePool_freesOnlyOnceTheLastUseHasCompleted)
+		{
+			ResourcePool<std::string> pool(RESOURCE_MESH);
+			std::vector<std::string> released;
+
+			const ResourceHandle a = pool.add("a");
+			const ResourceHandle b = pool.add("b");
+			const ResourceHandle c = pool.add("c");
+			const ResourceHandle d = pool.add("d");
+			const ResourceHandle unused = pool.add("unused");
+
+			// drawn by frames 3, 5, 4 and 5, the last use is what counts
+			pool.markUsed(a, 3);
+			pool.markUsed(b, 2);
+			pool.markUsed(b, 5);
+			pool.markUsed(b, 1);
+			pool.markUsed(c, 4);
+			pool.markUsed(d, 5);
+
+			// released in an order that isn't the fence order
+			pool.release(d);
+			pool.release(b);
+			pool.release(a);
+			pool.release(unused);
+			pool.release(c);
+			Assert::AreEqual(5u, pool.getPendingCount());
+			Assert::AreEqual(0u, pool.getLiveCount());
+
+			// nothing that any unfinished frame drew with
+			pool.collect(0, released);
+			Assert::AreEqual(static_cast<size_t>(1), released.size());
+			Assert::AreEqual(std::string("unused"), released[0]);
+
+			pool.collect(2, released);
+			Assert::AreEqual(static_cast<size_t>(1), released.size());
+
+			pool.collect(3, released);
+			Assert::AreEqual(static_cast<size_t>(2), released.size());
+			Assert::AreEqual(std::string("a"), released[1]);
+
+			// several frames finish between collects, lowest fence first then the order they were released in
+			pool.collect(5, released);
+			Assert::AreEqual(static_cast<size_t>(5), released.size());
+			Assert::AreEqual(std::string("c"), released[2]);
+			Assert::AreEqual(std::string("d"), released[3]);
+			Assert::AreEqual(std::string("b"), released[4]);
+			Assert::AreEqual(0u, pool.getPendingCount());
+
+			// a replaced resource waits for the frames that drew the handle, which stays live
+			const ResourceHandle streamed = pool.add("mip 4");
+			pool.markUsed(streamed, 7);
+			Assert::IsTrue(pool.retire(streamed, *pool.get(streamed)));
+			*pool.get(streamed) = "mip 2";
+
+			released.clear();
+			pool.collect(6, released);
+			Assert::IsTrue(released.empty());
+			pool.collect(7, released);
+			Assert::AreEqual(static_cast<size_t>(1), released.size());
+			Assert::AreEqual(std::string("mip 4"), released[0]);
+			Assert::IsNotNull(pool.get(streamed));
+
+			// shutdown, once the GPU is idle, takes live and waiting alike
+			pool.markUsed(streamed, 9);
+			pool.release(pool.add("pending"));
+			released.clear();
+			pool.clear(released);
+			Assert::AreEqual(static_cast<size_t>(2), released.size());
+			Assert::IsNull(pool.get(streamed));
+		}
+
+		TEST_METHOD(ResourceRegistry_keepsTypesApart)
+		{
+			NullResidencyBackend backend;
+			ResidencyManager residency(&backend);
+			ManualCopyBackend copyBackend;
+			CopyUploader uploader(&copyBackend);
+			ResourceRegistry registry(residency, uploader);
+
+			Geometry mesh = Geometry();
+			mesh.m_numIndices = 36;
+			Texture texture = Texture();
+			texture.m_srvIndex = 7;
+
+			const ResourceHandle meshHandle = registry.addMesh(mesh);
+			const ResourceHandle textureHandle = registry.addTexture(texture);
+			const ResourceHandle bufferHandle = registry.addBuffer(nullptr);
+
+			// every pool starts at slot 0, the type keeps them from answering for each other
+			Assert::AreEqual(36u, registry.getMesh(meshHandle)->m_numIndices);
+			Assert::AreEqual(7u, registry.getTexture(textureHandle)->m_srvIndex);
+			Assert::IsNull(registry.getMesh(textureHandle));
+			Assert::IsNull(registry.getTexture(bufferHandle));
+			Assert::IsNull(registry.getBuffer(meshHandle));
+			Assert::AreEqual(3u, registry.getLiveCount());
+
+			registry.markUsed(meshHandle, 2);
+			registry.markUsed(textureHandle, 1);
+			Assert::IsTrue(registry.release(meshHandle));
+			Assert::IsTrue(registry.release(textureHandle));
+			Assert::IsTrue(registry.release(bufferHandle));
+			Assert::IsFalse(registry.release(meshHandle));
+			Assert::IsNull(registry.getMesh(meshHandle));
+
+			Assert::AreEqual(1u, registry.collect(0));
+			Assert::AreEqual(1u, registry.collect(1));
+			Assert::AreEqual(1u, registry.getPendingCount());
+			Assert::AreEqual(1u, registry.collect(2));
+			Assert::AreEqual(0u, registry.getPendingCount());
+
+			registry.addMesh(mesh);
+			registry.clear();
+			Assert::AreEqual(0u, registry.getLiveCount());
+		}
+
+		TEST_METHOD(ResourceRegistry_keepsWhatIsStillBeingUploaded)
+		{
+			NullResidencyBackend backend;
+			ResidencyManager residency(&backend);
+			ManualCopyBackend copyBackend;
+			CopyUploader uploader(&copyBackend);
+			ResourceRegistry registry(residency, uploader);
+
+			// released before any frame drew it and before its upload even went to the copy queue
+			Geometry mesh = Geometry();
+			mesh.m_uploadTicket = enqueueBytes(uploader, 64);
+			Assert::IsTrue(registry.release(registry.addMesh(mesh)));
+
+			Texture texture = Texture();
+			texture.m_uploadTicket = enqueueBytes(uploader, 256);
+			const ResourceHandle textureHandle = registry.addTexture(texture);
+
+			// a streamed texture's smaller copy replaced while its own upload is still in flight
+			Texture old = Texture();
+			old.m_uploadTicket = texture.m_uploadTicket;
+			Assert::IsTrue(registry.retireTexture(textureHandle, old));
+
+			// nothing waits on an upload, so it goes even though it came after
+			Assert::IsTrue(registry.release(registry.addBuffer(nullptr)));
+
+			Assert::AreEqual(1u, registry.collect(10));
+			Assert::AreEqual(2u, registry.getPendingCount());
+
+			// on the copy queue but not finished
+			uploader.flush();
+			Assert::AreEqual(0u, registry.collect(10));
+			Assert::AreEqual(2u, registry.getPendingCount());
+
+			copyBackend.m_completedFenceValue = copyBackend.m_nextFenceValue - 1;
+			Assert::AreEqual(2u, registry.collect(10));
+			Assert::AreEqual(0u, registry.getPendingCount());
+			Assert::IsNotNull(registry.getTexture(textureHandle));
+
+			registry.clear();
+		}
+
+		TEST_METHOD(ResourcePool_looksUpInConstantTime)
+		{
+			// a large scene's worth of handles with a lot of churn, every lookup is an index and a compare
+			using namespace std::chrono;
+
+			const UINT c_resourceCount = 1 << 20;
+
+			ResourcePool<UINT> pool(RESOURCE_BUFFER);
+			std::vector<ResourceHandle> handles;
+
+			for (UINT i = 0; i < c_resourceCount; ++i)
+			{
+				handles.push_back(pool.add(i));
+			}
+
+			std::vector<UINT> released;
+
+			for (UINT i = 0; i < c_resourceCount; i += 2)
+			{
+				pool.markUsed(handles[i], i);
+				pool.release(handles[i]);
+			}
+
+			const steady_clock::time_point start = steady_clock::now();
+			UINT64 sum = 0;
+			UINT stale = 0;
+
+			for (UINT i = 0; i < c_resourceCount; ++i)
+			{
+				const UINT * value = pool.get(handles[(i * 7919u) & (c_resourceCount - 1)]);
+
+				if (value != nullptr)
+				{
+					sum += *value;
+				}
+				else
+				{
+					++stale;
+				}
+			}
+
+			const double lookupSeconds = duration<double>(steady_clock::now() - start).count();
+
+			pool.collect(c_resourceCount, released);
+
+			Assert::AreEqual(c_resourceCount / 2, stale);
+			Assert::AreEqual(static_cast<size_t>(c_resourceCount / 2), released.size());
+			Assert::IsTrue(sum > 0);
+
+			char statsStr[256];
+			sprintf_s(statsStr, "ResourcePool: %u lookups, %u stale, %.2f ns per lookup\n",
+				c_resourceCount, stale, lookupSeconds * 1e9 / c_resourceCount);
+			Logger::WriteMessage(statsStr);
+		}
+	};
+}
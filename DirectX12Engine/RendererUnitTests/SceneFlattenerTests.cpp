@@ -0,0 +1,273 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/SceneFlattener.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	DirectX::XMFLOAT4X4 translation(const float x, const float y, const float z)
+	{
+		return DirectX::XMFLOAT4X4(
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			x, y, z, 1.0f);
+	}
+
+	// a size x size grid of unit squares on the xy plane from the origin, front faces towards -z
+	MeshData makeGrid(const UINT size)
+	{
+		MeshData mesh;
+
+		for (UINT y = 0; y <= size; ++y)
+		{
+			for (UINT x = 0; x <= size; ++x)
+			{
+				mesh.m_vertices.push_back(Vertex());
+				mesh.m_vertices.back().m_position = DirectX::XMFLOAT3(static_cast<float>(x) / size, static_cast<float>(y) / size, 0.0f);
+			}
+		}
+
+		for (UINT y = 0; y < size; ++y)
+		{
+			for (UINT x = 0; x < size; ++x)
+			{
+				const UINT corner = y * (size + 1) + x;
+				const UINT quad[6] = { corner, corner + size + 2, corner + 1, corner, corner + size + 1, corner + size + 2 };
+				mesh.m_indices.insert(mesh.m_indices.end(), quad, quad + 6);
+			}
+		}
+
+		return mesh;
+	}
+
+	// z of the triangle's normal, negative for the way makeGrid winds them
+	float facing(const MeshData & mesh, const size_t triangle)
+	{
+		const DirectX::XMFLOAT3 & a = mesh.m_vertices[mesh.m_indices[triangle * 3]].m_position;
+		const DirectX::XMFLOAT3 & b = mesh.m_vertices[mesh.m_indices[triangle * 3 + 1]].m_position;
+		const DirectX::XMFLOAT3 & c = mesh.m_vertices[mesh.m_indices[triangle * 3 + 2]].m_position;
+
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	// a columns x rows field of grid tiles a unit apart, the left half one material and the right half another
+	std::vector<SceneInstance> makeField(const UINT columns, const UINT rows)
+	{
+		std::vector<SceneInstance> instances;
+
+		for (UINT y = 0; y < rows; ++y)
+		{
+			for (UINT x = 0; x < columns; ++x)
+			{
+				SceneInstance instance;
+				instance.m_mesh = 0;
+				instance.m_material = x < columns / 2 ? 3 : 1;
+				instance.m_world = translation(static_cast<float>(x), static_cast<float>(y), 0.0f);
+				instances.push_back(instance);
+			}
+		}
+
+		return instances;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(SceneFlattenerTests)
+	{
+	public:
+
+		TEST_METHOD(SceneFlattener_bakesTransforms)
+		{
+			std::vector<MeshData> meshes(1, makeGrid(1));
+
+			// one moved and one mirrored in x, which turns its triangles over unless the winding is flipped
+			std::vector<SceneInstance> instances(2);
+			instances[0].m_mesh = 0;
+			instances[0].m_material = 0;
+			instances[0].m_world = translation(10.0f, 0.0f, 5.0f);
+			instances[1].m_mesh = 0;
+			instances[1].m_material = 1;
+			instances[1].m_world = translation(-10.0f, 0.0f, 0.0f);
+			instances[1].m_world._11 = -2.0f;
+
+			JobSystem jobSystem(2);
+			SceneFlattener flattener(jobSystem);
+			MeshData merged;
+			std::vector<SceneBatch> batches;
+			SceneFlattenStats stats;
+			Assert::IsTrue(flattener.flatten(meshes, instances, merged, batches, stats));
+
+			Assert::AreEqual(2u, stats.m_batches);
+			Assert::AreEqual(1u, stats.m_mirroredInstances);
+			Assert::AreEqual(static_cast<size_t>(8), merged.m_vertices.size());
+			Assert::AreEqual(static_cast<size_t>(12), merged.m_indices.size());
+			Assert::IsTrue(merged.m_lods.empty());
+
+			// batches come in material order
+			Assert::AreEqual(0u, batches[0].m_material);
+			Assert::AreEqual(10.0f, batches[0].m_boundsMin.x);
+			Assert::AreEqual(11.0f, batches[0].m_boundsMax.x);
+			Assert::AreEqual(5.0f, batches[0].m_boundsMin.z);
+
+			Assert::AreEqual(1u, batches[1].m_material);
+			Assert::AreEqual(-12.0f, batches[1].m_boundsMin.x);
+			Assert::AreEqual(-10.0f, batches[1].m_boundsMax.x);
+
+			for (size_t t = 0; t < merged.m_indices.size() / 3; ++t)
+			{
+				Assert::IsTrue(facing(merged, t) < 0.0f);
+			}
+
+			// an instance of a mesh that isn't there fails the lot
+			instances[1].m_mesh = 1;
+			Assert::IsFalse(flattener.flatten(meshes, instances, merged, batches, stats));
+			Assert::IsTrue(batches.empty());
+		}
+
+		TEST_METHOD(SceneFlattener_mergesByMaterialIntoCompactBatches)
+		{
+			std::vector<MeshData> meshes(1, makeGrid(2));
+			const std::vector<SceneInstance> instances = makeField(16, 16);
+
+			// four tiles of nine vertices a batch
+			JobSystem jobSystem(4);
+			SceneFlattener flattener(jobSystem);
+			flattener.setMaxBatchVertices(36);
+			flattener.setGrainSize(5);
+
+			MeshData merged;
+			std::vector<SceneBatch> batches;
+			SceneFlattenStats stats;
+			Assert::IsTrue(flattener.flatten(meshes, instances, merged, batches, stats));
+
+			Assert::AreEqual(256u, stats.m_instances);
+			Assert::AreEqual(64u, stats.m_batches);
+			Assert::AreEqual(2u, stats.m_materials);
+			Assert::AreEqual(static_cast<UINT64>(256 * 9), stats.m_bakedVertices);
+			Assert::AreEqual(static_cast<size_t>(256 * 24), merged.m_indices.size());
+
+			UINT vertexOffset = 0;
+			UINT indexOffset = 0;
+
+			for (size_t b = 0; b < batches.size(); ++b)
+			{
+				const SceneBatch & batch = batches[b];
+				Assert::AreEqual(b < 32 ? 1u : 3u, batch.m_material);
+				Assert::AreEqual(4u, batch.m_instanceCount);
+				Assert::AreEqual(vertexOffset, batch.m_vertexOffset);
+				Assert::AreEqual(indexOffset, batch.m_indexOffset);
+
+				// the curve puts four neighbouring tiles together, a 2 x 2 block whose shared edges weld into 25 vertices
+				Assert::AreEqual(2.0f, batch.m_boundsMax.x - batch.m_boundsMin.x);
+				Assert::AreEqual(2.0f, batch.m_boundsMax.y - batch.m_boundsMin.y);
+				Assert::AreEqual(25u, batch.m_vertexCount);
+
+				for (UINT i = batch.m_indexOffset; i < batch.m_indexOffset + batch.m_indexCount; ++i)
+				{
+					Assert::IsTrue(merged.m_indices[i] >= batch.m_vertexOffset && merged.m_indices[i] < batch.m_vertexOffset + batch.m_vertexCount);
+				}
+
+				vertexOffset += batch.m_vertexCount;
+				indexOffset += batch.m_indexCount;
+			}
+
+			Assert::AreEqual(vertexOffset, stats.m_vertices);
+			Assert::AreEqual(static_cast<size_t>(vertexOffset), merged.m_vertices.size());
+
+			// welding doesn't move or turn anything over, the triangles cover the field exactly once
+			double area = 0.0;
+
+			for (size_t t = 0; t < merged.m_indices.size() / 3; ++t)
+			{
+				Assert::IsTrue(facing(merged, t) < 0.0f);
+				area -= facing(merged, t) * 0.5;
+			}
+
+			Assert::AreEqual(256.0, area, 1e-6);
+		}
+
+		TEST_METHOD(SceneFlattener_givesTheSameResultWhateverTheThreads)
+		{
+			std::vector<MeshData> meshes;
+			meshes.push_back(makeGrid(3));
+			meshes.push_back(makeGrid(5));
+			meshes.push_back(MeshData());
+
+			std::vector<SceneInstance> instances = makeField(40, 30);
+
+			for (size_t i = 0; i < instances.size(); ++i)
+			{
+				instances[i].m_mesh = (i * 7) % 3;
+				instances[i].m_material = (i * 13) % 5;
+				instances[i].m_world._11 = i % 4 == 0 ? -1.0f : 1.0f + (i % 3) * 0.25f;
+			}
+
+			MeshData merged[2];
+			std::vector<SceneBatch> batches[2];
+
+			for (UINT pass = 0; pass < 2; ++pass)
+			{
+				JobSystem jobSystem(pass == 0 ? 1 : 4);
+				SceneFlattener flattener(jobSystem);
+				flattener.setMaxBatchVertices(200);
+				flattener.setGrainSize(pass == 0 ? 100000 : 3);
+
+				SceneFlattenStats stats;
+				Assert::IsTrue(flattener.flatten(meshes, instances, merged[pass], batches[pass], stats));
+
+				// the empty mesh's instances draw nothing and go nowhere
+				Assert::AreEqual(static_cast<UINT64>((400 * 16) + (400 * 36)), stats.m_bakedVertices);
+			}
+
+			Assert::AreEqual(merged[0].m_vertices.size(), merged[1].m_vertices.size());
+			Assert::AreEqual(merged[0].m_indices.size(), merged[1].m_indices.size());
+			Assert::AreEqual(batches[0].size(), batches[1].size());
+			Assert::AreEqual(0, memcmp(merged[0].m_vertices.data(), merged[1].m_vertices.data(), sizeof(Vertex) * merged[0].m_vertices.size()));
+			Assert::AreEqual(0, memcmp(merged[0].m_indices.data(), merged[1].m_indices.data(), sizeof(UINT) * merged[0].m_indices.size()));
+			Assert::AreEqual(0, memcmp(batches[0].data(), batches[1].data(), sizeof(SceneBatch) * batches[0].size()));
+		}
+
+		TEST_METHOD(SceneFlattener_mergesLargeScenesAcrossCores)
+		{
+			// 20000 small props of 289 vertices each, 5.8M vertices and 10M triangles before merging
+			std::vector<MeshData> meshes(1, makeGrid(16));
+			std::vector<SceneInstance> instances = makeField(200, 100);
+
+			for (size_t i = 0; i < instances.size(); ++i)
+			{
+				instances[i].m_material = static_cast<UINT>(i % 8);
+			}
+
+			double seconds[2] = { 0.0, 0.0 };
+			UINT threads[2] = { 0, 0 };
+			SceneFlattenStats stats;
+
+			for (UINT pass = 0; pass < 2; ++pass)
+			{
+				JobSystem jobSystem(pass == 0 ? 1 : 4);
+				SceneFlattener flattener(jobSystem);
+				MeshData merged;
+				std::vector<SceneBatch> batches;
+
+				Assert::IsTrue(flattener.flatten(meshes, instances, merged, batches, stats));
+				seconds[pass] = stats.m_seconds;
+				threads[pass] = stats.m_threadCount;
+			}
+
+			char statsStr[256];
+			sprintf_s(statsStr, "SceneFlattener: %u draws -> %u, %llu vertices -> %u, %.1f ms on %u threads %.1f ms on %u\n",
+				stats.m_instances, stats.m_batches, stats.m_bakedVertices, stats.m_vertices,
+				seconds[0] * 1000.0, threads[0], seconds[1] * 1000.0, threads[1]);
+			Logger::WriteMessage(statsStr);
+		}
+	};
+}
@@ -0,0 +1,264 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/Skinning.h"
+
+#include <cmath>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	DirectX::XMFLOAT4X4 identity()
+	{
+		DirectX::XMFLOAT4X4 matrix;
+
+		for (UINT r = 0; r < 4; ++r)
+		{
+			for (UINT c = 0; c < 4; ++c)
+			{
+				matrix.m[r][c] = r == c ? 1.0f : 0.0f;
+			}
+		}
+
+		return matrix;
+	}
+
+	// rotation about y then a translation, row vector convention like DirectXMath
+	DirectX::XMFLOAT4X4 rotateYTranslate(const float angle, const float tx, const float ty, const float tz)
+	{
+		DirectX::XMFLOAT4X4 matrix = identity();
+		matrix.m[0][0] = std::cos(angle);
+		matrix.m[0][2] = -std::sin(angle);
+		matrix.m[2][0] = std::sin(angle);
+		matrix.m[2][2] = std::cos(angle);
+		matrix.m[3][0] = tx;
+		matrix.m[3][1] = ty;
+		matrix.m[3][2] = tz;
+		return matrix;
+	}
+
+	SkinnedVertex makeVertex(const float x, const float y, const float z)
+	{
+		SkinnedVertex vertex;
+		vertex.m_position = DirectX::XMFLOAT3(x, y, z);
+		vertex.m_colour = DirectX::XMFLOAT4(0.25f, 0.5f, 0.75f, 1.0f);
+
+		for (UINT i = 0; i < c_maxBoneInfluences; ++i)
+		{
+			vertex.m_boneIndices[i] = 0;
+			vertex.m_boneWeights[i] = 0;
+		}
+
+		vertex.m_boneWeights[0] = 255;
+		return vertex;
+	}
+
+	// plain double precision linear blend skinning to check the kernel against
+	void referenceSkin(const SkinnedVertex & vertex, const std::vector<DirectX::XMFLOAT4X4> & palette, double * position)
+	{
+		position[0] = position[1] = position[2] = 0.0;
+
+		for (UINT i = 0; i < c_maxBoneInfluences; ++i)
+		{
+			const DirectX::XMFLOAT4X4 & bone = palette[vertex.m_boneIndices[i]];
+			const double weight = vertex.m_boneWeights[i] / 255.0;
+
+			for (UINT c = 0; c < 3; ++c)
+			{
+				position[c] += weight * (vertex.m_position.x * bone.m[0][c] + vertex.m_position.y * bone.m[1][c] +
+					vertex.m_position.z * bone.m[2][c] + bone.m[3][c]);
+			}
+		}
+	}
+
+	// a random skinned cloud, each vertex weighted to up to four of the bones
+	std::vector<SkinnedVertex> makeRandomSkin(const size_t count, const UINT boneCount)
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+		std::uniform_real_distribution<float> weight(0.0f, 1.0f);
+		std::uniform_int_distribution<UINT> bone(0, boneCount - 1);
+		std::uniform_int_distribution<UINT> influenceCount(1, 6);
+
+		std::vector<SkinnedVertex> vertices(count);
+		SkinBuilder builder(count);
+
+		for (size_t v = 0; v < count; ++v)
+		{
+			vertices[v] = makeVertex(position(rng), position(rng), position(rng));
+
+			const UINT influences = influenceCount(rng);
+
+			for (UINT i = 0; i < influences; ++i)
+			{
+				builder.addInfluence(static_cast<UINT>(v), bone(rng), weight(rng));
+			}
+		}
+
+		builder.build(vertices);
+		return vertices;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(SkinningTests)
+	{
+	public:
+
+		TEST_METHOD(Skinning_quantisedWeightsAddUpTo255InOrder)
+		{
+			const float weights[][4] =
+			{
+				{ 1.0f, 0.0f, 0.0f, 0.0f },
+				{ 0.5f, 0.5f, 0.0f, 0.0f },
+				{ 0.34f, 0.33f, 0.33f, 0.0f },
+				{ 0.25f, 0.25f, 0.25f, 0.25f },
+				{ 0.7f, 0.2f, 0.06f, 0.04f },
+				{ 2.0f, 1.0f, 1.0f, 0.0f }, // not normalised
+			};
+
+			for (size_t w = 0; w < sizeof(weights) / sizeof(weights[0]); ++w)
+			{
+				UINT8 quantised[4];
+				quantiseBoneWeights(weights[w], quantised);
+
+				float total = 0.0f;
+
+				for (UINT i = 0; i < 4; ++i)
+				{
+					total += weights[w][i];
+				}
+
+				Assert::AreEqual(255, quantised[0] + quantised[1] + quantised[2] + quantised[3]);
+
+				for (UINT i = 0; i < 4; ++i)
+				{
+					Assert::IsTrue(std::fabs(quantised[i] - weights[w][i] / total * 255.0f) < 1.0f);
+
+					if (i > 0)
+					{
+						Assert::IsTrue(quantised[i] <= quantised[i - 1]);
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(Skinning_builderKeepsTheFourHeaviestInfluences)
+		{
+			std::vector<SkinnedVertex> vertices(3, makeVertex(0.0f, 0.0f, 0.0f));
+
+			SkinBuilder builder(vertices.size());
+
+			// six bones on the first vertex, the two lightest go
+			builder.addInfluence(0, 1, 0.05f);
+			builder.addInfluence(0, 2, 0.3f);
+			builder.addInfluence(0, 3, 0.1f);
+			builder.addInfluence(0, 4, 0.4f);
+			builder.addInfluence(0, 5, 0.1f);
+			builder.addInfluence(0, 6, 0.05f);
+
+			builder.addInfluence(1, 9, 1.0f);
+
+			// nothing on the last one
+
+			Assert::AreEqual(1u, builder.build(vertices));
+
+			Assert::AreEqual(static_cast<UINT8>(4), vertices[0].m_boneIndices[0]);
+			Assert::AreEqual(static_cast<UINT8>(2), vertices[0].m_boneIndices[1]);
+			// equal weights, the lower bone first
+			Assert::AreEqual(static_cast<UINT8>(3), vertices[0].m_boneIndices[2]);
+			Assert::AreEqual(static_cast<UINT8>(5), vertices[0].m_boneIndices[3]);
+
+			// 0.4 of the 0.9 kept
+			Assert::IsTrue(std::abs(vertices[0].m_boneWeights[0] - 113) <= 1);
+			Assert::AreEqual(255, vertices[0].m_boneWeights[0] + vertices[0].m_boneWeights[1] + vertices[0].m_boneWeights[2] + vertices[0].m_boneWeights[3]);
+
+			Assert::AreEqual(static_cast<UINT8>(9), vertices[1].m_boneIndices[0]);
+			Assert::AreEqual(static_cast<UINT8>(255), vertices[1].m_boneWeights[0]);
+			Assert::AreEqual(static_cast<UINT8>(0), vertices[1].m_boneWeights[1]);
+
+			Assert::AreEqual(static_cast<UINT8>(0), vertices[2].m_boneIndices[0]);
+			Assert::AreEqual(static_cast<UINT8>(255), vertices[2].m_boneWeights[0]);
+		}
+
+		TEST_METHOD(Skinning_identityPaletteKeepsTheBindPose)
+		{
+			const std::vector<SkinnedVertex> vertices = makeRandomSkin(100, 8);
+			const std::vector<DirectX::XMFLOAT4X4> palette(8, identity());
+			std::vector<Vertex> out(vertices.size());
+
+			CpuSkinner::skinRange(vertices.data(), 0, vertices.size(), palette.data(), out.data());
+
+			for (size_t v = 0; v < vertices.size(); ++v)
+			{
+				Assert::AreEqual(vertices[v].m_position.x, out[v].m_position.x, 1e-5f);
+				Assert::AreEqual(vertices[v].m_position.y, out[v].m_position.y, 1e-5f);
+				Assert::AreEqual(vertices[v].m_position.z, out[v].m_position.z, 1e-5f);
+				Assert::AreEqual(vertices[v].m_colour.y, out[v].m_colour.y);
+			}
+		}
+
+		TEST_METHOD(Skinning_blendsBonesLikeTheReference)
+		{
+			const UINT boneCount = 16;
+			const std::vector<SkinnedVertex> vertices = makeRandomSkin(5000, boneCount);
+
+			std::vector<DirectX::XMFLOAT4X4> palette;
+
+			for (UINT b = 0; b < boneCount; ++b)
+			{
+				palette.push_back(rotateYTranslate(b * 0.3f, b * 0.1f, 1.0f - b * 0.05f, -0.5f));
+			}
+
+			std::vector<Vertex> out(vertices.size());
+			CpuSkinner::skinRange(vertices.data(), 0, vertices.size(), palette.data(), out.data());
+
+			for (size_t v = 0; v < vertices.size(); ++v)
+			{
+				double expected[3];
+				referenceSkin(vertices[v], palette, expected);
+
+				Assert::AreEqual(expected[0], static_cast<double>(out[v].m_position.x), 1e-4);
+				Assert::AreEqual(expected[1], static_cast<double>(out[v].m_position.y), 1e-4);
+				Assert::AreEqual(expected[2], static_cast<double>(out[v].m_position.z), 1e-4);
+			}
+		}
+
+		TEST_METHOD(Skinning_jobsMatchASingleRangeAndReportThroughput)
+		{
+			const UINT boneCount = 64;
+			const std::vector<SkinnedVertex> vertices = makeRandomSkin(100000, boneCount);
+
+			std::vector<DirectX::XMFLOAT4X4> palette;
+
+			for (UINT b = 0; b < boneCount; ++b)
+			{
+				palette.push_back(rotateYTranslate(b * 0.1f, 0.0f, b * 0.02f, 0.0f));
+			}
+
+			std::vector<Vertex> single(vertices.size());
+			CpuSkinner::skinRange(vertices.data(), 0, vertices.size(), palette.data(), single.data());
+
+			JobSystem jobSystem(4);
+			CpuSkinner skinner(jobSystem);
+
+			std::vector<Vertex> parallel(vertices.size());
+			SkinningStats stats;
+			skinner.skin(vertices.data(), vertices.size(), palette.data(), parallel.data(), stats);
+
+			for (size_t v = 0; v < vertices.size(); ++v)
+			{
+				Assert::AreEqual(single[v].m_position.x, parallel[v].m_position.x);
+				Assert::AreEqual(single[v].m_position.y, parallel[v].m_position.y);
+				Assert::AreEqual(single[v].m_position.z, parallel[v].m_position.z);
+			}
+
+			Assert::AreEqual(static_cast<UINT64>(vertices.size()), stats.m_vertices);
+			Assert::AreEqual(5u, stats.m_threadCount);
+			Assert::IsTrue(stats.verticesPerSecondPerCore() > 0.0);
+		}
+	};
+}
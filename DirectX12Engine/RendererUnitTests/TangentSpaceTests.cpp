@@ -0,0 +1,441 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/TangentSpace.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	DirectX::XMFLOAT3 cross(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b)
+	{
+		return DirectX::XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float dot(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	DirectX::XMFLOAT3 normalise(const DirectX::XMFLOAT3 & v)
+	{
+		const float length = std::sqrt(dot(v, v));
+		return DirectX::XMFLOAT3(v.x / length, v.y / length, v.z / length);
+	}
+
+	bool near3(const DirectX::XMFLOAT3 & a, const DirectX::XMFLOAT3 & b, const float tolerance)
+	{
+		return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance && std::fabs(a.z - b.z) <= tolerance;
+	}
+
+	DirectX::XMFLOAT3 xyz(const DirectX::XMFLOAT4 & v)
+	{
+		return DirectX::XMFLOAT3(v.x, v.y, v.z);
+	}
+
+	// wound so cross(b - a, c - a) faces away from the centre like the engine's front faces
+	void addTriangle(const std::vector<Vertex> & vertices, std::vector<UINT> & indices, const UINT a, UINT b, UINT c, const DirectX::XMFLOAT3 & outwards)
+	{
+		const DirectX::XMFLOAT3 & pa = vertices[a].m_position;
+		const DirectX::XMFLOAT3 & pb = vertices[b].m_position;
+		const DirectX::XMFLOAT3 & pc = vertices[c].m_position;
+		const DirectX::XMFLOAT3 normal = cross(DirectX::XMFLOAT3(pb.x - pa.x, pb.y - pa.y, pb.z - pa.z), DirectX::XMFLOAT3(pc.x - pa.x, pc.y - pa.y, pc.z - pa.z));
+
+		if (dot(normal, outwards) < 0.0f)
+		{
+			std::swap(b, c);
+		}
+
+		indices.push_back(a);
+		indices.push_back(b);
+		indices.push_back(c);
+	}
+
+	// a 2 x 2 x 2 cube, either 8 shared corners or 4 vertices for each face
+	void makeCube(const bool shared, std::vector<Vertex> & vertices, std::vector<UINT> & indices)
+	{
+		vertices.clear();
+		indices.clear();
+
+		for (UINT axis = 0; axis < 3; ++axis)
+		{
+			for (int side = -1; side <= 1; side += 2)
+			{
+				float outwards[3] = { 0.0f, 0.0f, 0.0f };
+				outwards[axis] = static_cast<float>(side);
+				UINT quad[4];
+
+				for (UINT corner = 0; corner < 4; ++corner)
+				{
+					// around the face in order
+					float position[3];
+					position[axis] = static_cast<float>(side);
+					position[(axis + 1) % 3] = corner == 0 || corner == 3 ? -1.0f : 1.0f;
+					position[(axis + 2) % 3] = corner < 2 ? -1.0f : 1.0f;
+
+					quad[corner] = static_cast<UINT>(vertices.size());
+
+					if (shared)
+					{
+						for (UINT v = 0; v < vertices.size(); ++v)
+						{
+							if (vertices[v].m_position.x == position[0] && vertices[v].m_position.y == position[1] && vertices[v].m_position.z == position[2])
+							{
+								quad[corner] = v;
+							}
+						}
+					}
+
+					if (quad[corner] == vertices.size())
+					{
+						vertices.push_back(Vertex());
+						vertices.back().m_position = DirectX::XMFLOAT3(position[0], position[1], position[2]);
+					}
+				}
+
+				const DirectX::XMFLOAT3 normal(outwards[0], outwards[1], outwards[2]);
+				addTriangle(vertices, indices, quad[0], quad[1], quad[2], normal);
+				addTriangle(vertices, indices, quad[0], quad[2], quad[3], normal);
+			}
+		}
+	}
+
+	// a bumpy height field over a size x size grid, u and v run across it
+	void makeTerrain(const UINT size, std::vector<Vertex> & vertices, std::vector<DirectX::XMFLOAT2> & texCoords, std::vector<UINT> & indices)
+	{
+		vertices.resize((size + 1) * (size + 1));
+		texCoords.resize(vertices.size());
+		indices.clear();
+		indices.reserve(size * size * 6);
+
+		for (UINT y = 0; y <= size; ++y)
+		{
+			for (UINT x = 0; x <= size; ++x)
+			{
+				const UINT v = y * (size + 1) + x;
+				vertices[v].m_position = DirectX::XMFLOAT3(x * 0.1f, y * 0.1f, std::sin(x * 0.37f) * std::cos(y * 0.23f) * 0.5f);
+				texCoords[v] = DirectX::XMFLOAT2(x / static_cast<float>(size), 1.0f - y / static_cast<float>(size));
+			}
+		}
+
+		for (UINT y = 0; y < size; ++y)
+		{
+			for (UINT x = 0; x < size; ++x)
+			{
+				const UINT corner = y * (size + 1) + x;
+				const UINT quad[6] = { corner, corner + size + 2, corner + 1, corner, corner + size + 1, corner + size + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(TangentSpaceTests)
+	{
+	public:
+
+		TEST_METHOD(TangentSpace_weightsNormalsByAngle)
+		{
+			JobSystem jobSystem(2);
+			TangentSpaceGenerator generator(jobSystem);
+			TangentSpaceStats stats;
+
+			// every corner of the cube has three faces meeting at right angles. by area the face whose diagonal
+			// runs through the corner would count twice, by angle they all count the same
+			std::vector<Vertex> vertices;
+			std::vector<UINT> indices;
+			makeCube(true, vertices, indices);
+			Assert::AreEqual(static_cast<size_t>(8), vertices.size());
+
+			std::vector<DirectX::XMFLOAT3> normals;
+			generator.generateNormals(vertices, indices, false, normals, stats);
+			Assert::AreEqual(12u, stats.m_triangles);
+			Assert::AreEqual(0u, stats.m_degenerateTriangles);
+
+			for (size_t v = 0; v < vertices.size(); ++v)
+			{
+				Assert::IsTrue(near3(normalise(vertices[v].m_position), normals[v], 1e-6f));
+			}
+
+			// split per face the normals are flat, unless the positions are welded back together
+			makeCube(false, vertices, indices);
+			Assert::AreEqual(static_cast<size_t>(24), vertices.size());
+
+			generator.generateNormals(vertices, indices, false, normals, stats);
+
+			for (size_t v = 0; v < vertices.size(); ++v)
+			{
+				const UINT face = static_cast<UINT>(v / 4);
+				float expected[3] = { 0.0f, 0.0f, 0.0f };
+				expected[face / 2] = face % 2 == 0 ? -1.0f : 1.0f;
+				Assert::IsTrue(near3(DirectX::XMFLOAT3(expected[0], expected[1], expected[2]), normals[v], 1e-6f));
+			}
+
+			generator.generateNormals(vertices, indices, true, normals, stats);
+
+			for (size_t v = 0; v < vertices.size(); ++v)
+			{
+				Assert::IsTrue(near3(normalise(vertices[v].m_position), normals[v], 1e-6f));
+			}
+
+			// a triangle with no area counts for nothing, a vertex only it uses gets no normal
+			vertices.push_back(Vertex());
+			const UINT flat[3] = { 0, 1, static_cast<UINT>(vertices.size() - 1) };
+			vertices.back().m_position = DirectX::XMFLOAT3(vertices[0].m_position.x * 3.0f - vertices[1].m_position.x * 2.0f,
+				vertices[0].m_position.y * 3.0f - vertices[1].m_position.y * 2.0f, vertices[0].m_position.z * 3.0f - vertices[1].m_position.z * 2.0f);
+			indices.insert(indices.end(), flat, flat + 3);
+
+			generator.generateNormals(vertices, indices, false, normals, stats);
+			Assert::AreEqual(1u, stats.m_degenerateTriangles);
+			Assert::IsTrue(near3(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), normals.back(), 0.0f));
+			Assert::IsTrue(std::fabs(dot(normals[0], normals[0]) - 1.0f) < 1e-6f);
+		}
+
+		TEST_METHOD(TangentSpace_matchesReferenceTangents)
+		{
+			JobSystem jobSystem(2);
+			TangentSpaceGenerator generator(jobSystem);
+			TangentSpaceStats stats;
+
+			// a square mapped with a shear, u = x + y / 2 and v = y. the tangent is which way u grows with v held,
+			// (1, 0, 0), not the gradient of u which leans towards y
+			{
+				std::vector<Vertex> vertices(4);
+				vertices[0].m_position = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+				vertices[1].m_position = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+				vertices[2].m_position = DirectX::XMFLOAT3(1.0f, 1.0f, 0.0f);
+				vertices[3].m_position = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+
+				std::vector<DirectX::XMFLOAT2> texCoords(4);
+
+				for (UINT v = 0; v < 4; ++v)
+				{
+					texCoords[v] = DirectX::XMFLOAT2(vertices[v].m_position.x + vertices[v].m_position.y * 0.5f, vertices[v].m_position.y);
+				}
+
+				std::vector<UINT> indices;
+				addTriangle(vertices, indices, 0, 1, 2, DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f));
+				addTriangle(vertices, indices, 0, 2, 3, DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f));
+
+				std::vector<DirectX::XMFLOAT3> normals;
+				std::vector<DirectX::XMFLOAT4> tangents;
+				generator.generateNormals(vertices, indices, false, normals, stats);
+				generator.generateTangents(vertices, normals, texCoords, indices, tangents, stats);
+				Assert::AreEqual(0u, stats.m_splitVertices);
+
+				for (UINT v = 0; v < 4; ++v)
+				{
+					Assert::IsTrue(near3(DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f), normals[v], 1e-6f));
+					Assert::IsTrue(near3(DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f), xyz(tangents[v]), 1e-6f));
+
+					// the bitangent is v's direction made square to the tangent
+					const DirectX::XMFLOAT3 bitangent = cross(normals[v], xyz(tangents[v]));
+					Assert::IsTrue(near3(DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), DirectX::XMFLOAT3(bitangent.x * tangents[v].w, bitangent.y * tangents[v].w, bitangent.z * tangents[v].w), 1e-6f));
+				}
+			}
+
+			// a band around a sphere, u round the equator and v pole to pole. the reference frame at each vertex is
+			// the surface's own derivatives, which the averaged triangles come close to on a fine enough mesh
+			{
+				const UINT columns = 128;
+				const UINT rows = 64;
+				std::vector<Vertex> vertices;
+				std::vector<DirectX::XMFLOAT2> texCoords;
+				std::vector<UINT> indices;
+
+				for (UINT r = 0; r <= rows; ++r)
+				{
+					for (UINT c = 0; c <= columns; ++c)
+					{
+						const float u = c / static_cast<float>(columns);
+						const float v = 0.1f + 0.8f * r / static_cast<float>(rows);
+						const float phi = u * DirectX::XM_2PI;
+						const float theta = v * DirectX::XM_PI;
+
+						vertices.push_back(Vertex());
+						vertices.back().m_position = DirectX::XMFLOAT3(std::cos(phi) * std::sin(theta), std::cos(theta), std::sin(phi) * std::sin(theta));
+						texCoords.push_back(DirectX::XMFLOAT2(u, v));
+
+						// the seam has to land on exactly the same positions to be welded
+						if (c == columns)
+						{
+							vertices.back().m_position = vertices[vertices.size() - 1 - columns].m_position;
+						}
+					}
+				}
+
+				for (UINT r = 0; r < rows; ++r)
+				{
+					for (UINT c = 0; c < columns; ++c)
+					{
+						const UINT corner = r * (columns + 1) + c;
+						const DirectX::XMFLOAT3 & outwards = vertices[corner].m_position;
+						addTriangle(vertices, indices, corner, corner + 1, corner + columns + 2, outwards);
+						addTriangle(vertices, indices, corner, corner + columns + 2, corner + columns + 1, outwards);
+					}
+				}
+
+				// welded so the normals don't crease where u wraps round
+				std::vector<DirectX::XMFLOAT3> normals;
+				std::vector<DirectX::XMFLOAT4> tangents;
+				generator.generateNormals(vertices, indices, true, normals, stats);
+				generator.generateTangents(vertices, normals, texCoords, indices, tangents, stats);
+				Assert::AreEqual(0u, stats.m_splitVertices);
+
+				float worstTangent = 0.0f;
+
+				for (UINT r = 1; r < rows; ++r)
+				{
+					for (UINT c = 0; c <= columns; ++c)
+					{
+						const UINT v = r * (columns + 1) + c;
+						const float phi = c / static_cast<float>(columns) * DirectX::XM_2PI;
+						const float theta = (0.1f + 0.8f * r / static_cast<float>(rows)) * DirectX::XM_PI;
+
+						const DirectX::XMFLOAT3 dPdu(-std::sin(phi), 0.0f, std::cos(phi));
+						const DirectX::XMFLOAT3 dPdv(std::cos(phi) * std::cos(theta), -std::sin(theta), std::sin(phi) * std::cos(theta));
+
+						Assert::IsTrue(near3(normalise(vertices[v].m_position), normals[v], 2e-3f));
+
+						const DirectX::XMFLOAT3 tangent = xyz(tangents[v]);
+						worstTangent = std::max(worstTangent, 1.0f - dot(tangent, dPdu));
+
+						const DirectX::XMFLOAT3 bitangent = cross(normals[v], tangent);
+						Assert::IsTrue(dot(DirectX::XMFLOAT3(bitangent.x * tangents[v].w, bitangent.y * tangents[v].w, bitangent.z * tangents[v].w), dPdv) > 0.99f);
+						Assert::IsTrue(std::fabs(dot(tangent, normals[v])) < 1e-5f);
+					}
+				}
+
+				// only the seam columns are further out, they see the triangles on one side of them
+				Assert::IsTrue(worstTangent < 1e-3f);
+			}
+		}
+
+		TEST_METHOD(TangentSpace_splitsMirroredSeams)
+		{
+			// two quads side by side mapped with u = |x|, so the texture mirrors about x = 0 where they share vertices
+			std::vector<Vertex> vertices(6);
+			std::vector<DirectX::XMFLOAT2> texCoords(6);
+
+			for (UINT v = 0; v < 6; ++v)
+			{
+				const float x = static_cast<float>(v % 3) - 1.0f;
+				const float y = static_cast<float>(v / 3);
+				vertices[v].m_position = DirectX::XMFLOAT3(x, y, 0.0f);
+				texCoords[v] = DirectX::XMFLOAT2(std::fabs(x), y);
+			}
+
+			const DirectX::XMFLOAT3 towardsViewer(0.0f, 0.0f, -1.0f);
+			std::vector<UINT> indices;
+			addTriangle(vertices, indices, 0, 1, 4, towardsViewer);
+			addTriangle(vertices, indices, 0, 4, 3, towardsViewer);
+			addTriangle(vertices, indices, 1, 2, 5, towardsViewer);
+			addTriangle(vertices, indices, 1, 5, 4, towardsViewer);
+
+			JobSystem jobSystem(2);
+			TangentSpaceGenerator generator(jobSystem);
+			TangentSpaceStats stats;
+			std::vector<DirectX::XMFLOAT3> normals;
+			std::vector<DirectX::XMFLOAT4> tangents;
+			generator.generateNormals(vertices, indices, false, normals, stats);
+			generator.generateTangents(vertices, normals, texCoords, indices, tangents, stats);
+
+			// the two vertices on the seam get a copy for the mirrored side
+			Assert::AreEqual(2u, stats.m_splitVertices);
+			Assert::AreEqual(static_cast<size_t>(8), vertices.size());
+			Assert::AreEqual(vertices.size(), normals.size());
+			Assert::AreEqual(vertices.size(), texCoords.size());
+			Assert::AreEqual(vertices.size(), tangents.size());
+
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				// u grows away from the seam on both sides, v up both sides whichever way round the texture is
+				const bool left = i < 6;
+				const DirectX::XMFLOAT4 & tangent = tangents[indices[i]];
+				Assert::IsTrue(near3(DirectX::XMFLOAT3(left ? -1.0f : 1.0f, 0.0f, 0.0f), xyz(tangent), 1e-6f));
+
+				const DirectX::XMFLOAT3 bitangent = cross(normals[indices[i]], xyz(tangent));
+				Assert::IsTrue(near3(DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), DirectX::XMFLOAT3(bitangent.x * tangent.w, bitangent.y * tangent.w, bitangent.z * tangent.w), 1e-6f));
+			}
+
+			Assert::IsTrue(tangents[indices[0]].w != tangents[indices[6]].w);
+		}
+
+		TEST_METHOD(TangentSpace_givesTheSameResultWhateverTheThreads)
+		{
+			std::vector<Vertex> terrain;
+			std::vector<DirectX::XMFLOAT2> terrainTexCoords;
+			std::vector<UINT> terrainIndices;
+			makeTerrain(60, terrain, terrainTexCoords, terrainIndices);
+
+			std::vector<DirectX::XMFLOAT3> normals[2];
+			std::vector<DirectX::XMFLOAT4> tangents[2];
+
+			for (UINT pass = 0; pass < 2; ++pass)
+			{
+				JobSystem jobSystem(pass == 0 ? 1 : 4);
+				TangentSpaceGenerator generator(jobSystem);
+				generator.setGrainSize(pass == 0 ? 100000 : 7);
+
+				std::vector<Vertex> vertices = terrain;
+				std::vector<DirectX::XMFLOAT2> texCoords = terrainTexCoords;
+				std::vector<UINT> indices = terrainIndices;
+				TangentSpaceStats stats;
+				generator.generateNormals(vertices, indices, true, normals[pass], stats);
+				generator.generateTangents(vertices, normals[pass], texCoords, indices, tangents[pass], stats);
+			}
+
+			Assert::AreEqual(normals[0].size(), normals[1].size());
+			Assert::AreEqual(0, memcmp(normals[0].data(), normals[1].data(), sizeof(DirectX::XMFLOAT3) * normals[0].size()));
+			Assert::AreEqual(0, memcmp(tangents[0].data(), tangents[1].data(), sizeof(DirectX::XMFLOAT4) * tangents[0].size()));
+		}
+
+		TEST_METHOD(TangentSpace_generatesLargeMeshesAcrossCores)
+		{
+			// two million triangles
+			std::vector<Vertex> terrain;
+			std::vector<DirectX::XMFLOAT2> terrainTexCoords;
+			std::vector<UINT> indices;
+			makeTerrain(1000, terrain, terrainTexCoords, indices);
+
+			double normalSeconds[2] = { 0.0, 0.0 };
+			double tangentSeconds[2] = { 0.0, 0.0 };
+			UINT threads[2] = { 0, 0 };
+
+			for (UINT pass = 0; pass < 2; ++pass)
+			{
+				JobSystem jobSystem(pass == 0 ? 1 : 4);
+				TangentSpaceGenerator generator(jobSystem);
+				TangentSpaceStats stats;
+
+				std::vector<Vertex> vertices = terrain;
+				std::vector<DirectX::XMFLOAT2> texCoords = terrainTexCoords;
+				std::vector<UINT> tangentIndices = indices;
+				std::vector<DirectX::XMFLOAT3> normals;
+				std::vector<DirectX::XMFLOAT4> tangents;
+
+				generator.generateNormals(vertices, indices, true, normals, stats);
+				normalSeconds[pass] = stats.m_seconds;
+				threads[pass] = stats.m_threadCount;
+				Assert::AreEqual(2000000u, stats.m_triangles);
+
+				generator.generateTangents(vertices, normals, texCoords, tangentIndices, tangents, stats);
+				tangentSeconds[pass] = stats.m_seconds;
+				Assert::AreEqual(0u, stats.m_splitVertices);
+			}
+
+			char statsStr[256];
+			sprintf_s(statsStr, "TangentSpace: 2M triangles, normals %.1f ms on %u threads %.1f ms on %u, tangents %.1f ms on %u threads %.1f ms on %u\n",
+				normalSeconds[0] * 1000.0, threads[0], normalSeconds[1] * 1000.0, threads[1],
+				tangentSeconds[0] * 1000.0, threads[0], tangentSeconds[1] * 1000.0, threads[1]);
+			Logger::WriteMessage(statsStr);
+		}
+	};
+}
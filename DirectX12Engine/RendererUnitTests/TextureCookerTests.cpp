@@ -0,0 +1,263 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/TextureCooker.h"
+#include "../DirectX12Engine/BlockCompression.h"
+#include "../DirectX12Engine/DdsFormat.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// smooth gradients with a bit of noise and a hard edge, roughly what an albedo texture looks like
+	DecodedImage makeTestImage(const UINT width, const UINT height, const bool opaque)
+	{
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<int> noise(-6, 6);
+
+		DecodedImage image;
+		image.m_width = width;
+		image.m_height = height;
+		image.m_pixels.resize(static_cast<size_t>(width) * height * 4);
+
+		for (UINT y = 0; y < height; ++y)
+		{
+			for (UINT x = 0; x < width; ++x)
+			{
+				UINT8 * pixel = &image.m_pixels[(static_cast<size_t>(y) * width + x) * 4];
+				const int edge = x > width / 2 ? 60 : 0;
+
+				pixel[0] = static_cast<UINT8>(std::min(std::max(static_cast<int>(x * 255 / width) + noise(rng), 0), 255));
+				pixel[1] = static_cast<UINT8>(std::min(std::max(static_cast<int>(y * 255 / height) + edge + noise(rng), 0), 255));
+				pixel[2] = static_cast<UINT8>(std::min(std::max(128 + static_cast<int>(64.0 * std::sin(x * 0.2)) + noise(rng), 0), 255));
+				pixel[3] = opaque ? 255 : static_cast<UINT8>((x + y) * 255 / (width + height));
+			}
+		}
+
+		return image;
+	}
+
+	typedef void (*DecodeBlockFunc)(const UINT8 * block, UINT8 * rgba);
+
+	// psnr over the given channels of the top mip
+	double measurePsnr(const DecodedImage & image, const UINT8 * data, const UINT bytesPerBlock, DecodeBlockFunc decode, const UINT channelMask)
+	{
+		const UINT blocksWide = (image.m_width + 3) / 4;
+		double squaredError = 0.0;
+		UINT64 samples = 0;
+
+		for (UINT by = 0; by < (image.m_height + 3) / 4; ++by)
+		{
+			for (UINT bx = 0; bx < blocksWide; ++bx)
+			{
+				UINT8 decoded[64] = {};
+				decode(data + (by * blocksWide + bx) * bytesPerBlock, decoded);
+
+				for (UINT t = 0; t < 16; ++t)
+				{
+					const UINT x = bx * 4 + t % 4;
+					const UINT y = by * 4 + t / 4;
+
+					if (x >= image.m_width || y >= image.m_height)
+					{
+						continue;
+					}
+
+					for (UINT c = 0; c < 4; ++c)
+					{
+						if (channelMask & (1 << c))
+						{
+							const double d = static_cast<double>(decoded[t * 4 + c]) - image.m_pixels[(static_cast<size_t>(y) * image.m_width + x) * 4 + c];
+							squaredError += d * d;
+							++samples;
+						}
+					}
+				}
+			}
+		}
+
+		const double mse = squaredError / static_cast<double>(samples);
+		return mse == 0.0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+	}
+
+	double encodeAndMeasure(const TextureCompression compression, DecodeBlockFunc decode, const UINT channelMask)
+	{
+		JobSystem jobSystem(2);
+		TextureCooker cooker(jobSystem);
+
+		// BC1 alpha is only on or off, so it gets an opaque image
+		const DecodedImage image = makeTestImage(61, 47, compression == TEXTURE_COMPRESSION_BC1);
+		std::vector<UINT8> data(TextureCooker::surfaceSize(image.m_width, image.m_height, compression));
+		cooker.encodeSurface(image, compression, data.data());
+
+		return measurePsnr(image, data.data(), TextureCooker::blockBytes(compression), decode, channelMask);
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(TextureCookerTests)
+	{
+	public:
+
+		TEST_METHOD(BlockCompression_qualityPerFormat)
+		{
+			const double bc1 = encodeAndMeasure(TEXTURE_COMPRESSION_BC1, decodeBc1Block, 0x7);
+			const double bc3Colour = encodeAndMeasure(TEXTURE_COMPRESSION_BC3, decodeBc3Block, 0x7);
+			const double bc3Alpha = encodeAndMeasure(TEXTURE_COMPRESSION_BC3, decodeBc3Block, 0x8);
+			const double bc5 = encodeAndMeasure(TEXTURE_COMPRESSION_BC5, decodeBc5Block, 0x3);
+			const double bc7 = encodeAndMeasure(TEXTURE_COMPRESSION_BC7, decodeBc7Block, 0xf);
+
+			Assert::IsTrue(bc1 > 32.0);
+			Assert::IsTrue(bc3Colour > 32.0);
+			Assert::IsTrue(bc3Alpha > 45.0);
+			Assert::IsTrue(bc5 > 42.0);
+			Assert::IsTrue(bc7 > 34.0);
+
+			// BC7 should beat BC1 on colour at twice the size
+			const double bc7Colour = encodeAndMeasure(TEXTURE_COMPRESSION_BC7, decodeBc7Block, 0x7);
+			Assert::IsTrue(bc7Colour > bc1);
+		}
+
+		TEST_METHOD(BlockCompression_flatBlocksAreExact)
+		{
+			UINT8 texels[64];
+
+			for (UINT t = 0; t < 16; ++t)
+			{
+				texels[t * 4 + 0] = 200;
+				texels[t * 4 + 1] = 100;
+				texels[t * 4 + 2] = 50;
+				texels[t * 4 + 3] = 255;
+			}
+
+			UINT8 block[16];
+			UINT8 decoded[64];
+
+			encodeBc7Block(texels, block);
+			decodeBc7Block(block, decoded);
+
+			for (UINT i = 0; i < 64; ++i)
+			{
+				Assert::IsTrue(std::abs(static_cast<int>(decoded[i]) - static_cast<int>(texels[i])) <= 1);
+			}
+
+			encodeBc5Block(texels, block);
+			decodeBc5Block(block, decoded);
+
+			for (UINT t = 0; t < 16; ++t)
+			{
+				Assert::AreEqual(static_cast<UINT8>(200), decoded[t * 4 + 0]);
+				Assert::AreEqual(static_cast<UINT8>(100), decoded[t * 4 + 1]);
+			}
+		}
+
+		TEST_METHOD(BlockCompression_bc1KeepsPunchThroughAlpha)
+		{
+			UINT8 texels[64];
+
+			for (UINT t = 0; t < 16; ++t)
+			{
+				texels[t * 4 + 0] = static_cast<UINT8>(t * 16);
+				texels[t * 4 + 1] = 90;
+				texels[t * 4 + 2] = 30;
+				texels[t * 4 + 3] = (t % 3 == 0) ? 0 : 255;
+			}
+
+			UINT8 block[8];
+			UINT8 decoded[64];
+			encodeBc1Block(texels, block);
+			decodeBc1Block(block, decoded);
+
+			for (UINT t = 0; t < 16; ++t)
+			{
+				Assert::AreEqual(static_cast<UINT8>(t % 3 == 0 ? 0 : 255), decoded[t * 4 + 3]);
+			}
+		}
+
+		TEST_METHOD(TextureCooker_srgbMipsFilterInLinearSpace)
+		{
+			DecodedImage image;
+			image.m_width = 2;
+			image.m_height = 1;
+			image.m_pixels = { 0, 0, 0, 255, 255, 255, 255, 255 };
+
+			DecodedImage copy = image;
+
+			const std::vector<DecodedImage> linearMips = buildMipChain(std::move(image), false);
+			const std::vector<DecodedImage> srgbMips = buildMipChain(std::move(copy), true);
+
+			// half way in linear light is 188 once encoded back to srgb, not 128
+			Assert::AreEqual(static_cast<UINT8>(128), linearMips[1].m_pixels[0]);
+			Assert::AreEqual(static_cast<UINT8>(188), srgbMips[1].m_pixels[0]);
+			Assert::AreEqual(static_cast<UINT8>(255), srgbMips[1].m_pixels[3]);
+		}
+
+		TEST_METHOD(TextureCooker_cooksMipChainIntoDds)
+		{
+			JobSystem jobSystem(3);
+			TextureCooker cooker(jobSystem);
+
+			TextureCookSettings settings;
+			settings.m_compression = TEXTURE_COMPRESSION_BC7;
+			settings.m_srgb = true;
+			settings.m_generateMips = true;
+
+			TextureCookStats stats;
+			const CookedTexture texture = cooker.cook(makeTestImage(40, 24, false), settings, stats);
+
+			Assert::IsTrue(texture.m_format == DXGI_FORMAT_BC7_UNORM_SRGB);
+			// 40x24, 20x12, 10x6, 5x3, 2x1, 1x1
+			Assert::AreEqual(6u, texture.m_mipCount);
+
+			const size_t expectedSize = (10 * 6 + 5 * 3 + 3 * 2 + 2 * 1 + 1 + 1) * 16;
+			Assert::AreEqual(expectedSize, texture.m_data.size());
+			Assert::AreEqual(static_cast<UINT64>(expectedSize / 16), stats.m_blocks);
+			Assert::AreEqual(static_cast<UINT64>(40 * 24 + 20 * 12 + 10 * 6 + 5 * 3 + 2 + 1), stats.m_texels);
+
+			const std::vector<UINT8> file = TextureCooker::writeDds(texture);
+			Assert::AreEqual(4 + sizeof(DdsHeader) + sizeof(DdsHeaderDx10) + expectedSize, file.size());
+
+			UINT32 magic;
+			DdsHeader header;
+			DdsHeaderDx10 dx10;
+			memcpy(&magic, file.data(), 4);
+			memcpy(&header, file.data() + 4, sizeof(header));
+			memcpy(&dx10, file.data() + 4 + sizeof(header), sizeof(dx10));
+
+			Assert::AreEqual(c_ddsMagic, magic);
+			Assert::AreEqual(40u, header.m_width);
+			Assert::AreEqual(24u, header.m_height);
+			Assert::AreEqual(6u, header.m_mipMapCount);
+			Assert::AreEqual(c_ddsFourCcDx10, header.m_pixelFormat.m_fourCc);
+			Assert::AreEqual(static_cast<UINT32>(DXGI_FORMAT_BC7_UNORM_SRGB), dx10.m_dxgiFormat);
+			Assert::AreEqual(0, memcmp(file.data() + file.size() - expectedSize, texture.m_data.data(), expectedSize));
+		}
+
+		TEST_METHOD(TextureCooker_threadCountDoesNotChangeOutput)
+		{
+			const DecodedImage image = makeTestImage(64, 64, false);
+			const size_t size = TextureCooker::surfaceSize(64, 64, TEXTURE_COMPRESSION_BC3);
+
+			std::vector<UINT8> single(size);
+			std::vector<UINT8> multi(size);
+
+			{
+				JobSystem jobSystem(1);
+				TextureCooker cooker(jobSystem);
+				cooker.encodeSurface(image, TEXTURE_COMPRESSION_BC3, single.data());
+			}
+			{
+				JobSystem jobSystem(4);
+				TextureCooker cooker(jobSystem);
+				cooker.encodeSurface(image, TEXTURE_COMPRESSION_BC3, multi.data());
+			}
+
+			Assert::IsTrue(single == multi);
+		}
+	};
+}
@@ -0,0 +1,277 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/TextureLoader.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	std::vector<UINT8> makeTgaHeader(const UINT8 imageType, const UINT width, const UINT height, const UINT8 bitsPerPixel, const UINT8 descriptor)
+	{
+		std::vector<UINT8> tga(18, 0);
+		tga[2] = imageType;
+		tga[12] = static_cast<UINT8>(width & 0xff);
+		tga[13] = static_cast<UINT8>(width >> 8);
+		tga[14] = static_cast<UINT8>(height & 0xff);
+		tga[15] = static_cast<UINT8>(height >> 8);
+		tga[16] = bitsPerPixel;
+		tga[17] = descriptor;
+		return tga;
+	}
+
+	void checkPixel(const DecodedImage & image, const UINT x, const UINT y, const UINT8 r, const UINT8 g, const UINT8 b, const UINT8 a)
+	{
+		const UINT8 * pixel = &image.m_pixels[(y * image.m_width + x) * 4];
+		Assert::AreEqual(r, pixel[0]);
+		Assert::AreEqual(g, pixel[1]);
+		Assert::AreEqual(b, pixel[2]);
+		Assert::AreEqual(a, pixel[3]);
+	}
+
+	TextureSource makeEmbeddedSource(const char * name, const std::vector<UINT8> & data, const char * hint)
+	{
+		TextureSource source;
+		source.m_name = name;
+		source.m_formatHint = hint;
+		source.m_embeddedData = data.data();
+		source.m_embeddedSize = data.size();
+		source.m_rawWidth = 0;
+		source.m_rawHeight = 0;
+		return source;
+	}
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(TextureLoaderTests)
+	{
+	public:
+
+		TEST_METHOD(ImageDecoder_decodesUncompressedTga)
+		{
+			// 2x2, 24 bit, bottom row first
+			std::vector<UINT8> tga = makeTgaHeader(2, 2, 2, 24, 0);
+			const UINT8 pixels[] =
+			{
+				255, 0, 0,		0, 255, 0,		// bottom: blue, green
+				0, 0, 255,		255, 255, 255	// top: red, white
+			};
+			tga.insert(tga.end(), pixels, pixels + sizeof(pixels));
+
+			DecodedImage image;
+			Assert::IsTrue(decodeTga(tga.data(), tga.size(), image));
+			Assert::AreEqual(2u, image.m_width);
+			Assert::AreEqual(2u, image.m_height);
+
+			checkPixel(image, 0, 0, 255, 0, 0, 255);
+			checkPixel(image, 1, 0, 255, 255, 255, 255);
+			checkPixel(image, 0, 1, 0, 0, 255, 255);
+			checkPixel(image, 1, 1, 0, 255, 0, 255);
+
+			// cut short
+			tga.pop_back();
+			Assert::IsFalse(decodeTga(tga.data(), tga.size(), image));
+		}
+
+		TEST_METHOD(ImageDecoder_decodesRleTga)
+		{
+			// 3x1, 32 bit, top down, a run of two then one raw pixel
+			std::vector<UINT8> tga = makeTgaHeader(10, 3, 1, 32, 0x20);
+			const UINT8 packets[] =
+			{
+				0x81, 10, 20, 30, 40,	// run of 2
+				0x00, 50, 60, 70, 80	// 1 raw
+			};
+			tga.insert(tga.end(), packets, packets + sizeof(packets));
+
+			DecodedImage image;
+			Assert::IsTrue(decodeTga(tga.data(), tga.size(), image));
+			checkPixel(image, 0, 0, 30, 20, 10, 40);
+			checkPixel(image, 1, 0, 30, 20, 10, 40);
+			checkPixel(image, 2, 0, 70, 60, 50, 80);
+
+			// colour mapped images aren't supported
+			std::vector<UINT8> colourMapped = makeTgaHeader(1, 1, 1, 8, 0);
+			colourMapped[1] = 1;
+			colourMapped.push_back(0);
+			Assert::IsFalse(decodeTga(colourMapped.data(), colourMapped.size(), image));
+		}
+
+		TEST_METHOD(ImageDecoder_buildsMipChainDownToOne)
+		{
+			DecodedImage source;
+			source.m_width = 5;
+			source.m_height = 3;
+			source.m_pixels.resize(5 * 3 * 4);
+
+			// left half black, right half white, alpha 255
+			for (UINT y = 0; y < 3; ++y)
+			{
+				for (UINT x = 0; x < 5; ++x)
+				{
+					UINT8 * pixel = &source.m_pixels[(y * 5 + x) * 4];
+					const UINT8 value = x < 2 ? 0 : 255;
+					pixel[0] = value;
+					pixel[1] = value;
+					pixel[2] = value;
+					pixel[3] = 255;
+				}
+			}
+
+			const std::vector<DecodedImage> mips = buildMipChain(std::move(source));
+
+			Assert::AreEqual(static_cast<size_t>(3), mips.size());
+			Assert::AreEqual(2u, mips[1].m_width);
+			Assert::AreEqual(1u, mips[1].m_height);
+			Assert::AreEqual(1u, mips[2].m_width);
+			Assert::AreEqual(1u, mips[2].m_height);
+
+			// the left texel only covers the black columns, the right one takes the odd column too
+			checkPixel(mips[1], 0, 0, 0, 0, 0, 255);
+			checkPixel(mips[1], 1, 0, 255, 255, 255, 255);
+			Assert::AreEqual(static_cast<UINT8>(128), mips[2].m_pixels[0]);
+		}
+
+		TEST_METHOD(TextureLoader_resolvesMaterialPaths)
+		{
+			Assert::AreEqual(std::string("models/textures/brick.png"), TextureLoader::resolvePath("models", "textures\\brick.png"));
+			Assert::AreEqual(std::string("models/brick.png"), TextureLoader::resolvePath("models/", "./brick.png"));
+			Assert::AreEqual(std::string("C:/art/brick.png"), TextureLoader::resolvePath("models", "C:\\art\\brick.png"));
+			Assert::AreEqual(std::string("brick.png"), TextureLoader::resolvePath("", "brick.png"));
+
+			UINT index = 0;
+			Assert::IsTrue(TextureLoader::parseEmbeddedIndex("*12", index));
+			Assert::AreEqual(12u, index);
+			Assert::IsFalse(TextureLoader::parseEmbeddedIndex("*", index));
+			Assert::IsFalse(TextureLoader::parseEmbeddedIndex("*1a", index));
+			Assert::IsFalse(TextureLoader::parseEmbeddedIndex("brick.png", index));
+
+			Assert::AreEqual(std::string("jpg"), TextureLoader::extensionOf("a/b.c/Brick.JPG"));
+			Assert::AreEqual(std::string(), TextureLoader::extensionOf("a.b/brick"));
+		}
+
+		TEST_METHOD(TextureLoader_loadsEverySourceInParallel)
+		{
+			JobSystem jobSystem(3);
+
+			// a stand in format, the first two bytes are the size and the rest is ignored
+			std::atomic<int> decodeCalls(0);
+			TextureLoader loader(jobSystem, [&decodeCalls](const UINT8 * data, const size_t size, const std::string & hint, DecodedImage & image)
+			{
+				++decodeCalls;
+
+				if (hint != "fake" || size < 2)
+				{
+					return false;
+				}
+
+				image.m_width = data[0];
+				image.m_height = data[1];
+				image.m_pixels.assign(static_cast<size_t>(image.m_width) * image.m_height * 4, 200);
+				return true;
+			});
+
+			std::vector<std::vector<UINT8>> payloads;
+
+			for (UINT i = 0; i < 64; ++i)
+			{
+				payloads.push_back({ static_cast<UINT8>(1 + i % 16), static_cast<UINT8>(1 + i % 8), 0, 0 });
+			}
+
+			std::vector<TextureSource> sources;
+
+			for (size_t i = 0; i < payloads.size(); ++i)
+			{
+				sources.push_back(makeEmbeddedSource("*", payloads[i], "fake"));
+			}
+
+			// raw aiTexel data, b g r a
+			const std::vector<UINT8> raw = { 1, 2, 3, 4 };
+			TextureSource rawSource = makeEmbeddedSource("*raw", raw, "");
+			rawSource.m_rawWidth = 1;
+			rawSource.m_rawHeight = 1;
+			sources.push_back(rawSource);
+
+			// decoder says no
+			const std::vector<UINT8> bad = { 1, 1 };
+			sources.push_back(makeEmbeddedSource("*bad", bad, "png"));
+
+			// file that isn't there
+			TextureSource missing = makeEmbeddedSource("missing.fake", bad, "fake");
+			missing.m_embeddedData = nullptr;
+			missing.m_path = "this/file/does/not/exist.fake";
+			sources.push_back(missing);
+
+			TextureLoadStats stats;
+			const std::vector<LoadedTexture> textures = loader.load(sources, stats);
+
+			Assert::AreEqual(sources.size(), textures.size());
+			Assert::AreEqual(static_cast<int>(payloads.size() + 1), decodeCalls.load());
+
+			for (size_t i = 0; i < payloads.size(); ++i)
+			{
+				Assert::IsTrue(textures[i].m_loaded);
+				Assert::AreEqual(static_cast<UINT>(payloads[i][0]), textures[i].m_mips[0].m_width);
+				Assert::AreEqual(static_cast<UINT>(payloads[i][1]), textures[i].m_mips[0].m_height);
+
+				const DecodedImage & last = textures[i].m_mips.back();
+				Assert::IsTrue(last.m_width == 1 && last.m_height == 1);
+			}
+
+			const LoadedTexture & rawTexture = textures[payloads.size()];
+			Assert::IsTrue(rawTexture.m_loaded);
+			checkPixel(rawTexture.m_mips[0], 0, 0, 3, 2, 1, 4);
+
+			Assert::IsFalse(textures[payloads.size() + 1].m_loaded);
+			Assert::IsFalse(textures[payloads.size() + 2].m_loaded);
+
+			Assert::AreEqual(sources.size(), stats.m_textureCount);
+			Assert::AreEqual(static_cast<size_t>(2), stats.m_failedCount);
+			Assert::AreEqual(4u, stats.m_threadCount);
+			Assert::AreEqual(static_cast<UINT64>(payloads.size() * 4 + 4 + 2), stats.m_encodedBytes);
+		}
+
+		TEST_METHOD(TextureLoader_readsFilesFromDisk)
+		{
+			const char * path = "TextureLoaderTests_temp.tga";
+
+			std::vector<UINT8> tga = makeTgaHeader(3, 4, 4, 8, 0);
+			tga.insert(tga.end(), 16, 77);
+
+			{
+				std::ofstream file(path, std::ios::binary);
+				file.write(reinterpret_cast<const char*>(tga.data()), tga.size());
+			}
+
+			JobSystem jobSystem(1);
+			TextureLoader loader(jobSystem, [](const UINT8 * data, const size_t size, const std::string &, DecodedImage & image)
+			{
+				return decodeTga(data, size, image);
+			});
+
+			TextureSource source;
+			source.m_name = path;
+			source.m_path = path;
+			source.m_formatHint = TextureLoader::extensionOf(path);
+			source.m_embeddedData = nullptr;
+			source.m_embeddedSize = 0;
+			source.m_rawWidth = 0;
+			source.m_rawHeight = 0;
+
+			TextureLoadStats stats;
+			const std::vector<LoadedTexture> textures = loader.load({ source }, stats);
+
+			std::remove(path);
+
+			Assert::IsTrue(textures[0].m_loaded);
+			Assert::AreEqual(static_cast<size_t>(3), textures[0].m_mips.size());
+			checkPixel(textures[0].m_mips[2], 0, 0, 77, 77, 77, 255);
+			Assert::AreEqual(static_cast<UINT64>(tga.size()), stats.m_encodedBytes);
+		}
+	};
+}
@@ -0,0 +1,311 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "../DirectX12Engine/TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+	// square BC1, 8 bytes a block
+	StreamedTextureDesc makeBc1Desc(const UINT size)
+	{
+		StreamedTextureDesc desc;
+		desc.m_width = size;
+		desc.m_height = size;
+		desc.m_blockCompressed = true;
+
+		for (UINT mip = size; ; mip /= 2)
+		{
+			const UINT64 blocks = (mip + 3) / 4;
+			desc.m_mipBytes.push_back(blocks * blocks * 8);
+
+			if (mip == 1)
+			{
+				break;
+			}
+		}
+
+		return desc;
+	}
+
+	// runs a texture to the given mip with no budget pressure
+	void streamTo(TextureStreamer & streamer, const StreamedTextureId texture, const UINT mip, UINT64 & frame)
+	{
+		while (streamer.getResidentMip(texture) > mip)
+		{
+			streamer.requestMip(texture, static_cast<float>(mip), 1.0f);
+			const StreamingUpdate update = streamer.update(++frame);
+
+			for (size_t i = 0; i < update.m_loads.size(); ++i)
+			{
+				streamer.onChangeComplete(update.m_loads[i].m_texture);
+			}
+		}
+	}
+
+	struct InFlight
+	{
+		UINT64 m_frameDone;
+		StreamedTextureId m_texture;
+	};
+}
+
+namespace RendererUnitTests
+{
+	TEST_CLASS(TextureStreamerTests)
+	{
+	public:
+
+		TEST_METHOD(TextureStreamer_desiredMipFollowsTexelDensity)
+		{
+			TextureStreamer streamer;
+			// tan(fov / 2) = 0.5, so 1024 pixels cover one unit at a distance of one
+			streamer.setViewport(1024, 2.0f * std::atan(0.5f));
+
+			Assert::AreEqual(0.0f, streamer.desiredMip(1024, 1.0f, 1.0f), 0.001f);
+			Assert::AreEqual(2.0f, streamer.desiredMip(1024, 1.0f, 4.0f), 0.001f);
+			Assert::AreEqual(1.0f, streamer.desiredMip(512, 1.0f, 4.0f), 0.001f);
+			// magnified, still only the top mip
+			Assert::AreEqual(0.0f, streamer.desiredMip(1024, 1.0f, 0.25f), 0.001f);
+		}
+
+		TEST_METHOD(TextureStreamer_startsWithMipTailOnly)
+		{
+			TextureStreamer streamer;
+			streamer.setMipTailSize(64);
+
+			const StreamedTextureDesc desc = makeBc1Desc(1024);
+			const StreamedTextureId texture = streamer.addTexture(desc);
+
+			// 1024 >> 4 = 64
+			Assert::AreEqual(4u, streamer.getTailMip(texture));
+			Assert::AreEqual(4u, streamer.getResidentMip(texture));
+
+			UINT64 tailBytes = 0;
+
+			for (size_t i = 4; i < desc.m_mipBytes.size(); ++i)
+			{
+				tailBytes += desc.m_mipBytes[i];
+			}
+
+			Assert::AreEqual(tailBytes, streamer.getResidentBytes(texture));
+
+			// not asked for, nothing to load
+			Assert::IsTrue(streamer.update(1).m_loads.empty());
+		}
+
+		TEST_METHOD(TextureStreamer_keepsBlockCompressedTailsAligned)
+		{
+			TextureStreamer streamer;
+			streamer.setMipTailSize(64);
+
+			// 512x8, by size the tail would be 64x1, which D3D12 won't take as the top of a BC texture
+			StreamedTextureDesc wide;
+			wide.m_width = 512;
+			wide.m_height = 8;
+			wide.m_blockCompressed = true;
+			wide.m_mipBytes.assign(10, 8);
+
+			const StreamedTextureId wideTexture = streamer.addTexture(wide);
+			Assert::AreEqual(1u, streamer.getTailMip(wideTexture));
+
+			// the same size uncompressed can start anywhere
+			wide.m_blockCompressed = false;
+			Assert::AreEqual(3u, streamer.getTailMip(streamer.addTexture(wide)));
+
+			// not a power of two, nothing below the top is whole blocks so the full chain goes up
+			StreamedTextureDesc odd;
+			odd.m_width = 300;
+			odd.m_height = 200;
+			odd.m_blockCompressed = true;
+			odd.m_mipBytes.assign(9, 8);
+			Assert::AreEqual(0u, streamer.getTailMip(streamer.addTexture(odd)));
+
+			// loads stay above the tail, so every one starts at an aligned mip
+			UINT64 frame = 0;
+			streamTo(streamer, wideTexture, 0, frame);
+			Assert::AreEqual(0u, streamer.getResidentMip(wideTexture));
+		}
+
+		TEST_METHOD(TextureStreamer_loadsOneMipAtATimeInPriorityOrder)
+		{
+			TextureStreamer streamer;
+			streamer.setMaxLoadsPerUpdate(1);
+
+			const StreamedTextureId low = streamer.addTexture(makeBc1Desc(512));
+			const StreamedTextureId high = streamer.addTexture(makeBc1Desc(512));
+
+			streamer.requestMip(low, 0.0f, 1.0f);
+			streamer.requestMip(high, 0.0f, 5.0f);
+
+			const StreamingUpdate first = streamer.update(1);
+			Assert::AreEqual(static_cast<size_t>(1), first.m_loads.size());
+			Assert::AreEqual(high, first.m_loads[0].m_texture);
+			Assert::AreEqual(streamer.getTailMip(high) - 1, first.m_loads[0].m_topMip);
+			Assert::AreEqual(static_cast<UINT64>(1), streamer.getStats().m_loadsDeferred);
+
+			// still in flight, so the other one gets the slot
+			streamer.requestMip(low, 0.0f, 1.0f);
+			streamer.requestMip(high, 0.0f, 5.0f);
+
+			const StreamingUpdate second = streamer.update(2);
+			Assert::AreEqual(static_cast<size_t>(1), second.m_loads.size());
+			Assert::AreEqual(low, second.m_loads[0].m_texture);
+
+			// only resident once the caller says so
+			Assert::AreEqual(streamer.getTailMip(high), streamer.getResidentMip(high));
+			streamer.onChangeComplete(high);
+			Assert::AreEqual(streamer.getTailMip(high) - 1, streamer.getResidentMip(high));
+		}
+
+		TEST_METHOD(TextureStreamer_evictsLeastRecentlyUsedFirst)
+		{
+			TextureStreamer streamer;
+			streamer.setBudget(64 * 1024 * 1024);
+
+			const StreamedTextureId older = streamer.addTexture(makeBc1Desc(256));
+			const StreamedTextureId newer = streamer.addTexture(makeBc1Desc(256));
+			const StreamedTextureId incoming = streamer.addTexture(makeBc1Desc(256));
+
+			UINT64 frame = 0;
+			streamTo(streamer, older, 0, frame);
+			streamTo(streamer, newer, 0, frame);
+
+			// exactly what is resident now, the next load has to push something out
+			streamer.setBudget(streamer.getStats().m_residentBytes);
+
+			streamer.requestMip(incoming, 0.0f, 1.0f);
+			const StreamingUpdate update = streamer.update(++frame);
+
+			Assert::AreEqual(static_cast<size_t>(1), update.m_loads.size());
+			Assert::AreEqual(static_cast<size_t>(1), update.m_evictions.size());
+			Assert::AreEqual(older, update.m_evictions[0].m_texture);
+			// one 256x256 BC1 top mip (32k) pays for one 128x128 (8k)
+			Assert::AreEqual(1u, update.m_evictions[0].m_topMip);
+			Assert::AreEqual(0u, streamer.getResidentMip(newer));
+			Assert::IsTrue(streamer.getStats().m_residentBytes <= streamer.getStats().m_budgetBytes);
+		}
+
+		TEST_METHOD(TextureStreamer_keepsHigherPriorityVisibleTextures)
+		{
+			TextureStreamer streamer;
+			streamer.setBudget(64 * 1024 * 1024);
+
+			const StreamedTextureId important = streamer.addTexture(makeBc1Desc(256));
+			const StreamedTextureId other = streamer.addTexture(makeBc1Desc(256));
+
+			UINT64 frame = 0;
+			streamTo(streamer, important, 0, frame);
+			streamer.setBudget(streamer.getStats().m_residentBytes);
+
+			// both on screen, the one already resident matters more so the other has to wait
+			streamer.requestMip(important, 0.0f, 10.0f);
+			streamer.requestMip(other, 0.0f, 1.0f);
+
+			const StreamingUpdate update = streamer.update(++frame);
+			Assert::IsTrue(update.m_loads.empty());
+			Assert::IsTrue(update.m_evictions.empty());
+			Assert::AreEqual(0u, streamer.getResidentMip(important));
+		}
+
+		TEST_METHOD(TextureStreamer_simulatedCameraPathStaysUnderBudget)
+		{
+			const UINT textureCount = 32;
+			const UINT64 budget = 4 * 1024 * 1024;
+
+			TextureStreamer streamer;
+			streamer.setBudget(budget);
+			streamer.setViewport(720, 0.785398f);
+			streamer.setMaxLoadsPerUpdate(4);
+
+			// one 2 unit wide panel every 4 units down a corridor, about 22 MB of textures in total
+			std::vector<StreamedTextureId> textures;
+
+			for (UINT i = 0; i < textureCount; ++i)
+			{
+				textures.push_back(streamer.addTexture(makeBc1Desc(1024)));
+			}
+
+			// the recorded path: down the corridor, back half way, then stood still
+			std::vector<float> path;
+
+			for (int i = 0; i <= 256; ++i)
+			{
+				path.push_back(i * 0.5f);
+			}
+
+			for (int i = 0; i <= 128; ++i)
+			{
+				path.push_back(128.0f - i * 0.5f);
+			}
+
+			path.insert(path.end(), 120, path.back());
+
+			std::deque<InFlight> inFlight;
+			UINT64 evictions = 0;
+
+			for (size_t f = 0; f < path.size(); ++f)
+			{
+				const UINT64 frame = f + 1;
+
+				// uploads take three frames to land
+				while (!inFlight.empty() && inFlight.front().m_frameDone <= frame)
+				{
+					streamer.onChangeComplete(inFlight.front().m_texture);
+					inFlight.pop_front();
+				}
+
+				for (UINT i = 0; i < textureCount; ++i)
+				{
+					const float distance = i * 4.0f + 4.0f - path[f];
+
+					// only what is in front and within the far plane is drawn
+					if (distance > 0.5f && distance < 40.0f)
+					{
+						streamer.requestMip(textures[i], streamer.desiredMip(1024, 2.0f, distance), 1.0f / distance);
+					}
+				}
+
+				const StreamingUpdate update = streamer.update(frame);
+
+				for (size_t i = 0; i < update.m_loads.size(); ++i)
+				{
+					InFlight load;
+					load.m_frameDone = frame + 3;
+					load.m_texture = update.m_loads[i].m_texture;
+					inFlight.push_back(load);
+				}
+
+				// a smaller copy is swapped in straight away
+				for (size_t i = 0; i < update.m_evictions.size(); ++i)
+				{
+					streamer.onChangeComplete(update.m_evictions[i].m_texture);
+				}
+
+				evictions += update.m_evictions.size();
+
+				Assert::IsTrue(streamer.getStats().m_residentBytes <= budget);
+			}
+
+			// the corridor doesn't fit, so it had to evict on the way
+			Assert::IsTrue(evictions > 0);
+
+			// stood at 64 long enough for every visible panel to reach the mip it asks for
+			for (UINT i = 0; i < textureCount; ++i)
+			{
+				const float distance = i * 4.0f + 4.0f - path.back();
+
+				if (distance > 0.5f && distance < 40.0f)
+				{
+					const UINT wanted = static_cast<UINT>(streamer.desiredMip(1024, 2.0f, distance));
+					Assert::IsTrue(streamer.getResidentMip(textures[i]) <= std::min(wanted, streamer.getTailMip(textures[i])));
+				}
+			}
+		}
+	};
+}